@@ -28,6 +28,7 @@ struct arch_thread;
 struct arch_cpu {
     init_stack initstack;
     void init_on_cpu();
+    void init_cpu_id(unsigned id) { } /* no TSC_AUX equivalent wired up */
     int smp_idx; /* index into the cpus array */
     u64 mpid;    /* actual MPID as read from the cpu */
 };
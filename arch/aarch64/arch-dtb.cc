@@ -405,6 +405,28 @@ bool dtb_get_gic_v3(u64 *dist, size_t *dist_len, u64 *redist, size_t *redist_len
     return true;
 }
 
+bool dtb_get_gic_v3_its(u64 *base, size_t *len)
+{
+    u64 addr[1], reg_len[1];
+    int node;
+
+    if (!dtb)
+        return false;
+
+    node = fdt_node_offset_by_compatible(dtb, -1, "arm,gic-v3-its");
+    if (node < 0) {
+        return false;
+    }
+
+    if (!dtb_get_reg_n(node, addr, reg_len, 1))
+        return false;
+
+    *base = addr[0];
+    *len = reg_len[0];
+
+    return true;
+}
+
 /* this parses the cpus node and mpidr values and returns the number of cpu in it. */
 #define DTB_MAX_CPU_COUNT 32
 static int dtb_cpu_count = -1;
@@ -95,6 +95,13 @@ bool dtb_get_gic_v2(u64 *dist, size_t *dist_len, u64 *cpu, size_t *cpu_len);
 
 bool dtb_get_gic_v3(u64 *dist, size_t *dist_len, u64 *redist, size_t *redist_len);
 
+/* bool dtb_get_gic_v3_its(u64 *base, size_t *len)
+ *
+ * gets the GICv3 ITS (Interrupt Translation Service) register frame.
+ * return false on failure or when the machine has no ITS.
+ */
+bool dtb_get_gic_v3_its(u64 *base, size_t *len);
+
 /* int dtb_get_cpus_count();
  *
  * gets the number of available cpus.
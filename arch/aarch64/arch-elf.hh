@@ -20,6 +20,9 @@ enum {
 #define ARCH_JUMP_SLOT R_AARCH64_JUMP_SLOT
 #define ARCH_TLSDESC R_AARCH64_TLSDESC
 #define ARCH_IRELATIVE R_AARCH64_IRELATIVE
+#define ARCH_RELATIVE R_AARCH64_RELATIVE
+#define ARCH_TPOFF R_AARCH64_TLS_TPREL64
+#define ARCH_DTPMOD R_AARCH64_TLS_DTPMOD64
 
 #define ELF_KERNEL_MACHINE_TYPE 183
 
@@ -50,4 +50,12 @@ private:
     gic::irq_type irq_type;
 };
 
+/* Locality-specific Peripheral Interrupts (message-signaled, translated
+   by the GICv3 ITS; always edge-triggered) */
+class lpi_interrupt : public interrupt {
+public:
+    lpi_interrupt(unsigned id, std::function<void ()> h);
+    ~lpi_interrupt();
+};
+
 #endif /* ARCH_INTERRUPT_HH */
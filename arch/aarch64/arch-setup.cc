@@ -25,6 +25,7 @@
 #include "arch-dtb.hh"
 #include "gic-v2.hh"
 #include "gic-v3.hh"
+#include "gic-v3-its.hh"
 
 #include "drivers/console.hh"
 #include "drivers/pl011.hh"
@@ -133,6 +134,14 @@ void arch_setup_free_memory()
         /* linear_map [TTBR0 - GIC REDIST] */
         mmu::linear_map((void *)redist, (mmu::phys)redist, redist_len, "gic_redist", mmu::page_size,
                         mmu::mattr::dev);
+        u64 its_base;
+        size_t its_len;
+        if (dtb_get_gic_v3_its(&its_base, &its_len)) {
+            gic::its = new gic::gic_v3_its(its_base);
+            /* linear_map [TTBR0 - GIC ITS] */
+            mmu::linear_map((void *)its_base, (mmu::phys)its_base, its_len, "gic_its", mmu::page_size,
+                            mmu::mattr::dev);
+        }
     } else if (dtb_get_gic_v2(&dist, &dist_len, &cpuif, &cpuif_len)) {
         gic::gic = new gic::gic_v2_driver(dist, cpuif);
         /* linear_map [TTBR0 - GIC CPUIF] */
@@ -200,6 +209,9 @@ void arch_init_premain()
 #if CONF_drivers_virtio_fs
 #include "drivers/virtio-fs.hh"
 #endif
+#if CONF_drivers_virtio_balloon
+#include "drivers/virtio-balloon.hh"
+#endif
 
 void arch_init_drivers()
 {
@@ -249,6 +261,9 @@ void arch_init_drivers()
 #endif
 #if CONF_drivers_virtio_fs
     drvman->register_driver(virtio::fs::probe);
+#endif
+#if CONF_drivers_virtio_balloon
+    drvman->register_driver(virtio::balloon::probe);
 #endif
     boot_time.event("drivers probe");
     drvman->load_all();
@@ -62,6 +62,22 @@ inline void halt_no_interrupts()
     processor::halt_no_interrupts();
 }
 
+// No monitor/mwait equivalent is wired up here (wfe/sev could serve one
+// day); the scheduler falls back to wait_for_interrupt().
+inline bool monitor_wait_supported()
+{
+    return false;
+}
+
+inline void monitor(const void* addr)
+{
+}
+
+inline void monitor_wait()
+{
+    processor::wait_for_interrupt();
+}
+
 class irq_flag {
 public:
     void save() {
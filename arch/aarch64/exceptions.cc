@@ -45,6 +45,17 @@ interrupt_table::interrupt_table() {
 #endif
 }
 
+unsigned int interrupt_table::slot_of(unsigned int id)
+{
+    if (id < gic::max_nr_irqs) {
+        assert(id < this->nr_irqs);
+        return id;
+    }
+    assert(id >= GIC_LPI_BASE &&
+           id < GIC_LPI_BASE + (unsigned)gic::max_nr_lpis);
+    return gic::max_nr_irqs + (id - GIC_LPI_BASE);
+}
+
 void interrupt_table::enable_irq(int id)
 {
     gic::gic->unmask_irq(id);
@@ -59,10 +70,10 @@ void interrupt_table::register_interrupt(interrupt *interrupt)
 {
     WITH_LOCK(_lock) {
         unsigned id = interrupt->get_id();
-        assert(id < this->nr_irqs);
-        interrupt_desc *old = this->irq_desc[id].read_by_owner();
+        unsigned slot = slot_of(id);
+        interrupt_desc *old = this->irq_desc[slot].read_by_owner();
         interrupt_desc *desc = new interrupt_desc(old, interrupt);
-        this->irq_desc[id].assign(desc);
+        this->irq_desc[slot].assign(desc);
         osv::rcu_dispose(old);
 #if CONF_logger_debug
         debug_early_u64(" registered IRQ id=", (u64)id);
@@ -75,8 +86,8 @@ void interrupt_table::unregister_interrupt(interrupt *interrupt)
 {
     WITH_LOCK(_lock) {
         unsigned id = interrupt->get_id();
-        assert(id < this->nr_irqs);
-        interrupt_desc *old = this->irq_desc[id].read_by_owner();
+        unsigned slot = slot_of(id);
+        interrupt_desc *old = this->irq_desc[slot].read_by_owner();
         if (!old) {
             disable_irq(id);
             return;
@@ -107,7 +118,7 @@ void interrupt_table::unregister_interrupt(interrupt *interrupt)
             desc = nullptr;
         }
 
-        this->irq_desc[id].assign(desc);
+        this->irq_desc[slot].assign(desc);
         osv::rcu_dispose(old);
 #if CONF_logger_debug
         debug_early_u64("unregistered IRQ id=", (u64)id);
@@ -125,8 +136,7 @@ bool interrupt_table::invoke_interrupt(unsigned int id)
     assert(!arch::irq_enabled());
 #endif
     WITH_LOCK(osv::rcu_read_lock) {
-        assert(id < this->nr_irqs);
-        interrupt_desc *desc = this->irq_desc[id].read();
+        interrupt_desc *desc = this->irq_desc[slot_of(id)].read();
 
         if (!desc || desc->handlers.empty()) {
             return false;
@@ -158,11 +168,23 @@ void interrupt(exception_frame* frame)
     current_interrupt_frame = frame;
 
     unsigned int iar = gic::gic->ack_irq();
+    /* on GICv2 the bits above [9:0] carry the SGI source cpu, on GICv3
+       the InterruptID itself is up to 24 bits wide - LPIs translated by
+       the ITS start at GIC_LPI_BASE */
     unsigned int irq = iar & 0x3ff;
+    if ((iar & 0xffffff) >= GIC_LPI_BASE) {
+        irq = iar & 0xffffff;
+    }
 
     /* note that special values 1022 and 1023 are used for
        group 1 and spurious interrupts respectively. */
-    if (irq >= gic::gic->nr_of_irqs()) {
+    bool valid;
+    if (irq >= GIC_LPI_BASE) {
+        valid = irq < GIC_LPI_BASE + (unsigned)gic::max_nr_lpis;
+    } else {
+        valid = irq < gic::gic->nr_of_irqs();
+    }
+    if (!valid) {
         debug_early_u64("special InterruptID detected irq=", irq);
 
     } else {
@@ -57,8 +57,12 @@ protected:
     void enable_irq(int id);
     void disable_irq(int id);
 
+    /* map an InterruptID to its irq_desc slot: SGIs/PPIs/SPIs map
+       directly, LPIs (>= GIC_LPI_BASE) to the slots above them */
+    unsigned int slot_of(unsigned int id);
+
     unsigned int nr_irqs; /* number of supported InterruptIDs, read from gic */
-    osv::rcu_ptr<interrupt_desc> irq_desc[gic::max_nr_irqs];
+    osv::rcu_ptr<interrupt_desc> irq_desc[gic::max_nr_irqs + gic::max_nr_lpis];
     mutex _lock;
 };
 
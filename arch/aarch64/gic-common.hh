@@ -16,10 +16,14 @@
 #define GIC_MAX_IRQ  1019
 #define GIC_SPI_BASE 32
 #define GIC_PPI_BASE 16
+#define GIC_LPI_BASE 8192
 
 namespace gic {
 
 constexpr int max_nr_irqs = 1020;
+/* LPIs (message-signaled interrupts translated by the GICv3 ITS) live
+   in a disjoint InterruptID space starting at GIC_LPI_BASE */
+constexpr int max_nr_lpis = 256;
 
 enum class gicd_reg : unsigned int {
     GICD_CTLR       = 0x0000, /* Distributor Control Reg */
@@ -0,0 +1,354 @@
+/*
+ * Copyright (C) 2026 Waldemar Kozaczuk
+ *
+ * This work is open source software, licensed under the terms of the
+ * BSD license as described in the LICENSE file in the top-level directory.
+ */
+
+#include <osv/mmio.hh>
+#include <osv/mmu.hh>
+#include <osv/irqlock.hh>
+#include <osv/contiguous_alloc.hh>
+#include <string.h>
+
+#include "gic-v3-its.hh"
+
+#define isb() ({ asm volatile ("isb"); })
+
+namespace gic {
+
+class gic_v3_its *its;
+
+/* 2048 commands of 32 bytes; both the queue and the device/collection
+   tables must be 64K aligned */
+constexpr size_t its_cmd_queue_size = 64 * 1024;
+constexpr size_t its_table_size = 64 * 1024;
+constexpr size_t its_table_align = 64 * 1024;
+
+/* LPI InterruptID space we advertise in GICR_PROPBASER: 14 bits of
+   InterruptID cover 8192 LPIs above GIC_LPI_BASE, of which we hand out
+   max_nr_lpis (see gic-common.hh) */
+constexpr unsigned lpi_id_bits = 14;
+constexpr size_t lpi_prop_table_size = (1 << lpi_id_bits) - GIC_LPI_BASE;
+/* pending table: one bit per InterruptID, 64K aligned */
+constexpr size_t lpi_pend_table_size = 64 * 1024;
+
+/* default LPI priority, the per-interrupt byte analogue of
+   GICD_IPRIORITY_DEF; bit 0 is the enable bit */
+#define LPI_PROP_PRIO_DEF          0xc0
+#define LPI_PROP_ENABLED           0x01
+
+/* events (MSI-X entries) we support per device id: 6 bits = 64 */
+constexpr unsigned event_id_bits = 6;
+
+enum its_cmd_op : u64 {
+    ITS_CMD_MOVI  = 0x01,
+    ITS_CMD_SYNC  = 0x05,
+    ITS_CMD_MAPD  = 0x08,
+    ITS_CMD_MAPC  = 0x09,
+    ITS_CMD_MAPTI = 0x0a,
+    ITS_CMD_INV   = 0x0c,
+};
+
+u32 gic_v3_its::read_reg(u32 r)
+{
+    return mmio_getl((mmioaddr_t)_base + r);
+}
+
+void gic_v3_its::write_reg(u32 r, u32 v)
+{
+    mmio_setl((mmioaddr_t)_base + r, v);
+}
+
+u64 gic_v3_its::read_reg64(u32 r)
+{
+    return mmio_getq((mmioaddr_t)_base + r);
+}
+
+void gic_v3_its::write_reg64(u32 r, u64 v)
+{
+    mmio_setq((mmioaddr_t)_base + r, v);
+}
+
+static void* alloc_its_table(size_t size, size_t align)
+{
+    void* va = memory::alloc_phys_contiguous_aligned(size, align);
+    assert(va);
+    memset(va, 0, size);
+    return va;
+}
+
+void gic_v3_its::init_table_bases()
+{
+    /* The ITS backs its device and collection tables with memory we
+       provide through GITS_BASERn. A flat 64K device table limits the
+       device ids we can serve, but entries are 8-32 bytes so it covers
+       at least 2048 ids - plenty for the single PCIe segment of the
+       virt machine, where devid = (bus << 8) | devfn. */
+    for (int i = 0; i < 8; i++) {
+        u64 val = read_reg64(GITS_BASER(i));
+        auto type = GITS_BASER_TYPE(val);
+        if (type != GITS_BASER_TYPE_DEVICE &&
+            type != GITS_BASER_TYPE_COLLECTION) {
+            continue;
+        }
+
+        void* va = alloc_its_table(its_table_size, its_table_align);
+        val = mmu::virt_to_phys(va) | GITS_BASER_VALID |
+              (GITS_CACHE_RaWaWb << 59) | (GITS_SHARE_IS << 10) |
+              (its_table_size / mmu::page_size - 1); /* 4K pages */
+        write_reg64(GITS_BASER(i), val);
+
+        if (type == GITS_BASER_TYPE_DEVICE) {
+            _max_devid = its_table_size / GITS_BASER_ENTRY_SIZE(val);
+        }
+    }
+}
+
+void gic_v3_its::init_cmd_queue()
+{
+    _cmd_queue = static_cast<its_cmd*>(
+        alloc_its_table(its_cmd_queue_size, its_table_align));
+    write_reg64(GITS_CBASER, mmu::virt_to_phys(_cmd_queue) |
+                GITS_CBASER_VALID | (GITS_CACHE_RaWaWb << 59) |
+                (GITS_SHARE_IS << 10) |
+                (its_cmd_queue_size / mmu::page_size - 1));
+    write_reg64(GITS_CWRITER, 0);
+    _cmd_write = 0;
+}
+
+void gic_v3_its::init_on_primary_cpu()
+{
+    u64 typer = read_reg64(GITS_TYPER);
+    _pta = typer & GITS_TYPER_PTA;
+
+    /* Disable the ITS and wait until it is quiescent before handing it
+       new table bases */
+    write_reg(GITS_CTLR, read_reg(GITS_CTLR) & ~GITS_CTLR_ENABLED);
+    while (!(read_reg(GITS_CTLR) & GITS_CTLR_QUIESCENT))
+        ;
+
+    init_table_bases();
+    init_cmd_queue();
+
+    /* LPI configuration table, shared by all redistributors: one byte
+       per LPI - priority plus the enable bit */
+    _prop_table = static_cast<u8*>(
+        alloc_its_table(lpi_prop_table_size, mmu::page_size));
+    memset(_prop_table, LPI_PROP_PRIO_DEF, lpi_prop_table_size);
+    asm volatile("dsb ishst");
+
+    write_reg(GITS_CTLR, read_reg(GITS_CTLR) | GITS_CTLR_ENABLED);
+    isb();
+
+    init_lpis_on_cpu(0);
+    map_collection(0);
+}
+
+void gic_v3_its::init_on_secondary_cpu(int smp_idx)
+{
+    init_lpis_on_cpu(smp_idx);
+    map_collection(smp_idx);
+}
+
+void gic_v3_its::init_lpis_on_cpu(int smp_idx)
+{
+    auto drv = static_cast<gic_v3_driver*>(gic);
+
+    u64 propbaser = mmu::virt_to_phys(_prop_table) |
+        (GITS_CACHE_RaWaWb << 7) | (GITS_SHARE_IS << 10) |
+        (lpi_id_bits - 1);
+
+    /* per-cpu pending table; PTZ tells the redistributor it is zeroed */
+    void* pend = alloc_its_table(lpi_pend_table_size, its_table_align);
+    u64 pendbaser = mmu::virt_to_phys(pend) |
+        (GITS_CACHE_RaWaWb << 7) | (GITS_SHARE_IS << 10) |
+        GICR_PENDBASER_PTZ;
+
+    drv->enable_lpis(smp_idx, propbaser, pendbaser);
+}
+
+/* RDbase as encoded in bits [50:16] of MAPC and SYNC commands: either
+   the physical address of the target redistributor or its processor
+   number shifted in place, depending on GITS_TYPER.PTA */
+u64 gic_v3_its::rdbase(int smp_idx)
+{
+    auto drv = static_cast<gic_v3_driver*>(gic);
+    if (_pta) {
+        return drv->gicr_phys(smp_idx);
+    }
+    return ((drv->read_gicr_typer(smp_idx) >> 8) & 0xffff) << 16;
+}
+
+void gic_v3_its::queue_cmd(const its_cmd& cmd)
+{
+    constexpr unsigned nr_entries = its_cmd_queue_size / sizeof(its_cmd);
+    unsigned next = (_cmd_write + 1) % nr_entries;
+
+    /* wait for a free slot should the queue ever fill up */
+    while (read_reg64(GITS_CREADR) == next * sizeof(its_cmd))
+        ;
+
+    _cmd_queue[_cmd_write] = cmd;
+    asm volatile("dsb ishst");
+
+    _cmd_write = next;
+    write_reg64(GITS_CWRITER, _cmd_write * sizeof(its_cmd));
+}
+
+void gic_v3_its::wait_for_completion()
+{
+    while (read_reg64(GITS_CREADR) != _cmd_write * sizeof(its_cmd))
+        ;
+}
+
+u32 gic_v3_its::alloc_lpi()
+{
+    irq_save_lock_type irq_lock;
+    WITH_LOCK(irq_lock) {
+        WITH_LOCK(_cmd_lock) {
+            if (_next_lpi >= (unsigned)max_nr_lpis) {
+                return 0;
+            }
+            return GIC_LPI_BASE + _next_lpi++;
+        }
+    }
+}
+
+void gic_v3_its::map_collection(int smp_idx)
+{
+    irq_save_lock_type irq_lock;
+    WITH_LOCK(irq_lock) {
+        WITH_LOCK(_cmd_lock) {
+            its_cmd mapc = {};
+            mapc.raw[0] = ITS_CMD_MAPC;
+            mapc.raw[2] = GITS_BASER_VALID | rdbase(smp_idx) | (u64)smp_idx;
+            queue_cmd(mapc);
+
+            its_cmd sync = {};
+            sync.raw[0] = ITS_CMD_SYNC;
+            sync.raw[2] = rdbase(smp_idx);
+            queue_cmd(sync);
+
+            wait_for_completion();
+        }
+    }
+}
+
+void gic_v3_its::map_msi(u32 devid, u32 eventid, u32 lpi, int smp_idx)
+{
+    assert(devid < _max_devid);
+    assert(eventid < (1u << event_id_bits));
+    auto idx = lpi - GIC_LPI_BASE;
+    assert(idx < (unsigned)max_nr_lpis);
+
+    /* allocate the per-device Interrupt Translation Table (and take the
+       std::map insertion) outside the irq-disabled command section */
+    bool need_mapd = false;
+    auto it = _itt_phys_by_devid.find(devid);
+    if (it == _itt_phys_by_devid.end()) {
+        size_t itt_size = (1 << event_id_bits) *
+            (((read_reg64(GITS_TYPER) >> 4) & 0xf) + 1);
+        void* itt = alloc_its_table(itt_size, 256);
+        it = _itt_phys_by_devid.emplace(devid,
+                                        mmu::virt_to_phys(itt)).first;
+        need_mapd = true;
+    }
+
+    irq_save_lock_type irq_lock;
+    WITH_LOCK(irq_lock) {
+        WITH_LOCK(_cmd_lock) {
+            _lpis[idx] = {devid, eventid, smp_idx, true};
+
+            if (need_mapd) {
+                its_cmd mapd = {};
+                mapd.raw[0] = ITS_CMD_MAPD | ((u64)devid << 32);
+                mapd.raw[1] = event_id_bits - 1;
+                mapd.raw[2] = GITS_BASER_VALID | it->second;
+                queue_cmd(mapd);
+            }
+
+            its_cmd mapti = {};
+            mapti.raw[0] = ITS_CMD_MAPTI | ((u64)devid << 32);
+            mapti.raw[1] = eventid | ((u64)lpi << 32);
+            mapti.raw[2] = (u64)smp_idx;
+            queue_cmd(mapti);
+
+            /* pick up the configuration table state for the new LPI */
+            its_cmd inv = {};
+            inv.raw[0] = ITS_CMD_INV | ((u64)devid << 32);
+            inv.raw[1] = eventid;
+            queue_cmd(inv);
+
+            its_cmd sync = {};
+            sync.raw[0] = ITS_CMD_SYNC;
+            sync.raw[2] = rdbase(smp_idx);
+            queue_cmd(sync);
+
+            wait_for_completion();
+        }
+    }
+}
+
+void gic_v3_its::move_msi(u32 devid, u32 eventid, int smp_idx)
+{
+    irq_save_lock_type irq_lock;
+    WITH_LOCK(irq_lock) {
+        WITH_LOCK(_cmd_lock) {
+            for (auto& e : _lpis) {
+                if (e.mapped && e.devid == devid && e.eventid == eventid) {
+                    e.smp_idx = smp_idx;
+                    break;
+                }
+            }
+
+            its_cmd movi = {};
+            movi.raw[0] = ITS_CMD_MOVI | ((u64)devid << 32);
+            movi.raw[1] = eventid;
+            movi.raw[2] = (u64)smp_idx;
+            queue_cmd(movi);
+
+            its_cmd sync = {};
+            sync.raw[0] = ITS_CMD_SYNC;
+            sync.raw[2] = rdbase(smp_idx);
+            queue_cmd(sync);
+
+            wait_for_completion();
+        }
+    }
+}
+
+void gic_v3_its::set_lpi_enabled(u32 lpi, bool enabled)
+{
+    auto idx = lpi - GIC_LPI_BASE;
+    assert(idx < (unsigned)max_nr_lpis);
+
+    _prop_table[idx] = LPI_PROP_PRIO_DEF | (enabled ? LPI_PROP_ENABLED : 0);
+    asm volatile("dsb ishst");
+
+    /* an unmapped LPI (interrupt registered before setup_entry() ran)
+       needs no invalidation - MAPTI is followed by INV in map_msi() */
+    auto e = _lpis[idx];
+    if (!e.mapped) {
+        return;
+    }
+
+    irq_save_lock_type irq_lock;
+    WITH_LOCK(irq_lock) {
+        WITH_LOCK(_cmd_lock) {
+            its_cmd inv = {};
+            inv.raw[0] = ITS_CMD_INV | ((u64)e.devid << 32);
+            inv.raw[1] = e.eventid;
+            queue_cmd(inv);
+
+            its_cmd sync = {};
+            sync.raw[0] = ITS_CMD_SYNC;
+            sync.raw[2] = rdbase(e.smp_idx);
+            queue_cmd(sync);
+
+            wait_for_completion();
+        }
+    }
+}
+
+}
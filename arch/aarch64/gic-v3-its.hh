@@ -0,0 +1,130 @@
+/*
+ * Copyright (C) 2026 Waldemar Kozaczuk
+ *
+ * This work is open source software, licensed under the terms of the
+ * BSD license as described in the LICENSE file in the top-level directory.
+ */
+
+#ifndef GIC_V3_ITS_HH
+#define GIC_V3_ITS_HH
+
+#include "gic-v3.hh"
+
+#include <map>
+
+#define GITS_CTLR                  (0x0000)
+#define GITS_IIDR                  (0x0004)
+#define GITS_TYPER                 (0x0008)
+#define GITS_CBASER                (0x0080)
+#define GITS_CWRITER               (0x0088)
+#define GITS_CREADR                (0x0090)
+#define GITS_BASER(n)              (0x0100 + 8 * (n))
+#define GITS_TRANSLATER            (0x10040)
+
+#define GITS_CTLR_ENABLED          (1U << 0)
+#define GITS_CTLR_QUIESCENT        (1U << 31)
+
+#define GITS_TYPER_PTA             (1UL << 19)
+
+#define GITS_BASER_VALID           (1UL << 63)
+#define GITS_BASER_TYPE(v)         (((v) >> 56) & 0x7)
+#define GITS_BASER_ENTRY_SIZE(v)   ((((v) >> 48) & 0x1f) + 1)
+#define GITS_BASER_TYPE_DEVICE     1
+#define GITS_BASER_TYPE_COLLECTION 4
+
+#define GITS_CBASER_VALID          (1UL << 63)
+
+/* Normal inner-shareable, read-alloc write-alloc write-back memory -
+   the attribute encoding is shared by GITS_CBASER, GITS_BASERn,
+   GICR_PROPBASER and GICR_PENDBASER (at different shifts) */
+#define GITS_CACHE_RaWaWb          (0x5UL)
+#define GITS_SHARE_IS              (0x1UL)
+
+namespace gic {
+
+/* GICv3 Interrupt Translation Service. The ITS turns message-signaled
+   interrupts - a device write of an event id to GITS_TRANSLATER - into
+   LPIs (InterruptIDs >= GIC_LPI_BASE) delivered to a chosen
+   redistributor, which is what gives us per-queue, per-cpu interrupt
+   routing for MSI-X capable PCI devices (see arch/aarch64/msi.cc).
+
+   The ITS is programmed through a command queue in guest memory:
+   MAPD binds a device id to its Interrupt Translation Table, MAPC binds
+   a collection id to a redistributor (we keep one collection per cpu,
+   collection id == smp_idx), MAPTI routes (device id, event id) to an
+   LPI in a collection and MOVI re-routes it later for affinity
+   changes. */
+class gic_v3_its {
+public:
+    gic_v3_its(mmu::phys b) : _base(b) {}
+
+    /* called from gic_v3_driver::init_on_(primary|secondary)_cpu */
+    void init_on_primary_cpu();
+    void init_on_secondary_cpu(int smp_idx);
+
+    /* returns a free LPI InterruptID, or 0 when out of LPIs */
+    u32 alloc_lpi();
+
+    /* route (devid, eventid) to lpi, delivered to cpu smp_idx */
+    void map_msi(u32 devid, u32 eventid, u32 lpi, int smp_idx);
+    /* re-route an already mapped (devid, eventid) to cpu smp_idx */
+    void move_msi(u32 devid, u32 eventid, int smp_idx);
+
+    /* flip the enable bit of an LPI in the configuration table */
+    void set_lpi_enabled(u32 lpi, bool enabled);
+
+    /* physical address devices write their event id to */
+    u64 msi_address() { return _base + GITS_TRANSLATER; }
+
+private:
+    struct its_cmd {
+        u64 raw[4];
+    };
+
+    struct lpi_entry {
+        u32 devid;
+        u32 eventid;
+        int smp_idx;
+        bool mapped;
+    };
+
+    u32 read_reg(u32 r);
+    void write_reg(u32 r, u32 v);
+    u64 read_reg64(u32 r);
+    void write_reg64(u32 r, u64 v);
+
+    void init_cmd_queue();
+    void init_table_bases();
+    void init_lpis_on_cpu(int smp_idx);
+    void map_collection(int smp_idx);
+
+    /* RDbase value for command raw[2], encoding depends on GITS_TYPER.PTA */
+    u64 rdbase(int smp_idx);
+
+    /* queue a command; the caller must hold _cmd_lock with irqs disabled */
+    void queue_cmd(const its_cmd& cmd);
+    void wait_for_completion();
+
+    mmu::phys _base;
+    bool _pta;
+    unsigned _event_id_bits;
+
+    its_cmd* _cmd_queue = nullptr;
+    unsigned _cmd_write = 0;
+    spinlock_t _cmd_lock;
+
+    /* LPI configuration table, shared by all redistributors */
+    u8* _prop_table = nullptr;
+
+    u32 _max_devid = 0;
+    std::map<u32, u64> _itt_phys_by_devid;
+
+    lpi_entry _lpis[max_nr_lpis] = {};
+    unsigned _next_lpi = 0;
+};
+
+extern class gic_v3_its *its;
+
+}
+
+#endif
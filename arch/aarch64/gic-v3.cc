@@ -50,6 +50,7 @@
 
 #include "processor.hh"
 #include "gic-v3.hh"
+#include "gic-v3-its.hh"
 #include "arm-clock.hh"
 
 #define isb() ({ asm volatile ("isb"); })
@@ -88,6 +89,16 @@ void gic_v3_redist::write_at_offset(int smp_idx, u32 offset, u32 value)
     mmio_setl((mmioaddr_t)_base + smp_idx * GICR_STRIDE + offset, value);
 }
 
+u64 gic_v3_redist::read64_at_offset(int smp_idx, u32 offset)
+{
+    return mmio_getq((mmioaddr_t)_base + smp_idx * GICR_STRIDE + offset);
+}
+
+void gic_v3_redist::write64_at_offset(int smp_idx, u32 offset, u64 value)
+{
+    mmio_setq((mmioaddr_t)_base + smp_idx * GICR_STRIDE + offset, value);
+}
+
 void gic_v3_redist::wait_for_write_complete()
 {
     unsigned int val;
@@ -233,8 +244,54 @@ void gic_v3_driver::init_redist(int smp_idx)
     }
 }
 
+void gic_v3_driver::init_on_primary_cpu()
+{
+    init_dist();
+    init_redist(0);
+    if (its) {
+        its->init_on_primary_cpu();
+    }
+}
+
+void gic_v3_driver::init_on_secondary_cpu(int smp_idx)
+{
+    init_redist(smp_idx);
+    if (its) {
+        its->init_on_secondary_cpu(smp_idx);
+    }
+}
+
+u64 gic_v3_driver::read_gicr_typer(int smp_idx)
+{
+    return _gicr.read64_at_offset(smp_idx, GICR_TYPER);
+}
+
+mmu::phys gic_v3_driver::gicr_phys(int smp_idx)
+{
+    return _gicr.base() + smp_idx * GICR_STRIDE;
+}
+
+void gic_v3_driver::enable_lpis(int smp_idx, u64 propbaser, u64 pendbaser)
+{
+    _gicr.write64_at_offset(smp_idx, GICR_PROPBASER, propbaser);
+    _gicr.write64_at_offset(smp_idx, GICR_PENDBASER, pendbaser);
+
+    u32 ctlr = _gicr.read_at_offset(smp_idx, GICR_CTLR);
+    _gicr.write_at_offset(smp_idx, GICR_CTLR, ctlr | GICR_CTLR_ENABLE_LPIS);
+    isb();
+}
+
 void gic_v3_driver::mask_irq(unsigned int irq)
 {
+    //LPIs are masked through their configuration table entry, kept by
+    //the ITS
+    if (irq >= GIC_LPI_BASE) {
+        if (its) {
+            its->set_lpi_enabled(irq, false);
+        }
+        return;
+    }
+
     WITH_LOCK(gic_lock) {
         if (irq >= GIC_SPI_BASE) {
             u32 val = 1UL << (irq % GICD_I_PER_ICENABLERn);
@@ -248,6 +305,13 @@ void gic_v3_driver::mask_irq(unsigned int irq)
 
 void gic_v3_driver::unmask_irq(unsigned int irq)
 {
+    if (irq >= GIC_LPI_BASE) {
+        if (its) {
+            its->set_lpi_enabled(irq, true);
+        }
+        return;
+    }
+
     WITH_LOCK(gic_lock) {
         if (irq >= GIC_SPI_BASE) {
             u32 val = 1UL << (irq % GICD_I_PER_ISENABLERn);
@@ -343,6 +407,11 @@ void gic_v3_driver::end_irq(unsigned int irq)
     WRITE_SYS_REG32(ICC_EOIR1_EL1, irq);
     isb();
 
+    /* LPIs have no active state, so deactivation does not apply */
+    if ((irq & 0xffffff) >= GIC_LPI_BASE) {
+        return;
+    }
+
     /* Deactivate */
     WRITE_SYS_REG32(ICC_DIR_EL1, irq);
     isb();
@@ -100,6 +100,9 @@
 #define GICR_WAKER_ProcessorSleep  (1U << 1)
 #define GICR_WAKER_ChildrenAsleep  (1U << 2)
 
+#define GICR_CTLR_ENABLE_LPIS      (1U << 0)
+#define GICR_PENDBASER_PTZ         (1UL << 62)
+
 #define GICR_IPRIORITYR4(n)        (GICR_SGI_BASE + 0x0400 + 4 * ((n) >> 2))
 
 /* GICR for SGI's & PPI's */
@@ -160,6 +163,12 @@ public:
     u32 read_at_offset(int smp_idx, u32 offset);
     void write_at_offset(int smp_idx, u32 offset, u32 value);
 
+    /* 64-bit registers: GICR_TYPER, GICR_PROPBASER, GICR_PENDBASER */
+    u64 read64_at_offset(int smp_idx, u32 offset);
+    void write64_at_offset(int smp_idx, u32 offset, u64 value);
+
+    mmu::phys base() { return _base; }
+
     void wait_for_write_complete();
 private:
     mmu::phys _base;
@@ -171,13 +180,8 @@ class gic_v3_driver : public gic_driver {
 public:
     gic_v3_driver(mmu::phys d, mmu::phys r) : _gicd(d), _gicr(r) {}
 
-    virtual void init_on_primary_cpu()
-    {
-        init_dist();
-        init_redist(0);
-    }
-
-    virtual void init_on_secondary_cpu(int smp_idx) { init_redist(smp_idx); }
+    virtual void init_on_primary_cpu();
+    virtual void init_on_secondary_cpu(int smp_idx);
 
     virtual void mask_irq(unsigned int id);
     virtual void unmask_irq(unsigned int id);
@@ -188,6 +192,12 @@ public:
 
     virtual unsigned int ack_irq();
     virtual void end_irq(unsigned int iar);
+
+    /* used by the ITS (gic-v3-its.cc) to program LPI support and to
+       encode redistributors as command RDbase targets */
+    u64 read_gicr_typer(int smp_idx);
+    mmu::phys gicr_phys(int smp_idx);
+    void enable_lpis(int smp_idx, u64 propbaser, u64 pendbaser);
 private:
     void init_dist();
     void init_redist(int smp_idx);
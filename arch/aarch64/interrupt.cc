@@ -66,3 +66,15 @@ spi_interrupt::spi_interrupt(gic::irq_type t, unsigned id, std::function<bool ()
 spi_interrupt::~spi_interrupt() {
     idt.unregister_interrupt(this);
 }
+
+/* Locality-specific Peripheral Interrupts */
+
+lpi_interrupt::lpi_interrupt(unsigned id, std::function<void ()> h)
+    : interrupt(id, h)
+{
+    idt.register_interrupt(this);
+}
+
+lpi_interrupt::~lpi_interrupt() {
+    idt.unregister_interrupt(this);
+}
@@ -122,6 +122,41 @@ void flush_tlb_local() {
     asm volatile("dsb sy; tlbi vmalle1; dsb sy; isb;");
 }
 
+// tlbi vaae1is broadcasts a single-page invalidation to every cpu in the
+// inner shareable domain, so unlike x64 a range flush needs no IPIs here -
+// just a bounded loop of per-page invalidations.
+static constexpr size_t max_flush_pages = 32;
+
+void flush_tlb_ranges(const tlb_range* ranges, unsigned count)
+{
+    size_t pages = 0;
+    for (unsigned i = 0; i < count; i++) {
+        pages += align_up(ranges[i].size, page_size) / page_size;
+    }
+    if (pages > max_flush_pages) {
+        flush_tlb_all();
+        return;
+    }
+
+    asm volatile("dsb ishst");
+    for (unsigned i = 0; i < count; i++) {
+        auto start = align_down(reinterpret_cast<uintptr_t>(ranges[i].addr),
+                                page_size);
+        auto end = align_up(reinterpret_cast<uintptr_t>(ranges[i].addr) +
+                            ranges[i].size, page_size);
+        for (auto addr = start; addr != end; addr += page_size) {
+            asm volatile("tlbi vaae1is, %0" : : "r"(addr >> page_size_shift));
+        }
+    }
+    asm volatile("dsb ish; isb");
+}
+
+void flush_tlb_range(void* addr, size_t size)
+{
+    tlb_range range{addr, size};
+    flush_tlb_ranges(&range, 1);
+}
+
 static pt_element<4> page_table_root[2] __attribute__((init_priority((int)init_prio::pt_root)));
 u64 mem_addr;
 
@@ -1,46 +1,328 @@
 /*
  * Copyright (C) 2015 Huawei Technologies Duesseldorf GmbH
+ * Copyright (C) 2026 Waldemar Kozaczuk
  *
  * This work is open source software, licensed under the terms of the
  * BSD license as described in the LICENSE file in the top-level directory.
  */
 
-/* skeleton of MSI, not functional. */
+/* MSI/MSI-X support backed by the GICv3 ITS (see gic-v3-its.cc): each
+ * vector is an LPI, the message written to the device targets
+ * GITS_TRANSLATER with the entry id as the payload, and affinity
+ * changes are MOVI commands re-routing the LPI to another cpu's
+ * redistributor. Without an ITS (GICv2, or no ITS node in the device
+ * tree) request_vectors() hands out nothing and callers fall back to
+ * legacy pin-based interrupts. */
 
 #include <osv/msi.hh>
+#include <osv/trace.hh>
+#include <osv/sched.hh>
+#include <osv/mutex.h>
+#include <osv/interrupt.hh>
 
-msix_vector::msix_vector(pci::function *dev) {}
-msix_vector::~msix_vector() {}
-pci::function *msix_vector::get_pci_function(void) { return nullptr; }
-unsigned msix_vector::get_vector(void) { return 0; }
-void msix_vector::msix_unmask_entries(void) {}
-void msix_vector::msix_mask_entries(void) {}
-void msix_vector::add_entryid(unsigned entry_id) {}
-void msix_vector::interrupt(void) {}
-void msix_vector::set_handler(std::function<void ()> handler) {}
-void msix_vector::set_affinity(unsigned apic_id) {}
+#include "gic-v3-its.hh"
 
-interrupt_manager::interrupt_manager(pci::function *dev) {}
-interrupt_manager::~interrupt_manager() {}
+#include <map>
+#include <memory>
 
-bool interrupt_manager::easy_register(std::initializer_list<msix_binding> b)
+TRACEPOINT(trace_msix_interrupt, "vector=0x%02x", unsigned);
+TRACEPOINT(trace_msix_migrate, "vector=0x%02x cpu=%d", unsigned, unsigned);
+
+using namespace pci;
+
+/* device id the ITS sees on the PCIe bus: the requester id */
+static u32 its_devid(pci::function* dev)
+{
+    u8 bus, device, func;
+    dev->get_bdf(bus, device, func);
+    return ((u32)bus << 8) | ((u32)device << 3) | func;
+}
+
+/* the idt registration objects for each vector's LPI; msix_vector
+ * itself is shared with x64 and has no room for them */
+static mutex lpi_irqs_lock;
+static std::map<msix_vector*, std::unique_ptr<lpi_interrupt>> lpi_irqs;
+
+msix_vector::msix_vector(pci::function* dev)
+    : _dev(dev)
+{
+    _vector = gic::its ? gic::its->alloc_lpi() : 0;
+    if (_vector) {
+        WITH_LOCK(lpi_irqs_lock) {
+            lpi_irqs.emplace(this, std::unique_ptr<lpi_interrupt>(
+                new lpi_interrupt(_vector, [this] { interrupt(); })));
+        }
+    }
+}
+
+msix_vector::~msix_vector()
+{
+    WITH_LOCK(lpi_irqs_lock) {
+        lpi_irqs.erase(this);
+    }
+}
+
+pci::function* msix_vector::get_pci_function(void)
+{
+    return (_dev);
+}
+
+unsigned msix_vector::get_vector(void)
+{
+    return (_vector);
+}
+
+void msix_vector::msix_unmask_entries(void)
+{
+    for (auto entry_id : _entryids) {
+        if (_dev->is_msix()) {
+            _dev->msix_unmask_entry(entry_id);
+        } else {
+            _dev->msi_unmask_entry(entry_id);
+        }
+    }
+}
+
+void msix_vector::msix_mask_entries(void)
+{
+    for (auto entry_id : _entryids) {
+        if (_dev->is_msix()) {
+            _dev->msix_mask_entry(entry_id);
+        } else {
+            _dev->msi_mask_entry(entry_id);
+        }
+    }
+}
+
+void msix_vector::set_handler(std::function<void ()> handler)
+{
+    _handler = handler;
+}
+
+void msix_vector::add_entryid(unsigned entry_id)
+{
+    _entryids.push_back(entry_id);
+}
+
+void msix_vector::interrupt(void)
 {
-    return false;
+    trace_msix_interrupt(_vector);
+    _handler();
 }
-void interrupt_manager::easy_unregister() {}
 
-std::vector<msix_vector *> interrupt_manager::request_vectors(unsigned n) {
-    return _easy_vectors;
+/* unlike on x64 the message written to the device never changes - the
+ * routing lives in the ITS, so re-route the LPIs there instead */
+void msix_vector::set_affinity(unsigned cpu_id)
+{
+    if (!gic::its) {
+        return;
+    }
+    auto devid = its_devid(_dev);
+    for (auto entry_id : _entryids) {
+        gic::its->move_msi(devid, entry_id, cpu_id);
+    }
 }
-void interrupt_manager::free_vectors(const std::vector<msix_vector *> &v) {}
-bool interrupt_manager::assign_isr(msix_vector *, std::function<void ()> h)
+
+interrupt_manager::interrupt_manager(pci::function* dev)
+    : _dev(dev)
 {
-    return false;
 }
-bool interrupt_manager::setup_entry(unsigned entry_id, msix_vector *vector)
+
+interrupt_manager::~interrupt_manager()
 {
-    return false;
+
+}
+
+/**
+ * Changes the affinity of the MSI-X vector to the same CPU where its service
+ * routine thread is bound and then wakes that thread.
+ *
+ * @param current The CPU to which the MSI-X vector is currently bound
+ * @param v MSI-X vector handle
+ * @param t interrupt service routine thread
+ */
+static inline void set_affinity_and_wake(
+    sched::cpu*& current, msix_vector* v, sched::thread* t)
+{
+    auto cpu = t->get_cpu();
+
+    if (cpu != current) {
+
+        v->msix_mask_entries();
+
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+
+        current = cpu;
+        trace_msix_migrate(v->get_vector(), cpu->id);
+        v->set_affinity(cpu->id);
+
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+
+        v->msix_unmask_entries();
+    }
+
+    t->wake_with_irq_disabled();
 }
-bool interrupt_manager::unmask_interrupts(const std::vector<msix_vector *> &v) {
-    return false;
+
+bool interrupt_manager::easy_register(std::initializer_list<msix_binding> bindings)
+{
+    return easy_register(std::vector<msix_binding>(bindings));
+}
+
+bool interrupt_manager::easy_register(const std::vector<msix_binding>& bindings)
+{
+    unsigned n = bindings.size();
+
+    std::vector<msix_vector*> assigned = request_vectors(n);
+
+    if (assigned.size() != n) {
+        free_vectors(assigned);
+        return (false);
+    }
+
+    // Enable the device msix capability,
+    // masks all interrupts...
+
+    if (_dev->is_msix()) {
+        _dev->msix_enable();
+    } else {
+        _dev->msi_enable();
+    }
+
+    int idx=0;
+
+    for (auto binding : bindings) {
+        msix_vector* vec = assigned[idx++];
+        auto isr = binding.isr;
+        auto t = binding.t;
+
+        bool assign_ok;
+
+        if (t) {
+            sched::cpu* current = nullptr;
+            if (binding.cpu) {
+                // Bind the bottom-half thread and the vector to the
+                // requested cpu as a unit. set_affinity_and_wake() still
+                // follows the thread should it ever be re-pinned.
+                sched::thread::pin(t, binding.cpu);
+                current = binding.cpu;
+            }
+            assign_ok =
+                assign_isr(vec,
+                    [=]() mutable {
+                                    if (isr)
+                                        isr();
+                                    set_affinity_and_wake(current, vec, t);
+                                  });
+        } else {
+            assign_ok = assign_isr(vec, [=]() { if (isr) isr(); });
+        }
+
+        if (!assign_ok) {
+            free_vectors(assigned);
+            return false;
+        }
+        bool setup_ok = setup_entry(binding.entry, vec);
+        if (!setup_ok) {
+            free_vectors(assigned);
+            return false;
+        }
+        if (binding.cpu && t) {
+            // The entries are still masked here, so the route may be
+            // moved to the requested destination directly.
+            vec->set_affinity(binding.cpu->id);
+        }
+    }
+
+    // Save reference for assigned vectors
+    _easy_vectors = assigned;
+    unmask_interrupts(assigned);
+
+    return (true);
+}
+
+void interrupt_manager::easy_unregister()
+{
+    free_vectors(_easy_vectors);
+    _easy_vectors.clear();
+}
+
+std::vector<msix_vector*> interrupt_manager::request_vectors(unsigned num_vectors)
+{
+    std::vector<msix_vector*> results;
+    unsigned num_entries;
+
+    if (!gic::its) {
+        return results;
+    }
+
+    if (_dev->is_msix()) {
+        num_entries = _dev->msix_get_num_entries();
+    } else {
+        num_entries = _dev->msi_get_num_entries();
+    }
+
+    auto num = std::min(num_vectors, num_entries);
+
+    for (unsigned i = 0; i < num; ++i) {
+        auto vec = new msix_vector(_dev);
+        if (!vec->get_vector()) {
+            // out of LPIs
+            delete vec;
+            break;
+        }
+        results.push_back(vec);
+    }
+
+    return (results);
+}
+
+bool interrupt_manager::assign_isr(msix_vector* vector, std::function<void ()> handler)
+{
+    vector->set_handler(handler);
+
+    return (true);
+}
+
+bool interrupt_manager::setup_entry(unsigned entry_id, msix_vector* msix)
+{
+    if (!gic::its) {
+        return (false);
+    }
+
+    // Route (devid, entry_id) to this vector's LPI, delivered to the
+    // boot cpu until set_affinity() moves it
+    gic::its->map_msi(its_devid(_dev), entry_id, msix->get_vector(), 0);
+
+    u64 addr = gic::its->msi_address();
+    u32 data = entry_id;
+
+    if (_dev->is_msix()) {
+        if (!_dev->msix_write_entry(entry_id, addr, data)) {
+            return false;
+        }
+    } else {
+        if (!_dev->msi_write_entry(entry_id, addr, data)) {
+            return false;
+        }
+    }
+
+    msix->add_entryid(entry_id);
+    return (true);
+}
+
+void interrupt_manager::free_vectors(const std::vector<msix_vector*>& vectors)
+{
+    for (auto msix : vectors) {
+        delete msix;
+    }
+}
+
+bool interrupt_manager::unmask_interrupts(const std::vector<msix_vector*>& vectors)
+{
+    for (auto msix : vectors) {
+        msix->msix_unmask_entries();
+    }
+
+    return (true);
 }
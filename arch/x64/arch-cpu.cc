@@ -63,6 +63,19 @@ void fpu_state_save_xsave(processor::fpu_state *s) {
     processor::xsave(s, -1);
 }
 
+extern "C"
+void fpu_state_save_xsavec(processor::fpu_state *s) {
+    // The init optimization makes the save cheap for threads which never
+    // touched SIMD state (the interrupted netisr or percpu-worker threads,
+    // for example): components still in their init configuration are not
+    // written out, only marked absent in the header, and the matching
+    // xrstor re-inits them without reading the buffer. We deliberately use
+    // xsavec and not xsaveopt: the modified optimization of the latter is
+    // unsafe for save areas living on the stack like ours, which may be
+    // reused at the same linear address with different contents.
+    processor::xsavec(s, -1);
+}
+
 extern "C"
 void fpu_state_save_fxsave(processor::fpu_state *s) {
     processor::fxsave(s);
@@ -89,6 +102,9 @@ void (*resolve_fpu_state_init())(processor::fpu_state *s) {
 extern "C"
 void (*resolve_fpu_state_save())(processor::fpu_state *s) {
     if (processor::features().xsave) {
+        if (processor::features().xsavec) {
+            return fpu_state_save_xsavec;
+        }
         return fpu_state_save_xsave;
     } else {
         return fpu_state_save_fxsave;
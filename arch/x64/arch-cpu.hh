@@ -62,6 +62,7 @@ struct arch_cpu {
     // statically linked executables
     u64 _current_thread_kernel_tcb;
     void init_on_cpu();
+    void init_cpu_id(unsigned id);
     void set_ist_entry(unsigned ist, char* base, size_t size);
     char* get_ist_entry(unsigned ist);
     void set_exception_stack(char* base, size_t size = 0);
@@ -200,6 +201,16 @@ inline void arch_cpu::init_on_cpu()
     processor::wrmsr(msr::IA32_GS_BASE, reinterpret_cast<u64>(&_current_syscall_stack_descriptor.stack_top));
 }
 
+inline void arch_cpu::init_cpu_id(unsigned id)
+{
+    // Load the cpu id into IA32_TSC_AUX so rdtscp returns it - this is
+    // what lets __vdso_getcpu() (and Linux-style rdtscp users) learn the
+    // current cpu in a single instruction, with no kernel call.
+    if (processor::features().rdtscp) {
+        processor::wrmsr(msr::IA32_TSC_AUX, id);
+    }
+}
+
 struct exception_guard {
     exception_guard();
     ~exception_guard();
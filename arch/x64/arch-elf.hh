@@ -39,6 +39,9 @@ enum {
 #define ARCH_JUMP_SLOT R_X86_64_JUMP_SLOT
 #define ARCH_TLSDESC R_X86_64_TLSDESC
 #define ARCH_IRELATIVE R_X86_64_IRELATIVE
+#define ARCH_RELATIVE R_X86_64_RELATIVE
+#define ARCH_TPOFF R_X86_64_TPOFF64
+#define ARCH_DTPMOD R_X86_64_DTPMOD64
 
 #define ELF_KERNEL_MACHINE_TYPE 62
 
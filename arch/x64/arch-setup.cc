@@ -208,6 +208,17 @@ void arch_setup_free_memory()
         if (intersects(ent, initial_map)) {
             ent = truncate_below(ent, initial_map);
         }
+        // Online eagerly only the first few GB - enough to boot with. The
+        // rest gets queued and onlined by per-cpu worker threads after
+        // smp_launch() (see memory::online_deferred_memory()), so a
+        // big-memory guest does not stall before main() mapping memory it
+        // will touch lazily.
+        static size_t onlined_bytes = initial_map;
+        if (onlined_bytes >= memory::deferred_online_threshold &&
+            memory::defer_initial_memory_range(ent.addr, ent.size)) {
+            return;
+        }
+        onlined_bytes += ent.size;
         for (auto&& area : mmu::identity_mapped_areas) {
             auto base = reinterpret_cast<void*>(get_mem_area_base(area));
             mmu::linear_map(base + ent.addr, ent.addr, ent.size,
@@ -297,6 +308,9 @@ void arch_init_premain()
 #if CONF_drivers_virtio_fs
 #include "drivers/virtio-fs.hh"
 #endif
+#if CONF_drivers_virtio_balloon
+#include "drivers/virtio-balloon.hh"
+#endif
 #if CONF_drivers_xen
 #include "drivers/xenplatform-pci.hh"
 #endif
@@ -318,6 +332,9 @@ void arch_init_premain()
 #if CONF_drivers_nvme
 #include "drivers/nvme.hh"
 #endif
+#if CONF_drivers_ivshmem
+#include "drivers/ivshmem.hh"
+#endif
 
 extern bool opt_pci_disabled;
 void arch_init_drivers()
@@ -358,6 +375,9 @@ void arch_init_drivers()
 #if CONF_drivers_virtio_fs
     drvman->register_driver(virtio::fs::probe);
 #endif
+#if CONF_drivers_virtio_balloon
+    drvman->register_driver(virtio::balloon::probe);
+#endif
 #if CONF_drivers_xen
     drvman->register_driver(xenfront::xenplatform_pci::probe);
 #endif
@@ -378,6 +398,9 @@ void arch_init_drivers()
 #endif
 #if CONF_drivers_nvme
     drvman->register_driver(nvme::driver::probe);
+#endif
+#if CONF_drivers_ivshmem
+    drvman->register_driver(ivshmem::driver::probe);
 #endif
     boot_time.event("drivers probe");
     drvman->load_all();
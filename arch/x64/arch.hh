@@ -10,6 +10,7 @@
 
 #include "processor.hh"
 #include "msr.hh"
+#include "cpuid.hh"
 
 // namespace arch - architecture independent interface for architecture
 //                  dependent operations (e.g. irq_disable vs. cli)
@@ -61,6 +62,30 @@ inline void halt_no_interrupts()
     processor::cli_hlt();
 }
 
+// monitor/mwait based idling: on hypervisors which pass MONITOR/MWAIT
+// through to the guest (e.g. KVM with cpu-pm=on) an mwait-parked vcpu
+// stays in guest mode, so waking it - whether by a store to the monitored
+// line or by interrupt injection - skips the exit/reentry round trip that
+// hlt costs. We require the "interrupt break event" extension so the wait
+// can be entered with interrupts disabled, like sti;hlt.
+inline bool monitor_wait_supported()
+{
+    return processor::features().monitor &&
+           processor::features().mwait_interrupt_break;
+}
+
+inline void monitor(const void* addr)
+{
+    processor::monitor(addr, 0, 0);
+}
+
+inline void monitor_wait()
+{
+    // Extension bit 0: interrupts are break events even with rflags.IF
+    // clear (they stay pending); hint 0 requests C1.
+    processor::mwait(1, 0);
+}
+
 class irq_flag {
 public:
     // need to clear the red zone when playing with the stack. also, can't
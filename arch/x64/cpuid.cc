@@ -50,6 +50,8 @@ typedef features_type f;
 
 cpuid_bit cpuid_bits[] = {
     { 1, 'c', 0, &f::sse3, 0, nullptr, "sse3" },
+    { 1, 'c', 3, &f::monitor, 0, nullptr, "monitor" },
+    { 5, 'c', 1, &f::mwait_interrupt_break, 0, nullptr, "mwait_int_break" },
     { 1, 'c', 9, &f::ssse3, 0, nullptr, "ssse3" },
     { 1, 'c', 13, &f::cmpxchg16b, 0, nullptr, "cmpxchg16b" },
     { 1, 'c', 19, &f::sse4_1, 0, nullptr, "sse4.1" },
@@ -58,12 +60,17 @@ cpuid_bit cpuid_bits[] = {
     { 1, 'c', 24, &f::tsc_deadline, 0, nullptr, "tsc_deadline" },
     { 1, 'c', 26, &f::xsave, 0, nullptr, "xsave" },
     { 1, 'c', 27, &f::osxsave, 0, nullptr, "osxsave" },
+    { 0xd, 'a', 1, &f::xsavec, 1, nullptr, "xsavec" },
     { 1, 'c', 28, &f::avx, 0, nullptr, "avx" },
+    { 7, 'b', 5, &f::avx2, 0, nullptr, "avx2" },
+    { 1, 'c', 25, &f::aes, 0, nullptr, "aes" },
+    { 1, 'c', 1, &f::pclmulqdq, 0, nullptr, "pclmulqdq" },
     { 1, 'c', 30, &f::rdrand, 0, nullptr, "rdrand" },
     { 1, 'd', 19, &f::clflush, 0, nullptr, "clflush" },
     { 7, 'b', 0, &f::fsgsbase, 0, nullptr, "fgsbase" },
     { 7, 'b', 9, &f::repmovsb, 0, nullptr, "repmovsb" },
     { 0x80000001, 'd', 26, &f::gbpage, 0, nullptr, "gbpage" },
+    { 0x80000001, 'd', 27, &f::rdtscp, 0, nullptr, "rdtscp" },
     { 0x80000007, 'd', 8, &f::invariant_tsc, 0, nullptr, "invariant_tsc"},
     { 0x40000001, 'a', 0, &f::kvm_clocksource, 0, &kvm_signature, "kvmclock" },
     { 0x40000001, 'a', 3, &f::kvm_clocksource2, 0, &kvm_signature, "kvmclock2" },
@@ -15,6 +15,8 @@ namespace processor {
 struct features_type {
     features_type();
     bool sse3;
+    bool monitor;
+    bool mwait_interrupt_break;
     bool ssse3;
     bool cmpxchg16b;
     bool sse4_1;
@@ -22,13 +24,18 @@ struct features_type {
     bool x2apic;
     bool tsc_deadline;
     bool xsave;
+    bool xsavec;
     bool osxsave;
     bool avx;
+    bool avx2;
+    bool aes;
+    bool pclmulqdq;
     bool rdrand;
     bool clflush;
     bool fsgsbase;
     bool repmovsb;
     bool gbpage;
+    bool rdtscp;
     bool invariant_tsc;
     bool kvm_clocksource;
     bool kvm_clocksource2;
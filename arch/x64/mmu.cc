@@ -62,25 +62,52 @@ mutex tlb_flush_mutex;
 sched::thread_handle tlb_flush_waiter;
 std::atomic<int> tlb_flush_pendingconfirms;
 
+// The pending shootdown descriptor, written under tlb_flush_mutex before
+// the IPIs go out. A zero range count requests a full flush; otherwise the
+// receiving cpus INVLPG just the listed pages, keeping the rest of their
+// TLB (and their unrelated huge mappings) intact.
+static constexpr unsigned max_flush_ranges = 20;
+// Past this many pages a full flush is cheaper than an INVLPG loop (Linux
+// uses a similar ceiling of 33).
+static constexpr size_t max_flush_pages = 32;
+static tlb_range tlb_flush_ranges_pending[max_flush_ranges];
+static std::atomic<unsigned> tlb_flush_nranges;
+
+static void flush_tlb_ranges_local(const tlb_range* ranges, unsigned count)
+{
+    for (unsigned i = 0; i < count; i++) {
+        auto start = align_down(reinterpret_cast<uintptr_t>(ranges[i].addr),
+                                page_size);
+        auto end = align_up(reinterpret_cast<uintptr_t>(ranges[i].addr) +
+                            ranges[i].size, page_size);
+        for (auto addr = start; addr != end; addr += page_size) {
+            processor::invlpg(reinterpret_cast<void*>(addr));
+        }
+    }
+}
+
 inter_processor_interrupt tlb_flush_ipi{IPI_TLB_FLUSH, [] {
-        mmu::flush_tlb_local();
+        auto nranges = tlb_flush_nranges.load(std::memory_order_acquire);
+        if (nranges) {
+            flush_tlb_ranges_local(tlb_flush_ranges_pending, nranges);
+        } else {
+            mmu::flush_tlb_local();
+        }
         if (tlb_flush_pendingconfirms.fetch_add(-1) == 1) {
             tlb_flush_waiter.wake_from_kernel_or_with_irq_disabled();
         }
 }};
 
-void flush_tlb_all()
+// Send one IPI round for the pending shootdown descriptor and wait until
+// every targeted cpu confirmed. Cpus which are not currently running an
+// application thread are skipped and flush lazily before returning to
+// application code (see sched::cpu::lazy_flush_tlb) - a full flush there
+// covers any pending range list. Called with tlb_flush_mutex and the
+// migration lock held.
+static void tlb_flush_send_ipis_and_wait()
 {
     static std::vector<sched::cpu*> ipis(sched::max_cpus);
 
-    if (sched::cpus.size() <= 1) {
-        mmu::flush_tlb_local();
-        return;
-    }
-
-    SCOPE_LOCK(migration_lock);
-    mmu::flush_tlb_local();
-    std::lock_guard<mutex> guard(tlb_flush_mutex);
     tlb_flush_waiter.reset(*sched::thread::current());
     int count;
     if (sched::thread::current()->is_app()) {
@@ -118,6 +145,50 @@ void flush_tlb_all()
     tlb_flush_waiter.clear();
 }
 
+void flush_tlb_all()
+{
+    if (sched::cpus.size() <= 1) {
+        mmu::flush_tlb_local();
+        return;
+    }
+
+    SCOPE_LOCK(migration_lock);
+    mmu::flush_tlb_local();
+    std::lock_guard<mutex> guard(tlb_flush_mutex);
+    tlb_flush_nranges.store(0, std::memory_order_release);
+    tlb_flush_send_ipis_and_wait();
+}
+
+void flush_tlb_ranges(const tlb_range* ranges, unsigned count)
+{
+    size_t pages = 0;
+    for (unsigned i = 0; i < count; i++) {
+        pages += align_up(ranges[i].size, page_size) / page_size;
+    }
+    if (count > max_flush_ranges || pages > max_flush_pages) {
+        flush_tlb_all();
+        return;
+    }
+
+    if (sched::cpus.size() <= 1) {
+        flush_tlb_ranges_local(ranges, count);
+        return;
+    }
+
+    SCOPE_LOCK(migration_lock);
+    flush_tlb_ranges_local(ranges, count);
+    std::lock_guard<mutex> guard(tlb_flush_mutex);
+    std::copy(ranges, ranges + count, tlb_flush_ranges_pending);
+    tlb_flush_nranges.store(count, std::memory_order_release);
+    tlb_flush_send_ipis_and_wait();
+}
+
+void flush_tlb_range(void* addr, size_t size)
+{
+    tlb_range range{addr, size};
+    flush_tlb_ranges(&range, 1);
+}
+
 static pt_element<4> page_table_root __attribute__((init_priority((int)init_prio::pt_root)));
 
 pt_element<4> *get_root_pt(uintptr_t virt __attribute__((unused))) {
@@ -131,6 +131,11 @@ static inline void set_affinity_and_wake(
 }
 
 bool interrupt_manager::easy_register(std::initializer_list<msix_binding> bindings)
+{
+    return easy_register(std::vector<msix_binding>(bindings));
+}
+
+bool interrupt_manager::easy_register(const std::vector<msix_binding>& bindings)
 {
     unsigned n = bindings.size();
 
@@ -161,6 +166,13 @@ bool interrupt_manager::easy_register(std::initializer_list<msix_binding> bindin
 
         if (t) {
             sched::cpu* current = nullptr;
+            if (binding.cpu) {
+                // Bind the bottom-half thread and the vector to the
+                // requested cpu as a unit. set_affinity_and_wake() still
+                // follows the thread should it ever be re-pinned.
+                sched::thread::pin(t, binding.cpu);
+                current = binding.cpu;
+            }
             assign_ok =
                 assign_isr(vec,
                     [=]() mutable {
@@ -181,6 +193,11 @@ bool interrupt_manager::easy_register(std::initializer_list<msix_binding> bindin
             free_vectors(assigned);
             return false;
         }
+        if (binding.cpu && t) {
+            // The entries are still masked here, so the table may be
+            // rewritten with the requested destination directly.
+            vec->set_affinity(binding.cpu->arch.apic_id);
+        }
     }
 
     // Save reference for assigned vectors
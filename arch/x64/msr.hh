@@ -57,12 +57,21 @@ enum class msr : uint32_t {
     X2APIC_SELF_IPI = 0x83f,
 
     IA32_APIC_BASE = 0x0000001b,
+    IA32_PMC0 = 0x000000c1,
+    IA32_PERFEVTSEL0 = 0x00000186,
+    IA32_FIXED_CTR0 = 0x00000309,
+    IA32_FIXED_CTR1 = 0x0000030a,
+    IA32_FIXED_CTR2 = 0x0000030b,
+    IA32_FIXED_CTR_CTRL = 0x0000038d,
+    IA32_PERF_GLOBAL_STATUS = 0x0000038e,
+    IA32_PERF_GLOBAL_CTRL = 0x0000038f,
     IA32_EFER = 0xc0000080,
     IA32_STAR = 0xc0000081,
     IA32_LSTAR = 0xc0000082,
     IA32_FMASK = 0xc0000084,
     IA32_FS_BASE = 0xc0000100,
     IA32_GS_BASE = 0xc0000101,
+    IA32_TSC_AUX = 0xc0000103,
 
     KVM_WALL_CLOCK = 0x11,
     KVM_SYSTEM_TIME = 0x12,
@@ -78,9 +87,9 @@ inline void wrmsr(msr index, u64 value)
     wrmsr(static_cast<u32>(index), value);
 }
 
-inline void wrmsr_safe(msr index, u64 value)
+inline bool wrmsr_safe(msr index, u64 value)
 {
-    wrmsr_safe(static_cast<u32>(index), value);
+    return wrmsr_safe(static_cast<u32>(index), value);
 }
 
 inline u64 rdmsr(msr index)
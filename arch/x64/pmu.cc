@@ -0,0 +1,80 @@
+/*
+ * Copyright (C) 2026 Waldemar Kozaczuk
+ *
+ * This work is open source software, licensed under the terms of the
+ * BSD license as described in the LICENSE file in the top-level directory.
+ */
+
+#include "pmu.hh"
+#include "msr.hh"
+#include "processor.hh"
+
+#include <atomic>
+
+namespace pmu {
+
+// Architectural performance monitoring, cpuid leaf 0xA
+static constexpr u32 arch_perfmon_leaf = 0xa;
+
+// IA32_FIXED_CTR_CTRL: enable ring 0 and ring 3 counting for fixed
+// counters 0 (instructions retired) and 1 (unhalted core cycles)
+static constexpr u64 fixed_ctr_ctrl = 0x33;
+
+// IA32_PERFEVTSEL0: LLC misses, architectural event 0x2e umask 0x41,
+// counted in ring 0 and ring 3, counter enabled
+static constexpr u64 evtsel_llc_misses =
+    0x2e | (0x41 << 8) | (1 << 16) | (1 << 17) | (1 << 22);
+
+// IA32_PERF_GLOBAL_CTRL: general purpose counter 0 plus fixed 0 and 1
+static constexpr u64 global_ctrl = (1ull << 0) | (3ull << 32);
+
+static std::atomic<bool> _active {false};
+
+bool supported()
+{
+    auto r = processor::cpuid(arch_perfmon_leaf);
+    auto version = r.a & 0xff;
+    auto gp_counters = (r.a >> 8) & 0xff;
+    auto fixed_counters = r.d & 0x1f;
+    // Fixed counters appeared in version 2; bit 4 of ebx set means the
+    // LLC miss event is not available
+    return version >= 2 && gp_counters >= 1 && fixed_counters >= 2 &&
+        !(r.b & (1 << 4));
+}
+
+void init_on_current()
+{
+    if (!supported()) {
+        return;
+    }
+    // wrmsr_safe: a hypervisor advertising the leaf but filtering the
+    // MSRs must not take the guest down
+    if (!processor::wrmsr_safe(msr::IA32_FIXED_CTR_CTRL, fixed_ctr_ctrl) ||
+        !processor::wrmsr_safe(msr::IA32_PERFEVTSEL0, evtsel_llc_misses) ||
+        !processor::wrmsr_safe(msr::IA32_PERF_GLOBAL_CTRL, global_ctrl)) {
+        return;
+    }
+    _active.store(true, std::memory_order_relaxed);
+}
+
+bool active()
+{
+    return _active.load(std::memory_order_relaxed);
+}
+
+u64 instructions()
+{
+    return processor::rdmsr(msr::IA32_FIXED_CTR0);
+}
+
+u64 cycles()
+{
+    return processor::rdmsr(msr::IA32_FIXED_CTR1);
+}
+
+u64 llc_misses()
+{
+    return processor::rdmsr(msr::IA32_PMC0);
+}
+
+}
@@ -0,0 +1,35 @@
+/*
+ * Copyright (C) 2026 Waldemar Kozaczuk
+ *
+ * This work is open source software, licensed under the terms of the
+ * BSD license as described in the LICENSE file in the top-level directory.
+ */
+
+#ifndef PMU_HH_
+#define PMU_HH_
+
+#include <osv/types.h>
+
+namespace pmu {
+
+// True when the (virtual) PMU advertises architectural performance
+// monitoring with at least the fixed counters we need, i.e. the guest
+// runs with vPMU enabled
+bool supported();
+
+// Program this cpu's counters - fixed counters 0 (instructions retired)
+// and 1 (core cycles), plus general purpose counter 0 counting LLC
+// misses - and enable them. Idempotent; a no-op when not supported().
+void init_on_current();
+
+// True once at least one cpu programmed its counters successfully
+bool active();
+
+// Free-running per-cpu readouts; only meaningful for the current cpu
+u64 instructions();
+u64 cycles();
+u64 llc_misses();
+
+}
+
+#endif /* PMU_HH_ */
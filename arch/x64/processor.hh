@@ -98,6 +98,10 @@ inline void write_cr3(ulong r) {
     asm volatile ("mov %0, %%cr3" : : "r"(r));
 }
 
+inline void invlpg(void* addr) {
+    asm volatile ("invlpg (%0)" : : "r"(addr) : "memory");
+}
+
 inline ulong read_cr4() {
     ulong r;
     asm volatile ("mov %%cr4, %0" : "=r"(r));
@@ -251,6 +255,21 @@ inline void sti_hlt() {
     asm volatile ("sti; hlt" : : : "memory");
 }
 
+// Arm the address monitor on the cache line containing addr. A subsequent
+// mwait returns as soon as another agent stores to that line (even if the
+// store happens between the monitor and the mwait).
+inline void monitor(const void* addr, u32 extensions, u32 hints) {
+    asm volatile ("monitor" : : "a"(addr), "c"(extensions), "d"(hints));
+}
+
+// Wait in the C-state selected by hints until the monitored line is
+// written or a break event occurs. Extension bit 0 (if enumerated by
+// cpuid leaf 5) makes interrupts break events even when rflags.IF is
+// clear; the interrupt stays pending.
+inline void mwait(u32 extensions, u32 hints) {
+    asm volatile ("mwait" : : "c"(extensions), "a"(hints) : "memory");
+}
+
 inline u8 inb(u16 port)
 {
     u8 r;
@@ -367,6 +386,12 @@ inline void xsaveopt(fpu_state* s, u64 mask)
     asm volatile("xsaveoptq %[fpu]" : [fpu]"=m"(*s) : "a"(a), "d"(d));
 }
 
+inline void xsavec(fpu_state* s, u64 mask)
+{
+    u32 a = mask, d = mask >> 32;
+    asm volatile("xsavec64 %[fpu]" : [fpu]"=m"(*s) : "a"(a), "d"(d));
+}
+
 inline void xrstor(const fpu_state* s, u64 mask)
 {
     u32 a = mask, d = mask >> 32;
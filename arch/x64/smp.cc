@@ -21,12 +21,15 @@ extern "C" {
 #endif
 #include <boost/intrusive/parent_from_member.hpp>
 #include <osv/debug.hh>
+#include <osv/mempool.hh>
+#include <osv/numa.hh>
 #include <osv/sched.hh>
 #include <osv/barrier.hh>
 #include <osv/prio.hh>
 #include "osv/percpu.hh"
 #include <osv/aligned_new.hh>
 #include <osv/export.h>
+#include <osv/vdso-data.hh>
 
 extern "C" { void smp_main(void); }
 
@@ -94,6 +97,66 @@ void parse_madt()
     }
     debugf("%u CPUs detected\n", nr_cpus);
 }
+
+// Feed the SRAT's processor and memory affinity entries to the numa
+// registry, and stamp each already-registered cpu with its node. Guests
+// without an SRAT (the common case) keep the single-node default.
+void parse_srat()
+{
+    char srat_sig[] = ACPI_SIG_SRAT;
+    ACPI_TABLE_HEADER* srat_header;
+    auto st = AcpiGetTable(srat_sig, 0, &srat_header);
+    if (ACPI_FAILURE(st)) {
+        return;
+    }
+    auto srat = get_parent_from_member(srat_header, &ACPI_TABLE_SRAT::Header);
+    void* subtable = srat + 1;
+    void* srat_end = static_cast<void*>(srat) + srat->Header.Length;
+    while (subtable < srat_end) {
+        auto s = static_cast<ACPI_SUBTABLE_HEADER*>(subtable);
+        switch (s->Type) {
+        case ACPI_SRAT_TYPE_CPU_AFFINITY: {
+            auto cpu = get_parent_from_member(s,
+                    &ACPI_SRAT_CPU_AFFINITY::Header);
+            if (cpu->Flags & ACPI_SRAT_CPU_USE_AFFINITY) {
+                u32 domain = cpu->ProximityDomainLo |
+                        (cpu->ProximityDomainHi[0] << 8) |
+                        (cpu->ProximityDomainHi[1] << 16) |
+                        (cpu->ProximityDomainHi[2] << 24);
+                numa::add_cpu(cpu->ApicId, domain);
+            }
+            break;
+        }
+        case ACPI_SRAT_TYPE_X2APIC_CPU_AFFINITY: {
+            auto cpu = get_parent_from_member(s,
+                    &ACPI_SRAT_X2APIC_CPU_AFFINITY::Header);
+            if (cpu->Flags & ACPI_SRAT_CPU_ENABLED) {
+                numa::add_cpu(cpu->ApicId, cpu->ProximityDomain);
+            }
+            break;
+        }
+        case ACPI_SRAT_TYPE_MEMORY_AFFINITY: {
+            auto mem = get_parent_from_member(s,
+                    &ACPI_SRAT_MEM_AFFINITY::Header);
+            if (mem->Flags & ACPI_SRAT_MEM_ENABLED) {
+                numa::add_memory_range(mem->BaseAddress, mem->Length,
+                        mem->ProximityDomain);
+            }
+            break;
+        }
+        default:
+            break;
+        }
+        subtable += s->Length;
+    }
+    numa::complete();
+    if (numa::nr_nodes > 1) {
+        for (auto c : sched::cpus) {
+            c->node_id = numa::cpu_node(c->arch.apic_id);
+        }
+        memory::numa_rebalance();
+    }
+}
 #endif
 
 #define MPF_IDENTIFIER (('_'<<24) | ('P'<<16) | ('M'<<8) | '_')
@@ -205,6 +268,7 @@ void smp_init()
 #if CONF_drivers_acpi
     if (acpi::is_enabled()) {
         parse_madt();
+        parse_srat();
     } else {
 #endif
         parse_mp_table();
@@ -241,6 +305,10 @@ sched::cpu* smp_initial_find_current_cpu()
     abort();
 }
 
+// Bound by the vDSO at load time (see osv/vdso-data.hh); enabled below
+// once every cpu's IA32_TSC_AUX holds its id.
+OSV_LIBC_API std::atomic<u32> __osv_vdso_getcpu_rdtscp(0);
+
 void smp_launch()
 {
     ioapic::init();
@@ -270,6 +338,13 @@ void smp_launch()
     while (smp_processors != sched::cpus.size()) {
         barrier();
     }
+
+    // By now every cpu (the BSP in main(), the APs just above) has run
+    // init_on_cpu() and, when rdtscp is available, loaded its id into
+    // IA32_TSC_AUX - let the vDSO use it.
+    if (processor::features().rdtscp) {
+        __osv_vdso_getcpu_rdtscp.store(1, std::memory_order_release);
+    }
 }
 
 void smp_main()
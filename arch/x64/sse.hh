@@ -52,4 +52,14 @@ __m128i& xmm(sse_register_file<Regs>& sse)
 
 void ssse3_unaligned_copy(void* dest, const void* src, size_t n);
 
+// defined in string-avx2.cc (the only translation unit built with -mavx2)
+void avx2_unaligned_copy(void* dest, const void* src, size_t n);
+void avx2_fill(void* dest, int c, size_t n);
+size_t strlen_avx2(const char* s);
+char* strchr_avx2(const char* s, int c);
+int strcmp_avx2(const char* s1, const char* s2);
+
+// defined in string-sse42.cc (the only translation unit built with -msse4.2)
+int strcmp_sse42(const char* s1, const char* s2);
+
 #endif /* SSE_HH_ */
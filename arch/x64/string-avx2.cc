@@ -0,0 +1,183 @@
+/*
+ * Copyright (C) 2026 Waldemar Kozaczuk
+ *
+ * This work is open source software, licensed under the terms of the
+ * BSD license as described in the LICENSE file in the top-level directory.
+ */
+
+#include "sse.hh"
+#include <x86intrin.h>
+#include <stdint.h>
+
+// AVX2 bulk copy and fill loops for the mid-size range (roughly 1KB-64KB)
+// where "rep movsb" has not yet amortized its startup cost but 16-byte SSE
+// copies leave half the load/store width on the table. This translation
+// unit is the only one compiled with -mavx2 (like string-ssse3.cc is the
+// only one compiled with -mssse3), so the ymm registers never leak into
+// code running on cpus without AVX2; the resolvers in string.cc only pick
+// these functions when cpuid reports the feature and init_on_cpu() has
+// enabled the ymm state in xcr0.
+//
+// Gcc automatically emits vzeroupper on return from a -mavx2 function, so
+// we do not pay SSE/AVX transition penalties in the (SSE-only) callers.
+
+// Forward copy of up to 32 bytes, used for the unaligned head and tail.
+// Copies byte by byte so, like do_small_memcpy(), it also works for
+// overlapping dest and src with dest < src.
+static inline void short_copy(char* dest, const char* src, size_t n)
+{
+    while (n--) {
+        *dest++ = *src++;
+    }
+}
+
+// Copy n bytes forward with 32-byte loads and stores. Requires n >= 32.
+// The destination is aligned first - misaligned stores are more expensive
+// than misaligned loads on every AVX2 part we care about.
+void avx2_unaligned_copy(void* dest, const void* src, size_t n)
+{
+    auto d = static_cast<char*>(dest);
+    auto s = static_cast<const char*>(src);
+
+    auto head = -reinterpret_cast<uintptr_t>(d) & 31;
+    if (head) {
+        short_copy(d, s, head);
+        d += head;
+        s += head;
+        n -= head;
+    }
+
+    while (n >= 128) {
+        auto r0 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(s) + 0);
+        auto r1 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(s) + 1);
+        auto r2 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(s) + 2);
+        auto r3 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(s) + 3);
+        _mm256_store_si256(reinterpret_cast<__m256i*>(d) + 0, r0);
+        _mm256_store_si256(reinterpret_cast<__m256i*>(d) + 1, r1);
+        _mm256_store_si256(reinterpret_cast<__m256i*>(d) + 2, r2);
+        _mm256_store_si256(reinterpret_cast<__m256i*>(d) + 3, r3);
+        d += 128;
+        s += 128;
+        n -= 128;
+    }
+
+    while (n >= 32) {
+        _mm256_store_si256(reinterpret_cast<__m256i*>(d),
+                _mm256_loadu_si256(reinterpret_cast<const __m256i*>(s)));
+        d += 32;
+        s += 32;
+        n -= 32;
+    }
+
+    short_copy(d, s, n);
+}
+
+// Fill n bytes with 32-byte stores. Requires n >= 64, so that after the
+// (possibly overlapping) unaligned head store at least one aligned store
+// is executed and the overlapping tail store stays inside the buffer.
+// Unlike a copy, overlapping stores of the same value are harmless, so
+// the head and tail need no byte loops.
+void avx2_fill(void* dest, int c, size_t n)
+{
+    auto v = _mm256_set1_epi8(static_cast<char>(c));
+    auto d = static_cast<char*>(dest);
+
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(d), v);
+    auto head = -reinterpret_cast<uintptr_t>(d) & 31;
+    d += head;
+    n -= head;
+
+    while (n >= 128) {
+        _mm256_store_si256(reinterpret_cast<__m256i*>(d) + 0, v);
+        _mm256_store_si256(reinterpret_cast<__m256i*>(d) + 1, v);
+        _mm256_store_si256(reinterpret_cast<__m256i*>(d) + 2, v);
+        _mm256_store_si256(reinterpret_cast<__m256i*>(d) + 3, v);
+        d += 128;
+        n -= 128;
+    }
+
+    while (n >= 32) {
+        _mm256_store_si256(reinterpret_cast<__m256i*>(d), v);
+        d += 32;
+        n -= 32;
+    }
+
+    if (n) {
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(d + n - 32), v);
+    }
+}
+
+// 32-byte versions of the str* routines dispatched from string.cc. The
+// same page-safety rules as the SSE2 baselines apply: strlen/strchr use
+// aligned loads only (an aligned 32-byte load stays within the string's
+// page) and mask off the bytes preceding the string in its first block;
+// strcmp guards its unaligned loads with a distance-to-page-end check.
+
+size_t strlen_avx2(const char* s)
+{
+    auto p = reinterpret_cast<uintptr_t>(s);
+    auto block = reinterpret_cast<const __m256i*>(p & ~31ul);
+    auto zero = _mm256_setzero_si256();
+    unsigned mask = _mm256_movemask_epi8(
+            _mm256_cmpeq_epi8(_mm256_load_si256(block), zero));
+    mask &= ~0u << (p & 31);
+    while (!mask) {
+        ++block;
+        mask = _mm256_movemask_epi8(
+                _mm256_cmpeq_epi8(_mm256_load_si256(block), zero));
+    }
+    return reinterpret_cast<const char*>(block) + __builtin_ctz(mask) - s;
+}
+
+char* strchr_avx2(const char* s, int c)
+{
+    auto p = reinterpret_cast<uintptr_t>(s);
+    auto block = reinterpret_cast<const __m256i*>(p & ~31ul);
+    auto zero = _mm256_setzero_si256();
+    auto wanted = _mm256_set1_epi8(static_cast<char>(c));
+    auto v = _mm256_load_si256(block);
+    unsigned mask = _mm256_movemask_epi8(
+            _mm256_or_si256(_mm256_cmpeq_epi8(v, zero),
+                            _mm256_cmpeq_epi8(v, wanted)));
+    mask &= ~0u << (p & 31);
+    while (!mask) {
+        v = _mm256_load_si256(++block);
+        mask = _mm256_movemask_epi8(
+                _mm256_or_si256(_mm256_cmpeq_epi8(v, zero),
+                                _mm256_cmpeq_epi8(v, wanted)));
+    }
+    auto r = reinterpret_cast<const char*>(block) + __builtin_ctz(mask);
+    return *r == static_cast<char>(c) ? const_cast<char*>(r) : nullptr;
+}
+
+int strcmp_avx2(const char* s1, const char* s2)
+{
+    while (true) {
+        if (((reinterpret_cast<uintptr_t>(s1) |
+              reinterpret_cast<uintptr_t>(s2)) & 4095) <= 4096 - 32) {
+            auto v1 = _mm256_loadu_si256(
+                    reinterpret_cast<const __m256i*>(s1));
+            auto v2 = _mm256_loadu_si256(
+                    reinterpret_cast<const __m256i*>(s2));
+            unsigned diff = ~_mm256_movemask_epi8(
+                    _mm256_cmpeq_epi8(v1, v2));
+            unsigned nul = _mm256_movemask_epi8(
+                    _mm256_cmpeq_epi8(v1, _mm256_setzero_si256()));
+            auto mask = diff | nul;
+            if (mask) {
+                auto i = __builtin_ctz(mask);
+                return static_cast<unsigned char>(s1[i]) -
+                       static_cast<unsigned char>(s2[i]);
+            }
+            s1 += 32;
+            s2 += 32;
+        } else {
+            for (unsigned i = 0; i < 32; i++, s1++, s2++) {
+                if (*s1 != *s2 || !*s1) {
+                    return static_cast<unsigned char>(*s1) -
+                           static_cast<unsigned char>(*s2);
+                }
+            }
+        }
+    }
+}
@@ -0,0 +1,57 @@
+/*
+ * Copyright (C) 2026 Waldemar Kozaczuk
+ *
+ * This work is open source software, licensed under the terms of the
+ * BSD license as described in the LICENSE file in the top-level directory.
+ */
+
+#include "sse.hh"
+#include <x86intrin.h>
+#include <stdint.h>
+
+// strcmp built on the SSE4.2 string instructions. This translation unit
+// is the only one compiled with -msse4.2 (like string-ssse3.cc and
+// string-avx2.cc for their respective extensions); the resolver in
+// string.cc only hands it out when cpuid reports the feature.
+//
+// pcmpistri compares two 16-byte blocks in one instruction and handles
+// the terminator itself: with EQUAL_EACH + NEGATIVE_POLARITY it yields
+// the index of the first position where the blocks differ - a byte past
+// either string's end counts as a mismatch against a live byte on the
+// other side - and sets ZF when the second block contains the
+// terminator. So "no mismatch, ZF set" means both strings ended, equal.
+//
+// The loads are unaligned (the two strings are independently misaligned),
+// so the same distance-to-page-end guard as strcmp_sse2 keeps them from
+// crossing into an unmapped page; the rare eligible pair sent down the
+// byte loop is only a slowdown.
+
+int strcmp_sse42(const char* s1, const char* s2)
+{
+    constexpr int mode = _SIDD_UBYTE_OPS | _SIDD_CMP_EQUAL_EACH |
+                         _SIDD_NEGATIVE_POLARITY | _SIDD_LEAST_SIGNIFICANT;
+    while (true) {
+        if (((reinterpret_cast<uintptr_t>(s1) |
+              reinterpret_cast<uintptr_t>(s2)) & 4095) <= 4096 - 16) {
+            auto v1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(s1));
+            auto v2 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(s2));
+            if (_mm_cmpistrc(v1, v2, mode)) {
+                auto i = _mm_cmpistri(v1, v2, mode);
+                return static_cast<unsigned char>(s1[i]) -
+                       static_cast<unsigned char>(s2[i]);
+            }
+            if (_mm_cmpistrz(v1, v2, mode)) {
+                return 0;
+            }
+            s1 += 16;
+            s2 += 16;
+        } else {
+            for (unsigned i = 0; i < 16; i++, s1++, s2++) {
+                if (*s1 != *s2 || !*s1) {
+                    return static_cast<unsigned char>(*s1) -
+                           static_cast<unsigned char>(*s2);
+                }
+            }
+        }
+    }
+}
@@ -310,11 +310,40 @@ void *memcpy_repmov_ssse3(void *__restrict dest, const void *__restrict src, siz
     }
 }
 
+extern "C"
+[[gnu::optimize("omit-frame-pointer")]]
+void *memcpy_repmov_avx2(void *__restrict dest, const void *__restrict src, size_t n)
+{
+    if (n < small_memcpy_lim) {
+        return small_memcpy(dest, src, n);
+    } else if (n < 1024) {
+        return sse_memcpy(dest, src, n);
+    } else if (n < 65536) {
+        avx2_unaligned_copy(dest, src, n);
+        return dest;
+    } else {
+        auto ret = dest;
+        repmovsb(dest, src, n);
+        return ret;
+    }
+}
+
+// The resolvers below only hand out the avx2 variants when init_on_cpu()
+// will also have enabled the ymm state in xcr0 - it only does that with
+// both xsave and avx present, and touching ymm registers without it traps.
+static bool avx2_usable()
+{
+    return processor::features().avx2 && processor::features().avx &&
+            processor::features().xsave;
+}
+
 extern "C"
 void *(*resolve_memcpy())(void *__restrict dest, const void *__restrict src, size_t n)
 {
     if (processor::features().repmovsb) {
-        if (processor::features().ssse3) {
+        if (avx2_usable()) {
+            return memcpy_repmov_avx2;
+        } else if (processor::features().ssse3) {
             return memcpy_repmov_ssse3;
         } else {
             return memcpy_repmov;
@@ -525,10 +554,29 @@ void *memset_repstosb(void *__restrict dest, int c, size_t n)
     return ret;
 }
 
+extern "C"
+void *memset_repstosb_avx2(void *__restrict dest, int c, size_t n)
+{
+    auto ret = dest;
+    if (n <= 64) {
+        small_memset(dest, c, n);
+    } else if (n < 4096) {
+        // Below the point where "rep stosb" amortizes its startup cost,
+        // explicit 32-byte stores win.
+        avx2_fill(dest, c, n);
+    } else {
+        asm volatile("rep stosb" : "+D"(dest), "+c"(n) : "a"(c) : "memory");
+    }
+    return ret;
+}
+
 extern "C"
 void *(*resolve_memset())(void *__restrict dest, int c, size_t n)
 {
     if (processor::features().repmovsb) {
+        if (avx2_usable()) {
+            return memset_repstosb_avx2;
+        }
         return memset_repstosb;
     }
     return memset_repstos_old;
@@ -537,4 +585,135 @@ void *(*resolve_memset())(void *__restrict dest, int c, size_t n)
 void *memset(void *__restrict dest, int c, size_t n)
     __attribute__((ifunc("resolve_memset")));
 
+// The str* family. musl's scalar strlen/strcmp/strchr are hot under VFS
+// path lookup (one component comparison per directory level) and HTTP
+// header parsing, so we dispatch them like memcpy/memset above. The
+// baseline variants below use 16-byte SSE2 loads, which every x86_64 cpu
+// has; the resolvers upgrade to the AVX2 (and, for strcmp, SSE4.2 string
+// instruction) variants from the specially-compiled translation units
+// when cpuid allows.
+//
+// strlen and strchr only use aligned loads: an aligned 16-byte load never
+// crosses into the next page, so reading up to 15 bytes past the
+// terminator is safe, and the bytes preceding the string in its first
+// block are masked off. strcmp has to load from two independently
+// misaligned strings, so it uses unaligned loads with an explicit
+// distance-to-page-end check and falls back to byte compares near a page
+// boundary.
+
+extern "C"
+size_t strlen_sse2(const char* s)
+{
+    auto p = reinterpret_cast<uintptr_t>(s);
+    auto block = reinterpret_cast<const __m128i*>(p & ~15ul);
+    auto zero = _mm_setzero_si128();
+    unsigned mask = _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_load_si128(block),
+                                                     zero));
+    mask &= ~0u << (p & 15);
+    while (!mask) {
+        ++block;
+        mask = _mm_movemask_epi8(_mm_cmpeq_epi8(_mm_load_si128(block), zero));
+    }
+    return reinterpret_cast<const char*>(block) + __builtin_ctz(mask) - s;
+}
+
+extern "C"
+char* strchr_sse2(const char* s, int c)
+{
+    auto p = reinterpret_cast<uintptr_t>(s);
+    auto block = reinterpret_cast<const __m128i*>(p & ~15ul);
+    auto zero = _mm_setzero_si128();
+    auto wanted = _mm_set1_epi8(static_cast<char>(c));
+    auto v = _mm_load_si128(block);
+    // stop at the wanted byte or at the terminator, whichever comes first
+    unsigned mask = _mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(v, zero),
+                                                   _mm_cmpeq_epi8(v, wanted)));
+    mask &= ~0u << (p & 15);
+    while (!mask) {
+        v = _mm_load_si128(++block);
+        mask = _mm_movemask_epi8(_mm_or_si128(_mm_cmpeq_epi8(v, zero),
+                                              _mm_cmpeq_epi8(v, wanted)));
+    }
+    auto r = reinterpret_cast<const char*>(block) + __builtin_ctz(mask);
+    // covers strchr(s, '\0'), which must return the terminator
+    return *r == static_cast<char>(c) ? const_cast<char*>(r) : nullptr;
+}
+
+extern "C"
+int strcmp_sse2(const char* s1, const char* s2)
+{
+    while (true) {
+        // x|y is an upper bound for both x and y, so this guarantees
+        // neither 16-byte load crosses a page end (rarely sending an
+        // eligible pair down the byte loop is only a slowdown)
+        if (((reinterpret_cast<uintptr_t>(s1) |
+              reinterpret_cast<uintptr_t>(s2)) & 4095) <= 4096 - 16) {
+            auto v1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(s1));
+            auto v2 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(s2));
+            unsigned diff = 0xffff ^ _mm_movemask_epi8(_mm_cmpeq_epi8(v1, v2));
+            unsigned nul = _mm_movemask_epi8(_mm_cmpeq_epi8(v1,
+                                                    _mm_setzero_si128()));
+            // If the terminator comes first, the strings are equal up to
+            // and including it and we return 0 below; an earlier diff bit
+            // wins otherwise.
+            auto mask = diff | nul;
+            if (mask) {
+                auto i = __builtin_ctz(mask);
+                return static_cast<unsigned char>(s1[i]) -
+                       static_cast<unsigned char>(s2[i]);
+            }
+            s1 += 16;
+            s2 += 16;
+        } else {
+            // within 16 bytes of a page end on one side - compare bytes
+            // until both pointers are past it
+            for (unsigned i = 0; i < 16; i++, s1++, s2++) {
+                if (*s1 != *s2 || !*s1) {
+                    return static_cast<unsigned char>(*s1) -
+                           static_cast<unsigned char>(*s2);
+                }
+            }
+        }
+    }
+}
+
+extern "C"
+size_t (*resolve_strlen())(const char* s)
+{
+    if (avx2_usable()) {
+        return strlen_avx2;
+    }
+    return strlen_sse2;
+}
+
+size_t strlen(const char* s)
+    __attribute__((ifunc("resolve_strlen")));
+
+extern "C"
+char* (*resolve_strchr())(const char* s, int c)
+{
+    if (avx2_usable()) {
+        return strchr_avx2;
+    }
+    return strchr_sse2;
+}
+
+char* strchr(const char* s, int c)
+    __attribute__((ifunc("resolve_strchr")));
+
+extern "C"
+int (*resolve_strcmp())(const char* s1, const char* s2)
+{
+    if (avx2_usable()) {
+        return strcmp_avx2;
+    }
+    if (processor::features().sse4_2) {
+        return strcmp_sse42;
+    }
+    return strcmp_sse2;
+}
+
+int strcmp(const char* s1, const char* s2)
+    __attribute__((ifunc("resolve_strcmp")));
+
 
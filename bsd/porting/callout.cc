@@ -132,7 +132,10 @@ static void _callout_thread(void)
         bool expired = true;
         if (cur < c->c_to_ns-1_ms) {
             sched::timer t(*sched::thread::current());
-            t.set(c->c_to_ns);
+            // Callout ticks are millisecond-coarse anyway (we already
+            // tolerate 1ms slack above), so arm on the low-resolution
+            // timer wheel and spare the clock event reprogramming.
+            t.set_lowres(c->c_to_ns);
 
             trace_callout_thread_waiting(c);
             sched::thread::wait_until(callouts::_callout_mutex, [&] {
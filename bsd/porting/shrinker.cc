@@ -8,6 +8,7 @@
 #include <osv/mempool.hh>
 #include <osv/debug.hh>
 #include <osv/export.h>
+#include <osv/sched.hh>
 #include <sys/eventhandler.h>
 #include <algorithm>
 
@@ -80,6 +81,25 @@ size_t arc_shrinker::request_memory(size_t s, bool hard)
     return ret;
 }
 
+// The shrinker above only runs when the reclaimer's own loop decides to
+// poll it, which on a small guest can be after allocations already
+// started stalling in the ZFS write path. Watching the pressure level
+// directly lets the ARC start giving memory back the moment the
+// allocator crosses its watermark: a sized chunk at PRESSURE, and the
+// aggressive arc_lowmem() path once the emergency pool is being eaten.
+static void arc_pressure_watcher()
+{
+    auto level = memory::current_pressure();
+    for (;;) {
+        level = memory::wait_pressure_change(level);
+        if (level == memory::pressure::EMERGENCY) {
+            (*arc_lowmem_fun)(nullptr, 0);
+        } else if (level == memory::pressure::PRESSURE) {
+            (*arc_sized_adjust_fun)(16 << 20);
+        }
+    }
+}
+
 void bsd_shrinker_init(void)
 {
     struct eventhandler_list *list = eventhandler_find_list("vm_lowmem");
@@ -95,6 +115,9 @@ void bsd_shrinker_init(void)
 
         if ((void *)_ee->func == (void *)arc_lowmem_fun) {
             new arc_shrinker();
+            sched::thread::make(arc_pressure_watcher,
+                sched::thread::attr().detached().name("arc_pressure"))
+                ->start();
         } else {
             new bsd_shrinker(_ee);
         }
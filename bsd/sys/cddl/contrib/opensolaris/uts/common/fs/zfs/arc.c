@@ -136,6 +136,11 @@
 #include <bsd/porting/mmu.h>
 #include <osv/export.h>
 
+#ifdef __OSV__
+extern unsigned smp_processors;	/* OSv: number of online CPUs */
+#define	mp_ncpus	smp_processors
+#endif
+
 #ifdef illumos
 #ifndef _KERNEL
 /* set with ZFS_DEBUG=watch, to enable watchpoints on frozen buffers */
@@ -609,18 +614,27 @@ struct ht_lock {
 #endif
 };
 
-#define	BUF_LOCKS 256
+/*
+ * The hash chain locks are striped; the stripe count is fixed upstream at
+ * 256, which is both too much state on a single-vCPU microVM and too few
+ * stripes on a large SMP guest. Size the array once in buf_init() from
+ * the number of CPUs instead.
+ */
+#define	BUF_LOCKS_MIN	32
+#define	BUF_LOCKS_MAX	1024
 typedef struct buf_hash_table {
 	uint64_t ht_mask;
 	arc_buf_hdr_t **ht_table;
-	struct ht_lock ht_locks[BUF_LOCKS] __aligned(CACHE_LINE_SIZE);
+	struct ht_lock *ht_locks;
+	uint64_t ht_lock_mask;
 } buf_hash_table_t;
 
 static buf_hash_table_t buf_hash_table;
 
 #define	BUF_HASH_INDEX(spa, dva, birth) \
 	(buf_hash(spa, dva, birth) & buf_hash_table.ht_mask)
-#define	BUF_HASH_LOCK_NTRY(idx) (buf_hash_table.ht_locks[idx & (BUF_LOCKS-1)])
+#define	BUF_HASH_LOCK_NTRY(idx) \
+	(buf_hash_table.ht_locks[idx & buf_hash_table.ht_lock_mask])
 #define	BUF_HASH_LOCK(idx)	(&(BUF_HASH_LOCK_NTRY(idx).ht_lock))
 #define	HDR_LOCK(hdr) \
 	(BUF_HASH_LOCK(BUF_HASH_INDEX(hdr->b_spa, &hdr->b_dva, hdr->b_birth)))
@@ -911,8 +925,10 @@ buf_fini(void)
 
 	kmem_free(buf_hash_table.ht_table,
 	    (buf_hash_table.ht_mask + 1) * sizeof (void *));
-	for (i = 0; i < BUF_LOCKS; i++)
+	for (i = 0; i < (int)(buf_hash_table.ht_lock_mask + 1); i++)
 		mutex_destroy(&buf_hash_table.ht_locks[i].ht_lock);
+	kmem_free(buf_hash_table.ht_locks,
+	    (buf_hash_table.ht_lock_mask + 1) * sizeof (struct ht_lock));
 	kmem_cache_destroy(hdr_cache);
 	kmem_cache_destroy(buf_cache);
 }
@@ -999,6 +1015,7 @@ buf_init(void)
 {
 	uint64_t *ct;
 	uint64_t hsize = 1ULL << 12;
+	uint64_t nlocks;
 	int i, j;
 
 	/*
@@ -1027,7 +1044,18 @@ retry:
 		for (ct = zfs_crc64_table + i, *ct = i, j = 8; j > 0; j--)
 			*ct = (*ct >> 1) ^ (-(*ct & 1) & ZFS_CRC64_POLY);
 
-	for (i = 0; i < BUF_LOCKS; i++) {
+	/*
+	 * Scale the lock stripes with the CPU count - 16 per CPU keeps
+	 * collisions between concurrently hashing CPUs unlikely, while a
+	 * single-vCPU guest gets away with 32 stripes instead of 256.
+	 */
+	nlocks = BUF_LOCKS_MIN;
+	while (nlocks < (uint64_t)mp_ncpus * 16 && nlocks < BUF_LOCKS_MAX)
+		nlocks <<= 1;
+	buf_hash_table.ht_lock_mask = nlocks - 1;
+	buf_hash_table.ht_locks =
+	    kmem_zalloc(nlocks * sizeof (struct ht_lock), KM_SLEEP);
+	for (i = 0; i < (int)nlocks; i++) {
 		mutex_init(&buf_hash_table.ht_locks[i].ht_lock,
 		    NULL, MUTEX_DEFAULT, NULL);
 	}
@@ -3953,6 +3981,23 @@ arc_init(void)
 		arc_c_max = arc_c_min;
 	arc_c_max = MAX(arc_c * 5, arc_c_max);
 
+#ifdef __OSV__
+	/*
+	 * Low-memory profile: on small guests (1GB of RAM or less) the
+	 * server-oriented defaults above let the ARC take half of memory,
+	 * and shrinking it back 1/32 at a time is too slow to keep
+	 * allocations from stalling. Cap the target at a quarter of the
+	 * kernel memory, keep the floor low enough for the ARC to get
+	 * mostly out of the way, and shrink in larger steps. Explicit
+	 * vfs.zfs.arc_max/arc_min tunables below still win.
+	 */
+	if ((uint64_t)physmem * PAGESIZE <= (1ULL << 30)) {
+		arc_c_max = MAX(kmem_size() / 4, 64<<18);
+		arc_c_min = MIN(arc_c_min, MAX(kmem_size() / 16, 64<<18));
+		arc_shrink_shift = 4;
+	}
+#endif
+
 #ifdef _KERNEL
 	/*
 	 * Allow the tunables to override our calculations if they are
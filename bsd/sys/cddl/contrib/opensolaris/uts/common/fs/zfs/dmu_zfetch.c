@@ -44,6 +44,15 @@ uint32_t	zfetch_max_streams = 8;
 uint32_t	zfetch_min_sec_reap = 2;
 /* max number of blocks to fetch at a time */
 uint32_t	zfetch_block_cap = 256;
+/*
+ * Initial/floor prefetch depth of a stream, in blocks. The stock code
+ * started at the size of the triggering read (usually one block) and
+ * doubled per hit, which leaves a virtio-blk backed pool idle for the
+ * first several guest/host round trips of a sequential scan; starting
+ * deeper keeps the host's I/O pipeline busy from the first miss.
+ * (OSv addition)
+ */
+uint32_t	zfetch_min_cap = 16;
 /* number of bytes in a array_read at which we stop prefetching (1Mb) */
 uint64_t	zfetch_array_rd_sz = 1024 * 1024;
 
@@ -60,6 +69,9 @@ SYSCTL_UINT(_vfs_zfs_zfetch, OID_AUTO, min_sec_reap, CTLFLAG_RDTUN,
 TUNABLE_INT("vfs.zfs.zfetch.block_cap", &zfetch_block_cap);
 SYSCTL_UINT(_vfs_zfs_zfetch, OID_AUTO, block_cap, CTLFLAG_RDTUN,
     &zfetch_block_cap, 0, "Max number of blocks to fetch at a time");
+TUNABLE_INT("vfs.zfs.zfetch.min_cap", &zfetch_min_cap);
+SYSCTL_UINT(_vfs_zfs_zfetch, OID_AUTO, min_cap, CTLFLAG_RW,
+    &zfetch_min_cap, 0, "Initial number of blocks a stream fetches");
 TUNABLE_QUAD("vfs.zfs.zfetch.array_rd_sz", &zfetch_array_rd_sz);
 SYSCTL_UQUAD(_vfs_zfs_zfetch, OID_AUTO, array_rd_sz, CTLFLAG_RDTUN,
     &zfetch_array_rd_sz, 0,
@@ -88,6 +100,7 @@ typedef struct zfetch_stats {
 	kstat_named_t zfetchstat_stream_resets;
 	kstat_named_t zfetchstat_stream_noresets;
 	kstat_named_t zfetchstat_bogus_streams;
+	kstat_named_t zfetchstat_fetched_blocks;
 } zfetch_stats_t;
 
 static zfetch_stats_t zfetch_stats = {
@@ -102,6 +115,7 @@ static zfetch_stats_t zfetch_stats = {
 	{ "streams_resets",		KSTAT_DATA_UINT64 },
 	{ "streams_noresets",		KSTAT_DATA_UINT64 },
 	{ "bogus_streams",		KSTAT_DATA_UINT64 },
+	{ "fetched_blocks",		KSTAT_DATA_UINT64 },
 };
 
 #define	ZFETCHSTAT_INCR(stat, val) \
@@ -205,7 +219,8 @@ dmu_zfetch_dofetch(zfetch_t *zf, zstream_t *zs)
 	uint64_t	blocks_fetched;
 
 	zs->zst_stride = MAX((int64_t)zs->zst_stride, zs->zst_len);
-	zs->zst_cap = MIN(zfetch_block_cap, 2 * zs->zst_cap);
+	zs->zst_cap = MIN(zfetch_block_cap,
+	    MAX(zfetch_min_cap, 2 * zs->zst_cap));
 
 	prefetch_tail = MAX((int64_t)zs->zst_ph_offset,
 	    (int64_t)(zs->zst_offset + zs->zst_stride));
@@ -237,6 +252,7 @@ dmu_zfetch_dofetch(zfetch_t *zf, zstream_t *zs)
 
 		blocks_fetched = dmu_zfetch_fetch(zf->zf_dnode,
 		    prefetch_ofst, zs->zst_len);
+		ZFETCHSTAT_INCR(zfetchstat_fetched_blocks, blocks_fetched);
 
 		prefetch_tail += zs->zst_stride;
 		/* stop if we've run out of stuff to prefetch */
@@ -752,3 +768,42 @@ dmu_zfetch(zfetch_t *zf, uint64_t offset, uint64_t size, int prefetched)
 		}
 	}
 }
+
+/*
+ * OSv additions: setter for the tunables above, driven by the mount
+ * options path (parse_zfs_mount_options() in fs/vfs/main.cc), and a
+ * counter snapshot for the REST monitoring API. Both are handed to the
+ * kernel as callbacks from zfs_initialize.c, like osv_zfs_ioctl().
+ */
+int
+osv_zfs_zfetch_set(const char *name, uint64_t value)
+{
+	if (strcmp(name, "max_streams") == 0)
+		zfetch_max_streams = value;
+	else if (strcmp(name, "min_sec_reap") == 0)
+		zfetch_min_sec_reap = value;
+	else if (strcmp(name, "block_cap") == 0)
+		zfetch_block_cap = value;
+	else if (strcmp(name, "min_cap") == 0)
+		zfetch_min_cap = value;
+	else if (strcmp(name, "array_rd_sz") == 0)
+		zfetch_array_rd_sz = value;
+	else if (strcmp(name, "prefetch_disable") == 0)
+		zfs_prefetch_disable = value;
+	else
+		return (EINVAL);
+	return (0);
+}
+
+void
+osv_zfs_zfetch_stats(uint64_t *hits, uint64_t *misses,
+    uint64_t *stride_hits, uint64_t *stride_misses,
+    uint64_t *fetched_blocks, uint64_t *reclaim_failures)
+{
+	*hits = zfetch_stats.zfetchstat_hits.value.ui64;
+	*misses = zfetch_stats.zfetchstat_misses.value.ui64;
+	*stride_hits = zfetch_stats.zfetchstat_stride_hits.value.ui64;
+	*stride_misses = zfetch_stats.zfetchstat_stride_misses.value.ui64;
+	*fetched_blocks = zfetch_stats.zfetchstat_fetched_blocks.value.ui64;
+	*reclaim_failures = zfetch_stats.zfetchstat_reclaim_failures.value.ui64;
+}
@@ -97,6 +97,11 @@ typedef struct {
 #define	LINUX_SO_SNDTIMEO	21
 #define	LINUX_SO_TIMESTAMP	29
 #define	LINUX_SO_ACCEPTCONN	30
+#define	LINUX_SO_BUSY_POLL	46
+#define	LINUX_SO_INCOMING_CPU	49
+/* OSv extension, no Linux counterpart; chosen well clear of the numbers
+ * Linux assigns to its SO_* options */
+#define	LINUX_SO_TRACE_CONTEXT	200
 
 #define	LINUX_IP_MULTICAST_IF		32
 #define	LINUX_IP_MULTICAST_TTL		33
@@ -39,6 +39,7 @@
 #include <osv/uio.h>
 #include <bsd/uipc_syscalls.h>
 
+#include <bsd/porting/netport.h>
 #include <bsd/sys/sys/limits.h>
 #include <bsd/sys/sys/mbuf.h>
 #include <bsd/sys/sys/socket.h>
@@ -359,6 +360,12 @@ linux_to_bsd_so_sockopt(int opt)
 		return (SO_TIMESTAMP);
 	case LINUX_SO_ACCEPTCONN:
 		return (SO_ACCEPTCONN);
+	case LINUX_SO_BUSY_POLL:
+		return (SO_BUSY_POLL);
+	case LINUX_SO_INCOMING_CPU:
+		return (SO_INCOMING_CPU);
+	case LINUX_SO_TRACE_CONTEXT:
+		return (SO_TRACE_CONTEXT);
 	}
 	return (-1);
 }
@@ -537,6 +544,30 @@ linux_sendit(int s, struct msghdr *mp, int flags,
 	return (error);
 }
 
+/* Like linux_sendit(), but for a socket the caller has already pinned. */
+static int
+linux_sendit_so(struct socket *so, struct msghdr *mp, int flags,
+    struct mbuf *control, ssize_t *bytes)
+{
+	struct bsd_sockaddr *to;
+	int error, bsd_flags;
+
+	if (mp->msg_name != NULL) {
+		error = linux_getsockaddr(&to, (const bsd_osockaddr*)mp->msg_name, mp->msg_namelen);
+		if (error)
+			return (error);
+		mp->msg_name = to;
+	} else
+		to = NULL;
+
+	bsd_flags = linux_to_bsd_msg_flags(flags);
+	error = kern_sendit_so(so, mp, bsd_flags, control, bytes);
+
+	if (to)
+		free(to);
+	return (error);
+}
+
 /* Return 0 if IP_HDRINCL is set for the given socket. */
 static int
 linux_check_hdrincl(int s)
@@ -1037,16 +1068,67 @@ bad:
 	return (error);
 }
 
+/*
+ * sendmmsg(): send a vector of datagrams in one call. The socket is
+ * pinned once for the whole batch, so at high message rates the
+ * per-datagram fget()/fdrop() and descriptor-type check are paid once
+ * instead of per packet.
+ *
+ * Linux semantics: returns the number of datagrams actually sent, and an
+ * error is reported only if no datagram was sent at all - otherwise it
+ * will be seen again on the next call.
+ */
+int
+linux_sendmmsg(int s, struct mmsghdr *msgvec, unsigned int vlen, int flags,
+    unsigned int *sent)
+{
+	struct file *fp;
+	struct socket *so;
+	unsigned int i;
+	int error;
+
+	error = getsock_cap(s, &fp, NULL);
+	if (error)
+		return (error);
+	so = (struct socket *)file_data(fp);
+
+	for (i = 0; i < vlen; i++) {
+		struct msghdr *msg = &msgvec[i].msg_hdr;
+		ssize_t bytes = 0;
+
+		/* See the msg_control notes in linux_sendmsg(). */
+		if (msg->msg_control != NULL && msg->msg_controllen == 0)
+			msg->msg_control = NULL;
+		assert(msg->msg_control == NULL);
+
+		error = linux_to_bsd_msghdr(msg);
+		if (error)
+			break;
+		error = linux_sendit_so(so, msg, flags, NULL, &bytes);
+		if (error)
+			break;
+		msgvec[i].msg_len = bytes;
+	}
+	fdrop(fp);
+
+	if (i > 0)
+		error = 0;
+	*sent = i;
+	return (error);
+}
+
 struct linux_recvmsg_args {
 	int s;
 	l_uintptr_t msg;
 	int flags;
 };
 
-/* FIXME: OSv - flags are ignored, the flags
- * inside the msghdr are used instead */
-int
-linux_recvmsg(int s, struct msghdr *msg, int flags, ssize_t* bytes)
+/* The guts of linux_recvmsg(), operating on an already-pinned socket.
+ * flags (in Linux encoding) are merged into the msghdr's msg_flags, which
+ * is what the BSD receive path looks at. */
+static int
+linux_recvmsg_so(struct socket *so, struct msghdr *msg, int flags,
+    ssize_t* bytes)
 {
 #if 0
 	socklen_t datalen, outlen;
@@ -1057,6 +1139,7 @@ linux_recvmsg(int s, struct msghdr *msg, int flags, ssize_t* bytes)
 	int error, i, fd, fds, *fdp;
 #endif
 	int error;
+	msg->msg_flags |= flags;
 	error = linux_to_bsd_msghdr(msg);
 	if (error)
 		return (error);
@@ -1070,7 +1153,7 @@ linux_recvmsg(int s, struct msghdr *msg, int flags, ssize_t* bytes)
 
 	assert(msg->msg_control == NULL);
 
-	error = kern_recvit(s, msg, NULL, bytes);
+	error = kern_recvit_so(so, msg, NULL, bytes);
 	if (error)
 		goto bad;
 
@@ -1200,6 +1283,84 @@ bad:
 	return (error);
 }
 
+/* FIXME: OSv - flags are ignored, the flags
+ * inside the msghdr are used instead */
+int
+linux_recvmsg(int s, struct msghdr *msg, int flags, ssize_t* bytes)
+{
+	struct file *fp;
+	struct socket *so;
+	int error;
+
+	error = getsock_cap(s, &fp, NULL);
+	if (error)
+		return (error);
+	so = (struct socket *)file_data(fp);
+	error = linux_recvmsg_so(so, msg, 0, bytes);
+	fdrop(fp);
+	return (error);
+}
+
+/*
+ * recvmmsg(): receive a vector of datagrams in one call, pinning the
+ * socket once for the whole batch like linux_sendmmsg() above.
+ *
+ * As in Linux, the timeout is only checked after receiving a datagram,
+ * and MSG_WAITFORONE makes every receive after the first non-blocking.
+ * If some datagrams were received before an error, their count is
+ * returned and the error is left to reappear on the next call.
+ */
+int
+linux_recvmmsg(int s, struct mmsghdr *msgvec, unsigned int vlen, int flags,
+    struct timespec *timeout, unsigned int *received)
+{
+	struct file *fp;
+	struct socket *so;
+	struct timeval now;
+	uint64_t deadline = 0;
+	unsigned int i;
+	int error;
+
+	if (timeout != NULL) {
+		getmicrouptime(&now);
+		deadline = now.tv_sec * 1000000ULL + now.tv_usec +
+		    timeout->tv_sec * 1000000ULL + timeout->tv_nsec / 1000;
+	}
+
+	error = getsock_cap(s, &fp, NULL);
+	if (error)
+		return (error);
+	so = (struct socket *)file_data(fp);
+
+	for (i = 0; i < vlen; i++) {
+		struct msghdr *msg = &msgvec[i].msg_hdr;
+		ssize_t bytes = 0;
+		int msg_flags = flags;
+
+		if (i > 0 && (flags & LINUX_MSG_WAITFORONE))
+			msg_flags |= LINUX_MSG_DONTWAIT;
+
+		error = linux_recvmsg_so(so, msg, msg_flags, &bytes);
+		if (error)
+			break;
+		msgvec[i].msg_len = bytes;
+
+		if (deadline) {
+			getmicrouptime(&now);
+			if (now.tv_sec * 1000000ULL + now.tv_usec >= deadline) {
+				i++;
+				break;
+			}
+		}
+	}
+	fdrop(fp);
+
+	if (i > 0)
+		error = 0;
+	*received = i;
+	return (error);
+}
+
 int
 linux_shutdown(int s, int how)
 {
@@ -147,6 +147,8 @@ static void ena_free_io_irq(struct ena_adapter *);
 static void ena_free_irqs(struct ena_adapter *);
 static void ena_disable_msix(struct ena_adapter *);
 static void ena_unmask_all_io_irqs(struct ena_adapter *);
+static int ena_rss_init_default(struct ena_adapter *);
+static int ena_rss_configure(struct ena_adapter *);
 static int ena_up_complete(struct ena_adapter *);
 static void ena_init(void *);
 static int ena_ioctl(if_t, u_long, caddr_t);
@@ -321,6 +323,8 @@ ena_init_io_rings_basic(struct ena_adapter *adapter)
 
 		rxr->empty_rx_queue = 0;
 		rxr->rx_mbuf_sz = MJUMPAGESIZE;
+		rxr->moder_packets.store(0);
+		rxr->moder_interval.store(ENA_RX_IRQ_INTERVAL);
 	}
 }
 
@@ -1323,10 +1327,104 @@ ena_unmask_all_io_irqs(struct ena_adapter *adapter)
 	}
 }
 
+/*
+ * Set up the device RSS: a Toeplitz hash (with the device-chosen key) and
+ * an indirection table spreading flows round-robin over all Rx queues, so
+ * ingest scales past a single rx cleanup thread. Trimmed down from the
+ * FreeBSD driver's ena_rss.c, which this port had dropped.
+ */
+static int
+ena_rss_init_default(struct ena_adapter *adapter)
+{
+	struct ena_com_dev *ena_dev = adapter->ena_dev;
+	pci::device *pdev = adapter->pdev;
+	int rc;
+
+	rc = ena_com_rss_init(ena_dev, ENA_RX_RSS_TABLE_LOG_SIZE);
+	if (unlikely(rc != 0)) {
+		ena_log(pdev, ERR, "Cannot init indirection table");
+		return (rc);
+	}
+
+	rc = ena_com_fill_hash_function(ena_dev, ENA_ADMIN_TOEPLITZ, NULL,
+	    ENA_HASH_KEY_SIZE, 0xFFFFFFFF);
+	if (unlikely((rc != 0) && (rc != EOPNOTSUPP))) {
+		ena_log(pdev, ERR, "Cannot fill hash function");
+		goto err_rss_destroy;
+	}
+
+	rc = ena_com_set_default_hash_ctrl(ena_dev);
+	if (unlikely((rc != 0) && (rc != EOPNOTSUPP))) {
+		ena_log(pdev, ERR, "Cannot fill hash control");
+		goto err_rss_destroy;
+	}
+
+	ENA_FLAG_SET_ATOMIC(ENA_FLAG_RSS_ACTIVE, adapter);
+	return (0);
+
+err_rss_destroy:
+	ena_com_rss_destroy(ena_dev);
+	return (rc);
+}
+
+/*
+ * Flush the RSS configuration to the device; must run once the Rx queues
+ * exist. The indirection entries are (re)filled here rather than in
+ * ena_rss_init_default() so a device reset that came back with fewer IO
+ * queues never leaves stale entries pointing past num_io_queues.
+ */
+static int
+ena_rss_configure(struct ena_adapter *adapter)
+{
+	struct ena_com_dev *ena_dev = adapter->ena_dev;
+	pci::device *pdev = adapter->pdev;
+	int qid, rc, i;
+
+	for (i = 0; i < ENA_RX_RSS_TABLE_SIZE; i++) {
+		qid = i % adapter->num_io_queues;
+		rc = ena_com_indirect_table_fill_entry(ena_dev, i,
+		    ENA_IO_RXQ_IDX(qid));
+		if (unlikely((rc != 0) && (rc != EOPNOTSUPP))) {
+			ena_log(pdev, ERR, "Cannot fill indirection table");
+			return (rc);
+		}
+	}
+
+	rc = ena_com_set_hash_function(ena_dev);
+	if (unlikely((rc != 0) && (rc != EOPNOTSUPP))) {
+		ena_log(pdev, ERR, "Cannot set hash function");
+		return (rc);
+	}
+
+	rc = ena_com_set_hash_ctrl(ena_dev);
+	if (unlikely((rc != 0) && (rc != EOPNOTSUPP))) {
+		ena_log(pdev, ERR, "Cannot set hash control");
+		return (rc);
+	}
+
+	rc = ena_com_indirect_table_set(ena_dev);
+	if (unlikely((rc != 0) && (rc != EOPNOTSUPP))) {
+		ena_log(pdev, ERR, "Cannot set indirection table");
+		return (rc);
+	}
+
+	return (0);
+}
+
 static int
 ena_up_complete(struct ena_adapter *adapter)
 {
-	int rc = ena_change_mtu(adapter->ifp, adapter->ifp->if_mtu);
+	int rc;
+
+	if (likely(ENA_FLAG_ISSET(ENA_FLAG_RSS_ACTIVE, adapter))) {
+		rc = ena_rss_configure(adapter);
+		if (unlikely(rc != 0)) {
+			ena_log(adapter->pdev, ERR, "Failed to configure RSS");
+			return (rc);
+		}
+	}
+
+	rc = ena_change_mtu(adapter->ifp, adapter->ifp->if_mtu);
 	if (unlikely(rc != 0))
 		return (rc);
 
@@ -2168,11 +2266,56 @@ ena_update_hints(struct ena_adapter *adapter,
 	}
 }
 
+/*
+ * Adaptive Rx interrupt moderation, in the spirit of the Linux driver's
+ * DIM: once a second map each ring's observed packet rate to an unmask
+ * interval, so a busy ring trades latency for fewer interrupts while an
+ * idle one stays at zero delay.
+ */
+static void
+ena_update_io_moderation(struct ena_adapter *adapter)
+{
+	static const struct {
+		uint32_t pps;
+		uint16_t interval;
+	} moder_table[] = {
+		{ 10000, 0 },
+		{ 75000, ENA_RX_IRQ_INTERVAL },
+		{ 250000, 64 },
+		{ UINT32_MAX, ENA_RX_IRQ_INTERVAL_MAX },
+	};
+	struct ena_ring *rx_ring;
+	uint32_t pkts;
+	uint16_t target, cur;
+	int i, j;
+
+	if (!ena_com_get_adaptive_moderation_enabled(adapter->ena_dev))
+		return;
+
+	for (i = 0; i < adapter->num_io_queues; i++) {
+		rx_ring = &adapter->rx_ring[i];
+		pkts = rx_ring->moder_packets.exchange(0,
+		    std::memory_order_relaxed);
+
+		for (j = 0; moder_table[j].pps != UINT32_MAX; j++)
+			if (pkts < moder_table[j].pps)
+				break;
+		target = moder_table[j].interval;
+
+		/* Move half way towards the target to damp oscillation */
+		cur = rx_ring->moder_interval.load(std::memory_order_relaxed);
+		rx_ring->moder_interval.store((cur + target) / 2,
+		    std::memory_order_relaxed);
+	}
+}
+
 static void
 ena_timer_service(void *data)
 {
 	struct ena_adapter *adapter = (struct ena_adapter *)data;
 
+	ena_update_io_moderation(adapter);
+
 	check_for_missing_keep_alive(adapter);
 
 	check_for_admin_com_state(adapter);
@@ -2544,6 +2687,15 @@ ena_attach(pci::device* pdev, ena_adapter **_adapter)
 	/* initialize rings basic information */
 	ena_init_io_rings(adapter);
 
+	/*
+	 * Set up RSS so receive flows spread over all IO queues. Running
+	 * with a single queue is still fine without it, so a failure only
+	 * costs the spreading.
+	 */
+	rc = ena_rss_init_default(adapter);
+	if (unlikely(rc != 0))
+		ena_log(pdev, WARN, "Cannot init RSS rc: %d", rc);
+
 	/* Initialize statistics */
 	ena_alloc_counters((counter_u64_t *)&adapter->dev_stats,
 	    sizeof(struct ena_stats_dev));
@@ -2809,6 +2961,14 @@ ena_device_init(struct ena_adapter *adapter, pci::device *pdev,
 		goto err_admin_init;
 	}
 
+	rc = ena_com_init_interrupt_moderation(ena_dev);
+	if (unlikely(rc != 0)) {
+		ena_log(pdev, ERR, "Cannot init interrupt moderation");
+		goto err_admin_init;
+	}
+	if (ena_com_interrupt_moderation_supported(ena_dev))
+		ena_com_enable_adaptive_moderation(ena_dev);
+
 	return (0);
 
 err_admin_init:
@@ -117,6 +117,9 @@
 #define ENA_RX_IRQ_INTERVAL	20
 #define ENA_TX_IRQ_INTERVAL	50
 
+/* Largest Rx unmask interval (usec) adaptive moderation may pick */
+#define ENA_RX_IRQ_INTERVAL_MAX	128
+
 #define ENA_MIN_MTU		128
 
 #define ENA_TSO_MAXSIZE		65536
@@ -362,6 +365,15 @@ struct ena_ring {
 	std::atomic<uint8_t> first_interrupt;
 	uint16_t no_interrupt_event_cnt;
 
+	/*
+	 * Adaptive Rx interrupt moderation: packets cleaned since the last
+	 * timer service tick, and the current unmask interval (usec) derived
+	 * from the observed rate. Written by the cleanup path, read and
+	 * adjusted by the timer service (see ena_update_io_moderation()).
+	 */
+	std::atomic<uint32_t> moder_packets;
+	std::atomic<uint16_t> moder_interval;
+
 	struct ena_com_rx_buf_info ena_bufs[ENA_PKT_MAX_BUFS];
 
 	struct ena_que *que;
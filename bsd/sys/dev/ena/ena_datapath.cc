@@ -79,6 +79,7 @@ ena_cleanup(struct ena_que *que)
 	struct ena_eth_io_intr_reg intr_reg;
 	int qid, ena_qid;
 	int txc, rxc, i;
+	int rx_pkts = 0;
 
 	if (unlikely((ifp->if_drv_flags & IFF_DRV_RUNNING) == 0))
 		return;
@@ -97,6 +98,7 @@ ena_cleanup(struct ena_que *que)
 	for (i = 0; i < ENA_CLEAN_BUDGET; ++i) {
 		rxc = ena_rx_cleanup(rx_ring);
 		txc = ena_tx_cleanup(tx_ring);
+		rx_pkts += rxc;
 
 		if (unlikely((ifp->if_drv_flags & IFF_DRV_RUNNING) == 0))
 			return;
@@ -105,8 +107,17 @@ ena_cleanup(struct ena_que *que)
 			break;
 	}
 
-	/* Signal that work is done and unmask interrupt */
-	ena_com_update_intr_reg(&intr_reg, ENA_RX_IRQ_INTERVAL,
+	if (rx_pkts != 0)
+		rx_ring->moder_packets.fetch_add(rx_pkts,
+		    std::memory_order_relaxed);
+
+	/*
+	 * Signal that work is done and unmask interrupt. The Rx interval
+	 * follows the load observed by the timer service; the Tx one is
+	 * static since tx completions are already reaped lazily.
+	 */
+	ena_com_update_intr_reg(&intr_reg,
+	    rx_ring->moder_interval.load(std::memory_order_relaxed),
 	    ENA_TX_IRQ_INTERVAL, true);
 	counter_u64_add(tx_ring->tx_stats.unmask_interrupt_num, 1);
 	ena_com_unmask_intr(io_cq, &intr_reg);
@@ -372,6 +383,14 @@ ena_rx_mbuf(struct ena_ring *rx_ring, struct ena_com_rx_buf_info *ena_bufs,
 	ena_log_io(adapter->pdev, DBG, "Mbuf data offset=%u", ena_rx_ctx->pkt_offset);
 	mbuf->M_dat.MH.MH_pkthdr.rcvif = rx_ring->que->adapter->ifp;
 
+	/*
+	 * Pass the hash the device computed for RSS queue selection up the
+	 * stack, so the net-channel classifier can reuse it for the flow
+	 * lookup instead of hashing the headers again in software.
+	 */
+	mbuf->M_dat.MH.MH_pkthdr.flowid = ena_rx_ctx->hash;
+	mbuf->m_hdr.mh_flags |= M_FLOWID;
+
 	ena_log_io(adapter->pdev, DBG, "rx mbuf 0x%p, flags=0x%x, len: %d", mbuf,
 	    mbuf->m_hdr.mh_flags, mbuf->M_dat.MH.MH_pkthdr.len);
 
@@ -98,6 +98,9 @@ static void blkfront_initialize(struct xb_softc *);
 static int blkif_completion(struct xb_command *);
 static void blkif_free(struct xb_softc *);
 static void blkif_queue_cb(void *, bus_dma_segment_t *, int, int);
+static void blkif_put_to_ring(struct xb_softc *, struct xb_command *,
+                              bus_dma_segment_t *, int, blkif_vdev_t,
+                              grant_ref_t *);
 
 #define GRANT_INVALID_REF 0
 
@@ -381,7 +384,21 @@ xb_dump(void *arg, void *vvirtual, vm_offset_t physical, off_t offset,
             return (EBUSY);
         }
 
-        if (gnttab_alloc_grant_references(sc->max_request_segments,
+        chunk = length > sc->max_request_size
+              ? sc->max_request_size : length;
+
+        if (sc->xb_flags & XB_PERSISTENT) {
+            cm->pers_nseg = howmany(chunk, PAGE_SIZE);
+            if (!sc->persistent_pool->get(cm->pers_pages,
+                cm->pers_nseg)) {
+                cm->pers_nseg = 0;
+                xb_free_command(cm);
+                mutex_unlock(&xsc->xb_io_lock);
+                device_printf(sc->xb_dev,
+                    "no more persistent pages?\n");
+                return (EBUSY);
+            }
+        } else if (gnttab_alloc_grant_references(sc->max_request_segments,
                           &cm->gref_head) != 0) {
             xb_free_command(cm);
             mutex_unlock(&xsc->xb_io_lock);
@@ -389,8 +406,6 @@ xb_dump(void *arg, void *vvirtual, vm_offset_t physical, off_t offset,
             return (EBUSY);
         }
 
-        chunk = length > sc->max_request_size
-              ? sc->max_request_size : length;
         cm->data = vvirtual;
         cm->datalen = chunk;
         cm->operation = BLKIF_OP_WRITE;
@@ -616,13 +631,95 @@ blkif_claim_gref(grant_ref_t *gref_head,
     return ref;
 }
 
+/*
+ * Pool of persistently granted pages, used when the backend advertises
+ * feature-persistent.  Each page is granted to the backend exactly once,
+ * when it first enters the pool, and the grant is only revoked at device
+ * teardown; requests copy their data through these pages instead of
+ * granting and revoking the bio's own pages, which replaces two grant
+ * table hypercalls per segment with a memcpy.
+ */
+class blkfront_persistent_pool
+{
+public:
+    blkfront_persistent_pool(device_t dev, u_int max_pages)
+        : _dev(dev), _max_pages(max_pages) {}
+    ~blkfront_persistent_pool();
+
+    bool get(blkfront_persistent_page *pages, u_int count);
+    void put(blkfront_persistent_page *pages, u_int count);
+
+private:
+    bool grow(u_int count);
+
+    device_t _dev;
+    u_int _max_pages;
+    u_int _nr_pages = 0;
+    std::stack<blkfront_persistent_page> _free;
+};
+
+bool blkfront_persistent_pool::grow(u_int count)
+{
+    while (count != 0 && _nr_pages < _max_pages) {
+        blkfront_persistent_page pg;
+
+        if (gnttab_alloc_grant_references(1, &pg.gref_list) != 0) {
+            return false;
+        }
+
+        pg.va = memory::alloc_page();
+        pg.gref = blkif_claim_gref(&pg.gref_list, _dev,
+                                   virt_to_phys(pg.va), 0);
+        _free.push(pg);
+        _nr_pages++;
+        count--;
+    }
+    return count == 0;
+}
+
+bool blkfront_persistent_pool::get(blkfront_persistent_page *pages,
+                                   u_int count)
+{
+    if (_free.size() < count) {
+        grow(count - _free.size());
+        if (_free.size() < count) {
+            return false;
+        }
+    }
+
+    for (u_int i = 0; i < count; i++) {
+        pages[i] = _free.top();
+        _free.pop();
+    }
+    return true;
+}
+
+void blkfront_persistent_pool::put(blkfront_persistent_page *pages,
+                                   u_int count)
+{
+    for (u_int i = 0; i < count; i++) {
+        _free.push(pages[i]);
+    }
+}
+
+blkfront_persistent_pool::~blkfront_persistent_pool()
+{
+    while (!_free.empty()) {
+        auto pg = _free.top();
+        _free.pop();
+        gnttab_end_foreign_access_references(1, &pg.gref);
+        gnttab_free_grant_references(pg.gref_list);
+        memory::free_page(pg.va);
+    }
+}
+
 class indirect_page
 {
 public:
     indirect_page()
         : _va(memory::alloc_page()) {}
 
-    ~indirect_page() { memory::free_page(_va); }
+    ~indirect_page() { free_gref(); memory::free_page(_va); }
 
     static constexpr unsigned capacity()
         { return memory::page_size / sizeof(blkif_segment_indirect_t); }
@@ -636,6 +733,7 @@ public:
 private:
     void* _va;
 
+    bool _granted = false;
     grant_ref_t _gref_list;
     grant_ref_t _gref;
 };
@@ -643,9 +741,10 @@ private:
 class blkfront_indirect_descriptor
 {
 public:
-    blkfront_indirect_descriptor(int max_segs)
+    blkfront_indirect_descriptor(int max_segs, bool persistent)
         : _pages(pages_required(max_segs))
         , _max_segs(max_segs)
+        , _persistent(persistent)
         {}
 
     static constexpr unsigned total_capacity()
@@ -679,13 +778,15 @@ private:
     std::vector<indirect_page> _pages;
     int _max_segs;
     int _seg_number = 0;
+    bool _persistent;
     blkif_request_indirect_t *_descr = nullptr;
 };
 
 class blkfront_indirect_descriptors
 {
 public:
-    blkfront_indirect_descriptors(device_t &dev, uint32_t max_requests);
+    blkfront_indirect_descriptors(device_t &dev, uint32_t max_requests,
+                                  bool persistent);
     ~blkfront_indirect_descriptors();
 
     blkfront_indirect_descriptor *get()
@@ -790,6 +891,10 @@ void indirect_page::set_segment(int seg_num, grant_ref_t gref,
 
 grant_ref_t indirect_page::alloc_gref(device_t dev)
 {
+    if (_granted) {
+        return _gref;
+    }
+
     if (gnttab_alloc_grant_references(1, &_gref_list) != 0) {
             device_printf(dev, "No memory for grant references");
             abort();
@@ -797,13 +902,19 @@ grant_ref_t indirect_page::alloc_gref(device_t dev)
 
     auto pa = virt_to_phys(_va);
     _gref = blkif_claim_gref(&_gref_list, dev, pa, 1);
+    _granted = true;
     return _gref;
 }
 
 void indirect_page::free_gref()
 {
+    if (!_granted) {
+        return;
+    }
+
     gnttab_end_foreign_access_references(1, &_gref);
     gnttab_free_grant_references(_gref_list);
+    _granted = false;
 }
 
 void blkfront_indirect_descriptor::configure(uint64_t id,
@@ -846,6 +957,15 @@ void blkfront_indirect_descriptor::map(device_t dev)
 
 void blkfront_indirect_descriptor::unmap()
 {
+    /*
+     * With persistent grants the backend keeps the indirect pages mapped
+     * too - the grants stay valid and alloc_gref() reuses them on the
+     * next request.
+     */
+    if (_persistent) {
+        return;
+    }
+
     for(auto i = 0; i < pages_required(_seg_number); i++)
     {
         _pages[i].free_gref();
@@ -853,7 +973,7 @@ void blkfront_indirect_descriptor::unmap()
 }
 
 blkfront_indirect_descriptors::blkfront_indirect_descriptors(device_t &dev,
-    uint32_t max_requests)
+    uint32_t max_requests, bool persistent)
 {
     _max_segs = blkfront_read_feature(dev, "feature-max-indirect-segments");
 
@@ -861,7 +981,8 @@ blkfront_indirect_descriptors::blkfront_indirect_descriptors(device_t &dev,
 
     if (_max_segs != 0) {
         for(auto i = 0; i < max_requests; i++) {
-            _descriptors.emplace(new blkfront_indirect_descriptor(_max_segs));
+            _descriptors.emplace(new blkfront_indirect_descriptor(_max_segs,
+                                                                  persistent));
         }
     }
 }
@@ -923,6 +1044,14 @@ blkfront_alloc_commands(struct xb_softc* sc)
         cm->sg_refs = (grant_ref_t *)malloc(sizeof(grant_ref_t)
                    * sc->max_request_segments,
                      M_XENBLOCKFRONT, M_NOWAIT);
+        if (sc->xb_flags & XB_PERSISTENT) {
+            cm->pers_pages = (blkfront_persistent_page *)malloc(
+                   sizeof(*cm->pers_pages) * sc->max_request_segments,
+                     M_XENBLOCKFRONT, M_NOWAIT);
+            cm->pers_segs = (bus_dma_segment_t *)malloc(
+                   sizeof(*cm->pers_segs) * sc->max_request_segments,
+                     M_XENBLOCKFRONT, M_NOWAIT);
+        }
         cm->id = i;
         cm->cm_sc = sc;
         if (bus_dmamap_create(sc->xb_io_dmat, 0, &cm->map) != 0)
@@ -1097,6 +1226,15 @@ blkfront_initialize(struct xb_softc *sc)
         return;
     }
 
+    error = xs_printf(XST_NIL, node_path,
+             "feature-persistent", "%u", 1);
+    if (error) {
+        xenbus_dev_fatal(sc->xb_dev, error,
+                 "writing %s/feature-persistent",
+                 node_path);
+        return;
+    }
+
     error = xs_printf(XST_NIL, node_path, "event-channel",
               "%u", irq_to_evtchn_port(sc->irq));
     if (error) {
@@ -1259,9 +1397,12 @@ blkfront_connect(struct xb_softc *sc)
 
     sc->xb_flags |= blkfront_check_feature(dev, "feature-barrier", XB_BARRIER);
     sc->xb_flags |= blkfront_check_feature(dev, "feature-flush-cache", XB_FLUSH);
+    sc->xb_flags |= blkfront_check_feature(dev, "feature-persistent",
+                                           XB_PERSISTENT);
 
     sc->indirect_descriptors =
-        new blkfront_indirect_descriptors(sc->xb_dev, sc->max_requests);
+        new blkfront_indirect_descriptors(sc->xb_dev, sc->max_requests,
+                                          (sc->xb_flags & XB_PERSISTENT) != 0);
 
     if (!sc->indirect_descriptors->empty()) {
         sc->max_request_segments =
@@ -1270,6 +1411,18 @@ blkfront_connect(struct xb_softc *sc)
         sc->max_request_size = XBF_SEGS_TO_SIZE(sc->max_request_segments);
     }
 
+    if (sc->xb_flags & XB_PERSISTENT) {
+        /*
+         * Cap the pool at a header block's worth of pages for every
+         * outstanding request; larger indirect requests borrow more
+         * from the pool and simply wait for completions when it runs
+         * dry (the pool grows lazily up to this limit).
+         */
+        sc->persistent_pool = new blkfront_persistent_pool(dev,
+            sc->max_requests * BLKIF_MAX_SEGMENTS_PER_HEADER_BLOCK);
+        device_printf(dev, "using persistent grants\n");
+    }
+
     blkfront_alloc_commands(sc);
 
     if (sc->xb_disk == NULL) {
@@ -1481,7 +1634,21 @@ xb_bio_command(struct xb_softc *sc)
         return (NULL);
     }
 
-    if (gnttab_alloc_grant_references(sc->max_request_segments,
+    if (sc->xb_flags & XB_PERSISTENT) {
+        cm->pers_nseg = howmany(bp->bio_bcount, PAGE_SIZE);
+        if (!sc->persistent_pool->get(cm->pers_pages, cm->pers_nseg)) {
+            /*
+             * Every persistent page is attached to an in-flight
+             * request; blkif_int() calls xb_startio() after each
+             * completion returns pages to the pool, so just retry
+             * then.
+             */
+            cm->pers_nseg = 0;
+            xb_requeue_bio(sc, bp);
+            xb_enqueue_free(cm);
+            return (NULL);
+        }
+    } else if (gnttab_alloc_grant_references(sc->max_request_segments,
         &cm->gref_head) != 0) {
         gnttab_request_free_callback(&sc->callback,
             blkif_restart_queue_callback, sc,
@@ -1539,11 +1706,52 @@ xb_bio_command(struct xb_softc *sc)
     return (cm);
 }
 
+static int
+blkif_queue_request_persistent(struct xb_softc *sc, struct xb_command *cm)
+{
+    auto data = static_cast<uint8_t *>(cm->data);
+    size_t left = cm->datalen;
+    u_int i;
+
+    KASSERT(cm->pers_nseg <= sc->max_request_segments,
+        ("too many segments for a persistent request"));
+
+    /*
+     * The pool pages are page aligned, so each segment starts at sector
+     * zero and covers as much of the page as the request needs - no
+     * bounce segments for unaligned data, and no grant operations at all.
+     */
+    for (i = 0; i < cm->pers_nseg; i++) {
+        size_t len = MIN(left, PAGE_SIZE);
+
+        if (cm->operation == BLKIF_OP_WRITE ||
+            cm->operation == BLKIF_OP_WRITE_BARRIER)
+            memcpy(cm->pers_pages[i].va, data, len);
+
+        cm->sg_refs[i] = cm->pers_pages[i].gref;
+        cm->pers_segs[i].ds_addr = 0;
+        cm->pers_segs[i].ds_len = len;
+        data += len;
+        left -= len;
+    }
+    cm->nseg = cm->pers_nseg;
+
+    blkif_put_to_ring(sc, cm, cm->pers_segs, cm->nseg,
+                      (blkif_vdev_t)(uintptr_t)sc->xb_disk, cm->sg_refs);
+
+    xb_enqueue_busy(cm);
+
+    return (0);
+}
+
 static int
 blkif_queue_request(struct xb_softc *sc, struct xb_command *cm)
 {
     int    error;
 
+    if (sc->xb_flags & XB_PERSISTENT)
+        return (blkif_queue_request_persistent(sc, cm));
+
     error = bus_dmamap_load(sc->xb_io_dmat, cm->map, cm->data, cm->datalen,
         blkif_queue_cb, cm, 0);
     if (error == EINPROGRESS) {
@@ -1791,15 +1999,17 @@ blkif_int(void *_xsc)
         xb_remove_busy(cm);
         i += blkif_completion(cm);
 
-        if (cm->operation == BLKIF_OP_READ)
-            op = BUS_DMASYNC_POSTREAD;
-        else if ((cm->operation == BLKIF_OP_WRITE) ||
-            (cm->operation == BLKIF_OP_WRITE_BARRIER))
-            op = BUS_DMASYNC_POSTWRITE;
-        else
-            op = 0;
-        bus_dmamap_sync(sc->xb_io_dmat, cm->map, op);
-        bus_dmamap_unload(sc->xb_io_dmat, cm->map);
+        if ((sc->xb_flags & XB_PERSISTENT) == 0) {
+            if (cm->operation == BLKIF_OP_READ)
+                op = BUS_DMASYNC_POSTREAD;
+            else if ((cm->operation == BLKIF_OP_WRITE) ||
+                (cm->operation == BLKIF_OP_WRITE_BARRIER))
+                op = BUS_DMASYNC_POSTWRITE;
+            else
+                op = 0;
+            bus_dmamap_sync(sc->xb_io_dmat, cm->map, op);
+            bus_dmamap_unload(sc->xb_io_dmat, cm->map);
+        }
 
         /*
          * If commands are completing then resources are probably
@@ -1881,6 +2091,14 @@ blkif_free(struct xb_softc *sc)
                 free(cm->sg_refs, M_XENBLOCKFRONT);
                 cm->sg_refs = NULL;
             }
+            if (cm->pers_pages != NULL) {
+                free(cm->pers_pages, M_XENBLOCKFRONT);
+                cm->pers_pages = NULL;
+            }
+            if (cm->pers_segs != NULL) {
+                free(cm->pers_segs, M_XENBLOCKFRONT);
+                cm->pers_segs = NULL;
+            }
 
             bus_dmamap_destroy(sc->xb_io_dmat, cm->map);
         }
@@ -1900,13 +2118,31 @@ blkif_free(struct xb_softc *sc)
     }
 
     delete sc->indirect_descriptors;
+    delete sc->persistent_pool;
+    sc->persistent_pool = NULL;
 }
 
 static int
 blkif_completion(struct xb_command *s)
 {
 //printf("%s: Req %p(%d)\n", __func__, s, s->nseg);
-    gnttab_end_foreign_access_references(s->nseg, s->sg_refs);
+    if (s->cm_sc->xb_flags & XB_PERSISTENT) {
+        if (s->operation == BLKIF_OP_READ) {
+            auto data = static_cast<uint8_t *>(s->data);
+            size_t left = s->datalen;
+
+            for (u_int i = 0; i < s->pers_nseg; i++) {
+                size_t len = MIN(left, PAGE_SIZE);
+
+                memcpy(data, s->pers_pages[i].va, len);
+                data += len;
+                left -= len;
+            }
+        }
+        s->cm_sc->persistent_pool->put(s->pers_pages, s->pers_nseg);
+        s->pers_nseg = 0;
+    } else
+        gnttab_end_foreign_access_references(s->nseg, s->sg_refs);
     if (s->ind_descr) {
         s->ind_descr->unmap();
         s->cm_sc->indirect_descriptors->put(s->ind_descr);
@@ -113,6 +113,18 @@ struct xlbd_major_info
 };
 
 class blkfront_indirect_descriptor;
+class blkfront_persistent_pool;
+
+/**
+ * A page from the persistent grant pool.  The grant stays valid from the
+ * moment the page enters the pool until the device is torn down; requests
+ * copy their data through these pages instead of granting their own.
+ */
+struct blkfront_persistent_page {
+    void        *va;
+    grant_ref_t    gref;
+    grant_ref_t    gref_list;
+};
 
 struct xb_command {
     TAILQ_ENTRY(xb_command)    cm_link;
@@ -130,6 +142,9 @@ struct xb_command {
     bus_dmamap_t        map;
     uint64_t        id;
     grant_ref_t        *sg_refs;
+    struct blkfront_persistent_page *pers_pages;
+    bus_dma_segment_t    *pers_segs;
+    u_int            pers_nseg;
     struct bio        *bp;
     grant_ref_t        gref_head;
     void            *data;
@@ -174,6 +189,7 @@ struct xb_softc {
 #define XB_READY        (1 << 2)    /* Is ready */
 #define XB_FROZEN       (1 << 3)    /* Waiting for resources */
 #define XB_FLUSH        (1 << 4)    /* backend supports flushes */
+#define XB_PERSISTENT   (1 << 5)    /* backend keeps our grants mapped */
 #define XB_WAIT_IDLE    (1 << 6) // no new work until outstanding work completes
 
     int            xb_qfrozen_cnt = 0;
@@ -187,6 +203,7 @@ struct xb_softc {
     grant_ref_t        ring_ref[XBF_MAX_RING_PAGES];
     blkif_front_ring_t    ring;
     blkfront_indirect_descriptors *indirect_descriptors;
+    blkfront_persistent_pool *persistent_pool = nullptr;
     unsigned int        irq;
     struct gnttab_free_callback    callback;
     TAILQ_HEAD(,xb_command)    cm_free;
@@ -1107,7 +1107,7 @@ xn_rxeof(struct netfront_info *np)
          * Break the mbuf chain first though.
          */
         while ((m = mbufq_dequeue(&rxq)) != NULL) {
-            ifp->if_ipackets++;
+            IF_STAT_INC(ifp, ifi_ipackets);
 
             /*
              * Do we really need to drop the rx lock?
@@ -1198,7 +1198,7 @@ xn_txeof(struct netfront_info *np)
              * mbuf of the chain.
              */
             if (!m->m_hdr.mh_next)
-                ifp->if_opackets++;
+                IF_STAT_INC(ifp, ifi_opackets);
             if (unlikely(gnttab_query_foreign_access(
                 np->grant_tx_ref[id]) != 0)) {
                 panic("%s: grant id %u still in use by the "
@@ -1756,8 +1756,9 @@ static void xn_getinfo(struct ifnet *ifp, struct if_data *out_data)
     netfront_info *sc = (netfront_info *)ifp->if_softc;
     net_device_stats *stats = &sc->stats;
 
-    // First - take the ifnet data
+    // First - take the ifnet data and the per-cpu counter shards
     memcpy(out_data, &ifp->if_data, sizeof(*out_data));
+    if_stat_sum(ifp, out_data);
 
     out_data->ifi_ipackets       += stats->rx_packets;
     out_data->ifi_ibytes         += stats->rx_bytes;
@@ -406,6 +406,7 @@ mb_ctor_mbuf(void *mem, int size, void *arg, int how)
 		m->M_dat.MH.MH_pkthdr.tso_segsz = 0;
 		m->M_dat.MH.MH_pkthdr.ether_vtag = 0;
 		m->M_dat.MH.MH_pkthdr.flowid = 0;
+		m->M_dat.MH.MH_pkthdr.trace_ctx = 0;
 		SLIST_INIT(&m->M_dat.MH.MH_pkthdr.tags);
 #ifdef MAC
 		/* If the label init fails, fail the alloc */
@@ -634,6 +635,7 @@ mb_ctor_pack(void *mem, int size, void *arg, int how)
 		m->M_dat.MH.MH_pkthdr.tso_segsz = 0;
 		m->M_dat.MH.MH_pkthdr.ether_vtag = 0;
 		m->M_dat.MH.MH_pkthdr.flowid = 0;
+		m->M_dat.MH.MH_pkthdr.trace_ctx = 0;
 		SLIST_INIT(&m->M_dat.MH.MH_pkthdr.tags);
 #ifdef MAC
 		/* If the label init fails, fail the alloc */
@@ -659,6 +661,7 @@ m_pkthdr_init(struct mbuf *m, int how)
 	m->M_dat.MH.MH_pkthdr.header = NULL;
 	m->M_dat.MH.MH_pkthdr.len = 0;
 	m->M_dat.MH.MH_pkthdr.flowid = 0;
+	m->M_dat.MH.MH_pkthdr.trace_ctx = 0;
 	m->M_dat.MH.MH_pkthdr.csum_flags = 0;
 	m->M_dat.MH.MH_pkthdr.csum_data = 0;
 	m->M_dat.MH.MH_pkthdr.tso_segsz = 0;
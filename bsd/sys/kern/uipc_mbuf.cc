@@ -140,7 +140,7 @@ m_getm2(struct mbuf *m, int len, int how, short type, int flags)
 	return (m);
 }
 
-static void
+void
 ztx_release(void *arg1, void *arg2)
 {
 	auto zm = reinterpret_cast<struct zmsghdr *>(arg1);
@@ -150,11 +150,21 @@ ztx_release(void *arg1, void *arg2)
 	auto remained = zh->zh_remained.fetch_sub(len);
         remained -= len;
 
-	if (remained == 0 && zm->zm_txfd) {
+	if (remained == 0) {
+		auto efd = zm->zm_txfd;
 		zm->zm_txhandle = nullptr;
+		/*
+		 * The completion hook may free zm itself (zcopy_sendfile()
+		 * hands its zmsghdr over to it), so zm must not be touched
+		 * past this point.
+		 */
+		if (zh->zh_done)
+			zh->zh_done();
 		delete zh;
-		uint64_t v = 1;
-		write(zm->zm_txfd, &v, sizeof(v));
+		if (efd) {
+			uint64_t v = 1;
+			write(efd, &v, sizeof(v));
+		}
 	}
 }
 
@@ -127,6 +127,7 @@
 #include <bsd/sys/net/vnet.h>
 
 #include <osv/zcopy.hh>
+#include <osv/net_busy_poll.hh>
 
 #define uipc_d(...) tprintf_d("uipc_socket", __VA_ARGS__)
 
@@ -390,6 +391,9 @@ sonewconn(struct socket *head, int connstatus)
 	so->so_linger = head->so_linger;
 	so->so_state = head->so_state | SS_NOFDREF;
 	so->so_fibnum = head->so_fibnum;
+	/* like so_options: a preference set on the listener applies to the
+	 * connections it accepts */
+	so->so_incoming_cpu = head->so_incoming_cpu;
 	so->so_proto = head->so_proto;
 	VNET_SO_ASSERT(head);
 	if (soreserve_internal(so, head->so_snd.sb_hiwat, head->so_rcv.sb_hiwat) ||
@@ -432,10 +436,13 @@ sonewconn(struct socket *head, int connstatus)
 		so->so_qstate |= SQ_INCOMP;
 		head->so_incqlen++;
 	}
+	if (connstatus) {
+		/* Wake one acceptor; wait morphing hands it accept_mtx. */
+		head->so_acceptq_wq.wake_one(ACCEPT_MTX_REF());
+	}
 	ACCEPT_UNLOCK();
 	if (connstatus) {
 		sorwakeup(head);
-		wakeup_one(&head->so_timeo);
 	}
 	return (so);
 }
@@ -2396,9 +2403,14 @@ soreceive_dgram(struct socket *so, struct bsd_sockaddr **psa, struct uio *uio,
 	    ("soreceive_dgram: P_CONNREQUIRED"));
 
 	/*
-	 * Loop blocking while waiting for a datagram.
+	 * Loop blocking while waiting for a datagram.  Datagrams may be
+	 * sitting in the socket's net channel rather than in the receive
+	 * buffer, so pick those up first (sbwait() does the same after
+	 * each wakeup).
 	 */
 	SOCK_LOCK(so);
+	if (so->so_nc)
+		so->so_nc->process_queue();
 	while ((m = so->so_rcv.sb_mb) == NULL) {
 		KASSERT(so->so_rcv.sb_cc == 0,
 		    ("soreceive_dgram: sb_mb NULL but sb_cc %u",
@@ -2677,6 +2689,7 @@ sosetopt(struct socket *so, struct sockopt *sopt)
 	struct	timeval tv;
 	u_long  val;
 	uint32_t val32;
+	uint64_t val64;
 
 	CURVNET_SET(so->so_vnet);
 	error = 0;
@@ -2764,6 +2777,42 @@ sosetopt(struct socket *so, struct sockopt *sopt)
 			so->so_user_cookie = val32;
 			break;
 
+		case SO_BUSY_POLL:
+			error = sooptcopyin(sopt, &optval, sizeof optval,
+					    sizeof optval);
+			if (error)
+				goto bad;
+			if (optval < 0) {
+				error = EINVAL;
+				goto bad;
+			}
+			so->so_busy_poll = optval;
+			break;
+
+		case SO_INCOMING_CPU:
+			error = sooptcopyin(sopt, &optval, sizeof optval,
+					    sizeof optval);
+			if (error)
+				goto bad;
+			if (optval < -1) {
+				error = EINVAL;
+				goto bad;
+			}
+			so->so_incoming_cpu = optval;
+			if (so->so_nc)
+				so->so_nc->set_preferred_cpu(optval);
+			break;
+
+		case SO_TRACE_CONTEXT:
+			error = sooptcopyin(sopt, &val64, sizeof val64,
+					    sizeof val64);
+			if (error)
+				goto bad;
+			so->so_trace_ctx = val64;
+			if (so->so_nc)
+				so->so_nc->set_trace_ctx(val64);
+			break;
+
 		case SO_SNDBUF:
 		case SO_RCVBUF:
 		case SO_SNDLOWAT:
@@ -3006,6 +3055,23 @@ integer:
 			optval = so->so_incqlen;
 			goto integer;
 
+		case SO_BUSY_POLL:
+			optval = so->so_busy_poll;
+			goto integer;
+
+		case SO_INCOMING_CPU:
+			/* Prefer what the rx path actually reports; fall
+			 * back to the value the application set. */
+			optval = so->so_nc ? so->so_nc->last_rx_cpu() : -1;
+			if (optval < 0)
+				optval = so->so_incoming_cpu;
+			goto integer;
+
+		case SO_TRACE_CONTEXT:
+			error = sooptcopyout(sopt, &so->so_trace_ctx,
+			    sizeof(so->so_trace_ctx));
+			break;
+
 		default:
 			error = ENOPROTOOPT;
 			break;
@@ -3157,6 +3223,25 @@ sopoll(struct socket *so, int events, struct ucred *active_cred,
 	    td));
 }
 
+/*
+ * Return the SO_BUSY_POLL budget of the socket behind the given file, in
+ * microseconds, or 0 if this is not a socket or busy polling is off.
+ * Used by poll()/epoll_wait() to decide whether to spin on the NIC rx
+ * rings before blocking (see core/net_busy_poll.cc).
+ */
+int
+so_busy_poll_budget(struct file* fp)
+{
+	struct socket *so;
+
+	if (fp == NULL || fp->f_type != DTYPE_SOCKET)
+		return (0);
+	so = (struct socket *)fp->f_data;
+	if (so == NULL)
+		return (0);
+	return (so->so_busy_poll);
+}
+
 int
 sopoll_generic(struct socket *so, int events, struct ucred *active_cred,
     struct thread *td)
@@ -3425,9 +3510,12 @@ restart:
 			TAILQ_INSERT_TAIL(&head->so_comp, so, so_list);
 			head->so_qlen++;
 			so->so_qstate |= SQ_COMP;
+			// wake exactly one acceptor (with wait morphing onto
+			// accept_mtx), rather than a wakeup_one() through the
+			// global synch channel table
+			head->so_acceptq_wq.wake_one(ACCEPT_MTX_REF());
 			ACCEPT_UNLOCK();
 			sorwakeup(head);
-			wakeup_one(&head->so_timeo);
 		} else {
 			ACCEPT_UNLOCK();
 			soupcall_set(so, SO_RCV,
@@ -3505,6 +3593,11 @@ soisdisconnected(struct socket *so)
 	}
 	SOCK_UNLOCK(so);
 	wakeup(&so->so_timeo);
+	// If this was a listening socket, let any acceptors notice so_error
+	// or the drained queues.
+	ACCEPT_LOCK();
+	so->so_acceptq_wq.wake_all(ACCEPT_MTX_REF());
+	ACCEPT_UNLOCK();
 
 	if (do_release) {
 		ACCEPT_LOCK();
@@ -62,6 +62,7 @@
 #include <osv/pagealloc.hh>
 #include <osv/zcopy.hh>
 #include <sys/eventfd.h>
+#include <sys/mman.h>
 
 using namespace std;
 
@@ -91,7 +92,7 @@ SYSCTL_INT(_kern_ipc, OID_AUTO, nsfbufsused, CTLFLAG_RD, &nsfbufsused, 0,
  * Convert a user file descriptor to a kernel file entry.
  * A reference on the file entry is held upon returning.
  */
-static int
+int
 getsock_cap(int fd, struct file **fpp, u_int *fflagp)
 {
     struct file *fp;
@@ -240,11 +241,7 @@ kern_accept(int s, struct bsd_sockaddr *name,
 			head->so_error = ECONNABORTED;
 			break;
 		}
-		error = msleep(&head->so_timeo, &accept_mtx, 0, "accept", 0);
-		if (error) {
-			ACCEPT_UNLOCK();
-			goto noconnection;
-		}
+		head->so_acceptq_wq.wait(ACCEPT_MTX_REF());
 	}
 	if (head->so_error) {
 		error = head->so_error;
@@ -473,26 +470,24 @@ bad:
 	return (error);
 }
 
+/*
+ * The guts of kern_sendit(), operating on an already-pinned socket.
+ * sendmmsg() uses this directly so a whole batch of datagrams pays for a
+ * single fget()/fdrop() pair.
+ */
 int
-kern_sendit(int s,
+kern_sendit_so(struct socket *so,
             struct msghdr *mp,
             int flags,
             struct mbuf *control,
             ssize_t *bytes)
 {
-	struct file *fp;
 	struct uio auio = {};
 	struct iovec *iov;
-	struct socket *so;
 	struct bsd_sockaddr *from = 0;
 	int i, error;
 	ssize_t len;
 
-	error = getsock_cap(s, &fp, NULL);
-	if (error)
-		return (error);
-	so = (struct socket *)file_data(fp);
-
 	// Create a local copy of the user's iovec - sosend() is going to change it!
 	assert(mp->msg_iovlen <= UIO_MAXIOV);
 	struct iovec uio_iov[mp->msg_iovlen];
@@ -506,8 +501,7 @@ kern_sendit(int s,
 	iov = mp->msg_iov;
 	for (i = 0; i < mp->msg_iovlen; i++, iov++) {
 		if ((auio.uio_resid += iov->iov_len) < 0) {
-			error = EINVAL;
-			goto bad;
+			return (EINVAL);
 		}
 	}
 	len = auio.uio_resid;
@@ -530,7 +524,25 @@ kern_sendit(int s,
 	}
 	if (error == 0)
 	    *bytes = len - auio.uio_resid;
-bad:
+	return (error);
+}
+
+int
+kern_sendit(int s,
+            struct msghdr *mp,
+            int flags,
+            struct mbuf *control,
+            ssize_t *bytes)
+{
+	struct file *fp;
+	struct socket *so;
+	int error;
+
+	error = getsock_cap(s, &fp, NULL);
+	if (error)
+		return (error);
+	so = (struct socket *)file_data(fp);
+	error = kern_sendit_so(so, mp, flags, control, bytes);
 	fdrop(fp);
 	return (error);
 }
@@ -564,8 +576,14 @@ sys_sendmsg(int s, struct msghdr* msg, int flags, ssize_t* bytes)
 	return (error);
 }
 
+/*
+ * The guts of kern_recvit(), operating on an already-pinned socket.
+ * recvmmsg() uses this directly so a whole batch of datagrams pays for a
+ * single fget()/fdrop() pair.
+ */
 int
-kern_recvit(int s, struct msghdr *mp, struct mbuf **controlp, ssize_t* bytes)
+kern_recvit_so(struct socket *so, struct msghdr *mp, struct mbuf **controlp,
+    ssize_t* bytes)
 {
 	struct uio auio;
 	struct iovec *iov;
@@ -574,18 +592,11 @@ kern_recvit(int s, struct msghdr *mp, struct mbuf **controlp, ssize_t* bytes)
 	int error;
 	struct mbuf *m, *control = 0;
 	caddr_t ctlbuf;
-	struct file *fp;
-	struct socket *so;
 	struct bsd_sockaddr *fromsa = 0;
 
 	if (controlp != NULL)
 		*controlp = NULL;
 
-	error = getsock_cap(s, &fp, NULL);
-	if (error)
-		return (error);
-	so = (socket*)file_data(fp);
-
 	// Create a local copy of the user's iovec - sorecieve() is going to change it!
 	assert(mp->msg_iovlen <= UIO_MAXIOV);
 	struct iovec uio_iov[mp->msg_iovlen];
@@ -599,7 +610,6 @@ kern_recvit(int s, struct msghdr *mp, struct mbuf **controlp, ssize_t* bytes)
 	iov = mp->msg_iov;
 	for (i = 0; i < mp->msg_iovlen; i++, iov++) {
 		if ((auio.uio_resid += iov->iov_len) < 0) {
-			fdrop(fp);
 			return (EINVAL);
 		}
 	}
@@ -653,7 +663,6 @@ kern_recvit(int s, struct msghdr *mp, struct mbuf **controlp, ssize_t* bytes)
 		mp->msg_controllen = ctlbuf - (caddr_t)mp->msg_control;
 	}
 out:
-	fdrop(fp);
 	if (fromsa)
 		free(fromsa);
 
@@ -665,6 +674,22 @@ out:
 	return (error);
 }
 
+int
+kern_recvit(int s, struct msghdr *mp, struct mbuf **controlp, ssize_t* bytes)
+{
+	struct file *fp;
+	struct socket *so;
+	int error;
+
+	error = getsock_cap(s, &fp, NULL);
+	if (error)
+		return (error);
+	so = (socket*)file_data(fp);
+	error = kern_recvit_so(so, mp, controlp, bytes);
+	fdrop(fp);
+	return (error);
+}
+
 static int
 recvit(int s, struct msghdr *mp, void *namelenp, ssize_t* bytes)
 {
@@ -1083,6 +1108,87 @@ zcopy_txclose(struct zmsghdr *zm)
 	close(zm->zm_txfd);
 }
 
+/*
+ * Zero-copy transmit of a mapped file region, for sendfile(). The pages
+ * backing [base, base + map_len) are the pagecache (or ARC) pages the file
+ * mapping populated, so queueing them as external mbufs lets the NIC
+ * scatter-gather straight out of the cache with no copy. The mapping is
+ * what keeps those pages around, so ownership of it transfers to the stack
+ * here unconditionally: once every queued byte has been released (last ACK
+ * for TCP), the completion hook unmaps it. The caller must not touch the
+ * mapping again, on success or failure. Note that the pagecache does not
+ * pin pages against ARC eviction, so an unshare under memory pressure can
+ * still pull a page out from under an in-flight mbuf - the same exposure
+ * zcopy_tx() has always had on a file-backed mapping.
+ *
+ * Unlike zcopy_tx() this does not signal an eventfd - sendfile() callers
+ * expect plain write() semantics, so we return as soon as the data is
+ * queued (blocking for socket buffer space only if the socket blocks) and
+ * let the release run asynchronously. Returns the number of bytes queued,
+ * or -1 with errno set; EOPNOTSUPP means the socket cannot take this path
+ * and the caller should fall back to a copying write.
+ */
+ssize_t
+zcopy_sendfile(int s, void *base, size_t map_len, void *data, size_t count)
+{
+	struct file *fp;
+	struct socket *so;
+	struct uio auio = {};
+	struct iovec iov;
+	ssize_t bytes;
+	int error;
+
+	error = getsock_cap(s, &fp, NULL);
+	if (error) {
+		errno = error;
+		return (-1);
+	}
+	so = (struct socket *)file_data(fp);
+	if (so->so_type != SOCK_STREAM) {
+		fdrop(fp);
+		munmap(base, map_len);
+		errno = EOPNOTSUPP;
+		return (-1);
+	}
+
+	auto zm = new zmsghdr();
+	auto zh = new ztx_handle();
+	zh->zh_remained = count;
+	zh->zh_done = [base, map_len, zm] {
+		munmap(base, map_len);
+		delete zm;
+	};
+	zm->zm_txhandle = zh;
+	zm->zm_txfd = 0;
+
+	iov.iov_base = data;
+	iov.iov_len = count;
+	auio.uio_iov = &iov;
+	auio.uio_iovcnt = 1;
+	auio.uio_rw = UIO_WRITE;
+	auio.uio_offset = 0;
+	auio.uio_resid = count;
+
+	error = zsend(so, &auio, zm, 0);
+	bytes = count - auio.uio_resid;
+	if (error && bytes > 0 && (error == ERESTART ||
+	    error == EINTR || error == EWOULDBLOCK))
+		error = 0;
+	/*
+	 * The stack never saw the unsent tail, so release it ourselves -
+	 * this is also what eventually fires the completion hook if
+	 * nothing was queued at all.
+	 */
+	if (auio.uio_resid > 0)
+		ztx_release(zm, reinterpret_cast<void *>(auio.uio_resid));
+	fdrop(fp);
+	if (error) {
+		errno = error;
+		return (-1);
+	}
+	return (bytes);
+}
+
 ssize_t
 zcopy_rx(int s, struct zmsghdr *zm)
 {
@@ -1090,9 +1196,18 @@ zcopy_rx(int s, struct zmsghdr *zm)
 	struct file *fp;
 	struct socket *so;
 	struct bsd_sockaddr *fromsa = 0;
-	int flags = MSG_DONTWAIT;
+	int flags = zm->zm_msg.msg_flags;
 	ssize_t bytes;
 
+	/*
+	 * Only allow flags which are safe for detached mbufs. In particular
+	 * MSG_PEEK must be refused: zreceive() would hand out pointers to
+	 * data still queued in the socket buffer, and a later zcopy_rxgc()
+	 * would free mbufs the socket still owns.
+	 */
+	if (flags & ~(MSG_DONTWAIT | MSG_WAITALL))
+		return (EINVAL);
+
 	error = getsock_cap(s, &fp, NULL);
 	if (error)
 		return (error);
@@ -1108,6 +1223,7 @@ zcopy_rx(int s, struct zmsghdr *zm)
 		errno = error;
 		return (-1);
 	}
+	zm->zm_msg.msg_flags = flags;
 
 	return (bytes);
 }
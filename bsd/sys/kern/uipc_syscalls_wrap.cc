@@ -3,7 +3,9 @@
 #include <errno.h>
 #include <assert.h>
 
+#include <bsd/sys/sys/param.h>
 #include <bsd/uipc_syscalls.h>
+#include <bsd/sys/netinet/in.h>
 #include <osv/debug.h>
 #include <osv/export.h>
 #include "libc/af_local.h"
@@ -12,6 +14,30 @@
 
 #define sock_d(...)		tprintf_d("socket-api", __VA_ARGS__);
 
+/* Defined in core/dhcp.cc */
+extern "C" void dhcp_wait_for_ip(void);
+
+/*
+ * Boot no longer waits for the initial DHCP exchange to finish; instead the
+ * first socket operation that actually needs the leased address blocks here
+ * until it has been assigned. Wildcard and loopback addresses work without a
+ * lease, and a statically configured (or absent) network makes this a no-op.
+ */
+static void dhcp_gate(const struct bsd_sockaddr *addr)
+{
+	const struct bsd_sockaddr_in *sin;
+
+	if (addr == NULL || addr->sa_family != AF_INET)
+		return;
+
+	sin = (const struct bsd_sockaddr_in *)addr;
+	if (sin->sin_addr.s_addr == 0 ||
+	    (ntohl(sin->sin_addr.s_addr) >> 24) == IN_LOOPBACKNET)
+		return;
+
+	dhcp_wait_for_ip();
+}
+
 extern "C" OSV_LIBC_API
 int socketpair(int domain, int type, int protocol, int sv[2])
 {
@@ -108,6 +134,7 @@ int bind(int fd, const struct bsd_sockaddr *addr, socklen_t len)
 
 	sock_d("bind(fd=%d, ...)", fd);
 
+	dhcp_gate(addr);
 	error = linux_bind(fd, (void *)addr, len);
 	if (error) {
 		sock_d("bind() failed, errno=%d", error);
@@ -125,6 +152,7 @@ int connect(int fd, const struct bsd_sockaddr *addr, socklen_t len)
 
 	sock_d("connect(fd=%d, ...)", fd);
 
+	dhcp_gate(addr);
 	error = linux_connect(fd, (void *)addr, len);
 	if (error) {
 		sock_d("connect() failed, errno=%d", error);
@@ -217,6 +245,7 @@ ssize_t sendto(int fd, const void *buf, size_t len, int flags,
 
 	sock_d("sendto(fd=%d, buf=..., len=%d, flags=0x%x, ...", fd, len, flags);
 
+	dhcp_gate(addr);
 	error = linux_sendto(fd, (caddr_t)buf, len, flags, (caddr_t)addr,
 			   alen, &bytes);
 	if (error) {
@@ -254,6 +283,8 @@ ssize_t sendmsg(int fd, const struct msghdr *msg, int flags)
 
 	sock_d("sendmsg(fd=%d, msg=..., flags=0x%x)", fd, flags)
 
+	if (msg != NULL)
+		dhcp_gate((const struct bsd_sockaddr *)msg->msg_name);
 	error = linux_sendmsg(fd, (struct msghdr *)msg, flags, &bytes);
 	if (error) {
 		sock_d("sendmsg() failed, errno=%d", error);
@@ -264,6 +295,46 @@ ssize_t sendmsg(int fd, const struct msghdr *msg, int flags)
 	return bytes;
 }
 
+extern "C" OSV_LIBC_API
+int sendmmsg(int fd, struct mmsghdr *msgvec, unsigned int vlen,
+    unsigned int flags)
+{
+	unsigned int sent;
+	int error;
+
+	sock_d("sendmmsg(fd=%d, msgvec=..., vlen=%u, flags=0x%x)", fd, vlen,
+		flags)
+
+	error = linux_sendmmsg(fd, msgvec, vlen, flags, &sent);
+	if (error) {
+		sock_d("sendmmsg() failed, errno=%d", error);
+		errno = error;
+		return -1;
+	}
+
+	return sent;
+}
+
+extern "C" OSV_LIBC_API
+int recvmmsg(int fd, struct mmsghdr *msgvec, unsigned int vlen,
+    unsigned int flags, struct timespec *timeout)
+{
+	unsigned int received;
+	int error;
+
+	sock_d("recvmmsg(fd=%d, msgvec=..., vlen=%u, flags=0x%x)", fd, vlen,
+		flags)
+
+	error = linux_recvmmsg(fd, msgvec, vlen, flags, timeout, &received);
+	if (error) {
+		sock_d("recvmmsg() failed, errno=%d", error);
+		errno = error;
+		return -1;
+	}
+
+	return received;
+}
+
 extern "C" OSV_LIBC_API
 int getsockopt(int fd, int level, int optname, void *__restrict optval,
 		socklen_t *__restrict optlen)
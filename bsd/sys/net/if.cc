@@ -34,6 +34,7 @@
 #include <stddef.h>
 
 #include <osv/mutex.h>
+#include <osv/per-cpu-counter.hh>
 
 #include <osv/ioctl.h>
 #include <bsd/porting/netport.h>
@@ -355,6 +356,31 @@ if_grow(void)
 	V_ifindex_table = e;
 }
 
+/*
+ * Per-cpu shards for the software-maintained if_data counters, updated
+ * through IF_STAT_ADD()/IF_STAT_INC() so per-packet accounting doesn't
+ * bounce a shared cacheline between the cpus driving the interface.
+ */
+typedef osv::per_cpu_stats<struct if_data> if_stats_shards;
+
+static inline if_stats_shards *
+if_shards(struct ifnet *ifp)
+{
+	return static_cast<if_stats_shards *>(ifp->if_percpu_stats);
+}
+
+void
+if_stat_add(struct ifnet *ifp, int statnum, u_long val)
+{
+	if_shards(ifp)->add(statnum, val);
+}
+
+void
+if_stat_sum(struct ifnet *ifp, struct if_data *out_info)
+{
+	if_shards(ifp)->sum(out_info);
+}
+
 /*
  * Allocate a struct ifnet and an index for an interface.  A layer 2
  * common structure will also be allocated if an allocation routine is
@@ -388,6 +414,7 @@ if_alloc(u_char type)
 	}
 
 	ifp->if_afdata_initialized = 0;
+	ifp->if_percpu_stats = new if_stats_shards;
 	TAILQ_INIT(&ifp->if_addrhead);
 	TAILQ_INIT(&ifp->if_prefixhead);
 	TAILQ_INIT(&ifp->if_multiaddrs);
@@ -418,6 +445,7 @@ if_free_internal(struct ifnet *ifp)
 	if (ifp->if_description != NULL)
 		free(ifp->if_description);
 	ifq_delete(&ifp->if_snd);
+	delete if_shards(ifp);
 	delete ifp;
 }
 
@@ -520,7 +548,8 @@ if_attach(struct ifnet *ifp)
 }
 
 /**
- * Default implementation: simply take the current if_data from the ifnet
+ * Default implementation: take the current if_data from the ifnet and
+ * fold in the per-cpu counter shards.
  *
  * @param ifp interface handle
  * @param out_info output buffer
@@ -529,6 +558,7 @@ static void
 if_getinfo(struct ifnet *ifp, struct if_data *out_info)
 {
 	memcpy(out_info, &ifp->if_data, sizeof(*out_info));
+	if_stat_sum(ifp, out_info);
 }
 
 static void
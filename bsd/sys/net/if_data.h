@@ -62,6 +62,8 @@ struct if_data {
                                 * be sent due to a lack of free space
                                 * on a HW ring
                                 */
+    u_long  ifi_iring_hwm;  /* Rx HW ring occupancy high-water mark */
+    u_long  ifi_oring_hwm;  /* Tx HW ring occupancy high-water mark */
     wakeup_stats ifi_iwakeup_stats; /* Rx BH wakeup statistics */
     wakeup_stats ifi_owakeup_stats; /* Tx BH wakeup statistics */
 };
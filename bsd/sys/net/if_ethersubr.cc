@@ -571,7 +571,7 @@ ether_preprocess_packet(struct ifnet *ifp, struct mbuf *m, uint16_t& ether_type)
 			m->m_hdr.mh_flags |= M_BCAST;
 		else
 			m->m_hdr.mh_flags |= M_MCAST;
-		ifp->if_imcasts++;
+		IF_STAT_INC(ifp, ifi_imcasts);
 	}
 
 #if 0
@@ -592,7 +592,7 @@ ether_preprocess_packet(struct ifnet *ifp, struct mbuf *m, uint16_t& ether_type)
 	}
 
 	if (!(ifp->if_capenable & IFCAP_HWSTATS))
-		ifp->if_ibytes += m->M_dat.MH.MH_pkthdr.len;
+		IF_STAT_ADD(ifp, ifi_ibytes, m->M_dat.MH.MH_pkthdr.len);
 
 	/* Allow monitor mode to claim this frame, after stats are updated. */
 	if (ifp->if_flags & IFF_MONITOR) {
@@ -67,7 +67,13 @@
 #elif defined(LARGE_LOMTU)
 #define LOMTU	131072
 #else
-#define LOMTU	16384
+/*
+ * The largest IPv4 packet. Loopback traffic never touches real hardware,
+ * so there is no reason to chop it into wire-sized pieces: with a maximal
+ * MTU a bulk TCP connection over loopback moves ~64k of data per segment
+ * and pays the per-packet protocol cost once instead of four times.
+ */
+#define LOMTU	65535
 #endif
 
 #define	LO_CSUM_FEATURES	(CSUM_IP | CSUM_TCP | CSUM_UDP | CSUM_SCTP)
@@ -110,9 +116,16 @@ lo_clone_create(struct if_clone *ifc, int unit, caddr_t params)
 	ifp->if_ioctl = loioctl;
 	ifp->if_output = looutput;
 	ifp->if_snd.ifq_maxlen = ifqmaxlen;
+	/*
+	 * Claim TSO on top of full checksum offload: nothing ever segments
+	 * a loopback packet, so TCP may hand us 64k mbuf chains (see the
+	 * IP_MAXPACKET clamp in tcp_output()) which are delivered to the
+	 * receiver whole. This matters when a route caps the path MTU below
+	 * if_mtu - the TSO aggregation path still avoids per-MTU segments.
+	 */
 	ifp->if_capabilities = ifp->if_capenable =
-	    IFCAP_HWCSUM | IFCAP_HWCSUM_IPV6;
-	ifp->if_hwassist = LO_CSUM_FEATURES | LO_CSUM_FEATURES6;
+	    IFCAP_HWCSUM | IFCAP_HWCSUM_IPV6 | IFCAP_TSO4 | IFCAP_TSO6;
+	ifp->if_hwassist = LO_CSUM_FEATURES | LO_CSUM_FEATURES6 | CSUM_TSO;
 	if_attach(ifp);
 	if (V_loif == NULL)
 		V_loif = ifp;
@@ -146,8 +159,8 @@ looutput(struct ifnet *ifp, struct mbuf *m, struct bsd_sockaddr *dst,
 		        rt->rt_flags & RTF_HOST ? EHOSTUNREACH : ENETUNREACH);
 	}
 
-	ifp->if_opackets++;
-	ifp->if_obytes += m->M_dat.MH.MH_pkthdr.len;
+	IF_STAT_INC(ifp, ifi_opackets);
+	IF_STAT_ADD(ifp, ifi_obytes, m->M_dat.MH.MH_pkthdr.len);
 
 	/* BPF writes need to be handled specially. */
 	if (dst->sa_family == AF_UNSPEC) {
@@ -155,6 +168,14 @@ looutput(struct ifnet *ifp, struct mbuf *m, struct bsd_sockaddr *dst,
 		dst->sa_family = af;
 	}
 
+	/*
+	 * No segmentation happens on loopback - the chain is handed to the
+	 * receiver as-is - so drop the TSO request before the input path
+	 * sees it. (The RXCSUM rewrite below also clears it, but that can
+	 * be switched off with ifconfig.)
+	 */
+	m->M_dat.MH.MH_pkthdr.csum_flags &= ~CSUM_TSO;
+
 #if 1	/* XXX */
 	switch (dst->sa_family) {
 	case AF_INET:
@@ -286,8 +307,8 @@ if_simloop(struct ifnet *ifp, struct mbuf *m, int af, int hlen)
 		m_freem(m);
 		return (EAFNOSUPPORT);
 	}
-	ifp->if_ipackets++;
-	ifp->if_ibytes += m->M_dat.MH.MH_pkthdr.len;
+	IF_STAT_INC(ifp, ifi_ipackets);
+	IF_STAT_ADD(ifp, ifi_ibytes, m->M_dat.MH.MH_pkthdr.len);
 	netisr_queue(isr, m);	/* mbuf is free'd on failure. */
 	return (0);
 }
@@ -177,6 +177,20 @@ struct ifnet {
 	 * get the interface info and statistics including the one gathered by HW
 	 */
 	void (*if_getinfo)(struct ifnet *, struct if_data *);
+	/*
+	 * per-cpu shards for the software-maintained if_data counters -
+	 * see IF_STAT_ADD() below. Opaque here to keep osv headers out of
+	 * this one; allocated in if_alloc() and summed on top of if_data
+	 * by the default if_getinfo().
+	 */
+	void	*if_percpu_stats;
+	/*
+	 * Program the NIC's receive flow steering so the given flow is
+	 * delivered on the given cpu (-1 clears the rule). Left null by
+	 * drivers that cannot steer flows - e.g. single-queue virtio-net.
+	 * Consumed through SO_INCOMING_CPU, see net_channel::set_preferred_cpu().
+	 */
+	int (*if_steer_flow)(struct ifnet *, const ipv4_tcp_conn_id &, int cpu);
 	classifier if_classifier;
 
 	struct	vnet *if_home_vnet;	/* where this ifnet originates from */
@@ -217,6 +231,8 @@ struct ifnet {
 
 	void add_net_channel(net_channel* nc, ipv4_tcp_conn_id id) { if_classifier.add(id, nc); }
 	void del_net_channel(ipv4_tcp_conn_id id) { if_classifier.remove(id); }
+	void add_udp_net_channel(net_channel* nc, ipv4_tcp_conn_id id) { if_classifier.add_udp(id, nc); }
+	void del_udp_net_channel(ipv4_tcp_conn_id id) { if_classifier.remove_udp(id); }
 };
 
 typedef void if_init_f_t(void *);
@@ -247,6 +263,22 @@ typedef void if_init_f_t(void *);
 #define	if_noproto	if_data.ifi_noproto
 #define	if_lastchange	if_data.ifi_lastchange
 
+/*
+ * Per-packet counter updates run on every cpu receiving or transmitting
+ * for the interface, so bumping ifp->if_data fields directly bounces
+ * their cacheline between cpus.  Hot paths update the interface's
+ * per-cpu stats shards through these macros instead (using the same
+ * treat-the-struct-as-an-array-of-u_long convention as KMOD_TCPSTAT_INC);
+ * if_getinfo() folds the shards into the reported statistics.  Rarely
+ * updated counters (errors and the like) may keep writing if_data
+ * directly - both are included in the sum.
+ */
+void	if_stat_add(struct ifnet *ifp, int statnum, u_long val);
+void	if_stat_sum(struct ifnet *ifp, struct if_data *out_info);
+#define	IF_STAT_ADD(ifp, name, val)					\
+	if_stat_add(ifp, offsetof(struct if_data, name) / sizeof(u_long), (val))
+#define	IF_STAT_INC(ifp, name)	IF_STAT_ADD(ifp, name, 1)
+
 /* for compatibility with other BSDs */
 #define	if_addrlist	if_addrhead
 #define	if_list		if_link
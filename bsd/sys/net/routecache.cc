@@ -7,6 +7,9 @@
 
 #include "routecache.hh"
 #include "osv/prio.hh"
+#include <osv/percpu.hh>
+
+#include <atomic>
 
 osv::rcu_ptr<route_cache::routemap, osv::rcu_deleter<route_cache::routemap>> route_cache::cache
     __attribute__((init_priority((int)init_prio::routecache)))
@@ -14,3 +17,77 @@ osv::rcu_ptr<route_cache::routemap, osv::rcu_deleter<route_cache::routemap>> rou
 
 mutex route_cache::cache_mutex
     __attribute__((init_priority((int)init_prio::routecache)));
+
+//
+// The per-CPU front cache (see route_cache::front_lookup() declaration in
+// routecache.hh). Each CPU's array lives on the heap and is only ever
+// touched by that CPU with preemption disabled, so no locking or memory
+// ordering is needed on the entries themselves - only the generation is
+// shared, and a reader racing with an invalidation either sees the old
+// generation together with a consistently old entry, or the new
+// generation and a miss.
+//
+struct route_front_entry {
+    u64 generation = 0; // 0 never matches the generation below: stale
+    u32 address = 0;
+    nonlockable_rtentry rte;
+};
+
+static constexpr unsigned route_front_size = 64; // per cpu, power of two
+
+struct route_front_cache {
+    route_front_entry entries[route_front_size];
+};
+
+PERCPU(route_front_cache*, percpu_route_front);
+
+static sched::cpu::notifier route_front_notifier([] {
+    *percpu_route_front = new route_front_cache;
+});
+
+static std::atomic<u64> route_front_gen(1);
+
+static inline route_front_entry* route_front_slot(u32 address)
+{
+    // s_addr is in network order: the low bytes hold the network part,
+    // so fold the host part in before masking.
+    auto h = address ^ (address >> 16) ^ (address >> 24);
+    return &(*percpu_route_front)->entries[h & (route_front_size - 1)];
+}
+
+bool route_cache::front_lookup(u32 address, struct rtentry *ret)
+{
+    SCOPE_LOCK(preempt_lock);
+    if (!(*percpu_route_front)) {
+        return false;
+    }
+    auto e = route_front_slot(address);
+    if (e->generation == route_front_gen.load(std::memory_order_relaxed) &&
+        e->address == address) {
+        memcpy(ret, &e->rte, sizeof(*ret));
+        return true;
+    }
+    return false;
+}
+
+void route_cache::front_fill(u32 address, u64 gen, const struct rtentry *rte)
+{
+    SCOPE_LOCK(preempt_lock);
+    if (!(*percpu_route_front)) {
+        return;
+    }
+    auto e = route_front_slot(address);
+    memcpy(&e->rte, rte, sizeof(e->rte));
+    e->address = address;
+    e->generation = gen;
+}
+
+u64 route_cache::front_generation()
+{
+    return route_front_gen.load(std::memory_order_relaxed);
+}
+
+void route_cache::front_invalidate()
+{
+    route_front_gen.fetch_add(1, std::memory_order_relaxed);
+}
@@ -1067,7 +1067,7 @@ rt_ifmsg(struct ifnet *ifp)
 	ifm = mtod(m, struct if_msghdr *);
 	ifm->ifm_index = ifp->if_index;
 	ifm->ifm_flags = ifp->if_flags | ifp->if_drv_flags;
-	ifm->ifm_data = ifp->if_data;
+	ifp->if_getinfo(ifp, &ifm->ifm_data);
 	ifm->ifm_addrs = 0;
 	rt_dispatch(m, AF_UNSPEC);
 }
@@ -1390,7 +1390,7 @@ sysctl_iflist_ifml(struct ifnet *ifp, struct rt_addrinfo *info,
 	ifm->ifm_len = sizeof(*ifm);
 	ifm->ifm_data_off = offsetof(struct if_msghdrl, ifm_data);
 
-	ifm->ifm_data = ifp->if_data;
+	ifp->if_getinfo(ifp, &ifm->ifm_data);
 
 	return (SYSCTL_OUT(w->w_req, (caddr_t)ifm, len));
 }
@@ -1421,7 +1421,7 @@ sysctl_iflist_ifm(struct ifnet *ifp, struct rt_addrinfo *info,
 	ifm->ifm_flags = ifp->if_flags | ifp->if_drv_flags;
 	ifm->ifm_index = ifp->if_index;
 
-	ifm->ifm_data = ifp->if_data;
+	ifp->if_getinfo(ifp, &ifm->ifm_data);
 
 	return (SYSCTL_OUT(w->w_req, (caddr_t)ifm, len));
 }
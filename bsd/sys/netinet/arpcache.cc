@@ -8,8 +8,54 @@
 #include <bsd/sys/netinet/arpcache.hh>
 #include <bsd/sys/net/if_llatbl.h>
 
+#include <osv/percpu.hh>
+
+#include <atomic>
+
 struct arp_cache global_arp_cache{};
 
+//
+// A per-CPU direct-mapped front in front of the rcu hashtable above, so
+// the per-packet resolve on the transmit path touches nothing shared.
+// Entries are only read and written by their own CPU with preemption
+// disabled; any ARP change bumps the shared generation, invalidating all
+// the fronts wholesale (same scheme as the per-CPU route cache front in
+// net/routecache.cc).
+//
+struct arp_front_entry {
+    u64 generation = 0; // 0 never matches the generation below: stale
+    in_addr ip = {};
+    arp_cache::mac_address mac = {};
+    u16 flags = 0;
+};
+
+static constexpr unsigned arp_front_size = 128; // per cpu, power of two
+
+struct arp_front_cache {
+    arp_front_entry entries[arp_front_size];
+};
+
+PERCPU(arp_front_cache*, percpu_arp_front);
+
+static sched::cpu::notifier arp_front_notifier([] {
+    *percpu_arp_front = new arp_front_cache;
+});
+
+static std::atomic<u64> arp_front_gen(1);
+
+static inline arp_front_entry* arp_front_slot(const in_addr ip)
+{
+    // s_addr is in network order: fold the host part in before masking.
+    auto a = ip.s_addr;
+    auto h = a ^ (a >> 16) ^ (a >> 24);
+    return &(*percpu_arp_front)->entries[h & (arp_front_size - 1)];
+}
+
+static void arp_front_invalidate()
+{
+    arp_front_gen.fetch_add(1, std::memory_order_relaxed);
+}
+
 void arp_cache_add(const struct llentry *lle)
 {
     if (!(lle->la_flags & LLE_VALID)) {
@@ -17,21 +63,58 @@ void arp_cache_add(const struct llentry *lle)
     }
     auto* mac = reinterpret_cast<const arp_cache::mac_address*>(lle->ll_addr.mac16);
     auto* sin = satosin(L3_ADDR(lle));
+    // An entry may be replacing an older mapping for the same address -
+    // drop whatever the per-CPU fronts are holding.
+    arp_front_invalidate();
     global_arp_cache.add(sin->sin_addr, *mac, lle->la_flags);
 }
 
 void arp_cache_remove(const struct llentry *lle)
 {
     auto* sin = satosin(L3_ADDR(lle));
+    arp_front_invalidate();
     global_arp_cache.remove(sin->sin_addr);
 }
 
 bool arp_cache_lookup(const in_addr ip, arp_cache::mac_address& mac, u16& flags)
 {
+#if CONF_lazy_stack_invariant
+    assert(sched::preemptable() && arch::irq_enabled());
+#endif
+#if CONF_lazy_stack
+    arch::ensure_next_stack_page();
+#endif
+    WITH_LOCK(preempt_lock) {
+        auto fc = *percpu_arp_front;
+        if (fc) {
+            auto e = arp_front_slot(ip);
+            if (e->generation ==
+                    arp_front_gen.load(std::memory_order_relaxed) &&
+                e->ip.s_addr == ip.s_addr) {
+                mac = e->mac;
+                flags = e->flags;
+                return true;
+            }
+        }
+    }
+
+    // Read the generation before the shared lookup, so a concurrent ARP
+    // change leaves a front entry that can never validate.
+    auto gen = arp_front_gen.load(std::memory_order_relaxed);
     auto e = global_arp_cache.lookup(ip);
     if (e) {
         mac = e->mac;
         flags = e->flags;
+        WITH_LOCK(preempt_lock) {
+            auto fc = *percpu_arp_front;
+            if (fc) {
+                auto fe = arp_front_slot(ip);
+                fe->ip = ip;
+                fe->mac = mac;
+                fe->flags = flags;
+                fe->generation = gen;
+            }
+        }
         return true;
     }
     return false;
@@ -84,6 +84,7 @@
 #endif /* IPSEC */
 
 #include <osv/trace.hh>
+#include <osv/rcu.hh>
 
 #define	INPCBLBGROUP_SIZMIN	8
 #define	INPCBLBGROUP_SIZMAX	256
@@ -128,7 +129,7 @@ static void	in_pcbremlists(struct inpcb *inp);
 static struct inpcb	*in_pcblookup_hash_locked(struct inpcbinfo *pcbinfo,
 			    struct in_addr faddr, u_int fport_arg,
 			    struct in_addr laddr, u_int lport_arg,
-			    int lookupflags, struct ifnet *ifp);
+			    int lookupflags, struct ifnet *ifp, int lbgroup_ok);
 
 #if 0
 #define RANGECHK(var, min, max) \
@@ -355,6 +356,7 @@ in_pcbinslbgrouphash(struct inpcb *inp)
 
 	grp->il_inp[grp->il_inpcnt] = inp;
 	grp->il_inpcnt++;
+	pcbinfo->ipi_lbgroup_cnt++;
 	return (0);
 }
 
@@ -393,6 +395,7 @@ in_pcbremlbgrouphash(struct inpcb *inp)
 				/* Pull up inpcbs, shrink group if possible. */
 				in_pcblbgroup_reorder(hdr, &grp, i);
 			}
+			pcbinfo->ipi_lbgroup_cnt--;
 			return;
 		}
 	}
@@ -422,6 +425,7 @@ in_pcbinfo_init(struct inpcbinfo *pcbinfo, const char *name,
 	    &pcbinfo->ipi_porthashmask);
 	pcbinfo->ipi_lbgrouphashbase = (inpcblbgrouphead *)hashinit(hash_nelements, 0,
 	    &pcbinfo->ipi_lbgrouphashmask);
+	pcbinfo->ipi_lbgroup_cnt = 0;
 	// FIXME: uma_zone_set_max(pcbinfo->ipi_zone, maxsockets);
 }
 
@@ -1085,7 +1089,7 @@ in_pcbconnect_setup(struct inpcb *inp, struct bsd_sockaddr *nam,
 			return (error);
 	}
 	oinp = in_pcblookup_hash_locked(inp->inp_pcbinfo, faddr, fport,
-	    laddr, lport, 0, NULL);
+	    laddr, lport, 0, NULL, 1);
 	if (oinp != NULL) {
 		if (oinpp != NULL)
 			*oinpp = oinp;
@@ -1160,6 +1164,26 @@ in_pcbref(struct inpcb *inp)
 	refcount_acquire(&inp->inp_refcount);
 }
 
+/*
+ * Like in_pcbref(), but safe on a pcb that nothing pins: the lock-free
+ * lookup path may race with the last reference being dropped, in which
+ * case the refcount must not be resurrected from zero (the pcb is already
+ * on its way to an RCU-deferred free).  Returns 0 if the pcb was gone.
+ */
+static int
+in_pcbref_unless_zero(struct inpcb *inp)
+{
+	u_int old;
+
+	do {
+		old = inp->inp_refcount;
+		if (old == 0)
+			return (0);
+	} while (atomic_cmpset_acq_int(&inp->inp_refcount, old, old + 1) == 0);
+	trace_inpcb_ref(inp);
+	return (1);
+}
+
 /*
  * Drop a refcount on an inpcb elevated using in_pcbref(); because a call to
  * in_pcbfree() may have been made between in_pcbref() and in_pcbrele(), we
@@ -1200,7 +1224,12 @@ in_pcbrele_locked(struct inpcb *inp)
 
 	INP_UNLOCK(inp);
 	pcbinfo = inp->inp_pcbinfo;
-	delete inp;
+	/*
+	 * Lock-free lookups (see in_pcblookup_hash()) may still be
+	 * traversing this pcb's hash linkage, so defer the actual free
+	 * until after a grace period.
+	 */
+	osv::rcu_dispose(inp);
 	return (1);
 }
 
@@ -1599,13 +1628,16 @@ in_pcblookup_lbgroup(const struct inpcbinfo *pcbinfo,
 
 /*
  * Lookup PCB in hash list, using pcbinfo tables.  This variation assumes
- * that the caller has locked the hash list, and will not perform any further
- * locking or reference operations on either the hash list or the connection.
+ * that the caller has locked the hash list or holds the RCU read lock, and
+ * will not perform any further locking or reference operations on either
+ * the hash list or the connection.  Callers running without the hash lock
+ * must pass lbgroup_ok as 0: the load balance group arrays are modified in
+ * place and can only be inspected under the lock.
  */
 static struct inpcb *
 in_pcblookup_hash_locked(struct inpcbinfo *pcbinfo, struct in_addr faddr,
     u_int fport_arg, struct in_addr laddr, u_int lport_arg, int lookupflags,
-    struct ifnet *ifp)
+    struct ifnet *ifp, int lbgroup_ok)
 {
 	struct inpcbhead *head;
 	struct inpcb *inp, *tmpinp;
@@ -1614,8 +1646,6 @@ in_pcblookup_hash_locked(struct inpcbinfo *pcbinfo, struct in_addr faddr,
 	KASSERT((lookupflags & ~(INPLOOKUP_WILDCARD)) == 0,
 	    ("%s: invalid lookup flags %d", __func__, lookupflags));
 
-	INP_HASH_LOCK_ASSERT(pcbinfo);
-
 	/*
 	 * First look for an exact match.
 	 */
@@ -1647,7 +1677,7 @@ in_pcblookup_hash_locked(struct inpcbinfo *pcbinfo, struct in_addr faddr,
 	/*
 	 * Then look in lb group (for wildcard match).
 	 */
-	if (pcbinfo->ipi_lbgrouphashbase != NULL &&
+	if (lbgroup_ok && pcbinfo->ipi_lbgrouphashbase != NULL &&
 		(lookupflags & INPLOOKUP_WILDCARD)) {
 		inp = in_pcblookup_lbgroup(pcbinfo, &laddr, lport, &faddr,
 		    fport, lookupflags);
@@ -1730,31 +1760,95 @@ in_pcblookup_hash_locked(struct inpcbinfo *pcbinfo, struct in_addr faddr,
 }
 
 /*
- * Lookup PCB in hash list, using pcbinfo tables.  This variation locks the
- * hash list lock, and will return the inpcb locked (i.e., requires
- * INPLOOKUP_LOCKPCB).
+ * Re-check that a pcb picked up by the lock-free lookup still answers to
+ * the 4-tuple it was found under.  Between the RCU walk and taking the
+ * pcb's own lock the connection may have been disconnected, rebound or
+ * dropped from the hash entirely.
+ */
+static int
+in_pcblookup_validate(struct inpcb *inp, struct in_addr faddr, u_short fport,
+    struct in_addr laddr, u_short lport, int lookupflags)
+{
+	INP_LOCK_ASSERT(inp);
+
+	if ((inp->inp_flags & INP_INHASHLIST) == 0)
+		return (0);
+	if (inp->inp_faddr.s_addr == faddr.s_addr &&
+	    inp->inp_laddr.s_addr == laddr.s_addr &&
+	    inp->inp_fport == fport && inp->inp_lport == lport)
+		return (1);
+	if ((lookupflags & INPLOOKUP_WILDCARD) != 0 &&
+	    inp->inp_faddr.s_addr == INADDR_ANY && inp->inp_lport == lport &&
+	    (inp->inp_laddr.s_addr == laddr.s_addr ||
+	     inp->inp_laddr.s_addr == INADDR_ANY))
+		return (1);
+	return (0);
+}
+
+/*
+ * Lookup PCB in hash list, using pcbinfo tables.  Returns the inpcb locked
+ * (i.e., requires INPLOOKUP_LOCKPCB).
+ *
+ * The common case runs without taking ipi_hash_lock at all: every received
+ * segment performs a lookup, and bouncing the lock's cache line between
+ * CPUs dominates accept-heavy workloads.  Writers still serialize on
+ * INP_HASH_WLOCK and publish chain-head inserts with a release store (see
+ * in_pcbhash_insert()), freed pcbs are only reclaimed after an RCU grace
+ * period (see in_pcbrele_locked()), and LIST_REMOVE() is safe to race with
+ * since a removed pcb keeps its le_next pointer and new readers can no
+ * longer reach it.  A match is confirmed by taking a reference (which may
+ * fail if the last one was just dropped), locking the pcb and revalidating
+ * the tuple, restarting the walk on any mismatch.
+ *
+ * SO_REUSEPORT_LB group arrays are modified in place and cannot be walked
+ * locklessly, so fall back to the classic read-locked path while any load
+ * balance groups exist.
  */
 static struct inpcb *
 in_pcblookup_hash(struct inpcbinfo *pcbinfo, struct in_addr faddr,
-    u_int fport, struct in_addr laddr, u_int lport, int lookupflags,
+    u_int fport_arg, struct in_addr laddr, u_int lport_arg, int lookupflags,
     struct ifnet *ifp)
 {
 	struct inpcb *inp;
+	u_short fport = fport_arg, lport = lport_arg;
 
-	INP_HASH_RLOCK(pcbinfo);
-	inp = in_pcblookup_hash_locked(pcbinfo, faddr, fport, laddr, lport,
-	    (lookupflags & ~(INPLOOKUP_LOCKPCB)), ifp);
-	if (inp != NULL) {
-		in_pcbref(inp);
-		INP_HASH_RUNLOCK(pcbinfo);
-		if (lookupflags & INPLOOKUP_LOCKPCB) {
-			INP_LOCK(inp);
-			if (in_pcbrele_locked(inp))
-				return (NULL);
+	if (pcbinfo->ipi_lbgroup_cnt != 0) {
+		INP_HASH_RLOCK(pcbinfo);
+		inp = in_pcblookup_hash_locked(pcbinfo, faddr, fport, laddr,
+		    lport, (lookupflags & ~(INPLOOKUP_LOCKPCB)), ifp, 1);
+		if (inp != NULL) {
+			in_pcbref(inp);
+			INP_HASH_RUNLOCK(pcbinfo);
+			if (lookupflags & INPLOOKUP_LOCKPCB) {
+				INP_LOCK(inp);
+				if (in_pcbrele_locked(inp))
+					return (NULL);
+			} else
+				panic("%s: locking bug", __func__);
 		} else
-			panic("%s: locking bug", __func__);
-	} else
-		INP_HASH_RUNLOCK(pcbinfo);
+			INP_HASH_RUNLOCK(pcbinfo);
+		return (inp);
+	}
+
+restart:
+	WITH_LOCK(osv::rcu_read_lock) {
+		inp = in_pcblookup_hash_locked(pcbinfo, faddr, fport, laddr,
+		    lport, (lookupflags & ~(INPLOOKUP_LOCKPCB)), ifp, 0);
+		if (inp != NULL && in_pcbref_unless_zero(inp) == 0)
+			inp = NULL;	/* raced with the last reference */
+	}
+	if (inp == NULL)
+		return (NULL);
+	if ((lookupflags & INPLOOKUP_LOCKPCB) == 0)
+		panic("%s: locking bug", __func__);
+	INP_LOCK(inp);
+	if (in_pcbrele_locked(inp))
+		goto restart;
+	if (in_pcblookup_validate(inp, faddr, fport, laddr, lport,
+	    lookupflags) == 0) {
+		INP_UNLOCK(inp);
+		goto restart;
+	}
 	return (inp);
 }
 
@@ -1790,6 +1884,24 @@ in_pcblookup_mbuf(struct inpcbinfo *pcbinfo, struct in_addr faddr,
 }
 #endif /* INET */
 
+/*
+ * Insert a pcb at the head of a lookup hash chain.  in_pcblookup_hash()
+ * walks these chains without the hash lock (under RCU), so the pcb's own
+ * linkage must be globally visible before the chain head points at it.
+ */
+static void
+in_pcbhash_insert(struct inpcbhead *head, struct inpcb *inp)
+{
+	struct inpcb *first = LIST_FIRST(head);
+
+	inp->inp_hash.le_next = first;
+	inp->inp_hash.le_prev = &LIST_FIRST(head);
+	if (first != NULL)
+		first->inp_hash.le_prev = &inp->inp_hash.le_next;
+	atomic_store_rel_ptr((volatile u_long *)&LIST_FIRST(head),
+	    (u_long)inp);
+}
+
 /*
  * Insert PCB onto various hash lists.
  */
@@ -1854,7 +1966,7 @@ in_pcbinshash_internal(struct inpcb *inp)
 	}
 	inp->inp_phd = phd;
 	LIST_INSERT_HEAD(&phd->phd_pcblist, inp, inp_portlist);
-	LIST_INSERT_HEAD(pcbhash, inp, inp_hash);
+	in_pcbhash_insert(pcbhash, inp);
 	inp->inp_flags |= INP_INHASHLIST;
 	return (0);
 }
@@ -1896,7 +2008,7 @@ in_pcbrehash_mbuf(struct inpcb *inp, struct mbuf *m)
 		inp->inp_lport, inp->inp_fport, pcbinfo->ipi_hashmask)];
 
 	LIST_REMOVE(inp, inp_hash);
-	LIST_INSERT_HEAD(head, inp, inp_hash);
+	in_pcbhash_insert(head, inp);
 
 }
 
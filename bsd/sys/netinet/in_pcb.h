@@ -325,6 +325,14 @@ struct inpcbinfo {
 	struct	inpcblbgrouphead *ipi_lbgrouphashbase;	/* (h) */
 	u_long			 ipi_lbgrouphashmask;	/* (h) */
 
+	/*
+	 * Number of pcbs currently held in load balance groups. While it
+	 * is zero, in_pcblookup_hash() may use its lock-free RCU path,
+	 * which cannot walk the in-place-modified group arrays (see
+	 * in_pcb.cc).
+	 */
+	volatile u_int		 ipi_lbgroup_cnt;	/* (h) */
+
 	/*
 	 * Pointer to network stack instance
 	 */
@@ -197,9 +197,32 @@ struct tcphdr {
 #define	TCP_KEEPIDLE	0x100	/* L,N,X start keeplives after this period */
 #define	TCP_KEEPINTVL	0x200	/* L,N interval between keepalives */
 #define	TCP_KEEPCNT	0x400	/* L,N number of keepalives before close */
+#define	TCP_DELACK_US	0x800	/* delayed-ACK window in microseconds */
+#define	TCP_COALESCE_US	0x1000	/* small-write aggregation window in us */
+#define	TCP_TLS_TX	0x2000	/* install kernel TLS transmit keys */
 
 #define	TCP_CA_NAME_MAX	16	/* max congestion control name length */
 
+/*
+ * Kernel TLS transmit offload: after the handshake completes in
+ * userspace, the record keys are installed with setsockopt(TCP_TLS_TX)
+ * and the kernel frames and encrypts everything subsequently written to
+ * the socket into TLS application_data records - so sendfile() and
+ * write() need no userspace encryption pass. Fails with ENOTSUP when
+ * the cpu cannot encrypt in hardware; the caller is expected to keep
+ * TLS in userspace then. Alerts and handshake records must not be
+ * written to the socket once the keys are installed.
+ */
+#define	TCP_TLS_CIPHER_AES_GCM_128	1
+
+struct tcp_tls_tx {
+	u_int16_t	version;	/* wire version, 0x0303 = TLS 1.2 */
+	u_int16_t	cipher;		/* TCP_TLS_CIPHER_* */
+	u_int8_t	key[16];
+	u_int8_t	salt[4];	/* implicit part of the GCM nonce */
+	u_int8_t	seq[8];		/* initial record sequence, big endian */
+};
+
 #define	TCPI_OPT_TIMESTAMPS	0x01
 #define	TCPI_OPT_SACK		0x02
 #define	TCPI_OPT_WSCALE		0x04
@@ -91,15 +91,28 @@
 #include <osv/poll.h>
 #include <osv/net_trace.hh>
 #include <osv/aligned_new.hh>
+#include <osv/per-cpu-counter.hh>
 
 TRACEPOINT(trace_tcp_input_ack, "%p: We've got ACK: %u", void*, unsigned int);
 
 const int tcprexmtthresh = 3;
 
-VNET_DEFINE(struct tcpstat, tcpstat);
-SYSCTL_VNET_STRUCT(_net_inet_tcp, TCPCTL_STATS, stats, CTLFLAG_RW,
-    &VNET_NAME(tcpstat), tcpstat,
-    "TCP statistics (struct tcpstat, netinet/tcp_var.h)");
+static osv::per_cpu_stats<struct tcpstat> tcpstat_shards;
+
+void
+tcpstat_add(int statnum, u_long val)
+{
+
+	tcpstat_shards.add(statnum, val);
+}
+
+void
+tcp_stats_sum(struct tcpstat *out)
+{
+
+	memset(out, 0, sizeof(*out));
+	tcpstat_shards.sum(out);
+}
 
 int tcp_log_in_vain = 0;
 SYSCTL_INT(_net_inet_tcp, OID_AUTO, log_in_vain, CTLFLAG_RW,
@@ -216,7 +229,7 @@ void
 kmod_tcpstat_inc(int statnum)
 {
 
-	(*((u_long *)&V_tcpstat + statnum))++;
+	tcpstat_add(statnum, 1);
 }
 
 /*
@@ -1501,10 +1514,14 @@ tcp_do_segment(struct mbuf *m, struct tcphdr *th, struct socket *so,
 			 * If there's data, delay ACK; if there's also a FIN
 			 * ACKNOW will be turned on later.
 			 */
-			if (DELAY_ACK(tp) && tlen != 0)
-				tcp_timer_activate(tp, TT_DELACK,
-				    tcp_delacktime);
-			else
+			if (DELAY_ACK(tp) && tlen != 0) {
+				if (tp->t_delack_us)
+					tcp_timer_activate_us(tp, TT_DELACK,
+					    tp->t_delack_us);
+				else
+					tcp_timer_activate(tp, TT_DELACK,
+					    tcp_delacktime);
+			} else
 				tp->t_flags |= TF_ACKNOW;
 
 			if ((thflags & TH_ECE) && V_tcp_do_ecn) {
@@ -2538,7 +2555,12 @@ check_delack:
 
 	if (tp->t_flags & TF_DELACK) {
 		tp->t_flags &= ~TF_DELACK;
-		tcp_timer_activate(tp, TT_DELACK, tcp_delacktime);
+		// A per-socket TCP_DELACK_US window overrides the global
+		// tick-based delack time
+		if (tp->t_delack_us)
+			tcp_timer_activate_us(tp, TT_DELACK, tp->t_delack_us);
+		else
+			tcp_timer_activate(tp, TT_DELACK, tcp_delacktime);
 	}
 	return;
 
@@ -3234,13 +3256,28 @@ tcp_setup_net_channel(tcpcb* tp, struct ifnet* intf)
 	intf->add_net_channel(nc, tcp_connection_id(tp));
 	auto so = tp->t_inpcb->inp_socket;
 	so->so_nc = nc;
+	if (intf->if_steer_flow) {
+		auto id = tcp_connection_id(tp);
+		nc->set_steer_fn([=] (int cpu) {
+			intf->if_steer_flow(intf, id, cpu);
+		});
+	}
+	// a preference set before the channel existed (typically inherited
+	// from the listening socket) applies now
+	if (so->so_incoming_cpu >= 0) {
+		nc->set_preferred_cpu(so->so_incoming_cpu);
+	}
+	// same for a trace context set before the channel existed
+	if (so->so_trace_ctx) {
+		nc->set_trace_ctx(so->so_trace_ctx);
+	}
 	if (so->fp) {
 		WITH_LOCK(so->fp->f_lock) {
 			for (auto&& pl : so->fp->f_poll_list) {
 				so->so_nc->add_poller(*pl._req);
 			}
-			if (so->fp->f_epolls) {
-				for (auto&& ep : *so->fp->f_epolls) {
+			if (so->fp->epolls()) {
+				for (auto&& ep : *so->fp->epolls()) {
 					so->so_nc->add_epoll(ep);
 				}
 			}
@@ -3253,6 +3290,10 @@ void tcp_teardown_net_channel(tcpcb *tp)
 	if (!tp->nc_intf) {
 		return;
 	}
+	// drop any flow steering rule this channel programmed
+	if (tp->nc_intf->if_steer_flow && tp->nc && tp->nc->preferred_cpu() >= 0) {
+		tp->nc_intf->if_steer_flow(tp->nc_intf, tcp_connection_id(tp), -1);
+	}
 	tp->nc_intf->del_net_channel(tcp_connection_id(tp));
 	tp->nc_intf = nullptr;
 	// keep tp->nc around since it might still contain packets
@@ -282,7 +282,13 @@ tcp_lro_flush(struct lro_ctrl *lc, struct lro_entry *le)
 #endif
 	}
 
-	(*lc->ifp->if_input)(lc->ifp, le->m_head);
+	/*
+	 * Prefer the net-channel fast path for the aggregated frame, like
+	 * the drivers do for packets that bypass LRO; fall back to the
+	 * regular input path when no channel claims the flow.
+	 */
+	if (!lc->ifp->if_classifier.post_packet(le->m_head))
+		(*lc->ifp->if_input)(lc->ifp, le->m_head);
 	lc->lro_queued += le->append_cnt + 1;
 	lc->lro_flushed++;
 	bzero(le, sizeof(*le));
@@ -78,6 +78,8 @@
 TRACEPOINT(trace_tso_flush_sched, "");
 TRACEPOINT(trace_tso_flush_cancel, "");
 TRACEPOINT(trace_tso_flush_fire, "Going to send %d bytes", int);
+TRACEPOINT(trace_coalesce_sched, "");
+TRACEPOINT(trace_coalesce_fire, "Going to send %d bytes", int);
 TRACEPOINT(trace_tcp_output, "Going to send %d bytes, off %d, sendwin %d sb_cc "
 							 "%d cur_seq %u", int, int, int, int, unsigned int);
 TRACEPOINT(trace_tcp_output_error, "Transmission failed: %d", int);
@@ -152,6 +154,52 @@ static inline void tcp_cancel_tso_flush_timer(struct tcpcb *tp)
 	tp->t_flags &= ~((u_int)TF_TSO_PENDING);
 }
 
+static inline void tcp_cancel_coalesce_timer(struct tcpcb *tp)
+{
+	// Like the TSO_FLUSH timer above, just make it do nothing when it
+	// fires.
+	tp->t_flags2 &= ~((u_int)TF2_COALESCE_NOW);
+	tp->t_flags2 &= ~((u_int)TF2_COALESCE_PENDING);
+}
+
+/**
+ * Check if a sub-MSS write should go out now or keep aggregating
+ *
+ * @param tp TCP context handle
+ * @param len pending data length
+ *
+ * @return TRUE if data should be sent, FALSE otherwise
+ *
+ * When a TCP_COALESCE_US window is set on the socket, a small write
+ * that would otherwise be sent immediately (TCP_NODELAY or idle
+ * connection) is deferred for up to that many microseconds, so that
+ * further small writes are merged into one segment - one vring kick
+ * instead of one per write for bursts of small RPC messages.
+ */
+static inline bool tcp_coalesce_send_now(struct tcpcb *tp, long len)
+{
+	if (tp->t_coalesce_us == 0 || len >= tp->t_maxseg) {
+		return true;
+	}
+
+	// COALESCE timer fired - send!
+	if (tp->t_flags2 & TF2_COALESCE_NOW) {
+		trace_coalesce_fire(len);
+		return true;
+	}
+
+	//
+	// Start the timer when the aggregation starts
+	//
+	if (!(tp->t_flags2 & TF2_COALESCE_PENDING)) {
+		trace_coalesce_sched();
+		tp->t_flags2 |= TF2_COALESCE_PENDING;
+		tcp_timer_activate_us(tp, TT_COALESCE, tp->t_coalesce_us);
+	}
+
+	return false;
+}
+
 /**
  * Check if the TSO aggregation should be closed
  *
@@ -615,7 +663,9 @@ after_sack_rexmit:
 		    (idle || (tp->t_flags & TF_NODELAY)) &&
 		    len + off >= so->so_snd.sb_cc &&
 		    (tp->t_flags & TF_NOPUSH) == 0) {
-			goto send;
+			if (tcp_coalesce_send_now(tp, len)) {
+				goto send;
+			}
 		}
 		if (tp->t_flags & TF_FORCEDATA) {	/* typ. timeout case */
 			trace_tcp_output_ret(6);
@@ -1016,6 +1066,9 @@ send:
 		m->m_hdr.mh_len = hdrlen;
 	}
 	m->M_dat.MH.MH_pkthdr.rcvif = (struct ifnet *)0;
+	/* attribute this segment's tx-path trace events to the socket's
+	 * distributed-tracing context */
+	m->M_dat.MH.MH_pkthdr.trace_ctx = so->so_trace_ctx;
 #ifdef MAC
 	mac_inpcb_create_mbuf(tp->t_inpcb, m);
 #endif
@@ -1342,6 +1395,10 @@ timer:
 		if (!sack_rxmit && (tp->t_flags & TF_TSO_PENDING)) {
 			tcp_cancel_tso_flush_timer(tp);
 		}
+		// ... and the small-write coalescing timer
+		if (!sack_rxmit && (tp->t_flags2 & TF2_COALESCE_PENDING)) {
+			tcp_cancel_coalesce_timer(tp);
+		}
 
 		/* TODO: IPv6 IP6TOS_ECT bit on */
 		error = ip6_output(m, tp->t_inpcb->in6p_outputopts, &ro,
@@ -1381,6 +1438,10 @@ timer:
 	if (!sack_rxmit && (tp->t_flags & TF_TSO_PENDING)) {
 		tcp_cancel_tso_flush_timer(tp);
 	}
+	// ... and the small-write coalescing timer
+	if (!sack_rxmit && (tp->t_flags2 & TF2_COALESCE_PENDING)) {
+		tcp_cancel_coalesce_timer(tp);
+	}
 
 	error = ip_output(m, tp->t_inpcb->inp_options, &ro,
 	    ((so->so_options & SO_DONTROUTE) ? IP_ROUTETOIF : 0), 0,
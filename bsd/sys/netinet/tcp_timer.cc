@@ -65,6 +65,7 @@
 TRACEPOINT(trace_tcp_timer_tso_flush, "");
 TRACEPOINT(trace_tcp_timer_tso_flush_ret, "");
 TRACEPOINT(trace_tcp_timer_tso_flush_err, "");
+TRACEPOINT(trace_tcp_timer_coalesce, "");
 
 int	tcp_keepinit;
 SYSCTL_PROC(_net_inet_tcp, TCPCTL_KEEPINIT, keepinit, CTLTYPE_INT|CTLFLAG_RW,
@@ -455,6 +456,33 @@ tcp_timer_tso_flush(serial_timer_task& timer, struct tcpcb *tp)
 	trace_tcp_timer_tso_flush_ret();
 }
 
+// The TCP_COALESCE_US window expired - flush the aggregated small
+// writes (see tcp_coalesce_send_now() in tcp_output.cc).
+static void
+tcp_timer_coalesce(serial_timer_task& timer, struct tcpcb *tp)
+{
+	trace_tcp_timer_coalesce();
+
+	CURVNET_SET(tp->t_vnet);
+	struct inpcb *inp = tp->t_inpcb;
+
+	KASSERT(inp != NULL, ("tcp_timer_coalesce: inp == NULL"));
+	INP_LOCK(inp);
+
+	// Re-check the TF2_COALESCE_PENDING flag under the lock
+	if (!timer.try_fire() || !(tp->t_flags2 & TF2_COALESCE_PENDING)) {
+		INP_UNLOCK(inp);
+		CURVNET_RESTORE();
+		return;
+	}
+
+	tp->t_flags2 |= TF2_COALESCE_NOW;
+	(void) tcp_output(tp);
+
+	INP_UNLOCK(inp);
+	CURVNET_RESTORE();
+}
+
 static void
 tcp_timer_rexmt(serial_timer_task& timer, struct tcpcb *tp)
 {
@@ -619,6 +647,17 @@ tcp_timer_activate(struct tcpcb *tp, tcp_timer_type timer_type, ticks_t delta)
 	}
 }
 
+void
+tcp_timer_activate_us(struct tcpcb *tp, tcp_timer_type timer_type, u64 us)
+{
+	auto& timer = tp->t_timers->get(timer_type);
+	if (us == 0) {
+		timer.cancel();
+	} else {
+		timer.reschedule(us * 1000 * 1_ns);
+	}
+}
+
 int
 tcp_timer_active(struct tcpcb *tp, tcp_timer_type timer_type)
 {
@@ -648,6 +687,9 @@ init_timers(struct tcp_timer* timers, struct tcpcb *tp, struct inpcb *inp)
 
 	timers->timers[tcp_timer_type::TT_TSO_FLUSH] =
 		new serial_timer_task(inp->inp_lock, std::bind(tcp_timer_tso_flush, _1, tp));
+
+	timers->timers[tcp_timer_type::TT_COALESCE] =
+		new serial_timer_task(inp->inp_lock, std::bind(tcp_timer_coalesce, _1, tp));
 }
 
 serial_timer_task&
@@ -156,6 +156,7 @@ enum tcp_timer_type {
 	TT_KEEP,	/* 2*msl TIME_WAIT timer */
 	TT_2MSL,	/* delayed ACK timer */
 	TT_TSO_FLUSH, 	/* TSO flush timer */
+	TT_COALESCE,	/* small-write aggregation timer */
 	COUNT
 };
 
@@ -205,6 +206,9 @@ void	tcp_timer_init(void);
 struct tcptw *
 	tcp_tw_2msl_scan(int _reuse);		/* XXX temporary */
 void tcp_timer_activate(struct tcpcb *tp, tcp_timer_type timer_type, ticks_t delta);
+/* Same, but in microseconds - for the sub-tick delayed-ACK and
+ * small-write coalescing windows. */
+void tcp_timer_activate_us(struct tcpcb *tp, tcp_timer_type timer_type, u64 us);
 int tcp_timer_active(struct tcpcb *tp, tcp_timer_type timer_type);
 
 void init_timers(struct tcp_timer* timers, struct tcpcb *tp, struct inpcb *inp);
@@ -0,0 +1,182 @@
+/*
+ * Copyright (C) 2026 Waldemar Kozaczuk
+ *
+ * This work is open source software, licensed under the terms of the
+ * BSD license as described in the LICENSE file in the top-level directory.
+ */
+
+/*
+ * Kernel TLS transmit offload.
+ *
+ * After the handshake completes in userspace, the application installs
+ * its record keys with setsockopt(TCP_TLS_TX). From then on, every
+ * chain handed to tcp_usr_send() is cut into TLS 1.2 application_data
+ * records before it reaches the send buffer: a 13-byte header (5 bytes
+ * of record header plus the 8-byte explicit nonce) is prepended, the
+ * payload is AES-128-GCM encrypted in place inside the mbufs - which
+ * are private at that point, freshly filled by sosend - and the 16-byte
+ * tag appended. Combined with sendfile(), this leaves exactly one pass
+ * over the data between the page cache and the NIC.
+ *
+ * The cipher itself is the AES-NI helper in core/aes-gcm.cc; key
+ * installation fails with ENOTSUP on cpus it does not support, and the
+ * application is expected to keep encrypting in userspace then.
+ */
+
+#include <sys/cdefs.h>
+
+#include <bsd/porting/netport.h>
+#include <bsd/porting/sync_stub.h>
+
+#include <bsd/sys/sys/param.h>
+#include <bsd/sys/sys/mbuf.h>
+#include <bsd/sys/sys/socket.h>
+#include <bsd/sys/sys/socketvar.h>
+
+#include <bsd/sys/netinet/in.h>
+#include <bsd/sys/netinet/in_pcb.h>
+#include <bsd/sys/netinet/in_systm.h>
+#include <bsd/sys/netinet/ip.h>
+#include <bsd/sys/netinet/tcp.h>
+#include <bsd/sys/netinet/tcp_var.h>
+
+#include <osv/aes-gcm.hh>
+
+#include <vector>
+
+#define TLS_CONTENT_APPDATA	23	/* application_data */
+#define TLS_MAX_PLAINTEXT	16384	/* record plaintext limit */
+#define TLS_HDR_LEN		13	/* 5 header + 8 explicit nonce */
+#define TLS_TAG_LEN		16
+#define TLS_AAD_LEN		13	/* seq + type + version + length */
+
+struct tcp_tls_tx_state {
+	crypto::aes_gcm_128 cipher;
+	uint64_t seq;		/* next record sequence number */
+	uint16_t version;	/* wire version */
+};
+
+int
+tcp_tls_tx_enable(tcpcb *tp, const struct tcp_tls_tx *params)
+{
+	if (params->version != 0x0303 ||
+	    params->cipher != TCP_TLS_CIPHER_AES_GCM_128)
+		return (EINVAL);
+	if (!crypto::aes_gcm_128::supported())
+		return (ENOTSUP);
+	/* rekeying in place is not supported - records already in the
+	 * send buffer would have been sealed under the old key */
+	if (tp->t_tls_tx)
+		return (EBUSY);
+
+	auto ts = new tcp_tls_tx_state();
+	ts->cipher.set_key(params->key, params->salt);
+	ts->seq = 0;
+	for (int i = 0; i < 8; i++)
+		ts->seq = (ts->seq << 8) | params->seq[i];
+	ts->version = params->version;
+	tp->t_tls_tx = ts;
+	return (0);
+}
+
+void
+tcp_tls_free(tcpcb *tp)
+{
+	if (!tp->t_tls_tx)
+		return;
+	/* don't leave key schedules lying around in freed memory */
+	memset(tp->t_tls_tx, 0, sizeof(*tp->t_tls_tx));
+	delete tp->t_tls_tx;
+	tp->t_tls_tx = NULL;
+}
+
+/*
+ * Seal one record: m is a private chain holding exactly plen bytes of
+ * plaintext. Prepends the record header, encrypts in place and appends
+ * the tag. Returns the record chain, or NULL with the chain freed on
+ * allocation failure.
+ */
+static struct mbuf *
+tcp_tls_seal_record(struct tcp_tls_tx_state *ts, struct mbuf *m, u_int plen)
+{
+	/* gather the plaintext for the in-place scatter encrypt */
+	std::vector<iovec> iov;
+	for (struct mbuf *n = m; n; n = n->m_hdr.mh_next) {
+		if (n->m_hdr.mh_len)
+			iov.push_back({mtod(n, void *),
+			    (size_t)n->m_hdr.mh_len});
+	}
+
+	M_PREPEND(m, TLS_HDR_LEN, M_DONTWAIT);
+	if (m == NULL)
+		return (NULL);
+
+	u_int wire_len = plen + 8 + TLS_TAG_LEN; /* nonce + text + tag */
+	u_char *hdr = mtod(m, u_char *);
+	hdr[0] = TLS_CONTENT_APPDATA;
+	hdr[1] = ts->version >> 8;
+	hdr[2] = ts->version;
+	hdr[3] = wire_len >> 8;
+	hdr[4] = wire_len;
+	for (int i = 0; i < 8; i++)
+		hdr[5 + i] = ts->seq >> (56 - 8 * i);
+
+	/* additional data: seq || type || version || plaintext length */
+	uint8_t aad[TLS_AAD_LEN];
+	memcpy(aad, hdr + 5, 8);
+	aad[8] = TLS_CONTENT_APPDATA;
+	aad[9] = ts->version >> 8;
+	aad[10] = ts->version;
+	aad[11] = plen >> 8;
+	aad[12] = plen;
+
+	uint8_t tag[TLS_TAG_LEN];
+	ts->cipher.seal(ts->seq, aad, sizeof(aad), iov.data(), iov.size(),
+	    tag);
+	ts->seq++;
+
+	if (!m_append(m, TLS_TAG_LEN, (c_caddr_t)tag)) {
+		m_freem(m);
+		return (NULL);
+	}
+	return (m);
+}
+
+/*
+ * Turn a plaintext chain from sosend into a chain of sealed TLS
+ * records. Consumes m; returns the record chain or NULL (with
+ * everything freed) if an allocation failed.
+ */
+struct mbuf *
+tcp_tls_frame(tcpcb *tp, struct mbuf *m)
+{
+	struct tcp_tls_tx_state *ts = tp->t_tls_tx;
+	struct mbuf *head = NULL;
+	struct mbuf **tailp = &head;
+
+	while (m) {
+		u_int len = m_length(m, NULL);
+		u_int plen = bsd_min(len, (u_int)TLS_MAX_PLAINTEXT);
+		struct mbuf *rest = NULL;
+
+		if (len > plen) {
+			rest = m_split(m, plen, M_DONTWAIT);
+			if (rest == NULL) {
+				m_freem(m);
+				m_freem(head);
+				return (NULL);
+			}
+		}
+		m = tcp_tls_seal_record(ts, m, plen);
+		if (m == NULL) {
+			m_freem(rest);
+			m_freem(head);
+			return (NULL);
+		}
+		*tailp = m;
+		while (*tailp)
+			tailp = &(*tailp)->m_hdr.mh_next;
+		m = rest;
+	}
+	return (head);
+}
@@ -138,11 +138,14 @@ tcp_usr_attach(struct socket *so, int proto, struct thread *td)
 	tp = intotcpcb(inp);
 	if (tp->nc) {
 		so->so_nc = tp->nc;
+		if (so->so_trace_ctx) {
+			so->so_nc->set_trace_ctx(so->so_trace_ctx);
+		}
 		for (auto&& pl : so->fp->f_poll_list) {
 			so->so_nc->add_poller(*pl._req);
 		}
-		if (so->fp->f_epolls) {
-		    for (auto&& ep : *so->fp->f_epolls) {
+		if (so->fp->epolls()) {
+		    for (auto&& ep : *so->fp->epolls()) {
 		        so->so_nc->add_epoll(ep);
 		    }
 		}
@@ -794,6 +797,16 @@ tcp_usr_send(struct socket *so, int flags, struct mbuf *m,
 		m_freem(control);	/* empty control, just free it */
 	}
 	if (!(flags & PRUS_OOB)) {
+		if (tp->t_tls_tx != NULL && m != NULL) {
+			/* seal the chain into TLS records before it enters
+			 * the send buffer; the mbufs are still private here,
+			 * so the payload is encrypted in place */
+			m = tcp_tls_frame(tp, m);
+			if (m == NULL) {
+				error = ENOBUFS;
+				goto out;
+			}
+		}
 		sbappendstream(so, &so->so_snd, m);
 		if (nam && tp->get_state() < TCPS_SYN_SENT) {
 			/*
@@ -1268,6 +1281,7 @@ tcp_ctloutput(struct socket *so, struct sockopt *sopt)
 	struct	inpcb *inp;
 	struct	tcpcb *tp;
 	struct	tcp_info ti;
+	struct	tcp_tls_tx tls;
 	char buf[TCP_CA_NAME_MAX];
 	struct cc_algo *algo;
 
@@ -1477,6 +1491,44 @@ tcp_ctloutput(struct socket *so, struct sockopt *sopt)
 			INP_UNLOCK(inp);
 			break;
 
+		case TCP_DELACK_US:
+		case TCP_COALESCE_US:
+			INP_UNLOCK(inp);
+			error = sooptcopyin(sopt, &ui, sizeof(ui), sizeof(ui));
+			if (error)
+				return (error);
+
+			/* Cap the windows at one second: these are meant to
+			 * shave packets off microsecond-scale RPC traffic,
+			 * not to stall connections. */
+			if (ui > 1000000) {
+				error = EINVAL;
+				break;
+			}
+
+			INP_LOCK_RECHECK(inp);
+			if (sopt->sopt_name == TCP_DELACK_US)
+				tp->t_delack_us = ui;
+			else
+				tp->t_coalesce_us = ui;
+			INP_UNLOCK(inp);
+			break;
+
+		case TCP_TLS_TX:
+			INP_UNLOCK(inp);
+			error = sooptcopyin(sopt, &tls, sizeof(tls),
+			    sizeof(tls));
+			if (error)
+				return (error);
+
+			INP_LOCK_RECHECK(inp);
+			error = tcp_tls_tx_enable(tp, &tls);
+			INP_UNLOCK(inp);
+			/* the keys stop being needed the moment they are
+			 * installed (or rejected) */
+			bzero(&tls, sizeof(tls));
+			break;
+
 		case TCP_KEEPCNT:
 			INP_UNLOCK(inp);
 			error = sooptcopyin(sopt, &ui, sizeof(ui), sizeof(ui));
@@ -1556,6 +1608,23 @@ tcp_ctloutput(struct socket *so, struct sockopt *sopt)
 			INP_UNLOCK(inp);
 			error = sooptcopyout(sopt, &optval, sizeof optval);
 			break;
+		case TCP_DELACK_US:
+			optval = tp->t_delack_us;
+			INP_UNLOCK(inp);
+			error = sooptcopyout(sopt, &optval, sizeof optval);
+			break;
+		case TCP_COALESCE_US:
+			optval = tp->t_coalesce_us;
+			INP_UNLOCK(inp);
+			error = sooptcopyout(sopt, &optval, sizeof optval);
+			break;
+		case TCP_TLS_TX:
+			/* reports only whether offload is engaged; the
+			 * keys themselves are write-only */
+			optval = tp->t_tls_tx != NULL;
+			INP_UNLOCK(inp);
+			error = sooptcopyout(sopt, &optval, sizeof optval);
+			break;
 		default:
 			INP_UNLOCK(inp);
 			error = ENOPROTOOPT;
@@ -221,9 +221,16 @@ public:
 	u_int	t_keepintvl;		/* interval between keepalives */
 	u_int	t_keepcnt;		/* number of keepalives before close */
 
+	u_int	t_flags2;		/* more flags, see TF2_* below */
+	u_int	t_delack_us;		/* delayed-ACK window (us), 0=default */
+	u_int	t_coalesce_us;		/* small-write window (us), 0=off */
+
 	net_channel* nc;
 	struct ifnet* nc_intf;
 
+	/* kernel TLS transmit state (tcp_tls.cc), or NULL */
+	struct tcp_tls_tx_state *t_tls_tx;
+
 	uint32_t t_ispare[8];		/* 5 UTO, 3 TBD */
 	void	*t_pspare2[4];		/* 4 TBD */
 	uint64_t _pad[6];		/* 6 TBD (1-2 CC/RTT?) */
@@ -274,6 +281,12 @@ public:
 #define	TF_CONGRECOVERY	0x20000000	/* congestion recovery mode */
 #define	TF_WASCRECOVERY	0x40000000	/* was in congestion recovery */
 
+/*
+ * Flags for the t_flags2 field - t_flags above is full.
+ */
+#define	TF2_COALESCE_NOW	0x000001 /* flush the small-write aggregation */
+#define	TF2_COALESCE_PENDING	0x000002 /* small-write aggregation pending */
+
 #define	IN_FASTRECOVERY(t_flags)	(t_flags & TF_FASTRECOVERY)
 #define	ENTER_FASTRECOVERY(t_flags)	t_flags |= TF_FASTRECOVERY
 #define	EXIT_FASTRECOVERY(t_flags)	t_flags &= ~TF_FASTRECOVERY
@@ -531,10 +544,17 @@ struct	tcpstat {
 
 #ifdef _KERNEL
 /*
- * In-kernel consumers can use these accessor macros directly to update
- * stats.
+ * TCP statistics are sharded per cpu - segments for different
+ * connections are processed on different cpus and a shared tcpstat
+ * would bounce its cachelines between all of them. Consumers update
+ * stats through these accessor macros, which index tcpstat as an array
+ * of u_long; tcp_stats_sum() lazily aggregates the shards into a
+ * snapshot for whoever wants to read the statistics.
  */
-#define	TCPSTAT_ADD(name, val)	V_tcpstat.name += (val)
+void	tcpstat_add(int statnum, u_long val);
+void	tcp_stats_sum(struct tcpstat *out);
+#define	TCPSTAT_ADD(name, val)						\
+	tcpstat_add(offsetof(struct tcpstat, name) / sizeof(u_long), (val))
 #define	TCPSTAT_INC(name)	TCPSTAT_ADD(name, 1)
 
 /*
@@ -632,7 +652,6 @@ MALLOC_DECLARE(M_TCPLOG);
 
 VNET_DECLARE(struct inpcbhead, tcb);		/* queue of active tcpcb's */
 VNET_DECLARE(struct inpcbinfo, tcbinfo);
-VNET_DECLARE(struct tcpstat, tcpstat);		/* tcp statistics */
 extern	int tcp_log_in_vain;
 VNET_DECLARE(int, tcp_mssdflt);	/* XXX */
 VNET_DECLARE(int, tcp_minmss);
@@ -645,7 +664,6 @@ VNET_DECLARE(int, tcp_do_rfc3465);
 VNET_DECLARE(int, tcp_abc_l_var);
 #define	V_tcb			VNET(tcb)
 #define	V_tcbinfo		VNET(tcbinfo)
-#define	V_tcpstat		VNET(tcpstat)
 #define	V_tcp_mssdflt		VNET(tcp_mssdflt)
 #define	V_tcp_minmss		VNET(tcp_minmss)
 #define	V_tcp_delack_enabled	VNET(tcp_delack_enabled)
@@ -699,6 +717,10 @@ void	 tcp_reass_destroy(void);
 #endif
 void	 tcp_input(struct mbuf *, int);
 void	 tcp_flush_net_channel(tcpcb* tp);
+struct tcp_tls_tx;
+int	 tcp_tls_tx_enable(tcpcb *tp, const struct tcp_tls_tx *params);
+struct mbuf *tcp_tls_frame(tcpcb *tp, struct mbuf *m);
+void	 tcp_tls_free(tcpcb *tp);
 void	 tcp_setup_net_channel(tcpcb* tp, struct ifnet* intf);
 void	 tcp_teardown_net_channel(tcpcb* tp);
 void	 tcp_free_net_channel(tcpcb* tp);
@@ -70,6 +70,12 @@
 #include <bsd/sys/netinet/udp.h>
 #include <bsd/sys/netinet/udp_var.h>
 
+#include <bsd/sys/net/ethernet.h>
+#include <osv/poll.h>
+#include <osv/net_channel.hh>
+#include <osv/net_trace.hh>
+#include <osv/aligned_new.hh>
+
 /*
  * UDP protocol implementation.
  * Per RFC 768, August, 1980.
@@ -284,6 +290,184 @@ udp_append(struct inpcb *inp, struct ip *ip, struct mbuf *n, int off,
 		sorwakeup_locked(so);
 }
 
+/*
+ * Net channel callback for a connected UDP socket: the packet arrives
+ * straight from the driver, so unlike udp_input() we see the raw ethernet
+ * frame and have to do the IP-level length validation ourselves. The
+ * classifier only matches exact 4-tuples with an option-less IP header,
+ * which leaves length and checksum validation and the append. Runs from
+ * net_channel::process_queue() with the socket (== inpcb) lock held, i.e.
+ * in the context of the receiving thread, not the driver's.
+ */
+static void
+udp_net_channel_packet(struct inpcb *inp, struct mbuf *m)
+{
+	struct ip *ip;
+	struct udphdr *uh;
+	struct bsd_sockaddr_in udp_in;
+	int len, iphlen;
+
+	log_packet_handling(m, NETISR_ETHER);
+	m_adj(m, ETHER_HDR_LEN);
+	iphlen = sizeof(struct ip);
+	if (m->m_hdr.mh_len < iphlen + (int)sizeof(struct udphdr)) {
+		if ((m = m_pullup(m, iphlen + sizeof(struct udphdr))) == 0) {
+			UDPSTAT_INC(udps_hdrops);
+			return;
+		}
+	}
+	ip = mtod(m, struct ip *);
+	uh = (struct udphdr *)((caddr_t)ip + iphlen);
+	UDPSTAT_INC(udps_ipackets);
+
+	bzero(&udp_in, sizeof(udp_in));
+	udp_in.sin_len = sizeof(udp_in);
+	udp_in.sin_family = AF_INET;
+	udp_in.sin_port = uh->uh_sport;
+	udp_in.sin_addr = ip->ip_src;
+
+	len = ntohs((u_short)uh->uh_ulen);
+	if (len > ntohs((u_short)ip->ip_len) - iphlen ||
+	    len < (int)sizeof(struct udphdr) ||
+	    m->M_dat.MH.MH_pkthdr.len < iphlen + len) {
+		UDPSTAT_INC(udps_badlen);
+		m_freem(m);
+		return;
+	}
+	/* Drop any ethernet padding beyond the UDP payload. */
+	m_trim(m, iphlen + len);
+
+	/*
+	 * Checksum extended UDP header and data, as in udp_input().
+	 */
+	if (uh->uh_sum) {
+		u_short uh_sum;
+
+		if (m->M_dat.MH.MH_pkthdr.csum_flags & CSUM_DATA_VALID) {
+			if (m->M_dat.MH.MH_pkthdr.csum_flags & CSUM_PSEUDO_HDR)
+				uh_sum = m->M_dat.MH.MH_pkthdr.csum_data;
+			else
+				uh_sum = in_pseudo(ip->ip_src.s_addr,
+				    ip->ip_dst.s_addr, htonl((u_short)len +
+				    m->M_dat.MH.MH_pkthdr.csum_data + IPPROTO_UDP));
+			uh_sum ^= 0xffff;
+		} else {
+			char b[9];
+
+			bcopy(((struct ipovly *)ip)->ih_x1, b, 9);
+			bzero(((struct ipovly *)ip)->ih_x1, 9);
+			((struct ipovly *)ip)->ih_len = uh->uh_ulen;
+			uh_sum = in_cksum(m, len + sizeof(struct ip));
+			bcopy(b, ((struct ipovly *)ip)->ih_x1, 9);
+		}
+		if (uh_sum) {
+			UDPSTAT_INC(udps_badsum);
+			m_freem(m);
+			return;
+		}
+	} else
+		UDPSTAT_INC(udps_nosum);
+
+	udp_append(inp, ip, m, iphlen, &udp_in);
+}
+
+static ipv4_tcp_conn_id
+udp_connection_id(struct inpcb *inp)
+{
+	return {inp->inp_faddr, inp->inp_laddr,
+		ntohs(inp->inp_fport), ntohs(inp->inp_lport)};
+}
+
+/*
+ * Once a UDP socket is connected its datagrams arrive on a fixed 4-tuple,
+ * so, like an established TCP connection, the flow can be handed over to a
+ * net channel: the driver pushes matching packets onto the socket's
+ * lock-free ring and the receiving thread picks them apart itself, keeping
+ * the pcb hash lookup and the rx-side socket lock contention out of the
+ * fast path.
+ */
+static void
+udp_setup_net_channel(struct inpcb *inp, struct ifnet *intf)
+{
+	struct udpcb *up = intoudpcb(inp);
+
+	if (up->u_nc_intf)
+		return;
+	if (!up->u_nc)
+		up->u_nc = aligned_new<net_channel>([=] (mbuf *m) {
+			udp_net_channel_packet(inp, m);
+		});
+	up->u_nc_intf = intf;
+	intf->add_udp_net_channel(up->u_nc, udp_connection_id(inp));
+	auto so = inp->inp_socket;
+	so->so_nc = up->u_nc;
+	if (intf->if_steer_flow) {
+		auto id = udp_connection_id(inp);
+		so->so_nc->set_steer_fn([=] (int cpu) {
+			intf->if_steer_flow(intf, id, cpu);
+		});
+	}
+	if (so->so_incoming_cpu >= 0) {
+		so->so_nc->set_preferred_cpu(so->so_incoming_cpu);
+	}
+	if (so->so_trace_ctx) {
+		so->so_nc->set_trace_ctx(so->so_trace_ctx);
+	}
+	if (so->fp) {
+		WITH_LOCK(so->fp->f_lock) {
+			for (auto&& pl : so->fp->f_poll_list) {
+				so->so_nc->add_poller(*pl._req);
+			}
+			if (so->fp->epolls()) {
+				for (auto&& ep : *so->fp->epolls()) {
+					so->so_nc->add_epoll(ep);
+				}
+			}
+		}
+	}
+}
+
+/*
+ * Must run before in_pcbdisconnect() wipes the foreign address the
+ * classifier key is built from.
+ */
+static void
+udp_teardown_net_channel(struct inpcb *inp)
+{
+	struct udpcb *up = intoudpcb(inp);
+
+	if (!up->u_nc_intf)
+		return;
+	/* drop any flow steering rule this channel programmed */
+	if (up->u_nc_intf->if_steer_flow && up->u_nc &&
+	    up->u_nc->preferred_cpu() >= 0) {
+		up->u_nc_intf->if_steer_flow(up->u_nc_intf,
+		    udp_connection_id(inp), -1);
+	}
+	up->u_nc_intf->del_udp_net_channel(udp_connection_id(inp));
+	up->u_nc_intf = NULL;
+	/* keep up->u_nc around since it might still contain packets */
+}
+
+static void
+udp_free_net_channel(struct inpcb *inp)
+{
+	struct udpcb *up = intoudpcb(inp);
+
+	if (!up->u_nc)
+		return;
+	udp_teardown_net_channel(inp);
+	auto so = inp->inp_socket;
+	if (so && so->fp) {
+		for (auto&& pl : so->fp->f_poll_list) {
+			up->u_nc->del_poller(*pl._req);
+		}
+		so->so_nc = nullptr;
+	}
+	osv::rcu_dispose(up->u_nc);
+	up->u_nc = NULL;
+}
+
 void
 udp_input(struct mbuf *m, int off)
 {
@@ -567,6 +751,13 @@ udp_input(struct mbuf *m, int off)
 		m_freem(m);
 		return;
 	}
+	/*
+	 * A connected socket sees a pure 4-tuple flow: hand further packets
+	 * of this flow over to a net channel (see udp_setup_net_channel()).
+	 */
+	if (inp->inp_faddr.s_addr != INADDR_ANY &&
+	    intoudpcb(inp)->u_nc_intf == NULL && ifp != NULL)
+		udp_setup_net_channel(inp, ifp);
 	udp_append(inp, ip, m, iphlen, &udp_in);
 	INP_UNLOCK(inp);
 	return;
@@ -1123,6 +1314,9 @@ udp_output(struct inpcb *inp, struct mbuf *m, struct bsd_sockaddr *addr,
 	m->m_hdr.mh_data += max_linkhdr;
 	m->m_hdr.mh_len -= max_linkhdr;
 	m->M_dat.MH.MH_pkthdr.len -= max_linkhdr;
+	/* attribute this datagram's tx-path trace events to the socket's
+	 * distributed-tracing context */
+	m->M_dat.MH.MH_pkthdr.trace_ctx = inp->inp_socket->so_trace_ctx;
 
 	/*
 	 * Fill in mbuf with extended UDP header and addresses and length put
@@ -1342,6 +1536,7 @@ udp_abort(struct socket *so)
 	KASSERT(inp != NULL, ("udp_abort: inp == NULL"));
 	INP_LOCK(inp);
 	if (inp->inp_faddr.s_addr != INADDR_ANY) {
+		udp_teardown_net_channel(inp);
 		INP_HASH_WLOCK(&V_udbinfo);
 		in_pcbdisconnect(inp);
 		inp->inp_laddr.s_addr = INADDR_ANY;
@@ -1429,6 +1624,7 @@ udp_close(struct socket *so)
 	KASSERT(inp != NULL, ("udp_close: inp == NULL"));
 	INP_LOCK(inp);
 	if (inp->inp_faddr.s_addr != INADDR_ANY) {
+		udp_teardown_net_channel(inp);
 		INP_HASH_WLOCK(&V_udbinfo);
 		in_pcbdisconnect(inp);
 		inp->inp_laddr.s_addr = INADDR_ANY;
@@ -1476,6 +1672,7 @@ udp_detach(struct socket *so)
 	INP_LOCK(inp);
 	up = intoudpcb(inp);
 	KASSERT(up != NULL, ("%s: up == NULL", __func__));
+	udp_free_net_channel(inp);
 	inp->inp_ppcb = NULL;
 	in_pcbdetach(inp);
 	in_pcbfree(inp);
@@ -1495,6 +1692,7 @@ udp_disconnect(struct socket *so)
 		INP_UNLOCK(inp);
 		return (ENOTCONN);
 	}
+	udp_teardown_net_channel(inp);
 	INP_HASH_WLOCK(&V_udbinfo);
 	in_pcbdisconnect(inp);
 	inp->inp_laddr.s_addr = INADDR_ANY;
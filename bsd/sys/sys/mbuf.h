@@ -128,6 +128,10 @@ struct pkthdr {
 		u_int16_t vt_vtag;	/* Ethernet 802.1p+q vlan tag */
 		u_int16_t vt_nrecs;	/* # of IGMPv3 records in this chain */
 	} PH_vt;
+	uint64_t	 trace_ctx;	/* SO_TRACE_CONTEXT of the sending
+					 * socket, 0 if none; stamped into
+					 * tx-path tracepoints
+					 */
 	SLIST_HEAD(packet_tags, m_tag) tags; /* list of packet tags */
 };
 #define ether_vtag	PH_vt.vt_vtag
@@ -885,6 +889,7 @@ int		m_sanity(struct mbuf *, int);
 struct mbuf	*m_split(struct mbuf *, int, int);
 struct mbuf	*m_uiotombuf(struct uio *, int, int, int, int, int);
 struct mbuf	*m_uiotombuf_zcopy(struct uio *, int, int, int, int, int, struct zmsghdr *);
+void		 ztx_release(void *, void *);
 struct mbuf	*m_unshare(struct mbuf *, int how);
 
 /*-
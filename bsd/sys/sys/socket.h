@@ -114,6 +114,10 @@
 #define	SO_USER_COOKIE	0x1015		/* user cookie (dummynet etc.) */
 #define	SO_PROTOCOL	0x1016		/* get socket protocol (Linux name) */
 #define	SO_PROTOTYPE	SO_PROTOCOL	/* alias for SO_PROTOCOL (SunOS name) */
+#define	SO_BUSY_POLL	0x1017		/* busy-poll rx budget in usec */
+#define	SO_INCOMING_CPU	0x1018		/* preferred cpu for rx processing */
+#define	SO_TRACE_CONTEXT	0x1019	/* u64 distributed-tracing id stamped
+					   into net tracepoints */
 #endif
 
 #if __BSD_VISIBLE
@@ -121,10 +121,18 @@ struct socket {
 	 */
 	int so_fibnum;		/* routing domain for this socket */
 	uint32_t so_user_cookie;
+	int so_busy_poll = 0;	/* SO_BUSY_POLL rx spin budget (usec) */
+	int so_incoming_cpu = -1; /* SO_INCOMING_CPU preferred rx cpu, -1 unset */
+	uint64_t so_trace_ctx = 0; /* SO_TRACE_CONTEXT tracing id, 0 unset */
 	net_channel* so_nc = nullptr;
 	// a net channel only supports one consumer, so let others wait on a waitqueue instead
 	bool so_nc_busy = false;
 	waitqueue so_nc_wq;
+	// threads blocked in accept() on this (listening) socket, protected
+	// by accept_mtx. The FIFO order of the waitqueue means each new
+	// connection wakes exactly the longest-waiting acceptor, rotating
+	// fairly through a pool of acceptor threads.
+	waitqueue so_acceptq_wq;
 	/* FIXME: this is done for poll,
 	 * make sure there's only 1 ref to a fp */
 	struct file* fp;
@@ -143,6 +151,7 @@ extern struct mtx accept_mtx;
 #define	ACCEPT_UNLOCK_ASSERT()		mtx_assert(&accept_mtx, MA_NOTOWNED)
 #define	ACCEPT_LOCK()			mtx_lock(&accept_mtx)
 #define	ACCEPT_UNLOCK()			mtx_unlock(&accept_mtx)
+#define	ACCEPT_MTX_REF()		(accept_mtx._mutex)
 
 #define	SOCK_MTX(_so)			((_so)->so_mtx)
 #define	SOCK_MTX_REF(_so)		(*SOCK_MTX(so))
@@ -20,6 +20,11 @@ ifeq ($(conf_drivers_virtio_rng),1)
 export conf_drivers_virtio?=1
 endif
 
+export conf_drivers_virtio_balloon?=0
+ifeq ($(conf_drivers_virtio_balloon),1)
+export conf_drivers_virtio?=1
+endif
+
 export conf_drivers_cadence?=0
 export conf_drivers_virtio?=0
 export conf_drivers_pci?=0
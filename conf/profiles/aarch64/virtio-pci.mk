@@ -4,3 +4,4 @@ conf_drivers_virtio_blk?=1
 conf_drivers_virtio_fs?=1
 conf_drivers_virtio_net?=1
 conf_drivers_virtio_rng?=1
+conf_drivers_virtio_balloon?=1
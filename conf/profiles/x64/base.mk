@@ -27,6 +27,11 @@ ifeq ($(conf_drivers_virtio_rng),1)
 export conf_drivers_virtio?=1
 endif
 
+export conf_drivers_virtio_balloon?=0
+ifeq ($(conf_drivers_virtio_balloon),1)
+export conf_drivers_virtio?=1
+endif
+
 export conf_drivers_ahci?=0
 ifeq ($(conf_drivers_ahci),1)
 export conf_drivers_pci?=1
@@ -43,6 +48,11 @@ ifeq ($(conf_drivers_nvme),1)
 export conf_drivers_pci?=1
 endif
 
+export conf_drivers_ivshmem?=0
+ifeq ($(conf_drivers_ivshmem),1)
+export conf_drivers_pci?=1
+endif
+
 export conf_drivers_vmxnet3?=0
 ifeq ($(conf_drivers_vmxnet3),1)
 export conf_drivers_pci?=1
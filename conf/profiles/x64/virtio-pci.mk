@@ -6,5 +6,8 @@ conf_drivers_virtio_scsi?=1
 conf_drivers_virtio_fs?=1
 conf_drivers_virtio_net?=1
 conf_drivers_virtio_rng?=1
+conf_drivers_virtio_balloon?=1
 
 conf_drivers_pvpanic?=1
+
+conf_drivers_ivshmem?=1
@@ -0,0 +1,314 @@
+/*
+ * Copyright (C) 2026 Waldemar Kozaczuk
+ *
+ * This work is open source software, licensed under the terms of the
+ * BSD license as described in the LICENSE file in the top-level directory.
+ */
+
+#include <osv/aes-gcm.hh>
+#include <assert.h>
+#include <string.h>
+
+#ifdef __x86_64__
+
+#include <wmmintrin.h>
+#include <tmmintrin.h>
+#include "cpuid.hh"
+
+// AES-128-GCM on AES-NI and PCLMULQDQ. The GHASH multiply follows the
+// Intel carry-less multiplication white paper; all GHASH state is kept
+// in the byte-reflected domain, so data blocks are byte-swapped once on
+// the way in and the final digest once on the way out. OSv kernel
+// threads own their FPU state, so using vector registers here needs no
+// special save/restore. The per-function target attributes let this
+// file be part of the generic build while still emitting AES/CLMUL
+// instructions - supported() keeps them from running on cpus without.
+
+namespace crypto {
+
+bool aes_gcm_128::supported()
+{
+    return processor::features().aes && processor::features().pclmulqdq;
+}
+
+static const uint8_t bswap_mask_bytes[16] = {
+    15, 14, 13, 12, 11, 10, 9, 8, 7, 6, 5, 4, 3, 2, 1, 0
+};
+
+__attribute__((target("ssse3")))
+static inline __m128i bswap128(__m128i x)
+{
+    return _mm_shuffle_epi8(x,
+            _mm_loadu_si128((const __m128i *)bswap_mask_bytes));
+}
+
+__attribute__((target("aes")))
+static inline __m128i expand_step(__m128i key, __m128i keygened)
+{
+    keygened = _mm_shuffle_epi32(keygened, _MM_SHUFFLE(3, 3, 3, 3));
+    key = _mm_xor_si128(key, _mm_slli_si128(key, 4));
+    key = _mm_xor_si128(key, _mm_slli_si128(key, 4));
+    key = _mm_xor_si128(key, _mm_slli_si128(key, 4));
+    return _mm_xor_si128(key, keygened);
+}
+
+__attribute__((target("aes")))
+static inline __m128i encrypt_block(const __m128i *rk, __m128i b)
+{
+    b = _mm_xor_si128(b, rk[0]);
+    for (int i = 1; i < 10; i++) {
+        b = _mm_aesenc_si128(b, rk[i]);
+    }
+    return _mm_aesenclast_si128(b, rk[10]);
+}
+
+// Carry-less multiply in GF(2^128) with reduction modulo the GCM
+// polynomial; operands and result are in the byte-reflected domain
+// (algorithm 2 of the Intel white paper).
+__attribute__((target("pclmul")))
+static inline __m128i gfmul(__m128i a, __m128i b)
+{
+    __m128i tmp3 = _mm_clmulepi64_si128(a, b, 0x00);
+    __m128i tmp4 = _mm_clmulepi64_si128(a, b, 0x10);
+    __m128i tmp5 = _mm_clmulepi64_si128(a, b, 0x01);
+    __m128i tmp6 = _mm_clmulepi64_si128(a, b, 0x11);
+
+    tmp4 = _mm_xor_si128(tmp4, tmp5);
+    tmp5 = _mm_slli_si128(tmp4, 8);
+    tmp4 = _mm_srli_si128(tmp4, 8);
+    tmp3 = _mm_xor_si128(tmp3, tmp5);
+    tmp6 = _mm_xor_si128(tmp6, tmp4);
+
+    __m128i tmp7 = _mm_srli_epi32(tmp3, 31);
+    __m128i tmp8 = _mm_srli_epi32(tmp6, 31);
+    tmp3 = _mm_slli_epi32(tmp3, 1);
+    tmp6 = _mm_slli_epi32(tmp6, 1);
+
+    __m128i tmp9 = _mm_srli_si128(tmp7, 12);
+    tmp8 = _mm_slli_si128(tmp8, 4);
+    tmp7 = _mm_slli_si128(tmp7, 4);
+    tmp3 = _mm_or_si128(tmp3, tmp7);
+    tmp6 = _mm_or_si128(tmp6, tmp8);
+    tmp6 = _mm_or_si128(tmp6, tmp9);
+
+    tmp7 = _mm_slli_epi32(tmp3, 31);
+    tmp8 = _mm_slli_epi32(tmp3, 30);
+    tmp9 = _mm_slli_epi32(tmp3, 25);
+    tmp7 = _mm_xor_si128(tmp7, tmp8);
+    tmp7 = _mm_xor_si128(tmp7, tmp9);
+    tmp8 = _mm_srli_si128(tmp7, 4);
+    tmp7 = _mm_slli_si128(tmp7, 12);
+    tmp3 = _mm_xor_si128(tmp3, tmp7);
+
+    __m128i tmp2 = _mm_srli_epi32(tmp3, 1);
+    tmp4 = _mm_srli_epi32(tmp3, 2);
+    tmp5 = _mm_srli_epi32(tmp3, 7);
+    tmp2 = _mm_xor_si128(tmp2, tmp4);
+    tmp2 = _mm_xor_si128(tmp2, tmp5);
+    tmp2 = _mm_xor_si128(tmp2, tmp8);
+    tmp3 = _mm_xor_si128(tmp3, tmp2);
+    return _mm_xor_si128(tmp6, tmp3);
+}
+
+__attribute__((target("aes,pclmul,ssse3")))
+void aes_gcm_128::set_key(const uint8_t key[16], const uint8_t salt[4])
+{
+    __m128i k[11];
+    k[0] = _mm_loadu_si128((const __m128i *)key);
+    k[1] = expand_step(k[0], _mm_aeskeygenassist_si128(k[0], 0x01));
+    k[2] = expand_step(k[1], _mm_aeskeygenassist_si128(k[1], 0x02));
+    k[3] = expand_step(k[2], _mm_aeskeygenassist_si128(k[2], 0x04));
+    k[4] = expand_step(k[3], _mm_aeskeygenassist_si128(k[3], 0x08));
+    k[5] = expand_step(k[4], _mm_aeskeygenassist_si128(k[4], 0x10));
+    k[6] = expand_step(k[5], _mm_aeskeygenassist_si128(k[5], 0x20));
+    k[7] = expand_step(k[6], _mm_aeskeygenassist_si128(k[6], 0x40));
+    k[8] = expand_step(k[7], _mm_aeskeygenassist_si128(k[7], 0x80));
+    k[9] = expand_step(k[8], _mm_aeskeygenassist_si128(k[8], 0x1b));
+    k[10] = expand_step(k[9], _mm_aeskeygenassist_si128(k[9], 0x36));
+    memcpy(_round_keys, k, sizeof(k));
+
+    // the GHASH key is the encryption of the zero block, stored
+    // byte-reflected since that is how gfmul() consumes it
+    __m128i h = encrypt_block(k, _mm_setzero_si128());
+    _mm_store_si128((__m128i *)_h, bswap128(h));
+
+    memcpy(_salt, salt, 4);
+}
+
+// Streaming state for one seal() call. The iov buffers have arbitrary
+// lengths, so both the CTR keystream and the GHASH input can be left
+// with partial blocks at buffer boundaries; ks/ks_used and gbuf/gfill
+// carry them over.
+struct gcm_stream {
+    const __m128i *rk;
+    __m128i h;
+    __m128i x;            // GHASH accumulator, byte-reflected domain
+    uint8_t ctr_block[16]; // salt || explicit nonce || 32-bit counter
+    uint32_t ctr;
+    uint8_t ks[16];       // current keystream block
+    unsigned ks_used;     // bytes of ks already consumed (16 = none left)
+    uint8_t gbuf[16];     // partial GHASH input block
+    unsigned gfill;
+};
+
+__attribute__((target("aes")))
+static inline void next_keystream(gcm_stream &s)
+{
+    s.ctr++;
+    s.ctr_block[12] = s.ctr >> 24;
+    s.ctr_block[13] = s.ctr >> 16;
+    s.ctr_block[14] = s.ctr >> 8;
+    s.ctr_block[15] = s.ctr;
+    __m128i b = encrypt_block(s.rk,
+            _mm_loadu_si128((const __m128i *)s.ctr_block));
+    _mm_storeu_si128((__m128i *)s.ks, b);
+    s.ks_used = 0;
+}
+
+__attribute__((target("pclmul,ssse3")))
+static inline void ghash_block(gcm_stream &s, __m128i block)
+{
+    s.x = gfmul(_mm_xor_si128(s.x, bswap128(block)), s.h);
+}
+
+__attribute__((target("pclmul,ssse3")))
+static inline void ghash_bytes(gcm_stream &s, const uint8_t *p, size_t n)
+{
+    while (n) {
+        if (s.gfill == 0 && n >= 16) {
+            ghash_block(s, _mm_loadu_si128((const __m128i *)p));
+            p += 16;
+            n -= 16;
+            continue;
+        }
+        size_t take = 16 - s.gfill;
+        if (take > n) {
+            take = n;
+        }
+        memcpy(s.gbuf + s.gfill, p, take);
+        s.gfill += take;
+        p += take;
+        n -= take;
+        if (s.gfill == 16) {
+            ghash_block(s, _mm_loadu_si128((const __m128i *)s.gbuf));
+            s.gfill = 0;
+        }
+    }
+}
+
+// flush a trailing partial GHASH block, zero-padded per the GCM spec
+__attribute__((target("pclmul,ssse3")))
+static inline void ghash_flush(gcm_stream &s)
+{
+    if (s.gfill) {
+        memset(s.gbuf + s.gfill, 0, 16 - s.gfill);
+        ghash_block(s, _mm_loadu_si128((const __m128i *)s.gbuf));
+        s.gfill = 0;
+    }
+}
+
+__attribute__((target("aes,pclmul,ssse3")))
+void aes_gcm_128::seal(uint64_t nonce, const uint8_t *aad, size_t aad_len,
+                       const iovec *iov, int iovcnt, uint8_t tag[16])
+{
+    gcm_stream s;
+    s.rk = (const __m128i *)_round_keys;
+    s.h = _mm_load_si128((const __m128i *)_h);
+    s.x = _mm_setzero_si128();
+    s.ks_used = 16;
+    s.gfill = 0;
+
+    memcpy(s.ctr_block, _salt, 4);
+    for (int i = 0; i < 8; i++) {
+        s.ctr_block[4 + i] = nonce >> (56 - 8 * i);
+    }
+    s.ctr = 1; // counter 1 masks the tag; data starts at counter 2
+
+    ghash_bytes(s, aad, aad_len);
+    ghash_flush(s);
+
+    size_t text_len = 0;
+    for (int i = 0; i < iovcnt; i++) {
+        auto p = static_cast<uint8_t *>(iov[i].iov_base);
+        size_t n = iov[i].iov_len;
+        text_len += n;
+        while (n) {
+            if (s.ks_used == 16) {
+                next_keystream(s);
+            }
+            if (s.ks_used == 0 && s.gfill == 0 && n >= 16) {
+                // fast path: whole block, no partial state on either side
+                __m128i c = _mm_xor_si128(
+                        _mm_loadu_si128((const __m128i *)p),
+                        _mm_loadu_si128((const __m128i *)s.ks));
+                _mm_storeu_si128((__m128i *)p, c);
+                ghash_block(s, c);
+                s.ks_used = 16;
+                p += 16;
+                n -= 16;
+                continue;
+            }
+            size_t take = 16 - s.ks_used;
+            if (take > n) {
+                take = n;
+            }
+            for (size_t j = 0; j < take; j++) {
+                p[j] ^= s.ks[s.ks_used + j];
+            }
+            ghash_bytes(s, p, take);
+            s.ks_used += take;
+            p += take;
+            n -= take;
+        }
+    }
+    ghash_flush(s);
+
+    // the length block: bit lengths of aad and ciphertext, big endian
+    uint8_t lengths[16];
+    uint64_t aad_bits = uint64_t(aad_len) * 8;
+    uint64_t text_bits = uint64_t(text_len) * 8;
+    for (int i = 0; i < 8; i++) {
+        lengths[i] = aad_bits >> (56 - 8 * i);
+        lengths[8 + i] = text_bits >> (56 - 8 * i);
+    }
+    ghash_block(s, _mm_loadu_si128((const __m128i *)lengths));
+
+    // tag = E(K, J0) ^ GHASH, with J0 the counter-1 block
+    s.ctr_block[12] = 0;
+    s.ctr_block[13] = 0;
+    s.ctr_block[14] = 0;
+    s.ctr_block[15] = 1;
+    __m128i t = _mm_xor_si128(
+            encrypt_block(s.rk, _mm_loadu_si128((const __m128i *)s.ctr_block)),
+            bswap128(s.x));
+    _mm_storeu_si128((__m128i *)tag, t);
+}
+
+}
+
+#else /* !__x86_64__ */
+
+// No hardware AES-GCM on this architecture yet: report unsupported, so
+// TLS stays in userspace. The methods must still link.
+
+namespace crypto {
+
+bool aes_gcm_128::supported()
+{
+    return false;
+}
+
+void aes_gcm_128::set_key(const uint8_t key[16], const uint8_t salt[4])
+{
+    assert(false);
+}
+
+void aes_gcm_128::seal(uint64_t nonce, const uint8_t *aad, size_t aad_len,
+                       const iovec *iov, int iovcnt, uint8_t tag[16])
+{
+    assert(false);
+}
+
+}
+
+#endif
@@ -19,6 +19,7 @@
 #include <algorithm>
 #include <boost/range/algorithm/transform.hpp>
 #include <osv/wait_record.hh>
+#include <osv/boot.hh>
 #include "libc/pthread.hh"
 
 using namespace boost::range;
@@ -93,6 +94,37 @@ application_runtime::~application_runtime()
 
 app_registry application::apps;
 
+// The application template cache holds a reference to the loaded ELF object
+// of every launched payload, keeping it resident in the global program after
+// the application exits (join() alone would drop the last reference and
+// unload it). The next launch of the same command then finds the object
+// already loaded in program::get_library() and pays only for per-instance
+// state: static TLS areas are rebuilt for the new threads from the object's
+// TLS templates (captured once by init_static_tls()), and argv/environ/stdio
+// are per-application anyway. Note that a resident payload's init functions
+// run only on the first launch and its globals keep their values across
+// runs - re-launched payloads must be able to tolerate that.
+static mutex app_templates_mutex;
+static std::unordered_map<std::string, std::shared_ptr<elf::object>> app_templates;
+static bool app_templates_enabled = false;
+
+void application::cache_app_templates(bool enabled)
+{
+    WITH_LOCK(app_templates_mutex) {
+        app_templates_enabled = enabled;
+        if (!enabled) {
+            app_templates.clear();
+        }
+    }
+}
+
+void application::remove_app_template(const std::string& command)
+{
+    WITH_LOCK(app_templates_mutex) {
+        app_templates.erase(command);
+    }
+}
+
 shared_app_t application::get_current()
 {
     auto runtime = sched::thread::current()->app_runtime();
@@ -168,6 +200,12 @@ application::application(const std::string& command,
     , _terminated(false)
     , _post_main(post_main)
 {
+    // The first application marks the end of the boot on the chart;
+    // later launches (httpserver plugins etc.) are not boot phases
+    static std::atomic<bool> first_app(true);
+    if (first_app.exchange(false)) {
+        boot_time.event(("loading " + command).c_str());
+    }
     try {
         elf::program *current_program;
 
@@ -231,6 +269,24 @@ application::application(const std::string& command,
             throw launch_error("Failed looking up main");
         }
     }
+
+    // Objects loaded into a private namespace die with the application's
+    // program, so only payloads in the global program can be kept resident
+    if (!new_program) {
+        WITH_LOCK(app_templates_mutex) {
+            if (app_templates_enabled) {
+                app_templates.emplace(_command, _lib);
+            }
+        }
+    }
+}
+
+void application::set_mem_soft_cap(size_t cap, std::function<void(size_t)> shrink)
+{
+    // set the callback before publishing the cap: the malloc path only
+    // consults the callback after it observes a non-zero cap
+    _mem_account.shrink = std::move(shrink);
+    _mem_account.soft_cap.store(cap, std::memory_order_release);
 }
 
 void application::start()
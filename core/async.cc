@@ -65,6 +65,12 @@ TRACEPOINT(trace_async_worker_timer_fire_ret, "");
  * the per-CPU task is moved to RELEASED state it is appended to worker's
  * queue of released percpu tasks using lockfree mpsc queue. These
  * objects may be later reused for registrations.
+ *
+ * The connection-per-timer pattern - a timeout armed again on every
+ * packet, almost never firing - reschedules from the same CPU it last
+ * registered on. For that case update() moves the still-armed percpu
+ * task to its new timeout in place, without releasing the registration
+ * and borrowing a new one.
  */
 
 struct one_shot_task {
@@ -122,6 +128,37 @@ public:
         }
     }
 
+    // Try to move a task which is still armed in this worker's timer set
+    // to a new timeout, keeping its registration. Returns false when the
+    // task is no longer ours to move (it fired, is firing, or was
+    // released), in which case the caller has to take the full
+    // release-and-borrow path.
+    bool update(percpu_timer_task& task, clock::time_point time_point)
+    {
+#if CONF_lazy_stack_invariant
+        assert(arch::irq_enabled() && sched::preemptable());
+#endif
+#if CONF_lazy_stack
+        arch::ensure_next_stack_page();
+#endif
+        WITH_LOCK(preempt_lock) {
+            // The worker pops a task and flips it to FIRING without
+            // releasing preempt_lock, so ACTIVE and queued here means it
+            // cannot start firing under us.
+            if (task._state.load(std::memory_order_relaxed) !=
+                    percpu_timer_task::state::ACTIVE || !task.queued) {
+                return false;
+            }
+
+            _timer_tasks.remove(task);
+            task.fire_at = time_point;
+            if (_timer_tasks.insert(task)) {
+                rearm(task.get_timeout());
+            }
+            return true;
+        }
+    }
+
     // May be called from any CPU
     void free(percpu_timer_task& task)
     {
@@ -151,14 +188,29 @@ public:
 
     void fire_once(callback_t&& callback)
     {
-        auto task = new one_shot_task(std::move(callback));
-
 #if CONF_lazy_stack_invariant
         assert(arch::irq_enabled() && sched::preemptable());
 #endif
 #if CONF_lazy_stack
         arch::ensure_next_stack_page();
 #endif
+        one_shot_task* task = nullptr;
+        WITH_LOCK(preempt_lock) {
+            if (!_one_shot_pool.empty()) {
+                task = &*_one_shot_pool.begin();
+                _one_shot_pool.pop_front();
+                _one_shot_pool_size--;
+                // The pooled node's callback was cleared after it fired,
+                // so this move does not free anything under preempt_lock
+                task->_callback = std::move(callback);
+            }
+        }
+
+        if (!task) {
+            // Allocation may sleep, keep it outside preempt_lock
+            task = new one_shot_task(std::move(callback));
+        }
+
         WITH_LOCK(preempt_lock) {
             if (_queue.empty()) {
                 _thread->wake();
@@ -206,9 +258,19 @@ public:
                     DROP_LOCK(preempt_lock) {
                         trace_async_worker_fire(this, &task);
                         task._callback();
-                        delete &task;
+                        // Drop whatever the callback captured before the
+                        // node goes back to the pool
+                        task._callback = nullptr;
                         trace_async_worker_fire_ret();
                     }
+                    if (_one_shot_pool_size < max_pooled_one_shots) {
+                        _one_shot_pool.push_front(task);
+                        _one_shot_pool_size++;
+                    } else {
+                        DROP_LOCK(preempt_lock) {
+                            delete &task;
+                        }
+                    }
                 }
             }
         }
@@ -217,7 +279,11 @@ public:
 private:
     void rearm(clock::time_point time_point) {
         assert(sched::cpu::current() == _cpu);
-        _timer.reset(time_point);
+        // timer_task clients express delays in milliseconds or more and
+        // tolerate slack, so let the worker's wakeup coalesce with
+        // neighbouring timers instead of demanding its own interrupt.
+        using namespace osv::clock::literals;
+        _timer.reset_with_slack(time_point, 1_ms);
     }
 
     void mark_removed(percpu_timer_task& task)
@@ -261,6 +327,17 @@ private:
             bi::slist_member_hook<>,
             &one_shot_task::_hook>> _queue;
 
+    // Fired one_shot_task nodes are kept around (with their callback
+    // cleared) and reused by fire_once(), bounding the pool so a burst of
+    // run_later()s does not pin memory forever. A node is never in _queue
+    // and the pool at the same time, so the hook is shared.
+    static constexpr unsigned max_pooled_one_shots = 64;
+    bi::slist<one_shot_task,
+        bi::member_hook<one_shot_task,
+            bi::slist_member_hook<>,
+            &one_shot_task::_hook>> _one_shot_pool;
+    unsigned _one_shot_pool_size = 0;
+
     lockfree::unordered_queue_mpsc<percpu_timer_task> released_timer_tasks;
 
     std::unique_ptr<sched::thread> _thread;
@@ -321,6 +398,18 @@ bool timer_task::reschedule(clock::time_point time_point)
     assert(_mutex.owned());
     assert(!_terminating);
 
+    WITH_LOCK(migration_lock) {
+        auto& worker = get_worker();
+        auto task = _active_task;
+        if (task && &task->_worker == &worker
+                && worker.update(*task, time_point)) {
+            trace_async_timer_task_reschedule(this, &worker,
+                time_point.time_since_epoch().count());
+            // The previous registration was pending and stays armed
+            return true;
+        }
+    }
+
     bool was_pending = cancel();
 
     WITH_LOCK(migration_lock) {
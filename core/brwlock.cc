@@ -0,0 +1,89 @@
+/*
+ * Copyright (C) 2026 Waldemar Kozaczuk
+ *
+ * This work is open source software, licensed under the terms of the
+ * BSD license as described in the LICENSE file in the top-level directory.
+ */
+
+#include <osv/brwlock.hh>
+#include <osv/preempt-lock.hh>
+
+void brwlock::rlock()
+{
+    while (true) {
+        std::atomic<long>* counter;
+        WITH_LOCK(preempt_lock) {
+            counter = &*_readers;
+            counter->fetch_add(1, std::memory_order_relaxed);
+        }
+        //
+        // Pairs with the writer's fence between announcing itself and
+        // summing the counts: either we see the writer, or it sees our
+        // increment.
+        //
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (!_writer.load(std::memory_order_relaxed)) {
+            return;
+        }
+
+        // A writer is in or draining. Undo the increment on the same
+        // percpu counter it landed on, even if we have since migrated:
+        // readers() sums the counters one at a time with no snapshot, so
+        // undoing on a different cpu's counter could become visible
+        // before our increment does and cancel an established reader's
+        // increment in the writer's sum. On the same atomic the
+        // modification order guarantees no scan ever sees the decrement
+        // without the increment.
+        counter->fetch_add(-1, std::memory_order_relaxed);
+        _writer_thread.wake();
+
+        WITH_LOCK(_wmtx) {
+            while (_writer.load(std::memory_order_relaxed)) {
+                _read_waiters.wait(_wmtx);
+            }
+        }
+    }
+}
+
+void brwlock::runlock()
+{
+    WITH_LOCK(preempt_lock) {
+        _readers->fetch_add(-1, std::memory_order_release);
+    }
+    if (_writer.load(std::memory_order_acquire)) {
+        _writer_thread.wake();
+    }
+}
+
+long brwlock::readers()
+{
+    long sum = 0;
+    for (auto c : sched::cpus) {
+        sum += _readers.for_cpu(c)->load(std::memory_order_acquire);
+    }
+    return sum;
+}
+
+void brwlock::wlock()
+{
+    _wmtx.lock();
+    _writer_thread.reset(*sched::thread::current());
+    _writer.store(true, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    sched::thread::wait_until([this] { return readers() == 0; });
+    _writer_thread.clear();
+    _wowner = sched::thread::current();
+}
+
+bool brwlock::wowned()
+{
+    return _wowner == sched::thread::current();
+}
+
+void brwlock::wunlock()
+{
+    _wowner = nullptr;
+    _writer.store(false, std::memory_order_release);
+    _read_waiters.wake_all(_wmtx);
+    _wmtx.unlock();
+}
@@ -1,4 +1,6 @@
 #include "arch.hh"
+#include <string.h>
+#include <algorithm>
 #include <osv/debug.hh>
 #include <osv/sched.hh>
 #include "drivers/clock.hh"
@@ -12,7 +14,7 @@ double boot_time_chart::to_msec(u64 time)
 
 void boot_time_chart::print_one_time(int index)
 {
-    if (!arrays[index].str) {
+    if (!arrays[index].str[0]) {
         return;
     }
     auto field = arrays[index].stamp;
@@ -23,7 +25,7 @@ void boot_time_chart::print_one_time(int index)
 
 void boot_time_chart::event(const char *str)
 {
-    event(_event++, str, processor::ticks());
+    event(_event.fetch_add(1), str, processor::ticks());
 }
 
 void boot_time_chart::event(int event_idx, const char *str)
@@ -33,17 +35,38 @@ void boot_time_chart::event(int event_idx, const char *str)
 
 void boot_time_chart::event(int event_idx, const char *str, u64 stamp)
 {
-    arrays[event_idx].str = str;
+    // Silently drop the overflow - better to lose late events (there is
+    // one per driver probe and per mount now) than to grow the buffer
+    // every time a machine with more devices comes along
+    if (event_idx >= max_events) {
+        return;
+    }
+    strlcpy(arrays[event_idx].str, str, sizeof(arrays[event_idx].str));
     arrays[event_idx].stamp = stamp;
 }
 
+int boot_time_chart::count() const
+{
+    return std::min(_event.load(), max_events);
+}
+
+const char *boot_time_chart::entry_name(int index) const
+{
+    return arrays[index].str;
+}
+
+double boot_time_chart::entry_msec(int index)
+{
+    return to_msec(arrays[index].stamp - arrays[0].stamp);
+}
+
 void boot_time_chart::print_chart()
 {
     if (clock::get()->processor_to_nano(10000) == 0) {
         debug("Skipping bootchart: please run this with a clocksource that can do ticks/nanoseconds conversion.\n");
         return;
     }
-    int events = _event;
+    int events = count();
     for (auto i = 1; i < events; ++i) {
         print_one_time(i);
     }
@@ -51,7 +74,7 @@ void boot_time_chart::print_chart()
 
 void boot_time_chart::print_total_time()
 {
-    auto last = arrays[_event - 1].stamp;
+    auto last = arrays[count() - 1].stamp;
     auto initial = arrays[0].stamp;
     printf("Booted up in %.2f ms\n", to_msec(last - initial));
 }
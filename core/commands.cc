@@ -208,6 +208,142 @@ static void runscript_process_options(std::vector<std::vector<std::string> >& re
     }
 }
 
+/*
+Read a whole file with a single read() of st_size bytes. Boot-time config
+is consumed sequentially anyway, and one large read is much cheaper than
+the many small reads getline() issues. Sets ok to false when the file
+cannot be opened or read.
+*/
+static std::string read_whole_file(const std::string& fn, bool& ok)
+{
+    ok = false;
+    int fd = open(fn.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return "";
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        close(fd);
+        return "";
+    }
+    std::string content(st.st_size, '\0');
+    ssize_t nread = 0;
+    while (nread < st.st_size) {
+        ssize_t r = read(fd, &content[nread], st.st_size - nread);
+        if (r <= 0) {
+            close(fd);
+            return "";
+        }
+        nread += r;
+    }
+    close(fd);
+    ok = true;
+    return content;
+}
+
+// FNV-1a. Keys the parse cache on script content; collisions only cost
+// correctness against a deliberately crafted script, which the image
+// builder controls anyway.
+static uint64_t content_hash(const std::string& s)
+{
+    uint64_t h = 0xcbf29ce484222325ULL;
+    for (size_t i = 0; i < s.size(); i++) {
+        h ^= (unsigned char)s[i];
+        h *= 0x100000001b3ULL;
+    }
+    return h;
+}
+
+/*
+The spirit parse of a runscript costs a few ms on every boot even when the
+script never changes. Since the parse (unlike option processing and environ
+expansion, which are re-applied each boot) is a pure function of the script
+text, its result is cached next to the script in "<fn>.parsed", keyed by a
+hash of the content. The cache keeps the per-line grouping so options and
+expansion interleave across lines exactly as they would after a fresh
+parse. Saving is best effort: on a read-only image the write fails
+silently and every boot parses, same as before the cache existed.
+*/
+typedef std::vector<std::vector<std::vector<std::string>>> parsed_lines;
+
+static const char* parse_cache_magic = "osv-runscript-cache-1";
+
+static bool load_parse_cache(const std::string& fn, uint64_t hash,
+                             parsed_lines& lines)
+{
+    FILE *fp = fopen(fn.c_str(), "r");
+    if (!fp) {
+        return false;
+    }
+    char magic[32];
+    unsigned long long file_hash;
+    size_t nlines;
+    if (fscanf(fp, "%31s %llx %zu", magic, &file_hash, &nlines) != 3 ||
+            strcmp(magic, parse_cache_magic) != 0 || file_hash != hash) {
+        fclose(fp);
+        return false;
+    }
+    for (size_t li = 0; li < nlines; li++) {
+        size_t ncmds;
+        if (fscanf(fp, "%zu", &ncmds) != 1) {
+            goto bad;
+        }
+        lines.emplace_back();
+        for (size_t ci = 0; ci < ncmds; ci++) {
+            size_t nwords;
+            if (fscanf(fp, "%zu", &nwords) != 1) {
+                goto bad;
+            }
+            lines.back().emplace_back();
+            for (size_t wi = 0; wi < nwords; wi++) {
+                size_t len;
+                // the single space after the length is the separator; the
+                // word bytes themselves may begin with whitespace
+                if (fscanf(fp, "%zu", &len) != 1 || len > max_cmdline ||
+                        fgetc(fp) != ' ') {
+                    goto bad;
+                }
+                std::string word(len, '\0');
+                if (len && fread(&word[0], 1, len, fp) != len) {
+                    goto bad;
+                }
+                lines.back().back().push_back(std::move(word));
+            }
+        }
+    }
+    fclose(fp);
+    return true;
+bad:
+    fclose(fp);
+    lines.clear();
+    return false;
+}
+
+static void save_parse_cache(const std::string& fn, uint64_t hash,
+                             const parsed_lines& lines)
+{
+    FILE *fp = fopen(fn.c_str(), "w");
+    if (!fp) {
+        // read-only image, or unwritable directory - the cache is an
+        // optimization only
+        return;
+    }
+    fprintf(fp, "%s %llx %zu\n", parse_cache_magic,
+            (unsigned long long)hash, lines.size());
+    for (auto& cmds : lines) {
+        fprintf(fp, "%zu\n", cmds.size());
+        for (auto& cmd : cmds) {
+            fprintf(fp, "%zu\n", cmd.size());
+            for (auto& word : cmd) {
+                fprintf(fp, "%zu ", word.size());
+                fwrite(word.data(), 1, word.size(), fp);
+                fputc('\n', fp);
+            }
+        }
+    }
+    fclose(fp);
+}
+
 /*
 If cmd starts with "runscript file", read content of file and
 return vector of all programs to be run.
@@ -232,30 +368,54 @@ runscript_expand(const std::vector<std::string>& cmd, bool &ok, bool &is_runscri
         }
         auto fn = cmd[1];
 
-        FILE *fp = fopen(fn.c_str(), "r");
-        if (!fp) {
+        bool read_ok;
+        std::string text = read_whole_file(fn, read_ok);
+        if (!read_ok) {
             printf("Failed to open runscript file '%s'.\n", fn.c_str());
             ok = false;
             return result2;
         }
-        size_t line_num = 0, line_length = 0;
-        char *line_buffer = nullptr;
-        ssize_t read;
-        while ((read = getline(&line_buffer, &line_length, fp)) != -1) {
-            if (read && line_buffer[read - 1] == '\n') {
-                line_buffer[read - 1] = 0; //Remove new line character
+
+        std::vector<std::string> script_lines;
+        size_t start = 0;
+        while (start < text.size()) {
+            auto end = text.find('\n', start);
+            if (end == std::string::npos) {
+                script_lines.push_back(text.substr(start));
+                break;
             }
-            bool ok2;
-            result3 = parse_command_line_min(line_buffer, ok2);
-            printf("runscript expand fn='%s' line=%d '%s'\n", fn.c_str(), line_num, line_buffer);
-            if (ok2 == false) {
-                printf("Failed expanding runscript file='%s' line=%d '%s'.\n", fn.c_str(), line_num, strlen(line_buffer));
-                result2.clear();
-                ok = false;
-                free(line_buffer);
-                fclose(fp);
-                return result2;
+            script_lines.push_back(text.substr(start, end - start));
+            start = end + 1;
+        }
+
+        // Reuse a cached parse of an unchanged script; otherwise parse and
+        // cache for the next boot. An entry per script line, empty ones
+        // included, so the two paths stay in step with script_lines.
+        auto hash = content_hash(text);
+        auto cache_fn = fn + ".parsed";
+        parsed_lines lines;
+        bool cached = load_parse_cache(cache_fn, hash, lines) &&
+                lines.size() == script_lines.size();
+        if (!cached) {
+            lines.clear();
+            for (size_t line_num = 0; line_num < script_lines.size(); line_num++) {
+                bool ok2;
+                result3 = parse_command_line_min(script_lines[line_num], ok2);
+                if (ok2 == false) {
+                    printf("Failed expanding runscript file='%s' line=%d '%s'.\n",
+                           fn.c_str(), (int)line_num, script_lines[line_num].c_str());
+                    ok = false;
+                    return result2;
+                }
+                lines.push_back(std::move(result3));
             }
+            save_parse_cache(cache_fn, hash, lines);
+        }
+
+        for (size_t line_num = 0; line_num < lines.size(); line_num++) {
+            printf("runscript expand fn='%s' line=%d '%s'\n", fn.c_str(),
+                   (int)line_num, script_lines[line_num].c_str());
+            result3 = lines[line_num];
             // Replace env vars found inside script.
             // process and remove options from command
             runscript_process_options(result3);
@@ -265,10 +425,7 @@ runscript_expand(const std::vector<std::string>& cmd, bool &ok, bool &is_runscri
             // will have argv[2] equal to final value of PORT env var.
             expand_environ_vars(result3);
             result2.insert(result2.end(), result3.begin(), result3.end());
-            line_num++;
         }
-        free(line_buffer);
-        fclose(fp);
     }
     else {
         is_runscript = false;
@@ -143,6 +143,10 @@ void condvar::wake_all()
 
     _waiters_fifo.oldest = _waiters_fifo.newest = nullptr;
     _m.unlock();
+    // Waiters which cannot be morphed onto the user mutex (e.g. ones
+    // racing with a timeout) wake up right here; batch those wakeups so
+    // each destination cpu is interrupted at most once.
+    sched::wakeup_batch batch;
     while (wr) {
         auto next_wr = wr->next; // need to save - *wr invalid after wake
         auto cpu_wr = wr->thread()->tcpu();
@@ -0,0 +1,170 @@
+/*
+ * Copyright (C) 2026 Waldemar Kozaczuk
+ *
+ * This work is open source software, licensed under the terms of the
+ * BSD license as described in the LICENSE file in the top-level directory.
+ */
+
+#include <osv/crashdump.hh>
+#include <osv/mutex.h>
+#include <osv/sched.hh>
+#include <osv/mempool.hh>
+#include <osv/clock.hh>
+#include <osv/debug.hh>
+#include <osv/barrier.hh>
+#include <cstdint>
+#include <cstring>
+#include <cstdlib>
+
+// On panic the console is often the only channel left, and spewing per-cpu
+// state as text over a serial port takes seconds and loses structure. Here
+// regions of interest are registered up front and, on abort(), memcpy'd
+// into a buffer reserved at boot, framed with a magic header and checksum.
+// pvpanic (or watchdog expiry) already tells the host the guest died; fleet
+// automation then snapshots guest memory and extracts the dump by scanning
+// for the magic - no console attached, and the copy itself takes
+// milliseconds. The buffer sits in the core heap, which OSv maps linearly
+// over physical memory, so the dump is contiguous in the snapshot too.
+
+namespace crashdump {
+
+struct dump_header {
+    char magic[8];       // "OSVDUMP1"
+    uint32_t version;    // 1
+    uint32_t nregions;   // region headers actually written
+    uint64_t total_size; // bytes, this header included
+    uint64_t uptime_ns;
+    char msg[256];       // panic message, NUL terminated
+    uint64_t checksum;   // FNV-1a of everything after this header
+    uint32_t complete;   // written last: 0 means a torn dump, 1 valid
+} __attribute__((packed));
+
+struct region_header {
+    char name[16];       // NUL terminated
+    uint64_t orig_addr;  // where the bytes lived, for pointer chasing
+    uint64_t size;       // payload bytes following this header
+} __attribute__((packed));
+
+struct region {
+    char name[16];
+    const void* addr;
+    size_t size;
+};
+
+// Fixed table, so dump() can walk it without taking a lock or touching the
+// allocator. Registration happens at boot, under the mutex.
+static constexpr unsigned max_regions = 32;
+static region regions[max_regions];
+static unsigned nregions;
+static mutex regions_mutex;
+
+static char* dump_buf;
+static size_t dump_buf_size;
+
+void register_region(const char* name, const void* addr, size_t size)
+{
+    WITH_LOCK(regions_mutex) {
+        if (nregions == max_regions) {
+            debugf("crashdump: region table full, dropping '%s'\n", name);
+            return;
+        }
+        auto& r = regions[nregions];
+        memset(r.name, 0, sizeof(r.name));
+        strncpy(r.name, name, sizeof(r.name) - 1);
+        r.addr = addr;
+        r.size = size;
+        // fields first, count last - dump() reads without the lock
+        barrier();
+        nregions++;
+    }
+}
+
+void reserve(size_t size)
+{
+    dump_buf = static_cast<char*>(malloc(size));
+    if (!dump_buf) {
+        debugf("crashdump: failed to reserve %zd bytes\n", size);
+        return;
+    }
+    memset(dump_buf, 0, size);
+    dump_buf_size = size;
+}
+
+static uint64_t fnv1a(const char* p, size_t len)
+{
+    uint64_t h = 0xcbf29ce484222325ULL;
+    for (size_t i = 0; i < len; i++) {
+        h ^= (unsigned char)p[i];
+        h *= 0x100000001b3ULL;
+    }
+    return h;
+}
+
+// A small snapshot assembled at dump time and emitted as the first region
+// of every dump, so a harvester gets the basics even when nothing else was
+// registered.
+struct sysinfo_snapshot {
+    uint64_t uptime_ns;
+    uint32_t nr_cpus;
+    uint32_t panic_cpu;
+    uint64_t mem_total;
+    uint64_t mem_free;
+} __attribute__((packed));
+static sysinfo_snapshot sysinfo;
+
+void dump(const char* msg)
+{
+    if (!dump_buf) {
+        return;
+    }
+
+    sysinfo.uptime_ns =
+        osv::clock::uptime::now().time_since_epoch().count();
+    sysinfo.nr_cpus = sched::cpus.size();
+    sysinfo.panic_cpu = sched::cpu::current() ? sched::cpu::current()->id : 0;
+    sysinfo.mem_total = memory::stats::total();
+    sysinfo.mem_free = memory::stats::free();
+
+    auto* hdr = reinterpret_cast<dump_header*>(dump_buf);
+    size_t pos = sizeof(dump_header);
+    unsigned written = 0;
+    auto emit = [&](const char* name, const void* addr, size_t size) {
+        if (pos + sizeof(region_header) + size > dump_buf_size) {
+            // keep whatever fits; nregions in the header reflects it
+            return;
+        }
+        auto* rh = reinterpret_cast<region_header*>(dump_buf + pos);
+        memset(rh->name, 0, sizeof(rh->name));
+        strncpy(rh->name, name, sizeof(rh->name) - 1);
+        rh->orig_addr = reinterpret_cast<uint64_t>(addr);
+        rh->size = size;
+        pos += sizeof(region_header);
+        memcpy(dump_buf + pos, addr, size);
+        pos += size;
+        written++;
+    };
+
+    emit("sysinfo", &sysinfo, sizeof(sysinfo));
+    // Other cpus may still be running - the copies are racy snapshots,
+    // exactly as racy as the state itself was at the moment of the panic.
+    auto n = nregions;
+    for (unsigned i = 0; i < n; i++) {
+        emit(regions[i].name, regions[i].addr, regions[i].size);
+    }
+
+    memcpy(hdr->magic, "OSVDUMP1", sizeof(hdr->magic));
+    hdr->version = 1;
+    hdr->nregions = written;
+    hdr->total_size = pos;
+    hdr->uptime_ns = sysinfo.uptime_ns;
+    memset(hdr->msg, 0, sizeof(hdr->msg));
+    strncpy(hdr->msg, msg, sizeof(hdr->msg) - 1);
+    hdr->checksum = fnv1a(dump_buf + sizeof(dump_header),
+                          pos - sizeof(dump_header));
+    // the harvester's validity marker goes in last
+    barrier();
+    hdr->complete = 1;
+    debug_early("crashdump: dump serialized\n");
+}
+
+}
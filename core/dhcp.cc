@@ -79,6 +79,13 @@ void dhcp_renew(bool wait)
     net_dhcp_worker.renew(wait);
 }
 
+// Called lazily, from the first socket operation that actually needs the
+// leased address - boot itself no longer waits for the DHCP exchange.
+void dhcp_wait_for_ip()
+{
+    net_dhcp_worker.wait_for_ip();
+}
+
 namespace dhcp {
 
     const char * dhcp_options_magic = "\x63\x82\x53\x63";
@@ -558,6 +565,11 @@ namespace dhcp {
         _client_addr = _server_addr = ipv4_zero;
         dhcp_i( "Broadcasting DHCPDISCOVER message with xid: [%d]",_xid);
         _sock->dhcp_send(dm);
+
+        // Retransmit if no offer shows up; each interface keeps its own
+        // deadline, so several can run the DORA sequence in parallel
+        using namespace osv::clock::literals;
+        _deadline = osv::clock::uptime::now() + 3_s;
     }
 
     void dhcp_interface_state::release()
@@ -581,6 +593,7 @@ namespace dhcp {
         osv::set_dns_config({}, {});
         // no reply/ack is expected, after send we just forget all old state
         _client_addr = _server_addr = ipv4_zero;
+        _deadline = osv::clock::uptime::time_point::max();
     }
 
     void dhcp_interface_state::renew()
@@ -607,6 +620,22 @@ namespace dhcp {
         dhcp_i( "Unicasting DHCPREQUEST message with xid: [%d] from client: %s to server: %s in order to RENEW lease of: %s",
                 _xid, _client_addr.to_string().c_str(), _server_addr.to_string().c_str(), _client_addr.to_string().c_str());
         _sock->dhcp_send(dm);
+
+        // Retry the renewal if the server doesn't acknowledge it
+        using namespace osv::clock::literals;
+        _deadline = osv::clock::uptime::now() + 3_s;
+    }
+
+    void dhcp_interface_state::process_timeout()
+    {
+        // A renewing interface still knows its address; anything else
+        // restarts the DORA sequence from scratch
+        if (_state == DHCP_ACKNOWLEDGE ||
+            (_state == DHCP_REQUEST && _client_addr != ipv4_zero)) {
+            renew();
+        } else {
+            discover();
+        }
     }
 
     void dhcp_interface_state::process_packet(struct mbuf* m)
@@ -726,7 +755,20 @@ namespace dhcp {
 	            sethostname(dm.get_hostname().c_str(), dm.get_hostname().size());
                 dhcp_i("Set hostname to: %s", dm.get_hostname().c_str());
             }
-            // TODO: setup lease
+            // Arm the lease renewal: prefer the server's T1 and fall back
+            // to half the lease time as RFC 2131 suggests; a lease with
+            // neither never expires. The worker thread fires it from a
+            // slack timer, so renewals across interfaces coalesce.
+            u32 renew_sec = dm.get_renewal_time_sec();
+            if (renew_sec == 0) {
+                renew_sec = dm.get_lease_time_sec() / 2;
+            }
+            if (renew_sec != 0) {
+                _deadline = osv::clock::uptime::now() +
+                            std::chrono::seconds(renew_sec);
+            } else {
+                _deadline = osv::clock::uptime::time_point::max();
+            }
         } else if (dm.get_message_type() == DHCP_MT_NAK) {
             // from RFC 2131 section 3.1.5
             // "If the client receives a DHCPNAK message, the client restarts the
@@ -742,7 +784,7 @@ namespace dhcp {
     ///////////////////////////////////////////////////////////////////////////
 
     dhcp_worker::dhcp_worker()
-        : _dhcp_thread(nullptr), _have_ip(false), _waiter(nullptr)
+        : _dhcp_thread(nullptr), _have_ip(false)
     {
 
     }
@@ -779,26 +821,39 @@ namespace dhcp {
 
     void dhcp_worker::_send_and_wait(bool wait, dhcp_interface_state_send_packet iface_func)
     {
+        if (!_dhcp_thread) {
+            // Static configuration - init() was never called
+            return;
+        }
         // When doing renew, we still have IP, but want to reuse the flag.
         _have_ip = false;
-        do {
-            // Send discover or renew packets!
-            for (auto &it: _universe) {
-                (it.second->*iface_func)();
-            }
-
-            if (wait) {
-                dhcp_i("Waiting for IP...");
-                _waiter = sched::thread::current();
+        // Send discover or renew packets on all interfaces at once - each
+        // keeps its own retransmission deadline, so a slow server on one
+        // doesn't delay the others.
+        for (auto &it: _universe) {
+            (it.second->*iface_func)();
+        }
+        // The worker thread owns retransmissions and renewals now; wake it
+        // so it picks up the new deadlines.
+        _dhcp_thread->wake();
 
-                sched::timer t(*sched::thread::current());
-                using namespace osv::clock::literals;
-                t.set(3_s);
+        if (wait) {
+            dhcp_i("Waiting for IP...");
+            wait_for_ip();
+        }
+    }
 
-                sched::thread::wait_until([&]{ return _have_ip || t.expired(); });
-                _waiter = nullptr;
+    void dhcp_worker::wait_for_ip()
+    {
+        if (!_dhcp_thread) {
+            // Static configuration - DHCP was never started
+            return;
+        }
+        WITH_LOCK(_lock) {
+            while (!_have_ip) {
+                _ip_waiters.wait(_lock);
             }
-        } while (!_have_ip && wait);
+        }
     }
 
     void dhcp_worker::start(bool wait)
@@ -825,15 +880,44 @@ namespace dhcp {
     void dhcp_worker::dhcp_worker_fn()
     {
         while (true) {
-            mbuf* m;
+            mbuf* m = nullptr;
             WITH_LOCK(_lock) {
+                // Sleep until a packet arrives or the earliest per-interface
+                // deadline - a retransmission or a lease renewal - passes.
+                // Both tolerate plenty of slack, so let the expiry share a
+                // clock interrupt with other timers.
+                auto deadline = osv::clock::uptime::time_point::max();
+                for (auto &it: _universe) {
+                    deadline = std::min(deadline, it.second->deadline());
+                }
+
+                sched::timer t(*sched::thread::current());
+                if (deadline != osv::clock::uptime::time_point::max()) {
+                    using namespace osv::clock::literals;
+                    t.set_with_slack(deadline, 100_ms);
+                }
+
                 sched::thread::wait_until(_lock, [&] {
-                    return (!_rx_packets.empty());
+                    return (!_rx_packets.empty()) || t.expired();
                 });
 
-                // Get packet for handling
-                m = _rx_packets.front();
-                _rx_packets.pop_front();
+                if (!_rx_packets.empty()) {
+                    // Get packet for handling
+                    m = _rx_packets.front();
+                    _rx_packets.pop_front();
+                }
+            }
+
+            if (!m) {
+                // Timer expired: retransmit or renew on whichever
+                // interfaces are due
+                auto now = osv::clock::uptime::now();
+                for (auto &it: _universe) {
+                    if (it.second->deadline() <= now) {
+                        it.second->process_timeout();
+                    }
+                }
+                continue;
             }
 
             auto it = _universe.find(m->M_dat.MH.MH_pkthdr.rcvif);
@@ -846,9 +930,9 @@ namespace dhcp {
 
             // Check if we got an ip
             if (it->second->is_acknowledged()) {
-                _have_ip = true;
-                if (_waiter) {
-                    _waiter->wake();
+                WITH_LOCK(_lock) {
+                    _have_ip = true;
+                    _ip_waiters.wake_all(_lock);
                 }
             }
         }
@@ -0,0 +1,163 @@
+/*
+ * Copyright (C) 2026 Waldemar Kozaczuk
+ *
+ * This work is open source software, licensed under the terms of the
+ * BSD license as described in the LICENSE file in the top-level directory.
+ */
+
+#include <osv/dma-pool.hh>
+#include <osv/contiguous_alloc.hh>
+#include <osv/mmu.hh>
+#include <osv/preempt-lock.hh>
+#include <osv/trace.hh>
+#include <osv/debug.hh>
+
+#include <map>
+#include <algorithm>
+
+TRACEPOINT(trace_dma_pool_grow, "pool=%p buf_size=%lu arena=%p bufs=%u",
+           void*, size_t, void*, unsigned);
+TRACEPOINT(trace_dma_pool_refill, "pool=%p moved=%u", void*, unsigned);
+TRACEPOINT(trace_dma_pool_spill, "pool=%p moved=%u", void*, unsigned);
+
+namespace memory {
+
+dma_pool::dma_pool(size_t buf_size)
+    : _buf_size(buf_size)
+    // Sub-page buffers are naturally aligned so they never straddle a
+    // page boundary; page-sized and larger ones are page aligned, which
+    // is what the rx buffer consumers expect (they recover the buffer
+    // start with align_down())
+    , _align(std::min(buf_size, (size_t)mmu::page_size))
+{
+    assert(buf_size >= sizeof(free_obj) && (buf_size % 8) == 0);
+    _bufs_per_arena = std::max((size_t)batch * 2, max_arena_bytes / _buf_size);
+}
+
+dma_pool::~dma_pool()
+{
+    for (auto arena : _arenas) {
+        free_phys_contiguous_aligned(arena);
+    }
+}
+
+bool dma_pool::grow()
+{
+    auto arena = alloc_phys_contiguous_aligned(_bufs_per_arena * _buf_size,
+                                               _align);
+    if (!arena) {
+        return false;
+    }
+    // This is the single point where a vIOMMU mapping of the arena into
+    // the device IO address space would be established - buffers handed
+    // out below then never see per-I/O map/unmap work.
+    _arenas.push_back(arena);
+    auto base = static_cast<char*>(arena);
+    for (unsigned i = 0; i < _bufs_per_arena; i++) {
+        auto obj = reinterpret_cast<free_obj*>(base + i * _buf_size);
+        obj->next = _global;
+        _global = obj;
+    }
+    trace_dma_pool_grow(this, _buf_size, arena, _bufs_per_arena);
+    return true;
+}
+
+bool dma_pool::refill()
+{
+    WITH_LOCK(_lock) {
+        if (!_global && !grow()) {
+            return false;
+        }
+        // Move the batch to whichever CPU we end up running on - if we
+        // migrated since the caller found its cache empty, the buffers
+        // are still put to good use
+        unsigned moved = 0;
+        WITH_LOCK(preempt_lock) {
+            auto* c = &*_cache;
+            while (_global && moved < batch) {
+                auto obj = _global;
+                _global = obj->next;
+                obj->next = c->list;
+                c->list = obj;
+                c->count++;
+                moved++;
+            }
+        }
+        trace_dma_pool_refill(this, moved);
+    }
+    return true;
+}
+
+void dma_pool::spill()
+{
+    WITH_LOCK(_lock) {
+        unsigned moved = 0;
+        WITH_LOCK(preempt_lock) {
+            auto* c = &*_cache;
+            // Re-check under preempt_lock - we may have migrated to a CPU
+            // whose cache is not over the watermark after all
+            while (c->list && c->count > max_cached - batch) {
+                auto obj = c->list;
+                c->list = obj->next;
+                c->count--;
+                obj->next = _global;
+                _global = obj;
+                moved++;
+            }
+        }
+        trace_dma_pool_spill(this, moved);
+    }
+}
+
+void* dma_pool::alloc()
+{
+    for (;;) {
+        WITH_LOCK(preempt_lock) {
+            auto* c = &*_cache;
+            if (c->list) {
+                auto obj = c->list;
+                c->list = obj->next;
+                c->count--;
+                return obj;
+            }
+        }
+        // The cache was empty; top it up with preemption enabled (the
+        // refill takes a mutex and may allocate an arena) and retry
+        if (!refill()) {
+            return nullptr;
+        }
+    }
+}
+
+void dma_pool::free(void* buf)
+{
+    auto obj = static_cast<free_obj*>(buf);
+    WITH_LOCK(preempt_lock) {
+        auto* c = &*_cache;
+        obj->next = c->list;
+        c->list = obj;
+        if (++c->count <= max_cached) {
+            return;
+        }
+    }
+    spill();
+}
+
+static mutex dma_pools_lock;
+static std::map<size_t, dma_pool*>* dma_pools;
+
+dma_pool* get_dma_pool(size_t buf_size)
+{
+    WITH_LOCK(dma_pools_lock) {
+        if (!dma_pools) {
+            dma_pools = new std::map<size_t, dma_pool*>();
+        }
+        auto it = dma_pools->find(buf_size);
+        if (it == dma_pools->end()) {
+            it = dma_pools->emplace(buf_size, new dma_pool(buf_size)).first;
+        }
+        return it->second;
+    }
+}
+
+}
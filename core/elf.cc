@@ -13,6 +13,7 @@
 #include <string.h>
 #include <osv/align.hh>
 #include <osv/debug.hh>
+#include <stdio.h>
 #include <stdlib.h>
 #include <unistd.h>
 #include <boost/range/algorithm/find.hpp>
@@ -117,6 +118,12 @@ object::object(program& prog, std::string pathname)
     , _static_tls_offset(0)
     , _initial_tls_size(0)
     , _dynamic_table(nullptr)
+    , _lookup_tables_ready(false)
+    , _symtab(nullptr)
+    , _strtab(nullptr)
+    , _gnu_hashtab(nullptr)
+    , _sysv_hashtab(nullptr)
+    , _versym(nullptr)
     , _module_index(_prog.register_dtv(this))
     , _is_dynamically_linked_executable(false)
     , _init_called(false)
@@ -130,6 +137,12 @@ object::object(program& prog, std::string pathname)
 object::~object()
 {
     elf_debug("Removed\n");
+    if (_visibility_level.load(std::memory_order_acquire) !=
+            VisibilityLevel::Public) {
+        // The object never became Public (e.g. a failed load), so account
+        // for it leaving the module list while still hidden.
+        _prog._hidden_modules.fetch_add(-1, std::memory_order_acq_rel);
+    }
     _prog.free_dtv(this);
 }
 
@@ -177,9 +190,19 @@ bool object::visible(void) const
 
 void object::set_visibility(elf::VisibilityLevel visibilityLevel)
 {
+    auto old_level = _visibility_level.load(std::memory_order_acquire);
     _visibility_thread.store(visibilityLevel == VisibilityLevel::Public ? nullptr : sched::thread::current(),
              std::memory_order_release);
     _visibility_level.store(visibilityLevel, std::memory_order_release);
+    // Symbol lookups are thread-dependent while any module is non-Public,
+    // so program::lookup() keeps count of such modules to know when its
+    // result cache may be used.
+    auto hidden_before = old_level != VisibilityLevel::Public;
+    auto hidden_after = visibilityLevel != VisibilityLevel::Public;
+    if (hidden_before != hidden_after) {
+        _prog._hidden_modules.fetch_add(hidden_after ? 1 : -1,
+                std::memory_order_acq_rel);
+    }
 }
 
 template <>
@@ -398,6 +421,26 @@ void file::load_program_headers()
     }
 }
 
+// Objects listed with --preload-objects have their PT_LOAD segments
+// populated at load time instead of faulting in on demand. Useful for
+// latency-critical objects which would otherwise take many page faults
+// on their hot paths right after boot.
+std::vector<std::string> eager_load_objects;
+
+bool object::eager_load()
+{
+    for (auto& name : eager_load_objects) {
+        if (_pathname == name ||
+            (_pathname.size() > name.size() &&
+             _pathname.compare(_pathname.size() - name.size() - 1, 1, "/") == 0 &&
+             _pathname.compare(_pathname.size() - name.size(),
+                               name.size(), name) == 0)) {
+            return true;
+        }
+    }
+    return false;
+}
+
 void file::load_segment(const Elf64_Phdr& phdr)
 {
     ulong vstart = align_down(phdr.p_vaddr, mmu::page_size);
@@ -407,7 +450,10 @@ void file::load_segment(const Elf64_Phdr& phdr)
 
     unsigned perm = get_segment_mmap_permissions(phdr);
 
-    auto flag = mmu::mmap_fixed | (mlocked() ? mmu::mmap_populate : 0);
+    // Segments are mapped through the file vma/pagecache machinery, so by
+    // default their pages fault in on demand rather than being read here.
+    auto flag = mmu::mmap_fixed |
+        ((mlocked() || eager_load()) ? mmu::mmap_populate : 0);
     mmu::map_file(_base + vstart, filesz, flag, perm, _f, align_down(phdr.p_offset, mmu::page_size));
     if (phdr.p_filesz != phdr.p_memsz) {
         assert(perm & mmu::perm_write);
@@ -639,6 +685,11 @@ bool object::dynamic_exists(unsigned tag)
     return _dynamic_tag(tag);
 }
 
+bool object::has_versym()
+{
+    return dynamic_exists(DT_VERSYM);
+}
+
 Elf64_Dyn* object::_dynamic_tag(unsigned tag)
 {
     if (!_dynamic_table) {
@@ -737,6 +788,10 @@ symbol_module object::symbol_other(unsigned idx)
     return ret;
 }
 
+// Parallelize the R_*_RELATIVE pass only for objects carrying enough
+// relocations to amortize spawning worker threads.
+static constexpr unsigned parallel_relocation_min = 4096;
+
 void object::relocate_rela()
 {
     if(has_non_writable_text_relocations()) {
@@ -746,10 +801,48 @@ void object::relocate_rela()
     auto rela = dynamic_ptr<Elf64_Rela>(DT_RELA);
     assert(dynamic_val(DT_RELAENT) == sizeof(Elf64_Rela));
     unsigned nb = dynamic_val(DT_RELASZ) / sizeof(Elf64_Rela);
-    for (auto p = rela; p < rela + nb; ++p) {
+    // Most entries in a large position-independent object are R_*_RELATIVE
+    // relocations, which touch disjoint addresses and need no symbol lookup,
+    // so they can be applied from several cpus at once. Symbol-bound
+    // relocations are applied serially afterwards: while the object is still
+    // thread-private (see load_object()) its symbols can only be resolved
+    // from the loading thread.
+    if (nb >= parallel_relocation_min && sched::cpus.size() > 1) {
+        unsigned nworkers = std::min<size_t>(sched::cpus.size(), 8);
+        unsigned shard = (nb + nworkers - 1) / nworkers;
+        std::vector<std::unique_ptr<sched::thread>> workers;
+        for (unsigned i = 1; i < nworkers; i++) {
+            auto from = i * shard;
+            auto to = std::min(nb, from + shard);
+            workers.emplace_back(sched::thread::make([=] {
+                relocate_rela_range(rela, from, to, true);
+            }, sched::thread::attr().name("elf-reloc")));
+            workers.back()->start();
+        }
+        relocate_rela_range(rela, 0, std::min(nb, shard), true);
+        for (auto& w : workers) {
+            w->join();
+        }
+        relocate_rela_range(rela, 0, nb, false);
+    } else {
+        relocate_rela_range(rela, 0, nb, true);
+        relocate_rela_range(rela, 0, nb, false);
+    }
+    elf_debug("Relocated %d symbols in DT_RELA\n", nb);
+}
+
+// Apply the relocations in [@from, @to) of the DT_RELA table @rela. If
+// @relative, apply just the R_*_RELATIVE entries, otherwise just the rest.
+void object::relocate_rela_range(Elf64_Rela* rela, unsigned from, unsigned to,
+                                 bool relative)
+{
+    for (auto p = rela + from; p < rela + to; ++p) {
         auto info = p->r_info;
         u32 sym = info >> 32;
         u32 type = info & 0xffffffff;
+        if ((type == ARCH_RELATIVE) != relative) {
+            continue;
+        }
         void *addr = _base + p->r_offset;
         auto addend = p->r_addend;
 
@@ -758,12 +851,13 @@ void object::relocate_rela()
             abort();
         }
     }
-    elf_debug("Relocated %d symbols in DT_RELA\n", nb);
 }
 
 extern "C" { void __elf_resolve_pltgot(void); }
 
-void object::relocate_pltgot()
+// Point the reserved PLTGOT entries at ourselves and the resolver stub,
+// returning the prelinked .plt address (or nullptr) found in pltgot[1].
+void* object::setup_pltgot()
 {
     auto pltgot = dynamic_ptr<void*>(DT_PLTGOT);
     void *original_plt = nullptr;
@@ -784,6 +878,12 @@ void object::relocate_pltgot()
     // standard calling convention.
     pltgot[1] = this;
     pltgot[2] = reinterpret_cast<void*>(__elf_resolve_pltgot);
+    return original_plt;
+}
+
+void object::relocate_pltgot()
+{
+    void *original_plt = setup_pltgot();
 
     bool bind_now = dynamic_exists(DT_BIND_NOW) ||
         (dynamic_exists(DT_FLAGS) && (dynamic_val(DT_FLAGS) & DF_BIND_NOW)) ||
@@ -852,15 +952,309 @@ void* object::resolve_pltgot(unsigned index)
     return *static_cast<void**>(addr);
 }
 
+// Since images are immutable, the result of object::relocate() is identical
+// on every boot as long as the object is loaded at the same base and the same
+// modules are loaded in the same order (module indexes and static TLS offsets
+// are then reproduced too). With --save-reloc-cache, the resolved values are
+// written next to each object as <pathname>.reloc, and later boots replay
+// them with a simple copy loop instead of hashing and resolving every symbol.
+// Ifunc resolvers and TLS descriptors are deliberately left out of the cache
+// and re-run on every boot, as their results can depend on the cpu.
+bool save_relocation_caches = false;
+
+struct reloc_cache_header {
+    u64 magic;
+    u64 version;
+    u64 base;       // expected load base of the object
+    u64 rela_count; // expected number of DT_RELA entries
+    u64 plt_count;  // expected number of DT_JMPREL entries
+    u64 entry_count;
+};
+
+struct reloc_cache_entry {
+    u64 offset; // r_offset of the relocation
+    u64 value;  // resolved value at base + offset
+};
+
+static constexpr u64 reloc_cache_magic = 0x636f6c657256534f; // "OSVreloc"
+static constexpr u64 reloc_cache_version = 1;
+
+// With layout_only, additionally leave out relocations whose results are
+// not determined by the load layout alone: static TLS offsets and TLS
+// module ids are handed out by allocators global to all programs, so they
+// differ between two namespaces even with identical object placement.
+static void collect_cached_relocations(Elf64_Rela* rel, unsigned n, void* base,
+        std::vector<reloc_cache_entry>& entries, bool layout_only = false)
+{
+    for (auto p = rel; p < rel + n; ++p) {
+        u32 type = p->r_info & 0xffffffff;
+        if (type == ARCH_IRELATIVE || type == ARCH_TLSDESC) {
+            continue;
+        }
+        if (layout_only && (type == ARCH_TPOFF || type == ARCH_DTPMOD)) {
+            continue;
+        }
+        entries.push_back({p->r_offset,
+                *reinterpret_cast<u64*>(base + p->r_offset)});
+    }
+}
+
+std::string object::relocation_cache_path()
+{
+    return _pathname + ".reloc";
+}
+
+void object::save_relocation_cache()
+{
+    std::vector<reloc_cache_entry> entries;
+    reloc_cache_header header = {};
+    header.magic = reloc_cache_magic;
+    header.version = reloc_cache_version;
+    header.base = reinterpret_cast<u64>(_base);
+    if (dynamic_exists(DT_RELA)) {
+        header.rela_count = dynamic_val(DT_RELASZ) / sizeof(Elf64_Rela);
+        collect_cached_relocations(dynamic_ptr<Elf64_Rela>(DT_RELA),
+                header.rela_count, _base, entries);
+    }
+    if (dynamic_exists(DT_JMPREL)) {
+        header.plt_count = dynamic_val(DT_PLTRELSZ) / sizeof(Elf64_Rela);
+        collect_cached_relocations(dynamic_ptr<Elf64_Rela>(DT_JMPREL),
+                header.plt_count, _base, entries);
+    }
+    header.entry_count = entries.size();
+
+    auto path = relocation_cache_path();
+    auto f = fopen(path.c_str(), "w");
+    if (!f) {
+        // Most likely a read-only filesystem - just keep relocating from
+        // scratch on every boot.
+        elf_debug("Could not write relocation cache %s\n", path.c_str());
+        return;
+    }
+    if (fwrite(&header, sizeof(header), 1, f) != 1 ||
+        fwrite(entries.data(), sizeof(reloc_cache_entry),
+               entries.size(), f) != entries.size()) {
+        fclose(f);
+        unlink(path.c_str());
+        return;
+    }
+    fclose(f);
+    elf_debug("Saved %ld relocations to %s\n", entries.size(), path.c_str());
+}
+
+bool object::apply_relocation_cache()
+{
+    auto path = relocation_cache_path();
+    auto f = fopen(path.c_str(), "r");
+    if (!f) {
+        return false;
+    }
+    reloc_cache_header header;
+    if (fread(&header, sizeof(header), 1, f) != 1 ||
+        header.magic != reloc_cache_magic ||
+        header.version != reloc_cache_version ||
+        header.base != reinterpret_cast<u64>(_base) ||
+        header.rela_count != (dynamic_exists(DT_RELA) ?
+                dynamic_val(DT_RELASZ) / sizeof(Elf64_Rela) : 0) ||
+        header.plt_count != (dynamic_exists(DT_JMPREL) ?
+                dynamic_val(DT_PLTRELSZ) / sizeof(Elf64_Rela) : 0)) {
+        // A cache for a different image layout or load order - ignore it
+        fclose(f);
+        return false;
+    }
+    std::vector<reloc_cache_entry> entries(header.entry_count);
+    if (fread(entries.data(), sizeof(reloc_cache_entry),
+              entries.size(), f) != entries.size()) {
+        fclose(f);
+        return false;
+    }
+    fclose(f);
+
+    if (has_non_writable_text_relocations()) {
+        make_text_writable(true);
+    }
+    for (auto& e : entries) {
+        *reinterpret_cast<u64*>(_base + e.offset) = e.value;
+    }
+    // Re-run the entries the cache leaves out, and redo the PLTGOT setup
+    // (pltgot[1] holds a pointer to this object, which changes every boot)
+    if (dynamic_exists(DT_RELA)) {
+        auto rela = dynamic_ptr<Elf64_Rela>(DT_RELA);
+        for (auto p = rela; p < rela + header.rela_count; ++p) {
+            u32 type = p->r_info & 0xffffffff;
+            if (type == ARCH_IRELATIVE) {
+                arch_relocate_rela(type, p->r_info >> 32,
+                        _base + p->r_offset, p->r_addend);
+            }
+        }
+    }
+    if (dynamic_exists(DT_JMPREL)) {
+        setup_pltgot();
+        auto rel = dynamic_ptr<Elf64_Rela>(DT_JMPREL);
+        for (auto p = rel; p < rel + header.plt_count; ++p) {
+            u32 type = p->r_info & 0xffffffff;
+            void *addr = _base + p->r_offset;
+            if (type == ARCH_IRELATIVE) {
+                *static_cast<void**>(addr) =
+                    reinterpret_cast<void *(*)()>(_base + p->r_addend)();
+            } else if (type == ARCH_TLSDESC) {
+                arch_relocate_tls_desc(p->r_info >> 32, addr, p->r_addend);
+            }
+        }
+    }
+    elf_debug("Applied %ld relocations from %s\n", entries.size(),
+            path.c_str());
+    return true;
+}
+
+// Cross-namespace sharing of relocation results. Tenant-style workloads
+// spin up one program namespace per plugin (application::new_program())
+// with the same set of shared libraries, and while the read-only
+// segments of those libraries are already shared physically - they are
+// private file mappings served by the page cache - each namespace used
+// to repeat the whole symbol resolution and relocation pass, which is
+// where most of the per-namespace time and dirtied memory goes.
+//
+// The first namespace to relocate an object publishes its resolved
+// values here, keyed by pathname. A later namespace that mapped the same
+// file at the same offset within its own window - which, with bump
+// allocation from the window start, implies the same load order - can
+// replay them: a recorded value that points into the recording
+// namespace's window is rebased into the replaying one, and anything
+// else (kernel addresses, which are identical in every namespace, and
+// plain non-pointer words) is copied as is. Relocations whose results
+// are not layout-determined (ifuncs, TLS descriptors, TLS module ids
+// and static TLS offsets) are left out and recomputed on replay.
+//
+// Objects loaded into the default program share nothing: its window
+// also contains the kernel image, so window membership would no longer
+// separate rebasable addresses from shared ones.
+
+struct shared_reloc_proto {
+    u64 window;      // window start of the recording program
+    u64 base;        // the recording object's load base
+    u64 rela_count;
+    u64 plt_count;
+    std::vector<reloc_cache_entry> entries;
+};
+
+// must match the per-namespace stride in application::new_program()
+static constexpr u64 namespace_window_size = u64(1) << 33;
+
+static mutex shared_reloc_mutex;
+static std::unordered_map<std::string, shared_reloc_proto> shared_reloc_protos;
+
+void object::publish_shared_relocations()
+{
+    if (_prog.address_space_start() ==
+            reinterpret_cast<void*>(program_base)) {
+        return;
+    }
+    shared_reloc_proto proto;
+    proto.window = reinterpret_cast<u64>(_prog.address_space_start());
+    proto.base = reinterpret_cast<u64>(_base);
+    if (dynamic_exists(DT_RELA)) {
+        proto.rela_count = dynamic_val(DT_RELASZ) / sizeof(Elf64_Rela);
+        collect_cached_relocations(dynamic_ptr<Elf64_Rela>(DT_RELA),
+                proto.rela_count, _base, proto.entries, true);
+    }
+    if (dynamic_exists(DT_JMPREL)) {
+        proto.plt_count = dynamic_val(DT_PLTRELSZ) / sizeof(Elf64_Rela);
+        collect_cached_relocations(dynamic_ptr<Elf64_Rela>(DT_JMPREL),
+                proto.plt_count, _base, proto.entries, true);
+    }
+    WITH_LOCK(shared_reloc_mutex) {
+        // keep the first publisher's copy; later namespaces replay it
+        shared_reloc_protos.emplace(_pathname, std::move(proto));
+    }
+    elf_debug("Published relocations of %s for other namespaces\n",
+            _pathname.c_str());
+}
+
+bool object::apply_shared_relocations()
+{
+    if (_prog.address_space_start() ==
+            reinterpret_cast<void*>(program_base)) {
+        return false;
+    }
+    auto window = reinterpret_cast<u64>(_prog.address_space_start());
+    auto base = reinterpret_cast<u64>(_base);
+    WITH_LOCK(shared_reloc_mutex) {
+        auto it = shared_reloc_protos.find(_pathname);
+        if (it == shared_reloc_protos.end()) {
+            return false;
+        }
+        auto& proto = it->second;
+        if (base - window != proto.base - proto.window ||
+            proto.rela_count != (dynamic_exists(DT_RELA) ?
+                    dynamic_val(DT_RELASZ) / sizeof(Elf64_Rela) : 0) ||
+            proto.plt_count != (dynamic_exists(DT_JMPREL) ?
+                    dynamic_val(DT_PLTRELSZ) / sizeof(Elf64_Rela) : 0)) {
+            // recorded under a different layout - relocate from scratch
+            return false;
+        }
+        if (has_non_writable_text_relocations()) {
+            make_text_writable(true);
+        }
+        u64 delta = base - proto.base;
+        for (auto& e : proto.entries) {
+            u64 value = e.value;
+            if (value - proto.window < namespace_window_size) {
+                value += delta;
+            }
+            *reinterpret_cast<u64*>(_base + e.offset) = value;
+        }
+        // Recompute the entries the recording left out
+        if (dynamic_exists(DT_RELA)) {
+            auto rela = dynamic_ptr<Elf64_Rela>(DT_RELA);
+            for (auto p = rela; p < rela + proto.rela_count; ++p) {
+                u32 type = p->r_info & 0xffffffff;
+                if (type == ARCH_IRELATIVE || type == ARCH_TPOFF ||
+                    type == ARCH_DTPMOD) {
+                    arch_relocate_rela(type, p->r_info >> 32,
+                            _base + p->r_offset, p->r_addend);
+                }
+            }
+        }
+        if (dynamic_exists(DT_JMPREL)) {
+            setup_pltgot();
+            auto rel = dynamic_ptr<Elf64_Rela>(DT_JMPREL);
+            for (auto p = rel; p < rel + proto.plt_count; ++p) {
+                u32 type = p->r_info & 0xffffffff;
+                void *addr = _base + p->r_offset;
+                if (type == ARCH_IRELATIVE) {
+                    *static_cast<void**>(addr) =
+                        reinterpret_cast<void *(*)()>(_base + p->r_addend)();
+                } else if (type == ARCH_TLSDESC) {
+                    arch_relocate_tls_desc(p->r_info >> 32, addr, p->r_addend);
+                }
+            }
+        }
+        elf_debug("Replayed %ld relocations of %s from another namespace\n",
+                proto.entries.size(), _pathname.c_str());
+    }
+    return true;
+}
+
 void object::relocate()
 {
     assert(!dynamic_exists(DT_REL));
+    if (apply_relocation_cache()) {
+        return;
+    }
+    if (apply_shared_relocations()) {
+        return;
+    }
     if (dynamic_exists(DT_JMPREL)) {
         relocate_pltgot();
     }
     if (dynamic_exists(DT_RELA)) {
         relocate_rela();
     }
+    if (save_relocation_caches) {
+        save_relocation_cache();
+    }
+    publish_shared_relocations();
 }
 
 unsigned long
@@ -879,11 +1273,30 @@ elf64_hash(const char *name)
 
 constexpr Elf64_Versym old_version_symbol_mask = Elf64_Versym(1) << 15;
 
+// Resolve the tables involved in a symbol lookup from the dynamic table
+// once, so lookups do not pay a linear scan of it per table. Idempotent;
+// concurrent first lookups simply store the same values, and the
+// release/acquire pair on _lookup_tables_ready publishes them.
+void object::init_lookup_tables()
+{
+    _symtab = dynamic_exists(DT_SYMTAB) ?
+        dynamic_ptr<Elf64_Sym>(DT_SYMTAB) : nullptr;
+    _strtab = dynamic_exists(DT_STRTAB) ?
+        dynamic_ptr<char>(DT_STRTAB) : nullptr;
+    _gnu_hashtab = dynamic_exists(DT_GNU_HASH) ?
+        dynamic_ptr<Elf64_Word>(DT_GNU_HASH) : nullptr;
+    _sysv_hashtab = dynamic_exists(DT_HASH) ?
+        dynamic_ptr<Elf64_Word>(DT_HASH) : nullptr;
+    _versym = dynamic_exists(DT_VERSYM) ?
+        dynamic_ptr<Elf64_Versym>(DT_VERSYM) : nullptr;
+    _lookup_tables_ready.store(true, std::memory_order_release);
+}
+
 Elf64_Sym* object::lookup_symbol_old(const char* name)
 {
-    auto symtab = dynamic_ptr<Elf64_Sym>(DT_SYMTAB);
-    auto strtab = dynamic_ptr<char>(DT_STRTAB);
-    auto hashtab = dynamic_ptr<Elf64_Word>(DT_HASH);
+    auto symtab = _symtab;
+    auto strtab = _strtab;
+    auto hashtab = _sysv_hashtab;
     auto nbucket = hashtab[0];
     auto buckets = hashtab + 2;
     auto chain = buckets + nbucket;
@@ -910,9 +1323,9 @@ dl_new_hash(const char *s)
 
 Elf64_Sym* object::lookup_symbol_gnu(const char* name, bool self_lookup)
 {
-    auto symtab = dynamic_ptr<Elf64_Sym>(DT_SYMTAB);
-    auto strtab = dynamic_ptr<char>(DT_STRTAB);
-    auto hashtab = dynamic_ptr<Elf64_Word>(DT_GNU_HASH);
+    auto symtab = _symtab;
+    auto strtab = _strtab;
+    auto hashtab = _gnu_hashtab;
     auto nbucket = hashtab[0];
     auto symndx = hashtab[1];
     auto maskwords = hashtab[2];
@@ -923,7 +1336,10 @@ Elf64_Sym* object::lookup_symbol_gnu(const char* name, bool self_lookup)
     auto bword = bloom[(hashval / C) % maskwords];
     auto hashbit1 = hashval % C;
     auto hashbit2 = (hashval >> shift2) % C;
-    if ((bword >> hashbit1) == 0 || (bword >> hashbit2) == 0) {
+    // Both bits have to be set for the symbol to possibly be in this
+    // object; most lookups destined to miss are rejected right here,
+    // without touching the buckets or the symbol names.
+    if (((bword >> hashbit1) & 1) == 0 || ((bword >> hashbit2) & 1) == 0) {
         return nullptr;
     }
     auto buckets = reinterpret_cast<const Elf64_Word*>(bloom + maskwords);
@@ -932,7 +1348,7 @@ Elf64_Sym* object::lookup_symbol_gnu(const char* name, bool self_lookup)
     if (idx == 0) {
         return nullptr;
     }
-    auto version_symtab = (!self_lookup && dynamic_exists(DT_VERSYM)) ? dynamic_ptr<Elf64_Versym>(DT_VERSYM) : nullptr;
+    auto version_symtab = !self_lookup ? _versym : nullptr;
     do {
         if ((chains[idx] & ~1) != (hashval & ~1)) {
             continue;
@@ -952,11 +1368,17 @@ Elf64_Sym* object::lookup_symbol(const char* name, bool self_lookup)
     if (!visible()) {
         return nullptr;
     }
+    if (!_lookup_tables_ready.load(std::memory_order_acquire)) {
+        init_lookup_tables();
+    }
     Elf64_Sym* sym;
-    if (dynamic_exists(DT_GNU_HASH)) {
+    if (_gnu_hashtab) {
         sym = lookup_symbol_gnu(name, self_lookup);
-    } else {
+    } else if (_sysv_hashtab) {
         sym = lookup_symbol_old(name);
+    } else {
+        // No hash table at all - nothing to find in this object
+        return nullptr;
     }
     if (sym && sym->st_shndx == SHN_UNDEF) {
         sym = nullptr;
@@ -1300,7 +1722,8 @@ void create_main_program()
 }
 
 program::program(void* addr)
-    : _next_alloc(addr)
+    : _start(addr)
+    , _next_alloc(addr)
 {
 #ifdef __x86_64__
     void *program_base = (void*)(ELF_IMAGE_START + OSV_KERNEL_VM_SHIFT);
@@ -1461,6 +1884,7 @@ program::load_object(std::string name, std::vector<std::string> extra_path,
         new_modules->adds++;
         _modules_rcu.assign(new_modules.release());
         osv::rcu_dispose(old_modules);
+        invalidate_lookup_cache();
         ef->load_segments();
         ef->process_headers();
         if (ef->is_pic())
@@ -1553,6 +1977,12 @@ void program::remove_object(object *ef)
     osv::rcu_flush();
 
     del_debugger_obj(ef);
+    // Drop the published relocations, if they exist: with no live copy
+    // left the file could be replaced on disk, and the next load should
+    // relocate from scratch and republish.
+    WITH_LOCK(shared_reloc_mutex) {
+        shared_reloc_protos.erase(ef->pathname());
+    }
     // Note that if we race with get_library() of the same library, we may
     // find in _files a new copy of the same library, and mustn't remove it.
     if (_files[ef->pathname()].expired())
@@ -1567,6 +1997,7 @@ void program::remove_object(object *ef)
     new_modules->subs++;
     _modules_rcu.assign(new_modules.release());
     osv::rcu_dispose(old_modules);
+    invalidate_lookup_cache();
 
     ef->unload_needed();
 
@@ -1602,6 +2033,23 @@ symbol_module program::lookup(const char* name, object* seeker)
 {
     trace_elf_lookup(name);
     symbol_module ret(nullptr,nullptr);
+    // The result of a lookup is the same for every caller as long as no
+    // module is restricted to a particular thread and the seeker carries no
+    // symbol version table (which changes how its own symbols match), so in
+    // that case we can memoize it, saving a scan of every module's hash
+    // table on the next lookup of the same name.
+    bool cacheable = _hidden_modules.load(std::memory_order_acquire) == 0 &&
+        (!seeker || !seeker->has_versym());
+    u64 generation = 0;
+    if (cacheable) {
+        WITH_LOCK(_lookup_cache_mutex) {
+            generation = _lookup_cache_generation;
+            auto it = _lookup_cache.find(name);
+            if (it != _lookup_cache.end()) {
+                return it->second;
+            }
+        }
+    }
     with_modules([&](const elf::program::modules_list &ml)
     {
         for (auto module : ml.objects) {
@@ -1611,9 +2059,25 @@ symbol_module program::lookup(const char* name, object* seeker)
             }
         }
     });
+    if (cacheable) {
+        WITH_LOCK(_lookup_cache_mutex) {
+            // Drop the result if the module list changed while we scanned it
+            if (generation == _lookup_cache_generation) {
+                _lookup_cache.emplace(name, ret);
+            }
+        }
+    }
     return ret;
 }
 
+void program::invalidate_lookup_cache()
+{
+    WITH_LOCK(_lookup_cache_mutex) {
+        _lookup_cache.clear();
+        _lookup_cache_generation++;
+    }
+}
+
 symbol_module program::lookup_next(const char* name, const void* retaddr)
 {
     trace_elf_lookup_next(name);
@@ -22,6 +22,8 @@
 
 #include <osv/debug.hh>
 #include <osv/export.h>
+#include <osv/mempool.hh>
+#include <osv/net_busy_poll.hh>
 #include <unordered_map>
 #include <boost/range/algorithm/find.hpp>
 #include <algorithm>
@@ -64,15 +66,30 @@ class epoll_file final : public special_file {
     //    fp->f_lock > _activity_lock
     // we never hold both f_lock and activity_lock.
 
+    // The registration map and activity set allocate a node per insert;
+    // epoll_ctl() and every reported event hit these, so back them with
+    // shared per-type pools instead of the general allocator.
+    using activity_set = std::unordered_set<epoll_key,
+            std::hash<epoll_key>, std::equal_to<epoll_key>,
+            memory::pool_allocator<epoll_key>>;
+
     // protected by f_lock:
-    std::unordered_map<epoll_key, epoll_event> map;
+    std::unordered_map<epoll_key, epoll_event,
+            std::hash<epoll_key>, std::equal_to<epoll_key>,
+            memory::pool_allocator<std::pair<const epoll_key, epoll_event>>> map;
     mutex _activity_lock;
     // below, all protected by _activity_lock:
-    std::unordered_set<epoll_key> _activity;
+    activity_set _activity;
     waitqueue _waiters;
     boost::lockfree::queue<epoll_key, boost::lockfree::fixed_sized<true>> _activity_ring{512};
     std::atomic<bool> _activity_ring_overflow = { false };
     sched::thread_handle _activity_ring_owner;
+    // Cached result of busy_poll_budget(): recomputed lazily after an
+    // epoll_ctl change, so that wait() stays proportional to the number of
+    // ready events rather than scanning the whole interest map (which can
+    // hold tens of thousands of mostly-idle connections) on every cycle.
+    std::atomic<bool> _budget_dirty = { true };
+    unsigned _cached_budget = 0;
 public:
     epoll_file()
         : special_file(0, DTYPE_UNSPEC)
@@ -95,6 +112,7 @@ public:
             }
             map.emplace(key, *event);
             fp->epoll_add({ this, key});
+            _budget_dirty.store(true, std::memory_order_relaxed);
         }
         if (fp->poll(events_epoll_to_poll(event->events))) {
             wake(key);
@@ -111,6 +129,7 @@ public:
                 return ENOENT;
             }
             fp->epoll_add({ this, key });
+            _budget_dirty.store(true, std::memory_order_relaxed);
         }
         if (fp->poll(events_epoll_to_poll(event->events))) {
             wake(key);
@@ -122,12 +141,35 @@ public:
         WITH_LOCK(f_lock) {
             if (map.erase(key)) {
                 key._file->epoll_del({ this, key });
+                _budget_dirty.store(true, std::memory_order_relaxed);
                 return 0;
             } else {
                 return ENOENT;
             }
         }
     }
+    // The largest SO_BUSY_POLL budget (in microseconds) requested by any
+    // of the sockets in this epoll set, 0 if none enables busy polling.
+    // The map scan only runs after the set changed; a setsockopt() on an
+    // already-registered socket takes effect on its next epoll_ctl.
+    unsigned busy_poll_budget()
+    {
+        if (!_budget_dirty.load(std::memory_order_relaxed)) {
+            return _cached_budget;
+        }
+        int budget = 0;
+        WITH_LOCK(f_lock) {
+            _budget_dirty.store(false, std::memory_order_relaxed);
+            for (auto& e : map) {
+                auto b = so_busy_poll_budget(e.first._file);
+                if (b > budget) {
+                    budget = b;
+                }
+            }
+            _cached_budget = budget;
+        }
+        return budget;
+    }
     int wait(struct epoll_event *events, int maxevents, int timeout_ms)
     {
         auto tmo = parse_poll_timeout(timeout_ms);
@@ -136,6 +178,27 @@ public:
             tmr.set(*tmo);
         }
         int nr = 0;
+        // SO_BUSY_POLL: spin on the NIC rx rings before blocking, like
+        // poll() does. New events reach us through _activity_ring, which
+        // we can watch without taking _activity_lock; events already in
+        // _activity make the spin unnecessary, so skip it for them.
+        if (tmo) {
+            auto budget = busy_poll_budget();
+            if (budget) {
+                bool have_activity;
+                WITH_LOCK(_activity_lock) {
+                    flush_activity_ring();
+                    have_activity = !_activity.empty();
+                }
+                if (!have_activity) {
+                    osv::net_busy_poll::spin(budget, [this] {
+                        return !_activity_ring.empty() ||
+                               _activity_ring_overflow.load(
+                                       std::memory_order_relaxed);
+                    });
+                }
+            }
+        }
         WITH_LOCK(_activity_lock) {
             while (!tmr.expired() && nr == 0) {
                 if (tmo) {
@@ -174,7 +237,7 @@ public:
         }
         return nr;
     }
-    int process_activity(std::unordered_set<epoll_key>& activity,
+    int process_activity(activity_set& activity,
                          epoll_event* events, int maxevents) {
         int nr = 0;
         WITH_LOCK(f_lock) {
@@ -0,0 +1,163 @@
+/*
+ * Copyright (C) 2026 Waldemar Kozaczuk
+ *
+ * This work is open source software, licensed under the terms of the
+ * BSD license as described in the LICENSE file in the top-level directory.
+ */
+
+#include <osv/hazard-ptr.hh>
+#include <osv/percpu.hh>
+#include <osv/mempool.hh>
+#include <osv/mutex.h>
+#include <osv/sched.hh>
+#include <vector>
+#include <algorithm>
+
+namespace osv {
+namespace hazard {
+
+// All records ever allocated, never freed - see the comment in the
+// header. New records are pushed with a CAS; readers only ever follow
+// next pointers, which are immutable once a record is linked in.
+static std::atomic<record*> records_head;
+
+record* acquire_record()
+{
+    for (auto rec = records_head.load(std::memory_order_acquire); rec;
+            rec = rec->next) {
+        bool expected = false;
+        if (!rec->active.load(std::memory_order_relaxed) &&
+                rec->active.compare_exchange_strong(expected, true,
+                        std::memory_order_acquire)) {
+            return rec;
+        }
+    }
+    auto rec = new record;
+    rec->active.store(true, std::memory_order_relaxed);
+    rec->next = records_head.load(std::memory_order_relaxed);
+    while (!records_head.compare_exchange_weak(rec->next, rec,
+            std::memory_order_release)) {
+        // rec->next reloaded by compare_exchange
+    }
+    return rec;
+}
+
+void release_record(record* rec)
+{
+    rec->ptr.store(nullptr, std::memory_order_release);
+    rec->active.store(false, std::memory_order_release);
+}
+
+struct retired_item {
+    const void* obj;
+    size_t size;
+    void (*dispose)(const void*);
+    retired_item* next;
+};
+
+// Retired objects await scanning on per-cpu lists, so retiring doesn't
+// touch memory shared with the other cpus; the scan harvests all of
+// them. Only the owning cpu pushes, but CAS on both ends since a scan
+// on another cpu may pop the whole list at any time.
+static dynamic_percpu<std::atomic<retired_item*>> retired_lists;
+static std::atomic<size_t> retired_objects;
+static std::atomic<size_t> retired_size;
+static mutex scan_lock;
+
+// Scan once this many objects await reclamation. Low enough to keep the
+// backlog small, high enough to amortize walking the record list.
+static constexpr size_t scan_threshold = 128;
+
+// The shrinker gives the memory reclaimer visibility into (and a lever
+// over) the retired backlog. Registered lazily on the first retire() -
+// shrinkers hook into the reclaimer thread, which does not exist yet
+// when static constructors run.
+class hazard_shrinker : public memory::shrinker {
+public:
+    hazard_shrinker() : shrinker("hazard") {}
+    size_t request_memory(size_t n, bool hard) {
+        auto before = retired_size.load(std::memory_order_relaxed);
+        flush();
+        auto after = retired_size.load(std::memory_order_relaxed);
+        return before > after ? before - after : 0;
+    }
+};
+
+static void scan()
+{
+    // Pairs with the fence in holder::protect(): every slot published
+    // before a retired object was unlinked is visible to us.
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    std::vector<const void*> hazards;
+    for (auto rec = records_head.load(std::memory_order_acquire); rec;
+            rec = rec->next) {
+        auto p = rec->ptr.load(std::memory_order_acquire);
+        if (p) {
+            hazards.push_back(p);
+        }
+    }
+    std::sort(hazards.begin(), hazards.end());
+
+    for (auto cpu : sched::cpus) {
+        auto& list = *retired_lists.for_cpu(cpu);
+        auto item = list.exchange(nullptr, std::memory_order_acquire);
+        while (item) {
+            auto next = item->next;
+            if (std::binary_search(hazards.begin(), hazards.end(),
+                    item->obj)) {
+                // Still protected - put it back for the next scan.
+                item->next = list.load(std::memory_order_relaxed);
+                while (!list.compare_exchange_weak(item->next, item,
+                        std::memory_order_release)) {
+                }
+            } else {
+                retired_objects.fetch_sub(1, std::memory_order_relaxed);
+                retired_size.fetch_sub(item->size,
+                        std::memory_order_relaxed);
+                item->dispose(item->obj);
+                delete item;
+            }
+            item = next;
+        }
+    }
+}
+
+void retire(const void* obj, size_t size, void (*dispose)(const void*))
+{
+    static hazard_shrinker* shrinker;
+
+    auto item = new retired_item{obj, size, dispose, nullptr};
+    auto& list = *retired_lists;
+    item->next = list.load(std::memory_order_relaxed);
+    while (!list.compare_exchange_weak(item->next, item,
+            std::memory_order_release)) {
+    }
+    retired_size.fetch_add(size, std::memory_order_relaxed);
+    if (retired_objects.fetch_add(1, std::memory_order_relaxed) + 1
+            < scan_threshold) {
+        return;
+    }
+    // Backlog crossed the threshold; scan unless somebody already is.
+    if (scan_lock.try_lock()) {
+        if (!shrinker) {
+            shrinker = new hazard_shrinker;
+        }
+        scan();
+        scan_lock.unlock();
+    }
+}
+
+size_t deferred_bytes()
+{
+    return retired_size.load(std::memory_order_relaxed);
+}
+
+void flush()
+{
+    WITH_LOCK(scan_lock) {
+        scan();
+    }
+}
+
+}
+}
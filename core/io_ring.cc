@@ -0,0 +1,277 @@
+/*
+ * Copyright (C) 2026 Waldemar Kozaczuk
+ *
+ * This work is open source software, licensed under the terms of the
+ * BSD license as described in the LICENSE file in the top-level directory.
+ */
+
+// OSv-native asynchronous block I/O rings, see <osv/io_ring.h>.
+//
+// The submission side is single-producer (the application thread) and
+// single-consumer (the per-ring service thread), so the two only talk
+// through the head/tail indices - the application publishes entries with
+// a release store of the tail, the service thread claims them with an
+// acquire load. The completion side is fed from the driver's completion
+// thread under a small lock (it also covers the reaper's waitqueue), and
+// is sized at twice the submission ring so that completed-but-unreaped
+// entries can never overflow it: at most sq entries are in flight and at
+// most sq entries sit reaped-pending at any moment.
+
+#include <osv/io_ring.h>
+#include <osv/bio.h>
+#include <osv/device.h>
+#include <osv/prex.h>
+#include <osv/sched.hh>
+#include <osv/mutex.h>
+#include <osv/waitqueue.hh>
+#include <osv/export.h>
+
+#include <atomic>
+#include <new>
+#include <vector>
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+
+struct osv_io_ring {
+    struct device *dev;
+    unsigned sq_mask;           // sq entries - 1, power of two
+    unsigned cq_mask;           // 2 * sq entries - 1
+
+    // Submission ring: filled by the application, drained by _service
+    struct osv_io_sqe *sqes;
+    unsigned sq_prepared;       // entries claimed by get_sqe, app thread only
+    std::atomic<unsigned> sq_head;
+    std::atomic<unsigned> sq_tail;
+    mutex sq_lock;              // service thread sleep/wake only
+    waitqueue sq_waitq;
+
+    // Completion ring: filled by the driver completion path, drained by
+    // getevents
+    struct osv_io_cqe *cqes;
+    std::atomic<unsigned> cq_head;
+    std::atomic<unsigned> cq_tail;
+    mutex cq_lock;
+    waitqueue cq_waitq;
+
+    std::atomic<bool> stopping = {false};
+    sched::thread *service = nullptr;
+};
+
+// One per in-flight bio; bio_caller1 points here (bio_private belongs to
+// the low-level driver - nvme keeps its PRP list there).
+struct io_ring_req {
+    osv_io_ring *ring;
+    uint64_t user_data;
+    uint64_t len;
+};
+
+static void io_ring_post_cqe(osv_io_ring *r, uint64_t user_data, int64_t res)
+{
+    WITH_LOCK(r->cq_lock) {
+        auto tail = r->cq_tail.load(std::memory_order_relaxed);
+        auto *cqe = &r->cqes[tail & r->cq_mask];
+        cqe->user_data = user_data;
+        cqe->res = res;
+        r->cq_tail.store(tail + 1, std::memory_order_release);
+        r->cq_waitq.wake_all(r->cq_lock);
+    }
+}
+
+// Runs in the driver's completion thread, right after the batched
+// biodone() pass drained the device queue.
+static void io_ring_bio_done(struct bio *b)
+{
+    auto *req = static_cast<io_ring_req*>(b->bio_caller1);
+    auto *r = req->ring;
+    int64_t res = (b->bio_flags & BIO_ERROR) ? -EIO : (int64_t)req->len;
+    destroy_bio(b);
+
+    io_ring_post_cqe(r, req->user_data, res);
+    delete req;
+}
+
+// Per-ring service thread: drain whatever the application published,
+// turn it into a chain of bios and hand the chain to the driver with a
+// single doorbell (see bio_list_strategy()).
+static void io_ring_service(osv_io_ring *r)
+{
+    std::vector<struct bio*> chain;
+    chain.reserve(r->sq_mask + 1);
+
+    for (;;) {
+        WITH_LOCK(r->sq_lock) {
+            while (r->sq_head.load(std::memory_order_relaxed) ==
+                   r->sq_tail.load(std::memory_order_relaxed) &&
+                   !r->stopping.load(std::memory_order_relaxed)) {
+                r->sq_waitq.wait(r->sq_lock);
+            }
+        }
+        if (r->stopping.load(std::memory_order_relaxed)) {
+            break;
+        }
+
+        auto head = r->sq_head.load(std::memory_order_relaxed);
+        auto tail = r->sq_tail.load(std::memory_order_acquire);
+        chain.clear();
+
+        for (; head != tail; head++) {
+            auto *sqe = &r->sqes[head & r->sq_mask];
+
+            uint8_t cmd;
+            switch (sqe->opcode) {
+            case OSV_IO_OP_READ:
+                cmd = BIO_READ;
+                break;
+            case OSV_IO_OP_WRITE:
+                cmd = BIO_WRITE;
+                break;
+            case OSV_IO_OP_FLUSH:
+                cmd = BIO_FLUSH;
+                break;
+            default:
+                io_ring_post_cqe(r, sqe->user_data, -EINVAL);
+                continue;
+            }
+
+            auto *bio = alloc_bio();
+            auto *req = bio ? new (std::nothrow) io_ring_req : nullptr;
+            if (!req) {
+                destroy_bio(bio);
+                io_ring_post_cqe(r, sqe->user_data, -ENOMEM);
+                continue;
+            }
+            req->ring = r;
+            req->user_data = sqe->user_data;
+            req->len = sqe->len;
+
+            bio->bio_cmd = cmd;
+            bio->bio_dev = r->dev;
+            bio->bio_data = sqe->addr;
+            bio->bio_offset = sqe->offset;
+            bio->bio_bcount = sqe->len;
+            bio->bio_caller1 = req;
+            bio->bio_done = io_ring_bio_done;
+            chain.push_back(bio);
+        }
+        // The entries are consumed - the application may reuse the slots
+        r->sq_head.store(head, std::memory_order_release);
+
+        if (!chain.empty()) {
+            bio_list_strategy(chain.data(), chain.size());
+        }
+    }
+}
+
+extern "C" OSV_LIBC_API
+osv_io_ring_t *osv_io_ring_create(const char *devname, unsigned entries)
+{
+    if (!entries) {
+        errno = EINVAL;
+        return nullptr;
+    }
+    unsigned sq_size = 1;
+    while (sq_size < entries) {
+        sq_size <<= 1;
+    }
+
+    struct device *dev;
+    int error = device_open(devname, DO_RDWR, &dev);
+    if (error) {
+        errno = error;
+        return nullptr;
+    }
+
+    auto *r = new (std::nothrow) osv_io_ring();
+    if (!r) {
+        device_close(dev);
+        errno = ENOMEM;
+        return nullptr;
+    }
+    r->dev = dev;
+    r->sq_mask = sq_size - 1;
+    r->cq_mask = 2 * sq_size - 1;
+    r->sq_prepared = 0;
+    r->sq_head = 0;
+    r->sq_tail = 0;
+    r->cq_head = 0;
+    r->cq_tail = 0;
+    r->sqes = (struct osv_io_sqe *)calloc(sq_size, sizeof(struct osv_io_sqe));
+    r->cqes = (struct osv_io_cqe *)calloc(2 * sq_size, sizeof(struct osv_io_cqe));
+    if (!r->sqes || !r->cqes) {
+        free(r->sqes);
+        free(r->cqes);
+        device_close(dev);
+        delete r;
+        errno = ENOMEM;
+        return nullptr;
+    }
+
+    r->service = sched::thread::make([r] { io_ring_service(r); },
+            sched::thread::attr().name("io_ring"));
+    r->service->start();
+    return r;
+}
+
+extern "C" OSV_LIBC_API
+void osv_io_ring_destroy(osv_io_ring_t *r)
+{
+    r->stopping.store(true, std::memory_order_relaxed);
+    WITH_LOCK(r->sq_lock) {
+        r->sq_waitq.wake_all(r->sq_lock);
+    }
+    r->service->join();
+    delete r->service;
+
+    device_close(r->dev);
+    free(r->sqes);
+    free(r->cqes);
+    delete r;
+}
+
+extern "C" OSV_LIBC_API
+struct osv_io_sqe *osv_io_ring_get_sqe(osv_io_ring_t *r)
+{
+    if (r->sq_prepared - r->sq_head.load(std::memory_order_acquire) >
+            r->sq_mask) {
+        return nullptr;     // ring full, reap completions to make room
+    }
+    return &r->sqes[r->sq_prepared++ & r->sq_mask];
+}
+
+extern "C" OSV_LIBC_API
+int osv_io_ring_submit(osv_io_ring_t *r)
+{
+    auto tail = r->sq_tail.load(std::memory_order_relaxed);
+    int count = r->sq_prepared - tail;
+    if (count == 0) {
+        return 0;
+    }
+    r->sq_tail.store(r->sq_prepared, std::memory_order_release);
+    WITH_LOCK(r->sq_lock) {
+        r->sq_waitq.wake_all(r->sq_lock);
+    }
+    return count;
+}
+
+extern "C" OSV_LIBC_API
+int osv_io_ring_getevents(osv_io_ring_t *r, struct osv_io_cqe *cqes,
+                          int min, int max)
+{
+    int n = 0;
+    WITH_LOCK(r->cq_lock) {
+        for (;;) {
+            auto head = r->cq_head.load(std::memory_order_relaxed);
+            auto tail = r->cq_tail.load(std::memory_order_acquire);
+            while (head != tail && n < max) {
+                cqes[n++] = r->cqes[head++ & r->cq_mask];
+            }
+            r->cq_head.store(head, std::memory_order_release);
+            if (n >= min || n == max) {
+                break;
+            }
+            r->cq_waitq.wait(r->cq_lock);
+        }
+    }
+    return n;
+}
@@ -9,12 +9,14 @@
 #include <osv/trace.hh>
 #include <osv/sched.hh>
 #include <osv/wait_record.hh>
+#include <osv/lockstat.hh>
 #include <osv/export.h>
 
 namespace lockfree {
 
 TRACEPOINT(trace_mutex_lock, "%p", mutex *);
 TRACEPOINT(trace_mutex_lock_wait, "%p", mutex *);
+TRACEPOINT(trace_mutex_lock_spun, "%p, spins=%d", mutex *, unsigned);
 TRACEPOINT(trace_mutex_lock_wake, "%p", mutex *);
 TRACEPOINT(trace_mutex_try_lock, "%p, success=%d", mutex *, bool);
 TRACEPOINT(trace_mutex_unlock, "%p", mutex *);
@@ -46,7 +48,40 @@ void mutex::lock()
         return;
     }
 
-    // If we're here still here the lock is owned by a different thread.
+    // If we're still here the lock is owned by a different thread. For
+    // critical sections much shorter than the cost of two context switches
+    // (the memory pools and the dentry hash are typical holders) it pays to
+    // poll the lock briefly before parking. Our count increment above
+    // already forces the concurrent unlock() into its slow path, and since
+    // we haven't queued a wait record yet, that slow path publishes a
+    // handoff token - so polling the handoff is how a spinner acquires the
+    // lock. We give up early if other waiters are already parked (unlock()
+    // will pop those instead of publishing a handoff), and don't spin at
+    // all on a uniprocessor, where the owner cannot be running.
+    if (sched::cpus.size() > 1) {
+        constexpr unsigned max_spins = 100;
+        for (unsigned spins = 0; spins < max_spins && waitqueue.empty();
+                ++spins) {
+            auto old_handoff = handoff.load();
+            if (old_handoff &&
+                    handoff.compare_exchange_strong(old_handoff, 0U)) {
+                // A concurrent unlock() handed the mutex off to us. Like
+                // in the post-push handoff path below, our earlier count
+                // increment now counts as the holder's reference.
+                trace_mutex_lock_spun(this, spins);
+                owner.store(current, std::memory_order_relaxed);
+                depth = 1;
+                return;
+            }
+#ifdef __x86_64__
+            __asm __volatile("pause");
+#endif
+#ifdef __aarch64__
+            __asm __volatile("isb sy");
+#endif
+        }
+    }
+
     // Put this thread in a waiting queue, so it will eventually be woken
     // when another thread releases the lock.
     // Note "waiter" is on the stack, so we must not return before making sure
@@ -86,7 +121,9 @@ void mutex::lock()
 
     // Wait until another thread pops us from the wait queue and wakes us up.
     trace_mutex_lock_wait(this);
+    auto wait_start = lock_stats::wait_begin();
     waiter.wait();
+    lock_stats::wait_end(this, __builtin_return_address(0), wait_start);
     trace_mutex_lock_wake(this);
     owner.store(current, std::memory_order_relaxed);
     depth = 1;
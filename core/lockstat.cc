@@ -0,0 +1,170 @@
+/*
+ * Copyright (C) 2026 Waldemar Kozaczuk
+ *
+ * This work is open source software, licensed under the terms of the
+ * BSD license as described in the LICENSE file in the top-level directory.
+ */
+
+#include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <memory>
+#include <vector>
+
+#include <osv/lockstat.hh>
+#include <osv/clock.hh>
+#include <osv/percpu.hh>
+#include <osv/sched.hh>
+#include <osv/demangle.hh>
+#include <osv/printf.hh>
+
+namespace lock_stats {
+
+// One slot per (lock, waiter pc) pair, per cpu. The tables are open
+// addressed and lock-free: slots are claimed with a compare-exchange and
+// the counters are relaxed atomics, so accounting stays safe even if the
+// waking thread migrates mid-probe.
+static constexpr unsigned table_size = 512; // power of two
+static constexpr unsigned max_probes = 32;
+
+struct entry {
+    void* lock;
+    void* pc;
+    // 0 - free, 1 - being claimed, 2 - valid
+    std::atomic<u32> state;
+    std::atomic<u64> count;
+    std::atomic<u64> total_ns;
+    std::atomic<u64> max_ns;
+};
+
+static dynamic_percpu<std::unique_ptr<entry[]>> _tables;
+static std::atomic<bool> _enabled {false};
+static std::atomic<u64> _dropped;
+
+void enable(bool on)
+{
+    if (on) {
+        for (auto c : sched::cpus) {
+            auto* table = _tables.for_cpu(c);
+            if (!*table) {
+                table->reset(new entry[table_size]());
+            }
+        }
+    }
+    _enabled.store(on);
+}
+
+bool enabled()
+{
+    return _enabled.load(std::memory_order_relaxed);
+}
+
+u64 wait_begin()
+{
+    if (!__builtin_expect(_enabled.load(std::memory_order_relaxed), false)) {
+        return 0;
+    }
+    return osv::clock::uptime::now().time_since_epoch().count();
+}
+
+void wait_end(void* lock, void* pc, u64 begin)
+{
+    if (!begin) {
+        return;
+    }
+    u64 now = osv::clock::uptime::now().time_since_epoch().count();
+    u64 wait_ns = now > begin ? now - begin : 0;
+    auto& table = *_tables;
+    if (!table) {
+        return;
+    }
+    u64 hash = 0xcbf29ce484222325ull;
+    hash ^= reinterpret_cast<uintptr_t>(lock);
+    hash *= 0x100000001b3ull;
+    hash ^= reinterpret_cast<uintptr_t>(pc);
+    hash *= 0x100000001b3ull;
+    auto idx = hash & (table_size - 1);
+    for (unsigned probe = 0; probe < max_probes; probe++) {
+        auto& e = table[idx];
+        auto state = e.state.load(std::memory_order_acquire);
+        if (state == 0) {
+            u32 expected = 0;
+            if (e.state.compare_exchange_strong(expected, 1)) {
+                e.lock = lock;
+                e.pc = pc;
+                e.state.store(2, std::memory_order_release);
+                state = 2;
+            } else {
+                state = expected;
+            }
+        }
+        if (state == 2 && e.lock == lock && e.pc == pc) {
+            e.count.fetch_add(1, std::memory_order_relaxed);
+            e.total_ns.fetch_add(wait_ns, std::memory_order_relaxed);
+            auto max = e.max_ns.load(std::memory_order_relaxed);
+            while (wait_ns > max &&
+                   !e.max_ns.compare_exchange_weak(max, wait_ns)) {
+            }
+            return;
+        }
+        idx = (idx + 1) & (table_size - 1);
+    }
+    _dropped.fetch_add(1, std::memory_order_relaxed);
+}
+
+std::string dump()
+{
+    struct merged {
+        void* lock;
+        void* pc;
+        u64 count;
+        u64 total_ns;
+        u64 max_ns;
+    };
+    std::vector<merged> sites;
+    for (auto c : sched::cpus) {
+        auto* table = _tables.for_cpu(c);
+        if (!*table) {
+            continue;
+        }
+        for (unsigned i = 0; i < table_size; i++) {
+            auto& e = (*table)[i];
+            if (e.state.load(std::memory_order_acquire) != 2) {
+                continue;
+            }
+            auto found = std::find_if(sites.begin(), sites.end(),
+                [&e] (const merged& m) {
+                    return m.lock == e.lock && m.pc == e.pc;
+                });
+            if (found == sites.end()) {
+                sites.push_back({e.lock, e.pc,
+                    e.count.load(std::memory_order_relaxed),
+                    e.total_ns.load(std::memory_order_relaxed),
+                    e.max_ns.load(std::memory_order_relaxed)});
+            } else {
+                found->count += e.count.load(std::memory_order_relaxed);
+                found->total_ns += e.total_ns.load(std::memory_order_relaxed);
+                found->max_ns = std::max(found->max_ns,
+                    e.max_ns.load(std::memory_order_relaxed));
+            }
+        }
+    }
+    std::sort(sites.begin(), sites.end(),
+        [] (const merged& a, const merged& b) {
+            return a.total_ns > b.total_ns;
+        });
+    std::string out;
+    char name[1024];
+    for (auto& s : sites) {
+        osv::lookup_name_demangled(s.pc, name, sizeof(name));
+        out += osv::sprintf("lock %p waits %lu total_ns %lu max_ns %lu at %s\n",
+            s.lock, s.count, s.total_ns, s.max_ns, name);
+    }
+    auto dropped = _dropped.load(std::memory_order_relaxed);
+    if (dropped) {
+        out += osv::sprintf("dropped %lu\n", dropped);
+    }
+    return out;
+}
+
+}
@@ -20,6 +20,7 @@
 #include <osv/alloctracker.hh>
 #include <atomic>
 #include <osv/mmu.hh>
+#include <osv/numa.hh>
 #include <osv/trace.hh>
 #include <lockfree/ring.hh>
 #include <osv/percpu-worker.hh>
@@ -33,6 +34,9 @@
 #include <osv/dbg-alloc.hh>
 #include <osv/migration-lock.hh>
 #include <osv/export.h>
+#include <osv/execinfo.hh>
+#include <osv/demangle.hh>
+#include <osv/printf.hh>
 
 // recent Boost gets confused by the "hidden" macro we add in some Musl
 // header files, so need to undefine it
@@ -54,6 +58,7 @@ TRACEPOINT(trace_memory_realloc, "in=%p, newlen=%d, out=%p", void *, size_t, voi
 TRACEPOINT(trace_memory_page_alloc, "page=%p", void*);
 TRACEPOINT(trace_memory_page_free, "page=%p", void*);
 TRACEPOINT(trace_memory_huge_failure, "page ranges=%d", unsigned long);
+TRACEPOINT(trace_memory_page_pool_compaction, "drained %d pages from l2", size_t);
 TRACEPOINT(trace_memory_reclaim, "shrinker %s, target=%d, delta=%d", const char *, long, long);
 TRACEPOINT(trace_memory_wait, "allocation size=%d", size_t);
 
@@ -76,6 +81,132 @@ size_t phys_mem_size;
 // allocation. Don't set tracker_enabled before tracker is fully constructed.
 alloc_tracker tracker;
 bool tracker_enabled = false;
+// Sampled allocation profiler (see /proc/alloc_profile). Unlike the
+// alloc_tracker above, it is cheap enough to stay on in production:
+// roughly one allocation per sample_interval bytes allocated per cpu is
+// recorded with its call chain, aggregated by allocation site into a
+// fixed size lock-free table. Frees are not matched against sites - that
+// would need per-allocation metadata - so the profile is cumulative:
+// the site whose bytes keep climbing is the one growing the guest.
+namespace alloc_profiler {
+
+static constexpr unsigned max_depth = 10;
+static constexpr unsigned table_size = 2048; // power of two
+static constexpr unsigned max_probes = 64;
+
+struct site {
+    void* frames[max_depth];
+    u32 depth;
+    // 0 - free, 1 - being claimed, 2 - frames valid
+    std::atomic<u32> state;
+    std::atomic<u64> count;
+    std::atomic<u64> bytes;
+};
+
+static site* table;
+static std::atomic<bool> _enabled {false};
+static size_t sample_interval = 1024 * 1024;
+static PERCPU(ssize_t, bytes_until_sample);
+static std::atomic<u64> _dropped;
+
+static void record(size_t size)
+{
+    void* bt[max_depth];
+    int depth = backtrace_safe(bt, max_depth);
+    if (depth <= 0) {
+        return;
+    }
+    u64 hash = 0xcbf29ce484222325ull;
+    for (int i = 0; i < depth; i++) {
+        hash ^= reinterpret_cast<uintptr_t>(bt[i]);
+        hash *= 0x100000001b3ull;
+    }
+    auto idx = hash & (table_size - 1);
+    for (unsigned probe = 0; probe < max_probes; probe++) {
+        auto& e = table[idx];
+        auto state = e.state.load(std::memory_order_acquire);
+        if (state == 0) {
+            u32 expected = 0;
+            if (e.state.compare_exchange_strong(expected, 1)) {
+                memcpy(e.frames, bt, depth * sizeof(void*));
+                e.depth = depth;
+                e.state.store(2, std::memory_order_release);
+                state = 2;
+            } else {
+                state = expected;
+            }
+        }
+        if (state == 2 && e.depth == unsigned(depth) &&
+            !memcmp(e.frames, bt, depth * sizeof(void*))) {
+            e.count.fetch_add(1, std::memory_order_relaxed);
+            e.bytes.fetch_add(size, std::memory_order_relaxed);
+            return;
+        }
+        idx = (idx + 1) & (table_size - 1);
+    }
+    _dropped.fetch_add(1, std::memory_order_relaxed);
+}
+
+static inline void observe(size_t size)
+{
+    if (!__builtin_expect(_enabled.load(std::memory_order_relaxed), false)) {
+        return;
+    }
+    if (!smp_allocator) {
+        return;
+    }
+    // A racy migration between the decrement and the reset just perturbs
+    // the sampling phase, which is harmless
+    auto& remaining = *bytes_until_sample;
+    remaining -= size;
+    if (remaining > 0) {
+        return;
+    }
+    remaining = sample_interval;
+    record(size);
+}
+
+void enable(size_t sample_interval_bytes)
+{
+    if (!table) {
+        table = new site[table_size]();
+    }
+    if (sample_interval_bytes) {
+        sample_interval = sample_interval_bytes;
+    }
+    _enabled.store(true);
+}
+
+std::string dump()
+{
+    std::string out;
+    if (!table) {
+        return out;
+    }
+    out += osv::sprintf("sample_interval_bytes %lu\n", sample_interval);
+    for (unsigned i = 0; i < table_size; i++) {
+        auto& e = table[i];
+        if (e.state.load(std::memory_order_acquire) != 2) {
+            continue;
+        }
+        out += osv::sprintf("count %lu bytes %lu\n",
+            e.count.load(std::memory_order_relaxed),
+            e.bytes.load(std::memory_order_relaxed));
+        char name[1024];
+        for (unsigned f = 0; f < e.depth; f++) {
+            osv::lookup_name_demangled(e.frames[f], name, sizeof(name));
+            out += osv::sprintf("  %p <%s>\n", e.frames[f], name);
+        }
+    }
+    auto dropped = _dropped.load(std::memory_order_relaxed);
+    if (dropped) {
+        out += osv::sprintf("dropped %lu\n", dropped);
+    }
+    return out;
+}
+
+}
+
 static inline void tracker_remember(void *addr, size_t size)
 {
     // Check if tracker_enabled is true, but expect (be quicker in the case)
@@ -83,6 +214,7 @@ static inline void tracker_remember(void *addr, size_t size)
     if (__builtin_expect(tracker_enabled, false)) {
         tracker.remember(addr, size);
     }
+    alloc_profiler::observe(size);
 }
 static inline void tracker_forget(void *addr)
 {
@@ -121,13 +253,42 @@ PCPU_WORKERITEM(garbage_collector, garbage_collector_fn);
 class garbage_sink {
 private:
     static const int signal_threshold = 256;
+    // Even though the queue itself is lock-free, every push is still a
+    // cas on a cache line the consumer cpu keeps pulling away, so a
+    // producer/consumer pipeline freeing remotely at a high rate pays a
+    // cache-to-cache transfer per object. Frees are therefore staged in
+    // a producer-private chain first (each sink has a single producer
+    // cpu, and free() runs under preempt_lock) and linked into the
+    // shared queue with one cas per batch.
+    static const int batch_size = 32;
+    free_object* staged {};
+    free_object* staged_tail {};
+    int nstaged {};
     lockfree::unordered_queue_mpsc<free_object> queue;
     int pushed_since_last_signal {};
 public:
     void free(unsigned obj_cpu, free_object* obj)
     {
-        queue.push(obj);
-        if (++pushed_since_last_signal > signal_threshold) {
+        obj->next = staged;
+        if (!staged) {
+            staged_tail = obj;
+        }
+        staged = obj;
+        if (++nstaged >= batch_size) {
+            flush(obj_cpu);
+        }
+    }
+
+    void flush(unsigned obj_cpu)
+    {
+        if (!nstaged) {
+            return;
+        }
+        queue.push_many(staged, staged_tail);
+        pushed_since_last_signal += nstaged;
+        staged = staged_tail = nullptr;
+        nstaged = 0;
+        if (pushed_since_last_signal > signal_threshold) {
             garbage_collector.signal(sched::cpus[obj_cpu]);
             pushed_since_last_signal = 0;
         }
@@ -141,12 +302,29 @@ public:
 
 static garbage_sink ***pcpu_free_list;
 
+// Push this cpu's staged remote frees out to their owners' queues, so
+// partially filled batches don't park memory indefinitely.
+// Must be called with preemption disabled.
+static void flush_remote_free_batches()
+{
+    unsigned cur_cpu = mempool_cpuid();
+    for (unsigned i = 0; i < sched::cpus.size(); i++) {
+        if (i != cur_cpu) {
+            pcpu_free_list[i][cur_cpu]->flush(i);
+        }
+    }
+}
+
 void pool::collect_garbage()
 {
     assert(!sched::preemptable());
 
     unsigned cpu_id = mempool_cpuid();
 
+    // a collection pass is also a convenient periodic point to make this
+    // cpu's own staged remote frees visible to their owners
+    flush_remote_free_batches();
+
     for (unsigned i = 0; i < sched::cpus.size(); i++) {
         auto sink = pcpu_free_list[cpu_id][i];
         free_object* obj;
@@ -192,15 +370,37 @@ static void garbage_collector_fn()
 // contains page ranges large enough. If there is no such list then it is a
 // worst-fit allocation form the page ranges in the tree.
 
+// All live pools - the malloc size classes and any dedicated typed_pools -
+// registered for stats::get_object_pool_stats(). A function-local static
+// keeps the list safe to use from pool constructors running during static
+// initialization.
+using pool_registry_type = bi::list<pool,
+                                    bi::member_hook<pool,
+                                                    bi::list_member_hook<>,
+                                                    &pool::registry_hook>,
+                                    bi::constant_time_size<false>>;
+static pool_registry_type& pool_registry()
+{
+    static pool_registry_type registry;
+    return registry;
+}
+static mutex pool_registry_lock;
+
 pool::pool(unsigned size)
     : _size(size)
     , _free()
 {
     assert(size + sizeof(page_header) <= page_size);
+    WITH_LOCK(pool_registry_lock) {
+        pool_registry().push_back(*this);
+    }
 }
 
 pool::~pool()
 {
+    WITH_LOCK(pool_registry_lock) {
+        pool_registry().erase(pool_registry().iterator_to(*this));
+    }
 }
 
 const size_t pool::max_object_size = page_size / 4;
@@ -246,6 +446,7 @@ void* pool::alloc()
         if (!header->local_free) {
             _free->erase(it);
         }
+        ++_stats->allocs;
         ret = obj;
     }
 
@@ -279,11 +480,24 @@ void pool::add_page()
         header->owner = this;
         header->nalloc = 0;
         header->local_free = nullptr;
-        for (auto p = page + page_size - _size; p >= header + 1; p -= _size) {
+        // Slab coloring: shift each page's objects by a different multiple
+        // of a cache line within the page's slack space, so the same-index
+        // object on different pages (often the hottest) doesn't compete for
+        // the same cache sets. The step is at least the largest power of
+        // two dividing the object size, preserving the natural alignment
+        // pool allocations are expected to provide.
+        size_t step = std::max(size_t(64), size_t(_size & ~(_size - 1)));
+        size_t slack = (page_size - sizeof(page_header)) % _size;
+        size_t ncolors = slack / step + 1;
+        size_t color = _color.fetch_add(1, std::memory_order_relaxed)
+                % ncolors * step;
+        for (auto p = page + page_size - _size - color; p >= header + 1;
+                p -= _size) {
             auto obj = static_cast<free_object*>(p);
             obj->next = header->local_free;
             header->local_free = obj;
         }
+        ++_stats->pages;
         _free->push_back(*header);
         if (_free->empty()) {
             /* encountered when starting to enable TLS for AArch64 in mixed
@@ -308,6 +522,7 @@ void pool::free_same_cpu(free_object* obj, unsigned cpu_id)
         if (header->local_free) {
             _free->erase(_free->iterator_to(*header));
         }
+        --_stats->pages;
         DROP_LOCK(preempt_lock) {
             untracked_free_page(header);
         }
@@ -349,6 +564,7 @@ void pool::free(void* object)
         page_header* header = to_header(obj);
         unsigned obj_cpu = header->cpu_id;
         unsigned cur_cpu = mempool_cpuid();
+        ++_stats->frees;
 
         if (obj_cpu == cur_cpu) {
             // free from the same CPU this object has been allocated on.
@@ -357,6 +573,7 @@ void pool::free(void* object)
             // free from a different CPU. we try to hand the buffer
             // to the proper worker item that is pinned to the CPU that this buffer
             // was allocated from, so it'll free it.
+            ++_stats->frees_remote;
             free_different_cpu(obj, obj_cpu, cur_cpu);
         }
     }
@@ -368,6 +585,24 @@ pool* pool::from_object(void* object)
     return header->owner;
 }
 
+void pool::fill_stats(stats::object_pool_stats& s)
+{
+    s.object_size = _size;
+    s.allocs = 0;
+    s.frees = 0;
+    s.frees_remote = 0;
+    int64_t pages = 0;
+    for (auto c : sched::cpus) {
+        auto cs = _stats.for_cpu(c);
+        s.allocs += cs->allocs;
+        s.frees += cs->frees;
+        s.frees_remote += cs->frees_remote;
+        pages += cs->pages;
+    }
+    s.live = s.allocs - s.frees;
+    s.pages_held = pages > 0 ? pages : 0;
+}
+
 class malloc_pool : public pool {
 public:
     malloc_pool();
@@ -415,6 +650,81 @@ size_t malloc_pool::compute_object_size(unsigned pos)
     return size;
 }
 
+// Per-thread magazines in front of the per-cpu malloc pools. The pools are
+// already contention-free, but every alloc/free pair still pays for
+// preemption pinning and the page-header free-list dance. A magazine is a
+// small per-thread, per-size-class stack of ready objects: the common
+// malloc/free hits only thread-local memory, and the pool is entered once
+// per half-magazine to refill or flush in bulk. A full magazine holds at
+// most thread_mag_max objects of its class, so a thread can park no more
+// than ~32KB across all classes; a dying thread's magazines are flushed
+// back to the pools from thread::complete().
+constexpr unsigned thread_mag_max = 16;
+constexpr unsigned thread_mag_batch = thread_mag_max / 2;
+
+struct thread_magazine {
+    void* objs[thread_mag_max];
+    unsigned nr;
+};
+
+static __thread thread_magazine thread_mags[ilog2_roundup_constexpr(page_size) + 1];
+
+static void* pool_cache_alloc(unsigned n)
+{
+    auto& mag = thread_mags[n];
+    if (mag.nr) {
+        return mag.objs[--mag.nr];
+    }
+    // empty: refill half a magazine in bulk, so the pool overhead is
+    // amortized over the next thread_mag_batch allocations
+    while (mag.nr < thread_mag_batch - 1) {
+        mag.objs[mag.nr++] = malloc_pools[n].alloc();
+    }
+    return malloc_pools[n].alloc();
+}
+
+static bool pool_cache_free(pool* p, void* object)
+{
+    auto size = p->get_size();
+    if (size & (size - 1)) {
+        return false; // typed pool, not one of the malloc size classes
+    }
+    unsigned n = ilog2_roundup(static_cast<size_t>(size));
+    if (p != &malloc_pools[n]) {
+        return false; // power-of-two sized typed pool
+    }
+    auto& mag = thread_mags[n];
+    if (mag.nr == thread_mag_max) {
+        // full: flush the oldest (coldest) half back to the pool and keep
+        // the recently freed, cache-hot entries on top
+        for (unsigned i = 0; i < thread_mag_batch; i++) {
+            p->free(mag.objs[i]);
+        }
+        mag.nr -= thread_mag_batch;
+        memmove(mag.objs, mag.objs + thread_mag_batch,
+                mag.nr * sizeof(void*));
+    }
+    mag.objs[mag.nr++] = object;
+    return true;
+}
+
+void flush_thread_malloc_cache()
+{
+    for (unsigned n = 0; n < ilog2_roundup_constexpr(page_size) + 1; n++) {
+        auto& mag = thread_mags[n];
+        while (mag.nr) {
+            malloc_pools[n].free(mag.objs[--mag.nr]);
+        }
+    }
+    // the frees above may have staged remotely-owned objects; push them
+    // out now instead of waiting for their batches to fill
+    if (pcpu_free_list) {
+        WITH_LOCK(preempt_lock) {
+            flush_remote_free_batches();
+        }
+    }
+}
+
 page_range::page_range(size_t _size)
     : size(_size)
 {
@@ -460,9 +770,59 @@ void wake_reclaimer()
     reclaimer_thread.wake();
 }
 
+// Pressure level visible to applications, see current_pressure(). Updated
+// whenever the free memory counters move; waiters are only woken on an
+// actual level change, which is rare, so the accounting hot path pays one
+// relaxed exchange.
+static std::atomic<int> app_pressure_level((int)pressure::RELAXED);
+static mutex pressure_waiters_lock;
+static condvar pressure_waiters;
+
+static pressure observed_pressure_level()
+{
+    auto free = stats::free();
+    if (free < min_emergency_pool_size) {
+        return pressure::EMERGENCY;
+    } else if (free < watermark_lo) {
+        return pressure::PRESSURE;
+    } else if (free < watermark_lo * 2) {
+        return pressure::NORMAL;
+    }
+    return pressure::RELAXED;
+}
+
+static void update_pressure_level()
+{
+    int level = (int)observed_pressure_level();
+    if (app_pressure_level.exchange(level, std::memory_order_relaxed)
+            != level) {
+        // May run under free_page_ranges_lock; waiters never take that
+        // lock or allocate while holding pressure_waiters_lock.
+        WITH_LOCK(pressure_waiters_lock) {
+            pressure_waiters.wake_all();
+        }
+    }
+}
+
+pressure current_pressure()
+{
+    return (pressure)app_pressure_level.load(std::memory_order_relaxed);
+}
+
+pressure wait_pressure_change(pressure last)
+{
+    WITH_LOCK(pressure_waiters_lock) {
+        while (current_pressure() == last) {
+            pressure_waiters.wait(&pressure_waiters_lock);
+        }
+    }
+    return current_pressure();
+}
+
 static void on_free(size_t mem)
 {
     free_memory.fetch_add(mem);
+    update_pressure_level();
 }
 
 static void on_alloc(size_t mem)
@@ -474,12 +834,14 @@ static void on_alloc(size_t mem)
     if ((stats::free() + stats::jvm_heap()) < watermark_lo) {
         reclaimer_thread.wake();
     }
+    update_pressure_level();
 }
 
 static void on_new_memory(size_t mem)
 {
     total_memory.fetch_add(mem);
     watermark_lo = stats::total() * 10 / 100;
+    update_pressure_level();
 }
 
 namespace stats {
@@ -566,12 +928,26 @@ void reclaimer::wait_for_memory(size_t mem)
     _oom_blocked.wait(mem);
 }
 
+// The node the current thread should allocate from. Early in boot, before
+// the scheduler (and the NUMA topology) is up, everything is node 0.
+static unsigned allocating_node()
+{
+    if (numa::nr_nodes == 1 || !sched::thread::current()) {
+        return 0;
+    }
+    return sched::cpu::current()->node_id;
+}
+
 class page_range_allocator {
 public:
     static constexpr unsigned max_order = page_ranges_max_order;
 
     page_range_allocator() : _deferred_free(nullptr) { }
 
+    // The free lists are kept per NUMA node (keyed by the range's physical
+    // address), and alloc() serves from the calling thread's node first, so
+    // a pinned thread gets local memory. On single-node configurations all
+    // of this collapses to node 0 and behaves exactly as before.
     template<bool UseBitmap = true>
     page_range* alloc(size_t size, bool contiguous = true);
     page_range* alloc_aligned(size_t size, size_t offset, size_t alignment,
@@ -580,6 +956,10 @@ public:
 
     void initial_add(page_range* pr);
 
+    // Re-file free ranges under their proper node once the NUMA topology
+    // is known; everything added earlier sits under node 0.
+    void rebalance_nodes();
+
     template<typename Func>
     void for_each(unsigned min_order, Func f);
     template<typename Func>
@@ -588,28 +968,42 @@ public:
     }
 
     bool empty() const {
-        return _not_empty.none();
+        for (auto& not_empty : _not_empty) {
+            if (not_empty.any()) {
+                return false;
+            }
+        }
+        return true;
     }
     size_t size() const {
-        size_t size = _free_huge.size();
-        for (auto&& list : _free) {
-            size += list.size();
+        size_t size = 0;
+        for (unsigned node = 0; node < numa::max_nodes; node++) {
+            size += _free_huge[node].size();
+            for (auto&& list : _free[node]) {
+                size += list.size();
+            }
         }
         return size;
     }
 
     void stats(stats::page_ranges_stats& stats) const {
-        stats.order[max_order].ranges_num = _free_huge.size();
+        stats.order[max_order].ranges_num = 0;
         stats.order[max_order].bytes = 0;
-        for (auto& pr : _free_huge) {
-            stats.order[max_order].bytes += pr.size;
-        }
-
         for (auto order = max_order; order--;) {
-            stats.order[order].ranges_num = _free[order].size();
+            stats.order[order].ranges_num = 0;
             stats.order[order].bytes = 0;
-            for (auto& pr : _free[order]) {
-                stats.order[order].bytes += pr.size;
+        }
+        for (unsigned node = 0; node < numa::max_nodes; node++) {
+            stats.order[max_order].ranges_num += _free_huge[node].size();
+            for (auto& pr : _free_huge[node]) {
+                stats.order[max_order].bytes += pr.size;
+            }
+
+            for (auto order = max_order; order--;) {
+                stats.order[order].ranges_num += _free[node][order].size();
+                for (auto& pr : _free[node][order]) {
+                    stats.order[order].bytes += pr.size;
+                }
             }
         }
     }
@@ -620,28 +1014,31 @@ private:
         auto addr = static_cast<void*>(&pr);
         auto pr_end = static_cast<page_range**>(addr + pr.size - sizeof(page_range**));
         *pr_end = &pr;
+        auto node = node_of(pr);
         auto order = ilog2(pr.size / page_size);
         if (order >= max_order) {
-            _free_huge.insert(pr);
-            _not_empty[max_order] = true;
+            _free_huge[node].insert(pr);
+            _not_empty[node][max_order] = true;
         } else {
-            _free[order].push_front(pr);
-            _not_empty[order] = true;
+            _free[node][order].push_front(pr);
+            _not_empty[node][order] = true;
         }
         if (UseBitmap) {
             set_bits(pr, true);
         }
     }
     void remove_huge(page_range& pr) {
-        _free_huge.erase(_free_huge.iterator_to(pr));
-        if (_free_huge.empty()) {
-            _not_empty[max_order] = false;
+        auto node = node_of(pr);
+        _free_huge[node].erase(_free_huge[node].iterator_to(pr));
+        if (_free_huge[node].empty()) {
+            _not_empty[node][max_order] = false;
         }
     }
     void remove_list(unsigned order, page_range& pr) {
-        _free[order].erase(_free[order].iterator_to(pr));
-        if (_free[order].empty()) {
-            _not_empty[order] = false;
+        auto node = node_of(pr);
+        _free[node][order].erase(_free[node][order].iterator_to(pr));
+        if (_free[node][order].empty()) {
+            _not_empty[node][order] = false;
         }
     }
     void remove(page_range& pr) {
@@ -658,6 +1055,12 @@ private:
         idx -= reinterpret_cast<uintptr_t>(mmu::phys_mem);
         return idx / page_size;
     }
+    // The node a range is filed under, derived from its physical address.
+    // A range is never split on a node boundary, so one spanning two nodes
+    // (only possible around the handful of boundaries) counts as its start.
+    unsigned node_of(page_range& pr) const {
+        return numa::node_of(static_cast<u64>(get_bitmap_idx(pr)) * page_size);
+    }
     void set_bits(page_range& pr, bool value, bool fill = false) {
         auto end = pr.size / page_size - 1;
         if (fill) {
@@ -670,18 +1073,21 @@ private:
         }
     }
 
+    template<bool UseBitmap>
+    page_range* alloc_from_node(size_t size, bool contiguous, unsigned node);
+
     bi::multiset<page_range,
                  bi::member_hook<page_range,
                                  bi::set_member_hook<>,
                                  &page_range::set_hook>,
-                 bi::constant_time_size<false>> _free_huge;
+                 bi::constant_time_size<false>> _free_huge[numa::max_nodes];
     bi::list<page_range,
              bi::member_hook<page_range,
                              bi::list_member_hook<>,
                              &page_range::list_hook>,
-             bi::constant_time_size<false>> _free[max_order];
+             bi::constant_time_size<false>> _free[numa::max_nodes][max_order];
 
-    std::bitset<max_order + 1> _not_empty;
+    std::bitset<max_order + 1> _not_empty[numa::max_nodes];
 
     template<typename T>
     class bitmap_allocator {
@@ -722,12 +1128,29 @@ void page_range_allocator::bitmap_allocator<T>::deallocate(T* p, size_t n)
 
 template<bool UseBitmap>
 page_range* page_range_allocator::alloc(size_t size, bool contiguous)
+{
+    // Serve from the calling thread's node when we can; steal from the
+    // other nodes only when the local one is exhausted - remote memory
+    // beats failing the allocation.
+    auto node = allocating_node();
+    auto range = alloc_from_node<UseBitmap>(size, contiguous, node);
+    for (unsigned n = 0; !range && n < numa::nr_nodes; n++) {
+        if (n != node) {
+            range = alloc_from_node<UseBitmap>(size, contiguous, n);
+        }
+    }
+    return range;
+}
+
+template<bool UseBitmap>
+page_range* page_range_allocator::alloc_from_node(size_t size, bool contiguous,
+                                                  unsigned node)
 {
     auto exact_order = ilog2_roundup(size / page_size);
     if (exact_order > max_order) {
         exact_order = max_order;
     }
-    auto bitset = _not_empty.to_ulong();
+    auto bitset = _not_empty[node].to_ulong();
     if (exact_order) {
         bitset &= ~((1 << exact_order) - 1);
     }
@@ -735,13 +1158,13 @@ page_range* page_range_allocator::alloc(size_t size, bool contiguous)
 
     page_range* range = nullptr;
     if (!bitset) {
-        if (!contiguous || !exact_order || _free[exact_order - 1].empty()) {
+        if (!contiguous || !exact_order || _free[node][exact_order - 1].empty()) {
             return nullptr;
         }
         // This linear search makes worst case complexity of the allocator
         // O(n). Unfortunately we do not have choice for contiguous allocation
         // so let us hope there is large enough range.
-        for (auto&& pr : _free[exact_order - 1]) {
+        for (auto&& pr : _free[node][exact_order - 1]) {
             if (pr.size >= size) {
                 range = &pr;
                 remove_list(exact_order - 1, *range);
@@ -752,13 +1175,13 @@ page_range* page_range_allocator::alloc(size_t size, bool contiguous)
             return nullptr;
         }
     } else if (order == max_order) {
-        range = &*_free_huge.rbegin();
+        range = &*_free_huge[node].rbegin();
         if (range->size < size) {
             return nullptr;
         }
         remove_huge(*range);
     } else {
-        range = &_free[order].front();
+        range = &_free[node][order].front();
         remove_list(order, *range);
     }
 
@@ -807,18 +1230,25 @@ page_range* page_range_allocator::alloc_aligned(size_t size, size_t offset,
 
 void page_range_allocator::free(page_range* pr)
 {
+    // Never coalesce across a node boundary, so a merged range always lies
+    // entirely within one node's memory.
+    auto node = node_of(*pr);
     auto idx = get_bitmap_idx(*pr);
     if (idx && _bitmap[idx - 1]) {
         auto pr2 = *(reinterpret_cast<page_range**>(pr) - 1);
-        remove(*pr2);
-        pr2->size += pr->size;
-        pr = pr2;
+        if (node_of(*pr2) == node) {
+            remove(*pr2);
+            pr2->size += pr->size;
+            pr = pr2;
+        }
     }
     auto next_idx = get_bitmap_idx(*pr) + pr->size / page_size;
     if (next_idx < _bitmap.size() && _bitmap[next_idx]) {
         auto pr2 = static_cast<page_range*>(static_cast<void*>(pr) + pr->size);
-        remove(*pr2);
-        pr->size += pr2->size;
+        if (node_of(*pr2) == node) {
+            remove(*pr2);
+            pr->size += pr2->size;
+        }
     }
     insert(*pr);
 }
@@ -851,20 +1281,86 @@ void page_range_allocator::initial_add(page_range* pr)
 template<typename Func>
 void page_range_allocator::for_each(unsigned min_order, Func f)
 {
-    for (auto& pr : _free_huge) {
-        if (!f(pr)) {
-            return;
-        }
-    }
-    for (auto order = max_order; order-- > min_order;) {
-        for (auto& pr : _free[order]) {
+    // Visit the calling thread's node first, so searching consumers like
+    // alloc_aligned() prefer local ranges.
+    auto preferred = allocating_node();
+    for (unsigned i = 0; i < numa::max_nodes; i++) {
+        auto node = (preferred + i) % numa::max_nodes;
+        for (auto& pr : _free_huge[node]) {
             if (!f(pr)) {
                 return;
             }
         }
+        for (auto order = max_order; order-- > min_order;) {
+            for (auto& pr : _free[node][order]) {
+                if (!f(pr)) {
+                    return;
+                }
+            }
+        }
+    }
+}
+
+void page_range_allocator::rebalance_nodes()
+{
+    // Everything added before the topology was parsed was filed under node
+    // 0, and the initial ranges typically span all of RAM. Drain node 0,
+    // split every range where it crosses a node boundary, and re-insert
+    // the pieces, which files each under its proper node.
+    bi::list<page_range,
+             bi::member_hook<page_range,
+                             bi::list_member_hook<>,
+                             &page_range::list_hook>,
+             bi::constant_time_size<false>> pending;
+    for (auto order = max_order; order--;) {
+        auto& list = _free[0][order];
+        while (!list.empty()) {
+            auto& pr = list.front();
+            list.pop_front();
+            pending.push_back(pr);
+        }
+        _not_empty[0][order] = false;
+    }
+    auto& huge = _free_huge[0];
+    while (!huge.empty()) {
+        auto& pr = *huge.begin();
+        huge.erase(huge.begin());
+        pending.push_back(pr);
+    }
+    _not_empty[0][max_order] = false;
+
+    while (!pending.empty()) {
+        auto* pr = &pending.front();
+        pending.pop_front();
+        auto phys = static_cast<u64>(get_bitmap_idx(*pr)) * page_size;
+        auto boundary = numa::node_boundary(phys);
+        while (boundary < phys + pr->size) {
+            auto& np = *new (static_cast<void*>(pr) + (boundary - phys))
+                            page_range(pr->size - (boundary - phys));
+            pr->size = boundary - phys;
+            insert(*pr);
+            pr = &np;
+            phys = boundary;
+            boundary = numa::node_boundary(phys);
+        }
+        insert(*pr);
+    }
+}
+
+void numa_rebalance()
+{
+    WITH_LOCK(free_page_ranges_lock) {
+        free_page_ranges.rebalance_nodes();
     }
 }
 
+// Counters for the page-pool compaction path - see compact_page_pools()
+// and stats::get_compaction_stats().
+static std::atomic<size_t> compaction_runs(0);
+static std::atomic<size_t> compaction_pages_drained(0);
+static std::atomic<size_t> compaction_recovered(0);
+static void compact_page_pools();
+
 namespace stats {
     void get_page_ranges_stats(page_ranges_stats &stats)
     {
@@ -872,6 +1368,25 @@ namespace stats {
             free_page_ranges.stats(stats);
         }
     }
+
+    void get_compaction_stats(compaction_stats &stats)
+    {
+        stats.runs = compaction_runs.load(std::memory_order_relaxed);
+        stats.pages_drained =
+            compaction_pages_drained.load(std::memory_order_relaxed);
+        stats.recovered = compaction_recovered.load(std::memory_order_relaxed);
+    }
+
+    void get_object_pool_stats(std::function<void (const object_pool_stats&)> f)
+    {
+        WITH_LOCK(pool_registry_lock) {
+            for (auto& p : pool_registry()) {
+                object_pool_stats s;
+                p.fill_stats(s);
+                f(s);
+            }
+        }
+    }
 }
 
 static void* mapped_malloc_large(size_t size, size_t offset)
@@ -910,6 +1425,7 @@ static void* malloc_large(size_t size, size_t alignment, bool block = true, bool
         return obj;
     }
 
+    bool compacted = false;
     while (true) {
         WITH_LOCK(free_page_ranges_lock) {
             reclaimer_thread.wait_for_minimum_memory();
@@ -920,6 +1436,9 @@ static void* malloc_large(size_t size, size_t alignment, bool block = true, bool
                 ret_header = free_page_ranges.alloc(size, contiguous);
             }
             if (ret_header) {
+                if (compacted) {
+                    compaction_recovered.fetch_add(1, std::memory_order_relaxed);
+                }
                 on_alloc(size);
                 void* obj = ret_header;
                 obj += offset;
@@ -931,7 +1450,16 @@ static void* malloc_large(size_t size, size_t alignment, bool block = true, bool
                 // which we do after the loop below
                 break;
             }
-            if (block)
+            if (!compacted) {
+                // A contiguous allocation just failed. Before blocking on
+                // the reclaimer (or giving up), give compaction one shot
+                // at merging the pages parked in the percpu/global page
+                // pools back into larger free ranges.
+                compacted = true;
+                DROP_LOCK(free_page_ranges_lock) {
+                    compact_page_pools();
+                }
+            } else if (block)
                 reclaimer_thread.wait_for_memory(size);
             else
                 return nullptr;
@@ -978,6 +1506,20 @@ void *osv_register_shrinker(const char *name,
     return reinterpret_cast<void *>(new c_shrinker(name, func));
 }
 
+// C flavors of current_pressure()/wait_pressure_change() for applications
+// which keep caches of their own, see <osv/pressure.h>.
+extern "C" OSV_LIBC_API
+int osv_memory_pressure()
+{
+    return (int)current_pressure();
+}
+
+extern "C" OSV_LIBC_API
+int osv_wait_memory_pressure(int last_level)
+{
+    return (int)wait_pressure_change((pressure)last_level);
+}
+
 bool reclaimer_waiters::wake_waiters()
 {
     bool woken = false;
@@ -1230,12 +1772,15 @@ struct l1 {
     static void fill_thread();
     static void refill();
     static void unfill();
+    static void drain_local();
 
     static constexpr size_t max = 512;
     static constexpr size_t watermark_lo = max * 1 / 4;
     static constexpr size_t watermark_hi = max * 3 / 4;
     size_t nr = 0;
     unsigned int cpu_id;
+    // set by compact_page_pools(), handled by this cpu's fill thread
+    std::atomic<bool> drain = {false};
 
 private:
     std::unique_ptr<sched::thread> _fill_thread;
@@ -1342,6 +1887,7 @@ public:
     void fill_thread();
     void refill();
     void unfill();
+    size_t drain();
     void free_batch(page_batch& batch);
     size_t get_nr() { return _nr.load(std::memory_order_relaxed); }
     void inc_nr() { _nr.fetch_add(1, std::memory_order_relaxed); }
@@ -1387,9 +1933,13 @@ void l1::fill_thread()
             assert(!sched::thread::current()->is_app());
 #endif
             WITH_LOCK(preempt_lock) {
-                return pbuf.nr < pbuf.watermark_lo || pbuf.nr > pbuf.watermark_hi;
+                return pbuf.nr < pbuf.watermark_lo || pbuf.nr > pbuf.watermark_hi
+                        || pbuf.drain.load(std::memory_order_relaxed);
             }
         });
+        if (pbuf.drain.exchange(false, std::memory_order_relaxed)) {
+            drain_local();
+        }
         if (pbuf.nr < pbuf.watermark_lo) {
             while (pbuf.nr + page_batch::nr_pages < pbuf.max / 2) {
                 refill();
@@ -1571,6 +2121,170 @@ void l2::free_batch(page_batch& batch)
     }
 }
 
+// Move this cpu's whole L1 magazine back through the L2 pool, a batch at
+// a time. Called on the cpu being drained - either directly by the
+// allocating thread or by the cpu's fill thread on a drain request.
+void l1::drain_local()
+{
+#if CONF_lazy_stack_invariant
+    assert(sched::preemptable() && arch::irq_enabled());
+#endif
+#if CONF_lazy_stack
+    arch::ensure_next_stack_page();
+#endif
+    SCOPE_LOCK(preempt_lock);
+    auto& pbuf = get_l1();
+    while (pbuf.nr >= page_batch::nr_pages) {
+        auto* pb = static_cast<page_batch*>(pbuf.top());
+        for (size_t i = 0 ; i < page_batch::nr_pages; i++) {
+            pb->pages[i] = pbuf.pop();
+        }
+        global_l2.free_page_batch(pb);
+        compaction_pages_drained.fetch_add(page_batch::nr_pages,
+                std::memory_order_relaxed);
+    }
+}
+
+// Return every batch parked in the L2 stack to free_page_ranges, where
+// neighbouring pages can merge back into larger ranges.
+size_t l2::drain()
+{
+    page_batch batch;
+    page_batch* pb;
+    size_t drained = 0;
+    while (_stack.pop(pb)) {
+        batch = *pb;
+        dec_nr();
+        free_batch(batch);
+        drained += page_batch::nr_pages;
+    }
+    return drained;
+}
+
+// Contiguity compaction. Free pages parked in the percpu L1 magazines and
+// the global L2 batch stack cannot coalesce with their neighbours in
+// free_page_ranges, so after enough allocation churn 2MB-contiguous
+// requests start failing with plenty of free memory around. Draining the
+// pools gives the page_range merging in free() a chance to rebuild large
+// ranges: the calling cpu's magazine and the L2 stack are drained
+// synchronously before the caller retries, the other cpus' fill threads
+// are asked to drain in the background - helping the next attempt if not
+// this one. (Moving pages that are currently mapped would need a reverse
+// map OSv does not keep, so allocated pages stay put.)
+static void compact_page_pools()
+{
+    if (!smp_allocator) {
+        return;
+    }
+    compaction_runs.fetch_add(1, std::memory_order_relaxed);
+    for (auto c : sched::cpus) {
+        auto* pbuf = *percpu_l1.for_cpu(c);
+        if (pbuf) {
+            pbuf->drain.store(true, std::memory_order_relaxed);
+            pbuf->wake_thread();
+        }
+    }
+    l1::drain_local();
+    auto drained = global_l2.drain();
+    compaction_pages_drained.fetch_add(drained, std::memory_order_relaxed);
+    trace_memory_page_pool_compaction(drained);
+}
+
+// Percpu magazine of pre-zeroed pages for alloc_zeroed_page().
+//
+// The anonymous fault path has to hand out zeroed pages, and the memset
+// dominates its latency when pages come straight from the L1 pool. A percpu
+// fill thread zeroes pages in the background instead, so that under bursty
+// loads first-touch faults find ready pages here. The thread runs at a much
+// lower priority than normal threads: zeroing ahead of time is only a win
+// with cycles to spare, and when the cpu is saturated the fault path simply
+// falls back to zeroing on demand.
+struct zeroed_pool {
+    zeroed_pool(sched::cpu* cpu)
+        : _fill_thread(sched::thread::make([] { fill_thread(); },
+            sched::thread::attr().pin(cpu).name(std::string("page_zero_") + std::to_string(cpu->id))))
+    {
+        _fill_thread->set_priority(low_priority);
+        _fill_thread->start();
+    }
+
+    // Pop a pre-zeroed page, or return nullptr for an empty magazine (or
+    // before SMP bringup), leaving the caller to zero on demand.
+    static void* alloc_page();
+    static void fill_thread();
+
+    static constexpr size_t max = 128;
+    static constexpr size_t watermark_lo = max * 1 / 4;
+    static constexpr float low_priority = 10.0;
+    size_t nr = 0;
+    void* _pages[max];
+private:
+    std::unique_ptr<sched::thread> _fill_thread;
+};
+
+PERCPU(zeroed_pool*, percpu_zeroed);
+static sched::cpu::notifier _zeroed_notifier([] () {
+    *percpu_zeroed = new zeroed_pool(sched::cpu::current());
+});
+
+void* zeroed_pool::alloc_page()
+{
+    if (!smp_allocator) {
+        return nullptr;
+    }
+#if CONF_lazy_stack_invariant
+    assert(sched::preemptable() && arch::irq_enabled());
+#endif
+#if CONF_lazy_stack
+    arch::ensure_next_stack_page();
+#endif
+    SCOPE_LOCK(preempt_lock);
+    auto* z = *percpu_zeroed;
+    if (!z) {
+        return nullptr;
+    }
+    if (z->nr < watermark_lo) {
+        z->_fill_thread->wake();
+    }
+    if (z->nr == 0) {
+        return nullptr;
+    }
+    return z->_pages[--z->nr];
+}
+
+void zeroed_pool::fill_thread()
+{
+    sched::thread::wait_until([] {return smp_allocator;});
+    auto& z = **percpu_zeroed;
+    for (;;) {
+        sched::thread::wait_until([&] {
+#if CONF_lazy_stack_invariant
+            assert(!sched::thread::current()->is_app());
+#endif
+            WITH_LOCK(preempt_lock) {
+                return z.nr < watermark_lo;
+            }
+        });
+        bool full = false;
+        while (!full) {
+            // Allocate and zero with preemption enabled - this is the
+            // latency we are taking off the fault path.
+            void* page = untracked_alloc_page();
+            memset(page, 0, page_size);
+            WITH_LOCK(preempt_lock) {
+                if (z.nr < max) {
+                    z._pages[z.nr++] = page;
+                    page = nullptr;
+                }
+                full = z.nr == max;
+            }
+            if (page) {
+                untracked_free_page(page);
+            }
+        }
+    }
+}
+
 }
 
 namespace stats {
@@ -1744,6 +2458,20 @@ void* alloc_page()
     return p;
 }
 
+void* alloc_zeroed_page()
+{
+    void* p = page_pool::zeroed_pool::alloc_page();
+    if (p) {
+        trace_memory_page_alloc(p);
+        tracker_remember(p, page_size);
+        return p;
+    }
+    // Magazine empty (or pre-SMP) - zero on demand like before.
+    p = alloc_page();
+    memset(p, 0, page_size);
+    return p;
+}
+
 static inline void untracked_free_page(void *v)
 {
     trace_memory_page_free(v);
@@ -1815,6 +2543,76 @@ void free_initial_memory_range(void* addr, size_t size)
     free_page_ranges.initial_add(pr);
 }
 
+// Deferred initial-memory onlining. On big-memory guests, building the
+// linear mappings for all of physical memory and feeding it into
+// free_page_ranges before main() costs hundreds of milliseconds for
+// memory the workload will only touch lazily. arch_setup_free_memory()
+// onlines the first deferred_online_threshold bytes eagerly - plenty to
+// boot with - and queues the rest here in chunks; once smp_launch() has
+// run, online_deferred_memory() spreads the chunks over per-cpu worker
+// threads while boot carries on. Until a chunk is onlined it is simply
+// invisible to the allocator, so stats::total() grows for a short while
+// after boot.
+static constexpr size_t deferred_chunk_size = 2ull << 30;
+static constexpr unsigned max_deferred_ranges = 256;
+
+struct deferred_range {
+    mmu::phys addr;
+    size_t size;
+};
+static deferred_range deferred_ranges[max_deferred_ranges];
+static unsigned nr_deferred_ranges;
+
+bool defer_initial_memory_range(uintptr_t addr, size_t size)
+{
+    // Chunking both bounds the per-worker stint and gives the workers
+    // something to stripe over when the firmware reports one huge entry.
+    while (size) {
+        if (nr_deferred_ranges == max_deferred_ranges) {
+            return false; // table full - caller onlines the rest eagerly
+        }
+        auto chunk = std::min(size, deferred_chunk_size);
+        deferred_ranges[nr_deferred_ranges++] = {addr, chunk};
+        addr += chunk;
+        size -= chunk;
+    }
+    return true;
+}
+
+static void online_deferred_range(const deferred_range& r)
+{
+    // page table writes of concurrent workers (and of everything else
+    // mapping after smp - ACPI tables, device BARs) are serialized
+    // inside linear_map() itself
+    for (auto&& area : mmu::identity_mapped_areas) {
+        auto base = reinterpret_cast<char*>(mmu::get_mem_area_base(area));
+        mmu::linear_map(base + r.addr, r.addr, r.size,
+            area == mmu::mem_area::main ? "main" :
+            area == mmu::mem_area::page ? "page" : "mempool", ~0);
+    }
+    WITH_LOCK(free_page_ranges_lock) {
+        mmu::free_initial_memory_range(r.addr, r.size);
+    }
+}
+
+void online_deferred_memory()
+{
+    if (!nr_deferred_ranges) {
+        return;
+    }
+    auto nworkers = std::min(sched::cpus.size(),
+                             (size_t)nr_deferred_ranges);
+    for (size_t w = 0; w < nworkers; w++) {
+        auto t = sched::thread::make([w, nworkers] {
+            for (unsigned i = w; i < nr_deferred_ranges; i += nworkers) {
+                online_deferred_range(deferred_ranges[i]);
+            }
+        }, sched::thread::attr().pin(sched::cpus[w])
+                .name("memonline" + std::to_string(w)).detached(true));
+        t->start();
+    }
+}
+
 void  __attribute__((constructor(init_prio::mempool))) setup()
 {
     arch_setup_free_memory();
@@ -1828,6 +2626,53 @@ extern "C" {
     size_t malloc_usable_size(void *object);
 }
 
+static size_t object_size(void *object);
+
+// Per-application accounting (see osv::app_mem_account): allocations made
+// by application threads are charged to their application, frees are
+// uncharged against the freeing thread's context. When usage first crosses
+// a configured soft cap we run the application's shrink callback right
+// here in the allocating thread - the per-app analogue of direct reclaim -
+// so a leaky application is asked to trim its own memory before it drives
+// the whole guest into the global reclaimer. The guard flag keeps
+// allocations made by the callback itself from re-triggering it.
+static __thread bool app_shrink_active;
+
+static void charge_app_memory(void* object)
+{
+    auto t = sched::thread::current();
+    auto a = t ? t->mem_account() : nullptr;
+    if (!a) {
+        return;
+    }
+    auto sz = object_size(object);
+    auto bytes = a->bytes.fetch_add(sz, std::memory_order_relaxed) +
+            static_cast<ssize_t>(sz);
+    auto cap = a->soft_cap.load(std::memory_order_acquire);
+    if (cap && bytes > static_cast<ssize_t>(cap) && a->shrink &&
+            !app_shrink_active && !a->above_cap.exchange(true)) {
+        app_shrink_active = true;
+        a->shrink(bytes - cap);
+        app_shrink_active = false;
+    }
+}
+
+static void uncharge_app_memory(void* object)
+{
+    auto t = sched::thread::current();
+    auto a = t ? t->mem_account() : nullptr;
+    if (!a) {
+        return;
+    }
+    auto sz = object_size(object);
+    auto bytes = a->bytes.fetch_sub(sz, std::memory_order_relaxed) -
+            static_cast<ssize_t>(sz);
+    if (a->above_cap.load(std::memory_order_relaxed) &&
+            bytes <= static_cast<ssize_t>(a->soft_cap.load(std::memory_order_relaxed))) {
+        a->above_cap.store(false, std::memory_order_relaxed);
+    }
+}
+
 static inline void* std_malloc(size_t size, size_t alignment)
 {
     if ((ssize_t)size < 0)
@@ -1836,13 +2681,13 @@ static inline void* std_malloc(size_t size, size_t alignment)
     size_t minimum_size = std::max(size, memory::pool::min_object_size);
     if (smp_allocator && size <= memory::pool::max_object_size && alignment <= minimum_size) {
         unsigned n = ilog2_roundup(minimum_size);
-        ret = memory::malloc_pools[n].alloc();
+        ret = memory::pool_cache_alloc(n);
         ret = translate_mem_area(mmu::mem_area::main, mmu::mem_area::mempool,
                                  ret);
         trace_memory_malloc_mempool(ret, size, 1 << n, alignment);
     } else if (smp_allocator && alignment <= memory::pool::max_object_size && minimum_size <= alignment) {
         unsigned n = ilog2_roundup(alignment);
-        ret = memory::malloc_pools[n].alloc();
+        ret = memory::pool_cache_alloc(n);
         ret = translate_mem_area(mmu::mem_area::main, mmu::mem_area::mempool,
                                  ret);
         trace_memory_malloc_mempool(ret, size, 1 << n, alignment);
@@ -1857,6 +2702,9 @@ static inline void* std_malloc(size_t size, size_t alignment)
     } else {
         ret = memory::malloc_large(size, alignment, true, false);
     }
+    if (ret) {
+        charge_app_memory(ret);
+    }
     memory::tracker_remember(ret, size);
     return ret;
 }
@@ -1931,6 +2779,7 @@ void free(void* object)
     if (!object) {
         return;
     }
+    uncharge_app_memory(object);
     memory::tracker_forget(object);
 
     if (!mmu::is_linear_mapped(object, 0)) {
@@ -1949,9 +2798,12 @@ void free(void* object)
                                          mmu::mem_area::main, object);
         {
             auto pool = memory::pool::from_object(object);
-            if (pool)
+            if (pool) {
+                if (memory::pool_cache_free(pool, object)) {
+                    return;
+                }
                 return pool->free(object);
-            else
+            } else
                 return memory::early_free_object(object);
         }
     case mmu::mem_area::debug:
@@ -20,14 +20,18 @@
 #include "fs/vfs/vfs.h"
 #include <osv/error.h>
 #include <osv/trace.hh>
+#include <osv/procfs-bin.h>
 #include <stack>
 #include <fs/fs.hh>
 #include <osv/file.h>
 #include "dump.hh"
 #include <osv/rcu.hh>
 #include <osv/rwlock.h>
+#include <osv/brwlock.hh>
 #include <numeric>
 #include <set>
+#include <unordered_map>
+#include <atomic>
 
 // FIXME: Without this pragma, we get a lot of warnings that I don't know
 // how to explain or fix. For now, let's just ignore them :-(
@@ -93,6 +97,22 @@ typedef boost::intrusive::set<vma,
                               > vma_list_base;
 
 struct vma_list_type : vma_list_base {
+    // Bumped on every insert and erase. procfs caches its renderings of
+    // the vma list (/proc/self/maps and friends) and uses this to tell
+    // whether the cache is still current, so monitoring that polls those
+    // files only pays the formatting when the mappings actually changed.
+    std::atomic<u64> generation = {0};
+
+    void insert(vma& v) {
+        generation.fetch_add(1, std::memory_order_relaxed);
+        vma_list_base::insert(v);
+    }
+
+    void erase(vma& v) {
+        generation.fetch_add(1, std::memory_order_relaxed);
+        vma_list_base::erase(v);
+    }
+
     vma_list_type() {
         // insert markers for the edges of allocatable area
         // simplifies searches
@@ -113,8 +133,12 @@ vma_list_type vma_list;
 
 // protects vma list and page table modifications.
 // anything that may add, remove, split vma, zaps pte or changes pte permission
-// should hold the lock for write
-rwlock_t vma_list_mutex;
+// should hold the lock for write.
+// This is a big-reader lock: read acquisitions (page faults, vma lookups)
+// only touch a percpu counter, so faults on different cpus never contend
+// with each other on the lock itself, and only pay when an mmap/munmap is
+// actually draining them. Writers still serialize, as they always did.
+brwlock vma_list_mutex;
 
 // A mutex serializing modifications to the high part of the page table
 // (linear map, etc.) which are not part of vma_list.
@@ -257,6 +281,26 @@ bool change_perm(hw_ptep<N> ptep, unsigned int perm)
 #endif
 }
 
+// Counters behind get_hugepage_stats(). The mapped counters are bumped by
+// the demand-paging page providers below, the failure counter when a 2MB
+// allocation came back empty and the range had to fall back to 4K pages,
+// and the split counter whenever an installed huge mapping is demoted.
+// Relaxed updates - these are statistics, and the fault path is hot.
+static std::atomic<ulong> stat_huge_mapped(0);
+static std::atomic<ulong> stat_small_mapped(0);
+static std::atomic<ulong> stat_huge_failed(0);
+static std::atomic<ulong> stat_huge_split(0);
+static std::atomic<ulong> stat_huge_promoted(0);
+
+void get_hugepage_stats(hugepage_stats& s)
+{
+    s.huge_mapped = stat_huge_mapped.load(std::memory_order_relaxed);
+    s.small_mapped = stat_small_mapped.load(std::memory_order_relaxed);
+    s.huge_failed = stat_huge_failed.load(std::memory_order_relaxed);
+    s.huge_split = stat_huge_split.load(std::memory_order_relaxed);
+    s.huge_promoted = stat_huge_promoted.load(std::memory_order_relaxed);
+}
+
 template<int N>
 void split_large_page(hw_ptep<N> ptep)
 {
@@ -268,6 +312,7 @@ void split_large_page(hw_ptep<1> ptep)
     pt_element<1> pte_orig = ptep.read();
     pte_orig.set_large(false);
     allocate_intermediate_level(ptep, pte_orig);
+    stat_huge_split.fetch_add(1, std::memory_order_relaxed);
 }
 
 struct page_allocator {
@@ -656,6 +701,10 @@ struct tlb_gather {
         if (!nr_pages) {
             return false;
         }
+        // The gathered addresses are the linear-map aliases of the pages
+        // about to be freed, not the virtual addresses they were mapped
+        // at, so a range invalidation can't be used here - only a full
+        // flush guarantees no stale translation survives the free.
         mmu::flush_tlb_all();
         for (auto i = 0u; i < nr_pages; ++i) {
             auto&& tp = pages[i];
@@ -670,6 +719,69 @@ struct tlb_gather {
     }
 };
 
+// Registry of pages shared between several ptes by dedup_readonly_pages()
+// below. The value counts how many ptes currently point at the page; a page
+// not in the map is mapped exactly once and may be freed as usual.
+static mutex dedup_mutex;
+static std::unordered_map<void*, unsigned> dedup_shared;
+// Fast-path gate so mappings which never took part in deduplication don't
+// take dedup_mutex on every unmapped page.
+static std::atomic<size_t> dedup_shared_count(0);
+
+// Called when a pte pointing at addr is being torn down. Returns true if the
+// page is still referenced by another pte and must not be freed.
+static bool dedup_release(void* addr)
+{
+    if (!dedup_shared_count.load(std::memory_order_relaxed)) {
+        return false;
+    }
+    WITH_LOCK(dedup_mutex) {
+        auto it = dedup_shared.find(addr);
+        if (it == dedup_shared.end()) {
+            return false;
+        }
+        if (--it->second == 0) {
+            dedup_shared.erase(it);
+            dedup_shared_count.fetch_add(-1, std::memory_order_relaxed);
+            // Last reference gone - free the page normally
+            return false;
+        }
+        return true;
+    }
+}
+
+// Called before a pte gains write permission. If the page it points at is
+// shared, replace it with a private copy so the write cannot be observed
+// through the other mappings. Returns true if the pte was rewritten (and a
+// tlb flush is therefore needed).
+template<int N>
+static bool dedup_unshare(hw_ptep<N> ptep)
+{
+    if (!dedup_shared_count.load(std::memory_order_relaxed)) {
+        return false;
+    }
+    auto pte = ptep.read();
+    if (pte.empty() || pte.large()) {
+        return false;
+    }
+    void* addr = phys_to_virt(pte.addr());
+    WITH_LOCK(dedup_mutex) {
+        auto it = dedup_shared.find(addr);
+        if (it == dedup_shared.end()) {
+            return false;
+        }
+        void* copy = memory::alloc_page();
+        memcpy(copy, addr, page_size);
+        pte.set_addr(virt_to_phys(copy), false);
+        ptep.write(pte);
+        if (--it->second == 0) {
+            dedup_shared.erase(it);
+            dedup_shared_count.fetch_add(-1, std::memory_order_relaxed);
+        }
+    }
+    return true;
+}
+
 /*
  * Undo the operation of populate(), freeing memory allocated by populate()
  * and marking the pages non-present.
@@ -690,7 +802,12 @@ public:
         // evacuate() makes sure we are only called for allocated pages, and
         // not-present may only mean mprotect(PROT_NONE).
         if (_pops->unmap(addr, offset, ptep)) {
-            do_flush = !_tlb_gather.push(addr, size);
+            if (dedup_release(addr)) {
+                // The page is still mapped elsewhere - drop only our pte
+                do_flush = true;
+            } else {
+                do_flush = !_tlb_gather.push(addr, size);
+            }
         } else {
             do_flush = true;
         }
@@ -707,6 +824,201 @@ public:
     void finalize(void) {}
 };
 
+/*
+ * Like unpopulate, but only reaps pages whose dirty bit is still clear -
+ * the reclaim half of madvise(MADV_FREE): pages the application wrote to
+ * after the advice keep their contents, the rest go back to the page
+ * allocator. We deliberately keep the default no-op intermediate_page_post
+ * here: dirty leaves may survive under an intermediate page table, so it
+ * cannot be freed the way unpopulate does.
+ */
+template <account_opt T = account_opt::no>
+class unpopulate_clean : public vma_operation<allocate_intermediate_opt::no, skip_empty_opt::yes, T> {
+private:
+    tlb_gather _tlb_gather;
+    page_allocator* _pops;
+    bool do_flush = false;
+public:
+    unpopulate_clean(page_allocator* pops) : _pops(pops) {}
+    template<int N>
+    bool page(hw_ptep<N> ptep, uintptr_t offset) {
+        if (ptep.read().dirty()) {
+            return true;
+        }
+        void* addr = phys_to_virt(ptep.read().addr());
+        size_t size = pt_level_traits<N>::size::value;
+        if (_pops->unmap(addr, offset, ptep)) {
+            if (dedup_release(addr)) {
+                do_flush = true;
+            } else {
+                do_flush = !_tlb_gather.push(addr, size);
+            }
+        } else {
+            do_flush = true;
+        }
+        this->account(size);
+        return true;
+    }
+    bool tlb_flush_needed(void) {
+        return !_tlb_gather.flush() && do_flush;
+    }
+    void finalize(void) {}
+};
+
+/*
+ * The marking half of madvise(MADV_FREE): clear the dirty bit over the
+ * range, so that the hardware sets it again on the next write and the
+ * lazy-free shrinker can later tell reused pages from reclaimable ones.
+ */
+class lazy_free_marker : public vma_operation<allocate_intermediate_opt::no, skip_empty_opt::yes> {
+private:
+    bool do_flush = false;
+public:
+    template<int N>
+    bool page(hw_ptep<N> ptep, uintptr_t offset) {
+        auto pte = ptep.read();
+        if (pte.dirty()) {
+            pte.set_dirty(false);
+            ptep.write(pte);
+            do_flush = true;
+        }
+        return true;
+    }
+    bool tlb_flush_needed(void) { return do_flush; }
+    void finalize(void) {}
+};
+
+/*
+ * The opposite of splithugepages: collapse a fully-populated, huge-aligned
+ * 2MB run of 4K ptes back into one huge mapping. JIT code caches end up on
+ * 4K pages because the runtime commits and mprotects them piecemeal - every
+ * mprotect boundary splits a huge page - and executable pages are exactly
+ * where iTLB misses hurt, so once a run is dense again we restore the large
+ * mapping by copying into a fresh 2MB page and swapping it in.
+ *
+ * Only runs whose ptes all carry identical, non-cow permissions collapse.
+ * Writable ptes are write-protected (and the TLB flushed) before the copy,
+ * so a racing writer faults and blocks on vma_list_mutex - which our caller
+ * holds for write - instead of dirtying a page we already copied.
+ */
+class promotehugepages : public vma_operation<allocate_intermediate_opt::no, skip_empty_opt::yes, account_opt::yes> {
+private:
+    tlb_gather _tlb_gather;
+    unsigned _present = 0;
+    bool _collapsible = false;
+    pt_element<0> _first;
+    bool do_flush = false;
+public:
+    bool page(hw_ptep<1> ptep, uintptr_t offset) {
+        // already huge - nothing to do
+        return true;
+    }
+    bool page(hw_ptep<0> ptep, uintptr_t offset) {
+        auto pte = ptep.read();
+        if (_present++ == 0) {
+            _first = pte;
+        }
+        // only identical, non-cow ptes can merge into a single huge pte
+        if (pte_is_cow(pte) ||
+            pte.valid() != _first.valid() ||
+            pte.writable() != _first.writable() ||
+            pte.executable() != _first.executable()) {
+            _collapsible = false;
+        }
+        return true;
+    }
+    void intermediate_page_pre(hw_ptep<1> ptep, uintptr_t offset) {
+        _present = 0;
+        _collapsible = true;
+    }
+    void intermediate_page_post(hw_ptep<1> ptep, uintptr_t offset) {
+        constexpr unsigned nptes = 1 << pte_per_page_shift;
+        if (!_collapsible || _present != nptes) {
+            return;
+        }
+        void* huge = memory::alloc_huge_page(huge_page_size);
+        if (!huge) {
+            stat_huge_failed.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+        auto table_phys = ptep.read().next_pt_addr();
+        hw_ptep<0> pt = hw_ptep<0>::force(phys_cast<pt_element<0>>(table_phys));
+        if (_first.writable()) {
+            for (unsigned i = 0; i < nptes; i++) {
+                auto pte = pt.at(i).read();
+                pte.set_writable(false);
+                pt.at(i).write(pte);
+            }
+            mmu::flush_tlb_all();
+        }
+        auto dst = static_cast<char*>(huge);
+        for (unsigned i = 0; i < nptes; i++) {
+            memcpy(dst + i * page_size,
+                   phys_to_virt(pt.at(i).read().addr()), page_size);
+        }
+        unsigned perm = (_first.valid() ? perm_read : 0) |
+                        (_first.writable() ? perm_write : 0) |
+                        (_first.executable() ? perm_exec : 0);
+        ptep.write(make_leaf_pte(ptep, virt_to_phys(huge), perm));
+        for (unsigned i = 0; i < nptes; i++) {
+            void* addr = phys_to_virt(pt.at(i).read().addr());
+            if (dedup_release(addr)) {
+                // still mapped elsewhere - drop only this reference
+                do_flush = true;
+            } else {
+                do_flush = !_tlb_gather.push(addr, page_size);
+            }
+        }
+        // the intermediate table is unreferenced now; free it like
+        // unpopulate does, after concurrent rcu walkers are done with it
+        osv::rcu_defer([](void *page) { memory::free_page(page); },
+                phys_to_virt(table_phys));
+        stat_huge_promoted.fetch_add(1, std::memory_order_relaxed);
+        this->account(huge_page_size);
+    }
+    bool tlb_flush_needed(void) {
+        return !_tlb_gather.flush() && do_flush;
+    }
+    void finalize(void) {}
+};
+
+// Tally how many bytes of a vma are mapped by huge vs. small leaves.
+// The references let one accumulator span several operate_range() calls,
+// which copy the operation by value.
+class count_mapped : public vma_operation<allocate_intermediate_opt::no, skip_empty_opt::yes> {
+private:
+    ulong& _huge_bytes;
+    ulong& _small_bytes;
+public:
+    count_mapped(ulong& huge_bytes, ulong& small_bytes)
+        : _huge_bytes(huge_bytes), _small_bytes(small_bytes) {}
+    template<int N>
+    bool page(hw_ptep<N> ptep, uintptr_t offset) {
+        if (pt_level_traits<N>::large_capable::value) {
+            _huge_bytes += pt_level_traits<N>::size::value;
+        } else {
+            _small_bytes += pt_level_traits<N>::size::value;
+        }
+        return true;
+    }
+};
+
+// How much of the executable mappings sits on 2MB vs. 4K pages - the
+// iTLB-relevant counterpart of the cumulative hugepage counters. Walks the
+// page tables of every exec vma, so this is for diagnostics, not fast paths.
+void get_exec_mapping_stats(ulong& huge_bytes, ulong& small_bytes)
+{
+    huge_bytes = small_bytes = 0;
+    PREVENT_STACK_PAGE_FAULT
+    WITH_LOCK(vma_list_mutex.for_read()) {
+        for (auto& v : vma_list) {
+            if (v.perm() & perm_exec) {
+                v.operate_range(count_mapped(huge_bytes, small_bytes));
+            }
+        }
+    }
+}
+
 class protection : public vma_operation<allocate_intermediate_opt::no, skip_empty_opt::yes> {
 private:
     unsigned int perm;
@@ -715,12 +1027,82 @@ public:
     protection(unsigned int perm) : perm(perm), do_flush(false) { }
     template<int N>
     bool page(hw_ptep<N> ptep, uintptr_t offset) {
+        if (perm & perm_write) {
+            do_flush |= dedup_unshare(ptep);
+        }
         do_flush |= change_perm(ptep, perm);
         return true;
     }
     bool tlb_flush_needed(void) {return do_flush;}
 };
 
+static uint64_t hash_page(const uint64_t* page)
+{
+    // FNV-1a, folding the page in word at a time
+    uint64_t h = 0xcbf29ce484222325ull;
+    for (unsigned i = 0; i < page_size / sizeof(uint64_t); i++) {
+        h ^= page[i];
+        h *= 0x100000001b3ull;
+    }
+    return h;
+}
+
+/*
+ * page_dedup rewrites every small pte whose page has the same content as a
+ * page seen earlier in the pass to point at that earlier page, and frees the
+ * duplicate. The content index maps page hash to the canonical page and is
+ * shared by all vmas in one pass; pages kept alive by more than one pte are
+ * refcounted in dedup_shared above.
+ */
+class page_dedup : public vma_operation<allocate_intermediate_opt::no, skip_empty_opt::yes, account_opt::yes> {
+private:
+    std::unordered_map<uint64_t, void*>* _index;
+    tlb_gather _tlb_gather;
+    bool do_flush = false;
+public:
+    page_dedup(std::unordered_map<uint64_t, void*>* index) : _index(index) {}
+    template<int N>
+    bool split_large(hw_ptep<N> ptep, int level) { return false; }
+    template<int N>
+    bool page(hw_ptep<N> ptep, uintptr_t offset) {
+        if (pt_level_traits<N>::large_capable::value) {
+            // Not worth breaking up a huge mapping for this
+            return true;
+        }
+        auto pte = ptep.read();
+        void* addr = phys_to_virt(pte.addr());
+        auto ins = _index->emplace(hash_page(static_cast<const uint64_t*>(addr)), addr);
+        if (ins.second) {
+            // First page with this content
+            return true;
+        }
+        void* canonical = ins.first->second;
+        if (memcmp(canonical, addr, page_size)) {
+            // Hash collision - leave the page alone
+            return true;
+        }
+        WITH_LOCK(dedup_mutex) {
+            auto it = dedup_shared.find(canonical);
+            if (it == dedup_shared.end()) {
+                // Two references now: the canonical pte and ours
+                dedup_shared.emplace(canonical, 2);
+                dedup_shared_count.fetch_add(1, std::memory_order_relaxed);
+            } else {
+                ++it->second;
+            }
+        }
+        pte.set_addr(virt_to_phys(canonical), false);
+        ptep.write(pte);
+        // The duplicate may be freed only once no TLB maps it any more
+        do_flush = !_tlb_gather.push(addr, page_size);
+        this->account(pt_level_traits<N>::size::value);
+        return true;
+    }
+    bool tlb_flush_needed(void) {
+        return !_tlb_gather.flush() && do_flush;
+    }
+};
+
 template <typename T, account_opt Account = account_opt::no>
 class dirty_cleaner : public vma_operation<allocate_intermediate_opt::no, skip_empty_opt::yes, Account> {
 private:
@@ -876,12 +1258,11 @@ template<typename T> ulong operate_range(T mapper, void *vma_start, void *start,
     uintptr_t virt = reinterpret_cast<uintptr_t>(start);
     map_range(reinterpret_cast<uintptr_t>(vma_start), virt, size, mapper);
 
-    // TODO: consider if instead of requesting a full TLB flush, we should
-    // instead try to make more judicious use of INVLPG - e.g., in
-    // split_large_page() and other specific places where we modify specific
-    // page table entries.
     if (mapper.tlb_flush_needed()) {
-        mmu::flush_tlb_all();
+        // Invalidate just the operated-on range; flush_tlb_range() falls
+        // back to a full flush by itself when the range is too large for
+        // page-by-page invalidation to pay off.
+        mmu::flush_tlb_range(start, size);
     }
     mapper.finalize();
     return mapper.account_results();
@@ -1101,6 +1482,7 @@ private:
     virtual void* fill(void* addr, uint64_t offset, uintptr_t size) {
         return addr;
     }
+protected:
     template<int N>
     bool set_pte(void *addr, hw_ptep<N> ptep, pt_element<N> pte) {
         if (!addr) {
@@ -1118,11 +1500,25 @@ private:
     }
 public:
     virtual bool map(uintptr_t offset, hw_ptep<0> ptep, pt_element<0> pte, bool write) override {
-        return set_pte(fill(memory::alloc_page(), offset, page_size), ptep, pte);
+        if (set_pte(fill(memory::alloc_page(), offset, page_size), ptep, pte)) {
+            stat_small_mapped.fetch_add(1, std::memory_order_relaxed);
+            return true;
+        }
+        return false;
     }
     virtual bool map(uintptr_t offset, hw_ptep<1> ptep, pt_element<1> pte, bool write) override {
         size_t size = pt_level_traits<1>::size::value;
-        return set_pte(fill(memory::alloc_huge_page(size), offset, size), ptep, pte);
+        void* page = memory::alloc_huge_page(size);
+        if (!page) {
+            // set_pte() will throw and populate() will retry this range
+            // with 4K pages
+            stat_huge_failed.fetch_add(1, std::memory_order_relaxed);
+        }
+        if (set_pte(fill(page, offset, size), ptep, pte)) {
+            stat_huge_mapped.fetch_add(1, std::memory_order_relaxed);
+            return true;
+        }
+        return false;
     }
     virtual bool unmap(void *addr, uintptr_t offset, hw_ptep<0> ptep) override {
         clear_pte(ptep);
@@ -1142,6 +1538,17 @@ private:
         }
         return addr;
     }
+public:
+    // 4K pages come from the percpu magazine of pages pre-zeroed in the
+    // background, so the fault usually skips the memset; huge pages are
+    // still zeroed in place by fill() above.
+    virtual bool map(uintptr_t offset, hw_ptep<0> ptep, pt_element<0> pte, bool write) override {
+        if (set_pte(memory::alloc_zeroed_page(), ptep, pte)) {
+            stat_small_mapped.fetch_add(1, std::memory_order_relaxed);
+            return true;
+        }
+        return false;
+    }
 };
 
 class map_file_page_read : public uninitialized_anonymous_page_provider {
@@ -1192,6 +1599,32 @@ public:
     }
 };
 
+// Share identical read-only file-backed pages across mappings, typically
+// duplicate sections read in from different copies of the same libraries.
+// Only mappings populated by map_file_page_read are considered: their pages
+// are private copies we are free to retarget, while map_file_page_mmap pages
+// belong to the page cache and must be returned through put_page().
+// Writes cannot sneak in behind our back: the vmas have no write permission,
+// and mprotect() unshares the pages (see protection::page above) before
+// making them writable. Returns the number of bytes the pass released.
+ulong dedup_readonly_pages()
+{
+    std::unordered_map<uint64_t, void*> index;
+    ulong deduped = 0;
+    SCOPE_LOCK(vma_list_mutex.for_write());
+    for (auto& v : vma_list) {
+        if (v.perm() & perm_write) {
+            continue;
+        }
+        if (!dynamic_cast<file_vma*>(&v) ||
+            !dynamic_cast<map_file_page_read*>(v.page_ops())) {
+            continue;
+        }
+        deduped += v.operate_range(page_dedup(&index));
+    }
+    return deduped;
+}
+
 uintptr_t allocate(vma *v, uintptr_t start, size_t size, bool search)
 {
     if (search) {
@@ -1273,6 +1706,134 @@ static void nohugepage(void* addr, size_t length)
     }
 }
 
+// madvise(MADV_HUGEPAGE): the caller says the range is worth backing with
+// 2MB pages right now, so eagerly populate its huge-page aligned interior,
+// the same way map_anon() commits ahead for large writable mappings, and
+// collapse any dense 4K runs already present back into huge mappings. The
+// unaligned edges and mappings that can only ever use 4K pages stay lazy.
+static void hugepage(void* addr, size_t length)
+{
+    length = align_up(length, mmu::page_size);
+    auto start = reinterpret_cast<uintptr_t>(addr);
+    auto range = find_intersecting_vmas(addr_range(start, start + length));
+    for (auto i = range.first; i != range.second; ++i) {
+        if (!i->has_flags(mmap_small | mmap_file | mmap_jvm_balloon)) {
+            auto hp_start = align_up(std::max(start, i->start()), huge_page_size);
+            auto hp_end = align_down(std::min(start + length, i->end()), huge_page_size);
+            if (hp_start < hp_end) {
+                i->operate_range(populate<>(i->page_ops(), i->perm(), false, i->map_dirty()),
+                        reinterpret_cast<void*>(hp_start), hp_end - hp_start);
+                i->operate_range(promotehugepages(),
+                        reinterpret_cast<void*>(hp_start), hp_end - hp_start);
+            }
+        }
+        start += i->size();
+        length -= i->size();
+    }
+}
+
+// Collapse dense 4K runs in the executable anonymous vmas intersecting
+// [addr, addr+length) back into 2MB mappings (see promotehugepages above).
+// Called from mprotect(): a JIT making fresh code executable is the moment
+// its pages become iTLB-relevant, and the commit-sized mprotect calls that
+// preceded it are what split the huge mappings in the first place. Expects
+// vma_list_mutex held for write.
+static void promote_exec_hugepages(const void* addr, size_t length)
+{
+    auto start = reinterpret_cast<uintptr_t>(addr);
+    auto range = find_intersecting_vmas(addr_range(start, start + length));
+    for (auto i = range.first; i != range.second; ++i) {
+        if (!i->has_flags(mmap_small | mmap_file | mmap_jvm_balloon) &&
+                (i->perm() & perm_exec)) {
+            // Take in the whole huge pages the range touches - the split
+            // that made them 4K rarely matches the mprotect boundaries
+            auto hp_start = std::max(
+                    align_down(std::max(start, i->start()), huge_page_size),
+                    i->start());
+            auto hp_end = std::min(
+                    align_up(std::min(start + length, i->end()), huge_page_size),
+                    i->end());
+            hp_start = align_up(hp_start, huge_page_size);
+            hp_end = align_down(hp_end, huge_page_size);
+            if (hp_start < hp_end) {
+                i->operate_range(promotehugepages(),
+                        reinterpret_cast<void*>(hp_start), hp_end - hp_start);
+            }
+        }
+        start += i->size();
+        length -= i->size();
+    }
+}
+
+// madvise(MADV_FREE) bookkeeping: ranges whose dirty bits were cleared and
+// which the shrinker may reap when memory gets tight. Guarded by
+// vma_list_mutex held for write. The list is bounded - once full, further
+// advice is applied immediately instead of being deferred.
+struct lazy_free_range {
+    uintptr_t start;
+    size_t size;
+};
+static std::vector<lazy_free_range> lazy_free_ranges;
+static constexpr size_t max_lazy_free_ranges = 1024;
+
+static size_t reap_clean_pages(void* addr, size_t length)
+{
+    size_t freed = 0;
+    length = align_up(length, mmu::page_size);
+    auto start = reinterpret_cast<uintptr_t>(addr);
+    auto range = find_intersecting_vmas(addr_range(start, start + length));
+    for (auto i = range.first; i != range.second; ++i) {
+        if (!i->has_flags(mmap_file | mmap_jvm_balloon)) {
+            freed += i->operate_range(unpopulate_clean<account_opt::yes>(i->page_ops()),
+                    reinterpret_cast<void*>(start), std::min(length, i->size()));
+        }
+        start += i->size();
+        length -= i->size();
+    }
+    return freed;
+}
+
+static void mark_lazy_free(void* addr, size_t length)
+{
+    length = align_up(length, mmu::page_size);
+    auto start = reinterpret_cast<uintptr_t>(addr);
+    auto range = find_intersecting_vmas(addr_range(start, start + length));
+    for (auto i = range.first; i != range.second; ++i) {
+        if (!i->has_flags(mmap_file | mmap_jvm_balloon)) {
+            i->operate_range(lazy_free_marker(), reinterpret_cast<void*>(start),
+                    std::min(length, i->size()));
+        }
+        start += i->size();
+        length -= i->size();
+    }
+}
+
+class lazy_free_shrinker : public memory::shrinker {
+public:
+    lazy_free_shrinker() : shrinker("lazy_free") {}
+    size_t request_memory(size_t n, bool hard) override;
+};
+
+static lazy_free_shrinker* s_lazy_free_shrinker;
+
+size_t lazy_free_shrinker::request_memory(size_t n, bool hard)
+{
+    size_t freed = 0;
+    PREVENT_STACK_PAGE_FAULT
+    WITH_LOCK(vma_list_mutex.for_write()) {
+        while (!lazy_free_ranges.empty() && freed < n) {
+            auto r = lazy_free_ranges.back();
+            lazy_free_ranges.pop_back();
+            if (!ismapped(reinterpret_cast<void*>(r.start), r.size)) {
+                // unmapped (or partially so) since the advice was given
+                continue;
+            }
+            freed += reap_clean_pages(reinterpret_cast<void*>(r.start), r.size);
+        }
+    }
+    return freed;
+}
+
 error advise(void* addr, size_t size, int advice)
 {
     PREVENT_STACK_PAGE_FAULT
@@ -1283,6 +1844,31 @@ error advise(void* addr, size_t size, int advice)
         if (advice == advise_dontneed) {
             depopulate(addr, size);
             return no_error();
+        } else if (advice == advise_free) {
+#ifdef __x86_64__
+            // Lazy: clear the dirty bits now and let the shrinker reap
+            // whatever the application did not touch again, only when
+            // memory actually gets tight.
+            mark_lazy_free(addr, size);
+            if (lazy_free_ranges.size() < max_lazy_free_ranges) {
+                if (!s_lazy_free_shrinker) {
+                    s_lazy_free_shrinker = new lazy_free_shrinker();
+                }
+                lazy_free_ranges.push_back(
+                        {reinterpret_cast<uintptr_t>(addr), size});
+            } else {
+                reap_clean_pages(addr, size);
+            }
+#else
+            // Without hardware dirty-bit updates we could not tell a page
+            // rewritten after the advice from a reclaimable one, so
+            // degrade to an immediate MADV_DONTNEED-style release.
+            depopulate(addr, size);
+#endif
+            return no_error();
+        } else if (advice == advise_hugepage) {
+            hugepage(addr, size);
+            return no_error();
         } else if (advice == advise_nohugepage) {
             nohugepage(addr, size);
             return no_error();
@@ -1309,6 +1895,18 @@ ulong populate_vma(vma *vma, void *v, size_t size, bool write = false)
     return total;
 }
 
+// Writable anonymous mappings at least this large get their huge-page
+// aligned interior backed eagerly, at map_anon() time, with 2MB pages.
+// Faulting such ranges in on demand costs a vmexit per 2MB, and worse, once
+// physical memory becomes fragmented the lazy faults degrade to 4K pages
+// for the lifetime of the mapping; one early contiguous allocation burst
+// gets the TLB-friendly mappings while large free ranges still exist.
+// Read-only (e.g. PROT_NONE reservations, which malloc implementations and
+// the JVM mprotect or re-mmap piecemeal later), stack, and mmap_small
+// mappings stay lazy, as do mappings below the threshold - for those the
+// commit-ahead would be pure waste if the application never touches them.
+size_t huge_eager_threshold = 64 << 20;
+
 void* map_anon(const void* addr, size_t size, unsigned flags, unsigned perm)
 {
     bool search = !(flags & mmap_fixed);
@@ -1320,6 +1918,23 @@ void* map_anon(const void* addr, size_t size, unsigned flags, unsigned perm)
     auto v = (void*) allocate(vma, start, size, search);
     if (flags & mmap_populate) {
         populate_vma(vma, v, size);
+    } else if (!(flags & (mmap_small | mmap_stack))
+            && ((flags & mmap_huge)
+                || ((perm & perm_write) && size >= huge_eager_threshold))) {
+        // mmap_huge (MAP_HUGETLB) asks for the eager 2MB backing
+        // explicitly, whatever the size or protection - e.g. a JVM code
+        // cache mapped PROT_NONE and committed piecemeal later.
+        // The unaligned edges stay lazy; they could only ever use 4K
+        // pages, so faulting them in as needed loses nothing.
+        auto hp_start = align_up(reinterpret_cast<uintptr_t>(v), huge_page_size);
+        auto hp_end = align_down(reinterpret_cast<uintptr_t>(v) + size, huge_page_size);
+        if (hp_start < hp_end) {
+            auto total = populate_vma<account_opt::yes>(vma,
+                    reinterpret_cast<void*>(hp_start), hp_end - hp_start);
+            if (flags & mmap_jvm_heap) {
+                memory::stats::on_jvm_heap_alloc(total);
+            }
+        }
     }
     return v;
 }
@@ -1334,6 +1949,39 @@ std::unique_ptr<file_vma> map_file_mmap(file* file, addr_range range, unsigned f
     return std::unique_ptr<file_vma>(new file_vma(range, perm, flags, file, offset, new map_file_page_mmap(file, offset, flags & mmap_shared)));
 }
 
+// Maps a fixed physical range - device memory such as an ivshmem shared
+// memory BAR, already covered by the linear map - into a vma. The device
+// owns the memory: unmap just drops the pte and never frees anything.
+class map_phys_page : public page_allocator {
+private:
+    uintptr_t _paddr;
+
+public:
+    map_phys_page(uintptr_t paddr) : _paddr(paddr) {}
+    virtual ~map_phys_page() {};
+
+    virtual bool map(uintptr_t offset, hw_ptep<0> ptep, pt_element<0> pte, bool write) override {
+        return write_pte(phys_to_virt(_paddr + offset), ptep, pte);
+    }
+    virtual bool map(uintptr_t offset, hw_ptep<1> ptep, pt_element<1> pte, bool write) override {
+        if ((_paddr + offset) & (huge_page_size - 1)) {
+            return false;
+        }
+        return write_pte(phys_to_virt(_paddr + offset), ptep, pte);
+    }
+    virtual bool unmap(void *addr, uintptr_t offset, hw_ptep<0> ptep) override {
+        return false;
+    }
+    virtual bool unmap(void *addr, uintptr_t offset, hw_ptep<1> ptep) override {
+        return false;
+    }
+};
+
+std::unique_ptr<file_vma> map_phys_mmap(file* file, addr_range range, unsigned flags, unsigned perm, uintptr_t paddr, off_t offset)
+{
+    return std::unique_ptr<file_vma>(new file_vma(range, perm, flags, file, offset, new map_phys_page(paddr + offset)));
+}
+
 void* map_file(const void* addr, size_t size, unsigned flags, unsigned perm,
               fileref f, f_offset offset)
 {
@@ -1821,6 +2469,14 @@ file_vma::file_vma(addr_range range, unsigned perm, unsigned flags, fileref file
     _file_dev_id = st.st_dev;
 }
 
+// Fault-around: a read fault on a pagecache-backed mapping populates a whole
+// aligned window of this many bytes in one pass over the page table, instead
+// of taking a separate fault per page. Pages already present are skipped by
+// the populate operation, and the missing ones come from the file's page
+// cache, which reads them in batches and prefetches ahead of sequential
+// readers - so most of the extra pages cost a map_page() call, not disk I/O.
+static constexpr size_t fault_around_size = 16 * page_size; // 64K
+
 void file_vma::fault(uintptr_t addr, exception_frame *ef)
 {
     auto hp_start = align_up(_range.start(), huge_page_size);
@@ -1831,15 +2487,31 @@ void file_vma::fault(uintptr_t addr, exception_frame *ef)
         return;
     }
     size_t size;
+    auto write = mmu::is_page_fault_write(ef->get_error());
     if (!has_flags(mmap_small) && (hp_start <= addr && addr < hp_end) && offset(hp_end) < fsize) {
         addr = align_down(addr, huge_page_size);
         size = huge_page_size;
+    } else if (!write && dynamic_cast<map_file_page_mmap*>(_page_ops)) {
+        // Write faults stay single-page: around-faulting writes would
+        // spuriously dirty pages of shared mappings, or copy pages of
+        // private ones that are never written to. So do reads served by
+        // a read() per page (map_file_page_read) rather than the page
+        // cache.
+        auto start = std::max(align_down(addr, fault_around_size),
+                _range.start());
+        auto end = std::min(align_up(addr + 1, fault_around_size),
+                _range.end());
+        // Never map pages past the end of the file - an access to them
+        // must keep delivering SIGBUS
+        auto file_end = _range.start() + align_up(fsize - _offset, page_size);
+        end = std::min(end, file_end);
+        addr = start;
+        size = end - start;
     } else {
         size = page_size;
     }
 
-    populate_vma<account_opt::no>(this, (void*)addr, size,
-            mmu::is_page_fault_write(ef->get_error()));
+    populate_vma<account_opt::no>(this, (void*)addr, size, write);
 }
 
 file_vma::~file_vma()
@@ -1997,6 +2669,14 @@ std::string sysfs_linear_maps() {
     return output;
 }
 
+// linear_map() used to run only on the single-threaded early boot path,
+// but the deferred memory onlining workers, ACPI table mapping and driver
+// BAR mapping (mmio_map) all call it concurrently once smp is up, and
+// map_range() populates shared intermediate page table nodes with no
+// internal locking - so serialize every caller here. Uncontended in early
+// boot, and never on a hot path later.
+static mutex linear_map_mutex;
+
 void linear_map(void* _virt, phys addr, size_t size, const char* name,
                 size_t slop, mattr mem_attr)
 {
@@ -2004,7 +2684,9 @@ void linear_map(void* _virt, phys addr, size_t size, const char* name,
     slop = std::min(slop, page_size_level(nr_page_sizes - 1));
     assert((virt & (slop - 1)) == (addr & (slop - 1)));
     linear_page_mapper phys_map(addr, size, mem_attr);
-    map_range(virt, virt, size, phys_map, slop);
+    WITH_LOCK(linear_map_mutex) {
+        map_range(virt, virt, size, phys_map, slop);
+    }
     auto _vma = new linear_vma(_virt, addr, size, mem_attr, name);
     WITH_LOCK(linear_vma_set_mutex.for_write()) {
        linear_vma_set.insert(_vma);
@@ -2040,7 +2722,11 @@ error mprotect(const void *addr, size_t len, unsigned perm)
         return make_error(ENOMEM);
     }
 
-    return protect(addr, len, perm);
+    auto err = protect(addr, len, perm);
+    if (!err.bad() && (perm & perm_exec)) {
+        promote_exec_hugepages(addr, len);
+    }
+    return err;
 }
 
 error munmap(const void *addr, size_t length)
@@ -2069,18 +2755,41 @@ error msync(const void* addr, size_t length, int flags)
 
 error mincore(const void *addr, size_t length, unsigned char *vec)
 {
+    char *start = align_down((char *)addr, page_size);
     char *end = align_up((char *)addr + length, page_size);
-    char tmp;
     SCOPE_LOCK(vma_list_mutex.for_read());
-    if (!is_linear_mapped(addr, length) && !ismapped(addr, length)) {
+    if (is_linear_mapped(addr, length)) {
+        // the linear map is always backed by physical memory
+        memset(vec, 0x01, (end - start) / page_size);
+        return no_error();
+    }
+    if (!ismapped(addr, length)) {
         return make_error(ENOMEM);
     }
-    for (char *p = (char *)addr; p < end; p += page_size) {
-        if (safe_load(p, tmp)) {
-            *vec++ = 0x01;
-        } else {
-            *vec++ = 0x00;
+    // Inspect the actual ptes instead of test-loading the pages - a load
+    // would fault each page in, committing memory just to report all of
+    // them as resident.
+    struct resident_visitor : virt_pte_visitor {
+        bool resident;
+        void pte(pt_element<0> pte) override { resident = !pte.empty(); }
+        void pte(pt_element<1> pte) override { resident = !pte.empty(); }
+    } v;
+    for (char *p = start; p < end; p += page_size) {
+        v.resident = false;
+        virt_visit_pte_rcu(reinterpret_cast<uintptr_t>(p), v);
+        if (!v.resident) {
+            // Not mapped here, but a file page may still sit in the page
+            // cache/ARC - which is what callers scheduling prefetch
+            // actually want to know.
+            auto vma = find_intersecting_vma(reinterpret_cast<uintptr_t>(p));
+            if (vma != vma_list.end() && vma->has_flags(mmap_file)) {
+                auto& f_vma = static_cast<file_vma&>(*vma);
+                auto off = f_vma.offset() +
+                    (reinterpret_cast<uintptr_t>(p) - f_vma.start());
+                v.resident = f_vma.file()->cached_page(off);
+            }
         }
+        *vec++ = v.resident ? 0x01 : 0x00;
     }
     return no_error();
 }
@@ -2108,6 +2817,91 @@ std::string procfs_maps()
     return output;
 }
 
+u64 vma_list_generation()
+{
+    return vma_list.generation.load(std::memory_order_relaxed);
+}
+
+std::string procfs_maps_bin()
+{
+    std::string output;
+    WITH_LOCK(vma_list_mutex.for_read()) {
+        output.reserve(vma_list.size() * sizeof(procfs_bin_vma));
+        for (auto& vma : vma_list) {
+            procfs_bin_vma rec = {};
+            rec.start = vma.start();
+            rec.end = vma.end();
+            if (vma.perm() & perm_read) {
+                rec.perm |= PROCFS_BIN_PERM_READ;
+            }
+            if (vma.perm() & perm_write) {
+                rec.perm |= PROCFS_BIN_PERM_WRITE;
+            }
+            if (vma.perm() & perm_exec) {
+                rec.perm |= PROCFS_BIN_PERM_EXEC;
+            }
+            if (vma.flags() & mmap_file) {
+                const file_vma &f_vma = static_cast<file_vma&>(vma);
+                rec.flags |= PROCFS_BIN_VMA_FILE;
+                rec.file_offset = f_vma.offset();
+            }
+            output.append(reinterpret_cast<const char*>(&rec), sizeof(rec));
+        }
+    }
+    return output;
+}
+
+// One read-only pass over the ptes of a vma, counting what is actually
+// mapped. Copies of the mapper share the caller's counters, since
+// operate_range() takes its mapper by value.
+class page_counter : public vma_operation<allocate_intermediate_opt::no, skip_empty_opt::yes> {
+private:
+    ulong& _resident;
+    ulong& _huge;
+    ulong& _dirty;
+public:
+    page_counter(ulong& resident, ulong& huge, ulong& dirty)
+        : _resident(resident), _huge(huge), _dirty(dirty) {}
+    template<int N>
+    bool page(hw_ptep<N> ptep, uintptr_t offset) {
+        auto pte = ptep.read();
+        auto pages = pt_level_traits<N>::size::value / page_size;
+        _resident += pages;
+        if (pt_level_traits<N>::large_capable::value) {
+            _huge++;
+        }
+        if (pte.dirty()) {
+            _dirty += pages;
+        }
+        return true;
+    }
+    bool tlb_flush_needed(void) { return false; }
+    void finalize(void) {}
+};
+
+// A cheap per-vma residency report for cache-aware applications: one line
+// per vma with the counts of resident 4K pages, 2MB mappings and dirty
+// pages. Unlike Linux's binary per-page pagemap this is aggregated, which
+// keeps a walk of the whole address space cheap enough to poll.
+std::string procfs_pagemap()
+{
+    std::string output;
+    WITH_LOCK(vma_list_mutex.for_read()) {
+        for (auto& vma : vma_list) {
+            if (!vma.size()) {
+                continue; // skip the edge markers
+            }
+            ulong resident = 0, huge = 0, dirty = 0;
+            page_counter counter(resident, huge, dirty);
+            vma.operate_range(counter, reinterpret_cast<void*>(vma.start()),
+                    vma.size());
+            output += osv::sprintf("%012x-%012x resident %ld huge %ld dirty %ld\n",
+                    vma.start(), vma.end(), resident, huge, dirty);
+        }
+    }
+    return output;
+}
+
 }
 
 extern "C" bool is_linear_mapped(const void *addr)
@@ -0,0 +1,109 @@
+/*
+ * Copyright (C) 2026 Waldemar Kozaczuk
+ *
+ * This work is open source software, licensed under the terms of the
+ * BSD license as described in the LICENSE file in the top-level directory.
+ */
+
+#include <osv/net_busy_poll.hh>
+#include <osv/rcu.hh>
+#include <osv/mutex.h>
+#include <osv/clock.hh>
+#include <osv/trace.hh>
+
+#include <vector>
+#include <algorithm>
+#include <memory>
+
+TRACEPOINT(trace_net_busy_poll_spin, "budget_us=%d", unsigned);
+TRACEPOINT(trace_net_busy_poll_spin_ret, "found=%d", int);
+
+namespace osv {
+namespace net_busy_poll {
+
+//
+// The poller list is read on every polling pass but only written when a
+// NIC comes or goes, so it uses the same copy-on-update rcu scheme as
+// net_channel's poller list.
+//
+static mutex pollers_mutex;
+static osv::rcu_ptr<std::vector<poller*>> pollers;
+
+void register_poller(poller* p)
+{
+    WITH_LOCK(pollers_mutex) {
+        auto old = pollers.read_by_owner();
+        std::unique_ptr<std::vector<poller*>> neww{new std::vector<poller*>};
+        if (old) {
+            *neww = *old;
+        }
+        neww->push_back(p);
+        pollers.assign(neww.release());
+        osv::rcu_dispose(old);
+    }
+}
+
+void unregister_poller(poller* p)
+{
+    WITH_LOCK(pollers_mutex) {
+        auto old = pollers.read_by_owner();
+        std::unique_ptr<std::vector<poller*>> neww{new std::vector<poller*>};
+        if (old) {
+            *neww = *old;
+        }
+        neww->erase(std::remove(neww->begin(), neww->end(), p), neww->end());
+        pollers.assign(neww.release());
+        osv::rcu_dispose(old);
+    }
+    // Make sure no spin() still sees the poller before the caller tears
+    // down the device behind it.
+    osv::rcu_synchronize();
+}
+
+template <typename Func>
+static inline void for_each_poller(Func func)
+{
+    WITH_LOCK(osv::rcu_read_lock) {
+        auto pl = pollers.read();
+        if (pl) {
+            for (auto p : *pl) {
+                func(p);
+            }
+        }
+    }
+}
+
+bool spin(unsigned budget_us, std::function<bool ()> ready)
+{
+    trace_net_busy_poll_spin(budget_us);
+
+    auto deadline = osv::clock::uptime::now() +
+                    std::chrono::microseconds(budget_us);
+
+    //
+    // Masking is best-effort: concurrent spinners and the drivers' own
+    // interrupt management may re-enable an interrupt under our feet,
+    // which costs a spurious exit but nothing else.
+    //
+    for_each_poller([] (poller* p) { p->mask(); });
+
+    bool found = ready();
+    while (!found && osv::clock::uptime::now() < deadline) {
+        //
+        // Each pass takes the rcu read lock only briefly so we stay
+        // preemptable while spinning - the rx thread a poller wakes has
+        // a stronger priority and must be able to run, possibly on this
+        // very cpu.
+        //
+        for_each_poller([] (poller* p) { p->poll(); });
+        found = ready();
+    }
+
+    for_each_poller([] (poller* p) { p->unmask(); });
+
+    trace_net_busy_poll_spin_ret(found);
+    return found;
+}
+
+}
+}
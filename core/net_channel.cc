@@ -12,18 +12,83 @@
 #include <bsd/sys/netinet/ip.h>
 #include <bsd/sys/netinet/ip.h>
 #include <bsd/sys/netinet/tcp.h>
+#include <bsd/sys/netinet/udp.h>
 #include <bsd/sys/net/ethernet.h>
 #include <bsd/sys/net/netisr.h>
 
 #include <osv/net_trace.hh>
+#include <osv/trace.hh>
+#include <osv/clock.hh>
 #include <algorithm>
+#include <vector>
+
+// The ctx argument carries the owning socket's SO_TRACE_CONTEXT id (0 if
+// none was set), letting host-side analysis stitch these kernel events
+// into a request's distributed trace across guests.
+TRACEPOINT(trace_net_channel_push, "channel=%p ctx=0x%x", net_channel*, uint64_t);
+TRACEPOINT(trace_net_channel_wake, "channel=%p ctx=0x%x", net_channel*, uint64_t);
+TRACEPOINT(trace_net_channel_drain, "channel=%p ctx=0x%x packets=%d",
+        net_channel*, uint64_t, unsigned);
+
+// All live channels, so net_channel_foreach_stats() can walk their
+// counters. Registration happens at channel construction, which is off
+// the packet paths.
+static mutex channels_mutex;
+static std::vector<net_channel*> channels;
+static uint64_t next_channel_id;
+
+net_channel::net_channel(std::function<void (mbuf*)> process_packet)
+    : _process_packet(std::move(process_packet))
+{
+    WITH_LOCK(channels_mutex) {
+        _stats.id = ++next_channel_id;
+        channels.push_back(this);
+    }
+}
+
+net_channel::~net_channel()
+{
+    WITH_LOCK(channels_mutex) {
+        channels.erase(std::remove(channels.begin(), channels.end(), this),
+                channels.end());
+    }
+}
+
+void net_channel_foreach_stats(std::function<void (const net_channel_stats&)> f)
+{
+    WITH_LOCK(channels_mutex) {
+        for (auto ch : channels) {
+            f(ch->stats());
+        }
+    }
+}
+
+void net_channel::stamp_head()
+{
+    _head_enqueue.store(osv::clock::uptime::now().time_since_epoch().count(),
+            std::memory_order_relaxed);
+}
 
 void net_channel::process_queue()
 {
     mbuf* m;
-    while (_queue.pop(m)) {
-        _process_packet(m);
+    if (!_queue.pop(m)) {
+        return;
     }
+    // How long did the head of the queue sit before we ran? A racing
+    // push may leave us a slightly stale stamp; the wait counters are
+    // monitoring data, not an exact histogram.
+    auto now = osv::clock::uptime::now().time_since_epoch().count();
+    auto wait = now - _head_enqueue.load(std::memory_order_relaxed);
+    net_channel_update_wait_stats(_stats, wait > 0 ? wait : 0);
+    _stats.wakeups++;
+    unsigned packets = 0;
+    do {
+        packets++;
+        _process_packet(m);
+    } while (_queue.pop(m));
+    _stats.packets += packets;
+    trace_net_channel_drain(this, trace_ctx(), packets);
 }
 
 void net_channel::wake_pollers()
@@ -110,6 +175,11 @@ void classifier::add(ipv4_tcp_conn_id id, net_channel* channel)
 void classifier::remove(ipv4_tcp_conn_id id)
 {
     WITH_LOCK(_mtx) {
+        // Invalidate the flow caches before the erase, so a cached pointer
+        // to this channel can no longer validate. A racing reader may still
+        // use a pointer it fetched earlier, but it holds the rcu read lock,
+        // and the channel is only destroyed after a grace period.
+        _generation.fetch_add(1, std::memory_order_relaxed);
         auto i = _ipv4_tcp_channels.owner_find(id,
                 std::hash<ipv4_tcp_conn_id>(), key_item_compare());
         assert(i);
@@ -117,19 +187,40 @@ void classifier::remove(ipv4_tcp_conn_id id)
     }
 }
 
+void classifier::add_udp(ipv4_tcp_conn_id id, net_channel* channel)
+{
+    WITH_LOCK(_mtx) {
+        _ipv4_udp_channels.emplace(id, channel);
+    }
+}
+
+void classifier::remove_udp(ipv4_tcp_conn_id id)
+{
+    WITH_LOCK(_mtx) {
+        // see remove() above for the generation bump
+        _generation.fetch_add(1, std::memory_order_relaxed);
+        auto i = _ipv4_udp_channels.owner_find(id,
+                std::hash<ipv4_tcp_conn_id>(), key_item_compare());
+        assert(i);
+        _ipv4_udp_channels.erase(i);
+    }
+}
+
 bool classifier::post_packet(mbuf* m)
 {
 #if CONF_lazy_stack_invariant
     assert(!sched::thread::current()->is_app());
 #endif
     WITH_LOCK(osv::rcu_read_lock) {
-        if (auto nc = classify_ipv4_tcp(m)) {
+        if (auto nc = classify_ipv4(m)) {
             log_packet_in(m, NETISR_ETHER);
             if (!nc->push(m)) {
                 return false;
             }
+            trace_net_channel_push(nc, nc->trace_ctx());
             // FIXME: find a way to batch wakes
             nc->wake();
+            trace_net_channel_wake(nc, nc->trace_ctx());
             return true;
         }
     }
@@ -137,7 +228,7 @@ bool classifier::post_packet(mbuf* m)
 }
 
 // must be called with rcu lock held
-net_channel* classifier::classify_ipv4_tcp(mbuf* m)
+net_channel* classifier::classify_ipv4(mbuf* m)
 {
     caddr_t h = m->m_hdr.mh_data;
     if (unsigned(m->m_hdr.mh_len) < ETHER_HDR_LEN + sizeof(ip)) {
@@ -153,7 +244,8 @@ net_channel* classifier::classify_ipv4_tcp(mbuf* m)
     if (ip_size < sizeof(ip)) {
         return nullptr;
     }
-    if (ip_hdr->ip_p != IPPROTO_TCP) {
+    auto proto = ip_hdr->ip_p;
+    if (proto != IPPROTO_TCP && proto != IPPROTO_UDP) {
         return nullptr;
     }
     if (ntohs(ip_hdr->ip_off) & ~IP_DF) {
@@ -162,17 +254,52 @@ net_channel* classifier::classify_ipv4_tcp(mbuf* m)
     auto src_addr = ip_hdr->ip_src;
     auto dst_addr = ip_hdr->ip_dst;
     h += ip_size;
-    auto tcp_hdr = reinterpret_cast<tcphdr*>(h);
-    if (tcp_hdr->th_flags & (TH_SYN | TH_FIN | TH_RST)) {
-	    return nullptr;
+    in_port_t src_port, dst_port;
+    if (proto == IPPROTO_TCP) {
+        auto tcp_hdr = reinterpret_cast<tcphdr*>(h);
+        if (tcp_hdr->th_flags & (TH_SYN | TH_FIN | TH_RST)) {
+            return nullptr;
+        }
+        src_port = ntohs(tcp_hdr->th_sport);
+        dst_port = ntohs(tcp_hdr->th_dport);
+    } else {
+        // The UDP channel callback assumes an option-less IP header
+        // (see udp_net_channel_packet()), so packets carrying options
+        // take the regular path.
+        if (ip_size != sizeof(ip)) {
+            return nullptr;
+        }
+        auto udp_hdr = reinterpret_cast<udphdr*>(h);
+        src_port = ntohs(udp_hdr->uh_sport);
+        dst_port = ntohs(udp_hdr->uh_dport);
     }
-    auto src_port = ntohs(tcp_hdr->th_sport);
-    auto dst_port = ntohs(tcp_hdr->th_dport);
     auto id = ipv4_tcp_conn_id{src_addr, dst_addr, src_port, dst_port};
-    auto i = _ipv4_tcp_channels.reader_find(id,
+    flow_cache_entry* fce = nullptr;
+    if (m->m_hdr.mh_flags & M_FLOWID) {
+        // Reuse the RSS hash the NIC already computed for this packet
+        // instead of walking the hashtable. We run with preemption
+        // disabled (rcu lock), so the percpu cache needs no locking.
+        auto flowid = m->M_dat.MH.MH_pkthdr.flowid;
+        fce = &(*_flow_cache)->entries[flowid & (flow_cache_size - 1)];
+        if (fce->generation == _generation.load(std::memory_order_relaxed)
+                && fce->flowid == flowid && fce->proto == proto
+                && fce->key == id) {
+            return fce->chan;
+        }
+        fce->flowid = flowid;
+    }
+    auto& channels = (proto == IPPROTO_TCP) ? _ipv4_tcp_channels
+                                            : _ipv4_udp_channels;
+    auto i = channels.reader_find(id,
             std::hash<ipv4_tcp_conn_id>(), key_item_compare());
     if (!i) {
         return nullptr;
     }
+    if (fce) {
+        fce->key = id;
+        fce->proto = proto;
+        fce->chan = i->chan;
+        fce->generation = _generation.load(std::memory_order_relaxed);
+    }
     return i->chan;
 }
@@ -147,6 +147,7 @@ using slice_t = mbuf_slice<capture_limit>;
 TRACEPOINT(trace_net_packet_in, "proto=%d, data=%s", int, slice_t);
 TRACEPOINT(trace_net_packet_out, "proto=%d, data=%s", int, slice_t);
 TRACEPOINT(trace_net_packet_handling, "proto=%d, data=%s", int, slice_t);
+TRACEPOINT(trace_net_txq_xmit, "ctx=0x%x, len=%d", uint64_t, int);
 
 void log_packet_in(struct mbuf* m, int proto)
 {
@@ -162,3 +163,9 @@ void log_packet_handling(struct mbuf* m, int proto)
 {
     trace_net_packet_handling(proto, slice_t(m));
 }
+
+void log_txq_xmit(struct mbuf* m)
+{
+    trace_net_txq_xmit(m->M_dat.MH.MH_pkthdr.trace_ctx,
+                       m->M_dat.MH.MH_pkthdr.len);
+}
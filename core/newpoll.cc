@@ -46,6 +46,16 @@ void poller::set_timer(std::chrono::high_resolution_clock::time_point when)
     _timer->reset(ut);
 }
 
+void poller::set_timer(std::chrono::nanoseconds uptime_when)
+{
+    _timer->reset(osv::clock::uptime::time_point(uptime_when));
+}
+
+void poller::cancel_timer()
+{
+    _timer->cancel();
+}
+
 bool poller::expired()
 {
     if (_timer->expired()) {
@@ -0,0 +1,103 @@
+/*
+ * Copyright (C) 2026 Waldemar Kozaczuk
+ *
+ * This work is open source software, licensed under the terms of the
+ * BSD license as described in the LICENSE file in the top-level directory.
+ */
+
+#include <osv/numa.hh>
+#include <osv/debug.hh>
+#include <vector>
+
+namespace numa {
+
+unsigned nr_nodes = 1;
+
+// dense node id -> firmware proximity domain, in registration order
+static std::vector<u32> domains;
+
+struct cpu_affinity {
+    u32 apic_id;
+    unsigned node;
+};
+static std::vector<cpu_affinity> cpu_affinities;
+
+struct memory_range {
+    u64 base;
+    u64 end;
+    unsigned node;
+};
+static std::vector<memory_range> memory_ranges;
+
+static unsigned node_for_domain(u32 domain)
+{
+    for (unsigned i = 0; i < domains.size(); i++) {
+        if (domains[i] == domain) {
+            return i;
+        }
+    }
+    if (domains.size() == max_nodes) {
+        // more domains than we track; fold the overflow into the last node
+        // instead of forgetting its cpus and memory
+        return max_nodes - 1;
+    }
+    domains.push_back(domain);
+    return domains.size() - 1;
+}
+
+void add_cpu(u32 apic_id, u32 proximity_domain)
+{
+    cpu_affinities.push_back({apic_id, node_for_domain(proximity_domain)});
+}
+
+void add_memory_range(u64 base, u64 length, u32 proximity_domain)
+{
+    memory_ranges.push_back({base, base + length,
+            node_for_domain(proximity_domain)});
+}
+
+unsigned cpu_node(u32 apic_id)
+{
+    for (auto& ca : cpu_affinities) {
+        if (ca.apic_id == apic_id) {
+            return ca.node;
+        }
+    }
+    return 0;
+}
+
+u64 node_boundary(u64 phys)
+{
+    u64 next = ~0ULL;
+    for (auto& mr : memory_ranges) {
+        if (mr.base > phys && mr.base < next) {
+            next = mr.base;
+        }
+        if (mr.end > phys && mr.end < next) {
+            next = mr.end;
+        }
+    }
+    return next;
+}
+
+unsigned node_of(u64 phys)
+{
+    for (auto& mr : memory_ranges) {
+        if (phys >= mr.base && phys < mr.end) {
+            return mr.node;
+        }
+    }
+    return 0;
+}
+
+void complete()
+{
+    if (domains.size() <= 1) {
+        // no affinity information (or a single domain) - stay single-node
+        return;
+    }
+    nr_nodes = domains.size();
+    debugf("numa: %d nodes\n", nr_nodes);
+}
+
+}
@@ -16,6 +16,8 @@
 #include <osv/commands.hh>
 #include <osv/firmware.hh>
 #include <osv/hypervisor.hh>
+#include "drivers/zfs.hh"
+#include <osv/boot.hh>
 #include "cpuid.hh"
 #include <vector>
 
@@ -63,6 +65,31 @@ static char* str_to_c_str(const std::string& str) {
     return buf;
 }
 
+extern "C" OSV_MODULE_API
+int osv_get_bootchart_events(osv_bootchart_event** event_arr, size_t *len) {
+    auto count = boot_time.count();
+    auto *events = (osv_bootchart_event*)malloc(count * sizeof(osv_bootchart_event));
+    if (events == nullptr) {
+        *len = 0;
+        return ENOMEM;
+    }
+    for (int i = 0; i < count; i++) {
+        events[i].name = str_to_c_str(boot_time.entry_name(i));
+        if (events[i].name == nullptr) {
+            for (int j = 0; j < i; j++) {
+                free(events[j].name);
+            }
+            free(events);
+            *len = 0;
+            return ENOMEM;
+        }
+        events[i].time_ms = boot_time.entry_msec(i);
+    }
+    *event_arr = events;
+    *len = count;
+    return 0;
+}
+
 extern "C" OSV_MODULE_API
 int osv_get_all_threads(osv_thread** thread_arr, size_t *len) {
     using namespace std::chrono;
@@ -157,3 +184,11 @@ extern "C" OSV_MODULE_API
 bool osv_debug_enabled() {
     return verbose;
 }
+
+extern "C" OSV_MODULE_API
+int osv_zfs_zfetch_stats(struct osv_zfetch_stats *stats) {
+    return zfsdev::zfs_zfetch_stats(&stats->hits, &stats->misses,
+                                    &stats->stride_hits, &stats->stride_misses,
+                                    &stats->fetched_blocks,
+                                    &stats->reclaim_failures);
+}
@@ -10,10 +10,13 @@
 #include <unordered_set>
 #include <deque>
 #include <stack>
+#include <vector>
+#include <algorithm>
 #include <boost/variant.hpp>
 #include <osv/pagecache.hh>
 #include <osv/mempool.hh>
 #include <osv/export.h>
+#include <osv/condvar.h>
 #include <fs/vfs/vfs.h>
 #include <fs/vfs/vfs_id.h>
 #include <osv/trace.hh>
@@ -84,10 +87,20 @@ static unsigned lru_free_count = 20;
 constexpr unsigned max_lru_free_count = 200;
 static void* zero_page;
 
+// Write-behind: dirty pages accumulated in the write cache are written
+// back by a background flusher thread (see write_behind_flusher below)
+// instead of lingering until fsync(), eviction or unmap. A writer that
+// dirties pages faster than the flusher retires them is throttled once
+// the dirty set grows past write_behind_max_dirty pages, so a burst of
+// writes cannot turn a later sync into one giant stall.
+static std::atomic<size_t> dirty_page_count = {};
+static size_t write_behind_max_dirty = 100;
+
 void  __attribute__((constructor(init_prio::pagecache))) setup()
 {
     lru_max_length = std::max(memory::phys_mem_size / memory::page_size / 100, size_t(100));
     lru_free_count = std::min(lru_max_length/5, max_lru_free_count);
+    write_behind_max_dirty = std::max(lru_max_length / 4, 100u);
     zero_page = memory::alloc_page();
     memset(zero_page, 0, mmu::page_size);
 }
@@ -230,7 +243,7 @@ public:
         struct iovec iov {_page, mmu::page_size};
         struct uio uio {&iov, 1, _key.offset, mmu::page_size, UIO_WRITE};
 
-        _dirty = false;
+        clear_dirty_flag();
 
         vn_lock(_vp);
         error = VOP_WRITE(_vp, &uio, 0);
@@ -238,6 +251,27 @@ public:
 
         return error;
     }
+    // Write back a run of pages of the same vnode with consecutive offsets
+    // as a single vectored write - cheaper for the filesystem than one
+    // VOP_WRITE per page
+    static int writeback_run(cached_page_write** pages, unsigned count)
+    {
+        int error;
+        struct iovec iov[count];
+        for (unsigned i = 0; i < count; i++) {
+            iov[i] = {pages[i]->_page, mmu::page_size};
+            pages[i]->clear_dirty_flag();
+        }
+        struct uio uio {iov, (int)count, pages[0]->_key.offset,
+            (off_t)(count * mmu::page_size), UIO_WRITE};
+
+        auto vp = pages[0]->_vp;
+        vn_lock(vp);
+        error = VOP_WRITE(vp, &uio, 0);
+        vn_unlock(vp);
+
+        return error;
+    }
     void* release() { // called to demote a page from cache page to anonymous
         assert(boost::get<std::nullptr_t>(_ptes) == nullptr);
         void *p = _page;
@@ -246,7 +280,19 @@ public:
         return p;
     }
     void mark_dirty() {
-        _dirty |= true;
+        if (!_dirty) {
+            _dirty = true;
+            dirty_page_count.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+    void clear_dirty_flag() {
+        if (_dirty) {
+            _dirty = false;
+            dirty_page_count.fetch_sub(1, std::memory_order_relaxed);
+        }
+    }
+    bool dirty() {
+        return _dirty;
     }
     bool flush_check_dirty() {
         return for_each_pte([] (mmu::hw_ptep<0> pte) { return mmu::clear_pte(pte).dirty(); }, std::logical_or<bool>(), false);
@@ -480,8 +526,111 @@ static std::unique_ptr<cached_page_write> create_write_cached_page(vfs_file* fp,
     return std::unique_ptr<cached_page_write>(cp);
 }
 
+// Woken by the flusher after each pass to release throttled writers
+static condvar dirty_drained;
+
+TRACEPOINT(trace_writeback_flusher, "flushed=%u, still dirty=%lu", unsigned, size_t);
+class write_behind_flusher {
+    static constexpr std::chrono::milliseconds _interval{200};
+    // Cap on how many pages a single vectored write may carry (256K) -
+    // keeps the stack-allocated iovec array and the time the filesystem
+    // is busy with one write bounded
+    static constexpr unsigned _max_run = 64;
+    condvar _wakeup;
+    std::unique_ptr<sched::thread> _thread;
+public:
+    write_behind_flusher() : _thread(sched::thread::make(std::bind(&write_behind_flusher::run, this),
+            sched::thread::attr().name("page-writeback"))) {
+        _thread->start();
+    }
+    void wake() {
+        _wakeup.wake_one();
+    }
+private:
+    void run()
+    {
+        std::vector<cached_page_write*> dirty;
+        while (true) {
+            WITH_LOCK(write_lock) {
+                // Flush at a fixed interval, or right away when a
+                // throttled writer wakes us
+                _wakeup.wait(&write_lock, _interval);
+
+                // Transfer the hardware dirty bits into the pages' dirty
+                // flags and collect the dirty pages
+                bool cleared = false;
+                for (auto& it : write_cache) {
+                    auto cp = it.second;
+                    if (cp->clear_dirty()) {
+                        cp->mark_dirty();
+                        cleared = true;
+                    }
+                    if (cp->dirty()) {
+                        dirty.push_back(cp);
+                    }
+                }
+                if (cleared) {
+                    mmu::flush_tlb_all();
+                }
+
+                // Sort by (dev, ino, offset) so pages of the same file come
+                // out in ascending offset order and contiguous ones can be
+                // merged into single large writes
+                std::sort(dirty.begin(), dirty.end(),
+                        [](cached_page_write* a, cached_page_write* b) {
+                    auto& ka = a->key();
+                    auto& kb = b->key();
+                    if (ka.dev != kb.dev) {
+                        return ka.dev < kb.dev;
+                    }
+                    if (ka.ino != kb.ino) {
+                        return ka.ino < kb.ino;
+                    }
+                    return ka.offset < kb.offset;
+                });
+
+                unsigned flushed = 0;
+                for (size_t i = 0; i < dirty.size();) {
+                    size_t j = i + 1;
+                    while (j < dirty.size() && j - i < _max_run &&
+                           dirty[j]->key().dev == dirty[i]->key().dev &&
+                           dirty[j]->key().ino == dirty[i]->key().ino &&
+                           dirty[j]->key().offset ==
+                               dirty[j - 1]->key().offset + (off_t)mmu::page_size) {
+                        j++;
+                    }
+                    auto err = cached_page_write::writeback_run(&dirty[i], j - i);
+                    if (err) {
+                        // Keep the pages dirty - the next pass or an
+                        // explicit fsync() will retry (and report)
+                        for (size_t k = i; k < j; k++) {
+                            dirty[k]->mark_dirty();
+                        }
+                    } else {
+                        flushed += j - i;
+                    }
+                    i = j;
+                }
+                dirty.clear();
+                trace_writeback_flusher(flushed, dirty_page_count.load(std::memory_order_relaxed));
+
+                dirty_drained.wake_all();
+            }
+        }
+    }
+};
+
+static write_behind_flusher* s_write_behind_flusher = nullptr;
+
+constexpr std::chrono::milliseconds write_behind_flusher::_interval;
+
 TRACEPOINT(trace_drop_write_cached_page, "addr=%p", void*);
 static void insert(cached_page_write* cp) {
+    // Start the flusher lazily - by the first time a write cache page
+    // exists the scheduler is certainly up
+    if (!s_write_behind_flusher) {
+        s_write_behind_flusher = new write_behind_flusher();
+    }
     static cached_page_write* tofree[max_lru_free_count];
     write_cache.emplace(cp->key(), cp);
     write_lru.push_front(cp);
@@ -506,12 +655,46 @@ static void insert(cached_page_write* cp) {
 
 #define IS_ZFS(st_dev) ((st_dev & (0xffULL<<56)) == ZFS_ID)
 
+// Tell whether the file page at offset sits in one of the caches, without
+// mapping or faulting anything in - the answer mincore() needs for file
+// mappings whose pte is not (yet) populated.
+bool is_cached(vfs_file* fp, off_t offset)
+{
+    struct stat st;
+    fp->stat(&st);
+    hashkey key {st.st_dev, st.st_ino, offset};
+    WITH_LOCK(write_lock) {
+        if (find_in_cache(write_cache, key)) {
+            return true;
+        }
+    }
+    if (IS_ZFS(st.st_dev)) {
+        WITH_LOCK(arc_read_lock) {
+            return find_in_cache(arc_read_cache, key) != nullptr;
+        }
+    } else {
+        WITH_LOCK(read_lock) {
+            return find_in_cache(read_cache, key) != nullptr;
+        }
+    }
+}
+
 bool get(vfs_file* fp, off_t offset, mmu::hw_ptep<0> ptep, mmu::pt_element<0> pte, bool write, bool shared)
 {
     struct stat st;
     fp->stat(&st);
     hashkey key {st.st_dev, st.st_ino, offset};
     SCOPE_LOCK(write_lock);
+
+    if (write && s_write_behind_flusher) {
+        // Dirty-ratio throttling: make the writer wait for the flusher
+        // instead of letting it grow the dirty set without bound
+        while (dirty_page_count.load(std::memory_order_relaxed) > write_behind_max_dirty) {
+            s_write_behind_flusher->wake();
+            dirty_drained.wait(&write_lock);
+        }
+    }
+
     cached_page_write* wcp = find_in_cache(write_cache, key);
 
     if (write) {
@@ -22,6 +22,7 @@ sched::cpu::notifier workman::_cpu_notifier(workman::pcpu_init);
 
 PERCPU(std::atomic<bool>, workman::_duty);
 PERCPU(std::atomic<bool>, workman::_ready);
+PERCPU(workman::work_queue*, workman::_queue);
 PERCPU(sched::thread*, workman::_work_sheriff);
 
 extern char _percpu_workers_start[];
@@ -40,8 +41,13 @@ worker_item::worker_item(std::function<void ()> handler)
 void worker_item::signal(sched::cpu* cpu)
 {
     trace_pcpu_worker_item_signal(this, cpu->id);
-    _have_work[cpu->id].store(true, std::memory_order_relaxed);
-    workman_instance.signal(cpu);
+    // Coalesce repeated signals: while _have_work is set the item is
+    // already queued (or about to be invoked), so a second producer does
+    // not need to enqueue it again.
+    if (_have_work[cpu->id].exchange(true, std::memory_order_acq_rel)) {
+        return;
+    }
+    workman_instance.signal(cpu, this);
 }
 
 bool worker_item::have_work(sched::cpu* cpu)
@@ -59,7 +65,7 @@ void worker_item::clear_work(sched::cpu* cpu)
     _have_work[cpu->id].store(false, std::memory_order_release);
 }
 
-bool workman::signal(sched::cpu* cpu)
+bool workman::signal(sched::cpu* cpu, worker_item* item)
 {
     if (!(*_ready).load(std::memory_order_relaxed)) {
         return false;
@@ -67,18 +73,22 @@ bool workman::signal(sched::cpu* cpu)
 
     //
     // let the sheriff know that he have to do what he have to do.
-    // we simply set _duty=true and wake the sheriff
+    // we simply push the item on the cpu's queue and wake the sheriff.
     //
-    // when we signal a worker_item, we set 2 variables to true, the per
-    // worker_item's per-cpu _have_work variable and the global _duty variable
-    // of the cpu's sheriff we are signaling.
+    // push() is a release operation, so the sheriff observing the item in
+    // the queue also observes its _have_work flag set by our caller.
     //
-    // we want the sheriff to see _duty=true only after _have_work=true.
-    // in case duty=true will be seen before _have_work=true, we may miss
-    // it in the sheriff thread.
+    // Signal coalescing in worker_item::signal() bounds the queue depth
+    // by the number of worker items (give or take items being invoked
+    // right now), so with a 256-deep ring a failing push can only mean a
+    // wildly mis-sized configuration. Fall back to the sheriff's full
+    // scan of the .percpu_workers section rather than losing the signal.
     //
-    (*(_duty.for_cpu(cpu))).store(true, std::memory_order_release);
-    (*_work_sheriff.for_cpu(cpu))->wake();
+    work_queue* queue = *_queue.for_cpu(cpu);
+    if (!queue->push(item)) {
+        (*(_duty.for_cpu(cpu))).store(true, std::memory_order_release);
+    }
+    queue->wake_consumer();
 
     return true;
 }
@@ -88,29 +98,41 @@ void workman::call_of_duty(void)
     (*_ready).store(true, std::memory_order_relaxed);
     trace_pcpu_worker_sheriff_started();
 
+    sched::cpu* current = sched::cpu::current();
+    work_queue* queue = *_queue;
+
     while (true) {
-        sched::thread::wait_until([&] {
+        sched::thread::wait_for(*queue, [] {
             return ((*_duty).load(std::memory_order_relaxed) == true);
         });
 
-        (*_duty).store(false, std::memory_order_relaxed);
+        worker_item* wi;
+        while (queue->pop(wi)) {
+            trace_pcpu_worker_item_invoke(wi);
+            wi->clear_work(current);
+            wi->_handler();
+            wi->set_finished(current);
+        }
 
-        // Invoke all work items that needs handling. FIXME: O(n)
-        sched::cpu* current = sched::cpu::current();
-        worker_item* wi = reinterpret_cast<worker_item*>(_percpu_workers_start);
-        worker_item* end = reinterpret_cast<worker_item*>(_percpu_workers_end);
+        if ((*_duty).exchange(false, std::memory_order_relaxed)) {
+            // A producer overflowed the queue - invoke all work items
+            // that need handling the slow way, scanning the whole
+            // .percpu_workers section
+            wi = reinterpret_cast<worker_item*>(_percpu_workers_start);
+            worker_item* end = reinterpret_cast<worker_item*>(_percpu_workers_end);
 
-        while (wi != end) {
+            while (wi != end) {
 
-            // Invoke worker item
-            if (wi->have_work(current)) {
-                trace_pcpu_worker_item_invoke(wi);
-                wi->clear_work(current);
-                wi->_handler();
-                wi->set_finished(current);
-            }
+                // Invoke worker item
+                if (wi->have_work(current)) {
+                    trace_pcpu_worker_item_invoke(wi);
+                    wi->clear_work(current);
+                    wi->_handler();
+                    wi->set_finished(current);
+                }
 
-            wi++;
+                wi++;
+            }
         }
     }
 }
@@ -118,6 +140,7 @@ void workman::call_of_duty(void)
 void workman::pcpu_init()
 {
     (*_duty).store(false, std::memory_order_relaxed);
+    *_queue = new work_queue;
 
     auto c = sched::cpu::current();
     // Create PCPU Sheriff
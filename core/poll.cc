@@ -45,10 +45,13 @@
 #include <assert.h>
 #include <errno.h>
 #include <signal.h>
+#include <mutex>
 
 #include <osv/file.h>
 #include <osv/poll.h>
 #include <osv/export.h>
+#include <osv/mempool.hh>
+#include <osv/net_busy_poll.hh>
 #include <sys/epoll.h>
 
 #include <bsd/porting/netport.h>
@@ -66,6 +69,34 @@ TRACEPOINT(trace_poll_err, "%d", int);
 
 using namespace std;
 
+// Every poll()/epoll_wait() cycle allocates a pollreq and one poll_link
+// per polled file; at high wakeup rates that traffic is visible in
+// profiles. Dedicated typed pools keep these on per-cpu freelists.
+static memory::typed_pool<poll_link> poll_link_pool;
+static memory::typed_pool<pollreq> pollreq_pool;
+
+void* poll_link::operator new(size_t size)
+{
+    assert(size == sizeof(poll_link));
+    return poll_link_pool.alloc();
+}
+
+void poll_link::operator delete(void* object)
+{
+    poll_link_pool.free(object);
+}
+
+void* pollreq::operator new(size_t size)
+{
+    assert(size == sizeof(pollreq));
+    return pollreq_pool.alloc();
+}
+
+void pollreq::operator delete(void* object)
+{
+    pollreq_pool.free(object);
+}
+
 int poll_no_poll(int events)
 {
      // Return ready for read/write.
@@ -240,6 +271,22 @@ void poll_uninstall(struct pollreq* p)
     } /* End of clearing pollreq references from the other fds */
 }
 
+/*
+ * The largest SO_BUSY_POLL budget (in microseconds) requested by any of
+ * the polled sockets, 0 if none of them enables busy polling.
+ */
+static unsigned busy_poll_budget(std::vector<poll_file>& pfd)
+{
+    int budget = 0;
+    for (auto& p : pfd) {
+        auto b = so_busy_poll_budget(p.fp.get());
+        if (b > budget) {
+            budget = b;
+        }
+    }
+    return budget;
+}
+
 int do_poll(std::vector<poll_file>& pfd, file::timeout_t _timeout)
 {
     int nr_events;
@@ -262,6 +309,23 @@ int do_poll(std::vector<poll_file>& pfd, file::timeout_t _timeout)
         goto out;
     }
 
+    /*
+     * SO_BUSY_POLL: before blocking, spin on the NIC rx rings for the
+     * largest budget any of the polled sockets asked for. If an rx ring
+     * delivers, the packet travels to the socket and poll_scan() sees it
+     * without us ever paying the interrupt and wakeup latency.
+     */
+    if (auto budget = busy_poll_budget(p->_pfd)) {
+        osv::net_busy_poll::spin(budget, [&] {
+            nr_events = poll_scan(p->_pfd);
+            return nr_events != 0;
+        });
+        if (nr_events) {
+            pfd = std::move(p->_pfd);
+            goto out;
+        }
+    }
+
     /* Add pollreq references */
     poll_install(p.get());
 
@@ -293,19 +357,247 @@ out:
     return nr_events;
 }
 
-int file::poll_many(struct pollfd _pfd[], nfds_t _nfds, timeout_t timeout)
+/*
+ * poll() registration cache.
+ *
+ * Applications commonly call poll() in a loop with exactly the same fd
+ * array, and with many fds the repeated poll_install()/poll_uninstall()
+ * work - a poll_link allocation and two FD_LOCK acquisitions per fd per
+ * call - dominates. We therefore keep each thread's most recent pollreq
+ * installed on the files between calls; when the next call's (fd, events)
+ * signature matches and every fd still refers to the same file, the call
+ * reduces to a readiness scan (plus a sleep if nothing is ready).
+ *
+ * The cached request pins its files via the filerefs in _pfd, so without
+ * further care a file a cached fd was closed over would stay alive until
+ * the caching thread happened to poll again - a thread that polls a
+ * socket once and then stops would keep the socket open indefinitely,
+ * and close(2) would never send its FIN. To bound the pin, fdclose() and
+ * fdset() call poll_close_cached() when they clear or replace a gfdt
+ * slot: it retires any idle cached request registered on that file right
+ * there, dropping its filerefs. A request the owner is currently inside
+ * poll() with is only flagged stale - the owner retires it when the call
+ * finishes. Either way the pin ends with the close (or the current poll
+ * call), not with the caching thread's goodwill.
+ *
+ * The hand-off between the owning thread and a closer is arbitrated by
+ * _cache_state/_cache_stale under poll_cache_mutex: the owner claims the
+ * request (cached -> busy) for the duration of each call, a closer may
+ * only retire it while it is idle (cached -> retired), and a retired
+ * request's memory is still the owner's to free.
+ */
+static thread_local pollreq* t_poll_cache;
+static ::mutex poll_cache_mutex;
+
+// Tear down a request the current thread holds exclusively (claimed busy,
+// or already unreachable by closers) and give up its cache slot.
+static void poll_cache_retire(pollreq* p)
+{
+    t_poll_cache = nullptr;
+    poll_uninstall(p);
+    p->_poll_thread.clear();
+    osv::rcu_dispose(p);
+}
+
+static void poll_cache_drop()
+{
+    auto p = t_poll_cache;
+    if (!p) {
+        return;
+    }
+    bool retired;
+    WITH_LOCK(poll_cache_mutex) {
+        retired = p->_cache_state == pollreq::cache_state::retired;
+        if (!retired) {
+            // Make any concurrent closer skip the request while we tear
+            // it down outside the lock.
+            p->_cache_state = pollreq::cache_state::none;
+        }
+    }
+    if (retired) {
+        // A closer already uninstalled it; only the memory is left.
+        t_poll_cache = nullptr;
+        osv::rcu_dispose(p);
+    } else {
+        poll_cache_retire(p);
+    }
+}
+
+static void poll_cache_store(pollreq* p)
 {
-    std::vector<poll_file> pfd;
-    pfd.reserve(_nfds);
+    static std::once_flag once;
+    std::call_once(once, [] {
+        sched::thread::register_exit_notifier([] { poll_cache_drop(); });
+    });
+    t_poll_cache = p;
+}
+
+/*
+ * Claim this thread's cached request for the duration of a poll() call,
+ * so no closing fd retires it under us. Returns nullptr if there is no
+ * cached request, or if a closer already retired it (in which case only
+ * freeing the memory is left to us).
+ */
+static pollreq* poll_cache_claim()
+{
+    auto p = t_poll_cache;
+    if (!p) {
+        return nullptr;
+    }
+    WITH_LOCK(poll_cache_mutex) {
+        if (p->_cache_state == pollreq::cache_state::cached) {
+            p->_cache_state = pollreq::cache_state::busy;
+            return p;
+        }
+    }
+    t_poll_cache = nullptr;
+    osv::rcu_dispose(p);
+    return nullptr;
+}
+
+/*
+ * Give up the busy claim at the end of a call: re-cache the request, or
+ * retire it if a closing fd asked us to while we were using it.
+ */
+static void poll_cache_release(pollreq* p)
+{
+    bool stale;
+    WITH_LOCK(poll_cache_mutex) {
+        stale = p->_cache_stale;
+        if (!stale) {
+            p->_cache_state = pollreq::cache_state::cached;
+        }
+    }
+    if (stale) {
+        poll_cache_retire(p);
+    }
+}
+
+/*
+ * Called by fdclose()/fdset() when fp's gfdt slot is cleared or replaced:
+ * retire idle cached requests registered on fp so their filerefs don't
+ * outlive the descriptor, and flag in-use ones for their owner to retire.
+ */
+void poll_close_cached(struct file* fp)
+{
+    std::vector<poll_file> dropped;
+    WITH_LOCK(poll_cache_mutex) {
+        std::vector<pollreq*> victims;
+        FD_LOCK(fp);
+        for (auto& pl : fp->f_poll_list) {
+            auto p = pl._req;
+            switch (p->_cache_state) {
+            case pollreq::cache_state::cached:
+                p->_cache_state = pollreq::cache_state::retired;
+                victims.push_back(p);
+                break;
+            case pollreq::cache_state::busy:
+                p->_cache_stale = true;
+                break;
+            default:
+                break;
+            }
+        }
+        FD_UNLOCK(fp);
+        for (auto p : victims) {
+            poll_uninstall(p);
+            p->_poll_thread.clear();
+            // Move the filerefs out so the fdrops happen after we release
+            // the lock; the memory stays allocated for the owner to free.
+            dropped.insert(dropped.end(),
+                           std::make_move_iterator(p->_pfd.begin()),
+                           std::make_move_iterator(p->_pfd.end()));
+            p->_pfd.clear();
+        }
+    }
+}
 
+static bool poll_cache_match(pollreq* p, struct pollfd _pfd[], nfds_t _nfds)
+{
+    size_t j = 0;
     for (nfds_t i = 0; i < _nfds; ++i) {
-        if (_pfd[i].fd >= 0) {
-            pfd.emplace_back(fileref_from_fd(_pfd[i].fd), _pfd[i].events, _pfd[i].revents);
+        if (_pfd[i].fd < 0) {
+            continue;
+        }
+        if (j == p->_fds.size() || p->_fds[j] != _pfd[i].fd ||
+            p->_pfd[j].events != _pfd[i].events ||
+            !fd_matches_file(_pfd[i].fd, p->_pfd[j].fp.get())) {
+            return false;
+        }
+        ++j;
+    }
+    return j == p->_fds.size();
+}
+
+/*
+ * Like poll_install(), but does not stop at the first ready file: a
+ * partially installed request cannot be kept in the cache, and the caller
+ * scans for readiness right after installing anyway.
+ */
+static void poll_install_all(struct pollreq* p)
+{
+    for (unsigned i = 0; i < p->_nfds; ++i) {
+        auto entry = &p->_pfd[i];
+        auto fp = entry->fp.get();
+        assert(fp);
+
+        std::unique_ptr<poll_link> pl{new poll_link};
+        pl->_req = p;
+        pl->_events = entry->events | (POLLSTANDARD & ~POLL_REQUESTABLE);
+
+        fp->poll_install(*p);
+        FD_LOCK(fp);
+        fp->f_poll_list.push_back(*pl.release());
+        FD_UNLOCK(fp);
+    }
+}
+
+/*
+ * Wait for events on an already-installed pollreq. Because the poll_links
+ * are in place before the initial scan, an event can never fall between
+ * the cracks: it either shows up in the scan, or sets _awake and wakes us.
+ */
+static int poll_wait_installed(struct pollreq* p, file::timeout_t _timeout)
+{
+    sched::timer tmr(*sched::thread::current());
+
+    // Consume any wakeup that arrived since the previous call; whatever
+    // event caused it is level-triggered state which poll_scan() sees.
+    p->_awake.store(false, memory_order_relaxed);
+    int nr_events = poll_scan(p->_pfd);
+    if (nr_events || !_timeout) {
+        return nr_events;
+    }
+
+    if (auto budget = busy_poll_budget(p->_pfd)) {
+        osv::net_busy_poll::spin(budget, [&] {
+            nr_events = poll_scan(p->_pfd);
+            return nr_events != 0;
+        });
+        if (nr_events) {
+            return nr_events;
         }
     }
 
-    auto ret = do_poll(pfd, timeout);
+    tmr.set(*_timeout);
+    do {
+        sched::thread::wait_until([&] {
+            return p->_awake.load(memory_order_relaxed) || tmr.expired();
+        });
+
+        nr_events = 0;
+        if (p->_awake.load(memory_order_relaxed)) {
+            p->_awake.store(false, memory_order_relaxed);
+            nr_events = poll_scan(p->_pfd);
+        }
+    } while (!nr_events && !tmr.expired());
 
+    return nr_events;
+}
+
+static void poll_copy_revents(struct pollfd _pfd[], nfds_t _nfds,
+                              const std::vector<poll_file>& pfd)
+{
     for (nfds_t i = 0, j = 0; i < _nfds; ++i) {
         if (_pfd[i].fd >= 0) {
             _pfd[i].revents = pfd[j].revents;
@@ -314,8 +606,56 @@ int file::poll_many(struct pollfd _pfd[], nfds_t _nfds, timeout_t timeout)
             _pfd[i].revents = 0;
         }
     }
+}
 
-    return ret;
+int file::poll_many(struct pollfd _pfd[], nfds_t _nfds, timeout_t timeout)
+{
+    auto p = poll_cache_claim();
+    if (p && !poll_cache_match(p, _pfd, _nfds)) {
+        // Signature changed: retire the previous request (dropping its
+        // file references). We hold the busy claim, so no closer can
+        // be touching it.
+        poll_cache_retire(p);
+        p = nullptr;
+    }
+    if (!p) {
+        std::unique_ptr<pollreq> np{new pollreq};
+        np->_pfd.reserve(_nfds);
+        np->_fds.reserve(_nfds);
+        bool cacheable = true;
+        for (nfds_t i = 0; i < _nfds; ++i) {
+            if (_pfd[i].fd >= 0) {
+                np->_pfd.emplace_back(fileref_from_fd(_pfd[i].fd),
+                                      _pfd[i].events, _pfd[i].revents);
+                np->_fds.push_back(_pfd[i].fd);
+                if (!np->_pfd.back().fp) {
+                    // POLLNVAL: not installable, so not cacheable.
+                    cacheable = false;
+                }
+            }
+        }
+        np->_nfds = np->_pfd.size();
+
+        if (!cacheable) {
+            auto pfd = std::move(np->_pfd);
+            auto ret = do_poll(pfd, timeout);
+            poll_copy_revents(_pfd, _nfds, pfd);
+            return ret;
+        }
+
+        // Claim the request before its poll_links become visible, so a
+        // close() racing with this call flags it stale rather than
+        // missing it.
+        np->_cache_state = pollreq::cache_state::busy;
+        poll_install_all(np.get());
+        p = np.release();
+        poll_cache_store(p);
+    }
+
+    auto nr_events = poll_wait_installed(p, timeout);
+    poll_copy_revents(_pfd, _nfds, p->_pfd);
+    poll_cache_release(p);
+    return nr_events;
 }
 
 static int poll_one(struct pollfd& pfd, file::timeout_t timeout)
@@ -16,6 +16,7 @@
 #include <osv/migration-lock.hh>
 #include <osv/wait_record.hh>
 #include <osv/mempool.hh>
+#include <osv/interrupt.hh>
 
 namespace osv {
 
@@ -96,6 +97,42 @@ void cpu_quiescent_state_thread::set_generation(uint64_t generation)
     }
 }
 
+// Expedited synchronization support. Our read side just disables
+// preemption, so a cpu whose interrupted context is preemptable cannot be
+// inside a read-side critical section and can confirm quiescence straight
+// from the IPI handler. Only a cpu actually caught with preemption
+// disabled defers its confirmation to its cpu_quiescent_state_thread,
+// whose getting scheduled proves the reader has finished.
+mutex expedited_mutex;
+sched::thread_handle expedited_waiter;
+std::atomic<int> expedited_pendingconfirms;
+static PERCPU(std::atomic<bool>, percpu_expedited_pending);
+
+static void expedited_confirm()
+{
+    if (expedited_pendingconfirms.fetch_add(-1) == 1) {
+        expedited_waiter.wake_from_kernel_or_with_irq_disabled();
+    }
+}
+
+// Confirm a pending expedited request on this cpu; called by the
+// quiescent state thread, whose very running makes the cpu quiescent.
+static void expedited_check_local()
+{
+    if (percpu_expedited_pending->exchange(false, std::memory_order_relaxed)) {
+        expedited_confirm();
+    }
+}
+
+inter_processor_interrupt expedited_ipi{IPI_RCU_EXPEDITED, [] {
+    if (sched::preemptable()) {
+        expedited_confirm();
+    } else {
+        percpu_expedited_pending->store(true, std::memory_order_relaxed);
+        percpu_quiescent_state_thread->wake_from_kernel_or_with_irq_disabled();
+    }
+}};
+
 bool all_at_generation(decltype(cpu_quiescent_state_threads)& cqsts,
                        uint64_t generation)
 {
@@ -117,6 +154,7 @@ void cpu_quiescent_state_thread::work()
 void cpu_quiescent_state_thread::do_work()
 {
     while (true) {
+        expedited_check_local();
         bool toclean = false;
 #if CONF_lazy_stack_invariant
         assert(!sched::thread::current()->is_app());
@@ -156,11 +194,14 @@ void cpu_quiescent_state_thread::do_work()
                 sched::thread::wait_until([&cqsts, &g, this] {
                     return ( (_generation.load(std::memory_order_relaxed) <
                                 _request.load(std::memory_order_acquire))
-                             || all_at_generation(cqsts, g)); });
+                             || all_at_generation(cqsts, g)
+                             || percpu_expedited_pending->load(
+                                     std::memory_order_relaxed)); });
+                expedited_check_local();
                 auto r = _request.load(std::memory_order_relaxed);
                 if (_generation.load(std::memory_order_relaxed) < r) {
                     set_generation(r);
-                } else {
+                } else if (all_at_generation(cqsts, g)) {
                     break;
                 }
             }
@@ -181,7 +222,9 @@ void cpu_quiescent_state_thread::do_work()
             sched::thread::wait_until([=] {
                 return (_generation.load(std::memory_order_relaxed) <
                         _request.load(std::memory_order_acquire)) ||
-                        percpu_callbacks->ncallbacks[percpu_callbacks->buf]; });
+                        percpu_callbacks->ncallbacks[percpu_callbacks->buf] ||
+                        percpu_expedited_pending->load(
+                                std::memory_order_relaxed); });
             auto r = _request.load(std::memory_order_relaxed);
             if (_generation.load(std::memory_order_relaxed) < r) {
                 set_generation(r);
@@ -237,6 +280,24 @@ void rcu_synchronize()
     s.wait();
 }
 
+void rcu_synchronize_expedited()
+{
+    if (sched::cpus.size() <= 1) {
+        // With a single cpu, not being inside a read-side critical section
+        // ourselves is all the quiescence there is.
+        return;
+    }
+    SCOPE_LOCK(migration_lock);
+    std::lock_guard<mutex> guard(expedited_mutex);
+    expedited_waiter.reset(*sched::thread::current());
+    expedited_pendingconfirms.store(sched::cpus.size() - 1);
+    expedited_ipi.send_allbutself();
+    sched::thread::wait_until([] {
+        return expedited_pendingconfirms.load() == 0;
+    });
+    expedited_waiter.clear();
+}
+
 /// Ensure that all queued rcu callbacks are executed.
 /// This function provides a barrier that ensures that all callbacks previously enqueued
 /// with rcu_defer() have completed execution.  This is useful if some data that they
@@ -8,6 +8,7 @@
 #include <mutex>
 #include <osv/sched.hh>
 #include <osv/rwlock.h>
+#include <osv/lockstat.hh>
 #include <osv/export.h>
 
 rwlock::rwlock()
@@ -161,7 +162,9 @@ void rwlock::writer_wait_lockable()
             return;
         }
 
+        auto wait_start = lock_stats::wait_begin();
         _write_waiters.wait(_mtx);
+        lock_stats::wait_end(this, __builtin_return_address(0), wait_start);
     }
 }
 
@@ -172,7 +175,9 @@ void rwlock::reader_wait_lockable()
             return;
         }
 
+        auto wait_start = lock_stats::wait_begin();
         _read_waiters.wait(_mtx);
+        lock_stats::wait_end(this, __builtin_return_address(0), wait_start);
     }
 }
 
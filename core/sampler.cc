@@ -5,7 +5,12 @@
  * BSD license as described in the LICENSE file in the top-level directory.
  */
 
+#include <algorithm>
 #include <chrono>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <unordered_map>
 
 #include <osv/migration-lock.hh>
 #include <osv/sched.hh>
@@ -15,10 +20,24 @@
 #include <osv/trace.hh>
 #include <osv/percpu.hh>
 #include <osv/sampler.hh>
+#include <osv/execinfo.hh>
+#include <osv/demangle.hh>
+#include <osv/elf.hh>
+
+#ifdef __x86_64__
+#include <pmu.hh>
+#endif
 
 namespace prof {
 
 TRACEPOINT(trace_sampler_tick, "");
+#ifdef __x86_64__
+// Per-tick deltas of the PMU counters: instructions and cycles give the
+// IPC of the interval, LLC misses separate memory-bound regressions
+// from host-steal-bound ones
+TRACEPOINT(trace_sampler_pmu, "instructions=%lu cycles=%lu llc_misses=%lu",
+           u64, u64, u64);
+#endif
 
 static std::atomic<unsigned int> _active_cpus {0};
 static std::atomic<bool> _started;
@@ -27,10 +46,18 @@ static config _config;
 static sched::thread_handle _controller;
 static mutex _control_lock;
 
+static std::atomic<bool> _aggregate {false};
+static void record_sample();
+
 class cpu_sampler : public sched::timer_base::client {
 private:
     sched::timer_base _timer;
     bool _active;
+#ifdef __x86_64__
+    u64 _last_instructions = 0;
+    u64 _last_cycles = 0;
+    u64 _last_llc_misses = 0;
+#endif
 
     void arm()
     {
@@ -52,6 +79,22 @@ public:
     void timer_fired()
     {
         trace_sampler_tick();
+#ifdef __x86_64__
+        if (pmu::active()) {
+            auto instructions = pmu::instructions();
+            auto cycles = pmu::cycles();
+            auto llc_misses = pmu::llc_misses();
+            trace_sampler_pmu(instructions - _last_instructions,
+                              cycles - _last_cycles,
+                              llc_misses - _last_llc_misses);
+            _last_instructions = instructions;
+            _last_cycles = cycles;
+            _last_llc_misses = llc_misses;
+        }
+#endif
+        if (_aggregate.load(std::memory_order_relaxed)) {
+            record_sample();
+        }
         rearm();
     }
 
@@ -81,6 +124,61 @@ public:
 
 static dynamic_percpu<cpu_sampler> _sampler;
 
+//
+// Profiler mode: every sampler tick is also folded into a fixed size
+// per-cpu stack histogram, so a live guest can be profiled and the result
+// symbolized in-guest, without shipping the trace buffer together with an
+// unstripped kernel to an offline host. Insertion runs in the timer
+// interrupt with irqs disabled, so it must not allocate or take locks.
+//
+static constexpr unsigned profile_max_depth = 16;
+static constexpr unsigned profile_table_size = 4096; // power of two
+static constexpr unsigned profile_max_probes = 64;
+
+struct profile_entry {
+    void* frames[profile_max_depth];
+    u32 depth;
+    u32 count;
+};
+
+static dynamic_percpu<std::unique_ptr<profile_entry[]>> _profile_tables;
+static std::atomic<u64> _profile_dropped {0};
+
+static void record_sample()
+{
+    auto& table = *_profile_tables;
+    if (!table) {
+        return;
+    }
+    void* bt[profile_max_depth];
+    int depth = backtrace_safe(bt, profile_max_depth);
+    if (depth <= 0) {
+        return;
+    }
+    u64 hash = 0xcbf29ce484222325ull;
+    for (int i = 0; i < depth; i++) {
+        hash ^= reinterpret_cast<uintptr_t>(bt[i]);
+        hash *= 0x100000001b3ull;
+    }
+    auto idx = hash & (profile_table_size - 1);
+    for (unsigned probe = 0; probe < profile_max_probes; probe++) {
+        auto& e = table[idx];
+        if (!e.count) {
+            memcpy(e.frames, bt, depth * sizeof(void*));
+            e.depth = depth;
+            e.count = 1;
+            return;
+        }
+        if (e.depth == unsigned(depth) &&
+            !memcmp(e.frames, bt, depth * sizeof(void*))) {
+            e.count++;
+            return;
+        }
+        idx = (idx + 1) & (profile_table_size - 1);
+    }
+    _profile_dropped.fetch_add(1, std::memory_order_relaxed);
+}
+
 template <typename T>
 static bool fetch_and_inc_if_less(std::atomic<T>& var, T& previous, T max_value)
 {
@@ -102,6 +200,9 @@ static void start_on_current()
         return;
     }
 
+#ifdef __x86_64__
+    pmu::init_on_current();
+#endif
     _sampler->start();
 
     if (prev_active + 1 == _n_cpus) {
@@ -157,6 +258,9 @@ void start_sampler(config new_config) throw()
 
     trace_sampler_tick.enable(true);
     trace_sampler_tick.backtrace(true);
+#ifdef __x86_64__
+    trace_sampler_pmu.enable(true);
+#endif
 
     _n_cpus = sched::cpus.size();
     _config = new_config;
@@ -201,9 +305,98 @@ void stop_sampler() throw()
 
     trace_sampler_tick.backtrace(false);
     trace_sampler_tick.enable(false);
+#ifdef __x86_64__
+    trace_sampler_pmu.enable(false);
+#endif
 
     _started = false;
     debug("Sampler stopped.\n");
 }
 
+void start_profiler(config new_config) throw()
+{
+    WITH_LOCK(_control_lock) {
+        for (auto c : sched::cpus) {
+            auto* table = _profile_tables.for_cpu(c);
+            if (!*table) {
+                table->reset(new profile_entry[profile_table_size]);
+            }
+            memset(table->get(), 0, profile_table_size * sizeof(profile_entry));
+        }
+        _profile_dropped = 0;
+        _aggregate = true;
+    }
+    // start_sampler() takes _control_lock itself
+    start_sampler(new_config);
+}
+
+static const std::string& symbolize(void* addr,
+    std::unordered_map<void*, std::string>& cache)
+{
+    auto found = cache.find(addr);
+    if (found != cache.end()) {
+        return found->second;
+    }
+    char buf[1024];
+    auto ei = elf::get_program()->lookup_addr(addr);
+    const char* name = ei.sym;
+    if (name && osv::demangle(ei.sym, buf, sizeof(buf))) {
+        name = buf;
+    }
+    if (!name) {
+        snprintf(buf, sizeof(buf), "%p", addr);
+        name = buf;
+    }
+    std::string str(name);
+    // Semicolons separate stack frames in the collapsed format
+    std::replace(str.begin(), str.end(), ';', ':');
+    return cache.emplace(addr, std::move(str)).first->second;
+}
+
+std::string stop_profiler_and_collect()
+{
+    stop_sampler();
+    _aggregate = false;
+
+    std::string out;
+    WITH_LOCK(_control_lock) {
+        std::unordered_map<void*, std::string> names;
+        std::unordered_map<std::string, u64> collapsed;
+        for (auto c : sched::cpus) {
+            auto* table = _profile_tables.for_cpu(c);
+            if (!*table) {
+                continue;
+            }
+            for (unsigned i = 0; i < profile_table_size; i++) {
+                auto& e = (*table)[i];
+                if (!e.count) {
+                    continue;
+                }
+                std::string line;
+                // backtrace_safe() records the leaf first; collapsed
+                // stacks read root;...;leaf
+                for (int f = int(e.depth) - 1; f >= 0; f--) {
+                    if (!line.empty()) {
+                        line += ';';
+                    }
+                    line += symbolize(e.frames[f], names);
+                }
+                collapsed[line] += e.count;
+            }
+            table->reset();
+        }
+        for (auto& p : collapsed) {
+            out += p.first;
+            out += ' ';
+            out += std::to_string(p.second);
+            out += '\n';
+        }
+        auto dropped = _profile_dropped.exchange(0);
+        if (dropped) {
+            out += "[histogram_overflow] " + std::to_string(dropped) + "\n";
+        }
+    }
+    return out;
+}
+
 }
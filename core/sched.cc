@@ -25,6 +25,7 @@
 #include <osv/wait_record.hh>
 #include <osv/preempt-lock.hh>
 #include <osv/app.hh>
+#include <osv/mempool.hh>
 #include <osv/symbols.hh>
 #include <osv/stubbing.hh>
 #include <algorithm>
@@ -50,11 +51,13 @@ namespace sched {
 
 TRACEPOINT(trace_sched_idle, "");
 TRACEPOINT(trace_sched_idle_ret, "");
+TRACEPOINT(trace_sched_idle_wake, "residency=%lu ns timer=%d", u64, bool);
 TRACEPOINT(trace_sched_switch, "to %p vold=%g vnew=%g", thread*, float, float);
 TRACEPOINT(trace_sched_wait, "");
 TRACEPOINT(trace_sched_wait_ret, "");
 TRACEPOINT(trace_sched_wake, "wake %p", thread*);
 TRACEPOINT(trace_sched_migrate, "thread=%p cpu=%d", thread*, unsigned);
+TRACEPOINT(trace_sched_steal_req, "stealer=%d victim=%d", unsigned, unsigned);
 TRACEPOINT(trace_sched_queue, "thread=%p", thread*);
 TRACEPOINT(trace_sched_load, "load=%d", size_t);
 TRACEPOINT(trace_sched_preempt, "");
@@ -70,6 +73,8 @@ TRACEPOINT(trace_thread_create, "thread=%p", thread*);
 
 std::vector<cpu*> cpus __attribute__((init_priority((int)init_prio::cpus)));
 
+bool idle_quiesce = false;
+
 thread __thread * s_current;
 cpu __thread * current_cpu;
 
@@ -223,6 +228,92 @@ void thread::cputime_estimator_get(
     total_cpu_time = osv::clock::uptime::duration(tc_ho | tc);
 }
 
+// Aggregating the total cpu time of all threads (osv_run_stats(), which
+// monitoring tools poll about once a second through the httpserver module)
+// used to walk thread_map under thread_map_mutex, chasing one thread pointer
+// per entry. With thousands of threads that walk is slow, and taking the
+// global mutex from it disturbs thread creation and exit. Instead we keep a
+// columnar mirror of every thread's _total_cpu_time: each thread owns a
+// fixed slot in a set of flat arrays for its whole lifetime, the scheduler
+// refreshes the slot of the outgoing thread with a single relaxed store on
+// every reschedule, and readers just scan the arrays sequentially with no
+// lock at all. Slots are allocated and freed under thread_map_mutex, which
+// thread creation and destruction take anyway.
+class thread_stats_table {
+public:
+    static constexpr unsigned chunk_size = 1024;
+    static constexpr unsigned max_chunks = 64;
+    // Allocate a slot for a new thread. Must be called with thread_map_mutex
+    // held. The chunked layout lets us grow without moving existing slots,
+    // so readers never need to synchronize with growth beyond the release
+    // store publishing a new chunk.
+    unsigned alloc() {
+        auto n = _nr_chunks.load(std::memory_order_relaxed);
+        for (unsigned c = 0; c < n; c++) {
+            auto ch = _chunks[c].load(std::memory_order_relaxed);
+            for (unsigned i = 0; i < chunk_size; i++) {
+                if (!ch->live[i].load(std::memory_order_relaxed)) {
+                    ch->cpu_time[i].store(0, std::memory_order_relaxed);
+                    ch->live[i].store(1, std::memory_order_release);
+                    return c * chunk_size + i;
+                }
+            }
+        }
+        if (n == max_chunks) {
+            abort("Out of thread stats slots");
+        }
+        auto ch = new chunk;
+        ch->cpu_time[0].store(0, std::memory_order_relaxed);
+        ch->live[0].store(1, std::memory_order_relaxed);
+        _chunks[n].store(ch, std::memory_order_release);
+        _nr_chunks.store(n + 1, std::memory_order_release);
+        return n * chunk_size;
+    }
+    // Must be called with thread_map_mutex held.
+    void free(unsigned slot) {
+        chunk_of(slot)->live[slot % chunk_size].store(
+                0, std::memory_order_release);
+    }
+    void update(unsigned slot, osv::clock::uptime::duration time) {
+        chunk_of(slot)->cpu_time[slot % chunk_size].store(
+                time.count(), std::memory_order_relaxed);
+    }
+    // Sum the cpu time of all live slots. Lock-free; a thread exiting
+    // concurrently may be counted here or in total_app_time_exited (or,
+    // momentarily, in both or neither) - fine for statistics.
+    osv::clock::uptime::duration sum() const {
+        s64 total = 0;
+        auto n = _nr_chunks.load(std::memory_order_acquire);
+        for (unsigned c = 0; c < n; c++) {
+            auto ch = _chunks[c].load(std::memory_order_acquire);
+            for (unsigned i = 0; i < chunk_size; i++) {
+                if (ch->live[i].load(std::memory_order_acquire)) {
+                    total += ch->cpu_time[i].load(std::memory_order_relaxed);
+                }
+            }
+        }
+        return osv::clock::uptime::duration(total);
+    }
+private:
+    struct chunk {
+        std::atomic<s64> cpu_time[chunk_size];
+        std::atomic<u8> live[chunk_size];
+        chunk() {
+            for (unsigned i = 0; i < chunk_size; i++) {
+                live[i].store(0, std::memory_order_relaxed);
+            }
+        }
+    };
+    chunk* chunk_of(unsigned slot) const {
+        return _chunks[slot / chunk_size].load(std::memory_order_relaxed);
+    }
+    std::atomic<chunk*> _chunks[max_chunks];
+    std::atomic<unsigned> _nr_chunks {0};
+};
+
+static thread_stats_table thread_stats
+    __attribute__((init_priority((int)init_prio::threadlist)));
+
 // Note that this is a static (class) function, which can only reschedule
 // on the current CPU, not on an arbitrary CPU. Allowing to run one CPU's
 // scheduler on a different CPU would be disastrous.
@@ -280,6 +371,7 @@ void cpu::reschedule_from_interrupt(bool called_from_yield,
     assert(p_status != thread::status::queued);
 
     p->_total_cpu_time += interval;
+    thread_stats.update(p->_stats_slot, p->_total_cpu_time);
     p->_runtime.ran_for(interval);
 
     if (p_status == thread::status::running) {
@@ -344,6 +436,7 @@ void cpu::reschedule_from_interrupt(bool called_from_yield,
 
         trace_sched_preempt();
         p->stat_preemptions.incr();
+        stats.preemptions++;
     } else {
         // p is no longer running, so we'll switch to a different thread.
         // Return the runtime p borrowed for hysteresis.
@@ -356,6 +449,17 @@ void cpu::reschedule_from_interrupt(bool called_from_yield,
     n->cputime_estimator_set(now, n->_total_cpu_time);
     assert(n->_detached_state->st.load() == thread::status::queued);
     trace_sched_switch(n, p->_runtime.get_local(), n->_runtime.get_local());
+    stats.context_switches++;
+    auto queued_for = (now - n->_enqueued_at).count();
+    if (queued_for > 0) {
+        unsigned bucket = 63 - __builtin_clzll(queued_for);
+        if (bucket >= sched_stats::nr_latency_buckets) {
+            bucket = sched_stats::nr_latency_buckets - 1;
+        }
+        stats.queue_latency[bucket]++;
+    } else {
+        stats.queue_latency[0]++;
+    }
 
     if (called_from_yield) {
         enqueue(*p);
@@ -459,10 +563,57 @@ void cpu::idle_poll_end()
 void cpu::send_wakeup_ipi()
 {
     std::atomic_thread_fence(std::memory_order_seq_cst);
-    if (!idle_poll.load(std::memory_order_relaxed) && runqueue.size() <= 1) {
-        trace_sched_ipi(id);
-        wakeup_ipi.send(this);
+    if (runqueue.size() > 1) {
+        return;
     }
+    if (idle_poll.load(std::memory_order_relaxed)) {
+        // The target notices wakeups by itself - it is either spinning in
+        // do_idle(), which re-reads the queues every iteration, or parked
+        // in mwait with the monitor armed on idle_kick. Write the kick for
+        // the latter (the spinner just ignores it); either way neither
+        // side pays for an IPI.
+        idle_kick.fetch_add(1, std::memory_order_relaxed);
+        return;
+    }
+    trace_sched_ipi(id);
+    // Timestamp for the receiver so handle_incoming_wakeups() can
+    // measure the delivery latency. Overwriting an earlier stamp a
+    // slow receiver has not consumed yet just drops that sample.
+    wakeup_ipi_sent_at.store(
+        osv::clock::uptime::now().time_since_epoch().count(),
+        std::memory_order_relaxed);
+    wakeup_ipi.send(this);
+}
+
+// Bounds for the adaptive pre-halt spin window in do_idle(). The window
+// doubles whenever a halt turned out shorter than max_idle_spin_ns (a
+// little more spinning would have caught that wakeup without the
+// halt/wake round trip, which on a hypervisor means an exit and an
+// injection) and halves - down to zero - whenever the spin was wasted,
+// so a cpu that really goes idle stops burning its host's time.
+constexpr u64 min_idle_spin_ns = 2000;
+constexpr u64 max_idle_spin_ns = 100000;
+
+// Wait for the next wakeup with monitor/mwait instead of hlt. While
+// idle_poll is set, send_wakeup_ipi() wakes us by writing idle_kick -
+// which the armed monitor watches - rather than sending an IPI. Called
+// with interrupts disabled; returns with them enabled, like
+// arch::wait_for_interrupt().
+void cpu::mwait_idle()
+{
+    arch::monitor(&idle_kick);
+    idle_poll_start();
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    // Re-check after arming: a sender that missed idle_poll has already
+    // sent an IPI (a break event for the mwait below), and one that saw
+    // it has written idle_kick (caught by the monitor), so a wakeup
+    // enqueued before this point cannot be lost.
+    handle_incoming_wakeups();
+    if (runqueue.empty()) {
+        arch::monitor_wait();
+    }
+    idle_poll_end();
+    arch::irq_enable();
 }
 
 void cpu::do_idle()
@@ -470,13 +621,35 @@ void cpu::do_idle()
     do {
         idle_poll_lock_type idle_poll_lock{*this};
         WITH_LOCK(idle_poll_lock) {
-            // spin for a bit before halting
-            for (unsigned ctr = 0; ctr < 10000; ++ctr) {
-                // FIXME: can we pull threads from loaded cpus?
+            // Spin for a bit before halting; see the window tuning below
+            auto spin_start = osv::clock::uptime::now();
+            bool steal_requested = false;
+            while (true) {
                 handle_incoming_wakeups();
                 if (!runqueue.empty()) {
                     return;
                 }
+                auto spun = (osv::clock::uptime::now() - spin_start).count();
+                if (spun >= (s64)idle_spin_ns) {
+                    // Even when the window has shrunk to nothing, give the
+                    // busiest peer one chance to push work our way before
+                    // we halt; the wakeup IPI (or kick) will raise us if
+                    // it obliges.
+                    if (!steal_requested) {
+                        request_steal();
+                    }
+                    break;
+                }
+                // Half way through the spin, ask the busiest peer to push
+                // one of its queued threads our way (see request_steal()),
+                // instead of waiting for the periodic load balancer. If the
+                // victim obliges, the thread arrives through the regular
+                // incoming_wakeups protocol and the remaining iterations
+                // (or the wakeup IPI, if we end up halting) will notice it.
+                if (!steal_requested && spun * 2 >= (s64)idle_spin_ns) {
+                    steal_requested = true;
+                    request_steal();
+                }
             }
         }
 #if CONF_lazy_stack_invariant
@@ -488,7 +661,48 @@ void cpu::do_idle()
             return;
         }
         guard.release();
-        arch::wait_for_interrupt(); // this unlocks irq_lock
+        auto halted_at = osv::clock::uptime::now();
+        auto fired_before = timers.fired_count();
+        if (arch::monitor_wait_supported()) {
+            mwait_idle(); // this unlocks irq_lock
+        } else {
+            arch::wait_for_interrupt(); // this unlocks irq_lock
+        }
+        auto residency = (osv::clock::uptime::now() - halted_at).count();
+        if (residency > 0) {
+            unsigned bucket = 63 - __builtin_clzll(residency);
+            if (bucket >= sched_stats::nr_latency_buckets) {
+                bucket = sched_stats::nr_latency_buckets - 1;
+            }
+            stats.idle_residency[bucket]++;
+        } else {
+            stats.idle_residency[0]++;
+        }
+        // If our clock event fired while we were halted, a timer ended
+        // this idle period (timer_list::fired() attributes it further);
+        // otherwise it was a device interrupt or a wakeup IPI.
+        bool timer_wake = timers.fired_count() != fired_before;
+        if (timer_wake) {
+            stats.idle_wakeups_timer++;
+        } else {
+            stats.idle_wakeups_interrupt++;
+        }
+        trace_sched_idle_wake(residency, timer_wake);
+        // Tune the pre-halt spin window. A short residency ended by a
+        // device interrupt or a wakeup IPI means we halted just before
+        // work arrived - grow the window. A long halt (or one our own
+        // timer ended, which no amount of spinning can beat) means the
+        // spin was wasted - shrink it.
+        if (!timer_wake && residency < (s64)max_idle_spin_ns) {
+            idle_spin_ns = std::max(std::min(idle_spin_ns * 2,
+                                             max_idle_spin_ns),
+                                    min_idle_spin_ns);
+        } else {
+            idle_spin_ns /= 2;
+            if (idle_spin_ns < min_idle_spin_ns) {
+                idle_spin_ns = 0;
+            }
+        }
         handle_incoming_wakeups();
     } while (runqueue.empty());
 }
@@ -521,10 +735,25 @@ void cpu::handle_incoming_wakeups()
 #if CONF_lazy_stack_invariant
     assert(!arch::irq_enabled() || !thread::current()->is_app());
 #endif
+    if (steal_request.load(std::memory_order_relaxed)) {
+        handle_steal_request();
+    }
     cpu_set queues_with_wakes{incoming_wakeups_mask.fetch_clear()};
     if (!queues_with_wakes) {
         return;
     }
+    auto ipi_sent = wakeup_ipi_sent_at.load(std::memory_order_relaxed);
+    if (ipi_sent) {
+        wakeup_ipi_sent_at.store(0, std::memory_order_relaxed);
+        auto delta = osv::clock::uptime::now().time_since_epoch().count() -
+                     (s64)ipi_sent;
+        unsigned bucket = delta > 0 ? 63 - __builtin_clzll(delta) : 0;
+        if (bucket >= sched_stats::nr_latency_buckets) {
+            bucket = sched_stats::nr_latency_buckets - 1;
+        }
+        stats.ipi_latency[bucket]++;
+        stats.ipi_wakeups++;
+    }
     for (auto i : queues_with_wakes) {
         irq_save_lock_type irq_lock;
         WITH_LOCK(irq_lock) {
@@ -556,10 +785,114 @@ void cpu::handle_incoming_wakeups()
     trace_sched_load(runqueue.size());
 }
 
+// Called from an idle cpu: pick the busiest peer and ask it to push one of
+// its queued threads to us. We cannot pop a remote runqueue directly - each
+// runqueue is only ever touched by its own cpu - so instead we publish a
+// steal request which the victim notices in handle_incoming_wakeups() and
+// serves by migrating a thread through the regular incoming_wakeups queues.
+bool cpu::request_steal()
+{
+    // Prefer stealing from a cpu on our own NUMA node, so the migrated
+    // thread's working set stays in local memory; fall back to remote
+    // nodes only when the whole node has nothing to give.
+    cpu* busiest = nullptr;
+    cpu* busiest_remote = nullptr;
+    unsigned max = 1, max_remote = 1;
+    for (auto c : cpus) {
+        if (c == this) {
+            continue;
+        }
+        auto l = c->load();
+        if (c->node_id == node_id) {
+            if (l > max) {
+                max = l;
+                busiest = c;
+            }
+        } else if (l > max_remote) {
+            max_remote = l;
+            busiest_remote = c;
+        }
+    }
+    if (!busiest) {
+        busiest = busiest_remote;
+    }
+    if (!busiest) {
+        return false;
+    }
+    cpu* expected = nullptr;
+    if (!busiest->steal_request.compare_exchange_strong(expected, this,
+            std::memory_order_relaxed)) {
+        // Another idle cpu beat us to this victim. Try again next round.
+        return false;
+    }
+    trace_sched_steal_req(id, busiest->id);
+    // Interrupt the victim so it reschedules soon and notices the request,
+    // even if it would otherwise run its current thread for a while longer.
+    wakeup_ipi.send(busiest);
+    return true;
+}
+
+// Serve a pending steal request: migrate one of our queued threads to the
+// idle cpu which asked for it. This mirrors the migration done by
+// load_balance(), but is driven by the stealer instead of the 100ms tick.
+void cpu::handle_steal_request()
+{
+    auto stealer = steal_request.exchange(nullptr, std::memory_order_relaxed);
+    if (!stealer || stealer == this) {
+        return;
+    }
+    irq_save_lock_type irq_lock;
+    WITH_LOCK(irq_lock) {
+        // Keep at least one queued thread for ourselves, and don't bother
+        // if the stealer already found work elsewhere in the meantime.
+        if (runqueue.size() < 2 || stealer->load() > 0) {
+            return;
+        }
+        auto i = std::find_if(runqueue.rbegin(), runqueue.rend(),
+                [](thread& t) { return t._migration_lock_counter == 0; });
+        if (i == runqueue.rend()) {
+            return;
+        }
+        auto& mig = *i;
+        trace_sched_migrate(&mig, stealer->id);
+        runqueue.erase(std::prev(i.base()));  // i.base() returns off-by-one
+        // we won't race with wake(), since we're not thread::waiting
+        assert(mig._detached_state->st.load() == thread::status::queued);
+        mig._detached_state->st.store(thread::status::waking);
+        mig.suspend_timers();
+        mig._detached_state->_cpu = stealer;
+        // Convert the CPU-local runtime measure to a globally meaningful
+        // measure
+        mig._runtime.export_runtime();
+        mig.remote_thread_local_var(::percpu_base) = stealer->percpu_base;
+        mig.remote_thread_local_var(current_cpu) = stealer;
+        mig.stat_migrations.incr();
+        stealer->incoming_wakeups[id].push_back(mig);
+        stealer->incoming_wakeups_mask.set(id);
+        stealer->send_wakeup_ipi();
+    }
+}
+
 void cpu::enqueue(thread& t)
 {
     trace_sched_queue(&t);
+    t._enqueued_at = osv::clock::uptime::now();
     runqueue.insert_equal(t);
+    wake_balancer_if_parked();
+}
+
+// With idle_quiesce set the balancer parks without a timer while this
+// cpu's runqueue is empty. The thread that was just enqueued is the
+// second runnable one here (another is running), so unpark the balancer
+// and let it decide whether to shed load - an idle peer that went into
+// a deep sleep no longer polls for work, so nobody else will.
+// Called with interrupts disabled, like enqueue() itself.
+void cpu::wake_balancer_if_parked()
+{
+    if (balancer_parked.load(std::memory_order_relaxed) &&
+            balancer_parked.exchange(false, std::memory_order_relaxed)) {
+        balancer_thread->wake_with_irq_disabled();
+    }
 }
 
 // When the run queue has several threads with equal thread_runtime_compare,
@@ -569,12 +902,15 @@ void cpu::enqueue(thread& t)
 void cpu::enqueue_first_equal(thread& t)
 {
     trace_sched_queue(&t);
+    t._enqueued_at = osv::clock::uptime::now();
     runqueue.insert_before(runqueue.lower_bound(t), t);
+    wake_balancer_if_parked();
 }
 
 void cpu::init_on_cpu()
 {
     arch.init_on_cpu();
+    arch.init_cpu_id(id);
     clock_event->setup_on_cpu();
 }
 
@@ -792,21 +1128,53 @@ void thread::unpin()
 
 void cpu::load_balance()
 {
+    balancer_thread = thread::current();
     notifier::fire();
     timer tmr(*thread::current());
     while (true) {
-        tmr.set(osv::clock::uptime::now() + 100_ms);
-        thread::wait_until([&] { return tmr.expired(); });
+        if (idle_quiesce && runqueue.empty()) {
+            // Nothing to shed from an empty runqueue, so don't tick at
+            // all: park without arming the timer and let enqueue() wake
+            // us when a second thread becomes runnable on this cpu. A
+            // single pinned thread thus runs with zero housekeeping
+            // timer interrupts. The !runqueue.empty() leg of the
+            // predicate closes the window where a thread is enqueued
+            // (by an interrupt-driven wakeup) between our emptiness
+            // check and the parking store - enqueue() saw the flag
+            // still clear then, so nobody would unpark us.
+            balancer_parked.store(true, std::memory_order_relaxed);
+            thread::wait_until([&] {
+                return !balancer_parked.load(std::memory_order_relaxed) ||
+                       !runqueue.empty();
+            });
+            balancer_parked.store(false, std::memory_order_relaxed);
+        } else {
+            tmr.set(osv::clock::uptime::now() + 100_ms);
+            thread::wait_until([&] { return tmr.expired(); });
+        }
         if (runqueue.empty()) {
             continue;
         }
-        auto min = *std::min_element(cpus.begin(), cpus.end(),
-                [](cpu* c1, cpu* c2) { return c1->load() < c2->load(); });
+        // Prefer shedding load to a cpu on our own NUMA node, keeping the
+        // migrated thread's memory local; only when every cpu of this node
+        // is about as loaded as we are consider remote nodes.
+        auto node_min = *std::min_element(cpus.begin(), cpus.end(),
+                [this](cpu* c1, cpu* c2) {
+                    if ((c1->node_id == node_id) != (c2->node_id == node_id)) {
+                        return c1->node_id == node_id;
+                    }
+                    return c1->load() < c2->load();
+                });
+        auto min = node_min;
+        // This CPU is temporarily running one extra thread (this thread),
+        // so don't migrate a thread away if the difference is only 1.
+        if (min == this || min->load() >= (load() - 1)) {
+            min = *std::min_element(cpus.begin(), cpus.end(),
+                    [](cpu* c1, cpu* c2) { return c1->load() < c2->load(); });
+        }
         if (min == this) {
             continue;
         }
-        // This CPU is temporarily running one extra thread (this thread),
-        // so don't migrate a thread away if the difference is only 1.
         if (min->load() >= (load() - 1)) {
             continue;
         }
@@ -961,7 +1329,7 @@ using id_type = std::result_of<decltype(&thread::id)(thread)>::type;
 std::unordered_map<id_type, thread *> thread_map
     __attribute__((init_priority((int)init_prio::threadlist)));
 
-static thread_runtime::duration total_app_time_exited(0);
+static std::atomic<thread_runtime::duration::rep> total_app_time_exited(0);
 
 thread_runtime::duration thread::thread_clock() {
     if (this == current()) {
@@ -1032,13 +1400,22 @@ osv::clock::uptime::duration process_cputime()
 
 std::chrono::nanoseconds osv_run_stats()
 {
-    thread_runtime::duration total_app_time;
-
-    WITH_LOCK(thread_map_mutex) {
-        total_app_time = total_app_time_exited;
-        for (auto th : thread_map) {
-            thread *t = th.second;
-            total_app_time += t->thread_clock();
+    // Scan the columnar thread_stats table instead of walking thread_map:
+    // no global lock, no pointer chasing, just sequential reads of a few
+    // flat arrays. A thread's slot only reflects its cpu time up to its
+    // last reschedule, so add each cpu's in-progress slice on top - exactly
+    // the slices the slots of the currently-running threads are missing.
+    auto total_app_time = thread_stats.sum() + thread_runtime::duration(
+            total_app_time_exited.load(std::memory_order_relaxed));
+    auto now = osv::clock::uptime::now();
+    for (auto c : cpus) {
+        // Racy read of a remote cpu's running_since; like thread_clock(),
+        // we rely on 64-bit loads and stores being atomic in practice. A
+        // reschedule between our scan of the table and this read can double
+        // count or miss at most one partial timeslice.
+        auto slice = now - c->running_since;
+        if (slice.count() > 0) {
+            total_app_time += slice;
         }
     }
     return std::chrono::duration_cast<std::chrono::nanoseconds>(total_app_time);
@@ -1086,6 +1463,11 @@ thread::thread(std::function<void ()> func, attr attr, bool main, bool app)
 {
     trace_thread_create(this);
 
+    if (_attr._realtime_priority) {
+        _realtime._priority = _attr._realtime_priority;
+        _realtime._time_slice = _attr._realtime_time_slice;
+    }
+
     if (!main && sched::s_current) {
         auto app = application::get_current().get();
         if (override_current_app) {
@@ -1093,6 +1475,7 @@ thread::thread(std::function<void ()> func, attr attr, bool main, bool app)
         }
         if (_app && app) {
             _app_runtime = app->runtime();
+            _mem_account = &app->mem_account();
         }
     }
     setup_tcb();
@@ -1111,6 +1494,7 @@ thread::thread(std::function<void ()> func, attr attr, bool main, bool app)
     }
 
     WITH_LOCK(thread_map_mutex) {
+        _stats_slot = thread_stats.alloc();
         if (!main) {
             auto ttid = _s_idgen;
             auto tid = ttid;
@@ -1203,6 +1587,14 @@ osv::application *thread::current_app() {
     return &(cur->_app_runtime->app);
 }
 
+// not in the header for the same reason as current_app() above
+void thread::set_app_runtime(const std::shared_ptr<osv::application_runtime>& app)
+{
+    assert(_app);
+    _app_runtime = app;
+    _mem_account = app ? &app->app.mem_account() : nullptr;
+}
+
 thread::~thread()
 {
     cancel_this_thread_alarm();
@@ -1212,7 +1604,9 @@ thread::~thread()
     }
     WITH_LOCK(thread_map_mutex) {
         thread_map.erase(_id);
-        total_app_time_exited += _total_cpu_time;
+        total_app_time_exited.fetch_add(_total_cpu_time.count(),
+                std::memory_order_relaxed);
+        thread_stats.free(_stats_slot);
     }
     if (_attr._stack.deleter) {
         _attr._stack.deleter(_attr._stack);
@@ -1304,6 +1698,29 @@ void thread::destroy()
 // *may* contain status::sending_lock (for waitqueue wait morphing).
 // it will transition from one of the allowed initial states to the
 // waking state.
+// the innermost wakeup_batch active on this thread, if any
+static __thread wakeup_batch* current_wakeup_batch;
+
+wakeup_batch::wakeup_batch()
+    : _prev(current_wakeup_batch)
+{
+    migrate_disable();
+    current_wakeup_batch = this;
+}
+
+wakeup_batch::~wakeup_batch()
+{
+    current_wakeup_batch = _prev;
+    unsigned c = cpu::current()->id;
+    for (auto id : _cpus) {
+        auto tcpu = cpus[id];
+        if (!tcpu->incoming_wakeups_mask.test_all_and_set(c)) {
+            tcpu->send_wakeup_ipi();
+        }
+    }
+    migrate_enable();
+}
+
 void thread::wake_impl(detached_state* st, unsigned allowed_initial_states_mask)
 {
     status old_status = status::waiting;
@@ -1325,7 +1742,27 @@ void thread::wake_impl(detached_state* st, unsigned allowed_initial_states_mask)
         WITH_LOCK(irq_lock) {
             tcpu->incoming_wakeups[c].push_back(*st->t);
         }
-        if (!tcpu->incoming_wakeups_mask.test_all_and_set(c)) {
+        if (st->t->_realtime._priority > 0) {
+            // A real-time thread must not wait for the target cpu's next
+            // natural reschedule point: set the mask and interrupt the
+            // target even if another wakeup is already in flight or a
+            // wakeup batch is active, skipping only the runqueue-size
+            // heuristic of send_wakeup_ipi().
+            tcpu->incoming_wakeups_mask.set(c);
+            if (tcpu != current()->tcpu()) {
+                std::atomic_thread_fence(std::memory_order_seq_cst);
+                if (!tcpu->idle_poll.load(std::memory_order_relaxed)) {
+                    trace_sched_ipi(tcpu->id);
+                    wakeup_ipi.send(tcpu);
+                }
+            } else {
+                need_reschedule = true;
+            }
+        } else if (current_wakeup_batch && tcpu != current()->tcpu()) {
+            // A batch is active: remember the destination and let the
+            // batch's flush set the mask bit and send a single IPI.
+            current_wakeup_batch->_cpus.set(tcpu->id);
+        } else if (!tcpu->incoming_wakeups_mask.test_all_and_set(c)) {
             // FIXME: avoid if the cpu is alive and if the priority does not
             // FIXME: warrant an interruption
             if (tcpu != current()->tcpu()) {
@@ -1452,6 +1889,9 @@ void thread::stop_wait()
 void thread::complete()
 {
     run_exit_notifiers();
+    // return any objects parked in this thread's malloc magazines while
+    // our thread-local storage is still alive
+    memory::flush_thread_malloc_cache();
 
     //The logic below only applies when running statically
     //linked executables or dynamically linked ones launched by the
@@ -1656,23 +2096,55 @@ timer_list::callback_dispatch::callback_dispatch()
     clock_event->set_callback(this);
 }
 
+bool timer_list::insert(timer_base& t)
+{
+    return t._lowres ? _wheel.insert(t) : _list.insert(t);
+}
+
+void timer_list::remove(timer_base& t)
+{
+    if (t._lowres) {
+        _wheel.remove(t);
+    } else {
+        _list.remove(t);
+    }
+}
+
+osv::clock::uptime::time_point timer_list::next_timeout()
+{
+    return std::min(_list.get_next_timeout(), _wheel.get_next_timeout());
+}
+
 void timer_list::fired()
 {
+    auto c = cpu::current();
     auto now = osv::clock::uptime::now();
+    _fired_count++;
  again:
     _last = osv::clock::uptime::time_point::max();
     _list.expire(now);
+    _wheel.expire(now);
     timer_base* timer;
     while ((timer = _list.pop_expired())) {
         assert(timer->_state == timer_base::state::armed);
+        if (timer == &c->preemption_timer) {
+            c->stats.timers_fired_preempt++;
+        } else {
+            c->stats.timers_fired_other++;
+        }
         timer->expire();
     }
-    if (!_list.empty()) {
+    while ((timer = _wheel.pop_expired())) {
+        assert(timer->_state == timer_base::state::armed);
+        c->stats.timers_fired_other++;
+        timer->expire();
+    }
+    if (!_list.empty() || !_wheel.empty()) {
         // We could have simply called rearm() here, but this would lead to
         // recursion if the next timer has already expired in the time that
         // passed above. Better iterate in that case, instead.
         now = osv::clock::uptime::now();
-        auto t = _list.get_next_timeout();
+        auto t = next_timeout();
         if (t <= now) {
             goto again;
         } else {
@@ -1684,7 +2156,7 @@ void timer_list::fired()
 
 void timer_list::rearm()
 {
-    auto t = _list.get_next_timeout();
+    auto t = next_timeout();
     if (t < _last) {
         _last = t;
         clock_event->set(t - osv::clock::uptime::now());
@@ -1696,7 +2168,7 @@ void timer_list::suspend(timer_base::client_list_t& timers)
 {
     for (auto& t : timers) {
         assert(t._state == timer::state::armed);
-        _list.remove(t);
+        remove(t);
     }
 }
 
@@ -1706,7 +2178,7 @@ void timer_list::resume(timer_base::client_list_t& timers)
     bool do_rearm = false;
     for (auto& t : timers) {
         assert(t._state == timer::state::armed);
-        do_rearm |= _list.insert(t);
+        do_rearm |= insert(t);
     }
     if (do_rearm) {
         rearm();
@@ -1755,7 +2227,7 @@ void timer_base::set_with_irq_disabled(osv::clock::uptime::time_point time)
 
     auto& timers = cpu::current()->timers;
     _t._active_timers.push_back(*this);
-    if (timers._list.insert(*this)) {
+    if (timers.insert(*this)) {
         timers.rearm();
     }
 };
@@ -1777,7 +2249,7 @@ void timer_base::set(osv::clock::uptime::time_point time)
 
         auto& timers = cpu::current()->timers;
         _t._active_timers.push_back(*this);
-        if (timers._list.insert(*this)) {
+        if (timers.insert(*this)) {
             timers.rearm();
         }
     }
@@ -1793,7 +2265,7 @@ void timer_base::cancel()
     WITH_LOCK(irq_lock) {
         if (_state == state::armed) {
             _t._active_timers.erase(_t._active_timers.iterator_to(*this));
-            cpu::current()->timers._list.remove(*this);
+            cpu::current()->timers.remove(*this);
         }
         _state = state::free;
     }
@@ -1801,6 +2273,54 @@ void timer_base::cancel()
     // reprogramming the timer
 }
 
+// Round 'time' up to the next multiple of 'slack'. Every timer armed with
+// the same slack value thus lands on a shared grid point, so their
+// expirations merge into a single clock event interrupt, while no timer
+// ever fires before its requested time.
+static osv::clock::uptime::time_point coalesce(
+        osv::clock::uptime::time_point time,
+        osv::clock::uptime::duration slack)
+{
+    auto s = slack.count();
+    auto ns = time.time_since_epoch().count();
+    constexpr auto max_ns =
+            osv::clock::uptime::time_point::max().time_since_epoch().count();
+    if (s <= 0 || ns >= max_ns - s) {
+        // no slack, or rounding up would overflow (e.g. the time_point::max()
+        // the async workers use to mean "no pending timer")
+        return time;
+    }
+    return osv::clock::uptime::time_point(
+            osv::clock::uptime::duration(((ns + s - 1) / s) * s));
+}
+
+// A timer whose slack covers the low-resolution wheel's slot width can't
+// tell the difference between the wheel's bucketing and its own grid, so
+// route it to the wheel, where it also coalesces with unrelated neighbours
+// and arming is O(1).
+void timer_base::apply_slack_routing(osv::clock::uptime::duration slack)
+{
+    using wheel_t = timer_wheel<timer_base, &timer_base::hook,
+            osv::clock::uptime>;
+    if (slack.count() >= wheel_t::slot_width) {
+        _lowres = true;
+    }
+}
+
+void timer_base::set_with_slack(osv::clock::uptime::time_point time,
+        osv::clock::uptime::duration slack)
+{
+    apply_slack_routing(slack);
+    set(coalesce(time, slack));
+}
+
+void timer_base::reset_with_slack(osv::clock::uptime::time_point time,
+        osv::clock::uptime::duration slack)
+{
+    apply_slack_routing(slack);
+    reset(coalesce(time, slack));
+}
+
 void timer_base::reset(osv::clock::uptime::time_point time)
 {
     trace_timer_reset(this, time.time_since_epoch().count());
@@ -1813,7 +2333,7 @@ void timer_base::reset(osv::clock::uptime::time_point time)
     irq_save_lock_type irq_lock;
     WITH_LOCK(irq_lock) {
         if (_state == state::armed) {
-            timers._list.remove(*this);
+            timers.remove(*this);
         } else {
             _t._active_timers.push_back(*this);
             _state = state::armed;
@@ -1821,7 +2341,7 @@ void timer_base::reset(osv::clock::uptime::time_point time)
 
         _time = time;
 
-        if (timers._list.insert(*this)) {
+        if (timers.insert(*this)) {
             timers.rearm();
         }
     }
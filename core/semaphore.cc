@@ -15,6 +15,9 @@ semaphore::semaphore(unsigned val)
 void semaphore::post_unlocked(unsigned units)
 {
     _val += units;
+    // Wake all satisfied waiters as one batch - at most one IPI per
+    // destination cpu instead of one per waiter.
+    sched::wakeup_batch batch;
     auto i = _waiters.begin();
     while (_val > 0 && i != _waiters.end()) {
         auto wr = i++;
@@ -0,0 +1,75 @@
+/*
+ * Copyright (C) 2026 Waldemar Kozaczuk
+ *
+ * This work is open source software, licensed under the terms of the
+ * BSD license as described in the LICENSE file in the top-level directory.
+ */
+
+#include <osv/snapshot.hh>
+#include <osv/debug.hh>
+#include <osv/dhcp.hh>
+#include <osv/mutex.h>
+
+#include <unistd.h>
+#include <vector>
+
+#include "drivers/driver.hh"
+
+namespace osv {
+namespace snapshot {
+
+static mutex _mutex;
+
+// Function-local static, since fixups are registered as early as clock
+// setup, before global constructors in this file would have run
+static std::vector<std::function<void ()>>& resume_fixups()
+{
+    static std::vector<std::function<void ()>> fixups;
+    return fixups;
+}
+
+void on_resume(std::function<void ()> fixup)
+{
+    WITH_LOCK(_mutex) {
+        resume_fixups().push_back(fixup);
+    }
+}
+
+void prepare()
+{
+    // Flush dirty file data so the snapshotted image is consistent even if
+    // a clone resumes against a copy of the disk
+    sync();
+    hw::driver_manager::instance()->suspend_all();
+    debugf("snapshot: guest quiesced\n");
+}
+
+void resume()
+{
+    hw::driver_manager::instance()->resume_all();
+    std::vector<std::function<void ()>> fixups;
+    WITH_LOCK(_mutex) {
+        fixups = resume_fixups();
+    }
+    for (auto& f : fixups) {
+        f();
+    }
+    // Every clone resumes holding the pre-snapshot lease; re-acquire it in
+    // the background so clones on their own tap devices get distinct
+    // addresses
+    dhcp_renew(false);
+    debugf("snapshot: guest resumed\n");
+}
+
+}
+}
+
+void osv_snapshot_prepare()
+{
+    osv::snapshot::prepare();
+}
+
+void osv_snapshot_resume()
+{
+    osv::snapshot::resume();
+}
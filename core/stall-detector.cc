@@ -0,0 +1,200 @@
+/*
+ * Copyright (C) 2026 Waldemar Kozaczuk
+ *
+ * This work is open source software, licensed under the terms of the
+ * BSD license as described in the LICENSE file in the top-level directory.
+ */
+
+#include <chrono>
+
+#include <osv/migration-lock.hh>
+#include <osv/sched.hh>
+#include <osv/interrupt.hh>
+#include <osv/debug.hh>
+#include <osv/clock.hh>
+#include <osv/trace.hh>
+#include <osv/percpu.hh>
+#include <osv/stall-detector.hh>
+
+namespace osv {
+
+// The tick arrived delay nanoseconds later than the threshold allows.
+// The record's thread and backtrace describe the interrupted context:
+// the timer fires on whatever stack the stall held up.
+TRACEPOINT(trace_stall_detected, "delay=%lu ns", u64);
+
+static std::atomic<unsigned int> _active_cpus {0};
+static std::atomic<bool> _started;
+static unsigned int _n_cpus;
+static osv::clock::uptime::duration _threshold;
+static osv::clock::uptime::duration _period;
+static sched::thread_handle _controller;
+static mutex _control_lock;
+
+class cpu_stall_detector : public sched::timer_base::client {
+private:
+    sched::timer_base _timer;
+    osv::clock::uptime::time_point _expected;
+    bool _active;
+
+    void arm()
+    {
+        _expected = osv::clock::uptime::now() + _period;
+        _timer.set(_expected);
+    }
+
+    void rearm()
+    {
+        _expected = osv::clock::uptime::now() + _period;
+        _timer.set_with_irq_disabled(_expected);
+    }
+
+public:
+    cpu_stall_detector()
+        : _timer(*this)
+        , _active(false)
+    {
+    }
+
+    void timer_fired()
+    {
+        auto late = osv::clock::uptime::now() - _expected;
+        if (late > _threshold) {
+            trace_stall_detected(std::chrono::duration_cast<
+                std::chrono::nanoseconds>(late).count());
+        }
+        rearm();
+    }
+
+    void start()
+    {
+        assert(!_active);
+        _active = true;
+        if (arch::irq_enabled()) {
+            arm();
+        } else {
+            rearm();
+        }
+    }
+
+    void stop()
+    {
+        assert(_active);
+        _active = false;
+        _timer.cancel();
+    }
+
+    bool is_active()
+    {
+        return _active;
+    }
+};
+
+static dynamic_percpu<cpu_stall_detector> _detector;
+
+static void start_on_current()
+{
+    unsigned int prev_active = _active_cpus.fetch_add(1);
+
+    _detector->start();
+
+    if (prev_active + 1 == _n_cpus) {
+        _started = true;
+        if (arch::irq_enabled()) {
+            _controller.wake();
+        } else {
+            _controller.wake_from_kernel_or_with_irq_disabled();
+        }
+    }
+}
+
+static void stop_on_current()
+{
+    if (!_detector->is_active()) {
+        return;
+    }
+
+    _detector->stop();
+
+    if (--_active_cpus == 0) {
+        if (arch::irq_enabled()) {
+            _controller.wake();
+        } else {
+            _controller.wake_from_kernel_or_with_irq_disabled();
+        }
+    }
+}
+
+static inter_processor_interrupt start_detector_ipi {
+    IPI_STALL_DETECTOR_START, [] { start_on_current(); }};
+static inter_processor_interrupt stop_detector_ipi {
+    IPI_STALL_DETECTOR_STOP, [] { stop_on_current(); }};
+
+void start_stall_detector(osv::clock::uptime::duration threshold) throw()
+{
+    SCOPE_LOCK(_control_lock);
+
+    if (_started) {
+        stop_stall_detector();
+        assert(!_started);
+    }
+
+    debugf("Starting stall detector, threshold = %d ns\n",
+        std::chrono::duration_cast<std::chrono::nanoseconds>(threshold).count());
+
+    _controller.reset(*sched::thread::current());
+
+    assert(_active_cpus == 0);
+
+    trace_stall_detected.enable(true);
+    trace_stall_detected.backtrace(true);
+
+    _n_cpus = sched::cpus.size();
+    _threshold = threshold;
+    // Check often enough that a breach is attributed to the stall that
+    // caused it, but never more than once a millisecond
+    _period = std::max(threshold / 4,
+        osv::clock::uptime::duration(std::chrono::milliseconds(1)));
+    std::atomic_thread_fence(std::memory_order_release);
+
+    WITH_LOCK(migration_lock) {
+        start_on_current();
+        start_detector_ipi.send_allbutself();
+    }
+
+    sched::thread::wait_until([] { return _started.load(); });
+    _controller.clear();
+}
+
+void stop_stall_detector() throw()
+{
+    SCOPE_LOCK(_control_lock);
+
+    if (!_started) {
+        return;
+    }
+
+    _controller.reset(*sched::thread::current());
+
+    WITH_LOCK(migration_lock) {
+        stop_detector_ipi.send_allbutself();
+#if CONF_lazy_stack_invariant
+        assert(arch::irq_enabled());
+#endif
+#if CONF_lazy_stack
+        sched::ensure_next_stack_page_if_preemptable();
+#endif
+        stop_on_current();
+    }
+
+    sched::thread::wait_until([] { return _active_cpus == 0; });
+    _controller.clear();
+
+    trace_stall_detected.backtrace(false);
+    trace_stall_detected.enable(false);
+
+    _started = false;
+    debug("Stall detector stopped.\n");
+}
+
+}
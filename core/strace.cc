@@ -7,15 +7,106 @@
 
 #include <osv/strace.hh>
 #include <osv/sched.hh>
+#include <osv/debug.hh>
+#include <osv/nway_merger.hh>
 #include "drivers/console.hh"
 
-trace_log* _trace_log = nullptr;
+#include <osv/barrier.hh>
 
-static void print_trace(trace_record* tr) {
+#include <algorithm>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+
+trace_log** _trace_logs = nullptr;
+
+//
+// The per-cpu logs are individually time-sorted (each cpu appends its
+// own records in order), so the consumers below k-way merge them back
+// into one globally ordered stream with osv::nway_stream_merger. A
+// cursor per log is the merger's stream; since v2 records carry
+// delta-encoded timestamps, each cursor maintains its own delta chain
+// and exposes the absolute time of the record at its front as the merge
+// key. The merge moves trace_record pointers only - no record is copied.
+//
+class trace_log_cursor {
+public:
+    explicit trace_log_cursor(trace_log* log) : _log(log) {}
+    bool empty() const { return _log->empty(); }
+    trace_record* front() {
+        refresh();
+        return _front;
+    }
+    u64 front_time() {
+        refresh();
+        return _front_time;
+    }
+    void pop() {
+        refresh();
+        _last_time = _front_time;
+        _log->read();
+        _front = nullptr;
+    }
+private:
+    void refresh() {
+        if (_front) {
+            return;
+        }
+        _front = _log->peek();
+        if (_front) {
+            _front_time = _front->absolute_time() ?
+                *reinterpret_cast<const u64*>(_front->buffer) :
+                _last_time + _front->time_delta;
+        }
+    }
+    trace_log* _log;
+    trace_record* _front = nullptr;
+    u64 _front_time = 0;
+    u64 _last_time = 0;
+};
+
+struct trace_log_cursor_time_comparator {
+    bool operator()(trace_log_cursor* a, trace_log_cursor* b)
+    {
+        return a->front_time() > b->front_time();
+    }
+};
+
+using trace_log_merger = osv::nway_stream_merger<trace_log_cursor,
+                                                 trace_log_cursor_time_comparator>;
+static std::vector<trace_log_cursor> trace_log_cursors;
+static trace_log_merger merger;
+
+// Batch size for one merge-drain: bounds the stack footprint of the
+// batch array and how long producers can keep a single drain call busy
+static constexpr size_t drain_batch = 256;
+
+static void allocate_trace_logs()
+{
+    auto count = sched::cpus.size();
+    auto logs = new trace_log*[count];
+    trace_log_cursors.reserve(count);
+    for (unsigned i = 0; i < count; i++) {
+        logs[i] = new trace_log();
+        trace_log_cursors.emplace_back(logs[i]);
+        merger.add_stream(&trace_log_cursors[i]);
+    }
+    // publish only fully constructed logs to the producers
+    barrier();
+    _trace_logs = logs;
+}
+
+void print_trace(trace_record* tr) {
     char msg[512];
     auto tp = tr->tp;
-    float time = tr->time;
-    std::string thread_name = tr->thread_name.data();
+    float time = trace_record_time(tr);
+    std::string thread_name = trace_record_thread_name(tr);
 
     auto len = snprintf(msg, 512, "%-15s %3d %12.9f %s(", thread_name.c_str(), tr->cpu, time / 1000000000, tp->name);
     auto left = 512 - len;
@@ -29,11 +120,11 @@ static void print_trace(trace_record* tr) {
        len++;
     }
 
-    auto buf = tr->buffer;
+    auto buf = tr->payload();
     auto sig = tr->tp->sig;
     int written = 0;
 
-    if (tr->backtrace) {
+    if (tr->backtrace()) {
         buf += tracepoint_base::backtrace_len * sizeof(void*);
     }
 
@@ -132,13 +223,17 @@ static sched::thread *strace = nullptr;
 static std::atomic<bool> strace_done = {false};
 
 static void print_traces() {
-    while (auto tr = _trace_log->read()) {
-        print_trace(tr);
+    trace_record* batch[drain_batch];
+    size_t n;
+    while ((n = merger.drain(batch, drain_batch)) > 0) {
+        for (size_t i = 0; i < n; i++) {
+            print_trace(batch[i]);
+        }
     }
 }
 
 void start_strace() {
-    _trace_log = new trace_log();
+    allocate_trace_logs();
     strace = sched::thread::make([] {
         print_traces();
         do {
@@ -151,10 +246,137 @@ void start_strace() {
 }
 
 void wait_strace_complete() {
-    if (!_trace_log) {
+    if (!_trace_logs) {
         return;
     }
     strace_done = true;
     strace->join();
     delete strace;
 }
+
+//
+// Continuous trace streaming: like strace, drains the trace log, but
+// writes length-prefixed binary records to a host-facing channel - a TCP
+// collector ("tcp:<ip>:<port>") or any writable path such as a
+// virtio-serial port device or a virtiofs-shared file - so a host-side
+// collector gets live events without stopping the guest or pulling
+// multi-MB buffer dumps. Backpressure is handled at the producer: the
+// trace log is a ring which overwrites the oldest unread records when
+// the consumer (and thus the channel) cannot keep up.
+//
+static sched::thread *trace_stream = nullptr;
+static std::atomic<bool> trace_stream_done = {false};
+static std::string trace_stream_dest;
+
+static int open_stream_dest()
+{
+    const std::string& dest = trace_stream_dest;
+    if (dest.compare(0, 4, "tcp:") == 0) {
+        auto colon = dest.rfind(':');
+        if (colon == 3) {
+            return -1;
+        }
+        auto host = dest.substr(4, colon - 4);
+        auto port = atoi(dest.c_str() + colon + 1);
+        int fd = socket(AF_INET, SOCK_STREAM, 0);
+        if (fd < 0) {
+            return -1;
+        }
+        sockaddr_in addr = {};
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons(port);
+        addr.sin_addr.s_addr = inet_addr(host.c_str());
+        if (connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0) {
+            close(fd);
+            return -1;
+        }
+        return fd;
+    }
+    return open(dest.c_str(), O_WRONLY | O_CREAT | O_APPEND, 0644);
+}
+
+// Wire format, guest endian: u32 total record length (excluding itself),
+// u8 tracepoint name length + name, u8 thread name length + name,
+// u64 nanosecond timestamp, u8 cpu, u8 backtrace flag, u16 payload
+// length + the serialized arguments exactly as laid out in the trace
+// buffer (preceded by backtrace_len pointers when the flag is set)
+static bool stream_one(int fd, trace_record* tr)
+{
+    u8 buf[4096];
+    auto tp = tr->tp;
+    size_t payload = trace_payload_size(tr);
+    auto thread_name = trace_record_thread_name(tr);
+    u8 name_len = std::min(strlen(tp->name), size_t(255));
+    u8 tname_len = std::min(strlen(thread_name), size_t(255));
+    size_t total = 1 + name_len + 1 + tname_len + 8 + 1 + 1 + 2 + payload;
+    if (4 + total > sizeof(buf)) {
+        // oversized record (e.g. a corrupt signature); skip it
+        return true;
+    }
+    u8* p = buf;
+    *reinterpret_cast<u32*>(p) = total;
+    p += 4;
+    *p++ = name_len;
+    memcpy(p, tp->name, name_len);
+    p += name_len;
+    *p++ = tname_len;
+    memcpy(p, thread_name, tname_len);
+    p += tname_len;
+    *reinterpret_cast<u64*>(p) = trace_record_time(tr);
+    p += 8;
+    *p++ = tr->cpu;
+    *p++ = tr->backtrace() ? 1 : 0;
+    *reinterpret_cast<u16*>(p) = payload;
+    p += 2;
+    memcpy(p, tr->payload(), payload);
+    p += payload;
+
+    size_t len = p - buf;
+    size_t written = 0;
+    while (written < len) {
+        auto n = write(fd, buf + written, len - written);
+        if (n < 0) {
+            return false;
+        }
+        written += n;
+    }
+    return true;
+}
+
+void start_trace_stream(const char* dest)
+{
+    trace_stream_dest = dest;
+    allocate_trace_logs();
+    trace_stream = sched::thread::make([] {
+        int fd = -1;
+        // The collector or the destination filesystem may not be
+        // reachable this early in the boot - keep trying
+        while (fd < 0 && !trace_stream_done) {
+            fd = open_stream_dest();
+            if (fd < 0) {
+                sched::thread::sleep(std::chrono::seconds(1));
+            }
+        }
+        if (fd < 0) {
+            return;
+        }
+        debugf("trace: streaming to %s\n", trace_stream_dest.c_str());
+        bool ok = true;
+        trace_record* batch[drain_batch];
+        while (ok && !trace_stream_done) {
+            sched::thread::sleep(std::chrono::microseconds(100));
+            size_t n;
+            while (ok && (n = merger.drain(batch, drain_batch)) > 0) {
+                for (size_t i = 0; ok && i < n; i++) {
+                    if (!(ok = stream_one(fd, batch[i]))) {
+                        debugf("trace: streaming to %s failed, stopping\n",
+                            trace_stream_dest.c_str());
+                    }
+                }
+            }
+        }
+        close(fd);
+    }, sched::thread::attr().name("trace-stream"));
+
+    trace_stream->start();
+}
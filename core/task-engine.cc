@@ -0,0 +1,310 @@
+/*
+ * Copyright (C) 2026 Waldemar Kozaczuk
+ *
+ * This work is open source software, licensed under the terms of the
+ * BSD license as described in the LICENSE file in the top-level directory.
+ */
+
+// A run-to-completion executor on top of osv::newpoll: one pinned loop
+// thread per cpu that drains a lock-free task queue, fires due timers
+// and runs event callbacks inline from poller::process(). The loop
+// thread is woken at most once per batch of work, so a request that is
+// posted, handled and answered on the same cpu pays no context switch
+// beyond the initial wakeup - and none at all while the loop is kept
+// busy or spinning on the NIC rings (see the poll budget below).
+
+#include <osv/task-engine.h>
+#include <osv/newpoll.hh>
+#include <osv/net_busy_poll.hh>
+#include <osv/sched.hh>
+#include <osv/mutex.h>
+#include <osv/clock.hh>
+#include <osv/printf.hh>
+#include <osv/trace.hh>
+#include <lockfree/queue-mpsc.hh>
+
+#include <algorithm>
+#include <atomic>
+#include <map>
+#include <vector>
+
+TRACEPOINT(trace_task_engine_post, "engine=%p fn=%p", void*, void*);
+TRACEPOINT(trace_task_engine_event, "engine=%p event=%p", void*, void*);
+
+namespace osv {
+namespace taskengine {
+
+struct task {
+    void (*fn)(void *);
+    void *arg;
+    task *next; // lockfree::queue_mpsc linkage
+};
+
+class engine;
+
+// An event is a newpoll pollable carrying a C callback: signal() can be
+// called from anywhere, including interrupt context, and the callback
+// runs from the loop's poller::process().
+class event : public newpoll::pollable {
+public:
+    event(engine *eng, void (*fn)(void *), void *arg)
+        : _eng(eng), _fn(fn), _arg(arg)
+    {
+    }
+    virtual ~event() {
+    }
+    virtual void on_wake() override {
+        _fn(_arg);
+    }
+    engine *owner() { return _eng; }
+private:
+    engine *_eng;
+    void (*_fn)(void *);
+    void *_arg;
+};
+
+class engine {
+public:
+    explicit engine(unsigned cpu);
+    void post(void (*fn)(void *), void *arg);
+    void timer_after(uint64_t delay_ns, void (*fn)(void *), void *arg);
+    void add_event(event *ev);
+    void del_event(event *ev);
+    void set_poll_budget(unsigned budget_us) {
+        _poll_budget_us.store(budget_us, std::memory_order_relaxed);
+    }
+private:
+    void loop();
+    bool have_ready();
+    void run_due_timers();
+private:
+    // Posted tasks; multiple producers, consumed only by the loop
+    lockfree::queue_mpsc<task> _pending;
+    // Waking the loop for a posted task goes through this pollable, so
+    // the loop blocks on its poller alone
+    class notifier : public newpoll::pollable {
+        virtual void on_wake() override {} // the loop drains _pending itself
+    } _notify;
+    // Only the loop thread touches the fields below
+    newpoll::poller *_poller = nullptr;
+    std::multimap<osv::clock::uptime::time_point, task> _timers;
+    std::vector<event *> _events;
+    std::atomic<unsigned> _poll_budget_us {0};
+    sched::thread *_thread;
+};
+
+// thread-local shortcut so the capture-less lambdas posted to a loop
+// below can find the engine they run on
+static __thread engine *loop_engine;
+
+engine::engine(unsigned cpu)
+{
+    _thread = sched::thread::make([this] { loop(); },
+            sched::thread::attr().name(osv::sprintf("taskeng%d", cpu)));
+    sched::thread::pin(_thread, sched::cpus[cpu]);
+    _thread->start();
+}
+
+void engine::post(void (*fn)(void *), void *arg)
+{
+    trace_task_engine_post(this, reinterpret_cast<void*>(fn));
+    auto t = new task{fn, arg, nullptr};
+    _pending.push(t);
+    _notify.wake();
+}
+
+void engine::timer_after(uint64_t delay_ns, void (*fn)(void *), void *arg)
+{
+    auto when = osv::clock::uptime::now() + std::chrono::nanoseconds(delay_ns);
+    // The timer map belongs to the loop thread, so hand the insertion
+    // over instead of locking it
+    post([](void *req) {
+        auto p = static_cast<std::pair<osv::clock::uptime::time_point,
+                task> *>(req);
+        loop_engine->_timers.emplace(p->first, p->second);
+        delete p;
+    }, new std::pair<osv::clock::uptime::time_point, task>(
+            when, task{fn, arg, nullptr}));
+}
+
+void engine::add_event(event *ev)
+{
+    // poller::add() binds the pollable to the calling thread, so it has
+    // to run on the loop
+    post([](void *arg) {
+        auto ev = static_cast<event *>(arg);
+        auto eng = ev->owner();
+        eng->_poller->add(ev);
+        eng->_events.push_back(ev);
+    }, ev);
+}
+
+void engine::del_event(event *ev)
+{
+    // The removal must run on the loop thread; wait for it to finish, so
+    // the caller can release the callback's resources when we return
+    struct request {
+        event *ev;
+        sched::thread *waiter;
+        std::atomic<bool> done;
+    };
+    request req{ev, sched::thread::current(), {false}};
+    post([](void *arg) {
+        auto r = static_cast<request *>(arg);
+        auto eng = r->ev->owner();
+        eng->_poller->del(r->ev);
+        eng->_events.erase(std::remove(eng->_events.begin(),
+                eng->_events.end(), r->ev), eng->_events.end());
+        delete r->ev;
+        r->done.store(true, std::memory_order_release);
+        r->waiter->wake();
+    }, &req);
+    sched::thread::wait_until([&req] {
+        return req.done.load(std::memory_order_acquire);
+    });
+}
+
+bool engine::have_ready()
+{
+    if (!_pending.empty() || _notify.poll()) {
+        return true;
+    }
+    if (!_timers.empty() &&
+            _timers.begin()->first <= osv::clock::uptime::now()) {
+        return true;
+    }
+    for (auto ev : _events) {
+        if (ev->poll()) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void engine::run_due_timers()
+{
+    auto now = osv::clock::uptime::now();
+    while (!_timers.empty() && _timers.begin()->first <= now) {
+        auto t = _timers.begin()->second;
+        _timers.erase(_timers.begin());
+        t.fn(t.arg);
+    }
+    if (!_timers.empty()) {
+        _poller->set_timer(_timers.begin()->first.time_since_epoch());
+    } else {
+        _poller->cancel_timer();
+    }
+}
+
+void engine::loop()
+{
+    loop_engine = this;
+    // The poller's timer is bound to the current thread, so it can only
+    // be constructed here
+    newpoll::poller poller;
+    _poller = &poller;
+    poller.add(&_notify);
+
+    while (true) {
+        // drain posted tasks first: they carry timer and event
+        // registrations the rest of the pass depends on
+        _notify.read();
+        task *t;
+        while ((t = _pending.pop())) {
+            t->fn(t->arg);
+            delete t;
+        }
+        run_due_timers();
+        poller.process();
+        if (have_ready()) {
+            continue;
+        }
+        auto budget = _poll_budget_us.load(std::memory_order_relaxed);
+        if (budget &&
+                net_busy_poll::spin(budget, [this] { return have_ready(); })) {
+            continue;
+        }
+        poller.wait();
+    }
+}
+
+static mutex engines_mutex;
+static std::vector<engine *> engines;
+
+static engine *for_cpu(unsigned cpu)
+{
+    if (cpu >= sched::cpus.size()) {
+        return nullptr;
+    }
+    WITH_LOCK(engines_mutex) {
+        engines.resize(sched::cpus.size());
+        if (!engines[cpu]) {
+            engines[cpu] = new engine(cpu);
+        }
+        return engines[cpu];
+    }
+}
+
+}
+}
+
+using namespace osv::taskengine;
+
+unsigned osv_task_engine_cpus(void)
+{
+    return sched::cpus.size();
+}
+
+osv_task_engine *osv_task_engine_for_cpu(unsigned cpu)
+{
+    return reinterpret_cast<osv_task_engine *>(for_cpu(cpu));
+}
+
+int osv_task_engine_post(osv_task_engine *eng, void (*fn)(void *), void *arg)
+{
+    if (!eng || !fn) {
+        return -1;
+    }
+    reinterpret_cast<engine *>(eng)->post(fn, arg);
+    return 0;
+}
+
+int osv_task_engine_timer(osv_task_engine *eng, uint64_t delay_ns,
+                          void (*fn)(void *), void *arg)
+{
+    if (!eng || !fn) {
+        return -1;
+    }
+    reinterpret_cast<engine *>(eng)->timer_after(delay_ns, fn, arg);
+    return 0;
+}
+
+osv_task_engine_event *osv_task_engine_event_new(osv_task_engine *eng,
+                                                 void (*fn)(void *),
+                                                 void *arg)
+{
+    if (!eng || !fn) {
+        return nullptr;
+    }
+    auto e = reinterpret_cast<engine *>(eng);
+    auto ev = new event(e, fn, arg);
+    e->add_event(ev);
+    return reinterpret_cast<osv_task_engine_event *>(ev);
+}
+
+void osv_task_engine_event_signal(osv_task_engine_event *ev)
+{
+    trace_task_engine_event(reinterpret_cast<event *>(ev)->owner(), ev);
+    reinterpret_cast<event *>(ev)->wake();
+}
+
+void osv_task_engine_event_free(osv_task_engine_event *ev)
+{
+    auto e = reinterpret_cast<event *>(ev);
+    e->owner()->del_event(e);
+}
+
+void osv_task_engine_set_poll_budget(osv_task_engine *eng, unsigned budget_us)
+{
+    reinterpret_cast<engine *>(eng)->set_poll_budget(budget_us);
+}
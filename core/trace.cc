@@ -7,6 +7,7 @@
 
 #include "osv/trace.hh"
 #include "osv/tracecontrol.hh"
+#include "osv/strace.hh"
 #include <osv/sched.hh>
 #include <osv/mutex.h>
 #include "arch.hh"
@@ -21,6 +22,8 @@
 #include <osv/prio.hh>
 #include <osv/execinfo.hh>
 #include <osv/percpu.hh>
+#include <osv/per-cpu-counter.hh>
+#include <osv/crashdump.hh>
 #include <osv/ilog2.hh>
 #include <osv/semaphore.hh>
 #include <osv/elf.hh>
@@ -61,17 +64,28 @@ constexpr size_t trace_page_size = 4096;  // need not match arch page size
 // Having a struct is more complex than it need be for just per-vcpu buffers,
 // _but_ it is in line with later on having rotating buffers, thus wwhy not do it already
 struct trace_buf {
+    // A slot of the thread-name intern table. Records carry a one-byte
+    // slot index instead of a 16-byte inline name; the thread pointer
+    // lets readers detect a recycled slot (and fall back to "?").
+    struct name_slot {
+        sched::thread* thread;
+        std::array<char, 16> name;
+    };
+    static constexpr size_t n_name_slots = 256;
+
     std::unique_ptr<char[], decltype(&free)>
            _base;
     size_t _last;
     size_t _size;
+    u64 _last_time;
+    std::array<name_slot, n_name_slots> _names;
 
     trace_buf() :
-            _base(nullptr, free), _last(0), _size(0) {
+            _base(nullptr, free), _last(0), _size(0), _last_time(0), _names() {
     }
     trace_buf(size_t size) :
             _base(static_cast<char*>(aligned_alloc(sizeof(long), size)), free), _last(
-                    0), _size(size) {
+                    0), _size(size), _last_time(0), _names() {
         static_assert(is_power_of_two(trace_page_size), "just checking");
         assert(is_power_of_two(size) && "size must be power of two");
         assert((size & (trace_page_size - 1)) == 0 && "size must be multiple of trace_page_size");
@@ -83,6 +97,8 @@ struct trace_buf {
     {
         memcpy(_base.get(), buf._base.get(), _size);
         _last = buf._last;
+        _last_time = buf._last_time;
+        _names = buf._names;
     }
     trace_buf(trace_buf && buf) = default;
 
@@ -95,29 +111,77 @@ struct trace_buf {
         return index(_last);
     }
 
-    trace_record * allocate_trace_record(size_t size) {
-        size += sizeof(trace_record);
-        size = align_up(size, sizeof(long));
-        assert(size <= trace_page_size);
-        size_t p = _last;
-        size_t pn = p + size;
-        if (align_down(p, trace_page_size) != align_down(pn - 1, trace_page_size)) {
-            // crossed page boundary
-            pn = align_up(p, trace_page_size) + size;
+    trace_record * allocate_trace_record(size_t size, u64 time) {
+        u64 delta = time - _last_time;
+        // An absolute timestamp is needed when the delta does not fit in
+        // 32 bits, and forced for the first record of every trace page so
+        // readers can resynchronize at any page boundary after the ring
+        // wraps. The latter is only known once the allocation has been
+        // placed, hence the retry.
+        bool abs = delta > std::numeric_limits<u32>::max();
+        for (;;) {
+            size_t sz = sizeof(trace_record) + size;
+            if (abs) {
+                sz += sizeof(u64);
+            }
+            sz = align_up(sz, sizeof(long));
+            assert(sz <= trace_page_size);
+            size_t p = _last;
+            size_t pn = p + sz;
+            bool page_start = (p & (trace_page_size - 1)) == 0;
+            if (align_down(p, trace_page_size) != align_down(pn - 1, trace_page_size)) {
+                // crossed page boundary
+                pn = align_up(p, trace_page_size) + sz;
+                page_start = true;
+            }
+            if (page_start && !abs) {
+                abs = true;
+                continue;
+            }
+            auto * tr0 = reinterpret_cast<trace_record*>(&_base.get()[index(p)]);
+            auto * tr1 = reinterpret_cast<trace_record*>(&_base.get()[index(pn - sz)]);
+            // Put an "end-marker" on the record being written to signify this is yet incomplete.
+            // Reader is only this vcpu or attached debugger -> no fence needed.
+            tr1->tp = invalid_trace_point;
+            if (tr0 != tr1) {
+                // clear the prev word, do indicate padding at the end of the page
+                tr0->tp = nullptr;
+            }
+            barrier();
+            tr1->flags = abs ? trace_record::flag_abs_time : 0;
+            tr1->time_delta = abs ? 0 : delta;
+            if (abs) {
+                *reinterpret_cast<u64*>(tr1->buffer) = time;
+            }
+            _last_time = time;
+            _last = pn;
+            return tr1;
         }
-        auto * tr0 = reinterpret_cast<trace_record*>(&_base.get()[index(p)]);
-        auto * tr1 = reinterpret_cast<trace_record*>(&_base.get()[index(pn - size)]);
-        // Put an "end-marker" on the record being written to signify this is yet incomplete.
-        // Reader is only this vcpu or attached debugger -> no fence needed.
-        tr1->tp = invalid_trace_point;
-        if (tr0 != tr1) {
-            // clear the prev word, do indicate padding at the end of the page
-            tr0->tp = nullptr;
+    }
+
+    // Intern the thread's current name, returning the slot index stored
+    // in the record. Direct-mapped on the thread pointer: a collision
+    // simply recycles the slot, and readers detect that through the
+    // stored pointer.
+    u8 intern_thread_name(sched::thread* t) {
+        u8 id = (reinterpret_cast<uintptr_t>(t) >> 6) & (n_name_slots - 1);
+        auto& slot = _names[id];
+        auto name = t->name_raw();
+        if (slot.thread != t || slot.name != name) {
+            slot.thread = t;
+            slot.name = name;
         }
-        barrier();
-        _last = pn;
-        return tr1;
+        return id;
+    }
 
+    // The interned name behind a record, or "?" when the slot has been
+    // recycled by another thread since the record was written.
+    const char* thread_name(const trace_record* tr) const {
+        auto& slot = _names[tr->name_id];
+        if (!tr->thread || slot.thread != tr->thread) {
+            return "?";
+        }
+        return slot.name.data();
     }
 private:
     inline size_t index(size_t s) const {
@@ -130,12 +194,15 @@ tracepoint_base * const trace_buf::invalid_trace_point = reinterpret_cast<tracep
 PERCPU(trace_buf, percpu_trace_buffer);
 bool trace_enabled;
 static bool global_backtrace_enabled;
+static bool flight_recorder_enabled;
+static size_t flight_recorder_buf_size = 16 * trace_page_size;
 
 typeof(tracepoint_base::tp_list) tracepoint_base::tp_list __attribute__((init_priority((int)init_prio::tracepoint_base)));
 
 // Note: the definition of this list is: "expressions from command line",
 // and its only use is to deal with late initialization of tp:s
 std::vector<regex_t> enabled_tracepoint_regexs;
+std::vector<regex_t> counted_tracepoint_regexs;
 
 void enable_trace()
 {
@@ -160,10 +227,21 @@ void ensure_log_initialized()
         const size_t ncpu = 1 << size_t(ilog2_roundup(sched::cpus.size()));
         // TODO: examine these defaults. I'm guessing less than 256*mt sized buffers
         // will be subpar, so even if it bloats us on >4 vcpu lets do this for now.
-        const size_t size = trace_page_size * std::max(size_t(256), 1024 / ncpu);
+        size_t size = trace_page_size * std::max(size_t(256), 1024 / ncpu);
+        if (flight_recorder_enabled) {
+            // Flight recorder mode keeps the rings small - they only need to
+            // hold the last moments before an incident
+            size = flight_recorder_buf_size;
+        }
         for (auto c : sched::cpus) {
             auto * tbp = percpu_trace_buffer.for_cpu(c);
             *tbp = trace_buf(size);
+            // Include the ring in crash dumps: the last trace records
+            // before a panic are exactly what a postmortem wants. The
+            // buffers are allocated once and never move.
+            char name[16];
+            snprintf(name, sizeof(name), "trace-cpu%u", c->id);
+            crashdump::register_region(name, tbp->_base.get(), size);
         }
 
         buffers_initialized.store(true, std::memory_order_release);
@@ -184,6 +262,178 @@ void enable_tracepoint(std::string wildcard)
     }
 }
 
+void enable_tracepoint_counting(std::string wildcard)
+{
+    std::string pattern(wildcard);
+    osv::replace_all(pattern, std::string("*"), std::string(".*"));
+    osv::replace_all(pattern, std::string("?"), std::string("."));
+    regex_t re;
+    if (regcomp(&re, pattern.c_str(), REG_NOSUB) == 0) {
+        for (auto& tp : tracepoint_base::tp_list) {
+            if (regexec(&re, tp.name, 0, nullptr, 0) == 0) {
+                tp.count(true);
+            }
+        }
+        counted_tracepoint_regexs.push_back(re);
+    } else {
+        throw std::runtime_error("Failed to compile regular expression '" + wildcard + "'");
+    }
+}
+
+std::vector<std::pair<const char*, ulong>> get_tracepoint_counts()
+{
+    std::vector<std::pair<const char*, ulong>> counts;
+    for (auto& tp : tracepoint_base::tp_list) {
+        if (tp.counting()) {
+            counts.emplace_back(tp.name, tp.counter_value());
+        }
+    }
+    return counts;
+}
+
+void enable_flight_recorder(size_t bufsz_kb)
+{
+    if (bufsz_kb) {
+        // The trace_buf constructor insists on a power of two multiple of
+        // trace_page_size
+        flight_recorder_buf_size = std::max(trace_page_size,
+            size_t(1) << ilog2_roundup(bufsz_kb * 1024));
+    }
+    flight_recorder_enabled = true;
+    // The curated always-on set: scheduler switches, packets entering and
+    // leaving the network stack, and threads blocking on contended mutexes.
+    // The tracepoint templates serialize their arguments with
+    // compile-time-specialized code, so a hit costs a few dozen
+    // nanoseconds; anything more exotic should be enabled explicitly with
+    // --trace.
+    for (auto wildcard : {"sched_switch", "net_packet_*", "mutex_lock_wait"}) {
+        enable_tracepoint(wildcard);
+    }
+}
+
+// Size of the serialized arguments of a record (and optional backtrace),
+// derived from the tracepoint's signature the same way print_trace()
+// deserializes them. Does not include the absolute timestamp some v2
+// records carry before the payload - see trace_record::payload().
+// Also used by the trace streaming consumer in strace.cc.
+size_t trace_payload_size(const trace_record* tr)
+{
+    size_t size = tr->backtrace() ?
+        tracepoint_base::backtrace_len * sizeof(void*) : 0;
+    for (auto sig = tr->tp->sig; *sig; sig++) {
+        switch (*sig) {
+        case 'c':
+        case 'b':
+        case 'B':
+        case '?':
+            size += 1;
+            break;
+        case 'h':
+        case 'H':
+            size = align_up(size, sizeof(u16)) + sizeof(u16);
+            break;
+        case 'i':
+        case 'I':
+        case 'f':
+            size = align_up(size, sizeof(u32)) + sizeof(u32);
+            break;
+        case 'q':
+        case 'Q':
+        case 'd':
+        case 'P':
+            size = align_up(size, sizeof(u64)) + sizeof(u64);
+            break;
+        case 'p':
+            size += object_serializer<const char*>::max_len;
+            break;
+        case '*': {
+            size = align_up(size, sizeof(u16));
+            auto len = *reinterpret_cast<const u16*>(tr->payload() + size);
+            size += sizeof(u16) + len;
+            break;
+        }
+        default:
+            // Unknown signature character - give up on the rest of the page
+            return trace_page_size;
+        }
+    }
+    return size;
+}
+
+// Print the contents of the per-cpu trace buffers to the console. Called
+// from abort() with interrupts disabled, so it must not allocate or sleep.
+// Records are printed in buffer order, not time order - each carries its
+// timestamp, so they can be sorted offline.
+void dump_flight_recorder()
+{
+    if (!flight_recorder_enabled) {
+        return;
+    }
+    auto is_valid_tracepoint = [](const tracepoint_base* tp_test) {
+        for (auto& tp : tracepoint_base::tp_list) {
+            if (&tp == tp_test) {
+                return true;
+            }
+        }
+        return false;
+    };
+    char buf[64];
+    for (auto cpu : sched::cpus) {
+        auto* tbp = percpu_trace_buffer.for_cpu(cpu);
+        if (!tbp->_size) {
+            continue;
+        }
+        auto len = snprintf(buf, sizeof(buf), "flight recorder cpu %u:\n",
+                            cpu->id);
+        console::write(buf, len);
+        for (size_t pos = 0; pos < tbp->_size;) {
+            auto* tr = reinterpret_cast<trace_record*>(&tbp->_base.get()[pos]);
+            // A null tp marks padding at the end of a page, an invalid one
+            // a record that was being written when we aborted; anything not
+            // on the tracepoint list is a partially overwritten leftover
+            if (!tr->tp || tr->tp == trace_buf::invalid_trace_point ||
+                !is_valid_tracepoint(tr->tp)) {
+                pos = align_up(pos + 1, trace_page_size);
+                continue;
+            }
+            print_trace(tr);
+            pos += align_up(sizeof(trace_record) + trace_payload_size(tr) +
+                            (tr->absolute_time() ? sizeof(u64) : 0),
+                            sizeof(long));
+        }
+    }
+}
+
+// Resolve a record's thread name from its cpu's intern table. Reading
+// another cpu's live table is inherently racy - the pointer validation
+// catches a recycled slot, a torn 16-byte name is theoretically possible
+// but harmless for trace output.
+const char* trace_record_thread_name(const trace_record* tr)
+{
+    if (tr->cpu >= sched::cpus.size()) {
+        return "?";
+    }
+    auto* tbp = percpu_trace_buffer.for_cpu(sched::cpus[tr->cpu]);
+    return tbp->thread_name(tr);
+}
+
+// Rebuild a record's absolute timestamp from the per-cpu delta chain.
+// Callers must feed records of a given cpu in buffer order; records
+// flagged with an absolute time (at least one per trace page) resynchronize
+// the chain.
+u64 trace_record_time(const trace_record* tr)
+{
+    static std::array<u64, sched::max_cpus> last_time;
+    u64 time;
+    if (tr->absolute_time()) {
+        time = *reinterpret_cast<const u64*>(tr->buffer);
+    } else {
+        time = last_time[tr->cpu % sched::max_cpus] + tr->time_delta;
+    }
+    last_time[tr->cpu % sched::max_cpus] = time;
+    return time;
+}
+
 void enable_backtraces(bool backtrace) {
     global_backtrace_enabled = backtrace;
     for (auto& tp : tracepoint_base::tp_list) {
@@ -321,6 +571,46 @@ void tracepoint_base::try_enable()
             enable();
         }
     }
+    for (auto& re : counted_tracepoint_regexs) {
+        if (regexec(&re, name, 0, nullptr, 0) == 0) {
+            count(true);
+        }
+    }
+}
+
+// The per-cpu counter a counted tracepoint carries. Like
+// tracepoint_counter, hit() must live in the kernel proper and not in a
+// pageable shared object, since it runs with preemption disabled.
+class tracepoint_base::counter_probe : public tracepoint_base::probe {
+public:
+    virtual void hit() {
+        _counter.increment();
+    }
+    ulong read() {
+        return _counter.read();
+    }
+private:
+    per_cpu_counter _counter;
+};
+
+void tracepoint_base::count(bool enable)
+{
+    if (enable) {
+        if (!_counter) {
+            _counter = new counter_probe;
+            add_probe(_counter);
+        }
+    } else if (_counter) {
+        auto counter = _counter;
+        _counter = nullptr;
+        del_probe(counter); // waits for an rcu grace period
+        delete counter;
+    }
+}
+
+ulong tracepoint_base::counter_value()
+{
+    return _counter ? _counter->read() : 0;
 }
 
 void tracepoint_base::add_probe(probe* p)
@@ -361,7 +651,7 @@ std::unordered_set<tracepoint_id>& tracepoint_base::known_ids()
 
 void tracepoint_base::do_log_backtrace(trace_record* tr, u8*& buffer)
 {
-    assert(tr->backtrace);
+    assert(tr->backtrace());
     auto bt = reinterpret_cast<void**>(buffer);
     auto done = backtrace_safe(bt, backtrace_len);
     fill(bt + done, bt + backtrace_len, nullptr);
@@ -374,16 +664,21 @@ trace_record* tracepoint_base::allocate_trace_record(size_t size)
     if (bt) {
         size += backtrace_len * sizeof(void*);
     }
-    auto * tr = percpu_trace_buffer->allocate_trace_record(size);
-    tr->backtrace = bt;
-    tr->thread = sched::thread::current();
-    tr->thread_name = tr->thread->name_raw();
-    tr->time = 0;
-    tr->cpu = -1;
-    if (tr->thread) {
-        tr->time = clock::get()->uptime();
-        tr->cpu = tr->thread->tcpu()->id;
+    auto * t = sched::thread::current();
+    u64 time = 0;
+    unsigned cpu = -1;
+    if (t) {
+        time = clock::get()->uptime();
+        cpu = t->tcpu()->id;
     }
+    auto * tbp = &*percpu_trace_buffer;
+    auto * tr = tbp->allocate_trace_record(size, time);
+    if (bt) {
+        tr->flags |= trace_record::flag_backtrace;
+    }
+    tr->thread = t;
+    tr->cpu = cpu;
+    tr->name_id = t ? tbp->intern_thread_name(t) : 0;
     return tr;
 }
 
@@ -797,8 +1092,10 @@ trace::create_trace_dump()
         trace_out::pos_type _pos;
     };
 
+    // Minor 2: v2 trace records (delta timestamps, interned thread
+    // names) and a thread-name table at the head of each TRCS chunk
     static const int tf_version_major = 0;
-    static const int tf_version_minor = 1;
+    static const int tf_version_minor = 2;
 
     trace_out out;
 
@@ -954,6 +1251,15 @@ trace::create_trace_dump()
 
             out.align(8);
 
+            // The cpu's thread-name intern table; records refer to it
+            // through their name_id slot index
+            out.write(uint32_t(trace_buf::n_name_slots));
+            for (auto & slot : buf._names) {
+                out.write(reinterpret_cast<uint64_t>(slot.thread));
+                out.write(slot.name.data(), slot.name.size());
+            }
+            out.align(8);
+
             for (auto & r : regs) {
                 const char * s = r.first;
                 const char * e = r.second;
@@ -975,7 +1281,10 @@ trace::create_trace_dump()
 
                     out.twrite<trace_record>(s);
 
-                    if (tr->backtrace) {
+                    if (tr->absolute_time()) {
+                        out.twrite<u64>(s);
+                    }
+                    if (tr->backtrace()) {
                         out.twrite<void *>(s, tracepoint_base::backtrace_len);
                     }
                     auto sig = tr->tp->sig;
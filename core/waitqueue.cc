@@ -12,6 +12,7 @@
 TRACEPOINT(trace_waitqueue_wait, "%p", waitqueue *);
 TRACEPOINT(trace_waitqueue_wake_one, "%p", waitqueue *);
 TRACEPOINT(trace_waitqueue_wake_all, "%p", waitqueue *);
+TRACEPOINT(trace_waitqueue_wake_many, "%p count=%d", waitqueue *, size_t);
 
 namespace sched {
 
@@ -72,11 +73,35 @@ void waitqueue::wake_one(mutex& mtx)
     }
 }
 
+void waitqueue::wake_many(mutex& mtx, size_t count)
+{
+    trace_waitqueue_wake_many(this, count);
+    // Like wake_all(), batch the wakeups of waiters which cannot be
+    // morphed onto the mutex, so each destination cpu is interrupted at
+    // most once.
+    sched::wakeup_batch batch;
+    while (count--) {
+        wait_record *wr = _waiters_fifo.oldest;
+        if (!wr) {
+            break;
+        }
+        _waiters_fifo.oldest = wr->next;
+        if (wr->next == nullptr) {
+            _waiters_fifo.newest = nullptr;
+        }
+        wr->wake_lock(&mtx);
+    }
+}
+
 void waitqueue::wake_all(mutex& mtx)
 {
     trace_waitqueue_wake_all(this);
     wait_record *wr = _waiters_fifo.oldest;
     _waiters_fifo.oldest = _waiters_fifo.newest = nullptr;
+    // Any waiters which cannot be morphed onto the mutex wake up right
+    // here; batch those wakeups so each destination cpu is interrupted
+    // at most once.
+    sched::wakeup_batch batch;
     while (wr) {
         auto next_wr = wr->next; // need to save - *wr invalid after wake
         // FIXME: splice the entire chain at once?
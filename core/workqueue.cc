@@ -0,0 +1,195 @@
+/*
+ * Copyright (C) 2026 Waldemar Kozaczuk
+ *
+ * This work is open source software, licensed under the terms of the
+ * BSD license as described in the LICENSE file in the top-level directory.
+ */
+
+#include <osv/workqueue.hh>
+#include <osv/clock.hh>
+#include <osv/condvar.h>
+#include <osv/mutex.h>
+#include <osv/sched.hh>
+#include <osv/trace.hh>
+
+#include <deque>
+#include <map>
+#include <string>
+
+namespace workqueue {
+
+TRACEPOINT(trace_workqueue_queue, "class=%d delay_ns=%lu", int, u64);
+TRACEPOINT(trace_workqueue_execute, "class=%d backlog=%lu", int, size_t);
+TRACEPOINT(trace_workqueue_thread_start, "class=%d threads=%u", int, unsigned);
+TRACEPOINT(trace_workqueue_thread_exit, "class=%d threads=%u", int, unsigned);
+
+using osv::clock::uptime;
+
+// How long an idle pool thread lingers before exiting. Long enough that
+// periodic work (e.g. a clock resync every few seconds) reuses the same
+// thread instead of respawning one each round.
+static constexpr std::chrono::seconds idle_timeout{30};
+
+class pool {
+public:
+    pool(int id, const char* name, float thread_prio, unsigned max_threads)
+        : _id(id)
+        , _name(name)
+        , _thread_prio(thread_prio)
+        , _max_threads(max_threads)
+    {
+    }
+
+    void queue(std::function<void()> fn, std::chrono::nanoseconds delay)
+    {
+        WITH_LOCK(_lock) {
+            trace_workqueue_queue(_id, delay.count());
+            _queued++;
+            if (delay.count() == 0) {
+                _ready.push_back(std::move(fn));
+            } else {
+                _delayed.emplace(uptime::now() + delay, std::move(fn));
+            }
+            maybe_spawn();
+        }
+        // Also covers the delayed case: the woken thread recomputes its
+        // wait deadline against the new earliest item.
+        _work_ready.wake_one();
+    }
+
+    void set_max_threads(unsigned count)
+    {
+        WITH_LOCK(_lock) {
+            _max_threads = count;
+        }
+        // Excess idle threads notice on wakeup and exit.
+        _work_ready.wake_all();
+    }
+
+    stats get_stats()
+    {
+        WITH_LOCK(_lock) {
+            return {_queued, _executed, _threads, effective_max(),
+                    _ready.size() + _delayed.size()};
+        }
+    }
+
+private:
+    // A limit of 0 means "not set": one thread per CPU. Resolved lazily
+    // because sched::cpus is not populated when the static pools are
+    // constructed.
+    unsigned effective_max()
+    {
+        return _max_threads ? _max_threads : sched::cpus.size();
+    }
+
+    // Called with _lock held.
+    void maybe_spawn()
+    {
+        if (_idle > 0 || _threads >= effective_max()) {
+            return;
+        }
+        _threads++;
+        trace_workqueue_thread_start(_id, _threads);
+        auto t = sched::thread::make([this] { run(); },
+            sched::thread::attr().detached().name(
+                std::string(_name) + std::to_string(_thread_seq++)));
+        t->set_priority(_thread_prio);
+        t->start();
+    }
+
+    void run()
+    {
+        WITH_LOCK(_lock) {
+            for (;;) {
+                // Promote delayed work that has come due
+                auto now = uptime::now();
+                while (!_delayed.empty() && _delayed.begin()->first <= now) {
+                    _ready.push_back(std::move(_delayed.begin()->second));
+                    _delayed.erase(_delayed.begin());
+                }
+
+                if (!_ready.empty()) {
+                    auto fn = std::move(_ready.front());
+                    _ready.pop_front();
+                    trace_workqueue_execute(_id,
+                        _ready.size() + _delayed.size());
+                    DROP_LOCK(_lock) {
+                        fn();
+                    }
+                    _executed++;
+                    continue;
+                }
+
+                if (_threads > effective_max()) {
+                    // The limit was lowered under us
+                    break;
+                }
+
+                _idle++;
+                int timed_out;
+                if (!_delayed.empty()) {
+                    timed_out = _work_ready.wait(&_lock,
+                        _delayed.begin()->first);
+                } else {
+                    timed_out = _work_ready.wait(&_lock, idle_timeout);
+                }
+                _idle--;
+                if (timed_out && _ready.empty() && _delayed.empty()) {
+                    // Sat idle for the full timeout with nothing queued
+                    break;
+                }
+            }
+            _threads--;
+            trace_workqueue_thread_exit(_id, _threads);
+        }
+    }
+
+    const int _id;
+    const char* _name;
+    const float _thread_prio;
+
+    mutex _lock;
+    condvar _work_ready;
+    std::deque<std::function<void()>> _ready;
+    std::multimap<uptime::time_point, std::function<void()>> _delayed;
+    unsigned _max_threads;
+    unsigned _threads = 0;
+    unsigned _idle = 0;
+    unsigned _thread_seq = 0;
+    u64 _queued = 0;
+    u64 _executed = 0;
+};
+
+// Thread names show up in osv info threads, so keep them recognizable.
+// The low class defaults to a single thread: it exists to soak up batch
+// work (readahead, cache writeback) without ever competing for CPUs.
+static pool pools[] = {
+    {0, "wq_high", 0.2f, 0},
+    {1, "wq_norm", sched::thread::priority_default, 0},
+    {2, "wq_low", 2.0f, 1},
+};
+
+void queue(prio p, std::function<void()> fn)
+{
+    pools[static_cast<int>(p)].queue(std::move(fn),
+        std::chrono::nanoseconds::zero());
+}
+
+void queue_after(prio p, std::chrono::nanoseconds delay,
+                 std::function<void()> fn)
+{
+    pools[static_cast<int>(p)].queue(std::move(fn), delay);
+}
+
+void set_max_threads(prio p, unsigned count)
+{
+    pools[static_cast<int>(p)].set_max_threads(count);
+}
+
+stats get_stats(prio p)
+{
+    return pools[static_cast<int>(p)].get_stats();
+}
+
+}
@@ -139,9 +139,10 @@ void port::setup()
 
 void port::enable_irq()
 {
-    // Enable Device to Host Register FIS interrupt
+    // Enable Device to Host Register FIS and Set Device Bits FIS
+    // interrupts - NCQ commands complete with the latter
     auto val = port_readl(PORT_IE);
-    val |= PORT_IE_DHRE;
+    val |= PORT_IE_DHRE | PORT_IE_SDBE;
     port_writel(PORT_IE, val);
 }
 
@@ -165,7 +166,19 @@ void port::wait_ci_ready(u8 slot)
     }
 }
 
-int port::send_cmd(u8 slot, int iswrite, void *buffer, u32 bsize)
+void port::wait_sact_ready(u8 slot)
+{
+    // Wait for the device clearing the slot in SActive, which is how a
+    // queued command signals completion
+    for (;;) {
+        auto sact = port_readl(PORT_SACT);
+        if (!(sact & (1U << slot)))
+            break;
+    }
+}
+
+int port::send_cmd(u8 slot, int iswrite, void *buffer, u32 bsize,
+                   bool queued)
 {
     u32 flags;
 
@@ -201,6 +214,11 @@ int port::send_cmd(u8 slot, int iswrite, void *buffer, u32 bsize)
     // 3) set PORT_CI
     WITH_LOCK(_cmd_lock) {
         _cmd_active |= 1U << slot;
+        // A queued command must be marked active in SActive before it is
+        // issued; the device clears the bit when the command completes.
+        if (queued) {
+            port_writel(PORT_SACT, 1U << slot);
+        }
         port_writel(PORT_CI, 1U << slot);
     }
 
@@ -229,6 +247,15 @@ void port::wait_cmd_poll(u8 slot)
                assert(!error);
                break;
             }
+
+           if (is & PORT_IS_SDBS) {
+               // Queued command done - the SDB FIS carries the error bits
+               // and the device clears the slot in SActive
+               wait_sact_ready(slot);
+               auto error = _recv_fis->sdbfis[2];
+               assert(!error);
+               break;
+            }
         }
     }
     _hba->hba_writel(HOST_IS, host_is);
@@ -245,8 +272,12 @@ u32 port::done_mask()
         return 0x0;
 
     auto ci = port_readl(PORT_CI);
+    // For a non-queued command CI clearing means completion; a queued one
+    // is fetched (CI clears) long before it is done (SACT clears), so a
+    // slot only counts as completed once it is gone from both.
+    auto sact = port_readl(PORT_SACT);
 
-    return _cmd_active & (~ci);
+    return _cmd_active & ~(ci | sact);
 }
 
 void port::req_done()
@@ -276,6 +307,14 @@ void port::req_done()
             // Increase slot free number
             _slot_free++;
 
+            // The non-queued command was issued alone, so the queue being
+            // empty again means it has finished and the NCQ stream may
+            // resume
+            if (_nonq_active.load(std::memory_order_relaxed) &&
+                _cmd_active.load(std::memory_order_relaxed) == 0) {
+                _nonq_active.store(false, std::memory_order_relaxed);
+            }
+
             // Wakeup the thread waiting for a free slot
             _cmd_send_waiter.wake_from_kernel_or_with_irq_disabled();
         }
@@ -309,6 +348,7 @@ void port::poll_mode_done(struct bio *bio, u8 slot)
 {
     if (_hba->poll_mode()) {
         wait_cmd_poll(slot);
+        _nonq_active.store(false, std::memory_order_relaxed);
         biodone(bio, true);
     }
 }
@@ -321,18 +361,40 @@ void port::disk_rw(struct bio *bio, bool iswrite)
     u32 nr_sec = len / 512;
     u8 command, slot;
 
+    // A non-queued command may not overlap the NCQ stream; wait for it to
+    // retire before queueing more
+    while (_nonq_active.load(std::memory_order_relaxed)) {
+        _cmd_send_waiter.reset(*sched::thread::current());
+        sched::thread::wait_until([this] {
+            return !_nonq_active.load(std::memory_order_relaxed);
+        });
+        _cmd_send_waiter.clear();
+    }
+
     slot = get_slot_wait();
 
     struct cmd_table &cmd = _cmd_table[slot];
 
     memset(&cmd.fis, 0, sizeof(cmd.fis));
-    command = (iswrite ? ATA_CMD_WRITE_DMA_EXT : ATA_CMD_READ_DMA_EXT);
     cmd.fis.fis_type = 0x27;
     cmd.fis.flags = 1 << 7;
-    cmd.fis.feature_low = 1;
-    cmd.fis.command = command;
-    cmd.fis.sector_count = nr_sec & 0xFF;
-    cmd.fis.sector_count_ext = (nr_sec >> 8) & 0xFF;
+    if (_ncq) {
+        // NCQ command: the sector count lives in the feature fields and
+        // the sector count field carries the tag, which must match the
+        // command slot
+        command = (iswrite ? ATA_CMD_WRITE_FPDMA_QUEUED :
+                             ATA_CMD_READ_FPDMA_QUEUED);
+        cmd.fis.command = command;
+        cmd.fis.feature_low = nr_sec & 0xFF;
+        cmd.fis.feature_high = (nr_sec >> 8) & 0xFF;
+        cmd.fis.sector_count = (slot << 3) & 0xF8;
+    } else {
+        command = (iswrite ? ATA_CMD_WRITE_DMA_EXT : ATA_CMD_READ_DMA_EXT);
+        cmd.fis.command = command;
+        cmd.fis.feature_low = 1;
+        cmd.fis.sector_count = nr_sec & 0xFF;
+        cmd.fis.sector_count_ext = (nr_sec >> 8) & 0xFF;
+    }
     cmd.fis.lba_low = lba & 0xFF;
     cmd.fis.lba_mid = (lba >> 8) & 0xFF;
     cmd.fis.lba_high = (lba >> 16) & 0xFF;
@@ -342,13 +404,28 @@ void port::disk_rw(struct bio *bio, bool iswrite)
     cmd.fis.device = (1 << 6) | (1 << 4); // must have bit 6 set
 
     _bios[slot] = bio;
-    send_cmd(slot, iswrite, buf, len);
+    send_cmd(slot, iswrite, buf, len, _ncq);
 
     poll_mode_done(bio, slot);
 }
 
 void port::disk_flush(struct bio *bio)
 {
+    // Flush is a non-queued command; drain the NCQ stream first and keep
+    // new submissions back (they check _nonq_active) until it retires
+    if (_ncq) {
+        while (_cmd_active.load(std::memory_order_relaxed) != 0) {
+            _cmd_send_waiter.reset(*sched::thread::current());
+            sched::thread::wait_until([this] {
+                return _cmd_active.load(std::memory_order_relaxed) == 0;
+            });
+            _cmd_send_waiter.clear();
+        }
+        // No completion can arrive between here and send_cmd() - the
+        // queue is empty - so req_done() cannot clear the flag early
+        _nonq_active.store(true, std::memory_order_relaxed);
+    }
+
     auto slot = get_slot_wait();
 
     struct cmd_table &cmd = _cmd_table[slot];
@@ -379,8 +456,23 @@ void port::disk_identify()
     send_cmd(slot, 0, buffer, 512);
     wait_cmd_poll(slot);
 
-    // Word 75 queue depth
-    _queue_depth = buffer[75] & 0x1F;
+    // Word 75 bits 4:0 hold the queue depth minus one
+    _queue_depth = (buffer[75] & 0x1F) + 1;
+
+    // NCQ needs support on both sides: word 76 bit 8 on the disk and
+    // CAP.SNCQ on the HBA
+    _ncq = (buffer[76] & (1 << 8)) &&
+           (_hba->hba_readl(HOST_CAP) & HOST_CAP_SNCQ);
+    if (_ncq) {
+        // Lowest-free-first slot allocation keeps the tags below the
+        // queue depth as long as no more than that many are outstanding
+        if (_queue_depth < _slot_nr) {
+            _slot_free -= _slot_nr - _queue_depth;
+        }
+    } else {
+        // Without NCQ only a single non-queued command may be in flight
+        _slot_free -= _slot_nr - 1;
+    }
 
     // Word 83 LBA48 support
     if (buffer[83] & (1 << 10))  {
@@ -585,7 +677,7 @@ bool hba::ack_irq()
 
         u8 error = port->recv_fis_error();
         assert (error == 0);
-        if ((is & 1)) {
+        if (is & (PORT_IS_DHRS | PORT_IS_SDBS)) {
             port->wakeup();
             handled = true;
         }
@@ -28,6 +28,8 @@ enum ata_cmd {
     ATA_CMD_READ_DMA_EXT = 0x25,
     ATA_CMD_WRITE_DMA = 0xCA,
     ATA_CMD_WRITE_DMA_EXT = 0x35,
+    ATA_CMD_READ_FPDMA_QUEUED = 0x60,
+    ATA_CMD_WRITE_FPDMA_QUEUED = 0x61,
     ATA_CMD_FLUSH_CACHE_EXT = 0xEA,
     ATA_CMD_IDENTIFY_DEVICE = 0xEC,
     ATA_CMD_IDENTIFY_PACKET_DEVICE = 0xA1,
@@ -46,6 +48,11 @@ enum hba_reg {
     HOST_EM_CTL     = 0x20,
 };
 
+// HOST_CAP bits
+enum hba_reg_cap_bits {
+    HOST_CAP_SNCQ   = 1U << 30,     /* Supports Native Command Queuing */
+};
+
 // HOST_GHC bits
 enum hba_reg_ghc_bits {
     HOST_GHC_HR     = 1U << 0,
@@ -232,7 +239,8 @@ public:
 
     void reset();
     void setup();
-    int send_cmd(u8 slot, int iswrite, void *buffer, u32 bsize);
+    int send_cmd(u8 slot, int iswrite, void *buffer, u32 bsize,
+                 bool queued = false);
     void wait_cmd_poll(u8 slot);
     void wait_cmd_irq(u8 slot);
     void disk_identify();
@@ -242,6 +250,7 @@ public:
     void enable_irq();
     void wait_device_ready();
     void wait_ci_ready(u8 slot);
+    void wait_sact_ready(u8 slot);
     void wakeup() { _irq_thread->wake_with_irq_disabled(); }
     bool linkup() { return _linkup; }
 
@@ -284,6 +293,13 @@ public:
 private:
     sched::thread_handle _cmd_send_waiter;
     bool _linkup = false;
+    // NCQ is on when both the HBA and the disk advertise it; commands are
+    // then issued as READ/WRITE FPDMA QUEUED with the slot number as tag,
+    // and up to _queue_depth of them run on the device concurrently.
+    bool _ncq = false;
+    // A non-queued command (flush, identify) may not overlap the NCQ
+    // stream; set while one is outstanding to hold new submissions back.
+    std::atomic<bool> _nonq_active{false};
     u8 _queue_depth;
     size_t _devsize;
     mutex _lock;
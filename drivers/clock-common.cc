@@ -6,6 +6,12 @@
  */
 
 #include "clock-common.hh"
+#include <osv/vdso-data.hh>
+#include <osv/export.h>
+
+// Bound by the vDSO at load time; stays all-zero (so the vDSO falls back
+// to calling clock_gettime()) unless a driver enables it below.
+OSV_LIBC_API vdso_clock_data __osv_vdso_clock_data = {};
 
 pv_based_clock::pv_based_clock()
     : _smp_init(false)
@@ -26,6 +32,7 @@ void pv_based_clock::setup_cpu()
             == 1) {
         _boot_systemtime = system_time();
         _smp_init.store(true, std::memory_order_release);
+        enable_vdso_clock(_boot_systemtime);
     }
 }
 
@@ -29,6 +29,10 @@ protected:
     virtual u64 wall_clock_boot() = 0;
     virtual u64 system_time() = 0;
     virtual void init_on_cpu() {};
+    // Called once, after all CPUs ran init_on_cpu() and _boot_systemtime
+    // is known. A driver whose clock can be read from the vDSO without
+    // entering the kernel overrides this to publish __osv_vdso_clock_data.
+    virtual void enable_vdso_clock(s64 boot_systemtime) {};
 };
 
 #endif
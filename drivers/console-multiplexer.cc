@@ -7,6 +7,7 @@
 #include <osv/device.h>
 #include <osv/debug.hh>
 #include <signal.h>
+#include <cstring>
 #include "console-multiplexer.hh"
 
 // Set with set_fp(), each console is only open on one "file" object (which
@@ -34,6 +35,12 @@ void console_multiplexer::start()
         driver->start([=] { _ldisc->read_poll(driver); });
     }
     _drivers_writer =  [=](const char * str, size_t len) { this->drivers_write(str, len); };
+    for (unsigned i = 0; i < sched::cpus.size(); i++) {
+        _write_buffers.push_back(new write_buffer);
+    }
+    _flusher_thread = sched::thread::make([this] { flusher(); },
+            sched::thread::attr().name("console_flush"));
+    _flusher_thread->start();
     _started = true;
 }
 
@@ -73,17 +80,81 @@ void console_multiplexer::write_ll(const char *str, size_t len)
     }
 }
 
-void console_multiplexer::write(const char *str, size_t len)
+// Drain one staging buffer to the drivers. Called with _mutex held; the
+// staged bytes are copied out under the buffer's lock and written after it
+// is dropped, so a slow console driver never blocks that cpu's writers.
+void console_multiplexer::drain(write_buffer *buf)
+{
+    char local[write_buffer::capacity];
+    size_t n;
+    WITH_LOCK(buf->lock) {
+        n = buf->len;
+        memcpy(local, buf->data, n);
+        buf->len = 0;
+    }
+    if (n > 0) {
+        _ldisc->write(local, n, _drivers_writer);
+    }
+}
+
+void console_multiplexer::flush()
 {
     if (!_started) {
-        WITH_LOCK(_early_lock) {
-            write_ll(str, len);
+        return;
+    }
+    WITH_LOCK(_mutex) {
+        for (auto buf : _write_buffers) {
+            drain(buf);
         }
-    } else {
-        WITH_LOCK(_mutex) {
-            write_ll(str, len);
+        drivers_flush();
+    }
+}
+
+void console_multiplexer::flusher()
+{
+    while (true) {
+        sched::thread::wait_until([&] {
+            return _flush_pending.load(std::memory_order_acquire);
+        });
+        _flush_pending.store(false, std::memory_order_relaxed);
+        flush();
+    }
+}
+
+void console_multiplexer::write(const char *str, size_t len)
+{
+    if (!_started) {
+        qspin_node_t node;
+        qspin_lock(&_early_lock, &node);
+        write_ll(str, len);
+        qspin_unlock(&_early_lock, &node);
+        return;
+    }
+    // Stage the output in this cpu's buffer and let the flusher thread
+    // write it out in bulk: at low rates it wakes and flushes right away,
+    // and under load whole batches of lines go to the drivers per lock
+    // acquisition. Reading the cpu id without disabling preemption is
+    // fine - landing in a remote buffer merely costs locality.
+    auto buf = _write_buffers[sched::cpu::current()->id];
+    if (len < write_buffer::capacity) {
+        WITH_LOCK(buf->lock) {
+            if (buf->len + len <= write_buffer::capacity) {
+                memcpy(buf->data + buf->len, str, len);
+                buf->len += len;
+                _flush_pending.store(true, std::memory_order_release);
+                _flusher_thread->wake();
+                return;
+            }
         }
     }
+    // Too long to stage, or the buffer is full: write through. Draining
+    // this cpu's buffer first, under the same _mutex hold, keeps a single
+    // thread's output in order.
+    WITH_LOCK(_mutex) {
+        drain(buf);
+        _ldisc->write(str, len, _drivers_writer);
+        drivers_flush();
+    }
 }
 
 void console_multiplexer::write(struct uio *uio, int ioflag)
@@ -8,7 +8,10 @@
 #ifndef DRIVERS_CONSOLE_MULTIPLEXER_HH
 #define DRIVERS_CONSOLE_MULTIPLEXER_HH
 #include <osv/spinlock.h>
+#include <osv/sched.hh>
 #include <termios.h>
+#include <atomic>
+#include <vector>
 #include "console-driver.hh"
 #include "line-discipline.hh"
 
@@ -24,6 +27,8 @@ public:
     void write_ll(const char *str, size_t len);
     void write(const char *str, size_t len);
     void write(struct uio *uio, int ioflag);
+    // Drain all per-cpu staging buffers to the drivers.
+    void flush();
     // Operations passed to the line discipline:
     int read_queue_size();
     void discard_pending_input();
@@ -32,8 +37,29 @@ public:
 private:
     void drivers_write(const char *str, size_t len);
     void drivers_flush();
+    void drain(struct write_buffer *buf);
+    void flusher();
+    // Per-cpu staging for write(): a writer appends to its cpu's buffer
+    // under that buffer's own lock, so concurrent writers on different
+    // cpus do not serialize on one global console mutex. The flusher
+    // thread (or a writer which overflowed its buffer) drains the staged
+    // bytes to the drivers in bulk under _mutex. Lock order is always
+    // _mutex before a buffer lock; the fast path takes only the latter.
+    struct write_buffer {
+        static constexpr size_t capacity = 4096;
+        mutex lock;
+        size_t len = 0;
+        char data[capacity];
+    };
+    std::vector<write_buffer *> _write_buffers;  // one per cpu
+    sched::thread *_flusher_thread = nullptr;
+    std::atomic<bool> _flush_pending = {false};
     const termios *_tio;
-    spinlock _early_lock;
+    // Early boot output serializes here, and during SMP bring-up every
+    // cpu's chatter hits it at once; the queued lock keeps the waiters
+    // spinning on their own nodes and hands the console over in FIFO
+    // order, so no cpu's output is starved.
+    qspinlock _early_lock;
     bool _started = false;
     console_driver *_early_driver;
     std::list<console_driver *> _drivers;
@@ -8,6 +8,7 @@
 #include "drivers/driver.hh"
 #include <osv/pci.hh>
 #include <osv/debug.hh>
+#include <osv/boot.hh>
 
 #include "driver.hh"
 
@@ -40,6 +41,7 @@ namespace hw {
                 if (auto drv = probe(dev)) {
                     dev->set_attached();
                     _drivers.push_back(drv);
+                    boot_time.event(("probed " + drv->get_name()).c_str());
                     break;
                 }
             }
@@ -54,6 +56,21 @@ namespace hw {
         _drivers.clear();
     }
 
+    void driver_manager::suspend_all()
+    {
+        // Park devices in reverse probe order
+        for (auto it = _drivers.rbegin(); it != _drivers.rend(); ++it) {
+            (*it)->suspend();
+        }
+    }
+
+    void driver_manager::resume_all()
+    {
+        for (auto drv : _drivers) {
+            drv->resume();
+        }
+    }
+
     void driver_manager::list_drivers()
     {
         for (auto drv : _drivers) {
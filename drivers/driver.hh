@@ -22,9 +22,10 @@ namespace hw {
         // Drivers are indexed by their names
         virtual std::string get_name() const = 0;
 
-        // virtual bool sleep() = 0;
-        // virtual bool wake() = 0;
-        // ...
+        // Park/unpark the device around a VMM snapshot; drivers which keep
+        // host-visible or host-provided state override these.
+        virtual void suspend() {}
+        virtual void resume() {}
 
         virtual void dump_config() = 0;
     };
@@ -45,6 +46,8 @@ namespace hw {
         void register_driver(std::function<hw_driver* (hw_device*)> probe);
         void load_all();
         void unload_all();
+        void suspend_all();
+        void resume_all();
         void list_drivers();
 
     private:
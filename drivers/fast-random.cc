@@ -0,0 +1,197 @@
+/*
+ * Copyright (C) 2026 Waldemar Kozaczuk
+ *
+ * This work is open source software, licensed under the terms of the
+ * BSD license as described in the LICENSE file in the top-level directory.
+ */
+
+#include <osv/fast-random.hh>
+
+#include <osv/sched.hh>
+#include <osv/preempt-lock.hh>
+#include <osv/debug.hh>
+
+#include <dev/random/randomdev.h>
+#include <dev/random/random_adaptors.h>
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+
+namespace randomdev {
+
+//
+// ChaCha20 block function (RFC 7539). We only need the raw keystream -
+// each CPU's pool is a ChaCha20 instance keyed from Yarrow, with the CPU
+// id as the nonce so two pools never produce the same stream even if they
+// were (re)keyed identically.
+//
+
+static inline u32 rotl32(u32 x, int n)
+{
+    return (x << n) | (x >> (32 - n));
+}
+
+#define CHACHA_QR(a, b, c, d)                       \
+    a += b; d ^= a; d = rotl32(d, 16);              \
+    c += d; b ^= c; b = rotl32(b, 12);              \
+    a += b; d ^= a; d = rotl32(d, 8);               \
+    c += d; b ^= c; b = rotl32(b, 7);
+
+static void chacha20_block(const u32 key[8], u64 counter, u32 nonce,
+                           u32 out[16])
+{
+    u32 x[16] = {
+        // "expand 32-byte k"
+        0x61707865, 0x3320646e, 0x79622d32, 0x6b206574,
+        key[0], key[1], key[2], key[3],
+        key[4], key[5], key[6], key[7],
+        u32(counter), u32(counter >> 32), nonce, 0,
+    };
+    u32 in[16];
+    memcpy(in, x, sizeof(in));
+
+    for (int i = 0; i < 10; i++) {
+        CHACHA_QR(x[0], x[4], x[8],  x[12]);
+        CHACHA_QR(x[1], x[5], x[9],  x[13]);
+        CHACHA_QR(x[2], x[6], x[10], x[14]);
+        CHACHA_QR(x[3], x[7], x[11], x[15]);
+        CHACHA_QR(x[0], x[5], x[10], x[15]);
+        CHACHA_QR(x[1], x[6], x[11], x[12]);
+        CHACHA_QR(x[2], x[7], x[8],  x[13]);
+        CHACHA_QR(x[3], x[4], x[9],  x[14]);
+    }
+    for (int i = 0; i < 16; i++) {
+        out[i] = x[i] + in[i];
+    }
+}
+
+#undef CHACHA_QR
+
+// One pool per CPU, each on its own cache line: the fast path only ever
+// touches the current CPU's pool, under preempt_lock, so there is no
+// locking and no line bouncing.
+struct alignas(64) fast_pool {
+    u32 key[8];
+    u64 counter;
+    u32 seed_gen_seen;
+    unsigned avail;         // unconsumed bytes at the tail of buf
+    u8 buf[64];
+};
+
+static fast_pool* pools;
+static unsigned nr_pools;
+
+// Fresh keys staged by the rekeying thread; a pool picks its key up the
+// next time it runs after seed_gen was bumped. The fast path may copy a
+// key the rekeyer is still writing - a torn mix of two Yarrow outputs is
+// as unpredictable as either, so no locking is needed here either.
+static u32 (*pending_keys)[8];
+static std::atomic<u32> seed_gen;
+
+static std::atomic<bool> ready;
+
+// Rekey every pool this often. Between rekeys each CPU runs on its own
+// keystream; ChaCha20 output reveals nothing about the key, so the
+// interval is about post-compromise recovery, not output quality.
+static constexpr auto reseed_interval = std::chrono::seconds(30);
+
+static void read_adaptor(void* buf, int size)
+{
+    char* p = static_cast<char*>(buf);
+    while (size > 0) {
+        int n = (*random_adaptor->read)(p, size);
+        if (n <= 0) {
+            break;
+        }
+        p += n;
+        size -= n;
+    }
+    // Finished reading; let the source do its optional housekeeping
+    (*random_adaptor->read)(nullptr, 0);
+}
+
+static void reseed_thread_fn()
+{
+    while (true) {
+        sched::thread::sleep(reseed_interval);
+        for (unsigned i = 0; i < nr_pools; i++) {
+            read_adaptor(pending_keys[i], sizeof(pending_keys[i]));
+        }
+        seed_gen.fetch_add(1, std::memory_order_release);
+    }
+}
+
+bool fast_random_ready()
+{
+    return ready.load(std::memory_order_acquire);
+}
+
+void fast_random_fill(void* buf, size_t len)
+{
+    u8* out = static_cast<u8*>(buf);
+    while (len > 0) {
+        WITH_LOCK(preempt_lock) {
+            auto& p = pools[sched::cpu::current()->id];
+
+            auto gen = seed_gen.load(std::memory_order_acquire);
+            if (gen != p.seed_gen_seen) {
+                memcpy(p.key, pending_keys[sched::cpu::current()->id],
+                       sizeof(p.key));
+                p.seed_gen_seen = gen;
+                p.avail = 0;
+            }
+
+            // Generate in bounded chunks so a huge request doesn't keep
+            // preemption off for long
+            size_t chunk = std::min(len, size_t(256));
+            len -= chunk;
+            while (chunk > 0) {
+                if (p.avail == 0) {
+                    chacha20_block(p.key, p.counter++,
+                                   sched::cpu::current()->id,
+                                   reinterpret_cast<u32*>(p.buf));
+                    p.avail = sizeof(p.buf);
+                }
+                size_t n = std::min(chunk, size_t(p.avail));
+                memcpy(out, p.buf + (sizeof(p.buf) - p.avail), n);
+                p.avail -= n;
+                out += n;
+                chunk -= n;
+            }
+        }
+    }
+}
+
+void fast_random_init()
+{
+    nr_pools = sched::cpus.size();
+    pools = new fast_pool[nr_pools]();
+    pending_keys = new u32[nr_pools][8];
+
+    // Yarrow may not have accumulated enough entropy yet this early in
+    // boot; wait like /dev/random reads do before drawing the first keys
+    if (!random_adaptor->seeded) {
+        (*random_adaptor->block)(0);
+    }
+    for (unsigned i = 0; i < nr_pools; i++) {
+        read_adaptor(pools[i].key, sizeof(pools[i].key));
+    }
+    ready.store(true, std::memory_order_release);
+
+    auto t = sched::thread::make(reseed_thread_fn,
+            sched::thread::attr().name("fast-random"));
+    t->start();
+}
+
+}
+
+extern "C" int osv_fast_random_fill(void* buf, size_t len)
+{
+    if (!randomdev::fast_random_ready()) {
+        return -1;
+    }
+    randomdev::fast_random_fill(buf, len);
+    return 0;
+}
@@ -0,0 +1,227 @@
+/*
+ * Copyright (C) 2026 Waldemar Kozaczuk
+ *
+ * This work is open source software, licensed under the terms of the
+ * BSD license as described in the LICENSE file in the top-level directory.
+ */
+
+// Driver for the QEMU/ivshmem inter-VM shared memory device. The device
+// exposes a host-provided memory object in BAR2; every guest mapping it
+// sees the same bytes, so co-located guests can move data at memory
+// bandwidth instead of through the host network bridge. BAR0 carries a
+// small register block with our peer id and a doorbell: writing
+// (peer_id << 16) | vector rings MSI-X vector "vector" on the peer, which
+// is how a producer kicks a sleeping consumer.
+//
+// The region is published as /dev/ivshmemN. mmap() of the node maps BAR2
+// pages straight into the caller's address space (see devops::mmap and
+// mmu::map_phys_mmap()); read()/write() copy through the kernel mapping
+// for simple tooling; ioctls ring the doorbell and wait for incoming
+// doorbell interrupts. Ring structures from include/lockfree placed in
+// the shared region work unmodified between guests, since they only need
+// loads, stores and atomics on the shared bytes.
+
+#include "drivers/ivshmem.hh"
+#include <osv/device.h>
+#include <osv/uio.h>
+#include <osv/debug.hh>
+#include <osv/mmu.hh>
+#include <osv/sched.hh>
+#include <algorithm>
+
+namespace ivshmem {
+
+#define IVSHMEM_VENDOR_ID 0x1af4
+#define IVSHMEM_DEVICE_ID 0x1110
+
+static int _instance = 0;
+
+static driver *to_driver(struct device *dev)
+{
+    return reinterpret_cast<driver*>(dev->private_data);
+}
+
+static int
+ivshmem_read(struct device *dev, struct uio *uio, int ioflags)
+{
+    auto *drv = to_driver(dev);
+
+    if (uio->uio_offset < 0 || (u64)uio->uio_offset > drv->shm_size()) {
+        return EINVAL;
+    }
+
+    size_t len = std::min((u64)uio->uio_resid,
+                          drv->shm_size() - uio->uio_offset);
+    if (!len) {
+        return 0;
+    }
+    return uiomove(drv->shm() + uio->uio_offset, len, uio);
+}
+
+static int
+ivshmem_write(struct device *dev, struct uio *uio, int ioflags)
+{
+    // uiomove() copies in the direction recorded in uio->uio_rw, so the
+    // bounds checking is all that differs from the read path
+    return ivshmem_read(dev, uio, ioflags);
+}
+
+static int
+ivshmem_ioctl(struct device *dev, u_long cmd, void *arg)
+{
+    auto *drv = to_driver(dev);
+
+    switch (cmd) {
+    case IVSHMEM_GET_SIZE:
+        *reinterpret_cast<u64*>(arg) = drv->shm_size();
+        return 0;
+    case IVSHMEM_GET_POS:
+        *reinterpret_cast<u32*>(arg) = drv->position();
+        return 0;
+    case IVSHMEM_DOORBELL:
+        drv->ring_doorbell(*reinterpret_cast<u32*>(arg));
+        return 0;
+    case IVSHMEM_WAIT: {
+        auto *count = reinterpret_cast<u64*>(arg);
+        return drv->wait_doorbell(*count, count);
+    }
+    default:
+        return EINVAL;
+    }
+}
+
+static int
+ivshmem_mmap(struct device *dev, uintptr_t *paddr, size_t *size)
+{
+    auto *drv = to_driver(dev);
+
+    *paddr = drv->shm_phys();
+    *size = drv->shm_size();
+    return 0;
+}
+
+static struct devops ivshmem_device_devops {
+    no_open,
+    no_close,
+    ivshmem_read,
+    ivshmem_write,
+    ivshmem_ioctl,
+    no_devctl,
+    no_strategy,
+    ivshmem_mmap,
+};
+
+// "driver" is our hw_driver class in this namespace, so the devfs driver
+// struct needs the global type spelled out
+struct ::driver ivshmem_device_driver = {
+    "ivshmem",
+    &ivshmem_device_devops,
+};
+
+driver::driver(pci::device& dev)
+    : hw_driver()
+    , _dev(dev)
+    , _msi(&dev)
+    , _id(_instance++)
+{
+    _driver_name = "ivshmem" + std::to_string(_id);
+
+    _dev.set_bus_master(true);
+
+    _regs = _dev.get_bar(1);
+    assert(_regs != nullptr);
+    _regs->map();
+    assert(_regs->is_mapped());
+
+    // BAR2 holds the shared region itself. Map it into the linear region
+    // like any other memory, so the kernel mapping is cacheable and pages
+    // of it can be mapped into vmas by physical address.
+    auto *shm_bar = _dev.get_bar(3);
+    assert(shm_bar != nullptr);
+    _shm_phys = shm_bar->get_addr64();
+    _shm_size = shm_bar->get_size();
+    _shm = const_cast<char*>(static_cast<volatile char*>(
+            mmio_map(_shm_phys, _shm_size, "ivshmem")));
+
+    // Doorbell interrupts need MSI-X (a device without it - or without the
+    // ivshmem server on the host side - is plain shared memory; peers then
+    // have to poll, and IVSHMEM_WAIT reports ENOTSUP).
+    if (_dev.is_msix()) {
+        _doorbell_thread = std::unique_ptr<sched::thread>(sched::thread::make(
+            [this] {
+                while (true) {
+                    sched::thread::wait_until([this] {
+                        return _doorbell_pending.load(
+                                std::memory_order_relaxed);
+                    });
+                    _doorbell_pending.store(false, std::memory_order_relaxed);
+                    WITH_LOCK(_doorbell_mutex) {
+                        _doorbell_count.fetch_add(1,
+                                std::memory_order_relaxed);
+                        _doorbell_wq.wake_all(_doorbell_mutex);
+                    }
+                }
+            },
+            sched::thread::attr().name(_driver_name)));
+        _doorbell_thread->start();
+        _msi.easy_register({ msix_binding{0,
+            [this] { _doorbell_pending.store(true, std::memory_order_relaxed); },
+            _doorbell_thread.get()} });
+    }
+
+    register_devfs_node();
+
+    debugf("ivshmem: %s: peer id %d, %lu bytes of shared memory at %#lx%s\n",
+           _driver_name.c_str(), position(), _shm_size, _shm_phys,
+           has_interrupts() ? "" : ", no MSI-X - doorbells disabled");
+}
+
+void driver::register_devfs_node()
+{
+    struct device *dev = device_create(&ivshmem_device_driver,
+                                       _driver_name.c_str(), D_CHR);
+    dev->private_data = this;
+    dev->size = _shm_size;
+}
+
+u32 driver::position()
+{
+    return _regs->readl(IVSHMEM_IV_POSITION);
+}
+
+void driver::ring_doorbell(u32 val)
+{
+    _regs->writel(IVSHMEM_DOORBELL_REG, val);
+}
+
+int driver::wait_doorbell(u64 seen, u64* count)
+{
+    if (!has_interrupts()) {
+        return ENOTSUP;
+    }
+    WITH_LOCK(_doorbell_mutex) {
+        while (_doorbell_count.load(std::memory_order_relaxed) <= seen) {
+            _doorbell_wq.wait(_doorbell_mutex);
+        }
+        *count = _doorbell_count.load(std::memory_order_relaxed);
+    }
+    return 0;
+}
+
+void driver::dump_config()
+{
+    _dev.dump_config();
+}
+
+hw_driver* driver::probe(hw_device* dev)
+{
+    if (auto pci_dev = dynamic_cast<pci::device*>(dev)) {
+        if (pci_dev->get_id() ==
+                hw_device_id(IVSHMEM_VENDOR_ID, IVSHMEM_DEVICE_ID)) {
+            return new driver(*pci_dev);
+        }
+    }
+    return nullptr;
+}
+
+}
@@ -0,0 +1,87 @@
+/*
+ * Copyright (C) 2026 Waldemar Kozaczuk
+ *
+ * This work is open source software, licensed under the terms of the
+ * BSD license as described in the LICENSE file in the top-level directory.
+ */
+
+#ifndef IVSHMEM_DRIVER_H
+#define IVSHMEM_DRIVER_H
+
+#include "drivers/driver.hh"
+#include "drivers/pci-device.hh"
+#include <osv/interrupt.hh>
+#include <osv/msi.hh>
+#include <osv/mmio.hh>
+#include <osv/mutex.h>
+#include <osv/waitqueue.hh>
+#include <atomic>
+#include <memory>
+
+namespace ivshmem {
+
+// ioctls understood by /dev/ivshmemN; the shared region itself is best
+// accessed by mmap()ing the device node.
+enum {
+    IVSHMEM_GET_SIZE = 0x6900, // u64*: size of the shared region in bytes
+    IVSHMEM_GET_POS  = 0x6901, // u32*: our peer id (IVPosition register)
+    IVSHMEM_DOORBELL = 0x6902, // u32: (peer_id << 16) | vector, rings a peer
+    IVSHMEM_WAIT     = 0x6903, // u64*: block until the doorbell interrupt
+                               // count exceeds *arg; *arg is updated to the
+                               // new count on return
+};
+
+class driver : public hw_driver {
+public:
+    explicit driver(pci::device& dev);
+    virtual ~driver() {}
+
+    virtual std::string get_name() const override { return _driver_name; }
+
+    virtual void dump_config() override;
+
+    u64 shm_phys() const { return _shm_phys; }
+    u64 shm_size() const { return _shm_size; }
+    char* shm() const { return _shm; }
+
+    u32 position();
+    void ring_doorbell(u32 val);
+    // block until more doorbell interrupts than "seen" have arrived;
+    // returns the current count (ENOTSUP when the device has no MSI-X)
+    int wait_doorbell(u64 seen, u64* count);
+    bool has_interrupts() const { return (bool)_doorbell_thread; }
+
+    static hw_driver* probe(hw_device* dev);
+
+private:
+    // BAR0 register layout, all 32-bit little-endian
+    enum ivshmem_regs {
+        IVSHMEM_INTR_MASK   = 0x0, // legacy INTx only
+        IVSHMEM_INTR_STATUS = 0x4, // legacy INTx only
+        IVSHMEM_IV_POSITION = 0x8,
+        IVSHMEM_DOORBELL_REG = 0xc,
+    };
+
+    void register_devfs_node();
+
+    pci::device& _dev;
+    interrupt_manager _msi;
+    pci::bar* _regs = nullptr;
+    u64 _shm_phys = 0;
+    u64 _shm_size = 0;
+    char* _shm = nullptr;
+    std::string _driver_name;
+    int _id;
+
+    // doorbell interrupts: the MSI-X handler wakes _doorbell_thread, which
+    // bumps the count and broadcasts to sleepers in wait_doorbell()
+    std::unique_ptr<sched::thread> _doorbell_thread;
+    std::atomic<bool> _doorbell_pending = {false};
+    std::atomic<u64> _doorbell_count = {0};
+    mutex _doorbell_mutex;
+    waitqueue _doorbell_wq;
+};
+
+}
+
+#endif
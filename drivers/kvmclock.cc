@@ -17,6 +17,9 @@
 #include <osv/prio.hh>
 #include <osv/migration-lock.hh>
 #include <osv/sched.hh>
+#include <osv/snapshot.hh>
+#include <osv/vdso-data.hh>
+#include <osv/workqueue.hh>
 #include <mutex>
 #include <atomic>
 
@@ -31,7 +34,9 @@ protected:
     virtual u64 wall_clock_boot();
     virtual u64 system_time();
     virtual void init_on_cpu();
+    virtual void enable_vdso_clock(s64 boot_systemtime) override;
     void sync_wall_clock();
+    void schedule_wall_clock_sync();
 private:
     static bool _new_kvmclock_msrs;
     pvclock_wall_clock* _wall;
@@ -63,17 +68,22 @@ kvmclock::kvmclock()
     _wall_phys = mmu::virt_to_phys(_wall);
     sync_wall_clock();
     //
-    // Start a thread that will synchronize the wall clock with the host
-    auto t = sched::thread::make([this] {
-        while (true) {
-            sched::thread::sleep(std::chrono::seconds(1));
-            this->sync_wall_clock();
-        }
-    }, sched::thread::attr().name("kvm_wall_clock_sync"));
-    t->start();
-    //TODO: Technically we should terminate the thread
-    //when kvmclock object is destroyed but we are assuming it never will
-    //before OSv goes down
+    // Periodically synchronize the wall clock with the host
+    schedule_wall_clock_sync();
+    // After a snapshot restore the host wall clock may have jumped far
+    // ahead; resync right away instead of waiting for the periodic sync
+    osv::snapshot::on_resume([this] { sync_wall_clock(); });
+    //The periodic work keeps rescheduling itself forever, but we are
+    //assuming the kvmclock object is never destroyed before OSv goes down
+}
+
+void kvmclock::schedule_wall_clock_sync()
+{
+    workqueue::queue_after(workqueue::prio::normal, std::chrono::seconds(1),
+        [this] {
+            sync_wall_clock();
+            schedule_wall_clock_sync();
+        });
 }
 
 void kvmclock::init_on_cpu()
@@ -106,6 +116,21 @@ void kvmclock::sync_wall_clock()
     processor::wrmsr(_wall_time_msr, _wall_phys);
 }
 
+void kvmclock::enable_vdso_clock(s64 boot_systemtime)
+{
+    // The vDSO always reads vcpu0's time info, regardless of which cpu the
+    // calling thread runs on, which is only valid when the host marks the
+    // TSC stable across vcpus.
+    if (!(get_pvclock_flags() & pvclock::TSC_STABLE_BIT)) {
+        return;
+    }
+    auto& d = __osv_vdso_clock_data;
+    d.wall = _wall;
+    d.sys = _sys.for_cpu(sched::cpus[0]);
+    d.boot_systemtime = boot_systemtime;
+    d.enabled.store(1, std::memory_order_release);
+}
+
 u64 kvmclock::system_time()
 {
     WITH_LOCK(migration_lock) {
@@ -35,6 +35,7 @@
 #include <osv/sched.hh>
 #include <osv/poll.h>
 #include <signal.h>
+#include <cstring>
 
 namespace console {
 
@@ -169,14 +170,31 @@ void LineDiscipline::read_poll(console_driver *driver)
         }
     }
 }
+// Write whole spans at a time: scan for the newlines which need ONLCR
+// processing and hand each unmodified stretch between them to the writer
+// in a single call, instead of calling the writer once per character.
 void LineDiscipline::write(const char *str, size_t len,
     std::function<void(const char *str, size_t len)>& writer)
 {
-    while (len-- > 0) {
-        if ((*str == '\n') &&
-            (_tio->c_oflag & OPOST) && (_tio->c_oflag & ONLCR))
-                writer("\r", 1);
-            writer(str++, 1);
+    if (!((_tio->c_oflag & OPOST) && (_tio->c_oflag & ONLCR))) {
+        if (len > 0) {
+            writer(str, len);
+        }
+        return;
+    }
+    while (len > 0) {
+        auto nl = static_cast<const char*>(memchr(str, '\n', len));
+        if (!nl) {
+            writer(str, len);
+            return;
+        }
+        auto stretch = static_cast<size_t>(nl - str);
+        if (stretch > 0) {
+            writer(str, stretch);
+        }
+        writer("\r\n", 2);
+        str = nl + 1;
+        len -= stretch + 1;
     }
 }
 
@@ -16,6 +16,11 @@
 #include <osv/trace.hh>
 #include <osv/mempool.hh>
 #include <osv/align.hh>
+#include <osv/clock.hh>
+#include <osv/barrier.hh>
+#include <osv/preempt-lock.hh>
+
+#include <chrono>
 
 #include "nvme-queue.hh"
 
@@ -99,17 +104,39 @@ inline void queue_pair::advance_sq_tail()
          _sq_full);
 }
 
-u16 queue_pair::submit_cmd(nvme_sq_entry_t* cmd)
+u16 queue_pair::submit_cmd(nvme_sq_entry_t* cmd, bool ring_doorbell)
 {
     _sq._addr[_sq._tail] = *cmd;
     advance_sq_tail();
-    mmio_setl(_sq._doorbell, _sq._tail);
+    // The caller may hold the doorbell back while submitting a chain of
+    // commands; the write for the chain's last command then publishes
+    // the whole batch to the controller at once.
+    if (ring_doorbell) {
+        mmio_setl(_sq._doorbell, _sq._tail);
+    }
     return _sq._tail;
 }
 
 void queue_pair::wait_for_completion_queue_entries()
 {
     trace_nvme_cq_wait(_driver_id, _id, _cq._head);
+#if NVME_HYBRID_POLL_US > 0
+    // Hybrid polling: as long as commands are outstanding the next
+    // completion is most likely microseconds away, so spin on the CQ
+    // briefly before paying for enabling the interrupt and sleeping.
+    auto deadline = osv::clock::uptime::now() +
+        std::chrono::microseconds(NVME_HYBRID_POLL_US);
+    while (_sq._head.load(std::memory_order_relaxed) != _sq._tail) {
+        if (completion_queue_not_empty()) {
+            trace_nvme_cq_woken(_driver_id, _id, true);
+            return;
+        }
+        if (osv::clock::uptime::now() > deadline) {
+            break;
+        }
+        barrier();
+    }
+#endif
     sched::thread::wait_until([this] {
         bool have_elements = this->completion_queue_not_empty();
         if (!have_elements) {
@@ -127,7 +154,7 @@ void queue_pair::wait_for_completion_queue_entries()
     });
 }
 
-void queue_pair::map_prps(nvme_sq_entry_t* cmd, struct bio* bio, u64 datasize)
+void queue_pair::map_prps(nvme_sq_entry_t* cmd, struct bio* bio, u64 datasize, u64* prp_list)
 {
     void* data = (void*)mmu::virt_to_phys(bio->bio_data);
     bio->bio_private = nullptr;
@@ -152,17 +179,11 @@ void queue_pair::map_prps(nvme_sq_entry_t* cmd, struct bio* bio, u64 datasize)
     if (num_of_pages == 2) {
         cmd->rw.common.prp2 = first_page_start + NVME_PAGESIZE; //2nd page start
     } else if (num_of_pages > 2) {
-        // Allocate PRP list as the request is larger than 8K
+        // The request is larger than 8K so it needs a PRP list, supplied
+        // by the caller (which could obtain it with preemption enabled).
         // For now we can only accomodate datasize <= 2MB so single page
         // should be exactly enough to map up to 512 pages of the request data
         assert(num_of_pages / 512 == 0);
-        u64* prp_list = nullptr;
-        _free_prp_lists.pop(prp_list);
-        if (!prp_list) { // No free pre-allocated ones, so allocate new one
-            prp_list = (u64*) alloc_page();
-            trace_nvme_prp_alloc(_driver_id, _id, prp_list);
-        }
-
         assert(prp_list != nullptr);
         cmd->rw.common.prp2 = mmu::virt_to_phys(prp_list);
 
@@ -228,7 +249,8 @@ io_queue_pair::io_queue_pair(
     pci::device& dev,
     u32* sq_doorbell,
     u32* cq_doorbell,
-    std::map<u32, nvme_ns_t*>& ns
+    std::map<u32, nvme_ns_t*>& ns,
+    bool cpu_private
     ) : queue_pair(
         driver_id,
         id,
@@ -237,7 +259,8 @@ io_queue_pair::io_queue_pair(
         sq_doorbell,
         cq_doorbell,
         ns
-    )
+    ),
+    _cpu_private(cpu_private)
 {
     init_pending_bios(0);
 }
@@ -259,25 +282,20 @@ void io_queue_pair::init_pending_bios(u32 level)
     }
 }
 
-int io_queue_pair::make_request(struct bio* bio, u32 nsid = 1)
+io_queue_pair::submit_status
+io_queue_pair::try_submit_request(struct bio* bio, u32 nsid,
+    u64* spare_prp, bool &used_spare, u32 &level_to_alloc)
 {
-    u64 slba = bio->bio_offset;
-    u32 nlb = bio->bio_bcount; //do the blockshift in nvme_driver
-
-    SCOPE_LOCK(_lock);
     if (_sq_full) {
-        //Wait for free entries
-        _sq_full_waiter.reset(*sched::thread::current());
-        trace_nvme_sq_full_wait(_driver_id, _id, _sq._tail, _sq._head);
-        sched::thread::wait_until([this] { return !(this->_sq_full); });
-        _sq_full_waiter.clear();
+        return submit_status::SQ_FULL;
     }
     assert((((_sq._tail + 1) % _qsize) != _sq._head));
     //
     // We need to check if there is an outstanding command that uses
     // _sq._tail as command id.
     // This happens if:
-    // 1. The SQ is full. Then we just have to wait for an open slot (see above)
+    // 1. The SQ is full. Then we just have to wait for an open slot
+    //    (see make_request())
     // 2. The Controller already read a SQE but didnt post a CQE yet.
     //    This means we could post the command but need a different cid. To still
     //    use the cid as index to find the corresponding bios we use a matrix
@@ -288,39 +306,162 @@ int io_queue_pair::make_request(struct bio* bio, u32 nsid = 1)
         cid += _qsize;
         auto level = cid_to_row(cid);
         assert(level < max_pending_levels);
-        // Allocate next row of _pending_bios if needed
-        if (!_pending_bios[cid_to_row(cid)]) {
-            init_pending_bios(level);
+        // The next row of _pending_bios has to be allocated by the caller
+        // with preemption enabled - malloc() may sleep
+        if (!_pending_bios[level]) {
+            level_to_alloc = level;
+            return submit_status::NEED_PENDING_LEVEL;
+        }
+    }
+    //
+    // Requests spanning more than two 4K pages need a PRP list page; grab
+    // one here (we are the only consumer of _free_prp_lists) or ask the
+    // caller to allocate one with preemption enabled and retry
+    u64* prp_list = nullptr;
+    if (bio->bio_cmd == BIO_READ || bio->bio_cmd == BIO_WRITE) {
+        u64 datasize = bio->bio_bcount << _ns[nsid]->blockshift;
+        u64 addr = (u64) mmu::virt_to_phys(bio->bio_data);
+        if (align_up(addr + datasize, (u64)NVME_PAGESIZE) -
+            align_down(addr, (u64)NVME_PAGESIZE) > 2 * NVME_PAGESIZE) {
+            _free_prp_lists.pop(prp_list);
+            if (!prp_list) {
+                if (!spare_prp) {
+                    return submit_status::NEED_PRP_PAGE;
+                }
+                prp_list = spare_prp;
+                used_spare = true;
+            }
+        }
+    } else if (bio->bio_cmd == BIO_DELETE) {
+        // The deallocate range list is a data buffer of its own; it lives
+        // in a page drawn from the PRP list pool and is recycled into it
+        // by req_done() like any other PRP page
+        _free_prp_lists.pop(prp_list);
+        if (!prp_list) {
+            if (!spare_prp) {
+                return submit_status::NEED_PRP_PAGE;
+            }
+            prp_list = spare_prp;
+            used_spare = true;
         }
     }
     //Save bio
     _pending_bios[cid_to_row(cid)][cid_to_col(cid)] = bio;
 
+    u64 slba = bio->bio_offset;
+    u32 nlb = bio->bio_bcount; //do the blockshift in nvme_driver
+
     switch (bio->bio_cmd) {
     case BIO_READ:
         trace_nvme_read_write_cmd_submit(_driver_id, _id, cid, bio, slba, nlb, false);
-        submit_read_write_cmd(cid, nsid, NVME_CMD_READ, slba, nlb, bio);
+        submit_read_write_cmd(cid, nsid, NVME_CMD_READ, slba, nlb, bio, prp_list);
         break;
 
     case BIO_WRITE:
         trace_nvme_read_write_cmd_submit(_driver_id, _id, cid, bio, slba, nlb, true);
-        submit_read_write_cmd(cid, nsid, NVME_CMD_WRITE, slba, nlb, bio);
+        submit_read_write_cmd(cid, nsid, NVME_CMD_WRITE, slba, nlb, bio, prp_list);
         break;
 
     case BIO_FLUSH:
         submit_flush_cmd(cid, nsid);
         break;
 
+    case BIO_DELETE:
+        submit_dsm_deallocate_cmd(cid, nsid, slba, nlb, bio, prp_list);
+        break;
+
+    case BIO_ZERO:
+        submit_write_zeroes_cmd(cid, nsid, slba, nlb, bio);
+        break;
+    }
+    return submit_status::OK;
+}
+
+int io_queue_pair::make_request(struct bio* bio, u32 nsid = 1)
+{
+    switch (bio->bio_cmd) {
+    case BIO_READ:
+    case BIO_WRITE:
+    case BIO_FLUSH:
+    case BIO_DELETE:
+    case BIO_ZERO:
+        break;
     default:
         NVME_ERROR("Operation not implemented\n");
         return ENOTBLK;
     }
+
+    u64* spare_prp = nullptr;
+    bool used_spare = false;
+    u32 level_to_alloc = 0;
+    submit_status st;
+
+    // Fast path for a CPU-private queue: all submitters run on the owning
+    // CPU (the driver holds the migration lock across make_request()), so
+    // disabling preemption is all the mutual exclusion the SQ needs - no
+    // lock acquisition or atomic read-modify-write on this path, akin to
+    // osv::xmitter's per-CPU tx queues. Anything that may sleep is done
+    // outside the preemption-disabled region and the submission retried.
+    if (_cpu_private) {
+        for (;;) {
+            WITH_LOCK(preempt_lock) {
+                st = try_submit_request(bio, nsid, spare_prp, used_spare,
+                        level_to_alloc);
+            }
+            if (st == submit_status::NEED_PRP_PAGE) {
+                spare_prp = (u64*) alloc_page();
+                trace_nvme_prp_alloc(_driver_id, _id, spare_prp);
+                continue;
+            }
+            break;
+        }
+    } else {
+        st = submit_status::SQ_FULL; //take the locked slow path below
+    }
+
+    if (st != submit_status::OK) {
+        // Slow path: the queue is shared, the SQ is full, or a
+        // _pending_bios row is missing. _lock serializes the waiters and
+        // the allocations; the actual submission still runs under
+        // preempt_lock so it cannot interleave with a fast-path submitter
+        // on the owning CPU.
+        SCOPE_LOCK(_lock);
+        for (;;) {
+            WITH_LOCK(preempt_lock) {
+                st = try_submit_request(bio, nsid, spare_prp, used_spare,
+                        level_to_alloc);
+            }
+            if (st == submit_status::OK) {
+                break;
+            }
+            if (st == submit_status::NEED_PENDING_LEVEL) {
+                init_pending_bios(level_to_alloc);
+            } else if (st == submit_status::NEED_PRP_PAGE) {
+                spare_prp = (u64*) alloc_page();
+                trace_nvme_prp_alloc(_driver_id, _id, spare_prp);
+            } else { // SQ_FULL - wait for free entries
+                _sq_full_waiter.reset(*sched::thread::current());
+                trace_nvme_sq_full_wait(_driver_id, _id, _sq._tail, _sq._head);
+                sched::thread::wait_until([this] { return !(this->_sq_full); });
+                _sq_full_waiter.clear();
+            }
+        }
+    }
+
+    if (spare_prp && !used_spare) {
+        free_page(spare_prp);
+    }
     return 0;
 }
 
 void io_queue_pair::req_done()
 {
     nvme_cq_entry_t* cqep = nullptr;
+    // Bios completed in the current drain pass; they are delivered in one
+    // batch after the CQ doorbell has been rung once for the whole pass,
+    // so the woken submitters do not preempt us mid-drain.
+    std::vector<std::pair<struct bio*, bool>> completed;
+    completed.reserve(_qsize);
     while (true)
     {
         wait_for_completion_queue_entries();
@@ -329,7 +470,6 @@ void io_queue_pair::req_done()
             // and release the CQ slot
             nvme_cq_entry_t cqe = *cqep;
             advance_cq_head();
-            mmio_setl(_cq._doorbell, _cq._head);
             //
             // Wake up the requesting thread in case the submission queue was full before
             auto old_sq_head = _sq._head.exchange(cqe.sqhd); //update sq_head
@@ -353,23 +493,33 @@ void io_queue_pair::req_done()
                    trace_nvme_prp_free(_driver_id, _id, pending_bio->bio_private);
                 }
             }
-            // Call biodone
+            // Queue for batched biodone below
             if (cqe.sct != 0 || cqe.sc != 0) {
                 trace_nvme_req_done_error(_driver_id, _id, cid, cqe.sct, cqe.sc, pending_bio);
-                biodone(pending_bio, false);
+                completed.emplace_back(pending_bio, false);
                 NVME_ERROR("I/O queue: cid=%d, sct=%#x, sc=%#x, bio=%#x, slba=%llu, nlb=%llu\n",
                     cqe.cid, cqe.sct, cqe.sc, pending_bio,
                     pending_bio ? pending_bio->bio_offset : 0,
                     pending_bio ? pending_bio->bio_bcount : 0);
             } else {
                 trace_nvme_req_done_success(_driver_id, _id, cid, pending_bio);
-                biodone(pending_bio, true);
+                completed.emplace_back(pending_bio, true);
             }
         }
+        // Release all the CQ slots drained above with a single doorbell
+        // write instead of one per entry
+        mmio_setl(_cq._doorbell, _cq._head);
+
+        // Deliver the batch of completions
+        for (auto& c : completed) {
+            biodone(c.first, c.second);
+        }
+        completed.clear();
     }
 }
 
-u16 io_queue_pair::submit_read_write_cmd(u16 cid, u32 nsid, int opc, u64 slba, u32 nlb, struct bio* bio)
+u16 io_queue_pair::submit_read_write_cmd(u16 cid, u32 nsid, int opc, u64 slba, u32 nlb,
+    struct bio* bio, u64* prp_list)
 {
     nvme_sq_entry_t cmd;
     memset(&cmd, 0, sizeof(cmd));
@@ -381,9 +531,11 @@ u16 io_queue_pair::submit_read_write_cmd(u16 cid, u32 nsid, int opc, u64 slba, u
     cmd.rw.nlb = nlb - 1;
 
     u32 datasize = nlb << _ns[nsid]->blockshift;
-    map_prps(&cmd, bio, datasize);
+    map_prps(&cmd, bio, datasize, prp_list);
 
-    return submit_cmd(&cmd);
+    // Bios flagged BIO_MORE are part of a chain submitted with
+    // bio_list_strategy(); defer the SQ doorbell to the chain's last bio.
+    return submit_cmd(&cmd, !(bio->bio_flags & BIO_MORE));
 }
 
 u16 io_queue_pair::submit_flush_cmd(u16 cid, u32 nsid)
@@ -398,6 +550,49 @@ u16 io_queue_pair::submit_flush_cmd(u16 cid, u32 nsid)
     return submit_cmd(&cmd);
 }
 
+u16 io_queue_pair::submit_dsm_deallocate_cmd(u16 cid, u32 nsid, u64 slba, u32 nlb,
+    struct bio* bio, u64* range_page)
+{
+    // A single range entry covers any bio we can be handed (nlb is
+    // 32-bit), so the range list degenerates to one 16-byte descriptor
+    // at the start of the page. The page rides in bio_private so
+    // req_done() recycles it into _free_prp_lists on completion.
+    auto range = (nvme_dsm_range_t*) range_page;
+    memset(range, 0, sizeof(*range));
+    range->nlb = nlb;
+    range->slba = slba;
+    bio->bio_private = range_page;
+
+    nvme_sq_entry_t cmd;
+    memset(&cmd, 0, sizeof(cmd));
+
+    cmd.dsm.common.opc = NVME_CMD_DS_MGMT;
+    cmd.dsm.common.nsid = nsid;
+    cmd.dsm.common.cid = cid;
+    cmd.dsm.common.prp1 = (u64) mmu::virt_to_phys(range_page);
+    cmd.dsm.nr = 0; // number of ranges is 0-based
+    cmd.dsm.ad = 1; // deallocate
+
+    return submit_cmd(&cmd, !(bio->bio_flags & BIO_MORE));
+}
+
+u16 io_queue_pair::submit_write_zeroes_cmd(u16 cid, u32 nsid, u64 slba, u32 nlb,
+    struct bio* bio)
+{
+    nvme_sq_entry_t cmd;
+    memset(&cmd, 0, sizeof(cmd));
+
+    cmd.write_zeroes.common.opc = NVME_CMD_WRITE_ZEROES;
+    cmd.write_zeroes.common.nsid = nsid;
+    cmd.write_zeroes.common.cid = cid;
+    cmd.write_zeroes.slba = slba;
+    // 0-based; multiplex_strategy() splits bios at max_io_size, which
+    // keeps nlb well within the command's 16-bit limit
+    cmd.write_zeroes.nlb = nlb - 1;
+
+    return submit_cmd(&cmd, !(bio->bio_flags & BIO_MORE));
+}
+
 admin_queue_pair::admin_queue_pair(
     int driver_id,
     int id,
@@ -26,6 +26,13 @@
 #define NVME_PAGESIZE  mmu::page_size
 #define NVME_PAGESHIFT 12
 
+// Hybrid polling: while commands are outstanding, the completion thread
+// spins for up to this many microseconds before arming the queue's
+// interrupt - on local NVMe a 4K read completes in a few microseconds
+// and the interrupt costs more than the read. 0 disables polling and
+// always arms the interrupt right away.
+#define NVME_HYBRID_POLL_US 10
+
 namespace nvme {
 
 // Template to specify common elements of the submission and completion
@@ -93,9 +100,11 @@ protected:
     // PRP stands for Physical Region Page and is used to specify locations in
     // physical memory for data tranfers. In essence, they are arrays of physical
     // addresses of pages to read from or write to data.
-    void map_prps(nvme_sq_entry_t* cmd, struct bio* bio, u64 datasize);
+    // The prp_list page, if the request needs one, is supplied by the caller
+    // so this can run with preemption disabled (see try_submit_request()).
+    void map_prps(nvme_sq_entry_t* cmd, struct bio* bio, u64 datasize, u64* prp_list);
 
-    u16 submit_cmd(nvme_sq_entry_t* cmd);
+    u16 submit_cmd(nvme_sq_entry_t* cmd, bool ring_doorbell = true);
 
     nvme_cq_entry_t* get_completion_queue_entry();
 
@@ -137,20 +146,46 @@ public:
         pci::device& dev,
         u32* sq_doorbell,
         u32* cq_doorbell,
-        std::map<u32, nvme_ns_t*>& ns
+        std::map<u32, nvme_ns_t*>& ns,
+        bool cpu_private = false
     );
     ~io_queue_pair();
 
     int make_request(struct bio* bio, u32 nsid);
     void req_done();
 private:
+    enum class submit_status {
+        OK,                 // command is in the SQ
+        SQ_FULL,            // no SQ slot free, wait for a completion
+        NEED_PENDING_LEVEL, // a _pending_bios row must be allocated first
+        NEED_PRP_PAGE,      // a PRP list page must be allocated first
+    };
+
     void init_pending_bios(u32 level);
 
+    // Submit bio if an SQ slot and a free cid are at hand. Runs with
+    // preemption disabled, so anything that may sleep (allocating a PRP
+    // list page or a _pending_bios row) is reported back to the caller
+    // to be done with preemption enabled, and retried.
+    submit_status try_submit_request(struct bio* bio, u32 nsid,
+        u64* spare_prp, bool &used_spare, u32 &level_to_alloc);
+
     inline u16 cid_to_row(u16 cid) { return cid / _qsize; }
     inline u16 cid_to_col(u16 cid) { return cid % _qsize; }
 
-    u16 submit_read_write_cmd(u16 cid, u32 nsid, int opc, u64 slba, u32 nlb, struct bio* bio);
+    u16 submit_read_write_cmd(u16 cid, u32 nsid, int opc, u64 slba, u32 nlb,
+        struct bio* bio, u64* prp_list);
     u16 submit_flush_cmd(u16 cid, u32 nsid);
+    u16 submit_dsm_deallocate_cmd(u16 cid, u32 nsid, u64 slba, u32 nlb,
+        struct bio* bio, u64* range_page);
+    u16 submit_write_zeroes_cmd(u16 cid, u32 nsid, u64 slba, u32 nlb,
+        struct bio* bio);
+
+    // A CPU-private queue is only submitted to from its owning CPU (the
+    // driver routes by CPU id under the migration lock), so the
+    // submission fast path needs no lock - disabling preemption is
+    // mutual exclusion enough, like osv::xmitter's per-CPU tx queues.
+    bool _cpu_private;
 
     sched::thread_handle _sq_full_waiter;
 
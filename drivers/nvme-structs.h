@@ -64,9 +64,18 @@ enum {
     NVME_CMD_READ           = 0x2,      ///< read
     NVME_CMD_WRITE_UNCOR    = 0x4,      ///< write uncorrectable
     NVME_CMD_COMPARE        = 0x5,      ///< compare
+    NVME_CMD_WRITE_ZEROES   = 0x8,      ///< write zeroes
     NVME_CMD_DS_MGMT        = 0x9,      ///< dataset management
 };
 
+/// Optional NVM command support (ONCS) flags in identify controller data
+enum {
+    NVME_ONCS_COMPARE       = 1 << 0,   ///< compare
+    NVME_ONCS_WRITE_UNCOR   = 1 << 1,   ///< write uncorrectable
+    NVME_ONCS_DS_MGMT       = 1 << 2,   ///< dataset management
+    NVME_ONCS_WRITE_ZEROES  = 1 << 3,   ///< write zeroes
+};
+
 /// NVMe admin command op code
 enum {
     NVME_ACMD_DELETE_SQ     = 0x0,      ///< delete io submission queue
@@ -293,6 +302,44 @@ typedef struct _nvme_command_rw {
 
 static_assert(sizeof(nvme_command_rw_t)==64);
 
+/// NVMe command:  Dataset Management
+typedef struct _nvme_command_dsm {
+    nvme_command_common_t   common;     ///< common cdw 0
+    u32                     nr : 8;     ///< number of ranges, 0-based (cdw 10)
+    u32                     rsvd10 : 24; ///< reserved (in cdw 10)
+    u32                     idr : 1;    ///< integral dataset for read (cdw 11)
+    u32                     idw : 1;    ///< integral dataset for write
+    u32                     ad : 1;     ///< attribute - deallocate
+    u32                     rsvd11 : 29; ///< reserved (in cdw 11)
+    u32                     cdw12_15[4]; ///< reserved (cdw 12-15)
+} nvme_command_dsm_t;
+
+static_assert(sizeof(nvme_command_dsm_t)==64);
+
+/// Dataset Management range list entry, prp1 points to an array of these
+typedef struct _nvme_dsm_range {
+    u32                     cattr;      ///< context attributes
+    u32                     nlb;        ///< number of logical blocks
+    u64                     slba;       ///< starting LBA
+} nvme_dsm_range_t;
+
+static_assert(sizeof(nvme_dsm_range_t)==16);
+
+/// NVMe command:  Write Zeroes
+typedef struct _nvme_command_write_zeroes {
+    nvme_command_common_t   common;     ///< common cdw 0
+    u64                     slba;       ///< starting LBA (cdw 10)
+    u16                     nlb;        ///< number of logical blocks, 0-based
+    u16                     rsvd12 : 9; ///< reserved (in cdw 12)
+    u16                     deac : 1;   ///< deallocate
+    u16                     prinfo : 4; ///< protection information field
+    u16                     fua : 1;    ///< force unit access
+    u16                     lr  : 1;    ///< limited retry
+    u32                     cdw13_15[3]; ///< reserved (cdw 13-15)
+} nvme_command_write_zeroes_t;
+
+static_assert(sizeof(nvme_command_write_zeroes_t)==64);
+
 /// Admin and NVM Vendor Specific Command
 typedef struct _nvme_command_vs {
     nvme_command_common_t   common;     ///< common cdw 0
@@ -586,6 +633,8 @@ typedef struct _nvme_acmd_set_features {
 /// Submission queue entry
 typedef union _nvme_sq_entry {
     nvme_command_rw_t       rw;         ///< read/write command
+    nvme_command_dsm_t      dsm;        ///< dataset management command
+    nvme_command_write_zeroes_t write_zeroes; ///< write zeroes command
     nvme_command_vs_t       vs;         ///< admin and vendor specific command
 
     nvme_acmd_abort_t       abort;      ///< admin abort command
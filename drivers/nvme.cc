@@ -21,6 +21,7 @@
 #include <osv/debug.h>
 
 #include <osv/sched.hh>
+#include <osv/migration-lock.hh>
 #include <osv/trace.hh>
 #include <osv/aligned_new.hh>
 
@@ -341,8 +342,11 @@ int driver::create_io_queue(int qid, int qsize, sched::cpu* cpu, int qprio)
     u32* cq_doorbell = (u32*) ((u64) sq_doorbell + _doorbell_stride);
 
     // create queue pair with allocated SQ and CQ ring buffers
+    // A queue dedicated to a single CPU may use the lock-free submission
+    // fast path - see io_queue_pair::make_request()
     auto queue = std::unique_ptr<io_queue_pair, aligned_new_deleter<io_queue_pair>>(
-        aligned_new<io_queue_pair>(_id, iv, qsize, _dev, sq_doorbell, cq_doorbell, _ns_data));
+        aligned_new<io_queue_pair>(_id, iv, qsize, _dev, sq_doorbell, cq_doorbell, _ns_data,
+            cpu != nullptr));
 
     // create completion queue command
     nvme_acmd_create_cq_t cmd_cq;
@@ -430,6 +434,20 @@ int driver::make_request(bio* bio, u32 nsid)
         return 0;
     }
 
+    // Deallocate (TRIM) and write zeroes are optional commands - fail the
+    // bio if this controller does not implement them
+    if ((bio->bio_cmd == BIO_DELETE && !(_identify_controller->oncs & NVME_ONCS_DS_MGMT)) ||
+        (bio->bio_cmd == BIO_ZERO && !(_identify_controller->oncs & NVME_ONCS_WRITE_ZEROES))) {
+        NVME_ERROR("nvme%d: optional command %#x not supported by controller, oncs=%#x\n",
+            _id, bio->bio_cmd, _identify_controller->oncs);
+        biodone(bio, false);
+        return ENOTSUP;
+    }
+
+    // Pin the thread to its current CPU for the duration of the
+    // submission - a CPU-private queue relies on all its submitters
+    // staying on the owning CPU (see io_queue_pair::make_request())
+    SCOPE_LOCK(migration_lock);
     unsigned int qidx = sched::current_cpu->id % _io_queues.size();
     return _io_queues[qidx]->make_request(bio, nsid);
 }
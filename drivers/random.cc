@@ -34,6 +34,7 @@
  */
 
 #include "drivers/random.hh"
+#include <osv/fast-random.hh>
 #include <assert.h>
 
 #include <osv/device.h>
@@ -205,6 +206,9 @@ random_device::~random_device()
 void randomdev_init()
 {
     new random_device();
+    // Seed the per-CPU fast pools that serve getrandom() now that the
+    // adaptor can produce output
+    fast_random_init();
     debugf("random: <%s> initialized\n", random_adaptor->ident);
 }
 
@@ -0,0 +1,170 @@
+/*
+ * Copyright (C) 2026 Waldemar Kozaczuk
+ *
+ * This work is open source software, licensed under the terms of the
+ * BSD license as described in the LICENSE file in the top-level directory.
+ */
+
+#include "clock-common.hh"
+#include "cpuid.hh"
+#include "processor.hh"
+#include "rtc.hh"
+#include <osv/prio.hh>
+#include <osv/sched.hh>
+#include <osv/debug.hh>
+#include <osv/types.h>
+#include <osv/workqueue.hh>
+#include <atomic>
+#include <chrono>
+
+// Direct invariant-TSC clock, used when the hypervisor provides no usable
+// paravirtual clock - notably Cloud Hypervisor and Firecracker guests.
+// Those otherwise fall back to the HPET (an mmio vmexit per read) or fail
+// to find a clock at all, while with a nonstop TSC a time read is a single
+// rdtsc plus one multiply.
+//
+// The TSC frequency is taken from CPUID when the hypervisor reports it and
+// measured against the PIT otherwise, and the wall-clock base comes from
+// the RTC. Since nothing ever adjusts a raw TSC, a maintenance thread
+// periodically cross-checks the derived wall clock against the RTC and
+// steps the base when they clearly disagree (calibration drift, host
+// suspend/resume, host clock adjustments).
+class tscclock : public pv_based_clock {
+public:
+    tscclock(u64 tsc_hz);
+    static bool probe();
+    static u64 calibrate();
+    virtual u64 processor_to_nano(u64 ticks) override __attribute__((no_instrument_function));
+protected:
+    virtual u64 wall_clock_boot() override;
+    virtual u64 system_time() override;
+private:
+    // nanoseconds = (ticks * _mult) >> mult_shift. A shift of 26 keeps
+    // _mult well within 64 bits for any plausible TSC frequency; the
+    // product is computed in 128 bits so ticks may span centuries.
+    static constexpr unsigned mult_shift = 26;
+    u64 to_nano(u64 ticks) const __attribute__((no_instrument_function)) {
+        return (u64)(((unsigned __int128)ticks * _mult) >> mult_shift);
+    }
+    void validate_wall_clock();
+    void schedule_wall_clock_check();
+
+    u64 _hz;
+    u64 _mult;
+    u64 _tsc0;
+    std::atomic<s64> _wall; // RTC wall-clock time paired with _tsc0
+    rtc _rtc;
+};
+
+tscclock::tscclock(u64 tsc_hz)
+    : _hz(tsc_hz)
+    , _mult(((u64)1000000000 << mult_shift) / tsc_hz)
+{
+    _tsc0 = processor::rdtsc();
+    _wall.store(_rtc.wallclock_ns(), std::memory_order_relaxed);
+
+    debugf("tscclock: using invariant TSC at %lu Hz\n", _hz);
+
+    schedule_wall_clock_check();
+}
+
+void tscclock::schedule_wall_clock_check()
+{
+    workqueue::queue_after(workqueue::prio::normal, std::chrono::seconds(10),
+        [this] {
+            validate_wall_clock();
+            schedule_wall_clock_check();
+        });
+}
+
+bool tscclock::probe()
+{
+    if (clock::get()) {
+        // A paravirtual clock is registered; it tracks the host time and
+        // is always preferred.
+        return false;
+    }
+    return processor::features().invariant_tsc;
+}
+
+// Determine the TSC frequency, in Hz. Returns 0 when no source works.
+u64 tscclock::calibrate()
+{
+    // CPUID leaf 0x15: TSC / crystal-clock ratio
+    if (processor::cpuid(0).a >= 0x15) {
+        auto l = processor::cpuid(0x15);
+        if (l.a && l.b && l.c) {
+            return (u64)l.c * l.b / l.a;
+        }
+    }
+
+    // Hypervisor frequency leaf (VMware-compatible, also filled in by
+    // Cloud Hypervisor and Firecracker): eax is the TSC frequency in kHz
+    if (processor::cpuid(1).c & (1u << 31)) {
+        auto base = processor::cpuid(0x40000000);
+        if (base.a >= 0x40000010) {
+            auto l = processor::cpuid(0x40000010);
+            if (l.a) {
+                return (u64)l.a * 1000;
+            }
+        }
+    }
+
+    // Measure against the PIT: run channel 2 in one-shot mode for 50ms
+    // and count how far the TSC moves
+    constexpr u32 pit_hz = 1193182;
+    constexpr u32 divisor = 20;
+    u8 gate = processor::inb(0x61);
+    processor::outb((gate & ~0x02) | 0x01, 0x61); // gate on, speaker off
+    processor::outb(0xb0, 0x43); // channel 2, lobyte/hibyte, mode 0
+    u16 latch = pit_hz / divisor;
+    processor::outb(latch & 0xff, 0x42);
+    processor::outb(latch >> 8, 0x42);
+    u64 t0 = processor::rdtsc();
+    while (!(processor::inb(0x61) & 0x20)) {
+        // wait for the counter to run down
+    }
+    u64 t1 = processor::rdtsc();
+    processor::outb(gate, 0x61);
+    return (t1 - t0) * divisor;
+}
+
+u64 tscclock::wall_clock_boot()
+{
+    return _wall.load(std::memory_order_relaxed);
+}
+
+u64 tscclock::system_time()
+{
+    return to_nano(processor::rdtsc() - _tsc0);
+}
+
+u64 tscclock::processor_to_nano(u64 ticks)
+{
+    return to_nano(ticks);
+}
+
+void tscclock::validate_wall_clock()
+{
+    // The RTC only has second resolution, so only step the base once the
+    // TSC-derived wall clock has clearly walked away from it.
+    constexpr s64 max_drift = 2000000000; // 2s
+    s64 rtc_now = _rtc.wallclock_ns();
+    s64 tsc_now = _wall.load(std::memory_order_relaxed) + system_time();
+    s64 delta = rtc_now - tsc_now;
+    if (delta > max_drift || delta < -max_drift) {
+        _wall.fetch_add(delta, std::memory_order_relaxed);
+        debugf("tscclock: stepped wall clock by %ld ns to match the RTC\n",
+               delta);
+    }
+}
+
+static __attribute__((constructor(init_prio::tscclock))) void setup_tscclock()
+{
+    if (tscclock::probe()) {
+        auto hz = tscclock::calibrate();
+        if (hz) {
+            clock::register_clock(new tscclock(hz));
+        }
+    }
+}
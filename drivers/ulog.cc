@@ -0,0 +1,169 @@
+/*
+ * Copyright (C) 2026 Waldemar Kozaczuk
+ *
+ * This work is open source software, licensed under the terms of the
+ * BSD license as described in the LICENSE file in the top-level directory.
+ */
+
+/*
+ * /dev/ulog - the kernel side of the log transport ring described in
+ * <osv/ulog.h>.
+ *
+ * The ring and its drain thread are created lazily on the first open(),
+ * so guests that never log through it pay nothing. The ring lives in
+ * physically contiguous memory so that mmap() of the device node can
+ * map it into the application with the plain devops mmap hook; the
+ * drain thread pops committed records and ships them to the host
+ * through the console channel, which is the byte pipe every hypervisor
+ * configuration already provides. Under backpressure producers drop and
+ * count instead of blocking - see ULOG_GET_DROPPED.
+ */
+
+#include <osv/ulog.h>
+#include <osv/device.h>
+#include <osv/uio.h>
+#include <osv/mutex.h>
+#include <osv/condvar.h>
+#include <osv/sched.hh>
+#include <osv/clock.hh>
+#include <osv/contiguous_alloc.hh>
+#include <osv/mmu.hh>
+
+#include "drivers/console.hh"
+#include "drivers/ulog.hh"
+
+#include <memory>
+
+namespace ulogdev {
+
+// 1MB of data area (must stay a power of two), plus the header page
+constexpr size_t data_size = 1 << 20;
+
+static mutex lock;
+static struct ulog_ring_hdr *ring_hdr;
+static char *ring_data;
+static condvar kick;
+static std::unique_ptr<sched::thread> drain_thread;
+
+static void drain()
+{
+    std::unique_ptr<char[]> buf(new char[ULOG_MAX_RECORD]);
+    sched::timer tmr(*sched::thread::current());
+
+    for (;;) {
+        size_t n;
+        while ((n = ulog_ring_pop(ring_hdr, ring_data, buf.get(),
+                                  ULOG_MAX_RECORD)) != 0) {
+            console::write(buf.get(), n);
+        }
+        WITH_LOCK(lock) {
+            // poll the ring every 10ms; a kick (ioctl or kernel-side
+            // write) cuts the latency when somebody cares
+            tmr.set(osv::clock::uptime::now() + std::chrono::milliseconds(10));
+            kick.wait(lock, &tmr);
+            if (!tmr.expired()) {
+                tmr.cancel();
+            }
+        }
+    }
+}
+
+static int
+ulog_open(struct device *dev, int mode)
+{
+    WITH_LOCK(lock) {
+        if (ring_hdr) {
+            return 0;
+        }
+        auto mem = memory::alloc_phys_contiguous_aligned(
+            ULOG_DATA_OFF + data_size, mmu::page_size);
+        if (!mem) {
+            return ENOMEM;
+        }
+        memset(mem, 0, ULOG_DATA_OFF + data_size);
+        auto hdr = static_cast<struct ulog_ring_hdr *>(mem);
+        hdr->magic = ULOG_MAGIC;
+        hdr->data_size = data_size;
+        ring_data = static_cast<char *>(mem) + ULOG_DATA_OFF;
+        ring_hdr = hdr;
+        drain_thread.reset(sched::thread::make(drain,
+            sched::thread::attr().name("ulog-drain")));
+        drain_thread->start();
+    }
+    return 0;
+}
+
+static int
+ulog_write(struct device *dev, struct uio *uio, int ioflags)
+{
+    // Fallback for writers that do not map the ring: the whole buffer
+    // becomes one record, truncated to ULOG_MAX_RECORD. The transport
+    // is lossy by design, so a full ring counts a drop rather than
+    // failing the write.
+    auto len = std::min(uio->uio_resid, (long)ULOG_MAX_RECORD);
+    std::unique_ptr<char[]> tmp(new char[len]);
+
+    int error = uiomove(tmp.get(), len, uio);
+    if (error) {
+        return error;
+    }
+    uio->uio_resid = 0;
+
+    ulog_ring_append(ring_hdr, ring_data, tmp.get(), len);
+    WITH_LOCK(lock) {
+        kick.wake_one();
+    }
+    return 0;
+}
+
+static int
+ulog_ioctl(struct device *dev, u_long cmd, void *arg)
+{
+    switch (cmd) {
+    case ULOG_GET_SIZE:
+        *reinterpret_cast<uint64_t *>(arg) = ring_hdr->data_size;
+        return 0;
+    case ULOG_GET_DROPPED:
+        *reinterpret_cast<uint64_t *>(arg) =
+            __atomic_load_n(&ring_hdr->dropped, __ATOMIC_RELAXED);
+        return 0;
+    case ULOG_KICK:
+        WITH_LOCK(lock) {
+            kick.wake_one();
+        }
+        return 0;
+    default:
+        return EINVAL;
+    }
+}
+
+static int
+ulog_mmap(struct device *dev, uintptr_t *paddr, size_t *size)
+{
+    *paddr = mmu::virt_to_phys(ring_hdr);
+    *size = ULOG_DATA_OFF + ring_hdr->data_size;
+    return 0;
+}
+
+static struct devops ulog_device_devops {
+    ulog_open,
+    no_close,
+    no_read,
+    ulog_write,
+    ulog_ioctl,
+    no_devctl,
+    no_strategy,
+    ulog_mmap,
+};
+
+struct driver ulog_device_driver = {
+    "ulog",
+    &ulog_device_devops,
+};
+
+void ulogdev_init()
+{
+    device_create(&ulog_device_driver, "ulog", D_CHR);
+}
+
+}
@@ -0,0 +1,17 @@
+/*
+ * Copyright (C) 2026 Waldemar Kozaczuk
+ *
+ * This work is open source software, licensed under the terms of the
+ * BSD license as described in the LICENSE file in the top-level directory.
+ */
+
+#ifndef DRIVERS_ULOG_HH
+#define DRIVERS_ULOG_HH
+
+namespace ulogdev {
+
+void ulogdev_init();
+
+}
+
+#endif
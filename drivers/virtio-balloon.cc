@@ -0,0 +1,144 @@
+/*
+ * Copyright (C) 2026 Waldemar Kozaczuk
+ *
+ * This work is open source software, licensed under the terms of the
+ * BSD license as described in the LICENSE file in the top-level directory.
+ */
+
+#include "drivers/virtio-balloon.hh"
+
+#include <osv/debug.hh>
+#include <osv/mempool.hh>
+#include <osv/mmu.hh>
+#include <osv/pagealloc.hh>
+#include <osv/sched.hh>
+
+namespace virtio {
+
+// This driver only negotiates VIRTIO_BALLOON_F_REPORTING and leaves the
+// classic inflate/deflate protocol alone - OSv has no device-driven balloon
+// policy and the JVM balloon keeps its own accounting via jvm_balloon_api.
+// Reporting is guest initiated: the worker periodically borrows large runs
+// of free memory from the allocator, posts them to the reporting queue so
+// the host can drop their backing, and returns them to the free list once
+// the device is done. While a run is posted it is owned by this driver, so
+// the host zeroing it cannot race with a guest allocation.
+
+balloon::balloon(virtio_device& dev)
+    : virtio_driver(dev)
+{
+    setup_features();
+    probe_virt_queues();
+
+    if (!get_guest_feature_bit(VIRTIO_BALLOON_F_REPORTING)) {
+        add_dev_status(VIRTIO_CONFIG_S_DRIVER_OK);
+        debugf("virtio-balloon: host offers no free page reporting\n");
+        return;
+    }
+
+    interrupt_factory int_factory;
+    int_factory.create_pci_interrupt = [this](pci::device &pci_dev) {
+        return new pci_interrupt(
+            pci_dev,
+            [=] { return this->ack_irq(); },
+            [=] { this->handle_irq(); });
+    };
+    _dev.register_interrupt(int_factory);
+
+    // Queue 0 is inflate and queue 1 deflate; since we negotiate neither
+    // the stats nor the free page hint queue, reporting is queue 2
+    _queue = get_virt_queue(2);
+
+    add_dev_status(VIRTIO_CONFIG_S_DRIVER_OK);
+
+    _thread = sched::thread::make([&] { worker(); },
+        sched::thread::attr().name("virtio-balloon"));
+    _thread->start();
+}
+
+balloon::~balloon()
+{
+    //TODO: In theory maybe we should stop the worker thread but
+    //assuming the driver is never removed while OSv is running it
+    //should be fine
+}
+
+void balloon::handle_irq()
+{
+    if (_thread) {
+        _thread->wake_with_irq_disabled();
+    }
+}
+
+bool balloon::ack_irq()
+{
+    return _dev.read_and_ack_isr();
+}
+
+void balloon::worker()
+{
+    for (;;) {
+        sched::thread::sleep(std::chrono::seconds(5));
+        auto free = memory::stats::free();
+        if (free < _reserve + _min_report) {
+            continue;
+        }
+        // Skip the pass when free memory hardly moved since the last one -
+        // the ranges we would pick are most likely already unbacked
+        auto delta = free > _last_free ? free - _last_free : _last_free - free;
+        if (_last_free && delta < _min_report) {
+            continue;
+        }
+        report_free_pages(free - _reserve);
+        _last_free = memory::stats::free();
+    }
+}
+
+size_t balloon::report_free_pages(size_t target)
+{
+    size_t reported = 0;
+    while (reported < target) {
+        void* pages[_batch_size];
+        unsigned nr = 0;
+        _queue->init_sg();
+        while (nr < _batch_size &&
+               reported + nr * mmu::huge_page_size < target) {
+            auto page = memory::alloc_huge_page(mmu::huge_page_size);
+            if (!page) {
+                // Free memory got fragmented or scarce - stop borrowing
+                break;
+            }
+            pages[nr++] = page;
+            _queue->add_in_sg(page, mmu::huge_page_size);
+        }
+        if (!nr) {
+            break;
+        }
+        if (!_queue->add_buf(pages)) {
+            for (unsigned i = 0; i < nr; i++) {
+                memory::free_huge_page(pages[i], mmu::huge_page_size);
+            }
+            break;
+        }
+        _queue->kick();
+
+        wait_for_queue(_queue, &vring::used_ring_not_empty);
+
+        u32 len;
+        _queue->get_buf_elem(&len);
+        _queue->get_buf_finalize();
+
+        for (unsigned i = 0; i < nr; i++) {
+            memory::free_huge_page(pages[i], mmu::huge_page_size);
+        }
+        reported += nr * mmu::huge_page_size;
+    }
+    return reported;
+}
+
+hw_driver* balloon::probe(hw_device* dev)
+{
+    return virtio::probe<balloon, VIRTIO_ID_BALLOON>(dev);
+}
+
+}
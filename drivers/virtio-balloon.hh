@@ -0,0 +1,62 @@
+/*
+ * Copyright (C) 2026 Waldemar Kozaczuk
+ *
+ * This work is open source software, licensed under the terms of the
+ * BSD license as described in the LICENSE file in the top-level directory.
+ */
+
+#ifndef VIRTIO_BALLOON_DRIVER_H
+#define VIRTIO_BALLOON_DRIVER_H
+
+#include "drivers/virtio.hh"
+#include "drivers/device.hh"
+
+#include <memory>
+
+namespace virtio {
+
+enum {
+    VIRTIO_BALLOON_F_MUST_TELL_HOST = 0,
+    VIRTIO_BALLOON_F_STATS_VQ = 1,
+    VIRTIO_BALLOON_F_DEFLATE_ON_OOM = 2,
+    VIRTIO_BALLOON_F_FREE_PAGE_HINT = 3,
+    VIRTIO_BALLOON_F_PAGE_POISON = 4,
+    VIRTIO_BALLOON_F_REPORTING = 5,
+};
+
+class balloon : public virtio_driver {
+public:
+    explicit balloon(virtio_device& dev);
+    virtual ~balloon();
+
+    virtual std::string get_name() const { return "virtio-balloon"; }
+
+    virtual u64 get_driver_features() {
+        return virtio_driver::get_driver_features() |
+            (1ull << VIRTIO_BALLOON_F_REPORTING);
+    }
+
+    static hw_driver* probe(hw_device* dev);
+
+private:
+    void handle_irq();
+    bool ack_irq();
+    void worker();
+    size_t report_free_pages(size_t target);
+
+    // Free memory below this floor is never reported to the host
+    static const size_t _reserve = 64 << 20;
+    // A reporting pass is only worth its alloc/free churn when at least
+    // this much memory would be reported
+    static const size_t _min_report = 32 << 20;
+    // Huge pages posted to the reporting queue in one request
+    static const unsigned _batch_size = 16;
+
+    std::unique_ptr<sched::thread> _thread;
+    vring* _queue = nullptr;
+    size_t _last_free = 0;
+};
+
+}
+
+#endif
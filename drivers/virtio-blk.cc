@@ -17,9 +17,11 @@
 #include <osv/mempool.hh>
 #include <osv/mmu.hh>
 
+#include <algorithm>
 #include <string>
 #include <string.h>
 #include <map>
+#include <vector>
 #include <errno.h>
 #include <osv/debug.h>
 
@@ -37,6 +39,7 @@ TRACEPOINT(trace_virtio_blk_read_config_geometry, "cylinders=%u, heads=%u, secto
 TRACEPOINT(trace_virtio_blk_read_config_blk_size, "blk_size=%u", u32);
 TRACEPOINT(trace_virtio_blk_read_config_topology, "physical_block_exp=%u, alignment_offset=%u, min_io_size=%u, opt_io_size=%u", u32, u32, u32, u32);
 TRACEPOINT(trace_virtio_blk_read_config_wce, "wce=%u", u32);
+TRACEPOINT(trace_virtio_blk_read_config_num_queues, "num_queues=%u", u32);
 TRACEPOINT(trace_virtio_blk_read_config_ro, "readonly=true");
 TRACEPOINT(trace_virtio_blk_make_request_seg_max, "request of size %d needs more segment than the max %d", size_t, u32);
 TRACEPOINT(trace_virtio_blk_make_request_readonly, "write on readonly device");
@@ -103,10 +106,11 @@ struct driver blk_driver = {
 bool blk::ack_irq()
 {
     auto isr = _dev.read_and_ack_isr();
-    auto queue = get_virt_queue(0);
 
     if (isr) {
-        queue->disable_interrupts();
+        for (auto& q : _io_queues) {
+            q->vq->disable_interrupts();
+        }
         return true;
     } else {
         return false;
@@ -128,49 +132,87 @@ blk::blk(virtio_device& virtio_dev)
     // Step 7 - generic init of virtqueues
     probe_virt_queues();
 
-    //register the single irq callback for the block
-    sched::thread* t = sched::thread::make([this] { this->req_done(); },
-            sched::thread::attr().name("virtio-blk"));
-    t->start();
-    auto queue = get_virt_queue(0);
+    // With VIRTIO_BLK_F_MQ the device offers several request queues; take
+    // one per vCPU so each CPU submits to its own vring, and fall back to
+    // the single queue otherwise.
+    auto nqueues = std::max(1u,
+            std::min<unsigned>(_config.num_queues, sched::cpus.size()));
+    for (unsigned i = 0; i < nqueues; i++) {
+        auto vq = get_virt_queue(i);
+        if (!vq) {
+            break;
+        }
+        std::unique_ptr<io_queue> q(new io_queue);
+        q->vq = vq;
+        auto qp = q.get();
+        q->worker = sched::thread::make([this, qp] { this->req_done(*qp); },
+                sched::thread::attr().name("virtio-blk" + std::to_string(_id)
+                    + "-" + std::to_string(i)));
+        q->worker->start();
+        // Enable indirect descriptor
+        vq->set_use_indirect(true);
+        _io_queues.push_back(std::move(q));
+    }
 
     interrupt_factory int_factory;
 #if CONF_drivers_pci
-    int_factory.register_msi_bindings = [queue, t](interrupt_manager &msi) {
-        msi.easy_register( {{ 0, [=] { queue->disable_interrupts(); }, t }});
+    int_factory.register_msi_bindings = [this](interrupt_manager &msi) {
+        // One vector per queue, each routed - together with the queue's
+        // completion thread - to the cpu that submits to that queue, like
+        // multiqueue virtio-net does for its rx queues.
+        std::vector<msix_binding> bindings;
+        unsigned idx = 0;
+        for (auto& q : _io_queues) {
+            auto vq = q->vq;
+            bindings.emplace_back(idx, [vq] { vq->disable_interrupts(); },
+                    q->worker, sched::cpus[idx % sched::cpus.size()]);
+            idx++;
+        }
+        msi.easy_register(bindings);
     };
 
-    int_factory.create_pci_interrupt = [this,t](pci::device &pci_dev) {
+    int_factory.create_pci_interrupt = [this](pci::device &pci_dev) {
         return new pci_interrupt(
             pci_dev,
             [=] { return this->ack_irq(); },
-            [=] { t->wake_with_irq_disabled(); });
+            [this] {
+                for (auto& q : _io_queues) {
+                    q->worker->wake_with_irq_disabled();
+                }
+            });
     };
 #endif
 
 #ifdef __aarch64__
-    int_factory.create_spi_edge_interrupt = [this,t]() {
+    int_factory.create_spi_edge_interrupt = [this]() {
         return new spi_interrupt(
                 gic::irq_type::IRQ_TYPE_EDGE,
                 _dev.get_irq(),
                 [=] { return this->ack_irq(); },
-                [=] { t->wake_with_irq_disabled(); });
+                [this] {
+                    for (auto& q : _io_queues) {
+                        q->worker->wake_with_irq_disabled();
+                    }
+                });
     };
 #else
 #if CONF_drivers_mmio
-    int_factory.create_gsi_edge_interrupt = [this,t]() {
+    int_factory.create_gsi_edge_interrupt = [this]() {
         return new gsi_edge_interrupt(
                 _dev.get_irq(),
-                [=] { if (this->ack_irq()) t->wake_with_irq_disabled(); });
+                [this] {
+                    if (this->ack_irq()) {
+                        for (auto& q : _io_queues) {
+                            q->worker->wake_with_irq_disabled();
+                        }
+                    }
+                });
     };
 #endif
 #endif
 
     _dev.register_interrupt(int_factory);
 
-    // Enable indirect descriptor
-    queue->set_use_indirect(true);
-
     // Step 8
     add_dev_status(VIRTIO_CONFIG_S_DRIVER_OK);
 
@@ -187,7 +229,8 @@ blk::blk(virtio_device& virtio_dev)
     dev->max_io_size = _config.seg_max ? (_config.seg_max - 1) * mmu::page_size : UINT_MAX;
     read_partition_table(dev);
 
-    debugf("virtio-blk: Add blk device instances %d as %s, devsize=%lld\n", _id, dev_name.c_str(), dev->size);
+    debugf("virtio-blk: Add blk device instances %d as %s, devsize=%lld, queues=%d\n",
+           _id, dev_name.c_str(), dev->size, (int)_io_queues.size());
 }
 
 blk::~blk()
@@ -229,16 +272,27 @@ void blk::read_config()
     }
     if (get_guest_feature_bit(VIRTIO_BLK_F_CONFIG_WCE))
         trace_virtio_blk_read_config_wce((u32)_config.wce);
+    if (get_guest_feature_bit(VIRTIO_BLK_F_MQ)) {
+        READ_CONFIGURATION_FIELD(blk_config,num_queues,_config.num_queues)
+        trace_virtio_blk_read_config_num_queues((u32)_config.num_queues);
+    } else {
+        _config.num_queues = 1;
+    }
     if (get_guest_feature_bit(VIRTIO_BLK_F_RO)) {
         set_readonly();
         trace_virtio_blk_read_config_ro();
     }
 }
 
-void blk::req_done()
+void blk::req_done(io_queue& q)
 {
-    auto* queue = get_virt_queue(0);
+    auto* queue = q.vq;
     blk_req* req;
+    // Completed bios collected while draining the used ring; delivering
+    // them only after the whole ring has been drained keeps the woken
+    // submitters from preempting us in the middle of the drain.
+    std::vector<std::pair<struct bio*, bool>> completed;
+    completed.reserve(queue->size());
 
     while (1) {
 
@@ -251,15 +305,18 @@ void blk::req_done()
                 switch (req->res.status) {
                 case VIRTIO_BLK_S_OK:
                     trace_virtio_blk_req_ok(req->bio, req->hdr.sector, req->bio->bio_bcount, req->hdr.type);
-                    biodone(req->bio, true);
+                    completed.emplace_back(req->bio, true);
                     break;
                 case VIRTIO_BLK_S_UNSUPP:
                     trace_virtio_blk_req_unsupp(req->bio, req->hdr.sector, req->bio->bio_bcount, req->hdr.type);
-                    biodone(req->bio, false);
+                    completed.emplace_back(req->bio, false);
+                    // this thread is the only writer of this counter
+                    q.stats.errors++;
                     break;
                 default:
                     trace_virtio_blk_req_err(req->bio, req->hdr.sector, req->bio->bio_bcount, req->hdr.type);
-                    biodone(req->bio, false);
+                    completed.emplace_back(req->bio, false);
+                    q.stats.errors++;
                     break;
                }
             }
@@ -270,6 +327,12 @@ void blk::req_done()
 
         // wake up the requesting thread in case the ring was full before
         queue->wakeup_waiter();
+
+        // Deliver the batch of completions
+        for (auto& c : completed) {
+            biodone(c.first, c.second);
+        }
+        completed.clear();
     }
 }
 
@@ -282,10 +345,15 @@ int64_t blk::size()
 
 int blk::make_request(struct bio* bio)
 {
-    // The lock is here for parallel requests protection
-    WITH_LOCK(_lock) {
+    if (!bio) return EIO;
 
-        if (!bio) return EIO;
+    // Submissions from a CPU go to its own queue, so when the device gave
+    // us a queue per vCPU the lock below is effectively uncontended and
+    // parallel submitters proceed independently.
+    auto& q = *_io_queues[sched::cpu::current()->id % _io_queues.size()];
+
+    // The lock is here for parallel requests protection
+    WITH_LOCK(q.lock) {
 
         if (get_guest_feature_bit(VIRTIO_BLK_F_SEG_MAX)) {
             if (bio->bio_bcount/mmu::page_size + 1 > _config.seg_max) {
@@ -294,12 +362,14 @@ int blk::make_request(struct bio* bio)
             }
         }
 
-        auto* queue = get_virt_queue(0);
+        auto* queue = q.vq;
         blk_request_type type;
 
         switch (bio->bio_cmd) {
         case BIO_READ:
             type = VIRTIO_BLK_T_IN;
+            q.stats.reads++;
+            q.stats.bytes_read += bio->bio_bcount;
             break;
         case BIO_WRITE:
             if (is_readonly()) {
@@ -308,9 +378,12 @@ int blk::make_request(struct bio* bio)
                 return EROFS;
             }
             type = VIRTIO_BLK_T_OUT;
+            q.stats.writes++;
+            q.stats.bytes_written += bio->bio_bcount;
             break;
         case BIO_FLUSH:
             type = VIRTIO_BLK_T_FLUSH;
+            q.stats.writes++;
             break;
         default:
             return ENOTBLK;
@@ -337,7 +410,12 @@ int blk::make_request(struct bio* bio)
 
         queue->add_buf_wait(req);
 
-        queue->kick();
+        // A bio flagged BIO_MORE is part of a chain submitted with
+        // bio_list_strategy(); the kick for the chain's last bio
+        // notifies the host of all of them at once.
+        if (!(bio->bio_flags & BIO_MORE)) {
+            queue->kick();
+        }
 
         return 0;
     }
@@ -352,7 +430,8 @@ u64 blk::get_driver_features()
                  | ( 1 << VIRTIO_BLK_F_RO)
                  | ( 1 << VIRTIO_BLK_F_BLK_SIZE)
                  | ( 1 << VIRTIO_BLK_F_CONFIG_WCE)
-                 | ( 1 << VIRTIO_BLK_F_WCE));
+                 | ( 1 << VIRTIO_BLK_F_WCE)
+                 | ( 1 << VIRTIO_BLK_F_MQ));
 }
 
 hw_driver* blk::probe(hw_device* dev)
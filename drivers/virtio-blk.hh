@@ -10,6 +10,8 @@
 #include "drivers/virtio.hh"
 #include "drivers/virtio-device.hh"
 #include <osv/bio.h>
+#include <memory>
+#include <vector>
 
 namespace virtio {
 
@@ -28,6 +30,7 @@ public:
         VIRTIO_BLK_F_WCE        = 9,  /* Writeback mode enabled after reset */
         VIRTIO_BLK_F_TOPOLOGY   = 10, /* Topology information is available */
         VIRTIO_BLK_F_CONFIG_WCE = 11, /* Writeback mode available in config */
+        VIRTIO_BLK_F_MQ         = 12, /* Support more than one request queue */
     };
 
     enum {
@@ -96,6 +99,8 @@ public:
 
             /* writeback mode (if VIRTIO_BLK_F_CONFIG_WCE) */
             u8 wce;
+            /* number of request queues (if VIRTIO_BLK_F_MQ) */
+            u16 num_queues;
     } __attribute__((packed));
 
     /* This is the first element of the read scatter-gather list. */
@@ -129,7 +134,6 @@ public:
 
     int make_request(struct bio*);
 
-    void req_done();
     int64_t size();
 
     void set_readonly() {_ro = true;}
@@ -149,15 +153,36 @@ private:
         struct bio* bio;
     };
 
+    // One request virtqueue together with everything that serves it: the
+    // lock protecting submissions to its vring, the thread that collects
+    // its completions, and its statistics - the same shape multiqueue
+    // virtio-net gives each of its rx/tx queue pairs. With VIRTIO_BLK_F_MQ
+    // the device offers one of these per vCPU and every CPU submits to its
+    // own, so parallel submitters no longer serialize on one vring lock.
+    struct io_queue {
+        vring* vq;
+        sched::thread* worker;
+        // protects parallel make_request() additions to this vring
+        mutex lock;
+        struct queue_stats {
+            u64 reads = 0;          // read requests submitted
+            u64 writes = 0;         // write and flush requests submitted
+            u64 bytes_read = 0;
+            u64 bytes_written = 0;
+            u64 errors = 0;         // requests the device failed
+        } stats;
+    };
+
+    void req_done(io_queue& q);
+
     std::string _driver_name;
     blk_config _config;
+    std::vector<std::unique_ptr<io_queue>> _io_queues;
 
     //maintains the virtio instance number for multiple drives
     static int _instance;
     int _id;
     bool _ro;
-    // This mutex protects parallel make_request invocations
-    mutex _lock;
 };
 
 }
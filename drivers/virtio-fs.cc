@@ -6,8 +6,10 @@
  */
 
 #include <osv/drivers_config.h>
+#include <algorithm>
 #include <string>
 
+#include <osv/barrier.hh>
 #include <osv/debug.h>
 #include <osv/device.h>
 #include <osv/interrupt.hh>
@@ -197,22 +199,51 @@ void fs::req_done()
 }
 
 int fs::make_request(fuse_request& req)
+{
+    fuse_request* reqp = &req;
+    return make_requests(&reqp, 1);
+}
+
+int fs::make_requests(fuse_request** reqs, int count)
 {
     auto* queue = get_virt_queue(VQ_REQUEST);
 
     WITH_LOCK(_lock) {
-        queue->init_sg();
+        for (int i = 0; i < count; i++) {
+            queue->init_sg();
 
-        fuse_req_enqueue_input(*queue, req);
-        fuse_req_enqueue_output(*queue, req);
+            fuse_req_enqueue_input(*queue, *reqs[i]);
+            fuse_req_enqueue_output(*queue, *reqs[i]);
 
-        queue->add_buf_wait(&req);
+            queue->add_buf_wait(reqs[i]);
+        }
         queue->kick();
     }
 
     return 0;
 }
 
+void fs::wait_request(fuse_request& req, bool spin_hint)
+{
+    // Only spin on SMP - on a single cpu the completion path cannot make
+    // progress while we occupy the cpu, so spinning merely delays it.
+    if (spin_hint && sched::cpus.size() > 1) {
+        auto budget = _spin_budget.load(std::memory_order_relaxed);
+        for (unsigned i = 0; i < budget; i++) {
+            if (req.poll()) {
+                // The spin paid off - allow a longer one next time
+                _spin_budget.store(std::min(budget * 2, max_spin),
+                    std::memory_order_relaxed);
+                return;
+            }
+            barrier();
+        }
+        _spin_budget.store(std::max(budget / 2, min_spin),
+            std::memory_order_relaxed);
+    }
+    req.wait();
+}
+
 u64 fs::get_driver_features()
 {
     auto base = virtio_driver::get_driver_features();
@@ -49,6 +49,10 @@ public:
         // Waits for the request to be marked as completed. Should only be
         // called once, from the thread specified in the constructor.
         void wait() { processed.wait(); }
+        // Returns true once the request has been marked as completed, without
+        // blocking. May be called from the thread specified in the
+        // constructor until it observes true or calls wait().
+        bool poll() const { return processed.woken(); }
         // Marks the request as completed. Should only be called once.
         void done() { processed.wake(); }
 
@@ -83,6 +87,17 @@ public:
     virtual u64 get_driver_features();
 
     int make_request(fuse_request&);
+    // Submit @count requests as a single batch: the queue lock is taken and
+    // the device is kicked once for the whole batch, so the requests get
+    // pipelined by the device instead of being processed one kick at a time.
+    int make_requests(fuse_request** reqs, int count);
+    // Wait for @req to complete. With @spin_hint set (used for operations
+    // which the device is expected to answer in microseconds, e.g. metadata
+    // lookups served from virtiofsd's caches), first poll for the completion
+    // for an adaptively sized budget of iterations before going to sleep,
+    // saving the sleep/wake round trip which otherwise dominates such
+    // operations.
+    void wait_request(fuse_request& req, bool spin_hint = false);
     dax_window* get_dax() {
         return (_dax.addr != mmio_nullptr) ? &_dax : nullptr;
     }
@@ -112,6 +127,14 @@ private:
 
     // This mutex protects parallel make_request invocations
     mutex _lock;    // TODO: Maintain one mutex per virtqueue
+
+    // Adaptive spin budget for wait_request(): doubled (up to max_spin) when
+    // a spin observes the completion, halved (down to min_spin) when it ends
+    // up sleeping anyway, so a slow or overloaded device quickly stops us
+    // from spinning.
+    std::atomic<unsigned> _spin_budget = {256};
+    static constexpr unsigned min_spin = 16;
+    static constexpr unsigned max_spin = 4096;
 };
 
 }
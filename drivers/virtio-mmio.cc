@@ -81,6 +81,12 @@ void mmio_device::setup_queue(vring* queue)
 
     mmio_setl(_addr_mmio + VIRTIO_MMIO_QUEUE_USED_LOW, (u32)queue->get_used_addr());
     mmio_setl(_addr_mmio + VIRTIO_MMIO_QUEUE_USED_HIGH, (u32)(queue->get_used_addr() >> 32));
+    //
+    // Publish the doorbell address so kicks take the single-store
+    // kick_queue_fast() path; all queues share one notify register
+    // which takes the queue index as a 32-bit write
+    _notify_is_32bit = true;
+    _queue_notify_addr[queue->index()] = _addr_mmio + VIRTIO_MMIO_QUEUE_NOTIFY;
 }
 
 void mmio_device::activate_queue(int queue)
@@ -14,6 +14,7 @@
 #include <osv/interrupt.hh>
 
 #include <osv/mempool.hh>
+#include <osv/dma-pool.hh>
 #include <osv/mmu.hh>
 
 #include <string>
@@ -177,8 +178,9 @@ static void if_getinfo(struct ifnet* ifp, struct if_data* out_data)
 {
     net* vnet = (net*)ifp->if_softc;
 
-    // First - take the ifnet data
+    // First - take the ifnet data and the per-cpu counter shards
     memcpy(out_data, &ifp->if_data, sizeof(*out_data));
+    if_stat_sum(ifp, out_data);
 
     // then fill the internal statistics we've gathered
     vnet->fill_stats(out_data);
@@ -193,26 +195,45 @@ void net::fill_stats(struct if_data* out_data) const
 
 void net::fill_qstats(const struct rxq& rxq, struct if_data* out_data) const
 {
-    out_data->ifi_ipackets   += rxq.stats.rx_packets;
-    out_data->ifi_ibytes     += rxq.stats.rx_bytes;
-    out_data->ifi_iqdrops    += rxq.stats.rx_drops;
-    out_data->ifi_ierrors    += rxq.stats.rx_csum_err;
-    out_data->ifi_ibh_wakeups = rxq.stats.rx_bh_wakeups;
-    out_data->ifi_iwakeup_stats = rxq.stats.rx_wakeup_stats;
+    // Take a seqlocked snapshot so a reader on another cpu never sees a
+    // burst's packet count without its byte count (and never writes any
+    // line the rx thread touches)
+    rxq_stats stats;
+    u32 seq;
+    do {
+        seq = rxq.stats_seq.read_begin();
+        stats = rxq.stats;
+    } while (rxq.stats_seq.read_retry(seq));
+
+    out_data->ifi_ipackets   += stats.rx_packets;
+    out_data->ifi_ibytes     += stats.rx_bytes;
+    out_data->ifi_iqdrops    += stats.rx_drops;
+    out_data->ifi_ierrors    += stats.rx_csum_err;
+    out_data->ifi_ibh_wakeups = stats.rx_bh_wakeups;
+    out_data->ifi_iring_hwm   = stats.rx_ring_hwm;
+    out_data->ifi_iwakeup_stats = stats.rx_wakeup_stats;
 }
 
 void net::fill_qstats(const struct txq& txq, struct if_data* out_data) const
 {
     assert(!out_data->ifi_oerrors && !out_data->ifi_obytes && !out_data->ifi_opackets);
-    out_data->ifi_opackets       += txq.stats.tx_packets;
-    out_data->ifi_obytes         += txq.stats.tx_bytes;
-    out_data->ifi_oerrors        += txq.stats.tx_err + txq.stats.tx_drops;
-    out_data->ifi_oworker_kicks   = txq.stats.tx_worker_kicks;
-    out_data->ifi_oworker_wakeups = txq.stats.tx_worker_wakeups;
-    out_data->ifi_oworker_packets = txq.stats.tx_worker_packets;
-    out_data->ifi_okicks          = txq.stats.tx_kicks;
-    out_data->ifi_oqueue_is_full  = txq.stats.tx_hw_queue_is_full;
-    out_data->ifi_owakeup_stats   = txq.stats.tx_wakeup_stats;
+    txq_stats stats;
+    u32 seq;
+    do {
+        seq = txq.stats_seq.read_begin();
+        stats = txq.stats;
+    } while (txq.stats_seq.read_retry(seq));
+
+    out_data->ifi_opackets       += stats.tx_packets;
+    out_data->ifi_obytes         += stats.tx_bytes;
+    out_data->ifi_oerrors        += stats.tx_err + stats.tx_drops;
+    out_data->ifi_oworker_kicks   = stats.tx_worker_kicks;
+    out_data->ifi_oworker_wakeups = stats.tx_worker_wakeups;
+    out_data->ifi_oworker_packets = stats.tx_worker_packets;
+    out_data->ifi_okicks          = stats.tx_kicks;
+    out_data->ifi_oqueue_is_full  = stats.tx_hw_queue_is_full;
+    out_data->ifi_oring_hwm       = stats.tx_ring_hwm;
+    out_data->ifi_owakeup_stats   = stats.tx_wakeup_stats;
 }
 
 bool net::ack_irq()
@@ -241,7 +262,8 @@ net::net(virtio_device& dev)
     : virtio_driver(dev),
     _pre_init(this),
     _rxq(get_virt_queue(0), [this] { this->receiver(); }),
-    _txq(this, get_virt_queue(1))
+    _txq(this, get_virt_queue(1)),
+    _busy_poller(this)
 {
     _driver_name = "virtio-net";
     virtio_i("VIRTIO NET INSTANCE");
@@ -291,8 +313,18 @@ net::net(virtio_device& dev)
 
     if (_guest_csum) {
         _ifn->if_capabilities |= IFCAP_RXCSUM;
-        if (_guest_tso4)
+        if (_guest_tso4) {
+            // The host aggregates for us and delivers LRO-style large
+            // frames directly.
             _ifn->if_capabilities |= IFCAP_LRO;
+        } else if (tcp_lro_init(&_rxq.lro) == 0) {
+            // The host can only deliver single MTU-sized segments, so
+            // coalesce consecutive in-order segments of a flow in
+            // software before they enter the TCP stack (see receiver()).
+            _rxq.lro.ifp = _ifn;
+            _rxq.sw_lro = true;
+            _ifn->if_capabilities |= IFCAP_LRO;
+        }
     }
 
     _ifn->if_capenable = _ifn->if_capabilities | IFCAP_HWSTATS;
@@ -305,9 +337,16 @@ net::net(virtio_device& dev)
 
     interrupt_factory int_factory;
 #if CONF_drivers_pci
-    int_factory.register_msi_bindings = [this,poll_task](interrupt_manager &msi) {
+    // Co-locate the rx interrupt, the vring it serves and the polling
+    // thread on one cpu instead of letting the vector chase the thread
+    // after the first interrupts; spread multiple devices round-robin
+    // over the available cpus.
+    static std::atomic<unsigned> next_rx_cpu(0);
+    auto rx_cpu = sched::cpus[next_rx_cpu.fetch_add(1, std::memory_order_relaxed)
+                              % sched::cpus.size()];
+    int_factory.register_msi_bindings = [this,poll_task,rx_cpu](interrupt_manager &msi) {
        msi.easy_register({
-           { 0, [&] { this->_rxq.vqueue->disable_interrupts(); }, poll_task },
+           { 0, [&] { this->_rxq.vqueue->disable_interrupts(); }, poll_task, rx_cpu },
            { 1, [&] { this->_txq.vqueue->disable_interrupts(); }, nullptr }
        });
     };
@@ -344,6 +383,8 @@ net::net(virtio_device& dev)
 
     // Step 8
     add_dev_status(VIRTIO_CONFIG_S_DRIVER_OK);
+
+    osv::net_busy_poll::register_poller(&_busy_poller);
 }
 
 net::~net()
@@ -357,6 +398,12 @@ net::~net()
     // Since this will involve the rework of the virtio layer - make it for
     // all virtio drivers in a separate patchset.
 
+    osv::net_busy_poll::unregister_poller(&_busy_poller);
+
+    if (_rxq.sw_lro) {
+        tcp_lro_free(&_rxq.lro);
+    }
+
     ether_ifdetach(_ifn);
     if_free(_ifn);
 }
@@ -476,6 +523,10 @@ void net::receiver()
         _rxq.stats.rx_bh_wakeups++;
         _rxq.update_wakeup_stats(rx_packets);
 
+        u64 pending = vq->used_ring_pending();
+        if (pending > _rxq.stats.rx_ring_hwm)
+            _rxq.stats.rx_ring_hwm = pending;
+
         u32 len;
         int nbufs;
         rx_drops = rx_packets = csum_ok = 0;
@@ -539,6 +590,20 @@ void net::receiver()
             rx_packets++;
             rx_bytes += m_head->M_dat.MH.MH_pkthdr.len;
 
+            //
+            // Software GRO: try to merge the segment into a pending
+            // per-flow aggregate instead of paying the full per-packet
+            // TCP cost; everything still pending is flushed at the end
+            // of the burst below. Non-TCP/out-of-order packets are
+            // rejected by tcp_lro_rx() and take the usual path.
+            //
+            if (_rxq.sw_lro && (_ifn->if_capenable & IFCAP_LRO) &&
+                _rxq.lro.lro_cnt != 0 &&
+                tcp_lro_rx(&_rxq.lro, m_head, 0) == 0) {
+                trace_virtio_net_rx_packet(_ifn->if_index, rx_bytes);
+                continue;
+            }
+
             bool fast_path = _ifn->if_classifier.post_packet(m_head);
             if (!fast_path) {
                 (*_ifn->if_input)(_ifn, m_head);
@@ -552,12 +617,58 @@ void net::receiver()
                 break;
         }
 
-        // Update the stats
+        //
+        // The burst is over - flush whatever the software LRO is still
+        // holding, nothing else will merge into it before the next
+        // wakeup.
+        //
+        while (!SLIST_EMPTY(&_rxq.lro.lro_active)) {
+            auto queued = SLIST_FIRST(&_rxq.lro.lro_active);
+            SLIST_REMOVE_HEAD(&_rxq.lro.lro_active, next);
+            tcp_lro_flush(&_rxq.lro, queued);
+        }
+
+        // Update the stats. The seqlock bracket keeps the counters of one
+        // burst consistent with each other for fill_qstats() readers.
+        _rxq.stats_seq.write_begin();
         _rxq.stats.rx_drops      += rx_drops;
         _rxq.stats.rx_packets    += rx_packets;
         _rxq.stats.rx_csum       += csum_ok;
         _rxq.stats.rx_csum_err   += csum_err;
         _rxq.stats.rx_bytes      += rx_bytes;
+        _rxq.stats_seq.write_end();
+    }
+}
+
+//
+// The busy poller only watches the used ring and hands any completions to
+// the rx thread - all the actual packet processing stays in receiver(),
+// so there is nothing to synchronize with it.
+//
+void net::rx_busy_poller::poll()
+{
+    auto& rxq = _parent->_rxq;
+    if (rxq.vqueue->used_ring_not_empty()) {
+        rxq.poll_task->wake();
+    }
+}
+
+void net::rx_busy_poller::mask()
+{
+    _parent->_rxq.vqueue->disable_interrupts();
+}
+
+void net::rx_busy_poller::unmask()
+{
+    auto& rxq = _parent->_rxq;
+    auto vq = rxq.vqueue;
+    vq->enable_interrupts();
+    // Close the race with a packet that arrived while the interrupt was
+    // still masked - it hasn't raised an interrupt, so hand it to the rx
+    // thread ourselves (same pattern as wait_for_queue()).
+    if (vq->used_ring_not_empty()) {
+        vq->disable_interrupts();
+        rxq.poll_task->wake();
     }
 }
 
@@ -607,16 +718,33 @@ void net::free_large_buffer_and_refcnt(void* buffer, void* refcnt)
     delete static_cast<unsigned*>(refcnt);
 }
 
+// Premapped DMA pools shared by all virtio-net instances for rx buffers;
+// resolved once so every buffer alloc/free afterwards is a per-CPU
+// freelist operation (see osv/dma-pool.hh). Function-local statics so the
+// pools come to life on first use, safely after the CPUs are up.
+static memory::dma_pool* rx_buffer_pool()
+{
+    static memory::dma_pool* pool = memory::get_dma_pool(page_size);
+    return pool;
+}
+
+static memory::dma_pool* large_rx_buffer_pool()
+{
+    static memory::dma_pool* pool = memory::get_dma_pool(
+        net::LARGE_BUFFER_SIZE_IN_PAGES * page_size);
+    return pool;
+}
+
 void net::do_free_buffer(void* buffer)
 {
     buffer = align_down(buffer, page_size);
-    memory::free_page(buffer);
+    rx_buffer_pool()->free(buffer);
 }
 
 void net::do_free_large_buffer(void* buffer)
 {
     buffer = align_down(buffer, page_size);
-    memory::free_phys_contiguous_aligned(buffer);
+    large_rx_buffer_pool()->free(buffer);
 }
 
 void net::fill_rx_ring()
@@ -626,12 +754,11 @@ void net::fill_rx_ring()
     vring* vq = _rxq.vqueue;
 
     int size_in_pages = _use_large_buffers ? LARGE_BUFFER_SIZE_IN_PAGES : 1;
+    auto pool = _use_large_buffers ? large_rx_buffer_pool() : rx_buffer_pool();
     while (vq->avail_ring_not_empty()) {
-        void *buffer;
-        if (_use_large_buffers) {
-            buffer = memory::alloc_phys_contiguous_aligned(size_in_pages * memory::page_size, memory::page_size);
-        } else {
-            buffer = memory::alloc_page();
+        void *buffer = pool->alloc();
+        if (!buffer) {
+            break;
         }
 
         vq->init_sg();
@@ -649,6 +776,21 @@ void net::fill_rx_ring()
         vq->kick();
 }
 
+// A net_req is allocated for every transmitted packet; serve them from a
+// typed pool (a per-cpu freelist pop/push) instead of the general allocator.
+void* net::net_req::operator new(size_t size)
+{
+    static memory::typed_pool<net_req> pool;
+    assert(size == sizeof(net_req));
+    return pool.alloc();
+}
+
+void net::net_req::operator delete(void* object)
+{
+    // free through the owning pool, as found from the object's page
+    memory::pool::from_object(object)->free(object);
+}
+
 inline int net::txq::try_xmit_one_locked(void* _req)
 {
     net_req* req = static_cast<net_req*>(_req);
@@ -736,15 +878,22 @@ int net::txq::try_xmit_one_locked(net_req* req)
 
 inline void net::txq::update_stats(net_req* req)
 {
+    // Runs in the xmitter worker only, so the write side needs no lock
+    stats_seq.write_begin();
     stats.tx_bytes += req->tx_bytes;
     stats.tx_hw_queue_is_full += req->hw_queue_was_full;
     stats.tx_packets++;
 
+    u64 in_use = vqueue->in_use();
+    if (in_use > stats.tx_ring_hwm)
+        stats.tx_ring_hwm = in_use;
+
     if (req->mhdr.hdr.flags & net_hdr::VIRTIO_NET_HDR_F_NEEDS_CSUM)
         stats.tx_csum++;
 
     if (req->mhdr.hdr.gso_type)
         stats.tx_tso++;
+    stats_seq.write_end();
 }
 
 
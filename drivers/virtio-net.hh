@@ -12,9 +12,16 @@
 #include <bsd/sys/net/if_var.h>
 #include <bsd/sys/net/if.h>
 #include <bsd/sys/sys/mbuf.h>
+#include <bsd/sys/netinet/in_systm.h>
+#include <bsd/sys/netinet/in.h>
+#include <bsd/sys/netinet/ip.h>
+#include <bsd/sys/netinet/tcp.h>
+#include <bsd/sys/netinet/tcp_lro.h>
 
 #include <osv/percpu_xmit.hh>
 #include <osv/contiguous_alloc.hh>
+#include <osv/net_busy_poll.hh>
+#include <osv/seqlock.hh>
 
 #include "drivers/virtio.hh"
 #include "drivers/pci-device.hh"
@@ -113,7 +120,7 @@ public:
     // mandates the guest to use large receive buffers of at least 65562 bytes size
     // For simplicity we are rounding this up to the number of full pages which is 17
     // 65562 = 16 * 4096 + 26 = 65536 + 26 <= 17 * 4096
-    const int LARGE_BUFFER_SIZE_IN_PAGES = 17;
+    static constexpr int LARGE_BUFFER_SIZE_IN_PAGES = 17;
 
     struct net_config {
         /* The config defining mac address (if VIRTIO_NET_F_MAC) */
@@ -257,6 +264,11 @@ private:
             memset(&mhdr, 0, sizeof(mhdr));
         }
 
+        // one allocated per transmitted packet - served from a dedicated
+        // pool (see virtio-net.cc) instead of the general allocator
+        void* operator new(size_t size);
+        void operator delete(void* object);
+
         struct net::net_hdr_mrg_rxbuf mhdr;
         mbuf* mb;
         u64 tx_bytes;
@@ -285,6 +297,7 @@ private:
         u64 rx_csum;    /* number of packets with correct csum */
         u64 rx_csum_err;/* number of packets with a bad checksum */
         u64 rx_bh_wakeups;
+        u64 rx_ring_hwm;/* most used entries found pending at a wakeup */
 
         wakeup_stats rx_wakeup_stats;
     };
@@ -302,6 +315,7 @@ private:
         u64 tx_worker_wakeups;
         u64 tx_worker_packets;
         u64 tx_hw_queue_is_full;
+        u64 tx_ring_hwm;/* most descriptors seen in flight on the HW ring */
 
         wakeup_stats tx_wakeup_stats;
     };
@@ -320,6 +334,15 @@ private:
         vring* vqueue;
         std::unique_ptr<sched::thread> poll_task;
         struct rxq_stats stats = { 0 };
+        // versions the batched stats updates in receiver(), so
+        // fill_qstats() can copy a consistent snapshot without the rx
+        // thread ever taking a lock
+        osv::seq_counter stats_seq;
+
+        // Software GRO (see receiver()): used only when the host can't
+        // deliver large aggregated frames itself (no guest_tso4).
+        struct lro_ctrl lro = {};
+        bool sw_lro = false;
 
         void update_wakeup_stats(const u64 wakeup_packets) {
             if_update_wakeup_stats(stats.rx_wakeup_stats, wakeup_packets);
@@ -353,6 +376,15 @@ private:
             //    3) HW doesn't know there is a work to do.
             //    4) Dead lock.
             //
+            // Batch the worker's doorbells: under a high packet rate the
+            // per-burst kicks are what event-idx can't suppress and the
+            // exits they cause become the bottleneck. The byte bound is a
+            // single maximum-sized TSO frame so bulk TCP rings the
+            // doorbell immediately, and the time bound matches the
+            // standard 50us Tx coalescing timeout of real NICs.
+            //
+            _xmitter.set_doorbell_batching(_doorbell_pkts, _doorbell_bytes,
+                    std::chrono::microseconds(_doorbell_timeout_us));
         };
 
         /**
@@ -410,6 +442,9 @@ private:
 
         vring* vqueue;
         txq_stats stats = { 0 };
+        // versions update_stats() (worker context) against fill_qstats()
+        // readers, like rxq::stats_seq does for the rx side
+        osv::seq_counter stats_seq;
 
     private:
         /**
@@ -459,6 +494,10 @@ private:
         net* _parent;
         osv::tx_xmit_iterator<txq> _xmit_it;
         const int _kick_thresh;
+        // Doorbell batching bounds (see the constructor)
+        static const unsigned _doorbell_pkts = 32;
+        static const u64 _doorbell_bytes = 65536;
+        static const unsigned _doorbell_timeout_us = 50;
         u16 _pkts_to_kick = 0;
         //
         // 4096 is the size of the buffers ring of the FreeBSD virtio-net
@@ -490,15 +529,33 @@ private:
     void free_buffer(void *buffer)
     {
         if (_use_large_buffers) {
-            memory::free_phys_contiguous_aligned(buffer);
+            do_free_large_buffer(buffer);
         } else {
-            memory::free_page(buffer);
+            do_free_buffer(buffer);
         }
     }
 
+    /**
+     * @class rx_busy_poller
+     * SO_BUSY_POLL support: lets a thread blocked in poll()/epoll_wait()
+     * spin on the rx used ring with the rx interrupt masked and wake the
+     * rx thread the moment a completion shows up, instead of waiting for
+     * the interrupt to be injected (see core/net_busy_poll.cc).
+     */
+    class rx_busy_poller : public osv::net_busy_poll::poller {
+    public:
+        explicit rx_busy_poller(net* parent) : _parent(parent) {}
+        virtual void poll() override;
+        virtual void mask() override;
+        virtual void unmask() override;
+    private:
+        net* _parent;
+    };
+
     /* We currently support only a single Rx+Tx queue */
     struct rxq _rxq;
     struct txq _txq;
+    rx_busy_poller _busy_poller;
 
     //maintains the virtio instance number for multiple drives
     static int _instance;
@@ -196,6 +196,15 @@ void virtio_modern_pci_device::setup_queue(vring *queue)
     _queues_notify_offsets[queue_index] =
             _common_cfg->virtio_conf_readw(COMMON_CFG_OFFSET_OF(queue_notify_off));
 
+    // Resolve the notify ("doorbell") address of this queue up front and
+    // publish it so kicks take the single-store kick_queue_fast() path
+    // instead of re-deriving it on every notification
+    auto bar = _notify_cfg->get_bar();
+    if (bar->is_mmio() && bar->is_mapped()) {
+        _queue_notify_addr[queue_index] = bar->get_mmio() + _notify_cfg->get_bar_offset() +
+                _notify_offset_multiplier * _queues_notify_offsets[queue_index];
+    }
+
     _common_cfg->virtio_conf_writew(COMMON_CFG_OFFSET_OF(queue_size), queue->size());
     //
     // Pass addresses
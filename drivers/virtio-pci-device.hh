@@ -249,6 +249,7 @@ public:
         };
         u32 get_cfg_offset() { return _cfg_offset; }
         pci::bar* get_bar() { return _bar; }
+        u64 get_bar_offset() { return _bar_offset; }
 
         void print(const char *prefix) {
             virtio_d("%s bar=%d, offset=%x, size=%x", prefix, _bar_no, _bar_offset, _length);
@@ -87,6 +87,17 @@ size_t rng::get_random_bytes(char* buf, size_t size)
     }
 }
 
+void rng::resume()
+{
+    WITH_LOCK(_mtx) {
+        // Entropy buffered before the snapshot is identical in every
+        // restored clone - throw it away and have the worker refill the
+        // pool from the host
+        _entropy.clear();
+        _producer.wake_one();
+    }
+}
+
 void rng::handle_irq()
 {
     _thread->wake_with_irq_disabled();
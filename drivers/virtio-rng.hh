@@ -29,6 +29,10 @@ public:
 
     virtual size_t get_random_bytes(char* buf, size_t size) override;
 
+    // Discard pooled entropy after a snapshot restore (it is shared by
+    // every clone) and refill from the host
+    virtual void resume() override;
+
     static hw_driver* probe(hw_device* dev);
 
 private:
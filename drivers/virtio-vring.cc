@@ -74,6 +74,9 @@ namespace virtio {
         _sg_vec.reserve(max_sgs);
 
         _use_indirect = false;
+        // Indirect descriptor arrays are sized for the worst case so any
+        // request fits one pool buffer; the pool is shared between rings
+        _indirect_pool = memory::get_dma_pool(max_sgs * sizeof(vring_desc));
     }
 
     vring::~vring()
@@ -164,7 +167,7 @@ namespace virtio {
             vring_desc* descp = _desc;
 
             if (indirect) {
-                vring_desc* indirect = reinterpret_cast<vring_desc*>(alloc_phys_contiguous_aligned((_sg_vec.size())*sizeof(vring_desc), 8));
+                vring_desc* indirect = reinterpret_cast<vring_desc*>(_indirect_pool->alloc());
                 if (!indirect)
                     return false;
                 _desc[idx]._flags = vring_desc::VRING_DESC_F_INDIRECT;
@@ -220,7 +223,7 @@ namespace virtio {
                 int idx = elem._id;
 
                 if (_desc[idx]._flags & vring_desc::VRING_DESC_F_INDIRECT) {
-                    free_phys_contiguous_aligned(mmu::phys_to_virt(_desc[idx]._paddr));
+                    _indirect_pool->free(mmu::phys_to_virt(_desc[idx]._paddr));
                 } else
                     while (_desc[idx]._flags & vring_desc::VRING_DESC_F_NEXT) {
                         idx = _desc[idx]._next;
@@ -14,6 +14,7 @@
 #include <osv/debug.hh>
 #include <osv/mmu.hh>
 #include <osv/sched.hh>
+#include <osv/dma-pool.hh>
 
 #define virtio_tag "virtio"
 #define virtio_d(...)   tprintf_d(virtio_tag, __VA_ARGS__)
@@ -175,6 +176,20 @@ class virtio_driver;
         {
             return _avail_count + (_used_ring_host_head - _used_ring_guest_head);
         }
+
+        // Used entries the host has published and we haven't collected yet
+        inline u16 used_ring_pending() const
+        {
+            return _used->_idx.load(std::memory_order_relaxed) -
+                   _used_ring_host_head;
+        }
+
+        // Descriptors currently owned by the host: added and not completed,
+        // counting completions we haven't collected yet as free
+        inline u16 in_use()
+        {
+            return _num - effective_avail_ring_count();
+        }
         bool used_ring_not_empty() const;
         bool used_ring_is_half_empty() const;
         bool used_ring_can_gc() const;
@@ -283,6 +298,9 @@ class virtio_driver;
         std::atomic<u16>* _used_event;
         // A flag set by driver to turn on/off indirect descriptor
         bool _use_indirect;
+        // Premapped DMA pool the per-request indirect descriptor arrays
+        // come from (shared by all rings with the same max_sgs)
+        memory::dma_pool* _indirect_pool;
     };
 
 
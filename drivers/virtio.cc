@@ -106,12 +106,6 @@ void virtio_driver::free_queues()
     }
 }
 
-bool virtio_driver::kick(int queue)
-{
-    _dev.kick_queue(queue);
-    return true;
-}
-
 void virtio_driver::probe_virt_queues()
 {
     u16 qsize = 0;
@@ -153,8 +147,25 @@ vring* virtio_driver::get_virt_queue(unsigned idx)
     return _queues[idx];
 }
 
+unsigned virtio_driver::_irq_poll_rounds = 16;
+
 void virtio_driver::wait_for_queue(vring* queue, bool (vring::*pred)() const)
 {
+    // NAPI-style poll phase: notifications are still disabled here (the
+    // interrupt handler disabled them, and the caller has just drained the
+    // ring), so poll for a few rounds before re-arming them. A busy host
+    // refills the ring within a round or two and the next batch is then
+    // collected without paying for an interrupt; an idle queue falls
+    // through to the interrupt-driven wait below after _irq_poll_rounds
+    // yields.
+    for (unsigned round = 0; round < _irq_poll_rounds; round++) {
+        if ((queue->*pred)()) {
+            trace_virtio_wait_for_queue(queue, true);
+            return;
+        }
+        sched::thread::yield();
+    }
+
     sched::thread::wait_until([queue,pred] {
         bool have_elements = (queue->*pred)();
         if (!have_elements) {
@@ -150,23 +150,35 @@ static void if_getinfo(struct ifnet* ifp, struct if_data* out_data)
 {
     vmxnet3* vmx = (vmxnet3*)ifp->if_softc;
 
-    // First - take the ifnet data
+    // First - take the ifnet data and the per-cpu counter shards
     memcpy(out_data, &ifp->if_data, sizeof(*out_data));
+    if_stat_sum(ifp, out_data);
 
     // then fill the internal statistics we've gathered
     vmx->fill_stats(out_data);
 }
 
-void vmxnet3::fill_stats(struct if_data* out_data) const
+void vmxnet3::fill_stats(struct if_data* out_data)
 {
     assert(!out_data->ifi_oerrors && !out_data->ifi_obytes && !out_data->ifi_opackets);
+
+    // Ask the device to refresh the UPT stats blocks in the queues' shared
+    // memory, so we can fold in counters only the device sees (drops for
+    // lack of rx buffers, tx errors/discards, LRO aggregation).
+    write_cmd(command::get_stats);
+    auto &txs = _txq[0].layout->stats;
+    auto &rxs = _rxq[0].layout->stats;
+    _txq[0].stats.tx_tso = txs.TSO_packets;
+    _rxq[0].stats.rx_lro = rxs.LRO_packets;
+
     out_data->ifi_ipackets += _rxq[0].stats.rx_packets;
     out_data->ifi_ibytes   += _rxq[0].stats.rx_bytes;
-    out_data->ifi_iqdrops  += _rxq[0].stats.rx_drops;
-    out_data->ifi_ierrors  += _rxq[0].stats.rx_csum_err;
+    out_data->ifi_iqdrops  += _rxq[0].stats.rx_drops + rxs.nobuffer;
+    out_data->ifi_ierrors  += _rxq[0].stats.rx_csum_err + rxs.error;
     out_data->ifi_opackets += _txq[0].stats.tx_packets;
     out_data->ifi_obytes   += _txq[0].stats.tx_bytes;
-    out_data->ifi_oerrors  += _txq[0].stats.tx_err + _txq[0].stats.tx_drops;
+    out_data->ifi_oerrors  += _txq[0].stats.tx_err + _txq[0].stats.tx_drops +
+        txs.error + txs.discard;
 
     out_data->ifi_iwakeup_stats = _rxq[0].stats.rx_wakeup_stats;
     out_data->ifi_owakeup_stats = _txq[0].stats.tx_wakeup_stats;
@@ -623,7 +635,14 @@ void vmxnet3_txqueue::encap(vmxnet3_req *req)
         gen = txr.gen;
     }
     txd->layout->eop = 1;
-    txd->layout->compreq = 1;
+    // Only ask the device for a completion descriptor every compreq_thresh
+    // packets, or once the ring starts running low on descriptors - a single
+    // completion then retires the whole batch in gc(), the way the virtio
+    // drivers collect a batch of used elements per wakeup.
+    if (++_since_compreq >= compreq_thresh || _avail < qsize() / 4) {
+        _since_compreq = 0;
+        txd->layout->compreq = 1;
+    }
 
     if (m_head->m_hdr.mh_flags & M_VLANTAG) {
         sop->layout->vtag_mode = 1;
@@ -634,10 +653,12 @@ void vmxnet3_txqueue::encap(vmxnet3_req *req)
         sop->layout->offload_mode = om::tso;
         sop->layout->hlen = start;
         sop->layout->offload_pos = m_head->M_dat.MH.MH_pkthdr.tso_segsz;
+        stats.tx_tso++;
     } else if (m_head->M_dat.MH.MH_pkthdr.csum_flags & (CSUM_TCP | CSUM_UDP)) {
         sop->layout->offload_mode = om::csum;
         sop->layout->hlen = start;
         sop->layout->offload_pos = start + m_head->M_dat.MH.MH_pkthdr.csum_data;
+        stats.tx_csum++;
     }
 
     // Finally, change the ownership.
@@ -737,24 +758,33 @@ void vmxnet3_txqueue::gc()
             txc.gen ^= 1;
         }
 
+        // With completion moderation one descriptor may cover several
+        // packets - walk the command ring up to (and including) eop_idx
+        // and free every buffered chain on the way.
+        auto eop = txcd->layout->eop_idx;
         auto sop = txr.next;
-        auto m_head = _buf[sop];
+        while (1) {
+            auto m_head = _buf[sop];
 
-        if (m_head != NULL) {
-            int count = 0;
+            if (m_head != NULL) {
+                int count = 0;
 
-            for (auto m = m_head; m != NULL;) {
-                auto m_next = m->m_hdr.mh_next;
-                ++count;
-                m_free(m);
-                m = m_next;
+                for (auto m = m_head; m != NULL;) {
+                    auto m_next = m->m_hdr.mh_next;
+                    ++count;
+                    m_free(m);
+                    m = m_next;
+                }
+                _buf[sop] = NULL;
+                _avail += count;
             }
-            _buf[sop] = NULL;
-            _avail += count;
-        }
 
-        txr.next =
-            (txcd->layout->eop_idx + 1 ) % txr.get_desc_num();
+            auto last = (sop == eop);
+            sop = (sop + 1) % txr.get_desc_num();
+            if (last)
+                break;
+        }
+        txr.next = sop;
     }
 }
 
@@ -856,6 +886,12 @@ void vmxnet3_rxqueue::receive()
             m->M_dat.MH.MH_pkthdr.len = length;
             m->M_dat.MH.MH_pkthdr.rcvif = _ifn;
             m->M_dat.MH.MH_pkthdr.csum_flags = 0;
+            if (rxcd->layout->rss_type != 0) {
+                // hand the device-computed RSS hash to the net-channel
+                // classifier, which reuses it for the flow lookup
+                m->M_dat.MH.MH_pkthdr.flowid = rxcd->layout->rss_hash;
+                m->m_hdr.mh_flags |= M_FLOWID;
+            }
             m->m_hdr.mh_len = length;
             _m_currpkt_head = _m_currpkt_tail = m;
         } else {
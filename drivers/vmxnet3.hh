@@ -202,6 +202,11 @@ private:
     void encap(vmxnet3_req *req);
     int offload(vmxnet3_req *req);
     void gc();
+    // Completion moderation: request a completion descriptor only every
+    // compreq_thresh packets (or once the ring runs low), so one
+    // completion retires a whole batch in gc() instead of one per packet.
+    static constexpr unsigned compreq_thresh = VMXNET3_MAX_TX_NDESC / 3;
+    unsigned _since_compreq = 0;
     int try_xmit_one_locked(vmxnet3_req *req);
     typedef vmxnet3_ring<vmxnet3_tx_desc, VMXNET3_MAX_TX_NDESC> cmdRingT;
     typedef vmxnet3_ring<vmxnet3_tx_compdesc, VMXNET3_MAX_TX_NCOMPDESC> compRingT;
@@ -232,6 +237,7 @@ public:
         u64 rx_drops;   /* if_iqdrops */
         u64 rx_csum;    /* number of packets with correct csum */
         u64 rx_csum_err;/* number of packets with a bad checksum */
+        u64 rx_lro;     /* LRO-aggregated packets (device counter) */
         u64 rx_bh_wakeups; /* number of timer Rx BH has been woken up */
         wakeup_stats rx_wakeup_stats;
     } stats = { 0 };
@@ -272,10 +278,11 @@ public:
 
     /**
      * Fill the if_data buffer with data from our iface including those that
-     * we have gathered by ourselvs (e.g. FP queue stats).
+     * we have gathered by ourselvs (e.g. FP queue stats) and those the
+     * device keeps in the shared-memory UPT stats blocks.
      * @param out_data output buffer
      */
-    void fill_stats(struct if_data* out_data) const;
+    void fill_stats(struct if_data* out_data);
 
 private:
     void parse_pci_config();
@@ -9,6 +9,7 @@
 
 #include <osv/device.h>
 #include <osv/export.h>
+#include <errno.h>
 
 namespace zfsdev {
 
@@ -71,6 +72,31 @@ void zfsdev_init(void)
     }
 }
 
+//Set from libsolaris.so's INIT function like osv_zfs_ioctl_fun above
+int (*osv_zfs_zfetch_set_fun)(const char*, uint64_t);
+void (*osv_zfs_zfetch_stats_fun)(uint64_t*, uint64_t*, uint64_t*,
+                                 uint64_t*, uint64_t*, uint64_t*);
+
+int zfs_zfetch_set(const char* name, uint64_t value)
+{
+    if (!osv_zfs_zfetch_set_fun) {
+        return ENOENT;
+    }
+    return (*osv_zfs_zfetch_set_fun)(name, value);
+}
+
+int zfs_zfetch_stats(uint64_t* hits, uint64_t* misses,
+                     uint64_t* stride_hits, uint64_t* stride_misses,
+                     uint64_t* fetched_blocks, uint64_t* reclaim_failures)
+{
+    if (!osv_zfs_zfetch_stats_fun) {
+        return ENOENT;
+    }
+    (*osv_zfs_zfetch_stats_fun)(hits, misses, stride_hits, stride_misses,
+                                fetched_blocks, reclaim_failures);
+    return 0;
+}
+
 }
 
 extern "C" OSV_LIBSOLARIS_API void zfsdev_init()
@@ -86,3 +112,12 @@ extern "C" OSV_LIBSOLARIS_API void zfsdev_init()
 extern "C" OSV_LIBSOLARIS_API void register_osv_zfs_ioctl( int (*osv_zfs_ioctl_fun)(unsigned long, void*)) {
     zfsdev::osv_zfs_ioctl_fun = osv_zfs_ioctl_fun;
 }
+
+//Needs to be a C-style function so it can be called from libsolaris.so
+extern "C" OSV_LIBSOLARIS_API void register_osv_zfs_zfetch_funs(
+    int (*zfetch_set_fun)(const char*, uint64_t),
+    void (*zfetch_stats_fun)(uint64_t*, uint64_t*, uint64_t*,
+                             uint64_t*, uint64_t*, uint64_t*)) {
+    zfsdev::osv_zfs_zfetch_set_fun = zfetch_set_fun;
+    zfsdev::osv_zfs_zfetch_stats_fun = zfetch_stats_fun;
+}
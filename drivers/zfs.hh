@@ -26,6 +26,16 @@ private:
 
 void zfsdev_init();
 
+// Thin wrappers over callbacks libsolaris.so registers at load time
+// (see zfs_initialize.c); both return ENOENT until it is loaded.
+// zfs_zfetch_set() adjusts a prefetcher tunable by its short name
+// (e.g. "max_streams", "min_cap", "prefetch_disable"); zfs_zfetch_stats()
+// snapshots the prefetcher counters for the monitoring API.
+int zfs_zfetch_set(const char* name, uint64_t value);
+int zfs_zfetch_stats(uint64_t* hits, uint64_t* misses,
+                     uint64_t* stride_hits, uint64_t* stride_misses,
+                     uint64_t* fetched_blocks, uint64_t* reclaim_failures);
+
 }
 
 #endif
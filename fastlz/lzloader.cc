@@ -76,9 +76,28 @@ extern "C" void uncompress_loader()
         }
         else {
             //
-            // Copy from last byte to the first
-            for (auto off = *segment_info - 1; off >= 0; off--)
-                *(BUFFER_OUT + dst_offset + off) = *(compressed_input + src_offset + off);
+            // Copy from the last byte to the first (the regions may
+            // overlap), a word at a time - this stage is a visible part of
+            // boot time and a byte-wise loop is needlessly slow
+            char *dst = BUFFER_OUT + dst_offset;
+            const char *src = compressed_input + src_offset;
+            auto off = static_cast<long>(*segment_info);
+            if (dst - src >= static_cast<long>(sizeof(uint64_t))) {
+                while (off & (sizeof(uint64_t) - 1)) {
+                    off--;
+                    dst[off] = src[off];
+                }
+                while (off > 0) {
+                    off -= sizeof(uint64_t);
+                    *reinterpret_cast<uint64_t*>(dst + off) =
+                        *reinterpret_cast<const uint64_t*>(src + off);
+                }
+            } else {
+                while (off > 0) {
+                    off--;
+                    dst[off] = src[off];
+                }
+            }
         }
     }
 }
@@ -203,6 +203,19 @@ devfs_readdir(struct vnode *vp, struct file *fp, struct dirent *dir)
 	return 0;
 }
 
+static int
+devfs_fallocate(struct vnode *vp, int mode, loff_t offset, loff_t len)
+{
+	struct device *dev = (struct device *)vp->v_data;
+
+	DPRINTF(("devfs_fallocate: dev=%s mode=%x\n", dev->name, mode));
+
+	if (!(dev->flags & D_BLK))
+		return EOPNOTSUPP;
+
+	return bdev_fallocate(dev, mode, offset, len);
+}
+
 static int
 devfs_unmount(struct mount *mp, int flags)
 {
@@ -240,7 +253,6 @@ devfs_getattr(struct vnode *vnode, struct vattr *attr)
 #define devfs_inactive	((vnop_inactive_t)vop_nullop)
 #define devfs_truncate	((vnop_truncate_t)vop_nullop)
 #define devfs_link	((vnop_link_t)vop_eperm)
-#define devfs_fallocate ((vnop_fallocate_t)vop_nullop)
 #define devfs_readlink	((vnop_readlink_t)vop_nullop)
 #define devfs_symlink	((vnop_symlink_t)vop_nullop)
 
@@ -51,6 +51,7 @@
 #include <osv/prex.h>
 #include <osv/mutex.h>
 #include <osv/device.h>
+#include <osv/iosched.hh>
 #include <osv/debug.h>
 #include <osv/buf.h>
 #include <osv/export.h>
@@ -218,6 +219,7 @@ device_create(struct driver *drv, const char *name, int flags)
 		sys_panic("device_create");
 
     dev->driver = drv;
+    dev->io_sched = NULL;
     device_register(dev, name, flags);
 	return dev;
 }
@@ -303,6 +305,9 @@ device_release(struct device *dev)
 int
 device_destroy(struct device *dev)
 {
+	/* Drain and tear down the I/O scheduler before the device goes
+	 * away; its dispatch thread holds no reference on the device. */
+	iosched_stop(dev);
 
 	sched_lock();
 	if (!device_valid(dev)) {
@@ -417,6 +422,31 @@ device_write(struct device *dev, struct uio *uio, int ioflags)
  * The ioctl routine of each driver must validate the user buffer
  * pointed by the arg value.
  */
+/*
+ * device_mmap - report the physical region backing a device.
+ *
+ * Returns ENODEV for drivers which do not expose a memory region; the
+ * vfs then falls back to the read()-based private mapping.
+ */
+int
+device_mmap(struct device *dev, uintptr_t *paddr, size_t *size)
+{
+	struct devops *ops;
+	int error;
+
+	if ((error = device_reference(dev)) != 0)
+		return error;
+
+	ops = dev->driver->devops;
+	if (ops->mmap == NULL)
+		error = ENODEV;
+	else
+		error = (*ops->mmap)(dev, paddr, size);
+
+	device_release(dev);
+	return error;
+}
+
 int
 device_ioctl(struct device *dev, u_long cmd, void *arg)
 {
@@ -39,6 +39,8 @@ struct hash<fileref> {
 }
 
 fileref fileref_from_fd(int fd);
+// Check, without taking a reference, whether fd currently refers to fp.
+bool fd_matches_file(int fd, file* fp);
 fileref fileref_from_fname(std::string name);
 uint64_t size(fileref f);
 void read(fileref f, void *buffer, uint64_t offset, uint64_t len);
@@ -19,6 +19,9 @@
 #include <libgen.h>
 #include <osv/mempool.hh>
 #include <osv/printf.hh>
+#include <osv/syscall-stats.hh>
+#include <osv/lockstat.hh>
+#include <osv/procfs-bin.h>
 
 #include <sys/resource.h>
 #include <mntent.h>
@@ -129,6 +132,81 @@ static std::string procfs_mounts()
 	return rstr;
 }
 
+static std::string procfs_sched_stats()
+{
+    std::string out;
+    for (auto c : sched::cpus) {
+        auto& s = c->stats;
+        out += osv::sprintf("cpu%d switches %lu preemptions %lu runqueue %lu\n",
+                            c->id, s.context_switches, s.preemptions,
+                            (unsigned long)c->runqueue.size());
+        // dispatch latency histogram: bucket i counts dispatches which
+        // waited on the runqueue between 2^i and 2^(i+1)-1 nanoseconds
+        out += osv::sprintf("cpu%d qlat_log2ns", c->id);
+        for (unsigned i = 0; i < sched::cpu::sched_stats::nr_latency_buckets;
+                i++) {
+            out += osv::sprintf(" %lu", s.queue_latency[i]);
+        }
+        out += "\n";
+        // what ended each idle period, and which timers keep firing
+        // (preemption timer vs. sleeping threads and timeouts)
+        out += osv::sprintf("cpu%d idle_wakeups timer %lu other %lu "
+                            "timers_preempt %lu timers_other %lu\n",
+                            c->id, s.idle_wakeups_timer,
+                            s.idle_wakeups_interrupt,
+                            s.timers_fired_preempt, s.timers_fired_other);
+        // idle residency histogram: bucket i counts idle periods where the
+        // cpu stayed halted between 2^i and 2^(i+1)-1 nanoseconds
+        out += osv::sprintf("cpu%d idle_log2ns", c->id);
+        for (unsigned i = 0; i < sched::cpu::sched_stats::nr_latency_buckets;
+                i++) {
+            out += osv::sprintf(" %lu", s.idle_residency[i]);
+        }
+        out += "\n";
+        // wakeup IPI delivery latency histogram, send_wakeup_ipi() to
+        // handle_incoming_wakeups() on this cpu
+        out += osv::sprintf("cpu%d ipi_wakeups %lu ipilat_log2ns",
+                            c->id, s.ipi_wakeups);
+        for (unsigned i = 0; i < sched::cpu::sched_stats::nr_latency_buckets;
+                i++) {
+            out += osv::sprintf(" %lu", s.ipi_latency[i]);
+        }
+        out += "\n";
+    }
+    return out;
+}
+
+static std::string procfs_pool_stats()
+{
+    // one line per object pool (malloc size classes and typed pools);
+    // bytes_held - bytes_live is the class's internal fragmentation, and
+    // remote_frees against frees shows how much of a class's traffic is
+    // cross-cpu producer/consumer hand-off
+    std::string out =
+        "size allocs frees remote_frees live pages bytes_live bytes_held\n";
+    memory::stats::get_object_pool_stats(
+            [&out] (const memory::stats::object_pool_stats& s) {
+        out += osv::sprintf("%lu %lu %lu %lu %lu %lu %lu %lu\n",
+                s.object_size, s.allocs, s.frees, s.frees_remote, s.live,
+                s.pages_held, s.live * s.object_size,
+                s.pages_held * mmu::page_size);
+    });
+    return out;
+}
+
+static std::string procfs_hugepage_stats()
+{
+    mmu::hugepage_stats s;
+    mmu::get_hugepage_stats(s);
+    ulong exec_huge, exec_small;
+    mmu::get_exec_mapping_stats(exec_huge, exec_small);
+    return osv::sprintf("huge_mapped %lu small_mapped %lu huge_failed %lu "
+                        "huge_split %lu huge_promoted %lu "
+                        "exec_huge_bytes %lu exec_small_bytes %lu\n",
+                        s.huge_mapped, s.small_mapped, s.huge_failed,
+                        s.huge_split, s.huge_promoted, exec_huge, exec_small);
+}
+
 static std::string procfs_hostname()
 {
     char hostname[65];
@@ -140,6 +218,27 @@ static std::string procfs_hostname()
     return std::string(hostname);
 }
 
+static std::string procfs_bin_stat()
+{
+    struct procfs_bin_stat s = {};
+
+    using namespace std::chrono;
+    s.version = PROCFS_BIN_STAT_VERSION;
+    s.utime_us = duration_cast<microseconds>(sched::osv_run_stats()).count();
+    s.mem_total_bytes = memory::stats::total();
+    s.mem_free_bytes = memory::stats::free();
+    s.rss_bytes = s.mem_total_bytes - s.mem_free_bytes;
+    s.vsize_bytes = mmu::all_vmas_size();
+    s.nr_threads = sched::thread::numthreads();
+    s.nr_cpus = sched::cpus.size();
+    for (auto c : sched::cpus) {
+        s.context_switches += c->stats.context_switches;
+        s.preemptions += c->stats.preemptions;
+    }
+
+    return std::string(reinterpret_cast<const char*>(&s), sizeof(s));
+}
+
 static std::string procfs_exe()
 {
     auto app = sched::thread::current_app();
@@ -156,10 +255,17 @@ procfs_mount(mount* mp, const char *dev, int flags, const void* data)
 {
     auto* vp = mp->m_root->d_vnode;
 
+    // content depending only on the set of cpus never changes after boot
+    auto constant = [] { return (uint64_t)0; };
+
     auto self = make_shared<pseudo_dir_node>(inode_count++);
-    self->add("maps", inode_count++, mmu::procfs_maps);
+    // maps is regenerated only when the vma list actually changed -
+    // monitoring tends to poll it far more often than that
+    self->add("maps", inode_count++, mmu::procfs_maps,
+              mmu::vma_list_generation);
+    self->add("pagemap", inode_count++, mmu::procfs_pagemap);
     self->add("stat", inode_count++, procfs_stats);
-    self->add("status", inode_count++, procfs_status);
+    self->add("status", inode_count++, procfs_status, constant);
 
     auto exe = make_shared<pseudo_symlink_node>(inode_count++, procfs_exe);
     self->add("exe", exe);
@@ -170,13 +276,28 @@ procfs_mount(mount* mp, const char *dev, int flags, const void* data)
     auto sys = make_shared<pseudo_dir_node>(inode_count++);
     sys->add("kernel", kernel);
 
+    // binary counterparts of the hottest stats - see <osv/procfs-bin.h>
+    // for the record layouts; readers memcpy instead of parsing text
+    auto osv = make_shared<pseudo_dir_node>(inode_count++);
+    osv->add("stat", inode_count++, procfs_bin_stat);
+    osv->add("maps", inode_count++, mmu::procfs_maps_bin,
+             mmu::vma_list_generation);
+
     auto* root = new pseudo_dir_node(vp->v_ino);
     root->add("self", self);
+    root->add("osv", osv);
     root->add(std::to_string(OSV_PID), self); // our standard pid
     root->add("mounts", inode_count++, procfs_mounts);
     root->add("sys", sys);
 
-    root->add("cpuinfo", inode_count++, [] { return processor::features_str(); });
+    root->add("sched_stats", inode_count++, procfs_sched_stats);
+    root->add("syscall_stats", inode_count++, syscall_stats::format);
+    root->add("lock_stats", inode_count++, lock_stats::dump);
+    root->add("pool_stats", inode_count++, procfs_pool_stats);
+    root->add("alloc_profile", inode_count++, memory::alloc_profiler::dump);
+    root->add("hugepage_stats", inode_count++, procfs_hugepage_stats);
+    root->add("cpuinfo", inode_count++, [] { return processor::features_str(); },
+              constant);
     root->add("meminfo", inode_count++, [] { return pseudofs::meminfo("MemTotal:\t%ld kB\nMemFree: \t%ld kB\n"); });
 
     vp->v_data = static_cast<void*>(root);
@@ -10,6 +10,7 @@
 
 #include <osv/dentry.h>
 #include <osv/vnode.h>
+#include <osv/mutex.h>
 
 #include <functional>
 #include <memory>
@@ -46,6 +47,14 @@ public:
     pseudo_file_node(uint64_t ino, function<string()> gen)
             : pseudo_node(ino, VREG), _gen(gen) {}
 
+    // A cached file: the content is regenerated only when ver() returns
+    // a different value than it did for the cached copy, so files that
+    // are polled much more often than their source changes (e.g.
+    // /proc/self/maps against the vma list) skip the formatting.
+    pseudo_file_node(uint64_t ino, function<string()> gen,
+                     function<uint64_t()> ver)
+            : pseudo_node(ino, VREG), _gen(gen), _ver(ver) {}
+
     virtual off_t size() const override {
         return 0;
     }
@@ -55,11 +64,27 @@ public:
     }
 
     string *data() const {
-        return new string(_gen());
+        if (!_ver) {
+            return new string(_gen());
+        }
+        // read the version before generating: if the source changes
+        // under our feet we may cache slightly stale content, but it is
+        // tagged with the old version and the next read regenerates
+        auto v = _ver();
+        std::lock_guard<mutex_t> lock(_cache_mutex);
+        if (!_cached || v != _cached_ver) {
+            _cached.reset(new string(_gen()));
+            _cached_ver = v;
+        }
+        return new string(*_cached);
     }
 
 private:
     function<string()> _gen;
+    function<uint64_t()> _ver;
+    mutable mutex_t _cache_mutex;
+    mutable unique_ptr<string> _cached;
+    mutable uint64_t _cached_ver = 0;
 };
 
 class pseudo_symlink_node : public pseudo_node {
@@ -111,6 +136,11 @@ public:
         _children.insert({name, make_shared<pseudo_file_node>(ino, gen)});
     }
 
+    void add(string name, uint64_t ino, function<string()> gen,
+             function<uint64_t()> ver) {
+        _children.insert({name, make_shared<pseudo_file_node>(ino, gen, ver)});
+    }
+
     void add(string name, shared_ptr <pseudo_node> np) {
         _children.insert({name, np});
     }
@@ -46,6 +46,10 @@
 struct ramfs_file_segment {
     size_t size;
     char *data;
+    /* Set for segments carved as large contiguous extents out of the
+     * page-range allocator (see ramfs_enlarge_data_buffer); those have to
+     * be returned with free_phys_contiguous_aligned() rather than free() */
+    bool extent;
 };
 
 /*
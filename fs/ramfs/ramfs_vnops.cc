@@ -45,6 +45,7 @@
 #include <osv/file.h>
 #include <osv/mount.h>
 #include <osv/vnode_attr.h>
+#include <osv/mempool.hh>
 
 #include "ramfs.h"
 
@@ -67,6 +68,17 @@ set_times_to_now(struct timespec *time1, struct timespec *time2 = nullptr, struc
     }
 }
 
+static void
+ramfs_free_segment(struct ramfs_file_segment &segment)
+{
+    if (segment.extent) {
+        memory::free_phys_contiguous_aligned(segment.data);
+    } else {
+        free(segment.data);
+    }
+    segment.data = NULL;
+}
+
 struct ramfs_node *
 ramfs_allocate_node(const char *name, int type)
 {
@@ -114,8 +126,7 @@ ramfs_free_node(struct ramfs_node *np)
     if (np->rn_file_segments_by_offset != NULL) {
         if (np->rn_owns_buf) {
             for (auto it = np->rn_file_segments_by_offset->begin(); it != np->rn_file_segments_by_offset->end(); ++it) {
-                free(it->second.data);
-                it->second.data = NULL;
+                ramfs_free_segment(it->second);
             }
         }
 
@@ -354,6 +365,14 @@ ramfs_remove(struct vnode *dvp, struct vnode *vp, char *name)
 }
 
 #define ENLARGE_FACTOR 1.1f
+// Segments at least this big are carved as contiguous extents out of the
+// page-range allocator instead of malloc(), so scratch-heavy workloads
+// (GBs written to /tmp) neither fragment the malloc size-class pools nor
+// leave odd-sized chunks behind on delete - the extents go straight back
+// to the free page ranges. Extent-sized allocations also keep the number
+// of segments per file, and thus the per-I/O map walk, small.
+#define RAMFS_EXTENT_SIZE (2 * 1024 * 1024)
+
 static int
 ramfs_enlarge_data_buffer(struct ramfs_node *np, size_t desired_length)
 {
@@ -362,10 +381,26 @@ ramfs_enlarge_data_buffer(struct ramfs_node *np, size_t desired_length)
     assert(new_total_segment_size >= desired_length);
 
     auto new_segment_size = np->rn_owns_buf ? new_total_segment_size - np->rn_total_segments_size : new_total_segment_size;
-    ramfs_file_segment new_segment = {
-        .size = new_segment_size,
-        .data = (char*) malloc(new_segment_size)
-    };
+    ramfs_file_segment new_segment;
+    if (new_segment_size >= RAMFS_EXTENT_SIZE) {
+        // Round large segments up to whole extents and take them from the
+        // contiguous page-range allocator
+        new_segment_size = roundup(new_segment_size, RAMFS_EXTENT_SIZE);
+        new_total_segment_size = new_segment_size +
+            (np->rn_owns_buf ? np->rn_total_segments_size : 0);
+        new_segment = {
+            .size = new_segment_size,
+            .data = (char*) memory::alloc_phys_contiguous_aligned(
+                new_segment_size, RAMFS_EXTENT_SIZE),
+            .extent = true
+        };
+    } else {
+        new_segment = {
+            .size = new_segment_size,
+            .data = (char*) malloc(new_segment_size),
+            .extent = false
+        };
+    }
     if (!new_segment.data)
         return EIO;
 
@@ -400,7 +435,7 @@ ramfs_truncate(struct vnode *vp, off_t length)
     if (length == 0) {
         if (np->rn_owns_buf) {
             for (auto it = (*np->rn_file_segments_by_offset).begin(); it != (*np->rn_file_segments_by_offset).end(); ++it) {
-                free(it->second.data);
+                ramfs_free_segment(it->second);
             }
         }
 
@@ -61,8 +61,24 @@
 #include <osv/buf.h>
 
 #define ROFS_VERSION            1
+// Version 2 adds the flags field to the superblock and, with
+// ROFS_SB_FLAG_LZ4 set, per-extent lz4 compression of file data (see
+// scripts/gen-rofs-img.py --compress for the on-disk layout)
+#define ROFS_VERSION_LZ4        2
 #define ROFS_MAGIC              0xDEADBEAD
 
+#define ROFS_SB_FLAG_LZ4        0x1
+
+// Each compressed extent decompresses to exactly this many bytes (the
+// last extent of a file to file_size % ROFS_EXTENT_SIZE); it matches the
+// cache segment size, so one extent read and one decompress fill one
+// cache segment
+#define ROFS_EXTENT_SIZE        (32 * 1024)
+// High bit of an extent table entry: the extent is stored raw because
+// compression did not shrink it; the rest is the stored size in bytes
+#define ROFS_EXTENT_RAW         0x80000000u
+#define ROFS_EXTENT_LEN_MASK    0x7fffffffu
+
 #define ROFS_INODE_SIZE ((uint64_t)sizeof(struct rofs_inode))
 
 #define ROFS_SUPERBLOCK_SIZE sizeof(struct rofs_super_block)
@@ -101,6 +117,7 @@ struct rofs_super_block {
     uint64_t directory_entries_count;
     uint64_t symlinks_count;
     uint64_t inodes_count;
+    uint64_t flags;     // ROFS_SB_FLAG_*, only meaningful for version >= 2
 };
 
 struct rofs_inode {
@@ -134,5 +151,6 @@ namespace rofs {
 
 int rofs_read_blocks(struct device *device, uint64_t starting_block, uint64_t blocks_count, void* buf);
 void rofs_set_vnode(struct vnode* vnode, struct rofs_inode *inode);
+int rofs_lz4_decompress(void *dst, int dst_capacity, const void *src, int src_len);
 
 #endif
@@ -13,6 +13,7 @@
 #include <include/osv/contiguous_alloc.hh>
 #include <osv/debug.h>
 #include <osv/sched.hh>
+#include <osv/shrinker.h>
 #include <sys/mman.h>
 
 /*
@@ -21,9 +22,18 @@
  * segment by segment.
  **/
 //
-//TODO These 2 values can be made configurable
+//TODO These 4 values can be made configurable
 #define CACHE_SEGMENT_SIZE_IN_BLOCKS 64  // 32K
 #define CACHE_SEGMENT_INDEX(offset) (offset >> 15)
+//
+// How many extra segments to load after the one being read when the reads
+// look sequential - 4 means up to 128K of read-ahead fetched in the same bio.
+#define CACHE_READ_AHEAD_SEGMENTS 4
+//
+// Soft limit of the total cache size; once exceeded, the least recently
+// used segments get evicted. The reclaimer can also shrink the cache below
+// this limit when the system is short on memory.
+#define CACHE_MEMORY_LIMIT (64 * 1024 * 1024)
 
 #if defined(ROFS_DIAGNOSTICS_ENABLED)
 extern std::atomic<long> rofs_block_allocated;
@@ -38,6 +48,22 @@ struct file_cache {
     std::unordered_map<uint64_t, struct file_cache_segment *> segments_by_index;
     struct rofs_inode *inode;
     struct rofs_super_block *sb;
+    // Where the next read would start if the reader is walking the file
+    // sequentially; used to decide whether to read ahead.
+    uint64_t next_sequential_offset = 0;
+    //
+    // For compressed images: the file's extent table, loaded from disk on
+    // first access by load_extent_table(). Entry i holds the stored size
+    // of the extent that decompresses into segment i (plus the
+    // ROFS_EXTENT_RAW bit), and extent_blocks[i] its starting block
+    // relative to the inode's data_offset.
+    std::vector<uint32_t> extent_lens;
+    std::vector<uint64_t> extent_blocks;
+    bool extents_ready = false;
+
+    bool compressed() {
+        return (sb->flags & ROFS_SB_FLAG_LZ4) != 0;
+    }
 };
 
 //
@@ -63,6 +89,11 @@ struct rofs_cache_key_hasher {
     }
 };
 
+//
+// Total bytes of segment data currently allocated; updated with atomics
+// because buffers are allocated and freed outside of file_cache_lock.
+static std::atomic<uint64_t> cache_total_bytes(0);
+
 //
 // This structure holds block_count (typically CACHE_SEGMENT_SIZE_IN_BLOCKS) of 512 blocks
 // of file data starting at starting_block * 512 byte offset relative to the beginning
@@ -71,17 +102,107 @@ class file_cache_segment {
 private:
     struct file_cache *cache; // Parent file cache
     void *data;               // Copy of data on disk
+    uint64_t index;           // Key in the parent's segments_by_index
     uint64_t starting_block;  // This is relative to the 512-block of the inode itself
     uint64_t block_count;     // Length of data in 512 blocks
     bool data_ready;          // Has data been fully read from disk?
+    int busy;                 // Readers currently using this segment (file_cache_lock)
+    bool mapped;              // Handed out to the page cache - must never be evicted
+    std::list<file_cache_segment*>::iterator lru_link; // Position in cache_lru
 
 public:
-    file_cache_segment(struct file_cache *_cache, uint64_t _starting_block, uint64_t _block_count) {
+    file_cache_segment(struct file_cache *_cache, uint64_t _index,
+                       uint64_t _starting_block, uint64_t _block_count) {
         this->cache = _cache;
+        this->index = _index;
         this->starting_block = _starting_block;
         this->block_count = _block_count;
         this->data_ready = false;   // Data has to be loaded from disk
-        auto size = _cache->sb->block_size * _block_count;
+        // The data buffer is allocated lazily by allocate_data(), outside
+        // of file_cache_lock - the shrinker takes that lock, so allocating
+        // under it could deadlock against the reclaimer.
+        this->data = nullptr;
+        this->busy = 0;
+        this->mapped = false;
+    }
+
+    ~file_cache_segment() {
+        if (this->data == nullptr) {
+            return;
+        }
+        auto size = this->length();
+        if (size >= mmu::page_size) {
+            memory::free_phys_contiguous_aligned(this->data);
+        } else {
+            free(this->data);
+        }
+        cache_total_bytes.fetch_sub(size, std::memory_order_relaxed);
+    }
+
+    uint64_t length() {
+        return this->block_count * this->cache->sb->block_size;
+    }
+
+    uint64_t allocated_bytes() {
+        return this->data ? this->length() : 0;
+    }
+
+    struct file_cache *file() {
+        return this->cache;
+    }
+
+    uint64_t segment_index() {
+        return this->index;
+    }
+
+    // The busy count pins a segment for the duration of a read; it is
+    // manipulated under file_cache_lock, as is the LRU position.
+    void mark_busy() { this->busy++; }
+    void unmark_busy() { this->busy--; }
+    void mark_mapped() { this->mapped = true; }
+    bool is_evictable() { return this->busy == 0 && !this->mapped; }
+    std::list<file_cache_segment*>::iterator& lru_position() { return this->lru_link; }
+
+    // Number of blocks of this segment actually backed by the file (the
+    // last segment of a file is usually not full)
+    uint64_t blocks_behind_file() {
+        auto bytes_remaining = cache->inode->file_size - starting_block * cache->sb->block_size;
+        auto blocks_remaining = bytes_remaining / cache->sb->block_size;
+        if (bytes_remaining % cache->sb->block_size > 0) {
+            blocks_remaining++;
+        }
+        return std::min(block_count, blocks_remaining);
+    }
+
+    // First 512-byte block of this segment on disk
+    uint64_t disk_block() {
+        if (cache->compressed()) {
+            return cache->inode->data_offset + cache->extent_blocks[index];
+        }
+        return cache->inode->data_offset + starting_block;
+    }
+
+    // Number of blocks this segment occupies on disk - for compressed
+    // images that is the (rounded up) stored size of its extent
+    uint64_t disk_block_count() {
+        if (cache->compressed()) {
+            auto stored = cache->extent_lens[index] & ROFS_EXTENT_LEN_MASK;
+            return (stored + cache->sb->block_size - 1) / cache->sb->block_size;
+        }
+        return blocks_behind_file();
+    }
+
+    // Bytes of this segment actually backed by the file once decompressed
+    uint64_t bytes_behind_file() {
+        return std::min(this->length(),
+            cache->inode->file_size - starting_block * cache->sb->block_size);
+    }
+
+    int allocate_data() {
+        if (this->data != nullptr) {
+            return 0;
+        }
+        auto size = this->length();
         // Only allocate contiguous page-aligned memory if size greater or equal a page
         // to make sure page-cache mapping works properly
         if (size >= mmu::page_size) {
@@ -89,22 +210,47 @@ public:
         } else {
             this->data = malloc(size);
         }
+        if (this->data == nullptr) {
+            return ENOMEM;
+        }
+        cache_total_bytes.fetch_add(size, std::memory_order_relaxed);
 #if defined(ROFS_DIAGNOSTICS_ENABLED)
         rofs_block_allocated += block_count;
 #endif
+        return 0;
     }
 
-    ~file_cache_segment() {
-        auto size = this->cache->sb->block_size * this->block_count;
-        if (size >= mmu::page_size) {
-            memory::free_phys_contiguous_aligned(this->data);
-        } else {
-            free(this->data);
+    // Fill the segment from a buffer that was read from disk on its
+    // behalf (see the batched read in cache_read())
+    void populate(const void *src, uint64_t bytes) {
+        memcpy(this->data, src, bytes);
+        if (bytes < this->length()) {
+            memset(this->data + bytes, 0, this->length() - bytes);
         }
+        this->data_ready = true;
     }
 
-    uint64_t length() {
-        return this->block_count * this->cache->sb->block_size;
+    // Fill the segment by decompressing its extent, read from disk into
+    // src. A short or failed decompression means a corrupted image.
+    int populate_compressed(const void *src) {
+        auto stored = cache->extent_lens[index];
+        auto bytes = bytes_behind_file();
+        if (stored & ROFS_EXTENT_RAW) {
+            memcpy(this->data, src, stored & ROFS_EXTENT_LEN_MASK);
+        } else {
+            int n = rofs_lz4_decompress(this->data, this->length(),
+                                        src, stored & ROFS_EXTENT_LEN_MASK);
+            if (n < 0 || (uint64_t)n != bytes) {
+                kprintf("[rofs] Error decompressing extent %lu of i-node %lu\n",
+                        index, cache->inode->inode_no);
+                return EIO;
+            }
+        }
+        if (bytes < this->length()) {
+            memset(this->data + bytes, 0, this->length() - bytes);
+        }
+        this->data_ready = true;
+        return 0;
     }
 
     void* memory_address(off_t offset) {
@@ -127,16 +273,32 @@ public:
     //
     // Read all segment data from disk and copy to memory
     int read_from_disk(struct device *device) {
-        auto block = cache->inode->data_offset + starting_block;
-        auto bytes_remaining = cache->inode->file_size - starting_block * cache->sb->block_size;
-        auto blocks_remaining = bytes_remaining / cache->sb->block_size;
-        if (bytes_remaining % cache->sb->block_size > 0) {
-            blocks_remaining++;
+        auto error = allocate_data();
+        if (error) {
+            return error;
         }
-        auto block_count_to_read = std::min(block_count, blocks_remaining);
+        auto block = disk_block();
+        auto block_count_to_read = disk_block_count();
         print("[rofs] [%d] -> file_cache_segment::read_from_disk() i-node: %d, starting block %d, reading [%d] blocks at disk offset [%d]\n",
               sched::thread::current()->id(), cache->inode->inode_no, starting_block, block_count_to_read, block);
-        auto error = rofs_read_blocks(device, block, block_count_to_read, data);
+        if (cache->compressed()) {
+            // One bio for the extent, one decompress into the segment
+            void *scratch = malloc(block_count_to_read * cache->sb->block_size);
+            if (!scratch) {
+                return ENOMEM;
+            }
+            error = rofs_read_blocks(device, block, block_count_to_read, scratch);
+            if (!error) {
+                error = populate_compressed(scratch);
+            }
+            free(scratch);
+            if (error) {
+                printf("!!!!! Error reading from disk\n");
+            }
+            return error;
+        }
+        auto bytes_remaining = cache->inode->file_size - starting_block * cache->sb->block_size;
+        error = rofs_read_blocks(device, block, block_count_to_read, data);
         this->data_ready = (error == 0);
         if (error) {
             printf("!!!!! Error reading from disk\n");
@@ -151,6 +313,61 @@ public:
 
 static std::unordered_map<rofs_cache_key, struct file_cache *, rofs_cache_key_hasher> global_file_cache;
 static mutex file_cache_lock;
+//
+// All cached segments ordered by recency of use - front is the most
+// recently used. Protected by file_cache_lock.
+static std::list<file_cache_segment*> cache_lru;
+
+//
+// Register a newly created segment at the head of the LRU.
+// Called with file_cache_lock held.
+static void cache_lru_insert(file_cache_segment *segment) {
+    cache_lru.push_front(segment);
+    segment->lru_position() = cache_lru.begin();
+}
+
+//
+// Move a segment that just got used to the head of the LRU.
+// Called with file_cache_lock held.
+static void cache_lru_touch(file_cache_segment *segment) {
+    cache_lru.splice(cache_lru.begin(), cache_lru, segment->lru_position());
+}
+
+//
+// Drop least recently used segments until roughly target bytes have been
+// freed, skipping segments pinned by an ongoing read or by the page cache.
+// Returns the number of bytes freed. Called with file_cache_lock held.
+static uint64_t cache_evict_segments(uint64_t target) {
+    uint64_t freed = 0;
+    auto it = cache_lru.end();
+    while (it != cache_lru.begin() && freed < target) {
+        --it;
+        file_cache_segment *segment = *it;
+        if (!segment->is_evictable()) {
+            continue;
+        }
+        it = cache_lru.erase(it);
+        segment->file()->segments_by_index.erase(segment->segment_index());
+        freed += segment->allocated_bytes();
+        delete segment;
+    }
+    print("[rofs] [%d] -> cache_evict_segments freed [%d] bytes\n",
+          sched::thread::current()->id(), freed);
+    return freed;
+}
+
+//
+// Give cache memory back when the reclaimer asks for it
+class rofs_cache_shrinker : public memory::shrinker {
+public:
+    rofs_cache_shrinker() : memory::shrinker("rofs") {}
+    size_t request_memory(size_t n, bool hard) {
+        WITH_LOCK(file_cache_lock) {
+            return cache_evict_segments(n);
+        }
+    }
+};
+static rofs_cache_shrinker *cache_shrinker;
 
 static struct file_cache *get_or_create_file_cache(struct rofs_inode *inode, struct rofs_super_block *sb) {
     struct rofs_cache_key key = {
@@ -158,8 +375,12 @@ static struct file_cache *get_or_create_file_cache(struct rofs_inode *inode, str
         .sb = sb
     };
 
-    // This is the only global mutex
     WITH_LOCK(file_cache_lock) {
+        // Register the shrinker lazily so it only exists - and the
+        // reclaimer only bothers us - once a ROFS mount sees traffic.
+        if (!cache_shrinker) {
+            cache_shrinker = new rofs_cache_shrinker();
+        }
         auto cache_entry = global_file_cache.find(key);
         if (cache_entry == global_file_cache.end()) {
             struct file_cache *new_cache = new file_cache();
@@ -173,6 +394,68 @@ static struct file_cache *get_or_create_file_cache(struct rofs_inode *inode, str
     }
 }
 
+//
+// Load the extent table of a compressed file from disk on first access.
+// The table sits at the inode's data_offset: a uint32_t extent count
+// followed by one uint32_t stored size per extent, padded to a block
+// boundary, with the extents themselves following back-to-back (each
+// block-aligned). The disk read and the allocations happen outside of
+// file_cache_lock (see allocate_data() about why); if two readers race,
+// the loser simply discards its copy.
+static int load_extent_table(struct file_cache *cache, struct device *device) {
+    WITH_LOCK(file_cache_lock) {
+        if (cache->extents_ready) {
+            return 0;
+        }
+    }
+
+    auto block_size = cache->sb->block_size;
+    uint64_t extent_count =
+        (cache->inode->file_size + ROFS_EXTENT_SIZE - 1) / ROFS_EXTENT_SIZE;
+    std::vector<uint32_t> lens(extent_count);
+    std::vector<uint64_t> blocks(extent_count);
+
+    if (extent_count > 0) {
+        uint64_t table_bytes = sizeof(uint32_t) * (extent_count + 1);
+        uint64_t table_blocks = (table_bytes + block_size - 1) / block_size;
+        void *buf = malloc(table_blocks * block_size);
+        if (!buf) {
+            return ENOMEM;
+        }
+        int error = rofs_read_blocks(device, cache->inode->data_offset,
+                                     table_blocks, buf);
+        if (error) {
+            free(buf);
+            return error;
+        }
+        auto entries = static_cast<uint32_t*>(buf);
+        if (entries[0] != extent_count) {
+            kprintf("[rofs] Corrupted extent table of i-node %lu: "
+                    "%u extents, expected %lu\n",
+                    cache->inode->inode_no, entries[0], extent_count);
+            free(buf);
+            return EIO;
+        }
+        uint64_t next_block = table_blocks;
+        for (uint64_t i = 0; i < extent_count; i++) {
+            lens[i] = entries[1 + i];
+            blocks[i] = next_block;
+            next_block += ((lens[i] & ROFS_EXTENT_LEN_MASK) + block_size - 1) /
+                          block_size;
+        }
+        free(buf);
+    }
+
+    WITH_LOCK(file_cache_lock) {
+        if (!cache->extents_ready) {
+            cache->extent_lens = std::move(lens);
+            cache->extent_blocks = std::move(blocks);
+            cache->extents_ready = true;
+        }
+    }
+    return 0;
+}
+
 enum CacheTransactionType {
     READ_FROM_MEMORY = 1,
     READ_FROM_DISK
@@ -197,16 +480,37 @@ struct cache_segment_transaction {
     }
 };
 
+//
+// Create a new segment, hook it up to its file and the LRU, and pin it.
+// Called with file_cache_lock held.
+static file_cache_segment *
+add_cache_segment(struct file_cache *cache, uint64_t index,
+                  uint64_t starting_block, uint64_t block_count) {
+    auto new_cache_segment = new file_cache_segment(cache, index, starting_block, block_count);
+    cache->segments_by_index.emplace(index, new_cache_segment);
+    cache_lru_insert(new_cache_segment);
+    return new_cache_segment;
+}
+
 //
 // This function analyzes uio against existing segments in file_cache
 // and builds a vector of transactions/operation that is used by cache_read to tell it
 // to either read data from memory in cache segment or read data from disk into
-// new segment
+// new segment. Every segment referenced by a transaction gets its busy count
+// bumped so that the eviction logic leaves it alone until the caller is done
+// with it and unpins it.
+// NOTE: Must be called with file_cache_lock held.
 static std::vector<struct cache_segment_transaction>
-plan_cache_transactions(struct file_cache *cache, struct uio *uio) {
+plan_cache_transactions(struct file_cache *cache, struct uio *uio, bool may_read_ahead = true) {
 
     std::vector<struct cache_segment_transaction> transactions;
     //
+    // Detect sequential access - either a fresh scan from the beginning of
+    // the file, or a read continuing exactly where the last one ended -
+    // to decide below whether to read ahead.
+    bool sequential = may_read_ahead && (uio->uio_offset == 0 ||
+        (uint64_t)uio->uio_offset == cache->next_sequential_offset);
+    //
     // Check if file is small enough to fit into cache segment
     if (cache->segments_by_index.empty() &&
         cache->inode->file_size <= (CACHE_SEGMENT_SIZE_IN_BLOCKS * cache->sb->block_size)) {
@@ -214,10 +518,12 @@ plan_cache_transactions(struct file_cache *cache, struct uio *uio) {
         if (cache->inode->file_size % cache->sb->block_size > 0) {
             block_count++;
         }
-        auto new_cache_segment = new file_cache_segment(cache, 0, block_count);
-        cache->segments_by_index.emplace(0, new_cache_segment);
+        auto new_cache_segment = add_cache_segment(cache, 0, 0, block_count);
         uint64_t read_amt = std::min<uint64_t>(cache->inode->file_size - uio->uio_offset, uio->uio_resid);
-        transactions.push_back(cache_segment_transaction(new_cache_segment, uio->uio_offset, read_amt));
+        auto transaction = cache_segment_transaction(new_cache_segment, uio->uio_offset, read_amt);
+        new_cache_segment->mark_busy();
+        transactions.push_back(transaction);
+        cache->next_sequential_offset = uio->uio_offset + read_amt;
         print("[rofs] [%d] -> rofs_cache_get_segment_operations i-node: %d, read FULL file of %d bytes\n",
               sched::thread::current()->id(), cache->inode->inode_no, uio->uio_resid);
         return transactions;
@@ -226,16 +532,18 @@ plan_cache_transactions(struct file_cache *cache, struct uio *uio) {
     // File is larger than cache segment or previous attempt to read from disk failed
     uint64_t file_offset = uio->uio_offset;
     uint64_t bytes_to_read = std::min<uint64_t>(cache->inode->file_size - uio->uio_offset, uio->uio_resid);
+    uint64_t cache_segment_index = CACHE_SEGMENT_INDEX(file_offset);
     while (bytes_to_read > 0) {
         //
         // Next try to see if any cache segment is hit
-        auto cache_segment_index = CACHE_SEGMENT_INDEX(file_offset);
+        cache_segment_index = CACHE_SEGMENT_INDEX(file_offset);
         auto cache_segment = cache->segments_by_index.find(cache_segment_index);
         if (cache_segment != cache->segments_by_index.end()) {
             print("[rofs] [%d] -> rofs_cache_get_segment_operations i-node: %d, cache segment %d HIT at file offset %d\n",
                   sched::thread::current()->id(), cache->inode->inode_no, cache_segment_index, file_offset);
 
             auto transaction = cache_segment_transaction(cache_segment->second, file_offset, bytes_to_read);
+            cache_segment->second->mark_busy();
             file_offset += transaction.bytes_to_read;
             bytes_to_read -= transaction.bytes_to_read;
             transactions.push_back(transaction);
@@ -248,71 +556,186 @@ plan_cache_transactions(struct file_cache *cache, struct uio *uio) {
             uint64_t segment_starting_block = cache_segment_index * CACHE_SEGMENT_SIZE_IN_BLOCKS;
             //
             // Allocate new cache segment
-            auto new_cache_segment = new file_cache_segment(cache, segment_starting_block,
-                                                            CACHE_SEGMENT_SIZE_IN_BLOCKS);
-            cache->segments_by_index.emplace(cache_segment_index, new_cache_segment);
+            auto new_cache_segment = add_cache_segment(cache, cache_segment_index,
+                                                       segment_starting_block,
+                                                       CACHE_SEGMENT_SIZE_IN_BLOCKS);
 
             auto transaction = cache_segment_transaction(new_cache_segment, file_offset, bytes_to_read);
-            file_offset += transaction.bytes_to_read;;
+            new_cache_segment->mark_busy();
+            file_offset += transaction.bytes_to_read;
             bytes_to_read -= transaction.bytes_to_read;
             transactions.push_back(transaction);
         }
     }
+    cache->next_sequential_offset = file_offset;
+    //
+    // The reader looks sequential: plan zero-length transactions for the
+    // next few segments that are not cached yet, so cache_read() fetches
+    // them in the same bio as the segment the reader actually asked for.
+    if (sequential) {
+        uint64_t last_segment_index = CACHE_SEGMENT_INDEX(cache->inode->file_size - 1);
+        for (unsigned n = 0; n < CACHE_READ_AHEAD_SEGMENTS; n++) {
+            uint64_t ra_index = cache_segment_index + 1 + n;
+            if (ra_index > last_segment_index) {
+                break;
+            }
+            if (cache->segments_by_index.find(ra_index) != cache->segments_by_index.end()) {
+                break; // already cached - the reader is about to catch up with old data
+            }
+            print("[rofs] [%d] -> rofs_cache_get_segment_operations i-node: %d, cache segment %d READ-AHEAD\n",
+                  sched::thread::current()->id(), cache->inode->inode_no, ra_index);
+            auto ra_segment = add_cache_segment(cache, ra_index,
+                                                ra_index * CACHE_SEGMENT_SIZE_IN_BLOCKS,
+                                                CACHE_SEGMENT_SIZE_IN_BLOCKS);
+            auto transaction = cache_segment_transaction(ra_segment,
+                ra_index * CACHE_SEGMENT_SIZE_IN_BLOCKS * cache->sb->block_size, 0);
+            ra_segment->mark_busy();
+            transactions.push_back(transaction);
+        }
+    }
 
     return transactions;
 }
 
+//
+// Read the segments of transactions [first, last] - which all miss the
+// cache and sit back-to-back on disk - with a single bio, and distribute
+// the data among them. Falls back to one bio per segment if the scratch
+// buffer cannot be allocated.
+static int
+read_segment_run_from_disk(struct device *device,
+                           std::vector<struct cache_segment_transaction> &transactions,
+                           size_t first, size_t last) {
+    if (first == last) {
+        return transactions[first].segment->read_from_disk(device);
+    }
+
+    uint64_t total_blocks = 0;
+    for (auto i = first; i <= last; i++) {
+        total_blocks += transactions[i].segment->disk_block_count();
+    }
+    auto block_size = transactions[first].segment->file()->sb->block_size;
+    auto total_bytes = total_blocks * block_size;
+    void *scratch = memory::alloc_phys_contiguous_aligned(total_bytes, mmu::page_size);
+    if (!scratch) {
+        int error = 0;
+        for (auto i = first; i <= last && !error; i++) {
+            error = transactions[i].segment->read_from_disk(device);
+        }
+        return error;
+    }
+
+    print("[rofs] [%d] -> read_segment_run_from_disk reading [%d] blocks in one bio for [%d] segments\n",
+          sched::thread::current()->id(), total_blocks, last - first + 1);
+    int error = rofs_read_blocks(device, transactions[first].segment->disk_block(),
+                                 total_blocks, scratch);
+    if (!error) {
+        uint64_t scratch_offset = 0;
+        for (auto i = first; i <= last; i++) {
+            auto segment = transactions[i].segment;
+            error = segment->allocate_data();
+            if (error) {
+                break;
+            }
+            if (segment->file()->compressed()) {
+                error = segment->populate_compressed(scratch + scratch_offset);
+                if (error) {
+                    break;
+                }
+            } else {
+                segment->populate(scratch + scratch_offset,
+                                  segment->blocks_behind_file() * block_size);
+            }
+            scratch_offset += segment->disk_block_count() * block_size;
+        }
+    }
+    memory::free_phys_contiguous_aligned(scratch);
+    return error;
+}
+
 //
 // This function calls plan_cache_transactions first to identify what part of uio can be
 // read from memory and what needs to be read from disk
-// NOTE: This function is NOT thread-safe and does not need to be because it is called only
-// by rofs_read_with_cache() which in turn is called by vfs_file::read() in a critical section
-// specific to given file. So effectively cache_read() is assumed to be called by one thread
-// at a time and no thread synchronization is needed.
+// NOTE: Reads of the same file are serialized by vfs_file::read(), but reads of
+// different files run concurrently, and so does the eviction logic - therefore the
+// planning phase, which touches the shared LRU and segment maps, runs under
+// file_cache_lock, and the segments involved stay pinned until the copy-out is done.
 int
 cache_read(struct rofs_inode *inode, struct device *device, struct rofs_super_block *sb, struct uio *uio) {
     //
     // Find existing one or create new file cache
     struct file_cache *cache = get_or_create_file_cache(inode, sb);
 
+    if (cache->compressed()) {
+        int table_error = load_extent_table(cache, device);
+        if (table_error) {
+            return table_error;
+        }
+    }
+
     //
     // Prepare list of cache transactions (copy from memory
     // or read from disk into cache memory and then copy into memory)
-    auto segment_transactions = plan_cache_transactions(cache, uio);
+    std::vector<struct cache_segment_transaction> segment_transactions;
+    WITH_LOCK(file_cache_lock) {
+        segment_transactions = plan_cache_transactions(cache, uio);
+    }
     print("[rofs] [%d] rofs_cache_read called for i-node [%d] at %d with %d ops\n",
           sched::thread::current()->id(), inode->inode_no, uio->uio_offset, segment_transactions.size());
 
     int error = 0;
 
     // Iterate over the list of cache operation and either copy from memory
-    // or read from disk into cache memory and then copy into memory
-    auto it = segment_transactions.begin();
-    for (; it != segment_transactions.end(); ++it) {
-        auto transaction = *it;
+    // or read from disk into cache memory and then copy into memory. Runs of
+    // transactions that need the disk and are adjacent there - a cold
+    // sequential read plus its read-ahead - get fetched with a single bio.
+    for (size_t i = 0; i < segment_transactions.size() && !error; i++) {
+        auto transaction = segment_transactions[i];
 #if defined(ROFS_DIAGNOSTICS_ENABLED)
         rofs_cache_reads += 1;
 #endif
-        if (transaction.transaction_type == CacheTransactionType::READ_FROM_MEMORY) {
-            //
-            // Copy data from segment to target buffer
-            error = transaction.segment->read(uio, transaction.segment_offset, transaction.bytes_to_read);
-        }
-        // Read from disk into segment missing in cache or empty segment that was in cache but had not data because
-        // of failure to read
-        else {
-            error = transaction.segment->read_from_disk(device);
+        if (transaction.transaction_type == CacheTransactionType::READ_FROM_DISK) {
+            size_t last = i;
+            while (last + 1 < segment_transactions.size() &&
+                   segment_transactions[last + 1].transaction_type == CacheTransactionType::READ_FROM_DISK &&
+                   segment_transactions[last].segment->disk_block() +
+                   segment_transactions[last].segment->disk_block_count() ==
+                   segment_transactions[last + 1].segment->disk_block()) {
+                last++;
+            }
+            error = read_segment_run_from_disk(device, segment_transactions, i, last);
 #if defined(ROFS_DIAGNOSTICS_ENABLED)
             rofs_cache_misses += 1;
 #endif
-            //
-            // Copy data from segment to target buffer
             if (!error) {
-                error = transaction.segment->read(uio, transaction.segment_offset, transaction.bytes_to_read);
+                // Copy out the segments of the run the caller asked for;
+                // pure read-ahead transactions carry zero bytes_to_read.
+                for (auto j = i; j <= last && !error; j++) {
+                    auto& t = segment_transactions[j];
+                    if (t.bytes_to_read > 0) {
+                        error = t.segment->read(uio, t.segment_offset, t.bytes_to_read);
+                    }
+                }
             }
+            i = last;
+        } else {
+            //
+            // Copy data from segment to target buffer
+            error = transaction.segment->read(uio, transaction.segment_offset, transaction.bytes_to_read);
         }
+    }
 
-        if (error) {
-            break;
+    //
+    // Unpin the segments, refresh their LRU position and trim the cache
+    // back under its size limit.
+    WITH_LOCK(file_cache_lock) {
+        for (auto& transaction : segment_transactions) {
+            transaction.segment->unmark_busy();
+            cache_lru_touch(transaction.segment);
+        }
+        auto total = cache_total_bytes.load(std::memory_order_relaxed);
+        if (total > CACHE_MEMORY_LIMIT) {
+            cache_evict_segments(total - CACHE_MEMORY_LIMIT);
         }
     }
 
@@ -329,12 +752,23 @@ cache_get_page_address(struct rofs_inode *inode, struct device *device, struct r
     // Find existing one or create new file cache
     struct file_cache *cache = get_or_create_file_cache(inode, sb);
 
+    if (cache->compressed()) {
+        int table_error = load_extent_table(cache, device);
+        if (table_error) {
+            return table_error;
+        }
+    }
+
     //
     // Prepare a cache transaction (copy from memory
-    // or read from disk into cache memory and then copy into memory)
-    auto segment_transactions = plan_cache_transactions(cache, uio);
+    // or read from disk into cache memory and then copy into memory);
+    // read-ahead is disabled here as we need exactly one segment.
+    std::vector<struct cache_segment_transaction> segment_transactions;
+    WITH_LOCK(file_cache_lock) {
+        segment_transactions = plan_cache_transactions(cache, uio, false);
+    }
     print("[rofs] [%d] rofs_get_page_address called for i-node [%d] at %d with %d ops\n",
-          sched::thread::current()->id(), inode->inode_no, offset, segment_transactions.size());
+          sched::thread::current()->id(), inode->inode_no, uio->uio_offset, segment_transactions.size());
 
     int error = 0;
 
@@ -357,6 +791,16 @@ cache_get_page_address(struct rofs_inode *inode, struct device *device, struct r
    else
        *addr = nullptr;
 
+   WITH_LOCK(file_cache_lock) {
+       if (!error) {
+           // The page cache now holds a pointer into this segment's data,
+           // so it must stay resident for as long as the mapping may live.
+           transaction.segment->mark_mapped();
+       }
+       transaction.segment->unmark_busy();
+       cache_lru_touch(transaction.segment);
+   }
+
    return error;
 }
 
@@ -0,0 +1,97 @@
+/*
+ * Copyright (C) 2026 Waldemar Kozaczuk
+ *
+ * This work is open source software, licensed under the terms of the
+ * BSD license as described in the LICENSE file in the top-level directory.
+ */
+
+//
+// Minimal safe decoder for the LZ4 block format (see
+// https://github.com/lz4/lz4/blob/dev/doc/lz4_Block_format.md), used to
+// decompress ROFS extents written by scripts/gen-rofs-img.py with
+// --compress. Only decompression is needed in the kernel - images are
+// compressed at build time - so we keep a small standalone decoder here
+// instead of pulling in a library.
+//
+
+#include "rofs.hh"
+#include <string.h>
+
+//
+// Decompress the src_len bytes long LZ4 block at src into dst, which can
+// hold up to dst_capacity bytes. Returns the number of decompressed bytes,
+// or -1 when the block is malformed or does not fit - every read and write
+// is bounds-checked, so a corrupted image cannot run us out of the buffers.
+int rofs_lz4_decompress(void *dst, int dst_capacity, const void *src, int src_len)
+{
+    const uint8_t *ip = static_cast<const uint8_t*>(src);
+    const uint8_t *const iend = ip + src_len;
+    uint8_t *op = static_cast<uint8_t*>(dst);
+    uint8_t *const oend = op + dst_capacity;
+
+    if (src_len <= 0) {
+        return -1;
+    }
+
+    while (ip < iend) {
+        unsigned token = *ip++;
+
+        // Literals
+        size_t length = token >> 4;
+        if (length == 15) {
+            unsigned s;
+            do {
+                if (ip >= iend) {
+                    return -1;
+                }
+                s = *ip++;
+                length += s;
+            } while (s == 255);
+        }
+        if (length > (size_t)(iend - ip) || length > (size_t)(oend - op)) {
+            return -1;
+        }
+        memcpy(op, ip, length);
+        ip += length;
+        op += length;
+
+        // The last sequence of a block contains only literals
+        if (ip == iend) {
+            break;
+        }
+
+        // Match: 2-byte little-endian offset back into the output
+        if (iend - ip < 2) {
+            return -1;
+        }
+        size_t offset = ip[0] | (ip[1] << 8);
+        ip += 2;
+        if (offset == 0 || offset > (size_t)(op - static_cast<uint8_t*>(dst))) {
+            return -1;
+        }
+
+        length = (token & 15) + 4;
+        if (length == 19) {
+            unsigned s;
+            do {
+                if (ip >= iend) {
+                    return -1;
+                }
+                s = *ip++;
+                length += s;
+            } while (s == 255);
+        }
+        if (length > (size_t)(oend - op)) {
+            return -1;
+        }
+
+        // Matches may overlap their own output (offset < length), so copy
+        // byte by byte
+        const uint8_t *match = op - offset;
+        while (length--) {
+            *op++ = *match++;
+        }
+    }
+
+    return op - static_cast<uint8_t*>(dst);
+}
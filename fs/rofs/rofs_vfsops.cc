@@ -89,12 +89,20 @@ rofs_mount(struct mount *mp, const char *dev, int flags, const void *data)
         return -1; // TODO: Proper error code
     }
 
-    if (sb->version != ROFS_VERSION) {
+    if (sb->version != ROFS_VERSION && sb->version != ROFS_VERSION_LZ4) {
         kprintf("[rofs] Found rofs volume but incompatible version!\n");
-        kprintf("[rofs] Expecting %llu but found %llu\n", ROFS_VERSION, sb->version);
+        kprintf("[rofs] Expecting %llu or %llu but found %llu\n", ROFS_VERSION,
+                ROFS_VERSION_LZ4, sb->version);
         device_close(device);
         return -1;
     }
+    if (sb->version < ROFS_VERSION_LZ4) {
+        // Version 1 images predate the flags field
+        sb->flags = 0;
+    }
+    if (sb->flags & ROFS_SB_FLAG_LZ4) {
+        kprintf("[rofs] Image uses per-extent lz4 compression\n");
+    }
 
     print("[rofs] Got superblock version:   0x%016llX\n", sb->version);
     print("[rofs] Got magic:                0x%016llX\n", sb->magic);
@@ -102,6 +102,8 @@ static int rofs_readlink(struct vnode *vnode, struct uio *uio)
     return uiomove(link_path, strlen(link_path), uio);
 }
 
+static int rofs_read_with_cache(struct vnode *vnode, struct file* fp, struct uio *uio, int ioflag);
+
 //
 // This function reads as much data as requested per uio in single read from the disk but
 // the data does not get retained for subsequent reads
@@ -112,6 +114,13 @@ static int rofs_read_without_cache(struct vnode *vnode, struct file *fp, struct
     struct rofs_inode *inode = (struct rofs_inode *) vnode->v_data;
     struct device *device = vnode->v_mount->m_dev;
 
+    //
+    // Compressed extents can only be served through the decompressing
+    // cache - this covers both O_DIRECT reads and --disable_rofs_cache
+    if (sb->flags & ROFS_SB_FLAG_LZ4) {
+        return rofs_read_with_cache(vnode, fp, uio, ioflag);
+    }
+
     VERIFY_READ_INPUT_ARGUMENTS()
 
     int rv = 0;
@@ -163,6 +172,17 @@ static int rofs_read_with_cache(struct vnode *vnode, struct file* fp, struct uio
     return rofs::cache_read(inode,device,sb,uio);
 }
 //
+// Default read entry point: serve O_DIRECT reads straight from disk so a
+// self-caching application does not duplicate file data in the segment
+// cache, and everything else through the cache.
+static int rofs_read(struct vnode *vnode, struct file *fp, struct uio *uio, int ioflag)
+{
+    if (ioflag & IO_DIRECT) {
+        return rofs_read_without_cache(vnode, fp, uio, ioflag);
+    }
+    return rofs_read_with_cache(vnode, fp, uio, ioflag);
+}
+//
 // This functions reads directory information (dentries) based on information in memory
 // under rofs->dir_entries table
 static int rofs_readdir(struct vnode *vnode, struct file *fp, struct dirent *dir)
@@ -331,7 +351,7 @@ int rofs_map_cached_page(struct vnode *vnode, struct file* fp, struct uio *uio)
 struct vnops rofs_vnops = {
     rofs_open,               /* open */
     rofs_close,              /* close */
-    rofs_read_with_cache,    /* read */
+    rofs_read,               /* read */
     rofs_write,              /* write - returns error when called */
     rofs_seek,               /* seek */
     rofs_ioctl,              /* ioctl */
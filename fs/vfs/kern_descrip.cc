@@ -14,7 +14,10 @@
 #include <osv/debug.h>
 #include <osv/mutex.h>
 #include <osv/rcu.hh>
+#include <osv/hazard-ptr.hh>
 #include <osv/export.h>
+#include <algorithm>
+#include <atomic>
 #include <boost/range/algorithm/find.hpp>
 
 #include <bsd/sys/sys/queue.h>
@@ -24,9 +27,40 @@ using namespace osv;
 /*
  * Global file descriptors table - in OSv we have a single process so file
  * descriptors are maintained globally.
+ *
+ * Readers (fget()) access the table via RCU and take no locks. Writers
+ * only need to make the check-and-assign of a single slot atomic, so
+ * instead of one global mutex we shard the write locks by fd - an
+ * allocation and an unrelated close no longer serialize on each other.
  */
 rcu_ptr<file> gfdt[FDMAX] = {};
-mutex_t gfdt_lock = MUTEX_INITIALIZER;
+
+static constexpr unsigned fd_lock_count = 64;
+static mutex gfdt_locks[fd_lock_count];
+
+static mutex& fd_lock(int fd)
+{
+    return gfdt_locks[fd & (fd_lock_count - 1)];
+}
+
+/*
+ * Lowest fd which may be free. POSIX requires us to return the
+ * lowest-numbered free descriptor, which naively means scanning from 0
+ * on every allocation; the hint lets us skip the densely-used prefix of
+ * the table. Invariant: every fd below the hint is in use, so the hint
+ * is only lowered when a descriptor is freed, and only advanced past a
+ * slot we have just filled while it was the hint itself.
+ */
+static std::atomic<int> fd_free_hint(0);
+
+static void fd_free_hint_lower(int fd)
+{
+    int h = fd_free_hint.load(std::memory_order_relaxed);
+    while (fd < h && !fd_free_hint.compare_exchange_weak(h, fd,
+            std::memory_order_relaxed)) {
+        // nothing to do
+    }
+}
 
 /*
  * Allocate a file descriptor and assign fd to it atomically.
@@ -39,11 +73,12 @@ int _fdalloc(struct file *fp, int *newfd, int min_fd)
 
     fhold(fp);
 
-    for (fd = min_fd; fd < FDMAX; fd++) {
+    fd = std::max(min_fd, fd_free_hint.load(std::memory_order_relaxed));
+    for (; fd < FDMAX; fd++) {
         if (gfdt[fd])
             continue;
 
-        WITH_LOCK(gfdt_lock) {
+        WITH_LOCK(fd_lock(fd)) {
             /* Now that we hold the lock,
              * make sure the entry is still available */
             if (gfdt[fd].read_by_owner()) {
@@ -55,6 +90,14 @@ int _fdalloc(struct file *fp, int *newfd, int min_fd)
             *newfd = fd;
         }
 
+        // We filled the slot the hint pointed at - everything below it
+        // is known in use, so the next scan may start one slot further.
+        // A concurrent close() lowering the hint makes this CAS fail,
+        // which is exactly what we want.
+        int h = fd;
+        fd_free_hint.compare_exchange_strong(h, fd + 1,
+                std::memory_order_relaxed);
+
         return 0;
     }
 
@@ -82,7 +125,7 @@ int fdclose(int fd)
 {
     struct file* fp;
 
-    WITH_LOCK(gfdt_lock) {
+    WITH_LOCK(fd_lock(fd)) {
 
         fp = gfdt[fd].read_by_owner();
         if (fp == nullptr) {
@@ -92,6 +135,12 @@ int fdclose(int fd)
         gfdt[fd].assign(nullptr);
     }
 
+    fd_free_hint_lower(fd);
+
+    // Retire any cached poll() registration holding fp, so the cache's
+    // fileref doesn't keep the file alive past its descriptor.
+    poll_close_cached(fp);
+
     fdrop(fp);
 
     return 0;
@@ -110,14 +159,16 @@ int fdset(int fd, struct file *fp)
 
     fhold(fp);
 
-    WITH_LOCK(gfdt_lock) {
+    WITH_LOCK(fd_lock(fd)) {
         orig = gfdt[fd].read_by_owner();
         /* Install new file structure in place */
         gfdt[fd].assign(fp);
     }
 
-    if (orig)
+    if (orig) {
+        poll_close_cached(orig);
         fdrop(orig);
+    }
 
     return 0;
 }
@@ -166,6 +217,27 @@ int fget(int fd, struct file **out_fp)
     return 0;
 }
 
+/*
+ * Check, without taking a reference, whether fd currently refers to the
+ * given file. The poll() registration cache uses this to revalidate its
+ * cached filerefs on every call without touching the files' refcounts.
+ */
+bool fd_matches_file(int fd, struct file *fp)
+{
+    if (fd < 0 || fd >= FDMAX) {
+        return false;
+    }
+#if CONF_lazy_stack_invariant
+    assert(sched::preemptable() && arch::irq_enabled());
+#endif
+#if CONF_lazy_stack
+    arch::ensure_next_stack_page();
+#endif
+    WITH_LOCK(rcu_read_lock) {
+        return gfdt[fd].read() == fp;
+    }
+}
+
 file::file(unsigned flags, filetype_t type, void *opaque)
     : f_flags(flags)
     , f_count(1)
@@ -176,12 +248,24 @@ file::file(unsigned flags, filetype_t type, void *opaque)
 
 void file::wake_epoll(int events)
 {
-    WITH_LOCK(f_lock) {
-        if (!f_epolls) {
+    // Runs on every ready event, so don't fight epoll_ctl for f_lock:
+    // the epolls vector is copy-on-write and a hazard pointer keeps the
+    // copy we iterate alive even if it is replaced and retired under us.
+    // The rcu read section covers the epoll_file objects the vector
+    // points at - a closing epoll is disposed of with rcu_dispose(), so
+    // either we see the vector without it, or its free waits for us.
+    if (!f_epolls.load(std::memory_order_relaxed)) {
+        return;
+    }
+    osv::hazard::holder h;
+    WITH_LOCK(rcu_read_lock) {
+        auto epolls = h.protect(f_epolls);
+        if (!epolls) {
             return;
         }
-        for (auto&& ep : *f_epolls) {
-            epoll_wake(ep);
+        for (auto&& ep : *epolls) {
+            // rcu disables preemption, so use the non-blocking wake
+            epoll_wake_in_rcu(ep);
         }
     }
 }
@@ -223,6 +307,7 @@ int fdrop(struct file *fp)
 
 file::~file()
 {
+    delete f_epolls.load(std::memory_order_relaxed);
 }
 
 void file::stop_polls()
@@ -230,8 +315,9 @@ void file::stop_polls()
     auto fp = this;
 
     poll_drain(fp);
-    if (f_epolls) {
-        for (auto ep : *f_epolls) {
+    auto epolls = this->epolls();
+    if (epolls) {
+        for (auto ep : *epolls) {
             epoll_file_closed(ep);
         }
     }
@@ -240,11 +326,16 @@ void file::stop_polls()
 void file::epoll_add(epoll_ptr ep)
 {
     WITH_LOCK(f_lock) {
-        if (!f_epolls) {
-            f_epolls.reset(new std::vector<epoll_ptr>);
+        auto old = f_epolls.load(std::memory_order_relaxed);
+        if (old && boost::range::find(*old, ep) != old->end()) {
+            return;
         }
-        if (boost::range::find(*f_epolls, ep) == f_epolls->end()) {
-            f_epolls->push_back(ep);
+        auto epolls = old ? new std::vector<epoll_ptr>(*old)
+                          : new std::vector<epoll_ptr>;
+        epolls->push_back(ep);
+        f_epolls.store(epolls, std::memory_order_release);
+        if (old) {
+            osv::hazard::retire(old);
         }
     }
 }
@@ -252,11 +343,16 @@ void file::epoll_add(epoll_ptr ep)
 void file::epoll_del(epoll_ptr ep)
 {
     WITH_LOCK(f_lock) {
-        assert(f_epolls);
-        auto i = boost::range::find(*f_epolls, ep);
-        if (i != f_epolls->end()) {
-            f_epolls->erase(i);
+        auto old = f_epolls.load(std::memory_order_relaxed);
+        assert(old);
+        auto i = boost::range::find(*old, ep);
+        if (i == old->end()) {
+            return;
         }
+        auto epolls = new std::vector<epoll_ptr>(*old);
+        epolls->erase(epolls->begin() + (i - old->begin()));
+        f_epolls.store(epolls, std::memory_order_release);
+        osv::hazard::retire(old);
     }
 }
 
@@ -0,0 +1,327 @@
+/*
+ * Copyright (C) 2026 Waldemar Kozaczuk
+ *
+ * This work is open source software, licensed under the terms of the
+ * BSD license as described in the LICENSE file in the top-level directory.
+ */
+
+/*
+ * A deadline I/O scheduler for block devices.
+ *
+ * Bios are staged in two FIFOs - one for reads, one for writes and
+ * flushes - and a per-device thread dispatches them to the driver in
+ * batches. Reads are preferred, since a read nearly always has a thread
+ * sleeping behind it while writes are mostly asynchronous writeback, but
+ * every write carries a deadline so a flood of large writes cannot
+ * starve it forever. Writes and flushes are never reordered among
+ * themselves, which keeps a flush covering everything submitted before
+ * it.
+ *
+ * While a batch is dispatched, consecutive requests that are contiguous
+ * both on disk and in memory are merged into a single carrier bio, so
+ * the driver sees one large request instead of many small ones; the rest
+ * of the batch is chained with BIO_MORE, so drivers that understand the
+ * flag (virtio-blk, nvme) ring their doorbell once per batch.
+ */
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <deque>
+
+#include <osv/device.h>
+#include <osv/bio.h>
+#include <osv/iosched.hh>
+#include <osv/mutex.h>
+#include <osv/condvar.h>
+#include <osv/sched.hh>
+#include <osv/clock.hh>
+
+namespace {
+
+// How long a request may sit in its FIFO before its direction is served
+// unconditionally. Reads expire quickly - bounding read latency under a
+// write flood is the point of this scheduler.
+constexpr auto read_expire = std::chrono::milliseconds(100);
+constexpr auto write_expire = std::chrono::milliseconds(500);
+// How many read batches may be served in a row while writes are waiting.
+constexpr unsigned writes_starved_max = 4;
+// Requests dispatched per batch before the direction is reconsidered.
+constexpr unsigned fifo_batch = 16;
+
+struct ios_bio {
+	struct bio *bio;
+	osv::clock::uptime::time_point expire;
+};
+
+// Completion fan-out for a merged request: the carrier bio finishes all
+// the member bios it was merged from, each through its own bio_done.
+struct merged_bios {
+	int count;
+	struct bio *member[];
+};
+
+static void merged_done(struct bio *carrier)
+{
+	auto *m = static_cast<struct merged_bios *>(carrier->bio_caller1);
+	bool ok = !(carrier->bio_flags & BIO_ERROR);
+
+	for (int i = 0; i < m->count; i++) {
+		biodone(m->member[i], ok);
+	}
+	free(m);
+	destroy_bio(carrier);
+}
+
+class iosched {
+public:
+	explicit iosched(struct device *dev);
+	void queue(struct bio *bio);
+	void stop();
+
+	iosched_policy policy() const { return _policy; }
+	void set_policy(iosched_policy p) { _policy = p; }
+	const iosched_stats &stats() const { return _stats; }
+
+private:
+	void run();
+	unsigned pick_direction();
+	void dispatch_batch(unsigned dir);
+	void submit_batch(struct bio **bios, int count);
+	struct bio *merge(struct bio **bios, int count, size_t len);
+
+	static const unsigned dir_read = 0;
+	static const unsigned dir_write = 1;
+
+	struct device *_dev;
+	mutex _lock;
+	condvar _ready;
+	std::deque<ios_bio> _fifo[2];
+	// read batches served in a row while writes were waiting
+	unsigned _starved = 0;
+	iosched_policy _policy = iosched_policy::deadline;
+	bool _stopping = false;
+	sched::thread *_thread;
+	// queued is bumped under _lock, the rest only by the dispatcher
+	iosched_stats _stats = {};
+};
+
+iosched::iosched(struct device *dev)
+	: _dev(dev)
+{
+	_thread = sched::thread::make([this] { run(); },
+		sched::thread::attr().name(std::string("iosched-") + dev->name));
+	_thread->start();
+}
+
+void iosched::queue(struct bio *bio)
+{
+	// The scheduler batches doorbells itself, so a chain flag set by
+	// bio_list_strategy() must not leak through to the driver - the
+	// chain may be dispatched in a different order.
+	bio->bio_flags &= ~BIO_MORE;
+
+	auto dir = (bio->bio_cmd == BIO_READ) ? dir_read : dir_write;
+	auto expire = osv::clock::uptime::now() +
+		(dir == dir_read ? read_expire : write_expire);
+	WITH_LOCK(_lock) {
+		_fifo[dir].push_back({bio, expire});
+		_stats.queued++;
+	}
+	_ready.wake_one();
+}
+
+void iosched::stop()
+{
+	WITH_LOCK(_lock) {
+		_stopping = true;
+	}
+	_ready.wake_one();
+	_thread->join();
+	delete _thread;
+}
+
+void iosched::run()
+{
+	for (;;) {
+		unsigned dir;
+		WITH_LOCK(_lock) {
+			while (_fifo[dir_read].empty() &&
+			       _fifo[dir_write].empty()) {
+				if (_stopping) {
+					return;
+				}
+				_ready.wait(&_lock);
+			}
+			dir = pick_direction();
+		}
+		dispatch_batch(dir);
+	}
+}
+
+// Called with _lock held and at least one FIFO non-empty. Reads go first
+// unless the oldest write is past its deadline or writes have already
+// been passed over too many times.
+unsigned iosched::pick_direction()
+{
+	if (_fifo[dir_write].empty()) {
+		return dir_read;
+	}
+	if (_fifo[dir_read].empty()) {
+		_starved = 0;
+		return dir_write;
+	}
+	if (_fifo[dir_write].front().expire <= osv::clock::uptime::now() ||
+	    _starved >= writes_starved_max) {
+		_starved = 0;
+		return dir_write;
+	}
+	_starved++;
+	return dir_read;
+}
+
+void iosched::dispatch_batch(unsigned dir)
+{
+	struct bio *bios[fifo_batch];
+	int count = 0;
+
+	WITH_LOCK(_lock) {
+		while (count < (int)fifo_batch && !_fifo[dir].empty()) {
+			bios[count++] = _fifo[dir].front().bio;
+			_fifo[dir].pop_front();
+		}
+	}
+	submit_batch(bios, count);
+}
+
+// Build a carrier bio covering count member bios whose data buffers and
+// disk ranges are contiguous. Returns nullptr when out of memory, in
+// which case the members are submitted individually instead.
+struct bio *iosched::merge(struct bio **bios, int count, size_t len)
+{
+	auto *m = static_cast<struct merged_bios *>(
+		malloc(sizeof(*m) + count * sizeof(struct bio *)));
+	if (!m) {
+		return nullptr;
+	}
+	auto *carrier = alloc_bio();
+	if (!carrier) {
+		free(m);
+		return nullptr;
+	}
+	m->count = count;
+	memcpy(m->member, bios, count * sizeof(struct bio *));
+
+	carrier->bio_cmd = bios[0]->bio_cmd;
+	carrier->bio_dev = bios[0]->bio_dev;
+	carrier->bio_data = bios[0]->bio_data;
+	carrier->bio_offset = bios[0]->bio_offset;
+	carrier->bio_bcount = len;
+	carrier->bio_caller1 = m;
+	carrier->bio_done = merged_done;
+	return carrier;
+}
+
+void iosched::submit_batch(struct bio **bios, int count)
+{
+	int i = 0;
+
+	_stats.batches++;
+	while (i < count) {
+		struct bio *first = bios[i];
+		size_t len = first->bio_bcount;
+		int j = i + 1;
+
+		while (j < count && first->bio_cmd != BIO_FLUSH &&
+		       bios[j]->bio_cmd == first->bio_cmd &&
+		       bios[j]->bio_offset == first->bio_offset + (off_t)len &&
+		       bios[j]->bio_data == first->bio_data + len &&
+		       len + bios[j]->bio_bcount <= _dev->max_io_size) {
+			len += bios[j]->bio_bcount;
+			j++;
+		}
+
+		struct bio *out = first;
+		if (j > i + 1) {
+			out = merge(bios + i, j - i, len);
+			if (!out) {
+				j = i + 1;
+				out = first;
+			} else {
+				_stats.carriers++;
+				_stats.merged += j - i;
+			}
+		}
+		if (j < count) {
+			out->bio_flags |= BIO_MORE;
+		}
+		multiplex_submit(out);
+		i = j;
+	}
+}
+
+// Serializes lazy creation of per-device schedulers.
+mutex iosched_create_lock;
+
+iosched *iosched_of(struct device *dev)
+{
+	if (!dev->io_sched) {
+		WITH_LOCK(iosched_create_lock) {
+			if (!dev->io_sched) {
+				dev->io_sched = new iosched(dev);
+			}
+		}
+	}
+	return static_cast<iosched *>(dev->io_sched);
+}
+
+} // namespace
+
+bool iosched_queue_bio(struct bio *bio)
+{
+	auto *sched = iosched_of(bio->bio_dev);
+	if (sched->policy() == iosched_policy::none) {
+		return false;
+	}
+	sched->queue(bio);
+	return true;
+}
+
+int iosched_set_policy(struct device *dev, iosched_policy policy)
+{
+	if (!(dev->flags & D_BLK)) {
+		return ENOTBLK;
+	}
+	iosched_of(dev)->set_policy(policy);
+	return 0;
+}
+
+int iosched_get_stats(struct device *dev, struct iosched_stats *stats)
+{
+	if (!(dev->flags & D_BLK)) {
+		return ENOTBLK;
+	}
+	auto *sched = static_cast<iosched *>(dev->io_sched);
+	if (sched) {
+		*stats = sched->stats();
+	} else {
+		memset(stats, 0, sizeof(*stats));
+	}
+	return 0;
+}
+
+iosched_policy iosched_get_policy(struct device *dev)
+{
+	auto *sched = static_cast<iosched *>(dev->io_sched);
+	return sched ? sched->policy() : iosched_policy::deadline;
+}
+
+void iosched_stop(struct device *dev)
+{
+	auto *sched = static_cast<iosched *>(dev->io_sched);
+	if (sched) {
+		dev->io_sched = nullptr;
+		sched->stop();
+		delete sched;
+	}
+}
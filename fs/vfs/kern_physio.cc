@@ -13,6 +13,7 @@
 
 #include <osv/device.h>
 #include <osv/bio.h>
+#include <osv/iosched.hh>
 #include <osv/export.h>
 #include <sys/param.h>
 #include <assert.h>
@@ -63,6 +64,26 @@ biodone(struct bio *bio, bool ok)
 	bio->bio_done(bio);
 }
 
+/*
+ * Submit a chain of bios to their device in one go. All but the last bio
+ * are flagged BIO_MORE, which tells drivers that understand the flag
+ * (virtio-blk, nvme) to queue the request without notifying the device -
+ * the doorbell rung for the final bio then covers the whole chain.
+ * Drivers which ignore the flag simply notify per bio, as before.
+ */
+void
+bio_list_strategy(struct bio **bios, int count)
+{
+	int i;
+
+	for (i = 0; i < count; i++) {
+		struct bio *bio = bios[i];
+		if (i < count - 1)
+			bio->bio_flags |= BIO_MORE;
+		bio->bio_dev->driver->devops->strategy(bio);
+	}
+}
+
 void
 biofinish(struct bio *bp, struct devstat *stat, int error)
 {
@@ -94,7 +115,20 @@ static void multiplex_bio_done(struct bio *b)
 		biodone(bio, true);
 }
 
+/*
+ * Entry point of the strategy path for the block drivers: stage the bio
+ * with the device's I/O scheduler (fs/vfs/kern_iosched.cc), whose
+ * dispatch thread hands it on to multiplex_submit() below. Devices whose
+ * scheduling policy is "none" skip the stage and submit directly.
+ */
 void multiplex_strategy(struct bio *bio)
+{
+	if (iosched_queue_bio(bio))
+		return;
+	multiplex_submit(bio);
+}
+
+void multiplex_submit(struct bio *bio)
 {
 	struct device *dev = bio->bio_dev;
 	devop_strategy_t strategy = *((devop_strategy_t *)dev->private_data);
@@ -107,7 +141,12 @@ void multiplex_strategy(struct bio *bio)
 
 	assert(strategy != nullptr);
 
-	if (len <= dev->max_io_size) {
+	/*
+	 * Discards carry no data to DMA-map, so there is no reason to chop
+	 * them to the device's transfer limit - a single dataset-management
+	 * style command can cover the whole range.
+	 */
+	if (len <= dev->max_io_size || bio->bio_cmd == BIO_DELETE) {
 		strategy(bio);
 		return;
 	}
@@ -40,6 +40,7 @@
 #include <sys/statx.h>
 #include <sys/time.h>
 #include <sys/sendfile.h>
+#include <osv/zcopy.h>
 
 #include <limits.h>
 #include <unistd.h>
@@ -82,11 +83,15 @@
 #include <sys/mman.h>
 
 #include <osv/clock.hh>
+#include <osv/sched.hh>
+#include <osv/boot.hh>
+#include <osv/condvar.h>
 #include <api/utime.h>
 #include <chrono>
 
 #include "drivers/zfs.hh"
 #include "bsd/porting/shrinker.h"
+#include <osv/string_utils.hh>
 
 using namespace std;
 
@@ -2355,6 +2360,33 @@ ssize_t sendfile(int out_fd, int in_fd, off_t *_offset, size_t count)
     size_t bytes_to_mmap = count + (offset % mmu::page_size);
     off_t offset_for_mmap =  align_down(offset, (off_t)mmu::page_size);
 
+    // When sending a whole page or more to a stream socket, skip the copy
+    // into fresh mbuf clusters entirely: map the file (the mapping is backed
+    // by the very pages the pagecache/ARC holds) and queue those pages to
+    // the NIC as external mbufs. zcopy_sendfile() takes ownership of the
+    // mapping and drops it once the stack has released every queued byte.
+    if (out_fp->f_type == DTYPE_SOCKET && count >= mmu::page_size) {
+        char *src = static_cast<char *>(mmap(nullptr, bytes_to_mmap, PROT_READ,
+            MAP_SHARED | MAP_POPULATE, in_fd, offset_for_mmap));
+        if (src == MAP_FAILED) {
+            return -1;
+        }
+        auto ret = zcopy_sendfile(out_fd, src, bytes_to_mmap,
+            src + (offset % PAGE_SIZE), count);
+        if (ret >= 0) {
+            if (_offset == nullptr) {
+                lseek(in_fd, ret, SEEK_CUR);
+            } else {
+                *_offset += ret;
+            }
+            return ret;
+        } else if (errno != EOPNOTSUPP) {
+            return -1;
+        }
+        // Not a socket type the zero-copy path can serve: fall through to
+        // the copying path below (the mapping was already dropped).
+    }
+
     char *src = static_cast<char *>(mmap(nullptr, bytes_to_mmap, PROT_READ, MAP_SHARED, in_fd, offset_for_mmap));
 
     if (src == MAP_FAILED) {
@@ -2389,15 +2421,20 @@ ssize_t copy_file_range(int fd_in, off_t *off_in,
         errno = EINVAL;
         return -1;
     }
-    //We do not support writing to a file at specified offset because
-    //we delegate to sendfile() which assumes current position of the output
-    //file
-    if (off_out) {
-        WARN("copy_file_range() does not support non-zero off_out\n");
-        errno = EINVAL;
-        return -1;
+
+    fileref in_f{fileref_from_fd(fd_in)};
+    fileref out_f{fileref_from_fd(fd_out)};
+    if (!in_f || !out_f) {
+        return libc_error(EBADF);
     }
-    return sendfile(fd_out, fd_in, off_in, len);
+
+    size_t copied = 0;
+    int error = sys_copy_file_range(in_f.get(), off_in, out_f.get(), off_out,
+                                    len, &copied);
+    if (error) {
+        return libc_error(error);
+    }
+    return copied;
 }
 
 NO_SYS(OSV_LIBC_API int fchmodat(int dirfd, const char *pathname, mode_t mode, int flags));
@@ -2569,6 +2606,40 @@ static void import_extra_zfs_pools(void)
     }
 }
 
+// Parse the fstab options of a ZFS mount. The prefetcher tunables are
+// settable as "zfetch_<name>=<value>" (e.g. zfetch_max_streams=16,
+// zfetch_min_cap=32) plus "noprefetch" to disable prefetch entirely;
+// they reach dmu_zfetch.c through the callback libsolaris.so registers
+// at load time. The tunables are global to the DMU, not per dataset -
+// the last mount that sets one wins - but in practice images carry one
+// pool and the options express per-image tuning.
+static void parse_zfs_mount_options(const char *opts)
+{
+    std::vector<std::string> split_opts;
+    osv::split(split_opts, opts, ",");
+    for (auto &opt : split_opts) {
+        if (opt.empty() || opt == MNTOPT_DEFAULTS || opt == "osv/zfs") {
+            continue;
+        }
+        if (opt == "noprefetch") {
+            if (zfsdev::zfs_zfetch_set("prefetch_disable", 1)) {
+                printf("Warning: failed to disable zfs prefetch\n");
+            }
+            continue;
+        }
+        auto eq = opt.find('=');
+        if (opt.compare(0, 7, "zfetch_") == 0 && eq != std::string::npos) {
+            auto name = opt.substr(7, eq - 7);
+            auto value = strtoull(opt.c_str() + eq + 1, nullptr, 0);
+            if (zfsdev::zfs_zfetch_set(name.c_str(), value)) {
+                printf("Warning: unknown zfs prefetch option %s\n", opt.c_str());
+            }
+            continue;
+        }
+        printf("Warning: opts %s, ignored for fs zfs\n", opt.c_str());
+    }
+}
+
 static void mount_fs(mntent *m)
 {
     if (!strcmp(m->mnt_dir, "/")) {
@@ -2600,6 +2671,9 @@ static void mount_fs(mntent *m)
     }
 
     if (zfs) {
+        if (m->mnt_opts != nullptr) {
+            parse_zfs_mount_options(m->mnt_opts);
+        }
         m->mnt_opts = "osv/zfs";
     } else {
         if ((m->mnt_opts != nullptr) && strcmp(m->mnt_opts, MNTOPT_DEFAULTS)) {
@@ -2616,9 +2690,99 @@ static void mount_fs(mntent *m)
         if (zfs) {
             bsd_shrinker_init();
         }
+        boot_time.event((std::string(m->mnt_type) + " mounted on " +
+                         m->mnt_dir).c_str());
     }
 }
 
+// Lazy mounting (--lazy-mount): pivot_rootfs() queues the fstab and
+// --mount-fs entries and returns right away, letting the application start
+// while a background thread completes the mounts - the ZFS pool import in
+// particular. Path lookups reaching a mount point whose mount has not
+// finished yet wait for it (see vfs_wait_pending_mount()).
+bool opt_lazy_mount = false;
+
+struct pending_mount {
+    std::string fsname;
+    std::string dir;
+    std::string type;
+    std::string opts;
+    bool has_opts;
+};
+
+static mutex pending_mount_lock;
+static condvar pending_mount_done;
+static std::vector<std::string> pending_mount_dirs;
+static std::atomic<int> pending_mount_count(0);
+static sched::thread* pending_mount_thread;
+
+void vfs_wait_pending_mount(const char *path)
+{
+    if (pending_mount_count.load(std::memory_order_acquire) == 0 ||
+        sched::thread::current() == pending_mount_thread) {
+        // Nothing pending, or we are the mounting thread itself (which
+        // looks up the mount point while mounting it)
+        return;
+    }
+    WITH_LOCK(pending_mount_lock) {
+        bool retry = true;
+        while (retry) {
+            retry = false;
+            for (auto& d : pending_mount_dirs) {
+                if (strncmp(path, d.c_str(), d.size()) == 0 &&
+                    (path[d.size()] == '\0' || path[d.size()] == '/')) {
+                    pending_mount_done.wait(&pending_mount_lock);
+                    retry = true;
+                    break;
+                }
+            }
+        }
+    }
+}
+
+static void mount_pending(pending_mount& pm)
+{
+    struct mntent m = {};
+    m.mnt_fsname = const_cast<char*>(pm.fsname.c_str());
+    m.mnt_dir = const_cast<char*>(pm.dir.c_str());
+    m.mnt_type = const_cast<char*>(pm.type.c_str());
+    m.mnt_opts = pm.has_opts ? const_cast<char*>(pm.opts.c_str()) : nullptr;
+    mount_fs(&m);
+}
+
+static void mount_non_root_fs(std::vector<pending_mount>& mounts)
+{
+    if (mounts.empty()) {
+        return;
+    }
+    if (!opt_lazy_mount) {
+        for (auto& pm : mounts) {
+            mount_pending(pm);
+        }
+        return;
+    }
+    WITH_LOCK(pending_mount_lock) {
+        for (auto& pm : mounts) {
+            pending_mount_dirs.push_back(pm.dir);
+        }
+        pending_mount_count.store(mounts.size(), std::memory_order_release);
+    }
+    auto t = sched::thread::make([mounts] () mutable {
+        for (auto& pm : mounts) {
+            mount_pending(pm);
+            WITH_LOCK(pending_mount_lock) {
+                pending_mount_dirs.erase(
+                    std::find(pending_mount_dirs.begin(),
+                              pending_mount_dirs.end(), pm.dir));
+                pending_mount_count.fetch_add(-1, std::memory_order_release);
+                pending_mount_done.wake_all();
+            }
+        }
+    }, sched::thread::attr().detached().name("lazy-mount"));
+    pending_mount_thread = t;
+    t->start();
+}
+
 extern std::vector<mntent> opt_mount_fs;
 extern "C" void pivot_rootfs(const char* path)
 {
@@ -2646,18 +2810,25 @@ extern "C" void pivot_rootfs(const char* path)
         closedir(fs_lib_dir);
     }
 
+    // getmntent() returns pointers into a static buffer, so copy the
+    // entries before handing them (possibly) to the background mount thread
+    std::vector<pending_mount> mounts;
     auto ent = setmntent("/etc/fstab", "r");
     if (ent) {
         struct mntent *m = nullptr;
         while ((m = getmntent(ent)) != nullptr) {
-            mount_fs(m);
+            mounts.push_back({m->mnt_fsname, m->mnt_dir, m->mnt_type,
+                    m->mnt_opts ? m->mnt_opts : "", m->mnt_opts != nullptr});
         }
         endmntent(ent);
     }
 
     for (auto m: opt_mount_fs) {
-        mount_fs(&m);
+        mounts.push_back({m.mnt_fsname, m.mnt_dir, m.mnt_type,
+                m.mnt_opts ? m.mnt_opts : "", m.mnt_opts != nullptr});
     }
+
+    mount_non_root_fs(mounts);
 }
 
 extern "C" void unmount_devfs()
@@ -92,6 +92,8 @@ int	 sys_read(struct file *fp, const struct iovec *iov, size_t niov,
 		off_t offset, size_t *count);
 int	 sys_write(struct file *fp, const struct iovec *iov, size_t niov,
 		off_t offset, size_t *count);
+int	 sys_copy_file_range(struct file *in_fp, off_t *in_offp,
+		struct file *out_fp, off_t *out_offp, size_t len, size_t *count);
 int	 sys_lseek(struct file *fp, off_t off, int type, off_t * cur_off);
 int	 sys_ioctl(struct file *fp, u_long request, void *buf);
 int	 sys_fstat(struct file *fp, struct stat *st);
@@ -141,6 +143,7 @@ int	 path_conv(char *wd, const char *cpath, char *full);
 int	 sec_vnode_permission(char *path);
 
 int     namei(const char *path, struct dentry **dpp);
+void	 vfs_wait_pending_mount(const char *path);
 int	 namei_last_nofollow(char *path, struct dentry *ddp, struct dentry **dp);
 int	 lookup(char *path, struct dentry **dpp, char **name);
 void	 vnode_init(void);
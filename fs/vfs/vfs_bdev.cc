@@ -8,6 +8,8 @@
 
 #include <assert.h>
 #include <errno.h>
+#include <fcntl.h>
+#include <stdint.h>
 #include <stdlib.h>
 #include <string.h>
 #include <stdio.h>
@@ -16,11 +18,65 @@
 #include <osv/prex.h>
 #include <osv/buf.h>
 #include <osv/bio.h>
+#include <osv/vnode.h>
+#include <sys/refcount.h>
+
+/*
+ * O_DIRECT path: build a bio straight over the caller's buffer and hand it
+ * to the driver, bypassing the buffer cache entirely. The driver translates
+ * the buffer with virt_to_phys when it builds the device's sg-list, so the
+ * data is DMAed directly to or from application memory with no intermediate
+ * copy. The caller's buffers must be sector-aligned, like the offset and
+ * length already have to be.
+ */
+static int
+bdev_direct_io(struct device *dev, struct uio *uio, int cmd)
+{
+	while (uio->uio_resid > 0) {
+		struct iovec *iov = uio->uio_iov;
+		struct bio *bio;
+		int ret;
+
+		if (iov->iov_len == 0) {
+			uio->uio_iov++;
+			uio->uio_iovcnt--;
+			continue;
+		}
+		if (((uintptr_t)iov->iov_base % BSIZE) != 0 ||
+		    (iov->iov_len % BSIZE) != 0)
+			return EINVAL;
+
+		bio = alloc_bio();
+		if (!bio)
+			return ENOMEM;
+
+		bio->bio_cmd = cmd;
+		bio->bio_dev = dev;
+		bio->bio_data = iov->iov_base;
+		bio->bio_offset = uio->uio_offset;
+		bio->bio_bcount = iov->iov_len;
+
+		bio->bio_dev->driver->devops->strategy(bio);
+		ret = bio_wait(bio);
+
+		destroy_bio(bio);
+		if (ret)
+			return ret;
+
+		uio->uio_offset += iov->iov_len;
+		uio->uio_resid -= iov->iov_len;
+		uio->uio_iov++;
+		uio->uio_iovcnt--;
+	}
+	return 0;
+}
+
+/* How many buffers bdev_read holds at once between batched releases. */
+#define BDEV_READ_BATCH	16
 
 int
 bdev_read(struct device *dev, struct uio *uio, int ioflags)
 {
-	struct buf *bp;
 	int ret;
 
 	assert(uio->uio_rw == UIO_READ);
@@ -38,14 +94,30 @@ bdev_read(struct device *dev, struct uio *uio, int ioflags)
 		return EINVAL;
 	if (uio->uio_resid == 0)
 		return 0;
-    
+
+	if (ioflags & IO_DIRECT)
+		return bdev_direct_io(dev, uio, BIO_READ);
+
+	/* Acquire a run of blocks at a time and release them in one batch,
+	 * so the buffer cache locks are taken once per run rather than
+	 * twice per block. */
 	while (uio->uio_resid > 0) {
-		ret = bread(dev, uio->uio_offset >> 9, &bp);
+		struct buf *bps[BDEV_READ_BATCH];
+		int count = uio->uio_resid / BSIZE;
+
+		if (count > BDEV_READ_BATCH)
+			count = BDEV_READ_BATCH;
+		ret = bread_batch(dev, uio->uio_offset >> 9, &count, bps);
 		if (ret)
 			return ret;
 
-		ret = uiomove(bp->b_data, BSIZE, uio);
-		brelse(bp);
+		ret = 0;
+		for (int i = 0; i < count; i++) {
+			ret = uiomove(bps[i]->b_data, BSIZE, uio);
+			if (ret)
+				break;
+		}
+		brelse_batch(bps, count);
 
 		if (ret)
 			return ret;
@@ -75,7 +147,14 @@ bdev_write(struct device *dev, struct uio *uio, int ioflags)
 		return EINVAL;
 	if (uio->uio_resid == 0)
 		return 0;
-    
+
+	if (ioflags & IO_DIRECT) {
+		/* Cached copies of the written range would go stale - drop
+		 * this device's buffers before writing around the cache. */
+		binval(dev);
+		return bdev_direct_io(dev, uio, BIO_WRITE);
+	}
+
 	while (uio->uio_resid > 0) {
 		bp = getblk(dev, uio->uio_offset >> 9);
 
@@ -94,6 +173,149 @@ bdev_write(struct device *dev, struct uio *uio, int ioflags)
 }
 
 
+/*
+ * fallocate() on a block device: translate hole punching into the device's
+ * discard command (BIO_DELETE) and range zeroing into its write-zeroes
+ * command (BIO_ZERO), so freeing space tells the device to unmap the blocks
+ * instead of rewriting zeros through the data path. Drivers which do not
+ * implement the command fail the bio and the caller sees EIO.
+ */
+int
+bdev_fallocate(struct device *dev, int mode, off_t offset, off_t len)
+{
+	struct bio *bio;
+	int cmd, ret;
+
+	if (mode == (FALLOC_FL_PUNCH_HOLE | FALLOC_FL_KEEP_SIZE))
+		cmd = BIO_DELETE;
+	else if ((mode & ~FALLOC_FL_KEEP_SIZE) == FALLOC_FL_ZERO_RANGE)
+		cmd = BIO_ZERO;
+	else
+		return EOPNOTSUPP;
+
+	if ((offset % BSIZE) != 0 || (len % BSIZE) != 0)
+		return EINVAL;
+	if (offset + len > dev->size)
+		return EIO;
+
+	/* Cached copies of the affected range would go stale. */
+	binval(dev);
+
+	bio = alloc_bio();
+	if (!bio)
+		return ENOMEM;
+
+	bio->bio_cmd = cmd;
+	bio->bio_dev = dev;
+	bio->bio_data = NULL;
+	bio->bio_offset = offset;
+	bio->bio_bcount = len;
+
+	bio->bio_dev->driver->devops->strategy(bio);
+	ret = bio_wait(bio);
+
+	destroy_bio(bio);
+	return ret;
+}
+
+static void
+physio_done(struct bio *b)
+{
+	struct bio *parent = static_cast<struct bio*>(b->bio_caller1);
+	bool error = b->bio_flags & BIO_ERROR;
+	destroy_bio(b);
+
+	if (error) {
+		WITH_LOCK(parent->bio_mutex) {
+			parent->bio_flags |= BIO_ERROR;
+		}
+	}
+
+	// The last completion finishes the parent - a single wakeup for the
+	// whole chain, no matter how many bios it carried.
+	if (refcount_release(&parent->bio_refcnt))
+		biodone(parent, true);
+}
+
+/*
+ * Submit one bio per iovec as a chain, so the driver rings its doorbell
+ * once for the whole request, and complete them through a refcounted
+ * parent bio, so the submitting thread is woken up once.
+ */
+static int
+physio_vector(struct device *dev, struct uio *uio)
+{
+	int count = uio->uio_iovcnt;
+	int submitted = 0;
+	off_t offset = uio->uio_offset;
+	struct bio *bio;
+	int ret;
+
+	struct bio **bios = (struct bio **)malloc(count * sizeof(struct bio *));
+	if (!bios)
+		return ENOMEM;
+
+	struct bio *parent = alloc_bio();
+	if (!parent) {
+		free(bios);
+		return ENOMEM;
+	}
+
+	for (int i = 0; i < count; i++) {
+		struct iovec *iov = &uio->uio_iov[i];
+
+		if (!iov->iov_len)
+			continue;
+
+		bio = alloc_bio();
+		if (!bio) {
+			/* Nothing has been submitted yet, undo and bail. */
+			for (int j = 0; j < submitted; j++)
+				destroy_bio(bios[j]);
+			destroy_bio(parent);
+			free(bios);
+			return ENOMEM;
+		}
+
+		if (uio->uio_rw == UIO_READ)
+			bio->bio_cmd = BIO_READ;
+		else
+			bio->bio_cmd = BIO_WRITE;
+
+		bio->bio_dev = dev;
+		bio->bio_data = iov->iov_base;
+		bio->bio_offset = offset;
+		bio->bio_bcount = iov->iov_len;
+		bio->bio_caller1 = parent;
+		bio->bio_done = physio_done;
+
+		bios[submitted++] = bio;
+		offset += iov->iov_len;
+	}
+
+	if (!submitted) {
+		destroy_bio(parent);
+		free(bios);
+		return 0;
+	}
+
+	refcount_init(&parent->bio_refcnt, submitted);
+	bio_list_strategy(bios, submitted);
+	/* The children destroy themselves on completion. */
+	free(bios);
+
+	ret = bio_wait(parent);
+	destroy_bio(parent);
+
+	if (!ret) {
+		uio->uio_resid -= offset - uio->uio_offset;
+		uio->uio_offset = offset;
+		uio->uio_iov += count;
+		uio->uio_iovcnt = 0;
+	}
+	return ret;
+}
+
 int
 physio(struct device *dev, struct uio *uio, int ioflags)
 {
@@ -104,7 +326,10 @@ physio(struct device *dev, struct uio *uio, int ioflags)
 		return EINVAL;
 	if (uio->uio_resid == 0)
 		return 0;
-    
+
+	if (uio->uio_iovcnt > 1)
+		return physio_vector(dev, uio);
+
 	while (uio->uio_resid > 0) {
 		struct iovec *iov = uio->uio_iov;
 
@@ -60,55 +60,92 @@
 #define	ISSET(t, f)	((t) & (f))
 
 /*
- * Global lock to access all buffer headers and lists.
+ * The cache is sharded into buckets, each with its own lock, free list
+ * and counting semaphore, so that concurrent metadata-heavy workloads
+ * do not convoy on a single cache-wide lock.  A block is assigned to a
+ * bucket by hashing (dev, blkno), and each bucket manages a fixed slice
+ * of the buffer table, so a lookup only scans that slice.
  */
-static mutex bio_lock;
+#define NBUCKETS	32
+#define BUFS_PER_BUCKET	(NBUFS / NBUCKETS)
+
+struct bio_bucket {
+	mutex		lock;
+	boost::intrusive::list<struct buf,
+		boost::intrusive::base_hook<struct buf>> free_list;
+	sem_t		free_sem;
+};
+
+static struct bio_bucket bucket_table[NBUCKETS];
 
 /* fixed set of buffers */
 static struct buf buf_table[NBUFS];
-boost::intrusive::list<struct buf, boost::intrusive::base_hook<struct buf>> free_list;
 
-static sem_t free_sem;
+/*
+ * Hash a block to its bucket.  The device pointer is shifted so that
+ * consecutive blocks of the same device spread over all buckets.
+ */
+static unsigned
+bucket_index(struct device *dev, off_t blkno)
+{
+	return (blkno ^ ((uintptr_t)dev >> 6)) & (NBUCKETS - 1);
+}
+
+static struct bio_bucket *
+bio_bucket(struct device *dev, off_t blkno)
+{
+	return &bucket_table[bucket_index(dev, blkno)];
+}
 
 /*
- * Insert buffer to the head of free list
+ * The bucket a buffer belongs to is fixed by its position in the buffer
+ * table - only blocks hashing to that bucket are ever cached in it.
+ */
+static struct bio_bucket *
+bucket_of(struct buf *bp)
+{
+	return &bucket_table[(bp - buf_table) / BUFS_PER_BUCKET];
+}
+
+/*
+ * Insert buffer to the head of the bucket's free list
  */
 static void
-bio_insert_head(struct buf *bp)
+bio_insert_head(struct bio_bucket *b, struct buf *bp)
 {
-	free_list.push_front(*bp);
-	sem_post(&free_sem);
+	b->free_list.push_front(*bp);
+	sem_post(&b->free_sem);
 }
 
 /*
- * Insert buffer to the tail of free list
+ * Insert buffer to the tail of the bucket's free list
  */
 static void
-bio_insert_tail(struct buf *bp)
+bio_insert_tail(struct bio_bucket *b, struct buf *bp)
 {
-	free_list.push_back(*bp);
-	sem_post(&free_sem);
+	b->free_list.push_back(*bp);
+	sem_post(&b->free_sem);
 }
 
 /*
- * Remove buffer from free list
+ * Remove buffer from the bucket's free list
  */
 static void
-bio_remove(struct buf *bp)
+bio_remove(struct bio_bucket *b, struct buf *bp)
 {
-	sem_wait(&free_sem);
-	free_list.erase(free_list.iterator_to(*bp));
+	sem_wait(&b->free_sem);
+	b->free_list.erase(b->free_list.iterator_to(*bp));
 }
 
 /*
- * Remove buffer from the head of free list
+ * Remove buffer from the head of the bucket's free list
  */
 static struct buf *
-bio_remove_head(void)
+bio_remove_head(struct bio_bucket *b)
 {
-	sem_wait(&free_sem);
-	auto& bp = free_list.front();
-	free_list.pop_front();
+	sem_wait(&b->free_sem);
+	auto& bp = b->free_list.front();
+	b->free_list.pop_front();
 	return &bp;
 }
 
@@ -137,13 +174,16 @@ rw_buf(struct buf *bp, int rw)
 }
 
 /*
- * Determine if a block is in the cache.
+ * Determine if a block is in the cache.  Only the owning bucket's slice
+ * of the buffer table has to be scanned.
  */
 static struct buf *
-incore(struct device *dev, int blkno)
+incore(struct bio_bucket *b, struct device *dev, int blkno)
 {
-	for (int i = 0; i < NBUFS; i++) {
-		auto* bp = &buf_table[i];
+	int base = (b - bucket_table) * BUFS_PER_BUCKET;
+
+	for (int i = 0; i < BUFS_PER_BUCKET; i++) {
+		auto* bp = &buf_table[base + i];
 		if (bp->b_blkno == blkno && bp->b_dev == dev &&
 		    !ISSET(bp->b_flags, B_INVAL))
 			return bp;
@@ -151,10 +191,28 @@ incore(struct device *dev, int blkno)
 	return nullptr;
 }
 
+/*
+ * Take a delayed-write buffer off the free list and write it out, with
+ * the bucket lock dropped around the actual I/O.  Such a buffer is not
+ * busy, so it has to be re-acquired first - bwrite() asserts ownership
+ * and releases the buffer back to the free list when the I/O is done.
+ * The caller must rescan the bucket afterwards.
+ */
+static void
+bio_writeout(struct bio_bucket *b, struct buf *bp)
+{
+	bio_remove(b, bp);
+	SET(bp->b_flags, B_BUSY);
+	mutex_lock(&bp->b_lock);
+	DROP_LOCK(b->lock) {
+		bwrite(bp);
+	}
+}
+
 /*
  * Assign a buffer for the given block.
  *
- * The block is selected from the buffer list with LRU
+ * The block is selected from the owning bucket's buffers with LRU
  * algorithm.  If the appropriate block already exists in the
  * block list, return it.  Otherwise, the least recently used
  * block is used.
@@ -163,28 +221,31 @@ struct buf *
 getblk(struct device *dev, int blkno)
 {
 	DPRINTF(VFSDB_BIO, ("getblk: dev=%x blkno=%d\n", dev, blkno));
-	SCOPE_LOCK(bio_lock);
+	auto* b = bio_bucket(dev, blkno);
+	SCOPE_LOCK(b->lock);
 start:
-	auto* bp = incore(dev, blkno);
+	auto* bp = incore(b, dev, blkno);
 	if (bp != nullptr) {
 		/* Block found in cache. */
 		if (ISSET(bp->b_flags, B_BUSY)) {
 			/*
 			 * Wait buffer ready.
 			 */
-			DROP_LOCK(bio_lock) {
+			DROP_LOCK(b->lock) {
 				mutex_lock(&bp->b_lock);
 				mutex_unlock(&bp->b_lock);
 			}
 			/* Scan again if it's busy */
 			goto start;
 		}
-		bio_remove(bp);
+		bio_remove(b, bp);
 		SET(bp->b_flags, B_BUSY);
 	} else {
-		bp = bio_remove_head();
+		bp = bio_remove_head(b);
 		if (ISSET(bp->b_flags, B_DELWRI)) {
-			DROP_LOCK(bio_lock) {
+			SET(bp->b_flags, B_BUSY);
+			mutex_lock(&bp->b_lock);
+			DROP_LOCK(b->lock) {
 				bwrite(bp);
 			}
 			goto start;
@@ -198,6 +259,20 @@ start:
 	return bp;
 }
 
+/*
+ * Release a buffer whose bucket lock is already held.
+ */
+static void
+brelse_locked(struct bio_bucket *b, struct buf *bp)
+{
+	CLR(bp->b_flags, B_BUSY);
+	mutex_unlock(&bp->b_lock);
+	if (ISSET(bp->b_flags, B_INVAL))
+		bio_insert_head(b, bp);
+	else
+		bio_insert_tail(b, bp);
+}
+
 /*
  * Release a buffer, with no I/O implied.
  */
@@ -208,13 +283,32 @@ brelse(struct buf *bp)
 	DPRINTF(VFSDB_BIO, ("brelse: bp=%x dev=%x blkno=%d\n",
 				bp, bp->b_dev, bp->b_blkno));
 
-	SCOPE_LOCK(bio_lock);
-	CLR(bp->b_flags, B_BUSY);
-	mutex_unlock(&bp->b_lock);
-	if (ISSET(bp->b_flags, B_INVAL))
-		bio_insert_head(bp);
-	else
-		bio_insert_tail(bp);
+	auto* b = bucket_of(bp);
+	SCOPE_LOCK(b->lock);
+	brelse_locked(b, bp);
+}
+
+/*
+ * Release several buffers at once, taking each bucket lock only once
+ * for all the buffers it covers.
+ */
+void
+brelse_batch(struct buf **bpp, int count)
+{
+	for (int i = 0; i < count; i++) {
+		if (bpp[i] == nullptr)
+			continue;
+		auto* b = bucket_of(bpp[i]);
+		WITH_LOCK(b->lock) {
+			for (int j = i; j < count; j++) {
+				if (bpp[j] != nullptr && bucket_of(bpp[j]) == b) {
+					ASSERT(ISSET(bpp[j]->b_flags, B_BUSY));
+					brelse_locked(b, bpp[j]);
+					bpp[j] = nullptr;
+				}
+			}
+		}
+	}
 }
 
 /*
@@ -240,13 +334,53 @@ bread(struct device *dev, int blkno, struct buf **bpp)
 			return error;
 		}
 	}
-	CLR(bp->b_flags, B_INVAL);
-	SET(bp->b_flags, (B_READ | B_DONE));
+	/* Update the flags under the bucket lock - incore() scans them. */
+	WITH_LOCK(bucket_of(bp)->lock) {
+		CLR(bp->b_flags, B_INVAL);
+		SET(bp->b_flags, (B_READ | B_DONE));
+	}
 	DPRINTF(VFSDB_BIO, ("bread: done bp=%x\n\n", bp));
 	*bpp = bp;
 	return 0;
 }
 
+/*
+ * Read up to *countp consecutive blocks, returning each buffer busy as
+ * bread() does.  On return *countp holds the number of buffers actually
+ * acquired; release them with brelse_batch().
+ *
+ * Holding several buffers at once is only deadlock-free if everybody
+ * acquires them in a consistent order, so the batch is cut short as
+ * soon as the next block's bucket index would not increase.  Since
+ * consecutive blocks hash to consecutive buckets, a batch of
+ * consecutive blocks spans up to NBUCKETS blocks per call.
+ *
+ * On I/O error all buffers acquired so far are released, *countp is set
+ * to zero and the error is returned.
+ */
+int
+bread_batch(struct device *dev, int blkno, int *countp, struct buf **bpp)
+{
+	unsigned prev_idx = 0;
+	int n = 0;
+
+	while (n < *countp) {
+		auto idx = bucket_index(dev, blkno + n);
+		if (n > 0 && idx <= prev_idx)
+			break;
+		auto error = bread(dev, blkno + n, &bpp[n]);
+		if (error) {
+			brelse_batch(bpp, n);
+			*countp = 0;
+			return error;
+		}
+		prev_idx = idx;
+		n++;
+	}
+	*countp = n;
+	return 0;
+}
+
 /*
  * Block write with cache.
  * @buf:   buffer to write.
@@ -261,14 +395,15 @@ bwrite(struct buf *bp)
 	DPRINTF(VFSDB_BIO, ("bwrite: dev=%x blkno=%d\n", bp->b_dev,
 			    bp->b_blkno));
 
-	WITH_LOCK(bio_lock) {
+	auto* b = bucket_of(bp);
+	WITH_LOCK(b->lock) {
 		CLR(bp->b_flags, (B_READ | B_DONE | B_DELWRI));
 	}
 
 	auto error = rw_buf(bp, 1);
 	if (error)
 		return error;
-	WITH_LOCK(bio_lock) {
+	WITH_LOCK(b->lock) {
 		SET(bp->b_flags, B_DONE);
 	}
 	brelse(bp);
@@ -286,7 +421,7 @@ void
 bdwrite(struct buf *bp)
 {
 
-	WITH_LOCK(bio_lock) {
+	WITH_LOCK(bucket_of(bp)->lock) {
 		SET(bp->b_flags, B_DELWRI);
 		CLR(bp->b_flags, B_DONE);
 	}
@@ -299,10 +434,14 @@ bdwrite(struct buf *bp)
 void
 bflush(struct buf *bp)
 {
-	WITH_LOCK(bio_lock) {
-		if (ISSET(bp->b_flags, B_DELWRI))
-			bwrite(bp);
+	bool delwri;
+
+	WITH_LOCK(bucket_of(bp)->lock) {
+		delwri = ISSET(bp->b_flags, B_DELWRI);
 	}
+	/* The caller owns the buffer, so the flag cannot change under us. */
+	if (delwri)
+		bwrite(bp);
 }
 
 /*
@@ -312,39 +451,56 @@ bflush(struct buf *bp)
 void
 binval(struct device *dev)
 {
-	SCOPE_LOCK(bio_lock);
-	for (auto i = 0; i < NBUFS; i++) {
-		auto* bp = &buf_table[i];
-		if (bp->b_dev == dev) {
-			if (ISSET(bp->b_flags, B_DELWRI))
-				bwrite(bp);
-			else if (ISSET(bp->b_flags, B_BUSY))
-				brelse(bp);
+	for (int i = 0; i < NBUCKETS; i++) {
+		auto* b = &bucket_table[i];
+		SCOPE_LOCK(b->lock);
+restart:
+		for (int j = 0; j < BUFS_PER_BUCKET; j++) {
+			auto* bp = &buf_table[i * BUFS_PER_BUCKET + j];
+			if (bp->b_dev != dev)
+				continue;
+			if (ISSET(bp->b_flags, B_BUSY)) {
+				/* Wait for the owner to release it. */
+				DROP_LOCK(b->lock) {
+					mutex_lock(&bp->b_lock);
+					mutex_unlock(&bp->b_lock);
+				}
+				goto restart;
+			}
+			if (ISSET(bp->b_flags, B_DELWRI)) {
+				bio_writeout(b, bp);
+				goto restart;
+			}
 			bp->b_flags = B_INVAL;
 		}
 	}
 }
 
 /*
- * Invalidate all buffers.
+ * Flush all dirty buffers.
  * This is called when unmount.
  */
 void
 bio_sync(void)
 {
-	SCOPE_LOCK(bio_lock);
-start:
-	for (int i = 0; i < NBUFS; i++) {
-		auto* bp = &buf_table[i];
-		if (ISSET(bp->b_flags, B_BUSY)) {
-			DROP_LOCK(bio_lock) {
-				mutex_lock(&bp->b_lock);
-				mutex_unlock(&bp->b_lock);
+	for (int i = 0; i < NBUCKETS; i++) {
+		auto* b = &bucket_table[i];
+		SCOPE_LOCK(b->lock);
+restart:
+		for (int j = 0; j < BUFS_PER_BUCKET; j++) {
+			auto* bp = &buf_table[i * BUFS_PER_BUCKET + j];
+			if (ISSET(bp->b_flags, B_BUSY)) {
+				DROP_LOCK(b->lock) {
+					mutex_lock(&bp->b_lock);
+					mutex_unlock(&bp->b_lock);
+				}
+				goto restart;
+			}
+			if (ISSET(bp->b_flags, B_DELWRI)) {
+				bio_writeout(b, bp);
+				goto restart;
 			}
-			goto start;
 		}
-		if (ISSET(bp->b_flags, B_DELWRI))
-			bwrite(bp);
 	}
 }
 
@@ -358,10 +514,11 @@ bio_init(void)
 		auto* bp = &buf_table[i];
 		bp->b_flags = B_INVAL;
 		bp->b_data = malloc(BSIZE);
-		free_list.push_back(*bp);
+		bucket_of(bp)->free_list.push_back(*bp);
 	}
-	sem_init(&free_sem, 0, NBUFS);
+	for (int i = 0; i < NBUCKETS; i++)
+		sem_init(&bucket_table[i].free_sem, 0, BUFS_PER_BUCKET);
 
-	DPRINTF(VFSDB_BIO, ("bio: Buffer cache size %dK bytes\n",
-			    BSIZE * NBUFS / 1024));
+	DPRINTF(VFSDB_BIO, ("bio: Buffer cache size %dK bytes in %d buckets\n",
+			    BSIZE * NBUFS / 1024, NBUCKETS));
 }
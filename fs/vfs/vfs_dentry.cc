@@ -40,29 +40,80 @@
 
 #include <osv/dentry.h>
 #include <osv/vnode.h>
+#include <osv/rcu.hh>
+#include <osv/rcu-hashtable.hh>
 #include "vfs.h"
 
-#define DENTRY_BUCKETS 32
-
-static LIST_HEAD(dentry_hash_head, dentry) dentry_hash_table[DENTRY_BUCKETS];
-static LIST_HEAD(fake, dentry) fake;
-static mutex dentry_hash_lock;
+/*
+ * The dentry cache is an rcu_hashtable: dentry_lookup() walks it under the
+ * RCU read lock and takes a reference with a compare-exchange that refuses
+ * entries already dropped to zero, so the hot stat()/open() path takes no
+ * lock at all. All modifications - insert, remove, rename - and the final
+ * teardown of a dentry still serialize on dentry_hash_lock; the table
+ * resizes itself as the tree grows, so the lock only covers pointer
+ * manipulation, never a chain walk over an overloaded bucket.
+ *
+ * A dentry found by a racing reader may be concurrently torn down, so the
+ * memory the reader inspects - the dentry itself and its d_path string -
+ * is only freed after an RCU grace period.
+ */
 
 /*
  * Get the hash value from the mount point and path name.
- * XXX: replace with a better hash for 64-bit pointers.
+ * FNV-1a, folding the mount pointer in as a final round; unlike the old
+ * shift-and-add hash, it mixes well in the high bits, which is what the
+ * table's power-of-two bucket mask looks at.
  */
-static u_int
+static size_t
 dentry_hash(struct mount *mp, const char *path)
 {
-    u_int val = 0;
+    size_t val = 0xcbf29ce484222325UL;
 
     if (path) {
         while (*path) {
-            val = ((val << 5) + val) + *path++;
+            val = (val ^ (unsigned char) *path++) * 0x100000001b3UL;
         }
     }
-    return (val ^ (unsigned long) mp) & (DENTRY_BUCKETS - 1);
+    return (val ^ (unsigned long) mp) * 0x100000001b3UL;
+}
+
+struct dentry_ptr_hash {
+    size_t operator()(struct dentry* dp) const {
+        return dentry_hash(dp->d_mount, dp->d_path);
+    }
+};
+
+// key for lookups by (mount, path), avoiding a temporary dentry
+struct dentry_lookup_key {
+    struct mount* mp;
+    const char* path;
+};
+
+struct dentry_key_hash {
+    size_t operator()(const dentry_lookup_key& k) const {
+        return dentry_hash(k.mp, k.path);
+    }
+};
+
+struct dentry_key_compare {
+    bool operator()(const dentry_lookup_key& k, struct dentry* dp) const {
+        return dp->d_mount == k.mp && !strncmp(dp->d_path, k.path, PATH_MAX);
+    }
+};
+
+static osv::rcu_hashtable<struct dentry*, dentry_ptr_hash> dentry_hash_table(512);
+static mutex dentry_hash_lock;
+
+// Erase dp from the hash table if it is still there. Entries are removed
+// ahead of their last drele() by dentry_remove() and dentry_move(), so
+// absence is not an error. Called with dentry_hash_lock held.
+static void
+dentry_hash_remove_locked(struct dentry *dp)
+{
+    auto i = dentry_hash_table.owner_find(dp);
+    if (i) {
+        dentry_hash_table.erase(i);
+    }
 }
 
 
@@ -96,7 +147,7 @@ dentry_alloc(struct dentry *parent_dp, struct vnode *vp, const char *path)
     vn_add_name(vp, dp);
 
     mutex_lock(&dentry_hash_lock);
-    LIST_INSERT_HEAD(&dentry_hash_table[dentry_hash(mp, path)], dp, d_link);
+    dentry_hash_table.insert(dp);
     mutex_unlock(&dentry_hash_lock);
     return dp;
 };
@@ -104,18 +155,27 @@ dentry_alloc(struct dentry *parent_dp, struct vnode *vp, const char *path)
 struct dentry *
 dentry_lookup(struct mount *mp, char *path)
 {
-    struct dentry *dp;
-
-    mutex_lock(&dentry_hash_lock);
-    LIST_FOREACH(dp, &dentry_hash_table[dentry_hash(mp, path)], d_link) {
-        if (dp->d_mount == mp && !strncmp(dp->d_path, path, PATH_MAX)) {
-            dp->d_refcnt++;
-            mutex_unlock(&dentry_hash_lock);
-            return dp;
+    struct dentry *dp = nullptr;
+
+    WITH_LOCK(osv::rcu_read_lock) {
+        auto i = dentry_hash_table.reader_find(dentry_lookup_key{mp, path},
+                dentry_key_hash(), dentry_key_compare());
+        if (i) {
+            // Take a reference, unless a concurrent drele() already
+            // dropped the entry to zero - such a dentry is on its way
+            // out of the table and must not be resurrected.
+            struct dentry *found = *i;
+            int r = found->d_refcnt.load(std::memory_order_relaxed);
+            while (r != 0) {
+                if (found->d_refcnt.compare_exchange_weak(r, r + 1,
+                        std::memory_order_relaxed)) {
+                    dp = found;
+                    break;
+                }
+            }
         }
     }
-    mutex_unlock(&dentry_hash_lock);
-    return nullptr;                /* not found */
+    return dp;                /* null when not found */
 }
 
 static void dentry_children_remove(struct dentry *dp)
@@ -126,7 +186,7 @@ static void dentry_children_remove(struct dentry *dp)
         LIST_FOREACH(entry, &dp->d_children, d_children_link) {
             ASSERT(entry);
             ASSERT(entry->d_refcnt > 0);
-            LIST_REMOVE(entry, d_link);
+            dentry_hash_remove_locked(entry);
         }
     }
 }
@@ -156,29 +216,28 @@ dentry_move(struct dentry *dp, struct dentry *parent_dp, char *path)
         // Remove all dp's child dentries from the hashtable.
         dentry_children_remove(dp);
         // Remove dp with outdated hash info from the hashtable.
-        LIST_REMOVE(dp, d_link);
+        dentry_hash_remove_locked(dp);
         // Update dp.
         dp->d_path = strdup(path);
         dp->d_parent = parent_dp;
         // Insert dp updated hash info into the hashtable.
-        LIST_INSERT_HEAD(&dentry_hash_table[dentry_hash(dp->d_mount, path)],
-            dp, d_link);
+        dentry_hash_table.insert(dp);
     }
 
     if (old_pdp) {
         drele(old_pdp);
     }
 
-    free(old_path);
+    // A concurrent dentry_lookup() may still be comparing against the old
+    // path, so only free it after a grace period.
+    osv::rcu_defer([old_path] { free(old_path); });
 }
 
 void
 dentry_remove(struct dentry *dp)
 {
     mutex_lock(&dentry_hash_lock);
-    LIST_REMOVE(dp, d_link);
-    /* put it on a fake list for drele() to work*/
-    LIST_INSERT_HEAD(&fake, dp, d_link);
+    dentry_hash_remove_locked(dp);
     mutex_unlock(&dentry_hash_lock);
 }
 
@@ -188,9 +247,7 @@ dref(struct dentry *dp)
     ASSERT(dp);
     ASSERT(dp->d_refcnt > 0);
 
-    mutex_lock(&dentry_hash_lock);
-    dp->d_refcnt++;
-    mutex_unlock(&dentry_hash_lock);
+    dp->d_refcnt.fetch_add(1, std::memory_order_relaxed);
 }
 
 void
@@ -199,16 +256,17 @@ drele(struct dentry *dp)
     ASSERT(dp);
     ASSERT(dp->d_refcnt > 0);
 
-    mutex_lock(&dentry_hash_lock);
     if (--dp->d_refcnt) {
-        mutex_unlock(&dentry_hash_lock);
         return;
     }
-    LIST_REMOVE(dp, d_link);
-    vn_del_name(dp->d_vnode, dp);
-
+    // The count hit zero and dentry_lookup() refuses to resurrect such an
+    // entry, so from here the dentry is exclusively ours.
+    mutex_lock(&dentry_hash_lock);
+    dentry_hash_remove_locked(dp);
     mutex_unlock(&dentry_hash_lock);
 
+    vn_del_name(dp->d_vnode, dp);
+
     if (dp->d_parent) {
         WITH_LOCK(dp->d_parent->d_lock) {
             // Remove dp from its parent's children list.
@@ -219,16 +277,17 @@ drele(struct dentry *dp)
 
     vrele(dp->d_vnode);
 
-    free(dp->d_path);
-    free(dp);
+    // A reader which lost the compare-exchange race above may still be
+    // looking at the dentry and its path.
+    osv::rcu_defer([dp] {
+        free(dp->d_path);
+        free(dp);
+    });
 }
 
 void
 dentry_init(void)
 {
-    int i;
-
-    for (i = 0; i < DENTRY_BUCKETS; i++) {
-        LIST_INIT(&dentry_hash_table[i]);
-    }
+    // The hash table is a global object and needs no explicit setup; it
+    // starts at a modest size and resizes itself as dentries accumulate.
 }
@@ -8,18 +8,133 @@
 
 #include <fcntl.h>
 #include <sys/stat.h>
+#include <algorithm>
+#include <atomic>
+#include <memory>
 #include <osv/file.h>
 #include <osv/poll.h>
 #include <fs/vfs/vfs.h>
 #include <osv/vfs_file.hh>
+#include <osv/device.h>
 #include <osv/mmu.hh>
 #include <osv/pagecache.hh>
+#include <osv/sched.hh>
+#include <osv/mutex.h>
+#include <osv/vfs-notify.hh>
+#include <osv/workqueue.hh>
+#include <fs/fs.hh>
 
 vfs_file::vfs_file(unsigned flags)
 	: file(flags, DTYPE_VNODE)
 {
 }
 
+// Generic readahead, driven by the sequential-read detection in
+// vfs_file::read() below. The low-priority workqueue reads the next
+// window of the file through the regular VOP_READ path into a scratch
+// buffer and discards the data - the point is to populate whatever cache
+// the filesystem itself keeps (the ZFS ARC, the ROFS segment cache, the
+// buffer cache), so the application's next reads are served from memory.
+// Because the prefetched data is never handed to the application directly,
+// this stays coherent with writes no matter which path they take.
+
+namespace {
+
+constexpr size_t ra_window = 256 * 1024;
+constexpr size_t ra_chunk = 64 * 1024;
+constexpr unsigned ra_queue_max = 16;
+
+std::atomic<unsigned> ra_pending{0};
+
+void ra_run(vfs_file *fp, off_t offset, size_t len)
+{
+	struct vnode *vp = fp->f_dentry->d_vnode;
+	std::unique_ptr<char[]> buf(new (std::nothrow) char[ra_chunk]);
+	if (!buf) {
+		return;
+	}
+	while (len) {
+		iovec io[1];
+		io[0].iov_base = buf.get();
+		io[0].iov_len = std::min(len, ra_chunk);
+		uio data;
+		data.uio_iov = io;
+		data.uio_iovcnt = 1;
+		data.uio_offset = offset;
+		data.uio_resid = io[0].iov_len;
+		data.uio_rw = UIO_READ;
+		vn_lock(vp);
+		int error = VOP_READ(vp, fp, &data, 0);
+		vn_unlock(vp);
+		auto bytes = io[0].iov_len - data.uio_resid;
+		if (error || bytes == 0) {
+			break;
+		}
+		offset += bytes;
+		len -= bytes;
+	}
+}
+
+} // namespace
+
+void vfs_file_read_ahead_done(vfs_file *fp)
+{
+	fp->_ra_inflight.store(false, std::memory_order_release);
+}
+
+void vfs_file_read_ahead(vfs_file *fp, off_t offset, size_t len)
+{
+	if (ra_pending.fetch_add(1, std::memory_order_relaxed) >= ra_queue_max) {
+		// Too much prefetch already queued - this is only a
+		// hint, so drop it rather than pile up behind a slow device.
+		ra_pending.fetch_sub(1, std::memory_order_relaxed);
+		fp->_ra_inflight.store(false, std::memory_order_release);
+		return;
+	}
+	fileref ref(fp);
+	workqueue::queue(workqueue::prio::low, [ref, offset, len] {
+		auto fp = static_cast<vfs_file *>(ref.get());
+		ra_run(fp, offset, len);
+		vfs_file_read_ahead_done(fp);
+		ra_pending.fetch_sub(1, std::memory_order_relaxed);
+	});
+}
+
+// Called with the vnode lock held, after a successful read of count bytes
+// at offset. Tracks whether this file is being read sequentially, and once
+// a few back-to-back reads are seen, schedules readahead of the next
+// window beyond what was already prefetched.
+void vfs_file::consider_read_ahead(struct vnode *vp, off_t offset, size_t count)
+{
+	if (vp->v_type != VREG || count == 0) {
+		return;
+	}
+	if (offset == _next_read_offset) {
+		++_seq_streak;
+	} else {
+		_seq_streak = 0;
+		_ra_next = 0;
+	}
+	_next_read_offset = offset + count;
+	if (_seq_streak < 4) {
+		return;
+	}
+	auto target = std::max(_ra_next, _next_read_offset);
+	if (target >= vp->v_size) {
+		return;
+	}
+	auto len = std::min((off_t)ra_window, vp->v_size - target);
+	bool inflight = false;
+	if (!_ra_inflight.compare_exchange_strong(inflight, true,
+			std::memory_order_acq_rel)) {
+		// The previous window is still being fetched; don't queue up
+		// unbounded prefetch behind a slow device.
+		return;
+	}
+	_ra_next = target + len;
+	vfs_file_read_ahead(this, target, len);
+}
+
 int vfs_file::close()
 {
 	auto fp = this;
@@ -33,6 +148,9 @@ int vfs_file::close()
 	if (error)
 		return error;
 
+	vfs_notify::notify(vp, (fp->f_flags & FWRITE) ?
+			   IN_CLOSE_WRITE : IN_CLOSE_NOWRITE);
+
 	fp->f_dentry.reset();
 	return 0;
 }
@@ -47,15 +165,24 @@ int vfs_file::read(struct uio *uio, int flags)
 
 	bytes = uio->uio_resid;
 
+	int ioflags = 0;
+	if (fp->f_flags & O_DIRECT)
+		ioflags |= IO_DIRECT;
+
 	vn_lock(vp);
 	if ((flags & FOF_OFFSET) == 0)
 		uio->uio_offset = fp->f_offset;
 
-	error = VOP_READ(vp, fp, uio, 0);
+	off_t offset = uio->uio_offset;
+	error = VOP_READ(vp, fp, uio, ioflags);
 	if (!error) {
 		count = bytes - uio->uio_resid;
 		if ((flags & FOF_OFFSET) == 0)
 			fp->f_offset += count;
+		// A self-caching application explicitly asked us not to
+		// cache on its behalf, so don't prefetch either.
+		if (!(ioflags & IO_DIRECT))
+			consider_read_ahead(vp, offset, count);
 	}
 	vn_unlock(vp);
 
@@ -80,6 +207,8 @@ int vfs_file::write(struct uio *uio, int flags)
 		ioflags |= IO_APPEND;
 	if (fp->f_flags & (O_DSYNC|O_SYNC))
 		ioflags |= IO_SYNC;
+	if (fp->f_flags & O_DIRECT)
+		ioflags |= IO_DIRECT;
 
 	if ((flags & FOF_OFFSET) == 0)
 	        uio->uio_offset = fp->f_offset;
@@ -92,6 +221,9 @@ int vfs_file::write(struct uio *uio, int flags)
 	}
 
 	vn_unlock(vp);
+	if (!error) {
+		vfs_notify::notify(vp, IN_MODIFY);
+	}
 	return error;
 }
 
@@ -143,6 +275,11 @@ bool vfs_file::map_page(uintptr_t off, mmu::hw_ptep<0> ptep, mmu::pt_element<0>
     return pagecache::get(this, off, ptep, pte, write, shared);
 }
 
+bool vfs_file::cached_page(uintptr_t off)
+{
+    return pagecache::is_cached(this, off);
+}
+
 bool vfs_file::put_page(void *addr, uintptr_t off, mmu::hw_ptep<0> ptep)
 {
     return pagecache::release(this, addr, off, ptep);
@@ -182,6 +319,20 @@ std::unique_ptr<mmu::file_vma> vfs_file::mmap(addr_range range, unsigned flags,
 {
 	auto fp = this;
 	struct vnode *vp = fp->f_dentry->d_vnode;
+	// device nodes backed by a physical region (e.g. ivshmem shared
+	// memory) map that region directly instead of copying through read()
+	if (vp->v_type == VCHR || vp->v_type == VBLK) {
+		uintptr_t paddr;
+		size_t size;
+		if (device_mmap((device*)vp->v_data, &paddr, &size) == 0) {
+			if (offset < 0 ||
+			    (size_t)offset + (range.end() - range.start()) > size) {
+				throw make_error(ENXIO);
+			}
+			return mmu::map_phys_mmap(this, range, flags, perm,
+						  paddr, offset);
+		}
+	}
 	if (!vp->v_op->vop_cache || (vp->v_size < (off_t)mmu::page_size)) {
 		return mmu::default_file_mmap(this, range, flags, perm, offset);
 	}
@@ -37,6 +37,37 @@
 #include <osv/vnode.h>
 #include "vfs.h"
 
+/*
+ * A PATH_MAX string that carries its length. namei() appends one
+ * component per directory level; with plain strlcat() every append
+ * rescanned the whole path built so far, making a deep lookup quadratic
+ * in its length. Appends through this type truncate the way strlcat()
+ * does - the buffer stays NUL-terminated and an overlong path is cut
+ * short, not overflowed.
+ */
+struct path_buf {
+    char   data[PATH_MAX];
+    size_t len;
+
+    path_buf() : len(0) { data[0] = '\0'; }
+    void clear() {
+        data[0] = '\0';
+        len = 0;
+    }
+    void set(const char *s) {
+        size_t n = strlcpy(data, s, sizeof(data));
+        len = n < sizeof(data) ? n : sizeof(data) - 1;
+    }
+    void append(const char *s, size_t n) {
+        if (n > sizeof(data) - 1 - len) {
+            n = sizeof(data) - 1 - len;
+        }
+        memcpy(data + len, s, n);
+        len += n;
+        data[len] = '\0';
+    }
+};
+
 static ssize_t
 read_link(struct vnode *vp, char *buf, size_t bufsz, ssize_t *sz)
 {
@@ -58,7 +89,7 @@ read_link(struct vnode *vp, char *buf, size_t bufsz, ssize_t *sz)
 }
 
 int
-namei_follow_link(struct dentry *dp, char *node, char *name, char *fp, size_t mountpoint_len)
+namei_follow_link(struct dentry *dp, path_buf &node, path_buf &name, char *fp, size_t mountpoint_len)
 {
     std::unique_ptr<char []> link (new char[PATH_MAX]);
     std::unique_ptr<char []> t (new char[PATH_MAX]);
@@ -75,21 +106,22 @@ namei_follow_link(struct dentry *dp, char *node, char *name, char *fp, size_t mo
     }
     lp[sz] = 0;
 
-    p = fp + mountpoint_len + strlen(node);
-    c = strlen(node) - strlen(name) - 1;
-    node[c] = 0;
+    p = fp + mountpoint_len + node.len;
+    c = node.len - name.len - 1;
+    node.data[c] = 0;
+    node.len = c;
 
     if (lp[0] == '/') {
         strlcat(lp, p, PATH_MAX);
         strlcpy(fp, lp, PATH_MAX);
     } else {
         strlcpy(t.get(), p, PATH_MAX);
-        strlcpy(node, fp, mountpoint_len + c + 1);
-        path_conv(node, lp, fp);
+        strlcpy(node.data, fp, mountpoint_len + c + 1);
+        path_conv(node.data, lp, fp);
         strlcat(fp, t.get(), PATH_MAX);
     }
-    node[0] = 0;
-    name[0] = 0;
+    node.clear();
+    name.clear();
     return (0);
 }
 /*
@@ -102,19 +134,22 @@ int
 namei(const char *path, struct dentry **dpp)
 {
     char *p;
-    char node[PATH_MAX];
-    char name[PATH_MAX];
+    path_buf node;
+    path_buf name;
     std::unique_ptr<char []> fp (new char [PATH_MAX]);
     std::unique_ptr<char []> t (new char [PATH_MAX]);
     struct mount *mp;
     struct dentry *dp, *ddp;
     struct vnode *dvp, *vp;
-    int error, i;
+    int error;
     int links_followed;
     bool need_continue;
 
     DPRINTF(VFSDB_VNODE, ("namei: path=%s\n", path));
 
+    /* If a lazy background mount still covers this path, wait for it */
+    vfs_wait_pending_mount(path);
+
     links_followed = 0;
     strlcpy(fp.get(), path, PATH_MAX);
 
@@ -128,9 +163,9 @@ namei(const char *path, struct dentry **dpp)
             return ENOTDIR;
         }
         int mountpoint_len = p - fp.get() - 1;
-        strlcpy(node, "/", sizeof(node));
-        strlcat(node, p, sizeof(node));
-        dp = dentry_lookup(mp, node);
+        node.set("/");
+        node.append(p, strlen(p));
+        dp = dentry_lookup(mp, node.data);
         if (dp) {
             /* vnode is already active. */
             *dpp = dp;
@@ -147,7 +182,7 @@ namei(const char *path, struct dentry **dpp)
         }
         dref(ddp);
 
-        node[0] = '\0';
+        node.clear();
 
         while (*p != '\0') {
             /*
@@ -161,41 +196,56 @@ namei(const char *path, struct dentry **dpp)
                 break;
             }
 
-            for (i = 0; i < PATH_MAX; i++) {
-                if (*p == '\0' || *p == '/') {
-                    break;
-                }
-                name[i] = *p++;
+            const char *end = p;
+            while (*end != '\0' && *end != '/') {
+                end++;
             }
-            name[i] = '\0';
+            name.clear();
+            name.append(p, end - p);
+            p = const_cast<char *>(end);
 
             /*
              * Get a vnode for the target.
              */
-            strlcat(node, "/", sizeof(node));
-            strlcat(node, name, sizeof(node));
-            dvp = ddp->d_vnode;
-            vn_lock(dvp);
-            dp = dentry_lookup(mp, node);
+            node.append("/", 1);
+            node.append(name.data, name.len);
+            /*
+             * Try the dentry cache before touching the parent vnode:
+             * lookups are lock-free, and a hit means we don't need the
+             * directory at all, so a walk over cached components never
+             * serializes on vnode mutexes (the same trust the full-path
+             * fast path above has always extended to the cache).
+             */
+            dp = dentry_lookup(mp, node.data);
             if (dp == nullptr) {
-                /* Find a vnode in this directory. */
-                error = VOP_LOOKUP(dvp, name, &vp);
-                if (error) {
-                    vn_unlock(dvp);
-                    drele(ddp);
-                    return error;
-                }
-
-                dp = dentry_alloc(ddp, vp, node);
-                vput(vp);
-
-                if (!dp) {
-                    vn_unlock(dvp);
-                    drele(ddp);
-                    return ENOMEM;
+                dvp = ddp->d_vnode;
+                vn_lock(dvp);
+                /*
+                 * A concurrent walk may have filled the cache while we
+                 * took the lock - recheck before asking the filesystem,
+                 * so we don't allocate a duplicate dentry.
+                 */
+                dp = dentry_lookup(mp, node.data);
+                if (dp == nullptr) {
+                    /* Find a vnode in this directory. */
+                    error = VOP_LOOKUP(dvp, name.data, &vp);
+                    if (error) {
+                        vn_unlock(dvp);
+                        drele(ddp);
+                        return error;
+                    }
+
+                    dp = dentry_alloc(ddp, vp, node.data);
+                    vput(vp);
+
+                    if (!dp) {
+                        vn_unlock(dvp);
+                        drele(ddp);
+                        return ENOMEM;
+                    }
                 }
+                vn_unlock(dvp);
             }
-            vn_unlock(dvp);
             drele(ddp);
             ddp = dp;
 
@@ -208,13 +258,13 @@ namei(const char *path, struct dentry **dpp)
 
                 drele(dp);
 
-                p       = fp.get();
-                dp      = nullptr;
-                ddp     = nullptr;
-                vp      = nullptr;
-                dvp     = nullptr;
-                name[0] = 0;
-                node[0] = 0;
+                p   = fp.get();
+                dp  = nullptr;
+                ddp = nullptr;
+                vp  = nullptr;
+                dvp = nullptr;
+                name.clear();
+                node.clear();
 
                 if (++links_followed >= MAXSYMLINKS) {
                     return (ELOOP);
@@ -251,7 +301,7 @@ namei_last_nofollow(char *path, struct dentry *ddp, struct dentry **dpp)
     struct dentry *dp;
     struct vnode  *dvp;
     struct vnode  *vp;
-    std::unique_ptr<char []> node (new char[PATH_MAX]);
+    std::unique_ptr<path_buf> node (new path_buf);
 
     dvp  = nullptr;
 
@@ -270,26 +320,34 @@ namei_last_nofollow(char *path, struct dentry *ddp, struct dentry **dpp)
         return (ENOTDIR);
     }
 
-    strlcpy(node.get(), "/", PATH_MAX);
-    strlcat(node.get(), p, PATH_MAX);
+    node->set("/");
+    node->append(p, strlen(p));
 
     // We want to treat things like /tmp/ the same as /tmp. Best way to do that
     // is to ignore the last character, except when we're stating the root.
-    auto l = strlen(node.get()) - 1;
-    if (l && node.get()[l] == '/') {
-        node.get()[l] = '\0';
+    auto l = node->len - 1;
+    if (l && node->data[l] == '/') {
+        node->data[l] = '\0';
+        node->len = l;
+    }
+
+    // A cache hit needs no locks; see the component loop in namei().
+    dp = dentry_lookup(mp, node->data);
+    if (dp != nullptr) {
+        *dpp = dp;
+        return (0);
     }
 
     dvp = ddp->d_vnode;
     vn_lock(dvp);
-    dp = dentry_lookup(mp, node.get());
+    dp = dentry_lookup(mp, node->data);
     if (dp == nullptr) {
         error = VOP_LOOKUP(dvp, name, &vp);
         if (error != 0) {
             goto out;
         }
 
-        dp = dentry_alloc(ddp, vp, node.get());
+        dp = dentry_alloc(ddp, vp, node->data);
         vput(vp);
 
         if (dp == nullptr) {
@@ -53,6 +53,7 @@
 #include <osv/prex.h>
 #include <osv/vnode.h>
 #include <osv/vfs_file.hh>
+#include <osv/vfs-notify.hh>
 #include <osv/export.h>
 #include "vfs.h"
 #include <fs/fs.hh>
@@ -136,6 +137,9 @@ sys_open(char *path, int flags, mode_t mode, struct file **fpp)
 			mode |= S_IFREG;
 			error = VOP_CREATE(ddp->d_vnode, filename, mode);
 			vn_unlock(ddp->d_vnode);
+			if (!error)
+				vfs_notify::notify_name(ddp->d_vnode,
+							filename, IN_CREATE);
 			drele(ddp);
 
 			if (error)
@@ -198,6 +202,7 @@ sys_open(char *path, int flags, mode_t mode, struct file **fpp)
 		error = VOP_TRUNCATE(vp, 0);
 		if (error)
 			goto out_vn_unlock;
+		vfs_notify::notify(vp, IN_MODIFY);
 	}
 
 	try {
@@ -320,6 +325,88 @@ sys_write(struct file *fp, const struct iovec *iov, size_t niov,
     return error;
 }
 
+// Kernel-internal copy between two regular files: the data moves through a
+// kernel bounce buffer and the filesystems' own caches only, never crossing
+// to user space and back. A null offset pointer means "use and advance the
+// file's own position", as in Linux's copy_file_range(2).
+int
+sys_copy_file_range(struct file *in_fp, off_t *in_offp, struct file *out_fp,
+    off_t *out_offp, size_t len, size_t *count)
+{
+    constexpr size_t chunk_size = 256 * 1024;
+
+    *count = 0;
+
+    if ((in_fp->f_flags & FREAD) == 0 || (out_fp->f_flags & FWRITE) == 0)
+        return EBADF;
+    if (out_fp->f_flags & O_APPEND)
+        return EBADF;
+    if (!in_fp->f_dentry || !out_fp->f_dentry)
+        return EINVAL;
+
+    struct vnode *in_vp = in_fp->f_dentry->d_vnode;
+    struct vnode *out_vp = out_fp->f_dentry->d_vnode;
+    if (in_vp->v_type == VDIR || out_vp->v_type == VDIR)
+        return EISDIR;
+    if (in_vp->v_type != VREG || out_vp->v_type != VREG)
+        return EINVAL;
+
+    off_t in_off = in_offp ? *in_offp : in_fp->f_offset;
+    off_t out_off = out_offp ? *out_offp : out_fp->f_offset;
+    if (in_off < 0 || out_off < 0)
+        return EINVAL;
+    // Overlapping ranges within the same file are not allowed
+    if (in_vp == out_vp && in_off < out_off + (off_t)len &&
+        out_off < in_off + (off_t)len)
+        return EINVAL;
+
+    std::unique_ptr<char[]> buf(
+        new (std::nothrow) char[std::min(len, chunk_size)]);
+    if (!buf && len != 0)
+        return ENOMEM;
+
+    int error = 0;
+    while (*count < len) {
+        struct iovec riov {buf.get(), std::min(len - *count, chunk_size)};
+        size_t nread = 0;
+        error = sys_read(in_fp, &riov, 1, in_off, &nread);
+        if (error || nread == 0) {
+            // error, or end of the input file
+            break;
+        }
+
+        struct iovec wiov {buf.get(), nread};
+        size_t nwritten = 0;
+        error = sys_write(out_fp, &wiov, 1, out_off, &nwritten);
+        if (error)
+            break;
+
+        in_off += nread;
+        out_off += nwritten;
+        *count += nwritten;
+        if (nwritten < nread) {
+            // short write
+            break;
+        }
+    }
+
+    if (*count > 0) {
+        // A partial copy reports the bytes copied, not the error
+        error = 0;
+    }
+    if (!error) {
+        if (in_offp)
+            *in_offp = in_off;
+        else
+            in_fp->f_offset = in_off;
+        if (out_offp)
+            *out_offp = out_off;
+        else
+            out_fp->f_offset = out_off;
+    }
+    return error;
+}
+
 int
 sys_lseek(struct file *fp, off_t off, int type, off_t *origin)
 {
@@ -548,6 +635,9 @@ sys_mkdir(char *path, mode_t mode)
 	mode |= S_IFDIR;
 
 	error = VOP_MKDIR(ddp->d_vnode, name, mode);
+	if (!error)
+		vfs_notify::notify_name(ddp->d_vnode, name,
+					IN_CREATE | IN_ISDIR);
  out:
 	vn_unlock(ddp->d_vnode);
 	drele(ddp);
@@ -589,6 +679,12 @@ sys_rmdir(char *path)
 	error = VOP_RMDIR(ddp->d_vnode, vp, name);
 	vn_unlock(ddp->d_vnode);
 
+	if (!error) {
+		vfs_notify::notify(vp, IN_DELETE_SELF | IN_ISDIR);
+		vfs_notify::notify_name(ddp->d_vnode, name,
+					IN_DELETE | IN_ISDIR);
+	}
+
 	vn_unlock(vp);
 	dentry_remove(dp);
 	drele(ddp);
@@ -804,6 +900,16 @@ sys_rename(char *src, char *dest)
 
 	error = VOP_RENAME(dvp1, vp1, sname, dvp2, vp2, dname);
 
+	if (!error) {
+		uint32_t isdir = (vp1->v_type == VDIR) ? IN_ISDIR : 0;
+		uint32_t cookie = vfs_notify::next_cookie();
+		vfs_notify::notify_name(dvp1, sname,
+					IN_MOVED_FROM | isdir, cookie);
+		vfs_notify::notify_name(dvp2, dname,
+					IN_MOVED_TO | isdir, cookie);
+		vfs_notify::notify(vp1, IN_MOVE_SELF);
+	}
+
 	dentry_move(dp1, ddp2, dname);
 	if (dp2)
 		dentry_remove(dp2);
@@ -879,6 +985,9 @@ sys_symlink(const char *oldpath, const char *newpath)
 		goto out;
 	}
 	error = VOP_SYMLINK(newdirdp->d_vnode, name, op);
+	if (error == 0) {
+		vfs_notify::notify_name(newdirdp->d_vnode, name, IN_CREATE);
+	}
 
 out:
 	if (newdirdp != nullptr) {
@@ -941,6 +1050,8 @@ sys_link(char *oldpath, char *newpath)
 	}
 
 	error = VOP_LINK(newdirdp->d_vnode, vp, name);
+	if (!error)
+		vfs_notify::notify_name(newdirdp->d_vnode, name, IN_CREATE);
  out1:
 	vn_unlock(newdirdp->d_vnode);
 	drele(newdirdp);
@@ -996,6 +1107,11 @@ sys_unlink(char *path)
 	error = VOP_REMOVE(ddp->d_vnode, vp, name);
 	vn_unlock(ddp->d_vnode);
 
+	if (!error) {
+		vfs_notify::notify(vp, IN_DELETE_SELF);
+		vfs_notify::notify_name(ddp->d_vnode, name, IN_DELETE);
+	}
+
 	vn_unlock(vp);
 	dentry_remove(dp);
 	drele(ddp);
@@ -1133,6 +1249,9 @@ sys_truncate(char *path, off_t length)
 	error = VOP_TRUNCATE(dp->d_vnode, length);
 	vn_unlock(dp->d_vnode);
 
+	if (!error)
+		vfs_notify::notify(dp->d_vnode, IN_MODIFY);
+
 	drele(dp);
 	return error;
 }
@@ -1151,6 +1270,9 @@ sys_ftruncate(struct file *fp, off_t length)
 	error = VOP_TRUNCATE(vp, length);
 	vn_unlock(vp);
 
+	if (!error)
+		vfs_notify::notify(vp, IN_MODIFY);
+
 	return error;
 }
 
@@ -1301,6 +1423,9 @@ sys_utimes(char *path, const struct timeval times[2], int flags)
         error = vn_settimes(dp->d_vnode, timespec_times);
     }
 
+    if (!error)
+        vfs_notify::notify(dp->d_vnode, IN_ATTRIB);
+
     drele(dp);
     return error;
 }
@@ -1397,6 +1522,9 @@ sys_utimensat(int dirfd, const char *pathname, const struct timespec times[2], i
         error = vn_settimes(dp->d_vnode, timespec_times);
     }
 
+    if (!error)
+        vfs_notify::notify(dp->d_vnode, IN_ATTRIB);
+
     drele(dp);
     return error;
 }
@@ -1447,7 +1575,9 @@ sys_fallocate(struct file *fp, int mode, loff_t offset, loff_t len)
     // NOTE: It's not detected here whether or not the device underlying
     // the fs is a block device. It's up to the fs itself tell us whether
     // or not fallocate is supported. See below:
-    if (vp->v_type != VREG && vp->v_type != VDIR) {
+    // Block device nodes are allowed through as well - devfs translates
+    // the request into the device's discard/write-zeroes commands.
+    if (vp->v_type != VREG && vp->v_type != VDIR && vp->v_type != VBLK) {
         error = ENODEV;
         goto ret;
     }
@@ -1478,6 +1608,8 @@ sys_chmod(const char *path, mode_t mode)
         error = EROFS;
     } else {
         error = vn_setmode(dp->d_vnode, mode);
+        if (!error)
+            vfs_notify::notify(dp->d_vnode, IN_ATTRIB);
     }
     drele(dp);
     return error;
@@ -1500,6 +1632,9 @@ sys_fchmod(int fd, mode_t mode)
     if (f->f_dentry->d_mount->m_flags & MNT_RDONLY) {
         return EROFS;
     } else {
-        return vn_setmode(f->f_dentry->d_vnode, mode);
+        int error = vn_setmode(f->f_dentry->d_vnode, mode);
+        if (!error)
+            vfs_notify::notify(f->f_dentry->d_vnode, IN_ATTRIB);
+        return error;
     }
 }
@@ -42,6 +42,7 @@
 #include <osv/prex.h>
 #include <osv/vnode.h>
 #include <osv/export.h>
+#include <osv/brwlock.hh>
 #include "vfs.h"
 
 OSV_LIBSOLARIS_API
@@ -81,11 +82,18 @@ static LIST_HEAD(vnode_hash_head, vnode) vnode_table[VNODE_BUCKETS];
  * Global lock to access all vnodes and vnode table.
  * If a vnode is already locked, there is no need to
  * lock this global lock to access internal data.
+ *
+ * Lookups vastly outnumber table changes (a vnode is inserted on first
+ * open and removed when its last reference goes away), so this is a
+ * big-reader lock: concurrent vget()s of already-cached vnodes take only
+ * the read side, which touches no shared cache line. Reference counts
+ * are no longer covered by this lock and are maintained atomically.
  */
-static mutex_t vnode_lock = MUTEX_INITIALIZER;
-#define VNODE_LOCK()	mutex_lock(&vnode_lock)
-#define VNODE_UNLOCK()	mutex_unlock(&vnode_lock)
-#define VNODE_OWNED()	mutex_owned(&vnode_lock)
+static brwlock vnode_lock;
+#define VNODE_RLOCK()	vnode_lock.rlock()
+#define VNODE_RUNLOCK()	vnode_lock.runlock()
+#define VNODE_WLOCK()	vnode_lock.wlock()
+#define VNODE_WUNLOCK()	vnode_lock.wunlock()
 
 /*
  * Get the hash value from the mount point and path name.
@@ -98,22 +106,20 @@ vn_hash(struct mount *mp, uint64_t ino)
 }
 
 /*
- * Returns locked vnode for specified mount point and path.
- * vn_lock() will increment the reference count of vnode.
+ * Returns referenced (but not locked) vnode for specified mount point
+ * and inode. The caller locks the vnode after dropping vnode_lock; the
+ * reference taken here keeps it from being removed meanwhile.
  *
- * Locking: VNODE_LOCK must be held.
+ * Locking: vnode_lock must be held, for reading or writing.
  */
 struct vnode *
 vn_lookup(struct mount *mp, uint64_t ino)
 {
 	struct vnode *vp;
 
-	assert(VNODE_OWNED());
 	LIST_FOREACH(vp, &vnode_table[vn_hash(mp, ino)], v_link) {
 		if (vp->v_mount == mp && vp->v_ino == ino) {
-			vp->v_refcnt++;
-			mutex_lock(&vp->v_lock);
-			vp->v_nrlocks++;
+			__sync_fetch_and_add(&vp->v_refcnt, 1);
 			return vp;
 		}
 	}
@@ -178,17 +184,35 @@ vget(struct mount *mp, uint64_t ino, struct vnode **vpp)
 
 	DPRINTF(VFSDB_VNODE, ("vget %LLu\n", ino));
 
-	VNODE_LOCK();
+	VNODE_RLOCK();
+	vp = vn_lookup(mp, ino);
+	VNODE_RUNLOCK();
+	if (vp) {
+		/*
+		 * Locking the vnode must wait for vnode_lock to be dropped:
+		 * the current holder of v_lock may be a vput() waiting for
+		 * the write side.
+		 */
+		mutex_lock(&vp->v_lock);
+		vp->v_nrlocks++;
+		*vpp = vp;
+		return 1;
+	}
 
+	VNODE_WLOCK();
+
+	/* The lock was dropped after the miss - somebody may have raced us */
 	vp = vn_lookup(mp, ino);
 	if (vp) {
-		VNODE_UNLOCK();
+		VNODE_WUNLOCK();
+		mutex_lock(&vp->v_lock);
+		vp->v_nrlocks++;
 		*vpp = vp;
 		return 1;
 	}
 
 	if (!(vp = new vnode())) {
-		VNODE_UNLOCK();
+		VNODE_WUNLOCK();
 		return 0;
 	}
 
@@ -203,7 +227,7 @@ vget(struct mount *mp, uint64_t ino, struct vnode **vpp)
 	 * Request to allocate fs specific data for vnode.
 	 */
 	if ((error = VFS_VGET(mp, vp)) != 0) {
-		VNODE_UNLOCK();
+		VNODE_WUNLOCK();
 		delete vp;
 		return error;
 	}
@@ -212,13 +236,44 @@ vget(struct mount *mp, uint64_t ino, struct vnode **vpp)
 	vp->v_nrlocks++;
 
 	LIST_INSERT_HEAD(&vnode_table[vn_hash(mp, ino)], vp, v_link);
-	VNODE_UNLOCK();
+	VNODE_WUNLOCK();
 
 	*vpp = vp;
 
 	return 0;
 }
 
+/*
+ * Drop one reference to the vnode. Returns 1 if this was the last
+ * reference and the vnode was removed from the table (the caller must
+ * deallocate it), 0 otherwise.
+ *
+ * The fast path only decrements while other references remain, so it
+ * never races with removal. The final drop is decided under the write
+ * lock, where a vget() cannot concurrently revive the vnode.
+ */
+static int
+vn_drop_ref(struct vnode *vp)
+{
+	int refs = __atomic_load_n(&vp->v_refcnt, __ATOMIC_RELAXED);
+	while (refs > 1) {
+		if (__atomic_compare_exchange_n(&vp->v_refcnt, &refs, refs - 1,
+				true, __ATOMIC_RELEASE, __ATOMIC_RELAXED)) {
+			return 0;
+		}
+	}
+
+	VNODE_WLOCK();
+	if (__sync_fetch_and_add(&vp->v_refcnt, -1) > 1) {
+		/* A vget() revived the vnode before we got the lock. */
+		VNODE_WUNLOCK();
+		return 0;
+	}
+	LIST_REMOVE(vp, v_link);
+	VNODE_WUNLOCK();
+	return 1;
+}
+
 /*
  * Unlock vnode and decrement its reference count.
  */
@@ -230,15 +285,10 @@ vput(struct vnode *vp)
 	ASSERT(vp->v_refcnt > 0);
 	DPRINTF(VFSDB_VNODE, ("vput: ref=%d %s\n", vp->v_refcnt, vn_path(vp)));
 
-	VNODE_LOCK();
-	vp->v_refcnt--;
-	if (vp->v_refcnt > 0) {
-	    VNODE_UNLOCK();
+	if (!vn_drop_ref(vp)) {
 		vn_unlock(vp);
 		return;
 	}
-	LIST_REMOVE(vp, v_link);
-	VNODE_UNLOCK();
 
 	/*
 	 * Deallocate fs specific vnode data
@@ -261,10 +311,8 @@ vref(struct vnode *vp)
 	ASSERT(vp);
 	ASSERT(vp->v_refcnt > 0);	/* Need vget */
 
-	VNODE_LOCK();
 	DPRINTF(VFSDB_VNODE, ("vref: ref=%d\n", vp->v_refcnt));
-	vp->v_refcnt++;
-	VNODE_UNLOCK();
+	__sync_fetch_and_add(&vp->v_refcnt, 1);
 }
 
 /*
@@ -279,15 +327,10 @@ vrele(struct vnode *vp)
 	ASSERT(vp);
 	ASSERT(vp->v_refcnt > 0);
 
-	VNODE_LOCK();
 	DPRINTF(VFSDB_VNODE, ("vrele: ref=%d\n", vp->v_refcnt));
-	vp->v_refcnt--;
-	if (vp->v_refcnt > 0) {
-		VNODE_UNLOCK();
+	if (!vn_drop_ref(vp)) {
 		return;
 	}
-	LIST_REMOVE(vp, v_link);
-	VNODE_UNLOCK();
 
 	/*
 	 * Deallocate fs specific vnode data
@@ -453,7 +496,7 @@ vnode_dump(void)
 	char type[][6] = { "VNON ", "VREG ", "VDIR ", "VBLK ", "VCHR ",
 			   "VLNK ", "VSOCK", "VFIFO" };
 
-	VNODE_LOCK();
+	VNODE_RLOCK();
 	kprintf("Dump vnode\n");
 	kprintf(" vnode    mount    type  refcnt blkno    path\n");
 	kprintf(" -------- -------- ----- ------ -------- ------------------------------\n");
@@ -469,7 +512,7 @@ vnode_dump(void)
 		}
 	}
 	kprintf("\n");
-	VNODE_UNLOCK();
+	VNODE_RUNLOCK();
 }
 #endif
 
@@ -27,11 +27,13 @@ int dax_manager<W>::read(virtiofs_inode& inode, uint64_t file_handle,
 
     // Necessary pre-declarations due to goto below
     size_t to_map;
-    chunk nchunks;
+    chunk nchunks, fchunks;
     int error;
+    bool sequential;
     mapping_part mp;
     chunk fstart = uio.uio_offset / _chunk_size;
     off_t coffset = uio.uio_offset % _chunk_size; // offset within chunk
+    sequential = (inode.nodeid == _ra_nodeid && fstart == _ra_next);
     if (find(inode.nodeid, fstart, mp)) {
         // Requested data (at least some initial) is already mapped
         auto read_amt_act = std::min<size_t>(read_amt,
@@ -55,6 +57,17 @@ int dax_manager<W>::read(virtiofs_inode& inode, uint64_t file_handle,
     if (to_map % _chunk_size > 0) {
         nchunks++;
     }
+    if (sequential) {
+        // The reader is sequential: set up the chunks ahead of it in the
+        // same FUSE_SETUPMAPPING request as the ones it asked for, so its
+        // next reads are served from the window without a device round-trip
+        nchunks += DEFAULT_READAHEAD_CHUNKS;
+    }
+    // Do not map past the last chunk of the file, or more than the window
+    // can hold
+    fchunks = (inode.attr.size + _chunk_size - 1) / _chunk_size;
+    nchunks = std::min(nchunks, fchunks - fstart);
+    nchunks = std::min(nchunks, _window_chunks);
     // NOTE: This relies on the fact that requesting a mapping longer than the
     // remaining file works (see mmap() on the host). If that didn't work, we
     // would have to request exact mappings (byte-granularity, rather than
@@ -74,6 +87,10 @@ out:
     error = uiomove(const_cast<void*>(req_data), read_amt_act, &uio);
     if (error) {
         kprintf("[virtiofs] inode %lld, uiomove failed\n", inode.nodeid);
+    } else {
+        // Remember where this read left off, to detect sequential readers
+        _ra_nodeid = inode.nodeid;
+        _ra_next = uio.uio_offset / _chunk_size;
     }
     return error;
 }
@@ -82,90 +99,125 @@ template<typename W>
 int dax_manager<W>::map(uint64_t nodeid, uint64_t file_handle, chunk nchunks,
     chunk fstart, mapping_part& mapped, bool evict)
 {
-    // If necessary, unmap just enough chunks
-    auto empty = _window_chunks - first_empty();
-    if (evict && empty < nchunks) {
+    // If necessary, evict least-recently-used mappings until a gap large
+    // enough opens up
+    chunk gstart, glen;
+    best_gap(nchunks, gstart, glen);
+    while (evict && glen < nchunks && !_mappings.empty()) {
         mapping_part mp;
-        auto error = unmap(nchunks - empty, mp, false);
+        auto error = evict_lru(mp);
         if (error) {
             return error;
         }
-        empty += mp.nchunks;
+        best_gap(nchunks, gstart, glen);
     }
-    auto to_map = std::min<chunk>(nchunks, empty);
+    auto to_map = std::min<chunk>(nchunks, glen);
     if (to_map == 0) {
         // The window is full and evict is false, or nchunks is 0
-        mapped.mstart = _window_chunks - empty;
+        mapped.mstart = gstart;
         mapped.nchunks = 0;
         return (nchunks == 0) ? 0 : ENOBUFS;
     }
 
     // Map new chunks
-    auto mstart = _window_chunks - empty;
+    auto mstart = gstart;
     auto error = _window.map(nodeid, file_handle, to_map * _chunk_size,
         fstart * _chunk_size, mstart * _chunk_size);
     if (error) {
         return error;
     }
-    if (!_mappings.empty()) {
-        auto& m {_mappings.back()};
-        if (m.nodeid == nodeid && m.fstart + m.nchunks == fstart) {
-            // Extend previous mapping
+    // Keep _mappings sorted by mstart
+    auto it = std::upper_bound(_mappings.begin(), _mappings.end(), mstart,
+        [](chunk m, const mapping& a) { return m < a.mstart; });
+    if (it != _mappings.begin()) {
+        auto& m {*std::prev(it)};
+        if (m.nodeid == nodeid && m.fstart + m.nchunks == fstart &&
+            m.mstart + m.nchunks == mstart) {
+            // Extend previous mapping, adjacent in both the file and the
+            // window
             m.nchunks += to_map;
+            m.last_used = ++_use_clock;
             mapped.mstart = mstart;
             mapped.nchunks = to_map;
             return 0;
         }
     }
-    _mappings.emplace_back(nodeid, to_map, fstart, mstart);
+    auto m = _mappings.emplace(it, nodeid, to_map, fstart, mstart);
+    m->last_used = ++_use_clock;
     mapped.mstart = mstart;
     mapped.nchunks = to_map;
     return 0;
 }
 
 template<typename W>
-int dax_manager<W>::unmap(chunk nchunks, mapping_part& unmapped, bool deep)
+void dax_manager<W>::best_gap(chunk nchunks, chunk& gstart, chunk& glen) const
 {
-    // Determine necessary changes
-    chunk to_unmap = 0;
-    auto erase_first {_mappings.cend()};
-    chunk to_unmap_from_last = 0;
-    for (auto it {_mappings.crbegin()};
-        to_unmap < nchunks && it != _mappings.crend(); it++) {
+    gstart = 0;
+    glen = 0;
+    chunk pos = 0; // one past the end of the preceding mapping
+    for (auto& m : _mappings) {
+        if (m.mstart - pos > glen) {
+            gstart = pos;
+            glen = m.mstart - pos;
+            if (glen >= nchunks) {
+                return;
+            }
+        }
+        pos = m.mstart + m.nchunks;
+    }
+    if (_window_chunks - pos > glen) {
+        gstart = pos;
+        glen = _window_chunks - pos;
+    }
+    if (glen == 0) {
+        // No free chunks at all; report one past the last mapping
+        gstart = pos;
+    }
+}
 
-        if (it->nchunks <= nchunks - to_unmap) {
-            // Remove *it
-            erase_first = it.base() - 1;
-            to_unmap += it->nchunks;
-        } else {
-            // Modify *it
-            to_unmap_from_last = nchunks - to_unmap;
-            to_unmap = nchunks;
+template<typename W>
+int dax_manager<W>::evict_lru(mapping_part& evicted)
+{
+    auto victim = _mappings.end();
+    for (auto it = _mappings.begin(); it != _mappings.end(); it++) {
+        if (victim == _mappings.end() ||
+            it->last_used < victim->last_used ||
+            (it->last_used == victim->last_used &&
+             it->hits < victim->hits)) {
+            victim = it;
         }
     }
-    if (to_unmap == 0) {
-        // The window is empty, or nchunks is 0
-        unmapped.mstart = first_empty();
-        unmapped.nchunks = 0;
-        return (nchunks == 0) ? 0 : ENODATA;
+    if (victim == _mappings.end()) {
+        return ENODATA;
     }
 
-    // Apply changes
-    if (deep) {
-        auto mstart = first_empty() - to_unmap;
-        auto error = _window.unmap(to_unmap * _chunk_size,
-            mstart * _chunk_size);
+    auto error = _window.unmap(victim->nchunks * _chunk_size,
+        victim->mstart * _chunk_size);
+    if (error) {
+        return error;
+    }
+    evicted.mstart = victim->mstart;
+    evicted.nchunks = victim->nchunks;
+    _mappings.erase(victim);
+    return 0;
+}
+
+template<typename W>
+int dax_manager<W>::unmap(chunk nchunks, chunk& unmapped)
+{
+    unmapped = 0;
+    while (unmapped < nchunks && !_mappings.empty()) {
+        mapping_part mp;
+        auto error = evict_lru(mp);
         if (error) {
             return error;
         }
+        unmapped += mp.nchunks;
     }
-    _mappings.erase(erase_first, _mappings.cend());
-    if (to_unmap_from_last > 0) {
-        _mappings.back().nchunks -= to_unmap_from_last;
+    if (unmapped == 0 && nchunks > 0) {
+        // The window is empty
+        return ENODATA;
     }
-
-    unmapped.mstart = first_empty();
-    unmapped.nchunks = to_unmap;
     return 0;
 }
 
@@ -247,7 +299,6 @@ int dax_window_impl::unmap(uint64_t len, uint64_t mstart)
 
 template<typename W>
 bool dax_manager<W>::find(uint64_t nodeid, chunk fstart, mapping_part& found)
-    const
 {
     for (auto& m : _mappings) {
         if (m.nodeid == nodeid &&
@@ -258,6 +309,8 @@ bool dax_manager<W>::find(uint64_t nodeid, chunk fstart, mapping_part& found)
             auto excess = fstart - m.fstart; // excess contained in m
             found.nchunks = m.nchunks - excess;
             found.mstart = m.mstart + excess;
+            m.hits++;
+            m.last_used = ++_use_clock;
             return true;
         }
     }
@@ -265,13 +318,13 @@ bool dax_manager<W>::find(uint64_t nodeid, chunk fstart, mapping_part& found)
 }
 
 template<typename W>
-typename dax_manager<W>::chunk dax_manager<W>::first_empty() const
+typename dax_manager<W>::chunk dax_manager<W>::free_chunks() const
 {
-    if (_mappings.empty()) {
-        return 0;
+    chunk used = 0;
+    for (auto& m : _mappings) {
+        used += m.nchunks;
     }
-    auto& m {_mappings.back()};
-    return m.mstart + m.nchunks;
+    return _window_chunks - used;
 }
 
 // Explicitly instantiate the only uses of dax_manager.
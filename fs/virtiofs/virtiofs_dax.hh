@@ -70,14 +70,18 @@ private:
     u64 _len;
 };
 
-// A manager for the DAX window of a virtio-fs device. This implements a
-// straight-forward scheme for file mappings:
+// A manager for the DAX window of a virtio-fs device. This implements the
+// following scheme for file mappings:
 // - The window is split into equally-sized chunks. Each mapping occupies an
 //   integer amount of consecutive chunks.
-// - New mappings are placed on the lowest available chunks in the window.
-// - When there are not enough chunks available for a new mapping, the highest
-//   (i.e. most recently mapped) chunks occupied are evicted. Thus, chunks are
-//   mapped in a LIFO manner (the window resembles a stack).
+// - New mappings are placed in the first gap of free chunks large enough to
+//   hold them.
+// - When no such gap exists, the least-recently-used mappings are evicted
+//   until one opens up. Each mapping carries a hit counter and a last-use
+//   stamp, bumped on every read served from it.
+// - When a sequential reader is detected, chunks ahead of it are set up in
+//   the same FUSE_SETUPMAPPING request as the ones it faulted on, so
+//   subsequent reads are served from the window without a device round-trip.
 template<typename W>
 class dax_manager {
 public:
@@ -105,6 +109,10 @@ protected:
     // Helper type to better distinguish referring to chunks vs bytes
     using chunk = size_t;
 
+    // How many chunks to set up ahead of a sequential reader (8MiB with the
+    // default chunk size)
+    static constexpr chunk DEFAULT_READAHEAD_CHUNKS = 4;
+
     struct mapping {
         mapping(uint64_t _nodeid, chunk _nchunks, chunk _fstart, chunk _mstart)
             : nodeid {_nodeid},
@@ -115,6 +123,10 @@ protected:
         chunk nchunks;
         chunk fstart;
         chunk mstart;
+        // Reads served from this mapping
+        uint64_t hits = 0;
+        // _use_clock value of the last read served from this mapping
+        uint64_t last_used = 0;
     };
 
     struct mapping_part {
@@ -123,30 +135,45 @@ protected:
     };
 
     // Map up to @nchunks chunks of the file with @nodeid, starting at chunk
-    // @fstart of the file, after all other mappings. If @evict, evict other
-    // chunks if necessary. Returns in @mapped the new mapping and non-zero on
-    // failure. Called with _lock held (for writing).
+    // @fstart of the file, into the first gap large enough. If @evict, evict
+    // least-recently-used mappings if necessary. Returns in @mapped the new
+    // mapping and non-zero on failure. Called with _lock held (for writing).
     int map(uint64_t nodeid, uint64_t file_handle, chunk nchunks, chunk fstart,
         mapping_part& mapped, bool evict = false);
-    // Unmap @nchunks last chunks, also doing an actual unmapping on the device
-    // if @deep. Returns in @unmapped what was unmapped and non-zero on failure.
-    // Called with _lock held (for writing).
-    int unmap(chunk nchunks, mapping_part& unmapped, bool deep = false);
+    // Evict least-recently-used mappings until at least @nchunks chunks have
+    // been freed (or the window is empty). Returns in @unmapped how many
+    // chunks were freed and non-zero on failure. Called with _lock held (for
+    // writing).
+    int unmap(chunk nchunks, chunk& unmapped);
 
     // Return in @found the largest contiguous existing mapping for @nodeid
-    // starting at @fstart. If none found, returns false. Called with _lock held
+    // starting at @fstart, bumping its hit counter and last-use stamp. If
+    // none found, returns false. Called with _lock held (for writing).
+    bool find(uint64_t nodeid, chunk fstart, mapping_part& found);
+    // Return in @gstart/@glen the first gap of free chunks at least @nchunks
+    // long, or the largest gap if there is none such. Called with _lock held
+    // (for reading).
+    void best_gap(chunk nchunks, chunk& gstart, chunk& glen) const;
+    // Evict the least-recently-used mapping, unmapping it on the device.
+    // Returns in @evicted what was evicted, non-zero on failure and ENODATA
+    // if the window is empty. Called with _lock held (for writing).
+    int evict_lru(mapping_part& evicted);
+    // Returns the number of free chunks in the window. Called with _lock held
     // (for reading).
-    bool find(uint64_t nodeid, chunk fstart, mapping_part& found) const;
-    // Returns the first empty chunk in the window, or one-past-the-last if the
-    // window is full. Called with _lock held (for reading).
-    chunk first_empty() const;
+    chunk free_chunks() const;
 
     W _window;
     const size_t _chunk_size;
     const chunk _window_chunks;
     // TODO OPT: Switch to rwlock
     mutex _lock;
+    // Kept sorted by mstart
     std::vector<mapping> _mappings;
+    // Monotonic stamp source for mapping::last_used
+    uint64_t _use_clock = 0;
+    // Where the last read left off, to detect sequential readers
+    uint64_t _ra_nodeid = 0;
+    chunk _ra_next = 0;
 };
 
 using dax_manager_impl = dax_manager<dax_window_impl>;
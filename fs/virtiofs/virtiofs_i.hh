@@ -8,6 +8,7 @@
 #ifndef VIRTIOFS_IO_H
 #define VIRTIOFS_IO_H
 
+#include <memory>
 #include <utility>
 
 #include "drivers/virtio-fs.hh"
@@ -16,4 +17,16 @@ std::pair<size_t, int> fuse_req_send_and_receive_reply(virtio::fs* drv,
     uint32_t opcode, uint64_t nodeid, void* input_args_data,
     size_t input_args_size, void* output_args_data, size_t output_args_size);
 
+// Construct a request for the batch submission API below. Returns nullptr on
+// allocation failure.
+std::unique_ptr<virtio::fs::fuse_request> fuse_req_create(uint32_t opcode,
+    uint64_t nodeid, void* input_args_data, size_t input_args_size,
+    void* output_args_data, size_t output_args_size);
+
+// Submit @count requests with a single kick and wait for all of them to
+// complete, so independent requests get pipelined by the device. The caller
+// inspects each request's out_header for the per-request result.
+int fuse_req_send_batch(virtio::fs* drv, virtio::fs::fuse_request** reqs,
+    int count);
+
 #endif
@@ -33,14 +33,34 @@ static struct {
     mutex lock;
 } dax_managers;
 
-std::pair<size_t, int> fuse_req_send_and_receive_reply(virtio::fs* drv,
-    uint32_t opcode, uint64_t nodeid, void* input_args_data,
-    size_t input_args_size, void* output_args_data, size_t output_args_size)
+// Operations which the device is expected to answer quickly (metadata served
+// from virtiofsd's caches, in microseconds), making it worthwhile to poll for
+// the completion before going to sleep.
+static bool fuse_op_is_quick(uint32_t opcode)
+{
+    switch (opcode) {
+    case FUSE_LOOKUP:
+    case FUSE_GETATTR:
+    case FUSE_READLINK:
+    case FUSE_OPEN:
+    case FUSE_OPENDIR:
+    case FUSE_RELEASE:
+    case FUSE_RELEASEDIR:
+    case FUSE_STATFS:
+        return true;
+    default:
+        return false;
+    }
+}
+
+std::unique_ptr<fuse_request> fuse_req_create(uint32_t opcode, uint64_t nodeid,
+    void* input_args_data, size_t input_args_size, void* output_args_data,
+    size_t output_args_size)
 {
     std::unique_ptr<fuse_request> req {
         new (std::nothrow) fuse_request(sched::thread::current())};
     if (!req) {
-        return std::make_pair(0, ENOMEM);
+        return nullptr;
     }
     req->in_header.len = sizeof(req->in_header) + input_args_size;
     req->in_header.opcode = opcode;
@@ -54,12 +74,38 @@ std::pair<size_t, int> fuse_req_send_and_receive_reply(virtio::fs* drv,
     req->output_args_data = output_args_data;
     req->output_args_size = output_args_size;
 
+    return req;
+}
+
+int fuse_req_send_batch(virtio::fs* drv, fuse_request** reqs, int count)
+{
+    assert(drv);
+    int error = drv->make_requests(reqs, count);
+    if (error) {
+        return error;
+    }
+    for (int i = 0; i < count; i++) {
+        reqs[i]->wait();
+    }
+    return 0;
+}
+
+std::pair<size_t, int> fuse_req_send_and_receive_reply(virtio::fs* drv,
+    uint32_t opcode, uint64_t nodeid, void* input_args_data,
+    size_t input_args_size, void* output_args_data, size_t output_args_size)
+{
+    auto req = fuse_req_create(opcode, nodeid, input_args_data,
+        input_args_size, output_args_data, output_args_size);
+    if (!req) {
+        return std::make_pair(0, ENOMEM);
+    }
+
     assert(drv);
     int error = drv->make_request(*req);
     if (error) {
         return std::make_pair(0, error);
     }
-    req->wait();
+    drv->wait_request(*req, fuse_op_is_quick(opcode));
 
     // return the length of the response's payload
     size_t len = req->out_header.len - sizeof(fuse_out_header);
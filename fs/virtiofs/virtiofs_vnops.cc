@@ -30,6 +30,8 @@
 #include "virtiofs_dax.hh"
 #include "virtiofs_i.hh"
 
+using fuse_request = virtio::fs::fuse_request;
+
 static constexpr uint32_t OPEN_FLAGS = O_RDONLY;
 
 int virtiofs_init()
@@ -192,33 +194,86 @@ static int virtiofs_readlink(struct vnode* vnode, struct uio* uio)
     return uiomove(link_path.get(), strlen(link_path.get()), uio);
 }
 
+// Max bytes per FUSE_READ request and max requests submitted as one batch.
+// Large reads are split into chunks which are all submitted with a single
+// kick, so the device processes them in a pipeline instead of one sleep/wake
+// round trip per request. The chunk size also bounds the physically
+// contiguous allocations.
+static constexpr u32 read_chunk_size = 64 * 1024;
+static constexpr int read_batch_max = 8;
+
 // Read @read_amt bytes from @inode, using the fallback FUSE_READ mechanism.
 static int virtiofs_read_fallback(virtiofs_inode& inode, u64 file_handle,
     u32 read_amt, u32 flags, virtio::fs& drv, struct uio& uio)
 {
-    std::unique_ptr<fuse_read_in> in_args {new (std::nothrow) fuse_read_in()};
-    std::unique_ptr<void, std::function<void(void*)>> buf {
-        memory::alloc_phys_contiguous_aligned(read_amt,
-        alignof(std::max_align_t)), memory::free_phys_contiguous_aligned };
-    if (!in_args || !buf) {
-        return ENOMEM;
-    }
-    in_args->fh = file_handle;
-    in_args->offset = uio.uio_offset;
-    in_args->size = read_amt;
-    in_args->flags = flags;
-
     virtiofs_debug("inode %lld, reading %lld bytes at offset %lld\n",
         inode.nodeid, read_amt, uio.uio_offset);
-    auto error = fuse_req_send_and_receive_reply(&drv, FUSE_READ,
-        inode.nodeid, in_args.get(), sizeof(*in_args), buf.get(),
-        read_amt).second;
-    if (error) {
-        kprintf("[virtiofs] inode %lld, read failed\n", inode.nodeid);
-        return error;
+
+    while (read_amt > 0) {
+        auto nreq = std::min<int>(read_batch_max,
+            (read_amt + read_chunk_size - 1) / read_chunk_size);
+
+        std::unique_ptr<fuse_read_in> in_args[read_batch_max];
+        std::unique_ptr<void, std::function<void(void*)>>
+            bufs[read_batch_max];
+        std::unique_ptr<fuse_request> reqs[read_batch_max];
+        fuse_request* reqps[read_batch_max];
+
+        u32 batch_amt = 0;
+        for (int i = 0; i < nreq; i++) {
+            auto chunk = std::min(read_amt - batch_amt, read_chunk_size);
+
+            in_args[i].reset(new (std::nothrow) fuse_read_in());
+            bufs[i] = {memory::alloc_phys_contiguous_aligned(chunk,
+                alignof(std::max_align_t)),
+                memory::free_phys_contiguous_aligned};
+            if (!in_args[i] || !bufs[i]) {
+                return ENOMEM;
+            }
+            in_args[i]->fh = file_handle;
+            in_args[i]->offset = uio.uio_offset + batch_amt;
+            in_args[i]->size = chunk;
+            in_args[i]->flags = flags;
+
+            reqs[i] = fuse_req_create(FUSE_READ, inode.nodeid,
+                in_args[i].get(), sizeof(*in_args[i]), bufs[i].get(), chunk);
+            if (!reqs[i]) {
+                return ENOMEM;
+            }
+            reqps[i] = reqs[i].get();
+            batch_amt += chunk;
+        }
+
+        auto error = fuse_req_send_batch(&drv, reqps, nreq);
+        if (error) {
+            kprintf("[virtiofs] inode %lld, read failed\n", inode.nodeid);
+            return error;
+        }
+
+        u32 copied = 0;
+        for (int i = 0; i < nreq; i++) {
+            error = -reqs[i]->out_header.error;
+            if (error) {
+                kprintf("[virtiofs] inode %lld, read failed\n", inode.nodeid);
+                return error;
+            }
+            auto chunk = reqs[i]->output_args_size;
+            size_t len = reqs[i]->out_header.len - sizeof(fuse_out_header);
+            auto to_copy = std::min<size_t>(len, chunk);
+            error = uiomove(bufs[i].get(), to_copy, &uio);
+            if (error) {
+                return error;
+            }
+            copied += to_copy;
+            if (to_copy < chunk) {
+                // Short read (e.g. EOF on the host side) - drop the rest
+                return 0;
+            }
+        }
+        read_amt -= copied;
     }
 
-    return uiomove(buf.get(), read_amt, &uio);
+    return 0;
 }
 
 static int virtiofs_read(struct vnode* vnode, struct file* fp, struct uio* uio,
@@ -44,6 +44,17 @@ extern void register_pagecache_arc_funs(
     void (*_arc_buf_accessed_fun)(const uint64_t[4]),
     void (*_arc_buf_get_hashkey_fun)(arc_buf_t*, uint64_t[4]));
 
+extern int osv_zfs_zfetch_set(const char *name, uint64_t value);
+extern void osv_zfs_zfetch_stats(uint64_t *hits, uint64_t *misses,
+    uint64_t *stride_hits, uint64_t *stride_misses,
+    uint64_t *fetched_blocks, uint64_t *reclaim_failures);
+//The function below is part of kernel and is used to
+//register the prefetcher tunable/stats functions above as callbacks
+extern void register_osv_zfs_zfetch_funs(
+    int (*zfetch_set_fun)(const char*, uint64_t),
+    void (*zfetch_stats_fun)(uint64_t*, uint64_t*, uint64_t*,
+                             uint64_t*, uint64_t*, uint64_t*));
+
 extern struct vfsops zfs_vfsops;
 //The function below is part of kernel and is used to
 //update ZFS vfsops in the vfssw configuration struct
@@ -71,6 +82,9 @@ void __attribute__((constructor)) zfs_initialize(void) {
 
     //Register osv_zfs_ioctl() as callback in drivers/zfs.cc
     register_osv_zfs_ioctl(&osv_zfs_ioctl);
+    //Register the zfetch tunable setter and stats snapshot (dmu_zfetch.c)
+    //as callbacks in drivers/zfs.cc, for mount options and monitoring
+    register_osv_zfs_zfetch_funs(&osv_zfs_zfetch_set, &osv_zfs_zfetch_stats);
     //Register arc_lowmem() and arc_sized_adjust() as callbacks in arc_shrinker
     //implemented as part of bsd/porting/shrinker.cc
     register_shrinker_arc_funs(&arc_lowmem, &arc_sized_adjust);
@@ -14,6 +14,7 @@ extern "C" {
 #define __NEED_pid_t
 #define __NEED_gid_t
 #define __NEED_struct_iovec
+#define __NEED_struct_timespec
 
 #include <bits/alltypes.h>
 
@@ -268,6 +269,8 @@ ssize_t sendto (int, const void *, size_t, int, const struct sockaddr *, socklen
 ssize_t recvfrom (int, void *__restrict, size_t, int, struct sockaddr *__restrict, socklen_t *__restrict);
 ssize_t sendmsg (int, const struct msghdr *, int);
 ssize_t recvmsg (int, struct msghdr *, int);
+int sendmmsg (int, struct mmsghdr *, unsigned int, unsigned int);
+int recvmmsg (int, struct mmsghdr *, unsigned int, unsigned int, struct timespec *);
 
 int getsockopt (int, int, int, void *__restrict, socklen_t *__restrict);
 int setsockopt (int, int, int, const void *, socklen_t);
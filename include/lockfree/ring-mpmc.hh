@@ -0,0 +1,175 @@
+/*
+ * Copyright (C) 2026 Waldemar Kozaczuk
+ *
+ * This work is open source software, licensed under the terms of the
+ * BSD license as described in the LICENSE file in the top-level directory.
+ */
+
+//
+// multiple-producer / multiple-consumer lockless ring buffer of fixed
+// size, complementing the spsc and unordered mpsc variants.
+//
+#ifndef __LF_RING_MPMC_HH__
+#define __LF_RING_MPMC_HH__
+
+#include <atomic>
+#include <type_traits>
+#include <osv/sched.hh>
+#include <arch.hh>
+#include <osv/ilog2.hh>
+
+template<class T, typename COUNTER_TYPE, COUNTER_TYPE MaxSize, COUNTER_TYPE MaxSizeMask = MaxSize - 1>
+class ring_mpmc;
+
+namespace sched {
+
+//
+// Waiting protocol for a single blocking consumer, like the one
+// net_channel offers: poll the ring, park the consumer's thread handle
+// while empty, and have producers call wake_consumer() after pushing.
+// Concurrent non-blocking consumers may still pop() at any time.
+//
+template<class T, typename COUNTER_TYPE, COUNTER_TYPE MaxSize, COUNTER_TYPE MaxSizeMask>
+class wait_object<ring_mpmc<T, COUNTER_TYPE, MaxSize, MaxSizeMask>> {
+private:
+    ring_mpmc<T, COUNTER_TYPE, MaxSize, MaxSizeMask>& _ring;
+public:
+    explicit wait_object(ring_mpmc<T, COUNTER_TYPE, MaxSize, MaxSizeMask>& ring,
+                         mutex* mtx = nullptr) : _ring(ring) {}
+    bool poll() { return !_ring.empty(); }
+    void arm() { _ring._waiting_thread.reset(*sched::thread::current()); }
+    void disarm() { _ring._waiting_thread.clear(); }
+};
+
+}
+
+//
+// mpmc ring of fixed size
+//
+// Every slot carries a sequence number advancing in lockstep with the
+// producer and consumer tickets, so a producer (consumer) can tell
+// whether its slot has been drained (filled) without looking at the
+// opposite side's ticket, and threads that claimed different slots
+// never synchronize with each other. Slots are padded to a cache line
+// so concurrent producers do not false-share.
+//
+template<class T, typename COUNTER_TYPE, COUNTER_TYPE MaxSize, COUNTER_TYPE MaxSizeMask>
+class ring_mpmc {
+public:
+    ring_mpmc(): _push_ticket(0), _pop_ticket(0)
+    {
+        static_assert(is_power_of_two(MaxSize), "size must be a power of two");
+        for (COUNTER_TYPE i = 0; i < MaxSize; i++) {
+            _ring[i].seq.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    template<typename... Args>
+    inline bool emplace(Args&&... args)
+    {
+        COUNTER_TYPE ticket = _push_ticket.load(std::memory_order_relaxed);
+
+        for (;;) {
+            slot& s = _ring[ticket & MaxSizeMask];
+            //
+            // Acquire pairs with the consumer's release store below: once
+            // seq catches up with our ticket the slot's previous value has
+            // been fully read out.
+            //
+            COUNTER_TYPE seq = s.seq.load(std::memory_order_acquire);
+            auto dif = static_cast<counter_diff>(seq - ticket);
+
+            if (dif == 0) {
+                if (_push_ticket.compare_exchange_weak(ticket, ticket + 1,
+                        std::memory_order_relaxed)) {
+                    new (&s.value) T(std::forward<Args>(args)...);
+                    s.seq.store(ticket + 1, std::memory_order_release);
+                    return true;
+                }
+                // CAS failure reloaded ticket - retry with the new one
+            } else if (dif < 0) {
+                // The slot still holds an element from a lap ago: full
+                return false;
+            } else {
+                // Another producer overtook us; chase the shared ticket
+                ticket = _push_ticket.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    bool push(const T& element)
+    {
+        return emplace(element);
+    }
+
+    bool pop(T& element)
+    {
+        COUNTER_TYPE ticket = _pop_ticket.load(std::memory_order_relaxed);
+
+        for (;;) {
+            slot& s = _ring[ticket & MaxSizeMask];
+            COUNTER_TYPE seq = s.seq.load(std::memory_order_acquire);
+            auto dif = static_cast<counter_diff>(seq - (ticket + 1));
+
+            if (dif == 0) {
+                if (_pop_ticket.compare_exchange_weak(ticket, ticket + 1,
+                        std::memory_order_relaxed)) {
+                    element = std::move(s.value);
+                    s.value.~T();
+                    //
+                    // Advancing seq by a full lap marks the slot free for
+                    // the producer that will claim this index next time
+                    // around; release orders it after the load above.
+                    //
+                    s.seq.store(ticket + MaxSize, std::memory_order_release);
+                    return true;
+                }
+            } else if (dif < 0) {
+                // No producer finished writing this slot yet: empty
+                return false;
+            } else {
+                ticket = _pop_ticket.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    /**
+     * May be called by any thread; the count is approximate while
+     * producers or consumers are in flight.
+     *
+     * @return the current number of the elements.
+     */
+    COUNTER_TYPE size() const {
+        COUNTER_TYPE push = _push_ticket.load(std::memory_order_relaxed);
+        COUNTER_TYPE pop = _pop_ticket.load(std::memory_order_relaxed);
+
+        return (push - pop);
+    }
+
+    bool empty() const {
+        return size() == 0;
+    }
+
+    // producer: wake the blocking consumer, if any (best used after
+    // multiple push()s)
+    void wake_consumer() {
+        _waiting_thread.wake();
+    }
+
+private:
+    using counter_diff = typename std::make_signed<COUNTER_TYPE>::type;
+
+    struct slot {
+        std::atomic<COUNTER_TYPE> seq;
+        T value;
+    } CACHELINE_ALIGNED;
+
+    std::atomic<COUNTER_TYPE> _push_ticket CACHELINE_ALIGNED;
+    std::atomic<COUNTER_TYPE> _pop_ticket CACHELINE_ALIGNED;
+    sched::thread_handle _waiting_thread CACHELINE_ALIGNED;
+    slot _ring[MaxSize];
+
+    friend class sched::wait_object<ring_mpmc>;
+};
+
+#endif // !__LF_RING_MPMC_HH__
@@ -51,6 +51,23 @@ public:
         } while (!_head.compare_exchange_weak(old, item, std::memory_order_release));
     }
     
+    /**
+     * Inserts a chain of objects already linked from first to last via
+     * their "next" fields, paying for a single atomic update instead of
+     * one per object.
+     *
+     * Preconditions:
+     *  - no object in the chain may be already queued
+     *  - first and last != nullptr
+     */
+    inline void push_many(LT* first, LT* last)
+    {
+        LT *old = _head.load(std::memory_order_relaxed);
+        do {
+            last->next = old;
+        } while (!_head.compare_exchange_weak(old, first, std::memory_order_release));
+    }
+
     /**
      * Removes some object and returns it or nullptr if there are no objects.
      *
@@ -0,0 +1,47 @@
+/*
+ * Copyright (C) 2026 Waldemar Kozaczuk
+ *
+ * This work is open source software, licensed under the terms of the
+ * BSD license as described in the LICENSE file in the top-level directory.
+ */
+
+#ifndef AES_GCM_HH_
+#define AES_GCM_HH_
+
+// AES-128-GCM sealing for in-kernel TLS record encryption (see
+// bsd/sys/netinet/tcp_tls.cc). This is a hardware-only implementation:
+// encryption runs on the AES-NI and PCLMULQDQ instructions, and
+// supported() tells whether the cpu has them. Callers are expected to
+// keep crypto in userspace when it does not - there is deliberately no
+// software fallback to misbehave silently on old cpus.
+
+#include <stdint.h>
+#include <stddef.h>
+#include <sys/uio.h>
+
+namespace crypto {
+
+class aes_gcm_128 {
+public:
+    // true when the cpu can run this implementation (AES-NI + PCLMULQDQ)
+    static bool supported();
+    // key is the 16-byte AES key, salt the 4-byte implicit nonce part
+    // (what RFC 5288 calls the salt)
+    void set_key(const uint8_t key[16], const uint8_t salt[4]);
+    // One-shot AEAD seal over a scattered buffer: authenticates aad,
+    // encrypts the iov buffers in place, and writes the 16-byte tag.
+    // nonce is the 8-byte explicit part of the GCM nonce - for TLS, the
+    // record sequence number.
+    void seal(uint64_t nonce, const uint8_t *aad, size_t aad_len,
+              const iovec *iov, int iovcnt, uint8_t tag[16]);
+private:
+    // expanded AES round keys and the GHASH key, kept as raw bytes so
+    // that this header stays free of x86 vector types
+    alignas(16) uint8_t _round_keys[11 * 16];
+    alignas(16) uint8_t _h[16];
+    uint8_t _salt[4];
+};
+
+}
+
+#endif /* AES_GCM_HH_ */
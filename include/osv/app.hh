@@ -199,6 +199,41 @@ public:
       */
     pid_t get_main_thread_id();
 
+    /**
+     * Enable or disable the application template cache. While enabled, the
+     * loaded ELF objects of every launched payload are kept resident, so
+     * running the same command again skips the ELF load and relocation and
+     * only pays for per-instance state (TLS areas, argv, stdio).
+     */
+    static void cache_app_templates(bool enabled);
+
+    /**
+     * Drop the cached template of a command, letting its ELF objects be
+     * unloaded once the last running instance exits.
+     */
+    static void remove_app_template(const std::string& command);
+
+    /**
+     * Set a soft cap on this application's heap usage. When the net bytes
+     * charged to the application cross the cap, the shrink callback runs
+     * in the allocating thread with the number of bytes over the cap,
+     * giving the application a chance to trim (drop caches, run GC) before
+     * guest-wide memory pressure kicks in. A cap of 0 disables the check.
+     * Call before the application allocates; the callback must not throw.
+     */
+    void set_mem_soft_cap(size_t cap, std::function<void(size_t)> shrink);
+
+    /**
+     * Net heap bytes charged to this application; an approximation when
+     * memory is freed from a different application context (see
+     * osv::app_mem_account in <osv/sched.hh>).
+     */
+    ssize_t allocated_memory() const {
+        return _mem_account.bytes.load(std::memory_order_relaxed);
+    }
+
+    app_mem_account& mem_account() { return _mem_account; }
+
     std::shared_ptr<application_runtime> runtime() const { return _runtime; }
     std::shared_ptr<elf::object> lib() const { return _lib; }
 
@@ -253,6 +288,7 @@ private:
     std::list<std::function<void()>> _termination_request_callbacks;
 
     std::shared_ptr<application_runtime> _runtime;
+    app_mem_account _mem_account;
     sched::thread* _joiner;
     std::atomic<bool> _terminated;
     std::function<void()> _post_main;
@@ -58,12 +58,16 @@ __BEGIN_DECLS
 #define BIO_SCSI	0x20
 #define BIO_CMD1	0x40	/* Available for local hacks */
 #define BIO_CMD2	0x80	/* Available for local hacks */
+#define BIO_ZERO	BIO_CMD1 /* write zeroes, see bdev_fallocate() */
 
 /* bio_flags */
 #define BIO_ERROR	0x01
 #define BIO_DONE	0x02
 #define BIO_ONQUEUE	0x04
 #define BIO_ORDERED	0x08
+#define BIO_MORE	0x10	/* More bios of the same chain follow; the
+				   driver may defer its doorbell until a bio
+				   without this flag arrives. */
 
 struct disk;
 struct bio;
@@ -123,6 +127,7 @@ void		destroy_bio(struct bio *bio);
 
 int		bio_wait(struct bio *bio);
 void		biodone(struct bio *bio, bool ok);
+void		bio_list_strategy(struct bio **bios, int count);
 struct devstat;
 void    biofinish(struct bio *bp, struct devstat *stat, int error);
 
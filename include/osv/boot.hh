@@ -2,10 +2,13 @@
 #define BOOT_HH
 
 #include "arch-setup.hh"
+#include <atomic>
 
 class time_element {
 public:
-    const char *str;
+    // Copied, not referenced - phase names may be built on the fly
+    // (driver names, mount points)
+    char str[64];
     u64 stamp;
 };
 
@@ -16,16 +19,29 @@ public:
     void event(int event_idx, const char *str, u64 stamp);
     void print_chart();
     void print_total_time();
+
+    // Read interface for the REST API (see osv_get_bootchart_events()):
+    // the number of recorded events, an event's phase name and its offset
+    // in milliseconds from the first event.
+    int count() const;
+    const char *entry_name(int index) const;
+    double entry_msec(int index);
+
+    static const int max_events = 48;
 private:
     // Can we keep it at 0 and let the initial two users increment it?  No, we
     // cannot. The reason is that the code that *parses* those fields run
     // relatively late (the code that takes the measure is so early it cannot
     // call this one directly. Therefore, the measurements would appear in the
     // middle of the list, and we want to preserve order.
-    int _event = 4;
-    time_element arrays[16];
+    // Atomic, since concurrent boot stages may record events in parallel
+    std::atomic<int> _event = {4};
+    time_element arrays[max_events];
 
     void print_one_time(int index);
     double to_msec(u64 time);
 };
+
+extern boot_time_chart boot_time;
+
 #endif
@@ -0,0 +1,101 @@
+/*
+ * Copyright (C) 2026 Waldemar Kozaczuk
+ *
+ * This work is open source software, licensed under the terms of the
+ * BSD license as described in the LICENSE file in the top-level directory.
+ */
+
+#ifndef __OSV_BRWLOCK_HH__
+#define __OSV_BRWLOCK_HH__
+
+#include <atomic>
+#include <osv/mutex.h>
+#include <osv/percpu.hh>
+#include <osv/sched.hh>
+#include <osv/waitqueue.hh>
+
+class brwlock;
+
+// adapters in the style of rwlock_for_read/rwlock_for_write, so a
+// brwlock can be used with WITH_LOCK() and friends:
+//
+//   WITH_LOCK(my_brwlock.for_read()) { ... }
+class brwlock_for_read {
+private:
+    brwlock_for_read() {}
+public:
+    void lock();
+    void unlock();
+    friend class brwlock;
+};
+
+class brwlock_for_write {
+private:
+    brwlock_for_write() {}
+public:
+    void lock();
+    void unlock();
+    friend class brwlock;
+};
+
+//
+// Big-reader rwlock. The plain rwlock takes its internal mutex on every
+// rlock()/runlock(), so read-mostly data pays for a shared cache line
+// bouncing between all reading cpus. Here each cpu counts its readers in
+// its own percpu slot and a read lock/unlock touches nothing shared; the
+// writer announces itself and then drains the readers by waiting for the
+// sum of all the percpu counts to reach zero, which makes wlock()
+// proportionally expensive - use this only when writes are rare.
+//
+// Unlike rwlock, the read lock must not be taken recursively while a
+// writer is waiting (the second rlock() would wait for the writer, which
+// waits for the first hold), and there is no upgrade or downgrade.
+//
+class brwlock : private brwlock_for_read, brwlock_for_write {
+public:
+    // Reader
+    void rlock();
+    void runlock();
+    brwlock_for_read& for_read() { return *this; }
+
+    // Writer
+    void wlock();
+    void wunlock();
+    bool wowned();
+    brwlock_for_write& for_write() { return *this; }
+
+private:
+    long readers();
+
+    friend class brwlock_for_read;
+    friend class brwlock_for_write;
+
+    dynamic_percpu<std::atomic<long>> _readers;
+    std::atomic<bool> _writer {false};
+    sched::thread* _wowner {nullptr};
+    mutex _wmtx;
+    waitqueue _read_waiters;
+    sched::thread_handle _writer_thread;
+};
+
+inline void brwlock_for_read::lock()
+{
+    static_cast<brwlock*>(this)->rlock();
+}
+
+inline void brwlock_for_read::unlock()
+{
+    static_cast<brwlock*>(this)->runlock();
+}
+
+inline void brwlock_for_write::lock()
+{
+    static_cast<brwlock*>(this)->wlock();
+}
+
+inline void brwlock_for_write::unlock()
+{
+    static_cast<brwlock*>(this)->wunlock();
+}
+
+#endif // !__OSV_BRWLOCK_HH__
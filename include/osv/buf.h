@@ -60,10 +60,13 @@ struct buf: boost::intrusive::list_base_hook<> {
 __BEGIN_DECLS
 struct buf *getblk(struct device *, int);
 int	bread(struct device *, int, struct buf **);
+/* Read up to *countp consecutive blocks; release with brelse_batch(). */
+int	bread_batch(struct device *, int, int *, struct buf **);
 int	bwrite(struct buf *);
 void	bdwrite(struct buf *);
 void	binval(struct device *);
 void	brelse(struct buf *);
+void	brelse_batch(struct buf **, int);
 void	bflush(struct buf *);
 void	bio_sync(void);
 void	bio_init(void);
@@ -0,0 +1,36 @@
+/*
+ * Copyright (C) 2026 Waldemar Kozaczuk
+ *
+ * This work is open source software, licensed under the terms of the
+ * BSD license as described in the LICENSE file in the top-level directory.
+ */
+
+#ifndef CRASHDUMP_HH_
+#define CRASHDUMP_HH_
+
+#include <cstddef>
+
+// Binary crash dumps for host-side postmortems. Subsystems register the
+// memory regions worth having after a panic (per-cpu trace rings, stats
+// blocks and the like) up front; abort() then serializes them all into a
+// buffer reserved at boot, framed with a magic header so fleet automation
+// can extract the dump from a guest memory snapshot without a console
+// attached. See core/crashdump.cc for the format and rationale.
+namespace crashdump {
+
+// Register a region to include in crash dumps. Call at boot or subsystem
+// setup time, not from panic context; the region must stay valid (and at
+// the same address) for the lifetime of the kernel.
+void register_region(const char* name, const void* addr, size_t size);
+
+// Reserve the dump buffer. Called once from loader option parsing; a dump
+// is only ever written if this succeeded.
+void reserve(size_t size);
+
+// Serialize all registered regions into the reserved buffer. Called from
+// abort() with interrupts disabled - must not allocate, lock or sleep.
+void dump(const char* msg);
+
+}
+
+#endif /* CRASHDUMP_HH_ */
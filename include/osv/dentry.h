@@ -13,9 +13,19 @@
 
 struct vnode;
 
+/* The reference count is manipulated with atomics so that dentry_lookup()
+ * can take a reference without serializing on a lock; the plain int spelling
+ * keeps the layout identical for C-interface consumers.
+ */
+#if defined(__cplusplus) && !defined(USE_C_INTERFACE)
+#include <atomic>
+typedef std::atomic<int> dentry_refcnt_t;
+#else
+typedef int dentry_refcnt_t;
+#endif
+
 struct dentry {
-	LIST_ENTRY(dentry) d_link;	/* link for hash list */
-	int		d_refcnt;	/* reference count */
+	dentry_refcnt_t	d_refcnt;	/* reference count */
 	char		*d_path;	/* pointer to path in fs */
 	struct vnode	*d_vnode;
 	struct mount	*d_mount;
@@ -68,6 +68,7 @@ typedef int (*devop_write_t)  (struct device *, struct uio *, int);
 typedef int (*devop_ioctl_t)  (struct device *, u_long, void *);
 typedef int (*devop_devctl_t) (struct device *, u_long, void *);
 typedef void (*devop_strategy_t)(struct bio *);
+typedef int (*devop_mmap_t)   (struct device *, uintptr_t *, size_t *);
 
 /*
  * Device operations
@@ -80,6 +81,10 @@ struct devops {
 	devop_ioctl_t	ioctl;
 	devop_devctl_t	devctl;
 	devop_strategy_t strategy;
+	/* optional: report the physical region backing this device, which
+	   makes the device node mmap-able (e.g. ivshmem shared memory);
+	   left null by drivers initializing only the fields above */
+	devop_mmap_t	mmap;
 };
 
 
@@ -90,6 +95,7 @@ struct devops {
 #define	no_ioctl	((devop_ioctl_t)enodev)
 #define	no_devctl	((devop_devctl_t)nullop)
 #define	no_strategy	((devop_strategy_t)nullop)
+#define	no_mmap		((devop_mmap_t)NULL)
 
 /*
  * Driver object
@@ -129,6 +135,7 @@ struct device {
 	off_t		offset; /* 0 for the main drive, if we have a partition, this is the start address */
 	size_t		max_io_size;
 	void		*private_data;	/* private storage */
+	void		*io_sched;	/* per-device I/O scheduler (fs/vfs/kern_iosched.cc) */
 
 	void *softc;
 	void *ivars;
@@ -192,11 +199,13 @@ int	 device_open(const char *, int, struct device **);
 int	 device_close(struct device *);
 int	 device_read(struct device *, struct uio *, int);
 int	 device_write(struct device *, struct uio *, int);
+int	 device_mmap(struct device *, uintptr_t *, size_t *);
 int	 device_ioctl(struct device *, u_long, void *);
 int	 device_info(struct devinfo *);
 
 int	 bdev_read(struct device *dev, struct uio *uio, int ioflags);
 int	 bdev_write(struct device *dev, struct uio *uio, int ioflags);
+int	 bdev_fallocate(struct device *dev, int mode, off_t offset, off_t len);
 
 int	enodev(void);
 int	nullop(void);
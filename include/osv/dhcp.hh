@@ -17,6 +17,7 @@
 #include <bsd/sys/netinet/udp.h>
 #include <osv/sched.hh>
 #include <osv/mutex.h>
+#include <osv/waitqueue.hh>
 #include <osv/debug.h>
 
 #include <boost/asio/ip/address.hpp>
@@ -26,6 +27,9 @@ extern "C" {
 void dhcp_start(bool wait);
 void dhcp_release();
 void dhcp_renew(bool wait);
+// Block until the initial DHCP exchange has assigned us an address. A no-op
+// when networking is static (DHCP never started) or already configured.
+void dhcp_wait_for_ip();
 }
 
 namespace dhcp {
@@ -242,12 +246,20 @@ namespace dhcp {
 
         bool is_acknowledged() { return (_state == DHCP_ACKNOWLEDGE); }
 
+        // When the worker thread should next act on this interface:
+        // retransmit a lost DISCOVER/REQUEST, or renew an expiring lease.
+        // time_point::max() means nothing is pending.
+        osv::clock::uptime::time_point deadline() const { return _deadline; }
+        void process_timeout();
+
     private:
         state _state;
         struct ifnet* _ifp;
         dhcp_socket* _sock;
         boost::asio::ip::address_v4 _client_addr;
         boost::asio::ip::address_v4 _server_addr;
+        osv::clock::uptime::time_point _deadline =
+            osv::clock::uptime::time_point::max();
 
         // Transaction id
         u32 _xid;
@@ -269,6 +281,8 @@ namespace dhcp {
         // Send release packet for all DHCP IPs.
         void release();
         void renew(bool wait);
+        // Block until some interface got an address acknowledged
+        void wait_for_ip();
 
         void dhcp_worker_fn();
         void queue_packet(struct mbuf* m);
@@ -282,7 +296,7 @@ namespace dhcp {
 
         // Wait for IP
         bool _have_ip;
-        sched::thread * _waiter;
+        waitqueue _ip_waiters;
         void _send_and_wait(bool wait, dhcp_interface_state_send_packet iface_func);
     };
 
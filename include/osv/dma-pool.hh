@@ -0,0 +1,96 @@
+/*
+ * Copyright (C) 2026 Waldemar Kozaczuk
+ *
+ * This work is open source software, licensed under the terms of the
+ * BSD license as described in the LICENSE file in the top-level directory.
+ */
+
+#ifndef DMA_POOL_HH
+#define DMA_POOL_HH
+
+#include <osv/types.h>
+#include <osv/mutex.h>
+#include <osv/percpu.hh>
+#include <vector>
+
+namespace memory {
+
+// A dma_pool hands out fixed-size, pinned, physically contiguous buffers
+// suitable for device DMA. Buffers are carved out of large arenas allocated
+// once from alloc_phys_contiguous_aligned() and recycled through per-CPU
+// freelists, so the per-I/O path is a freelist pop/push with preemption
+// disabled - no contiguous allocation, no page_range_allocator pressure and
+// no per-buffer mapping work.
+//
+// In OSv all kernel memory is pinned and device-visible, so "premapped"
+// today means the arena's physical layout is resolved once up front; under
+// a vIOMMU the arena would additionally be mapped into the device's IO
+// address space at the same point (see grow()), keeping map/unmap cost off
+// the per-I/O path either way.
+class dma_pool {
+public:
+    // buf_size must be a multiple of 8; buffers are naturally aligned to
+    // their size for sub-page pools and to a page otherwise.
+    explicit dma_pool(size_t buf_size);
+    ~dma_pool();
+
+    // Pop a buffer from the current CPU's freelist, refilling it from the
+    // global list (growing the pool by an arena if that is empty too).
+    // May sleep; returns nullptr only if memory is exhausted.
+    void* alloc();
+
+    // Return a buffer to the current CPU's freelist; batches above the
+    // per-CPU watermark spill back to the global list.
+    void free(void* buf);
+
+    size_t buf_size() const { return _buf_size; }
+
+private:
+    // A free buffer stores the freelist link in its own first word
+    struct free_obj {
+        free_obj* next;
+    };
+
+    struct cpu_cache {
+        free_obj* list = nullptr;
+        unsigned count = 0;
+    };
+
+    // Move a batch of buffers from the global freelist (growing it if
+    // needed) to the current CPU's cache. Takes _lock, may sleep.
+    bool refill();
+
+    // Move a batch of buffers from the current CPU's cache back to the
+    // global freelist. Takes _lock.
+    void spill();
+
+    // Allocate a new arena and carve it into the global freelist.
+    // Called with _lock held.
+    bool grow();
+
+    const size_t _buf_size;
+    const size_t _align;
+    unsigned _bufs_per_arena;
+
+    dynamic_percpu<cpu_cache> _cache;
+
+    mutex _lock;
+    free_obj* _global = nullptr;
+    std::vector<void*> _arenas;
+
+    // Buffers moved between a CPU cache and the global list at a time
+    static constexpr unsigned batch = 16;
+    // Above this many cached buffers a CPU spills a batch back
+    static constexpr unsigned max_cached = 64;
+    // Arenas are at most this big (and at least batch * 2 buffers)
+    static constexpr size_t max_arena_bytes = 1 << 20;
+};
+
+// Shared pools keyed by buffer size, created on first use and never
+// destroyed. Users with a common buffer size (e.g. one-page rx buffers)
+// share arenas this way.
+dma_pool* get_dma_pool(size_t buf_size);
+
+}
+
+#endif /* DMA_POOL_HH */
@@ -33,6 +33,7 @@ namespace elf {
 typedef u64 Elf64_Addr;
 typedef u64 Elf64_Off;
 typedef u16 Elf64_Half;
+typedef Elf64_Half Elf64_Versym;
 typedef u32 Elf64_Word;
 typedef int Elf64_Sword;
 typedef u64 Elf64_Xword;
@@ -359,6 +360,8 @@ public:
     void* end() const;
     Elf64_Sym* lookup_symbol(const char* name, bool self_lookup);
     symbol_module lookup_symbol_deep(const char* name);
+    // Does the object carry a symbol version table (DT_VERSYM)?
+    bool has_versym();
     void load_segments();
     void process_headers();
     void unload_segments();
@@ -425,6 +428,7 @@ protected:
     virtual void unload_segment(const Elf64_Phdr& segment) = 0;
     virtual void read(Elf64_Off offset, void* data, size_t len) = 0;
     bool mlocked();
+    bool eager_load();
     bool has_non_writable_text_relocations();
     unsigned get_segment_mmap_permissions(const Elf64_Phdr& phdr);
 private:
@@ -442,6 +446,14 @@ private:
     symbol_module symbol_other(unsigned idx);
     Elf64_Xword symbol_tls_module(unsigned idx);
     void relocate_rela();
+    void relocate_rela_range(Elf64_Rela* rela, unsigned from, unsigned to,
+                             bool relative);
+    void* setup_pltgot();
+    std::string relocation_cache_path();
+    void save_relocation_cache();
+    bool apply_relocation_cache();
+    void publish_shared_relocations();
+    bool apply_shared_relocations();
     void relocate_pltgot();
     unsigned symtab_len();
     void collect_dependencies(std::unordered_set<elf::object*>& ds);
@@ -468,6 +480,16 @@ protected:
     size_t _initial_tls_size;
     std::vector<ptrdiff_t> _initial_tls_offsets;
     Elf64_Dyn* _dynamic_table;
+    // Symbol lookup tables, resolved from the dynamic table once on the
+    // first lookup (see init_lookup_tables()), so that every lookup does
+    // not rescan the dynamic table for each of them.
+    std::atomic<bool> _lookup_tables_ready;
+    Elf64_Sym* _symtab;
+    const char* _strtab;
+    const Elf64_Word* _gnu_hashtab;  // DT_GNU_HASH, or nullptr
+    const Elf64_Word* _sysv_hashtab; // DT_HASH, or nullptr
+    const Elf64_Versym* _versym;     // DT_VERSYM, or nullptr
+    void init_lookup_tables();
     ulong _module_index;
     std::unique_ptr<char[]> _section_names_cache;
     bool _is_dynamically_linked_executable;
@@ -654,6 +676,10 @@ public:
     elf::object *object_containing_addr(const void *addr);
     inline object *tls_object(ulong module);
     void *get_libvdso_base() { return _libvdso->base(); }
+    // Start of the address range this program bump-allocates its objects
+    // from; each namespace created by application::new_program() gets its
+    // own disjoint window (see the shared relocation cache in elf.cc)
+    void *address_space_start() const { return _start; }
 private:
     void add_debugger_obj(object* obj);
     void del_debugger_obj(object* obj);
@@ -667,6 +693,7 @@ private:
     void initialize_libvdso();
 private:
     mutex _mutex;
+    void* _start;
     void* _next_alloc;
     std::shared_ptr<object> _core;
     std::shared_ptr<object> _libvdso;
@@ -679,6 +706,19 @@ private:
     osv::rcu_ptr<modules_list> _modules_rcu;
     modules_list modules_get() const;
 
+    // Memoized lookup() results, keyed by symbol name. Only maintained while
+    // every module is Public (see _hidden_modules) and flushed whenever the
+    // module list changes; the generation count detects lookups racing with
+    // a flush.
+    std::unordered_map<std::string, symbol_module> _lookup_cache;
+    mutex _lookup_cache_mutex;
+    u64 _lookup_cache_generation = 0;
+    void invalidate_lookup_cache();
+    // Number of modules with non-Public visibility. While it is non-zero,
+    // lookup results are thread-dependent and the cache is bypassed. Updated
+    // by object::set_visibility().
+    std::atomic<int> _hidden_modules = {0};
+
     // If _module_delete_disable > 0, objects are not deleted but rather
     // collected for deletion when _modules_delete_disable becomes 0.
     mutex _modules_delete_mutex;
@@ -699,6 +739,14 @@ private:
 };
 
 extern void *missing_symbols_page_addr;
+
+// When set (--save-reloc-cache), each relocated object writes its resolved
+// relocations to <pathname>.reloc, replayed by subsequent boots.
+extern bool save_relocation_caches;
+
+// Objects (by pathname or file name) whose segments are populated at load
+// time instead of demand-paged (--preload-objects)
+extern std::vector<std::string> eager_load_objects;
 void setup_missing_symbols_detector();
 
 void create_main_program();
@@ -0,0 +1,41 @@
+/*
+ * Copyright (C) 2026 Waldemar Kozaczuk
+ *
+ * This work is open source software, licensed under the terms of the
+ * BSD license as described in the LICENSE file in the top-level directory.
+ */
+
+#ifndef OSV_FAST_RANDOM_HH
+#define OSV_FAST_RANDOM_HH
+
+#include <stddef.h>
+
+//
+// Per-CPU ChaCha20 fast random pools, layered on top of the Yarrow CSPRNG
+// that backs /dev/random. Each CPU owns a private ChaCha20 keystream, so
+// getrandom() and friends never contend on the Yarrow mutexes or wait for
+// a virtio-rng round trip; a background thread periodically rekeys every
+// pool from Yarrow, which in turn is fed by virtio-rng, RDRAND and the
+// interrupt entropy harvesting hooks.
+//
+
+namespace randomdev {
+
+// Allocate and seed the per-CPU pools and start the rekeying thread.
+// Called from randomdev_init() once the random adaptor is up.
+void fast_random_init();
+
+// True once fast_random_init() completed - callers that can run without
+// the random device (e.g. getrandom() with --norandom) must check first.
+bool fast_random_ready();
+
+// Fill buf from the current CPU's pool. Never blocks, never fails.
+void fast_random_fill(void* buf, size_t len);
+
+}
+
+// C entry point for libc: returns 0 after filling buf, or -1 when the
+// pools were never initialized (the caller falls back to /dev/random).
+extern "C" int osv_fast_random_fill(void* buf, size_t len);
+
+#endif /* OSV_FAST_RANDOM_HH */
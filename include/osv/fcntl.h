@@ -27,6 +27,7 @@ __BEGIN_DECLS
 /* Fallocate modes */
 #define FALLOC_FL_KEEP_SIZE 1
 #define FALLOC_FL_PUNCH_HOLE 2
+#define FALLOC_FL_ZERO_RANGE 0x10
 
 #define loff_t off_t
 typedef struct flock64 {
@@ -44,6 +44,7 @@
 
 #if defined(__cplusplus) && !defined(USE_C_INTERFACE)
 
+#include <atomic>
 #include <memory>
 #include <vector>
 #include <osv/addr_range.hh>
@@ -83,6 +84,10 @@ struct poll_link {
     struct pollreq* _req = nullptr;
     /* Events being polled... */
     int _events = 0;
+    /* allocated on every poll() cycle, so served from a dedicated pool
+     * (see core/poll.cc) instead of the general allocator */
+    void* operator new(size_t size);
+    void operator delete(void* object);
 };
 
 struct file;
@@ -167,6 +172,9 @@ struct file {
 	virtual bool map_page(uintptr_t offset, mmu::hw_ptep<1> ptep, mmu::pt_element<1> pte, bool write, bool shared) { throw make_error(ENOSYS); }
 	virtual bool put_page(void *addr, uintptr_t offset, mmu::hw_ptep<0> ptep) { throw make_error(ENOSYS); }
 	virtual bool put_page(void *addr, uintptr_t offset, mmu::hw_ptep<1> ptep) { throw make_error(ENOSYS); }
+	// whether the page at offset is resident in the page cache - used by
+	// mincore(); files with no cache simply report false
+	virtual bool cached_page(uintptr_t offset) { return false; }
 	virtual void sync(off_t start, off_t end) { throw make_error(ENOSYS); }
 
 	int		f_flags;	/* open flags */
@@ -182,7 +190,14 @@ struct file {
 	                       boost::intrusive::constant_time_size<false>>
 	                f_poll_list; /* poll request list */
 	mutex_t		f_lock;		/* lock */
-	std::unique_ptr<std::vector<epoll_ptr>> f_epolls;
+	/* Epoll instances this file is registered with. The vector is
+	 * copy-on-write: mutated only under f_lock by publishing a new
+	 * copy, with the old one retired through osv::hazard so that
+	 * wake_epoll() can iterate it without taking f_lock. */
+	std::atomic<std::vector<epoll_ptr>*> f_epolls = {nullptr};
+	std::vector<epoll_ptr>* epolls() {
+		return f_epolls.load(std::memory_order_consume);
+	}
 	void stop_polls();
 	void wake_epoll(int possible_events = -1);
 };
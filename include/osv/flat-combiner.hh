@@ -0,0 +1,123 @@
+/*
+ * Copyright (C) 2026 Waldemar Kozaczuk
+ *
+ * This work is open source software, licensed under the terms of the
+ * BSD license as described in the LICENSE file in the top-level directory.
+ */
+
+#ifndef FLAT_COMBINER_HH_
+#define FLAT_COMBINER_HH_
+
+#include <atomic>
+#include <osv/mutex.h>
+#include <osv/sched.hh>
+#include <arch.hh>
+
+namespace osv {
+
+//
+// Flat combining for shared state which cannot be made percpu.
+//
+// When many cpus hammer one mutex-protected counter, most of the cost is
+// the cache line of the mutex itself bouncing between them. With flat
+// combining a contending cpu instead publishes its operation into its own
+// per-cpu slot - a line nobody else writes - and the one thread that does
+// hold the lock (the combiner) applies all published operations in a
+// batch. The line with the shared state then moves between cpus once per
+// batch rather than once per operation.
+//
+// The combiner lock is supplied by the caller, so structures that already
+// serialize on a mutex (e.g. a semaphore waking its waiters) can route
+// only their hottest operation through the combiner while the remaining
+// operations keep taking the mutex directly - the two paths exclude each
+// other on the same lock. An operation handed to combine() may therefore
+// be applied by another thread; it must not depend on the publisher's
+// context, and combine() returns only after it was applied.
+//
+template <typename Op>
+class flat_combiner {
+public:
+    explicit flat_combiner(mutex& lock) : _lock(lock) {}
+
+    // Apply "op", and possibly operations published by other cpus, by
+    // calling fn(op) with the combiner lock held.
+    template <typename Fn>
+    inline void combine(Op op, Fn&& fn)
+    {
+        if (_lock.try_lock()) {
+            fn(op);
+            drain(fn);
+            _lock.unlock();
+            return;
+        }
+
+        auto& slot = _slots[sched::cpu::current()->id];
+        const Op* expected = nullptr;
+        //
+        // The slot is per-cpu, not per-thread: if another thread of this
+        // cpu already published into it, just take the lock directly.
+        // Release pairs with the combiner's acquire load, making "op"
+        // visible before the pointer to it.
+        //
+        if (!slot.pending.compare_exchange_strong(expected, &op,
+                std::memory_order_release, std::memory_order_relaxed)) {
+            WITH_LOCK(_lock) {
+                fn(op);
+                drain(fn);
+            }
+            return;
+        }
+
+        //
+        // Published. Now either the current lock holder is a combiner and
+        // will apply our operation, or the lock holder is on a direct
+        // path (which does not drain the slots) - in which case we must
+        // keep trying to become the combiner ourselves once it unlocks.
+        //
+        unsigned spins = 0;
+        while (slot.pending.load(std::memory_order_acquire)) {
+            if (_lock.try_lock()) {
+                // drain() clears our own slot too, ending the loop
+                drain(fn);
+                _lock.unlock();
+            } else if (++spins % 256) {
+#ifdef __x86_64__
+                __asm __volatile("pause");
+#endif
+#ifdef __aarch64__
+                __asm __volatile("isb sy");
+#endif
+            } else {
+                // The lock holder may be preempted; don't burn its
+                // timeslice spinning
+                sched::thread::yield();
+            }
+        }
+    }
+
+private:
+    template <typename Fn>
+    void drain(Fn&& fn)
+    {
+        for (auto& slot : _slots) {
+            auto* p = slot.pending.load(std::memory_order_acquire);
+            if (p) {
+                fn(*p);
+                // Release orders the application of *p before the
+                // publisher is allowed to return (and reuse its stack)
+                slot.pending.store(nullptr, std::memory_order_release);
+            }
+        }
+    }
+
+    struct combiner_slot {
+        std::atomic<const Op*> pending {nullptr};
+    } CACHELINE_ALIGNED;
+
+    mutex& _lock;
+    combiner_slot _slots[sched::max_cpus];
+};
+
+}
+
+#endif /* FLAT_COMBINER_HH_ */
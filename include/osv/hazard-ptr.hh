@@ -0,0 +1,112 @@
+/*
+ * Copyright (C) 2026 Waldemar Kozaczuk
+ *
+ * This work is open source software, licensed under the terms of the
+ * BSD license as described in the LICENSE file in the top-level directory.
+ */
+
+#ifndef __OSV_HAZARD_PTR_HH__
+#define __OSV_HAZARD_PTR_HH__
+
+#include <atomic>
+#include <cstddef>
+#include <arch.hh>
+
+//
+// Hazard-pointer based deferred reclamation, complementing osv::rcu.
+//
+// rcu_defer() may not reclaim an object until every cpu passes through a
+// quiescent state, and the amount of memory awaiting a grace period is
+// unbounded. With hazard pointers, a reader publishes the one pointer it
+// is about to dereference in a slot that reclaimers scan: retired
+// objects whose address appears in no slot are freed immediately, so the
+// backlog is bounded by the number of pointers readers actually hold,
+// not by how long it takes every cpu to quiesce.
+//
+// Reader:
+//     osv::hazard::holder h;
+//     auto p = h.protect(ptr);     // ptr is a std::atomic<T*>
+//     ... use *p ...
+//     h.clear();                   // or let the holder go out of scope
+//
+// Writer (after unpublishing p so new readers cannot find it):
+//     osv::hazard::retire(p);
+//
+// Retired objects are kept on per-cpu lists and scanned in batches;
+// the total is visible to the memory shrinker, which can force a flush
+// under pressure (see core/hazard-ptr.cc).
+//
+namespace osv {
+namespace hazard {
+
+//
+// One published hazard slot. Records are allocated once, linked into a
+// global list and never freed; releasing one only clears its active
+// flag so the next acquirer can reuse it, which keeps the list short
+// and makes the reclaimers' scan cheap.
+//
+struct record {
+    std::atomic<const void*> ptr {nullptr};
+    std::atomic<bool> active {false};
+    record* next = nullptr;
+} CACHELINE_ALIGNED;
+
+record* acquire_record();
+void release_record(record* rec);
+
+// Retire an object for deferred disposal. size is only used for
+// accounting towards the shrinker-visible total.
+void retire(const void* obj, size_t size, void (*dispose)(const void*));
+
+template <typename T>
+void retire(const T* obj)
+{
+    retire(obj, sizeof(T), [] (const void* p) {
+        delete static_cast<const T*>(p);
+    });
+}
+
+// Number of bytes sitting on the retired lists, awaiting a scan.
+size_t deferred_bytes();
+
+// Dispose of every retired object no hazard slot protects.
+void flush();
+
+//
+// RAII wrapper around a hazard record, the usual way to read a
+// hazard-protected pointer.
+//
+class holder {
+public:
+    holder() : _rec(acquire_record()) {}
+    ~holder() { release_record(_rec); }
+    holder(const holder&) = delete;
+    holder& operator=(const holder&) = delete;
+
+    // Load *src and publish the result so it cannot be reclaimed until
+    // clear(). The store-load fence pairs with the one in the scan: a
+    // reclaimer either sees our published pointer, or we see the
+    // writer's unpublished (new) value and retry.
+    template <typename T>
+    T* protect(const std::atomic<T*>& src) {
+        T* p = src.load(std::memory_order_relaxed);
+        for (;;) {
+            _rec->ptr.store(p, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            T* q = src.load(std::memory_order_acquire);
+            if (q == p) {
+                return p;
+            }
+            p = q;
+        }
+    }
+
+    void clear() { _rec->ptr.store(nullptr, std::memory_order_release); }
+private:
+    record* _rec;
+};
+
+}
+}
+
+#endif // !__OSV_HAZARD_PTR_HH__
@@ -51,8 +51,11 @@ protected:
 enum ipi_id {
     IPI_WAKEUP,
     IPI_TLB_FLUSH,
+    IPI_RCU_EXPEDITED,
     IPI_SAMPLER_START,
     IPI_SAMPLER_STOP,
+    IPI_STALL_DETECTOR_START,
+    IPI_STALL_DETECTOR_STOP,
     IPI_SMP_STOP,
 };
 
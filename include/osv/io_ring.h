@@ -0,0 +1,88 @@
+/*
+ * Copyright (C) 2026 Waldemar Kozaczuk
+ *
+ * This work is open source software, licensed under the terms of the
+ * BSD license as described in the LICENSE file in the top-level directory.
+ */
+
+/* OSv-native asynchronous block I/O rings.
+ *
+ * An application creates a ring against a block device ("vblk0",
+ * "nvme0n1", ...), fills submission entries in place and publishes them
+ * with a single call; a kernel service thread turns each batch into a
+ * chain of bios which is handed to the driver with one doorbell, and the
+ * driver's completion path posts entries to the completion ring, waking
+ * the reaping thread once per batch. Because OSv runs the application in
+ * the kernel address space, the queues really are shared memory - there
+ * is no syscall or copy on either path, and the I/O goes straight to the
+ * device, bypassing the buffered vfs_bio layer.
+ *
+ * A ring expects a single submitting thread and a single reaping thread
+ * (they may be the same thread); use one ring per thread otherwise.
+ */
+
+#ifndef OSV_IO_RING_H_
+#define OSV_IO_RING_H_
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* osv_io_sqe opcodes */
+enum {
+    OSV_IO_OP_READ  = 1,
+    OSV_IO_OP_WRITE = 2,
+    OSV_IO_OP_FLUSH = 3,
+};
+
+/* Submission queue entry. offset and len must obey the device's
+ * alignment rules (sector-sized and sector-aligned for block devices),
+ * as the buffer is handed to the driver as-is. */
+struct osv_io_sqe {
+    uint8_t  opcode;
+    uint8_t  pad[7];
+    uint64_t user_data;     /* copied verbatim into the completion */
+    void     *addr;         /* data buffer */
+    uint64_t len;           /* length in bytes */
+    uint64_t offset;        /* byte offset on the device */
+};
+
+/* Completion queue entry: res is the number of bytes transferred, or
+ * -errno on failure. */
+struct osv_io_cqe {
+    uint64_t user_data;
+    int64_t  res;
+};
+
+typedef struct osv_io_ring osv_io_ring_t;
+
+/* Create a ring of the given number of entries (rounded up to a power
+ * of two) against the named block device. Returns NULL and sets errno
+ * if the device cannot be opened or memory is short. */
+osv_io_ring_t *osv_io_ring_create(const char *devname, unsigned entries);
+
+/* Tear the ring down. The caller must have reaped all submitted
+ * operations first. */
+void osv_io_ring_destroy(osv_io_ring_t *ring);
+
+/* Claim the next free submission entry for filling in, or NULL if the
+ * submission ring is full (reap completions to make room). */
+struct osv_io_sqe *osv_io_ring_get_sqe(osv_io_ring_t *ring);
+
+/* Publish all entries claimed since the last call and wake the service
+ * thread; the batch is submitted to the device as one chain. Returns
+ * the number of entries published. */
+int osv_io_ring_submit(osv_io_ring_t *ring);
+
+/* Reap up to max completions into cqes, blocking until at least min are
+ * available (min may be 0 for a pure poll). Returns the number reaped. */
+int osv_io_ring_getevents(osv_io_ring_t *ring, struct osv_io_cqe *cqes,
+                          int min, int max);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* OSV_IO_RING_H_ */
@@ -0,0 +1,58 @@
+/*
+ * Copyright (C) 2026 Waldemar Kozaczuk
+ *
+ * This work is open source software, licensed under the terms of the
+ * BSD license as described in the LICENSE file in the top-level directory.
+ */
+
+#ifndef IOSCHED_HH_
+#define IOSCHED_HH_
+
+#include <stdint.h>
+#include <osv/device.h>
+#include <osv/bio.h>
+
+// Pluggable per-device I/O scheduler, sitting between the filesystems
+// and the block drivers. See fs/vfs/kern_iosched.cc for the actual
+// scheduling; the hook into the submission path is multiplex_strategy()
+// in fs/vfs/kern_physio.cc.
+
+enum class iosched_policy {
+    none,       // submit bios to the driver in arrival order, as before
+    deadline,   // merge adjacent bios, bound read latency under write floods
+};
+
+// Select the scheduling policy of a block device. Requests already queued
+// are drained through the scheduler regardless of the new policy.
+int iosched_set_policy(struct device *dev, iosched_policy policy);
+iosched_policy iosched_get_policy(struct device *dev);
+
+// Cumulative counters kept by a device's scheduler. The dispatcher
+// updates them without locking, so a read is a momentary snapshot -
+// good enough for benchmarks and monitoring.
+struct iosched_stats {
+	uint64_t queued;	// bios handed to the scheduler
+	uint64_t batches;	// dispatch batches sent to the driver
+	uint64_t merged;	// member bios coalesced into carriers
+	uint64_t carriers;	// carrier bios submitted on their behalf
+};
+
+// Snapshot the device's scheduler counters. Returns ENOTBLK for
+// non-block devices and zeroed counters when no scheduler has been
+// created for the device yet.
+int iosched_get_stats(struct device *dev, struct iosched_stats *stats);
+
+// Called from multiplex_strategy(): hand the bio to the device's
+// scheduler. Returns false when the device's policy is to bypass the
+// scheduler, in which case the caller submits directly to the driver.
+bool iosched_queue_bio(struct bio *bio);
+
+// Drain the device's queue and tear its scheduler down (the
+// device_destroy() path).
+void iosched_stop(struct device *dev);
+
+// The direct submission path - splits the bio according to the device's
+// max_io_size and hands the pieces to the driver (fs/vfs/kern_physio.cc).
+void multiplex_submit(struct bio *bio);
+
+#endif /* !IOSCHED_HH_ */
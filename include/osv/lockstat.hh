@@ -0,0 +1,37 @@
+/*
+ * Copyright (C) 2026 Waldemar Kozaczuk
+ *
+ * This work is open source software, licensed under the terms of the
+ * BSD license as described in the LICENSE file in the top-level directory.
+ */
+
+#ifndef _OSV_LOCKSTAT_HH
+#define _OSV_LOCKSTAT_HH
+
+#include <osv/types.h>
+
+#include <string>
+
+namespace lock_stats {
+
+// Turn lock contention accounting on or off. Only the park paths of
+// lockfree::mutex and rwlock are instrumented, so the uncontended fast
+// paths stay untouched; when off, a contended lock costs one extra flag
+// test before going to sleep.
+void enable(bool = true);
+bool enabled();
+
+// Uptime nanoseconds if accounting is on, 0 otherwise. Take the
+// timestamp right before parking...
+u64 wait_begin();
+// ...and account the wait after waking up. pc identifies the waiting
+// call site, lock the contended object. No-op when begin returned 0.
+void wait_end(void* lock, void* pc, u64 begin);
+
+// The contended locks sorted by total wait time, symbolized;
+// served as /proc/lock_stats
+std::string dump();
+
+}
+
+#endif
@@ -8,9 +8,12 @@
 #ifndef MEMPOOL_HH
 #define MEMPOOL_HH
 
+#include <algorithm>
 #include <cstdint>
+#include <cstdlib>
 #include <functional>
 #include <list>
+#include <string>
 #include <boost/intrusive/set.hpp>
 #include <boost/intrusive/list.hpp>
 #include <osv/mutex.h>
@@ -50,6 +53,10 @@ struct free_object {
     free_object* next;
 };
 
+namespace stats {
+    struct object_pool_stats;
+}
+
 class pool {
 public:
     explicit pool(unsigned size);
@@ -57,8 +64,11 @@ public:
     void* alloc();
     void free(void* object);
     unsigned get_size();
+    void fill_stats(stats::object_pool_stats& s);
     static pool* from_object(void* object);
     static void collect_garbage();
+    // for the registry of all live pools, see stats::get_object_pool_stats()
+    bi::list_member_hook<> registry_hook;
 private:
     struct page_header;
 private:
@@ -92,11 +102,78 @@ private:
     };
     // maintain a list of free pages percpu
     dynamic_percpu<free_list_type> _free;
+    // next page's slab color, see add_page()
+    std::atomic<unsigned> _color = {0};
+    // allocation statistics, maintained under preempt_lock like _free;
+    // summed over cpus by fill_stats()
+    struct cpu_stats {
+        uint64_t allocs;
+        uint64_t frees;
+        uint64_t frees_remote; // freed on a different cpu than allocated
+        int64_t pages; // net, may transiently be negative on a single cpu
+    };
+    dynamic_percpu<cpu_stats> _stats;
 public:
     static const size_t max_object_size;
     static const size_t min_object_size;
 };
 
+// A pool dedicated to a single object type. Hot types which would land in
+// the same malloc size class (mbufs, vnodes, epoll entries, ...) can each
+// get their own pages this way, so unrelated objects never false-share a
+// cache line, and the per-pool statistics show the type's own allocation
+// rate instead of a class-wide aggregate.
+template <typename T>
+class typed_pool : public pool {
+public:
+    typed_pool() : pool(std::max(sizeof(T), min_object_size)) {}
+    template <typename... Args>
+    T* construct(Args&&... args) {
+        return new (alloc()) T(std::forward<Args>(args)...);
+    }
+    void destroy(T* p) {
+        p->~T();
+        free(p);
+    }
+};
+
+// A standard-library allocator which serves single objects - the nodes of
+// node-based containers like std::unordered_map - from a pool shared by
+// all containers of the same value type, so the container's per-element
+// insert/erase path becomes a per-cpu freelist pop/push. Array requests
+// (e.g. a hash table's bucket array) and objects too large for a pool
+// fall back to malloc.
+template <typename T>
+class pool_allocator {
+public:
+    using value_type = T;
+    pool_allocator() noexcept = default;
+    template <typename U>
+    pool_allocator(const pool_allocator<U>&) noexcept {}
+    T* allocate(size_t n) {
+        if (n == 1 && sizeof(T) <= pool::max_object_size) {
+            return static_cast<T*>(shared_pool().alloc());
+        }
+        return static_cast<T*>(::malloc(n * sizeof(T)));
+    }
+    void deallocate(T* p, size_t n) {
+        if (n == 1 && sizeof(T) <= pool::max_object_size) {
+            shared_pool().free(p);
+        } else {
+            ::free(p);
+        }
+    }
+    template <typename U>
+    bool operator==(const pool_allocator<U>&) const noexcept { return true; }
+    template <typename U>
+    bool operator!=(const pool_allocator<U>&) const noexcept { return false; }
+private:
+    static pool& shared_pool() {
+        static pool p(std::max(sizeof(T), pool::min_object_size));
+        return p;
+    }
+};
+
 struct page_range {
     explicit page_range(size_t size);
     bool operator<(const page_range& pr) const {
@@ -108,12 +185,41 @@ struct page_range {
 };
 
 void free_initial_memory_range(void* addr, size_t size);
+
+// Deferred initial-memory onlining (see core/mempool.cc): memory past
+// this threshold is queued at early boot and onlined by per-cpu worker
+// threads once smp_launch() has run.
+constexpr size_t deferred_online_threshold = 4ull << 30;
+bool defer_initial_memory_range(uintptr_t addr, size_t size);
+void online_deferred_memory();
+
+// Return the exiting thread's malloc magazines to the per-cpu pools;
+// called from thread::complete() on the dying thread.
+void flush_thread_malloc_cache();
+
 void enable_debug_allocator();
 
 extern bool tracker_enabled;
 
 enum class pressure { RELAXED, NORMAL, PRESSURE, EMERGENCY };
 
+// The memory pressure level currently observed by the allocator:
+// RELAXED   - free memory is plentiful;
+// NORMAL    - free memory is getting within sight of the reclaim watermark;
+// PRESSURE  - below the watermark, the reclaimer and the in-kernel
+//             shrinkers (and JVM balloon, if any) are being engaged;
+// EMERGENCY - free memory is down to the emergency pool, allocations may
+//             soon block or fail.
+// Applications which keep caches of their own can watch this and shed them
+// at PRESSURE, participating in reclaim alongside the kernel shrinkers.
+pressure current_pressure();
+
+// Block until the pressure level differs from last, and return the new
+// level. Levels can change in either direction; a watcher simply loops.
+// C applications get these two as osv_memory_pressure() and
+// osv_wait_memory_pressure(), see <osv/pressure.h>.
+pressure wait_pressure_change(pressure last);
+
 class shrinker {
 public:
     explicit shrinker(std::string name);
@@ -190,6 +296,10 @@ private:
 
 const unsigned page_ranges_max_order = 16;
 
+// Re-file free page ranges under their NUMA nodes; called once the
+// topology has been parsed from the platform's affinity table.
+void numa_rebalance();
+
 namespace stats {
     size_t free();
     size_t total();
@@ -207,6 +317,33 @@ namespace stats {
 
     void get_page_ranges_stats(page_ranges_stats &stats);
 
+    // Page-pool compaction: how often a failing contiguous allocation
+    // triggered a drain of the L1/L2 page pools, how many parked pages
+    // went back to the free ranges, and how many of those allocations
+    // then succeeded on retry.
+    struct compaction_stats {
+        size_t runs;
+        size_t pages_drained;
+        size_t recovered;
+    };
+
+    void get_compaction_stats(compaction_stats &stats);
+
+    struct object_pool_stats {
+        size_t object_size;
+        uint64_t allocs;       // cumulative
+        uint64_t frees;        // cumulative
+        uint64_t frees_remote; // of frees, on a different cpu than the alloc
+        uint64_t live;         // allocs - frees
+        uint64_t pages_held;   // whole pages currently owned by the pool
+    };
+
+    // Call f once per live pool (the malloc size classes plus any dedicated
+    // typed_pools). Comparing live * object_size against pages_held reveals
+    // a class's internal fragmentation; sampling allocs periodically gives
+    // its allocation rate.
+    void get_object_pool_stats(std::function<void (const object_pool_stats&)> f);
+
     struct pool_stats {
         size_t _max;
         size_t _nr;
@@ -218,6 +355,17 @@ namespace stats {
     void get_l1_stats(unsigned int cpu_id, stats::pool_stats &stats);
 }
 
+namespace alloc_profiler {
+    // Sampled allocation profiler: unlike the alloc_tracker leak detector,
+    // cheap enough to leave on in production. Roughly one allocation per
+    // sample_interval_bytes allocated is recorded, aggregated by
+    // allocation site into a fixed-size table.
+    void enable(size_t sample_interval_bytes);
+    // Cumulative sampled allocations per site, symbolized;
+    // served as /proc/alloc_profile
+    std::string dump();
+}
+
 class phys_contiguous_memory final {
 public:
     phys_contiguous_memory(size_t size, size_t align) {
@@ -85,11 +85,16 @@ enum {
     mmap_jvm_balloon = 1ul << 6,
     mmap_file        = 1ul << 7,
     mmap_stack       = 1ul << 8,
+    // MAP_HUGETLB equivalent: back the huge-page aligned interior with
+    // 2MB pages eagerly, regardless of size or protection
+    mmap_huge        = 1ul << 9,
 };
 
 enum {
     advise_dontneed = 1ul << 0,
     advise_nohugepage = 1ul << 1,
+    advise_free = 1ul << 2,
+    advise_hugepage = 1ul << 3,
 };
 
 enum {
@@ -101,6 +106,18 @@ void flush_tlb_local();
 /* flush tlb for all */
 void flush_tlb_all();
 
+struct tlb_range {
+    void* addr;
+    size_t size;
+};
+
+/* flush a bounded list of ranges on all processors in one shootdown round,
+ * invalidating page by page instead of dropping the whole TLB; falls back
+ * to flush_tlb_all() when the total page count makes that a bad deal */
+void flush_tlb_ranges(const tlb_range* ranges, unsigned count);
+/* single-range convenience wrapper for flush_tlb_ranges() */
+void flush_tlb_range(void* addr, size_t size);
+
 constexpr size_t page_size_level(unsigned level)
 {
     return size_t(1) << (page_size_shift + pte_per_page_shift * level);
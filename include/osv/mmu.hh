@@ -209,6 +209,9 @@ bool ismapped(const void *addr, size_t size);
 bool isreadable(void *addr, size_t size);
 std::unique_ptr<file_vma> default_file_mmap(file* file, addr_range range, unsigned flags, unsigned perm, off_t offset);
 std::unique_ptr<file_vma> map_file_mmap(file* file, addr_range range, unsigned flags, unsigned perm, off_t offset);
+// map a fixed physical range - device memory such as the ivshmem shared
+// memory BAR - rather than pages owned by the file or the page cache
+std::unique_ptr<file_vma> map_phys_mmap(file* file, addr_range range, unsigned flags, unsigned perm, uintptr_t paddr, off_t offset);
 
 
 template<int N>
@@ -352,6 +355,33 @@ void switch_to_runtime_page_tables();
 
 void set_nr_page_sizes(unsigned nr);
 
+// Minimum size from which map_anon() backs the huge-page aligned interior
+// of a writable anonymous mapping eagerly with 2MB pages (see the policy
+// comment by its definition in core/mmu.cc). May be raised (or set to
+// SIZE_MAX to disable eager backing) before the application maps its heap.
+extern size_t huge_eager_threshold;
+
+// Cumulative counts of demand mappings installed huge (2MB) vs small (4K);
+// their ratio, weighted by page size, shows how much of the mapped memory
+// enjoys large TLB entries. huge_failed counts 2MB allocations which came
+// back empty (fragmentation) so the range fell back to 4K pages; huge_split
+// counts huge mappings later demoted to 4K, e.g. by a partial munmap() or
+// madvise(MADV_NOHUGEPAGE); huge_promoted counts dense 4K runs collapsed
+// back into huge mappings (executable regions on mprotect(PROT_EXEC), any
+// region on madvise(MADV_HUGEPAGE)).
+struct hugepage_stats {
+    ulong huge_mapped;
+    ulong small_mapped;
+    ulong huge_failed;
+    ulong huge_split;
+    ulong huge_promoted;
+};
+void get_hugepage_stats(hugepage_stats& s);
+
+// Bytes of executable mappings currently backed by 2MB vs. 4K pages -
+// what the iTLB actually sees. Walks the exec vmas' page tables.
+void get_exec_mapping_stats(ulong& huge_bytes, ulong& small_bytes);
+
 void vpopulate(void* addr, size_t size);
 void vdepopulate(void* addr, size_t size);
 void vcleanup(void* addr, size_t size);
@@ -361,10 +391,18 @@ error  advise(void* addr, size_t size, int advice);
 void vm_fault(uintptr_t addr, exception_frame* ef);
 
 std::string procfs_maps();
+std::string procfs_pagemap();
 std::string sysfs_linear_maps();
+// packed procfs_bin_vma records for /proc/osv/maps
+std::string procfs_maps_bin();
+// bumped whenever the vma list changes; lets procfs cache its renderings
+u64 vma_list_generation();
 
 unsigned long all_vmas_size();
 
+// Merge identical read-only file-backed pages, returning the bytes released
+ulong dedup_readonly_pages();
+
 // Synchronize cpu data and instruction caches for specified area of virtual memory
 void synchronize_cpu_caches(void *v, size_t size);
 }
@@ -12,6 +12,10 @@
 
 #include <list>
 
+namespace sched {
+    class cpu;
+}
+
 class msix_vector {
 public:
     msix_vector(pci::function* dev);
@@ -44,6 +48,14 @@ struct msix_binding {
     std::function<void ()> isr;
     // bottom half
     sched::thread *t;
+    // Optional: pin the bottom-half thread and route the vector to this
+    // cpu as a unit, so the interrupt, the ring it serves and the service
+    // thread share one cpu's cache from the start instead of the vector
+    // chasing the thread after the first interrupts.
+    sched::cpu *cpu;
+    msix_binding(unsigned e, std::function<void ()> i, sched::thread *th,
+                 sched::cpu *c = nullptr)
+        : entry(e), isr(i), t(th), cpu(c) {}
 };
 
 class interrupt_manager {
@@ -61,6 +73,9 @@ public:
     // 3. Setup entries
     // 4. Unmask interrupts
     bool easy_register(std::initializer_list<msix_binding> bindings);
+    // Same, for a number of bindings only known at run time, e.g. one
+    // binding per queue on a multiqueue device.
+    bool easy_register(const std::vector<msix_binding>& bindings);
     void easy_unregister();
 
     /////////////////////
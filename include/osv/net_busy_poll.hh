@@ -0,0 +1,66 @@
+/*
+ * Copyright (C) 2026 Waldemar Kozaczuk
+ *
+ * This work is open source software, licensed under the terms of the
+ * BSD license as described in the LICENSE file in the top-level directory.
+ */
+
+#ifndef NET_BUSY_POLL_HH_
+#define NET_BUSY_POLL_HH_
+
+#include <functional>
+
+struct file;
+
+namespace osv {
+namespace net_busy_poll {
+
+/**
+ * A per-NIC hook for SO_BUSY_POLL style receive polling.
+ *
+ * The normal rx path is interrupt driven: the device raises an interrupt,
+ * the ISR wakes the driver's rx thread and the rx thread wakes the
+ * application. For latency-sensitive workloads a thread blocking in
+ * poll()/epoll_wait() can instead spin() on the device rx rings with the
+ * rx interrupt masked, handing completions to the rx thread the moment
+ * they appear and skipping the interrupt exit/injection latency entirely.
+ *
+ * Drivers that can poll their rx ring cheaply implement this interface
+ * and register an instance per device.
+ */
+class poller {
+public:
+    virtual ~poller() {}
+    // Check the device rx ring for completed work and dispatch it (e.g.
+    // wake the driver's rx thread). Called with the rcu read lock held,
+    // so it must not sleep.
+    virtual void poll() = 0;
+    // Mask/unmask the device rx interrupt around a busy-poll spin.
+    // unmask() must recheck the ring and dispatch anything that arrived
+    // while the interrupt was masked. Both are best-effort: they may race
+    // with the driver's own interrupt management, and losing such a race
+    // only costs a spurious interrupt or a spurious poll() pass.
+    virtual void mask() = 0;
+    virtual void unmask() = 0;
+};
+
+void register_poller(poller* p);
+void unregister_poller(poller* p);
+
+/**
+ * Spin on the registered device rx rings for up to budget_us
+ * microseconds, calling ready() after every polling pass. Returns true
+ * as soon as ready() does, false if the budget expired first (the IRQ
+ * path takes over from there).
+ */
+bool spin(unsigned budget_us, std::function<bool ()> ready);
+
+}
+}
+
+// Returns the SO_BUSY_POLL budget (microseconds) of the socket behind
+// the given file, or 0 if the file is not a socket or busy polling is
+// not enabled on it. Implemented in uipc_socket.cc.
+int so_busy_poll_budget(struct file* fp);
+
+#endif /* NET_BUSY_POLL_HH_ */
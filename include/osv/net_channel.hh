@@ -15,10 +15,12 @@
 #include <unordered_map>
 #include <osv/rcu.hh>
 #include <osv/rcu-hashtable.hh>
+#include <osv/percpu.hh>
 #include <bsd/porting/netport.h>
 #include <bsd/sys/netinet/in.h>
 #include <bsd/sys/netinet/ip.h>
 #include <osv/file.h>
+#include <osv/net_channel_stats.hh>
 
 struct mbuf;
 struct pollreq;
@@ -39,11 +41,43 @@ private:
     osv::rcu_ptr<std::vector<pollreq*>> _pollers;
     osv::rcu_hashtable<epoll_ptr> _epollers;
     mutex _pollers_mutex;
+    net_channel_stats _stats = {};
+    // when the head of the queue was pushed, for the wait counters
+    std::atomic<int64_t> _head_enqueue = {0};
+    // SO_INCOMING_CPU support: the cpu the owner wants this flow's rx
+    // handled on, and the cpu the producer last pushed from
+    std::atomic<int> _preferred_cpu = {-1};
+    std::atomic<int> _last_rx_cpu = {-1};
+    // programs the NIC's flow steering, when it has any; set by the
+    // protocol at channel attach time
+    std::function<void (int)> _steer_flow;
+    // SO_TRACE_CONTEXT: application-assigned distributed-tracing id,
+    // stamped into this channel's tracepoints so host-side analysis can
+    // attribute rx wakeups and drains to a request; 0 means unset
+    std::atomic<u64> _trace_ctx = {0};
 public:
-    explicit net_channel(std::function<void (mbuf*)> process_packet)
-        : _process_packet(std::move(process_packet)) {}
+    explicit net_channel(std::function<void (mbuf*)> process_packet);
+    ~net_channel();
     // producer: try to push a packet
-    bool push(mbuf* m) { return _queue.push(m); }
+    bool push(mbuf* m) {
+        if (!_queue.push(m)) {
+            _stats.drops++;
+            return false;
+        }
+        // remember which cpu feeds this flow, for SO_INCOMING_CPU;
+        // write only on change so the line stays shared when stable
+        auto c = int(sched::cpu::current()->id);
+        if (_last_rx_cpu.load(std::memory_order_relaxed) != c) {
+            _last_rx_cpu.store(c, std::memory_order_relaxed);
+        }
+        if (_queue.size() == 1) {
+            // The push made the ring non-empty - remember when, so
+            // process_queue() can tell how long the head of the queue
+            // sat waiting for the consumer.
+            stamp_head();
+        }
+        return true;
+    }
     // consumer: wake the consumer (best used after multiple push()s)
     void wake() {
 #if CONF_lazy_stack_invariant
@@ -61,8 +95,36 @@ public:
     void del_poller(pollreq& pr);
     void add_epoll(const epoll_ptr& ep);
     void del_epoll(const epoll_ptr& ep);
+    // counters for net_channel_foreach_stats(); reads are unlocked
+    const net_channel_stats& stats() const { return _stats; }
+    // SO_INCOMING_CPU: record where the owner wants this flow handled
+    // and pass it on to the NIC's flow steering hook, if any
+    void set_preferred_cpu(int cpu) {
+        _preferred_cpu.store(cpu, std::memory_order_relaxed);
+        if (_steer_flow) {
+            _steer_flow(cpu);
+        }
+    }
+    int preferred_cpu() const {
+        return _preferred_cpu.load(std::memory_order_relaxed);
+    }
+    // the cpu the producer (NIC rx path) last pushed a packet from
+    int last_rx_cpu() const {
+        return _last_rx_cpu.load(std::memory_order_relaxed);
+    }
+    void set_steer_fn(std::function<void (int)> fn) {
+        _steer_flow = std::move(fn);
+    }
+    // SO_TRACE_CONTEXT of the owning socket
+    void set_trace_ctx(u64 ctx) {
+        _trace_ctx.store(ctx, std::memory_order_relaxed);
+    }
+    u64 trace_ctx() const {
+        return _trace_ctx.load(std::memory_order_relaxed);
+    }
 private:
     void wake_pollers();
+    void stamp_head();
 private:
     friend class sched::wait_object<net_channel>;
 };
@@ -83,6 +145,7 @@ public:
 }
 
 struct ipv4_tcp_conn_id {
+    ipv4_tcp_conn_id() : src_addr{}, dst_addr{}, src_port(0), dst_port(0) {}
     ipv4_tcp_conn_id(in_addr src_addr, in_addr dst_addr, in_port_t src_port, in_port_t dst_port)
         : src_addr(src_addr), dst_addr(dst_addr), src_port(src_port), dst_port(dst_port) {}
 
@@ -118,10 +181,15 @@ public:
     // consumer side operations
     void add(ipv4_tcp_conn_id id, net_channel* channel);
     void remove(ipv4_tcp_conn_id id);
+    // UDP flows are keyed by the same 4-tuple id, but kept in a separate
+    // table so a TCP connection and a UDP flow sharing port numbers can
+    // never clash
+    void add_udp(ipv4_tcp_conn_id id, net_channel* channel);
+    void remove_udp(ipv4_tcp_conn_id id);
     // producer side operations
     bool post_packet(mbuf* m);
 private:
-    net_channel* classify_ipv4_tcp(mbuf* m);
+    net_channel* classify_ipv4(mbuf* m);
 private:
     struct item {
         item(const ipv4_tcp_conn_id& key, net_channel* chan) : key(key), chan(chan) {}
@@ -137,8 +205,31 @@ private:
         }
     };
     using ipv4_tcp_channels = osv::rcu_hashtable<item, item_hash>;
+    // Packets carrying the NIC-computed RSS hash (M_FLOWID) short-cut the
+    // hashtable walk through this direct-mapped flow cache, indexed by the
+    // hardware hash. The cache is percpu: each rx queue is serviced from
+    // its own cpu, so entries are filled and looked up with preemption
+    // disabled, without locking and without sharing cache lines between
+    // queues. A hit is validated against the full 4-tuple, and removing
+    // any channel bumps _generation, invalidating all caches wholesale.
+    struct flow_cache_entry {
+        uint32_t flowid;
+        uint64_t generation = 0; // 0 never matches _generation: stale
+        ipv4_tcp_conn_id key;
+        uint8_t proto = 0;
+        net_channel* chan;
+    };
+    static constexpr unsigned flow_cache_size = 256; // per cpu, power of two
+    struct flow_cache {
+        flow_cache_entry entries[flow_cache_size];
+    };
+    // indirect: heap-backed, as there is a classifier per ifnet and the
+    // dynamic percpu arena is small
+    dynamic_percpu_indirect<flow_cache> _flow_cache;
+    std::atomic<uint64_t> _generation = {1}; // entries start at 0 == stale
     mutex _mtx;
     ipv4_tcp_channels _ipv4_tcp_channels;
+    ipv4_tcp_channels _ipv4_udp_channels;
 };
 
 #endif /* NETCHANNEL_HH_ */
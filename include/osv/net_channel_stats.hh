@@ -0,0 +1,52 @@
+/*
+ * Copyright (C) 2014 Cloudius Systems, Ltd.
+ *
+ * This work is open source software, licensed under the terms of the
+ * BSD license as described in the LICENSE file in the top-level directory.
+ */
+
+#ifndef NETCHANNEL_STATS_HH_
+#define NETCHANNEL_STATS_HH_
+
+#include <cstdint>
+#include <functional>
+
+// Monitoring counters kept by each net_channel. They live in a header of
+// their own so the httpserver modules can export them without dragging in
+// the kernel-side net_channel machinery.
+struct net_channel_stats {
+    uint64_t id;      // registration order, stable for the channel's lifetime
+    uint64_t packets; // packets consumed by process_queue()
+    uint64_t drops;   // pushes refused because the channel ring was full
+    uint64_t wakeups; // process_queue() runs that found packets queued
+    // Count the runs whose head-of-line packet sat queued for at least X
+    // before process_queue() got to it - the same cumulative-threshold
+    // scheme wakeup_stats in <bsd/sys/net/if_data.h> uses.
+    uint64_t waits_1us;
+    uint64_t waits_10us;
+    uint64_t waits_100us;
+    uint64_t waits_1ms;
+    uint64_t waits_10ms;
+};
+
+/**
+ * Increment the appropriate wait counters
+ * @param stats net_channel_stats struct to update
+ * @param wait_ns how long the head-of-line packet waited, in nanoseconds
+ */
+static inline void net_channel_update_wait_stats(net_channel_stats& stats,
+                                                 uint64_t wait_ns)
+{
+    stats.waits_1us   += (wait_ns >= 1000);
+    stats.waits_10us  += (wait_ns >= 10000);
+    stats.waits_100us += (wait_ns >= 100000);
+    stats.waits_1ms   += (wait_ns >= 1000000);
+    stats.waits_10ms  += (wait_ns >= 10000000);
+}
+
+// Call f with the stats of every live channel. The counters are updated
+// without locking, so the values read are a momentary, possibly slightly
+// inconsistent snapshot - good enough for monitoring.
+void net_channel_foreach_stats(std::function<void (const net_channel_stats&)> f);
+
+#endif /* NETCHANNEL_STATS_HH_ */
@@ -15,4 +15,8 @@ void log_packet_in(struct mbuf *m, int proto);
 void log_packet_out(struct mbuf *m, int proto);
 void log_packet_handling(struct mbuf *m, int proto);
 
+// Record a packet entering the per-cpu tx framework, tagged with the
+// sending socket's SO_TRACE_CONTEXT id (see pkthdr.trace_ctx)
+void log_txq_xmit(struct mbuf *m);
+
 #endif
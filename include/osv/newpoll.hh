@@ -15,6 +15,7 @@
 // pollable can only be waited on by a single thread at a time, so
 // it requires less locking.
 
+#include <atomic>
 #include <functional>
 #include <forward_list>
 #include <memory>
@@ -89,6 +90,12 @@ public:
     // Currently, the timer is not a normal pollable and doesn't have a
     // callback. Rather, after calling wait(), do something if expired().
     void set_timer(std::chrono::high_resolution_clock::time_point when);
+    // Same, for callers that already work in uptime terms and don't need
+    // the wall-clock conversion.
+    void set_timer(std::chrono::nanoseconds uptime_when);
+    // Disarm the timer, so wait() no longer returns because of an old
+    // expiration.
+    void cancel_timer();
     bool expired();
 };
 
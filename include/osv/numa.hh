@@ -0,0 +1,54 @@
+/*
+ * Copyright (C) 2026 Waldemar Kozaczuk
+ *
+ * This work is open source software, licensed under the terms of the
+ * BSD license as described in the LICENSE file in the top-level directory.
+ */
+
+#ifndef NUMA_HH_
+#define NUMA_HH_
+
+#include <osv/types.h>
+
+// A small registry of the guest's NUMA topology. On x64 it is populated
+// from the ACPI SRAT by drivers/acpi.cc; when no affinity table exists (or
+// on platforms which don't feed us one) everything stays on node 0 and all
+// lookups degenerate to constants, so callers never need to special-case
+// the non-NUMA configuration.
+namespace numa {
+
+// A modest fixed limit keeps per-node arrays (e.g. the free list columns in
+// core/mempool.cc) cheap; proximity domains beyond it fold into the last
+// node rather than being lost.
+constexpr unsigned max_nodes = 8;
+
+// Number of nodes actually present, at least 1. Stable once the affinity
+// table has been parsed, early in boot before secondary cpus run
+// application threads.
+extern unsigned nr_nodes;
+
+// Topology registration, called by the platform's affinity table parser.
+// Proximity domain values are arbitrary firmware tokens; they are remapped
+// to dense node ids in registration order.
+void add_cpu(u32 apic_id, u32 proximity_domain);
+void add_memory_range(u64 base, u64 length, u32 proximity_domain);
+// Finish registration: fixes nr_nodes and assigns node ids to sched::cpus.
+void complete();
+
+// Node owning the given physical address (or offset into the linear
+// physical memory map); addresses outside any registered range fall back
+// to node 0.
+unsigned node_of(u64 phys);
+
+// Node of the cpu with the given local APIC id, 0 if unknown.
+unsigned cpu_node(u32 apic_id);
+
+// The next physical address above phys where the owning node can change
+// (the nearest start or end of a registered memory range), or ~0ULL when
+// there is none. Lets the page allocator split free ranges on node
+// boundaries.
+u64 node_boundary(u64 phys);
+
+}
+
+#endif /* NUMA_HH_ */
@@ -15,6 +15,7 @@
 #ifndef _NWAY_MERGE_HH
 #define _NWAY_MERGE_HH
 
+#include <cstddef>
 #include <queue>
 #include <vector>
 #include <list>
@@ -246,6 +247,102 @@ private:
     C* _sorted_lists;
     std::list<SPtr> _empty_lists;
 };
+
+/** @class stream_front_comparator
+ * Compares two streams by the record at their cursor, for the
+ * nway_stream_merger heap. Stream::front() values must implement
+ * operator>().
+ */
+template <class Stream>
+class stream_front_comparator {
+public:
+    bool operator()(Stream* a, Stream* b)
+    {
+        return a->front() > b->front();
+    }
+};
+
+/** @class nway_stream_merger "nway_merger.hh"
+ * A non-destructive variant of nway_merger for merging K live,
+ * individually sorted streams - typically cursors over per-cpu rings -
+ * into a single ordered output.
+ *
+ * Unlike nway_merger, which consumes STL-style containers through
+ * begin()/erase(), this merger works through a minimal cursor interface
+ * and never touches stream storage: the output iterator receives exactly
+ * what front() yields (e.g. a pointer into a ring), so the merge itself
+ * is zero-copy. Streams may be refilled by concurrent producers between
+ * drain() calls - every drain() re-examines all registered streams.
+ *
+ * The Stream type must implement:
+ *  - empty() - no record at the cursor right now
+ *  - front() - the record at the cursor; stable until pop()
+ *  - pop()   - advance the cursor past front()
+ *
+ * #### Complexity:
+ * drain() costs O(K) to seed the heap plus O(log(K)) per emitted record.
+ */
+template <class Stream, class Comp = stream_front_comparator<Stream> >
+class nway_stream_merger {
+public:
+    /**
+     * Register a stream. Streams are registered once, up front; an empty
+     * stream simply doesn't participate in a drain until it has records.
+     * @param s the stream, which must outlive the merger
+     */
+    void add_stream(Stream* s)
+    {
+        _streams.push_back(s);
+    }
+
+    /**
+     * Merge-drain up to max_records records into the output iterator, in
+     * an increasing order.
+     *
+     * @param res output iterator receiving Stream::front() values
+     * @param max_records batch limit, so producers that outrun the
+     *                    consumer can't keep a single call busy forever
+     *
+     * @return the number of records emitted
+     */
+    template <class OutputIt>
+    size_t drain(OutputIt res, size_t max_records)
+    {
+        /* Seed the heap with every stream that has something to offer */
+        for (Stream* s : _streams) {
+            if (!s->empty()) {
+                _heap.push(s);
+            }
+        }
+
+        size_t emitted = 0;
+        while (!_heap.empty() && emitted < max_records) {
+            Stream* s = _heap.top();
+            _heap.pop();
+
+            *res = s->front();
+            ++res;
+            ++emitted;
+
+            s->pop();
+            if (!s->empty()) {
+                _heap.push(s);
+            }
+        }
+
+        /* Drop the leftovers: the next drain() re-seeds from scratch,
+           which also picks up whatever producers appended meanwhile */
+        _heap = heap_type();
+
+        return emitted;
+    }
+
+private:
+    typedef std::priority_queue<Stream*, std::vector<Stream*>, Comp> heap_type;
+
+    std::vector<Stream*> _streams;
+    heap_type _heap;
+};
 } /* namespace osv */
 
 
@@ -9,6 +9,7 @@
 #define INCLUDED_OSV_C_WRAPPERS_H
 
 #include <limits.h>
+#include <stdint.h>
 #include <sys/types.h>
 #include <osv/mount.h>
 
@@ -76,6 +77,22 @@ Returns 0 on success, error code on error.
 */
 int osv_get_all_threads(osv_thread** thread_arr, size_t *len);
 
+struct osv_bootchart_event {
+  // Boot phase name
+  char* name;
+
+  // Milliseconds since the first boot event
+  double time_ms;
+};
+
+/*
+Save in *event_arr the boot chronograph events (see <osv/boot.hh>) in
+boot order. *event_arr is allocated with malloc, *len holds length.
+Caller is responsible to free event_arr and the names in it.
+Returns 0 on success, error code on error.
+*/
+int osv_get_bootchart_events(struct osv_bootchart_event** event_arr, size_t *len);
+
 /*
  * Return OSv version as C string. The returned C string is
  * allocated with malloc and caller is responsible to free it
@@ -132,6 +149,22 @@ void osv_current_app_on_termination_request(void (*handler)());
  */
 int osv_run_app(const char *app_path, const char *args[], int args_len);
 
+struct osv_zfetch_stats {
+    uint64_t hits;             /* reads matching an existing prefetch stream */
+    uint64_t misses;
+    uint64_t stride_hits;
+    uint64_t stride_misses;
+    uint64_t fetched_blocks;   /* blocks the prefetcher asked the pool for */
+    uint64_t reclaim_failures;
+};
+
+/*
+ * Snapshot the ZFS prefetcher (dmu_zfetch) counters. Returns non-zero
+ * when ZFS is not loaded. fetched_blocks minus hits approximates wasted
+ * (fetched but never awaited) prefetch.
+ */
+int osv_zfs_zfetch_stats(struct osv_zfetch_stats *stats);
+
 #ifdef __cplusplus
 }
 #endif
@@ -13,6 +13,10 @@
 namespace memory {
 
 void* alloc_page();
+// Like alloc_page(), but the page comes back zeroed - from a percpu
+// magazine pre-zeroed in the background when possible, so the caller
+// usually skips the memset.
+void* alloc_zeroed_page();
 void free_page(void* page);
 void* alloc_huge_page(size_t bytes);
 void free_huge_page(void *page, size_t bytes);
@@ -31,6 +31,7 @@ struct arc_hashkey {
 };
 
 bool get(vfs_file* fp, off_t offset, mmu::hw_ptep<0> ptep, mmu::pt_element<0> pte, bool write, bool shared);
+bool is_cached(vfs_file* fp, off_t offset);
 bool release(vfs_file* fp, void *addr, off_t offset, mmu::hw_ptep<0> ptep);
 void sync(vfs_file* fp, off_t start, off_t end);
 void unmap_arc_buf(arc_buf_t* ab);
@@ -23,4 +23,42 @@ private:
     dynamic_percpu<ulong> _counter;
 };
 
+namespace osv {
+
+// A generalization of per_cpu_counter to a whole structure of counters:
+// T is sharded per cpu, writers bump a counter in their own cpu's copy
+// (addressed as an index into T viewed as an array of ulongs, the same
+// convention the BSD stack's KMOD_*STAT_INC macros use), and nothing is
+// shared until somebody asks for a snapshot, which lazily sums all the
+// shards. Non-counter fields of T are never written by add() and stay
+// zero in every shard, so they contribute nothing to the sum.
+template <typename T>
+class per_cpu_stats {
+public:
+    static_assert(sizeof(T) % sizeof(ulong) == 0,
+                  "T must be a structure of word-sized counters");
+
+    void add(unsigned statnum, ulong val) {
+        sched::preempt_disable();
+        reinterpret_cast<ulong*>(&*_shards)[statnum] += val;
+        sched::preempt_enable();
+    }
+
+    // Add this structure's counters into *out, which the caller may have
+    // pre-filled with non-counter fields (or zeroed).
+    void sum(T* out) {
+        auto o = reinterpret_cast<ulong*>(out);
+        for (auto cpu : sched::cpus) {
+            auto shard = reinterpret_cast<const ulong*>(_shards.for_cpu(cpu));
+            for (unsigned i = 0; i < sizeof(T) / sizeof(ulong); i++) {
+                o[i] += shard[i];
+            }
+        }
+    }
+private:
+    dynamic_percpu<T> _shards;
+};
+
+}
+
 #endif /* PER_CPU_COUNTER_HH_ */
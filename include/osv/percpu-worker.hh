@@ -13,6 +13,7 @@
 #include <osv/percpu.hh>
 #include <osv/condvar.h>
 #include <osv/sched.hh>
+#include <lockfree/ring-mpmc.hh>
 
 #define PCPU_WORKERITEM(name, lambda) \
     worker_item name __attribute__((section(".percpu_workers"))) { lambda }
@@ -35,14 +36,19 @@ public:
 // invokes work items in a per cpu manner
 class workman {
 public:
-    bool signal(sched::cpu* cpu);
+    bool signal(sched::cpu* cpu, worker_item* item);
 private:
+    // signaled items ride to the sheriff on a per-cpu mpmc ring; any cpu
+    // may produce into any other cpu's ring
+    typedef ring_mpmc<worker_item*, unsigned, 256> work_queue;
+
     static sched::cpu::notifier _cpu_notifier;
     static void pcpu_init();
 
     // per CPU thread that invokes worker items
     static percpu<std::atomic<bool>> _duty;
     static percpu<std::atomic<bool>> _ready;
+    static percpu<work_queue*> _queue;
     static percpu<sched::thread *> _work_sheriff;
     static void call_of_duty(void);
 };
@@ -17,6 +17,7 @@
 #include <osv/aligned_new.hh>
 
 #include <bsd/sys/sys/mbuf.h>
+#include <osv/net_trace.hh>
 
 #if BOOST_VERSION < 106600
 #include <boost/function_output_iterator.hpp>
@@ -253,6 +254,40 @@ public:
         }
     }
 
+    /**
+     * Configure doorbell batching for the worker thread.
+     *
+     * By default the worker rings the HW doorbell after every burst it
+     * drains from the per-CPU queues. With batching enabled the kick is
+     * deferred until either @pkts packets or @bytes bytes have been posted
+     * since the last one, or until the oldest unkicked packet has been
+     * sitting for @timeout - whichever comes first. The deferred kick
+     * still goes through the device's kick_pending()/kick_hw() path, so
+     * for virtio it composes with the event-idx suppression in
+     * vring::kick(): batching here saves the exits event-idx can not,
+     * namely one per burst when the host keeps moving the event index.
+     *
+     * The byte bound paces the bytes-in-flight between doorbells: a
+     * single large TSO frame is enough to trigger an immediate kick, so
+     * bulk TCP traffic starts draining at once instead of making the
+     * low-latency packets queued behind it wait out the packet batch.
+     *
+     * The worker always flushes a pending doorbell before it goes to
+     * sleep or yields to the worker of another CPU, so no timer is needed
+     * to enforce the time bound.
+     *
+     * @param pkts    packets per doorbell (<= 1 disables batching)
+     * @param bytes   bytes per doorbell
+     * @param timeout max time a posted packet may wait for the doorbell
+     */
+    void set_doorbell_batching(unsigned pkts, u64 bytes,
+                               std::chrono::microseconds timeout)
+    {
+        _doorbell_batch_pkts = pkts;
+        _doorbell_batch_bytes = bytes;
+        _doorbell_timeout = timeout;
+    }
+
     /**
      * A main transmit function: will try to bypass the per-CPU queue if
      * possible and will push the frame into that queue otherwise.
@@ -266,6 +301,10 @@ public:
      */
     int xmit(mbuf* buff) {
 
+        // Attribute the packet entering the tx framework to its socket's
+        // trace context, so the txq leg of a request shows up in traces.
+        log_txq_xmit(buff);
+
         void* cooky = nullptr;
         int rc = _txq->xmit_prep(buff, cooky);
 
@@ -390,6 +429,10 @@ private:
 
                 if (!_mg.pop(_xmit_it)) {
 
+                    // Ring a deferred doorbell before going to sleep - we
+                    // don't know when the next packet will show up.
+                    flush_doorbell();
+
                     // Wake all unwoken waiters before going to sleep
                     wake_waiters_all();
 
@@ -428,14 +471,17 @@ lock:
                 _txq->kick_pending_with_thresh();
             }
 
-            // Kick any pending work
-            _txq->kick_pending();
+            // Kick any pending work, or defer the kick if doorbell
+            // batching is configured and no batching bound has been
+            // reached yet.
+            kick_or_defer();
 
             if (smp && budget <= 0) {
                 using namespace std::chrono;
                 auto now = osv::clock::uptime::now();
                 auto diff = now - start;
                 if (duration_cast<milliseconds>(diff) >= milliseconds(100)) {
+                    flush_doorbell();
                     unlock_running();
 
                     //
@@ -585,6 +631,38 @@ lock:
         _check_empty_queues.store(false, std::memory_order_relaxed);
     }
 
+    // Doorbell batching helpers. Both may only be called by the worker
+    // while it holds the RUNNING lock. The posted packets and bytes are
+    // taken from the device Tx statistics the worker updates anyway, so
+    // we don't need any extra bookkeeping on the xmit path.
+    void kick_or_defer() {
+        if (_doorbell_batch_pkts <= 1) {
+            _txq->kick_pending();
+            return;
+        }
+
+        auto pkts  = _txq->stats.tx_worker_packets - _kicked_packets;
+        auto bytes = _txq->stats.tx_bytes - _kicked_bytes;
+        auto now = osv::clock::uptime::now();
+
+        if (!_doorbell_armed) {
+            _doorbell_due = now + _doorbell_timeout;
+            _doorbell_armed = true;
+        }
+
+        if ((pkts >= _doorbell_batch_pkts) ||
+            (bytes >= _doorbell_batch_bytes) || (now >= _doorbell_due)) {
+            flush_doorbell();
+        }
+    }
+
+    void flush_doorbell() {
+        _doorbell_armed = false;
+        _kicked_packets = _txq->stats.tx_worker_packets;
+        _kicked_bytes = _txq->stats.tx_bytes;
+        _txq->kick_pending();
+    }
+
 private:
     typedef cpu_queue<CpuTxqSize> cpu_queue_type;
 
@@ -599,6 +677,17 @@ private:
     osv::nway_merger<std::list<cpu_queue_type*>>      _mg    CACHELINE_ALIGNED;
     std::atomic<bool>                  _check_empty_queues    CACHELINE_ALIGNED;
     //
+    // Doorbell batching state (see set_doorbell_batching()). Only ever
+    // touched by the worker under the RUNNING lock.
+    //
+    unsigned _doorbell_batch_pkts = 1;
+    u64 _doorbell_batch_bytes = 0;
+    std::chrono::microseconds _doorbell_timeout{0};
+    bool _doorbell_armed = false;
+    clock::uptime::time_point _doorbell_due;
+    u64 _kicked_packets = 0;
+    u64 _kicked_bytes = 0;
+    //
     // This lock will be used to get an exclusive control over the HW
     // channel.
     //
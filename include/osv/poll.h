@@ -140,9 +140,28 @@ struct poll_file {
  */
 struct pollreq {
     std::vector<poll_file> _pfd;
+    // The fd numbers behind _pfd's entries (negative fds skipped), kept so
+    // the poll() registration cache can match a later call's fd array
+    // against this already-installed request.
+    std::vector<int> _fds;
     nfds_t _nfds;
     std::atomic<bool> _awake = { false };
     sched::thread_handle _poll_thread = { *sched::thread::current() };
+    // Registration-cache state, guarded by poll_cache_mutex (core/poll.cc).
+    // Stays 'none' for ordinary requests. The cache moves it between
+    // 'busy' (the owning thread is inside poll()) and 'cached' (idle
+    // between calls, when a closing fd may retire it); 'retired' means a
+    // closing fd already tore the request down and only the memory remains
+    // for the owner to free.
+    enum class cache_state { none, busy, cached, retired };
+    cache_state _cache_state = cache_state::none;
+    // A closing fd found the request busy; the owner retires it instead
+    // of re-caching when the current call finishes.
+    bool _cache_stale = false;
+    // allocated on every poll() cycle, so served from a dedicated pool
+    // (see core/poll.cc) instead of the general allocator
+    void* operator new(size_t size);
+    void operator delete(void* object);
 };
 
 #endif
@@ -152,6 +171,7 @@ struct file;
 int poll_wake(struct file* fp, int events);
 int poll(struct pollfd _pfd[], nfds_t _nfds, int _timeout);
 void poll_drain(struct file* fp);
+void poll_close_cached(struct file* fp);
 int poll_no_poll(int events);
 __END_DECLS
 
@@ -0,0 +1,29 @@
+#ifndef PRESSURE_H_
+#define PRESSURE_H_
+
+/* Memory pressure notification for applications which keep caches of
+ * their own: poll osv_memory_pressure(), or loop on
+ * osv_wait_memory_pressure() which blocks until the level changes, and
+ * start shedding cache at OSV_MEMORY_PRESSURE. The levels mirror the
+ * C++ enum memory::pressure in <osv/mempool.hh>.
+ */
+
+enum {
+    OSV_MEMORY_RELAXED = 0,
+    OSV_MEMORY_NORMAL = 1,
+    OSV_MEMORY_PRESSURE = 2,
+    OSV_MEMORY_EMERGENCY = 3,
+};
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+int osv_memory_pressure(void);
+int osv_wait_memory_pressure(int last_level);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
@@ -30,6 +30,7 @@ enum {
     reclaimer,
     sched,
     clock,
+    tscclock,
     hpet,
     tracepoint_base,
     malloc_pools,
@@ -0,0 +1,53 @@
+/*
+ * Copyright (C) 2026 Waldemar Kozaczuk
+ *
+ * This work is open source software, licensed under the terms of the
+ * BSD license as described in the LICENSE file in the top-level directory.
+ */
+
+#ifndef OSV_PROCFS_BIN_H
+#define OSV_PROCFS_BIN_H
+
+#include <stdint.h>
+
+/*
+ * Binary counterparts of the hottest procfs text files, for monitoring
+ * agents that poll them at high rates: a read of /proc/osv/stat or
+ * /proc/osv/maps returns the packed structs below, so the reader does a
+ * memcpy instead of parsing text and the kernel skips the string
+ * formatting. The first field of /proc/osv/stat is a version number,
+ * bumped whenever the layout changes.
+ */
+
+#define PROCFS_BIN_STAT_VERSION 1
+
+/* /proc/osv/stat - one struct per read */
+struct procfs_bin_stat {
+    uint64_t version;           /* PROCFS_BIN_STAT_VERSION */
+    uint64_t utime_us;          /* cpu time consumed, microseconds */
+    uint64_t rss_bytes;         /* resident memory */
+    uint64_t vsize_bytes;       /* sum of all vma sizes */
+    uint64_t mem_total_bytes;
+    uint64_t mem_free_bytes;
+    uint64_t context_switches;  /* summed over all cpus */
+    uint64_t preemptions;       /* summed over all cpus */
+    uint32_t nr_threads;
+    uint32_t nr_cpus;
+};
+
+/* /proc/osv/maps - an array of these, one per vma */
+#define PROCFS_BIN_PERM_READ    0x1
+#define PROCFS_BIN_PERM_WRITE   0x2
+#define PROCFS_BIN_PERM_EXEC    0x4
+
+#define PROCFS_BIN_VMA_FILE     0x1     /* file-backed mapping */
+
+struct procfs_bin_vma {
+    uint64_t start;
+    uint64_t end;
+    uint64_t file_offset;       /* 0 unless PROCFS_BIN_VMA_FILE */
+    uint32_t perm;              /* PROCFS_BIN_PERM_* */
+    uint32_t flags;             /* PROCFS_BIN_VMA_* */
+};
+
+#endif /* OSV_PROCFS_BIN_H */
@@ -251,6 +251,14 @@ void rcu_defer(functor func, T* p)
 
 void rcu_synchronize();
 
+// Like rcu_synchronize(), but returns in microseconds rather than waiting
+// for a full grace period to elapse on its own: every other cpu is sent an
+// IPI, and a cpu only delays its confirmation if the IPI actually caught a
+// read-side critical section in progress there. Use for rare, latency-
+// sensitive updates (e.g. configuration reload); the IPI broadcast makes
+// it too expensive for routine use.
+void rcu_synchronize_expedited();
+
 void rcu_flush();
 
 }
@@ -10,6 +10,8 @@
 
 #include <osv/clock.hh>
 
+#include <string>
+
 namespace prof {
 
 struct config {
@@ -32,6 +34,23 @@ void start_sampler(config) throw();
  */
 void stop_sampler() throw();
 
+/**
+ * Starts the profiler: like start_sampler(), but every sample is also
+ * folded into an in-kernel per-cpu stack histogram.
+ *
+ * May block.
+ */
+void start_profiler(config) throw();
+
+/**
+ * Stops the profiler and returns the aggregated samples, symbolized
+ * against the loaded ELF objects, in flamegraph "collapsed stack" format:
+ * one "root;...;leaf count" line per unique stack.
+ *
+ * May block.
+ */
+std::string stop_profiler_and_collect();
+
 }
 
 #endif
@@ -26,6 +26,7 @@
 #include <osv/rcu.hh>
 #include <osv/clock.hh>
 #include <osv/timer-set.hh>
+#include <osv/timer-wheel.hh>
 #include <osv/export.h>
 #include <string.h>
 
@@ -34,7 +35,10 @@ typedef float runtime_t;
 enum {
     FUTEX_WAIT           = 0,
     FUTEX_WAKE           = 1,
+    FUTEX_REQUEUE        = 3,
+    FUTEX_CMP_REQUEUE    = 4,
     FUTEX_WAIT_BITSET    = 9,
+    FUTEX_WAKE_BITSET    = 10,
     FUTEX_PRIVATE_FLAG   = 128,
     FUTEX_CLOCK_REALTIME = 256,
     FUTEX_CMD_MASK       = ~(FUTEX_PRIVATE_FLAG|FUTEX_CLOCK_REALTIME),
@@ -71,6 +75,24 @@ namespace osv {
 class application;
 struct application_runtime;
 
+// Per-application memory accounting, maintained by the malloc path in
+// core/mempool.cc. Every application thread carries a pointer to its
+// application's account; allocations are charged to the allocating thread's
+// account and frees are uncharged against the freeing thread's, so memory
+// handed between applications makes "bytes" an approximation rather than an
+// exact figure. When a non-zero soft_cap is set and usage crosses it, the
+// shrink callback runs once in the context of the allocating thread - the
+// per-app analogue of direct reclaim - and re-arms when usage falls back
+// under the cap. Allocations are never failed because of the cap.
+struct app_mem_account {
+    std::atomic<ssize_t> bytes = {0};
+    std::atomic<size_t> soft_cap = {0};
+    std::atomic<bool> above_cap = {false};
+    // called with the number of bytes by which the cap was exceeded; set
+    // via application::set_mem_soft_cap() before the cap is published
+    std::function<void(size_t)> shrink;
+};
+
 }
 
 /**
@@ -206,7 +228,41 @@ public:
     ~timer_base();
     void set(osv::clock::uptime::time_point time);
     void set_with_irq_disabled(osv::clock::uptime::time_point time);
+    // Arm the timer on the per-cpu low-resolution timer wheel instead of
+    // the default timer_set. Arming and cancelling are O(1) and the clock
+    // event is only reprogrammed when an earlier wheel slot becomes
+    // populated, at the cost of the timer firing up to ~1ms late. Meant
+    // for timers which are usually cancelled before they fire, such as
+    // TCP retransmit timers and BSD callouts.
+    void set_lowres(osv::clock::uptime::time_point time) {
+        _lowres = true;
+        set(time);
+    }
+    template <class Rep, class Period>
+    void set_lowres(std::chrono::duration<Rep, Period> duration) {
+        set_lowres(osv::clock::uptime::now() + duration);
+    }
+    // Arm the timer with a tolerance: it may fire up to 'slack' later than
+    // 'time' if that saves a clock event interrupt (like the Linux timer
+    // slack). The expiry is rounded up to a multiple of the slack, so all
+    // timers armed with the same slack land on shared grid points and their
+    // expirations coalesce into a single interrupt; a slack covering the
+    // low-resolution wheel's slot width additionally routes the timer there
+    // (see set_lowres()), merging it with unrelated nearby timers as well.
+    // Meant for periodic housekeeping - DHCP lease renewal, keepalives, the
+    // async workers - which doesn't care about milliseconds. The timer
+    // never fires before 'time'.
+    void set_with_slack(osv::clock::uptime::time_point time,
+            osv::clock::uptime::duration slack);
+    template <class Rep, class Period>
+    void set_with_slack(std::chrono::duration<Rep, Period> duration,
+            osv::clock::uptime::duration slack) {
+        set_with_slack(osv::clock::uptime::now() + duration, slack);
+    }
     void reset(osv::clock::uptime::time_point time);
+    // Slack-tolerant variant of reset(), see set_with_slack().
+    void reset_with_slack(osv::clock::uptime::time_point time,
+            osv::clock::uptime::duration slack);
     // Set a timer using absolute wall-clock time.
     // CAVEAT EMPTOR: Internally timers are kept using the monotonic (uptime)
     // clock, so the wall-time given here is converted to an uptime.
@@ -235,12 +291,16 @@ public:
     friend bool operator<(const timer_base& t1, const timer_base& t2);
 private:
     void expire();
+    void apply_slack_routing(osv::clock::uptime::duration slack);
 protected:
     client& _t;
     enum class state {
         free, armed, expired
     };
     state _state = state::free;
+    // when true, the timer lives on timer_list's low-resolution wheel
+    // rather than in its timer_set (see set_lowres())
+    bool _lowres = false;
     osv::clock::uptime::time_point _time;
     friend class timer_list;
 };
@@ -415,6 +475,21 @@ public:
             strlcpy(_name.data(), n.data(), sizeof(_name));
             return *this;
         }
+        // Start the thread in the real-time scheduling class (see
+        // set_realtime_priority()), so it never competes on runtime floats
+        // with fair-class threads and there is no window where it runs at
+        // the default priority before its creator gets to change it. A
+        // zero time slice matches SCHED_FIFO, a non-zero one SCHED_RR.
+        attr& realtime(unsigned priority,
+                thread_realtime::duration time_slice =
+                    thread_realtime::duration::zero()) {
+            _realtime_priority = priority;
+            _realtime_time_slice = time_slice;
+            return *this;
+        }
+        unsigned _realtime_priority = 0;
+        thread_realtime::duration _realtime_time_slice =
+                thread_realtime::duration::zero();
     };
 
 private:
@@ -595,13 +670,13 @@ public:
     void detach();
     void set_cleanup(std::function<void ()> cleanup);
     bool is_app() const { return _app; }
-    void set_app_runtime(const std::shared_ptr<osv::application_runtime>& app) {
-        assert(_app);
-        _app_runtime = app;
-    }
+    // defined in sched.cc, where osv::application is a complete type: it
+    // also caches a pointer to the application's memory account
+    void set_app_runtime(const std::shared_ptr<osv::application_runtime>& app);
     std::shared_ptr<osv::application_runtime> app_runtime() {
         return _app_runtime;
     }
+    osv::app_mem_account* mem_account() { return _mem_account; }
     static osv::application *current_app();
     bool migratable() const { return _migration_lock_counter == 0; }
     bool pinned() const { return _pinned; }
@@ -805,6 +880,9 @@ private:
     // wake() on any state except waiting is discarded.
     thread_runtime _runtime;
     thread_realtime _realtime;
+    // when this thread was last put on a runqueue; used by the owning
+    // cpu to account dispatch latency into cpu::stats
+    osv::clock::uptime::time_point _enqueued_at;
     // part of the thread state is detached from the thread structure,
     // and freed by rcu, so that waking a thread and destroying it can
     // occur in parallel without synchronization via thread_handle
@@ -832,6 +910,7 @@ private:
     std::vector<char*> _tls;
     bool _app;
     std::shared_ptr<osv::application_runtime> _app_runtime;
+    osv::app_mem_account* _mem_account = {nullptr};
 public:
     void destroy();
 #ifdef __x86_64__
@@ -905,6 +984,7 @@ public:
     stat_counter stat_migrations;
 private:
     thread_runtime::duration _total_cpu_time {0};
+    unsigned _stats_slot; // index into thread_stats_table (core/sched.cc)
     std::atomic<u64> _cputime_estimator {0}; // for thread_clock()
     inline void cputime_estimator_set(
             osv::clock::uptime::time_point running_since,
@@ -943,17 +1023,49 @@ private:
 
 void init_detached_threads_reaper();
 
+// Batches the cross-cpu notification part of a burst of thread wake()s.
+//
+// While a wakeup_batch is alive on the current thread, wake() still pushes
+// each woken thread onto its target cpu's incoming_wakeups queue right away,
+// but the incoming_wakeups_mask update and the wakeup IPI for remote cpus
+// are deferred to the batch's destructor, which issues at most one IPI per
+// destination cpu. A producer waking dozens of consumers spread over a few
+// cpus thus interrupts each of those cpus once instead of once per consumer.
+//
+// Batches may nest. A batch holds the migration lock for its lifetime: the
+// deferred mask bit is indexed by the waking cpu, so we must not migrate
+// between a deferred push and its flush.
+class wakeup_batch {
+public:
+    wakeup_batch();
+    ~wakeup_batch();
+private:
+    friend class thread;
+    cpu_set _cpus;
+    wakeup_batch* _prev;
+};
+
 class timer_list {
 public:
     void fired();
     void suspend(timer_base::client_list_t& t);
     void resume(timer_base::client_list_t& t);
     void rearm();
+    // Number of clock events this cpu has taken; the idle loop compares
+    // snapshots of it to tell timer wakeups from other interrupts.
+    u64 fired_count() const { return _fired_count; }
 private:
     friend class timer_base;
+    // route a timer to the timer_set or the low-resolution wheel,
+    // depending on how it was armed
+    bool insert(timer_base& t);
+    void remove(timer_base& t);
+    osv::clock::uptime::time_point next_timeout();
     osv::clock::uptime::time_point _last {
             osv::clock::uptime::time_point::max() };
+    u64 _fired_count = 0;
     timer_set<timer_base, &timer_base::hook, osv::clock::uptime> _list;
+    timer_wheel<timer_base, &timer_base::hook, osv::clock::uptime> _wheel;
     class callback_dispatch : private clock_event_callback {
     public:
         callback_dispatch();
@@ -988,6 +1100,9 @@ typedef bi::rbtree<thread,
 struct cpu : private timer_base::client {
     explicit cpu(unsigned id);
     unsigned id;
+    // NUMA node this cpu belongs to (see osv/numa.hh); stays 0 unless the
+    // platform's affinity table says otherwise
+    unsigned node_id = 0;
     struct arch_cpu arch;
     thread* bringup_thread;
     runqueue_type runqueue;
@@ -996,6 +1111,24 @@ struct cpu : private timer_base::client {
     thread* idle_thread;
     // if true, cpu is now polling incoming_wakeups_mask
     std::atomic<bool> idle_poll = { false };
+    // While idle_poll is set this cpu notices wakeups by itself - either
+    // spinning in do_idle() or parked in mwait with the monitor armed on
+    // this word - so senders write idle_kick instead of paying for an IPI
+    // (see send_wakeup_ipi()). Cacheline-aligned so stores to neighbouring
+    // fields don't trip the monitor spuriously.
+    std::atomic<u64> idle_kick CACHELINE_ALIGNED = { 0 };
+    // Pre-halt spin window in nanoseconds, adapted by do_idle() to the
+    // wakeup pattern this cpu actually sees
+    u64 idle_spin_ns = 10000;
+    // set by an idle peer (see request_steal()) asking this cpu to push one
+    // of its queued threads to it instead of waiting for the load balancer
+    std::atomic<cpu*> steal_request = { nullptr };
+    // The balancer thread pinned to this cpu. With idle_quiesce set it
+    // parks without a timer whenever the runqueue is empty, and enqueue()
+    // unparks it when a second thread becomes runnable here (see
+    // load_balance() and wake_balancer_if_parked()).
+    thread* balancer_thread = nullptr;
+    std::atomic<bool> balancer_parked = { false };
     // there is a data dependency between next two fields
     // two cpus can access/modify them simultaneously and
     // they should observe changes in the same order
@@ -1015,10 +1148,13 @@ struct cpu : private timer_base::client {
     bool poll_wakeup_queue();
     void idle();
     void do_idle();
+    void mwait_idle();
     void idle_poll_start();
     void idle_poll_end();
     void send_wakeup_ipi();
     void load_balance();
+    bool request_steal();
+    void handle_steal_request();
     unsigned load();
     /**
      * Try to reschedule.
@@ -1043,6 +1179,41 @@ struct cpu : private timer_base::client {
 #endif
     void enqueue(thread& t);
     void enqueue_first_equal(thread& t);
+    void wake_balancer_if_parked();
+    // Always-on scheduler statistics, updated only by this cpu on its
+    // reschedule path and read racily (single writer, word-sized fields)
+    // by /proc/sched_stats. Queue latency - the time between a thread
+    // being enqueued and dispatched - goes into log2(nanoseconds)
+    // buckets.
+    struct sched_stats {
+        static constexpr unsigned nr_latency_buckets = 32;
+        u64 context_switches;
+        u64 preemptions;
+        u64 queue_latency[nr_latency_buckets];
+        // Idle residency - how long the cpu stayed halted per idle
+        // period, in log2(nanoseconds) buckets - and what ended each
+        // period: a clock event or some other interrupt (device or
+        // wakeup IPI). Expired timers are further attributed to the
+        // preemption timer vs. everything else (sleeping threads,
+        // timeouts), so an "idle" guest that still takes hundreds of
+        // clock events a second shows who is arming them.
+        u64 idle_residency[nr_latency_buckets];
+        u64 idle_wakeups_timer;
+        u64 idle_wakeups_interrupt;
+        u64 timers_fired_preempt;
+        u64 timers_fired_other;
+        // Wakeup IPI delivery latency - from send_wakeup_ipi() on the
+        // sender to handle_incoming_wakeups() observing the wake on this
+        // cpu - in the same log2(nanoseconds) buckets. This is the cost
+        // of getting a halted cpu back to work, which differs wildly
+        // between hypervisors and idle states.
+        u64 ipi_wakeups;
+        u64 ipi_latency[nr_latency_buckets];
+    };
+    sched_stats stats = {};
+    // Set by the remote sender in send_wakeup_ipi(), cleared and
+    // bucketed into stats.ipi_latency by handle_incoming_wakeups()
+    std::atomic<u64> wakeup_ipi_sent_at = {0};
     void init_idle_thread();
     virtual void timer_fired() override;
     class notifier;
@@ -1522,6 +1693,13 @@ timer::timer(thread& t)
 
 extern std::vector<cpu*> cpus;
 
+// Set by the --idle-quiesce boot option: when a cpu has nothing to run,
+// its periodic housekeeping (currently the load balancer tick) is armed
+// with a one second slack instead of a tight 100ms period, so the
+// housekeeping of all idle cpus coalesces into a single aligned wakeup
+// slot per second (see timer_base::set_with_slack()).
+extern bool idle_quiesce;
+
 inline void migrate_disable()
 {
     thread::current()->_migration_lock_counter++;
@@ -11,12 +11,20 @@
 #include <osv/mutex.h>
 #include <boost/intrusive/list.hpp>
 #include <osv/sched.hh>
+#include <osv/flat-combiner.hh>
 
 class semaphore {
 public:
     explicit semaphore(unsigned val);
     virtual ~semaphore() {}
-    virtual void post(unsigned units = 1) { WITH_LOCK(_mtx) { post_unlocked(units); } }
+    // post() is the hot side: producers on many cpus may hit it millions
+    // of times a second, so contending posts are flat-combined and
+    // applied in a batch by a single thread. wait() keeps taking _mtx
+    // directly - a waiter may have to block, which only works under the
+    // mutex - and excludes the combiner via the same lock.
+    virtual void post(unsigned units = 1) {
+        _post_combiner.combine(units, [this] (unsigned u) { post_unlocked(u); });
+    }
 
     bool wait(unsigned units = 1, sched::timer* tmr = nullptr);
     bool trywait(unsigned units = 1);
@@ -32,6 +40,7 @@ protected:
     boost::intrusive::list<wait_record,
                           boost::intrusive::base_hook<wait_record>,
                           boost::intrusive::constant_time_size<false>> _waiters;
+    osv::flat_combiner<unsigned> _post_combiner {_mtx};
 };
 
 #endif /* SEMAPHORE_HH_ */
@@ -0,0 +1,116 @@
+/*
+ * Copyright (C) 2026 Waldemar Kozaczuk
+ *
+ * This work is open source software, licensed under the terms of the
+ * BSD license as described in the LICENSE file in the top-level directory.
+ */
+
+#ifndef SEQLOCK_HH_
+#define SEQLOCK_HH_
+
+#include <atomic>
+#include <osv/types.h>
+#include <osv/mutex.h>
+
+namespace osv {
+
+//
+// Sequence lock for read-mostly data, generalizing the version-counter
+// protocol pvclock-abi.hh hand-rolls against the hypervisor's time
+// structures: the writer bumps a counter to an odd value before updating
+// the data and to an even value after, and a reader retries its snapshot
+// whenever the counter was odd or changed under it. Unlike a rwlock,
+// readers never write shared memory, so concurrent readers on different
+// cpus don't bounce a lock's cache line between them - but a reader can
+// starve if writes are frequent, so this fits data updated rarely or in
+// batches.
+//
+// seq_counter is the bare protocol for embedding next to data updated
+// from a single context; writers must be serialized externally. Readers
+// must tolerate garbage in their snapshot (no pointers chased, no
+// division by a torn value) since torn data is only detected afterwards,
+// by read_retry().
+//
+class seq_counter {
+public:
+    // reader: returns the version to hand to read_retry(), waiting out
+    // any write in progress
+    u32 read_begin() const {
+        u32 seq;
+        while ((seq = _seq.load(std::memory_order_acquire)) & 1) {
+#ifdef __x86_64__
+            __asm __volatile("pause");
+#endif
+#ifdef __aarch64__
+            __asm __volatile("isb sy");
+#endif
+        }
+        return seq;
+    }
+
+    // reader: true when a writer raced with the snapshot and it must be
+    // taken again
+    bool read_retry(u32 seq) const {
+        // Keep the snapshot's loads before the re-load of the counter
+        std::atomic_thread_fence(std::memory_order_acquire);
+        return _seq.load(std::memory_order_relaxed) != seq;
+    }
+
+    // writer side; calls must be externally serialized
+    void write_begin() {
+        _seq.store(_seq.load(std::memory_order_relaxed) + 1,
+                   std::memory_order_relaxed);
+        // Keep the data stores after the counter went odd
+        std::atomic_thread_fence(std::memory_order_release);
+    }
+
+    void write_end() {
+        // Keep the data stores before the counter goes even again
+        std::atomic_thread_fence(std::memory_order_release);
+        _seq.store(_seq.load(std::memory_order_relaxed) + 1,
+                   std::memory_order_relaxed);
+    }
+
+private:
+    std::atomic<u32> _seq {0};
+};
+
+//
+// Value wrapper serializing writers on an internal mutex; read() returns
+// a consistent copy of the whole value.
+//
+template <typename T>
+class seqlock {
+public:
+    T read() const {
+        T copy;
+        u32 seq;
+        do {
+            seq = _counter.read_begin();
+            copy = _data;
+        } while (_counter.read_retry(seq));
+        return copy;
+    }
+
+    template <typename Fn>
+    void update(Fn&& fn) {
+        WITH_LOCK(_write_lock) {
+            _counter.write_begin();
+            fn(_data);
+            _counter.write_end();
+        }
+    }
+
+    void write(const T& value) {
+        update([&] (T& data) { data = value; });
+    }
+
+private:
+    mutex _write_lock;
+    seq_counter _counter;
+    T _data {};
+};
+
+}
+
+#endif /* SEQLOCK_HH_ */
@@ -0,0 +1,38 @@
+/*
+ * Copyright (C) 2026 Waldemar Kozaczuk
+ *
+ * This work is open source software, licensed under the terms of the
+ * BSD license as described in the LICENSE file in the top-level directory.
+ */
+
+#ifndef INCLUDED_OSV_SNAPSHOT_HH
+#define INCLUDED_OSV_SNAPSHOT_HH
+
+#include <functional>
+
+namespace osv {
+namespace snapshot {
+
+// Quiesce the guest ahead of a VMM (e.g. Firecracker) snapshot: flush dirty
+// file data and park the devices via the driver suspend hooks. Pausing the
+// vcpus is the VMM's job; call this right before requesting the snapshot.
+void prepare();
+
+// Fix up state after the VMM resumed a restored clone: resume the drivers
+// and run the registered fixups (wall clock resync, entropy reseed), then
+// re-acquire the DHCP lease.
+void resume();
+
+// Register a fixup to run on every resume.
+void on_resume(std::function<void ()> fixup);
+
+}
+}
+
+// C entry points for a guest agent coordinating with the VMM
+extern "C" {
+void osv_snapshot_prepare();
+void osv_snapshot_resume();
+}
+
+#endif
@@ -54,6 +54,40 @@ void irq_spin_lock(irq_spinlock_t *sl);
 bool irq_spin_trylock(irq_spinlock_t *sl);
 void irq_spin_unlock(irq_spinlock_t *sl);
 
+// Queued (MCS) spin lock. Each waiter spins on its own stack-allocated
+// node instead of the shared lock word, so under contention the line
+// holding the lock is not bounced between the spinning cpus and the
+// lock is handed over in FIFO order. Prefer it over spinlock for locks
+// with measurable waiter counts; the plain spinlock remains cheaper
+// when contention is rare. The node must live until qspin_unlock()
+// returns - a local variable in the locking function is the usual
+// choice:
+//
+//     qspin_node_t node;
+//     qspin_lock(&lock, &node);
+//     ...
+//     qspin_unlock(&lock, &node);
+
+typedef struct qspin_node {
+    struct qspin_node *_next;
+    bool _wait;
+} qspin_node_t;
+
+typedef struct qspinlock {
+    struct qspin_node *_tail;
+#ifdef __cplusplus
+    inline constexpr qspinlock() : _tail(nullptr) { }
+#endif
+} qspinlock_t;
+
+static inline void qspinlock_init(qspinlock_t *sl)
+{
+    sl->_tail = 0;
+}
+void qspin_lock(qspinlock_t *sl, qspin_node_t *node);
+bool qspin_trylock(qspinlock_t *sl, qspin_node_t *node);
+void qspin_unlock(qspinlock_t *sl, qspin_node_t *node);
+
 __END_DECLS
 
 #ifdef __cplusplus
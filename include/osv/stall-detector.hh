@@ -0,0 +1,35 @@
+/*
+ * Copyright (C) 2026 Waldemar Kozaczuk
+ *
+ * This work is open source software, licensed under the terms of the
+ * BSD license as described in the LICENSE file in the top-level directory.
+ */
+
+#ifndef _OSV_STALL_DETECTOR_HH
+#define _OSV_STALL_DETECTOR_HH
+
+#include <osv/clock.hh>
+
+namespace osv {
+
+/**
+ * Starts the stall detector: a periodic per-cpu timer that compares the
+ * expected and actual tick times and records every tick arriving more
+ * than the given threshold late into the trace buffer, together with a
+ * backtrace of the interrupted context. A lightweight hung-task and
+ * hardlockup detector for long irq-disabled sections and host steal time.
+ *
+ * May block.
+ */
+void start_stall_detector(osv::clock::uptime::duration threshold) throw();
+
+/**
+ * Stops the stall detector.
+ *
+ * May block.
+ */
+void stop_stall_detector() throw();
+
+}
+
+#endif
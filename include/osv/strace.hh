@@ -12,5 +12,10 @@
 
 void start_strace();
 void wait_strace_complete();
+void print_trace(trace_record* tr);
+// Stream length-prefixed binary trace records to a TCP collector
+// ("tcp:<ip>:<port>") or a writable path (e.g. a serial port device or
+// a host-shared file)
+void start_trace_stream(const char* dest);
 
 #endif
@@ -0,0 +1,28 @@
+/*
+ * Copyright (C) 2026 Waldemar Kozaczuk
+ *
+ * This work is open source software, licensed under the terms of the
+ * BSD license as described in the LICENSE file in the top-level directory.
+ */
+
+#ifndef _OSV_SYSCALL_STATS_HH
+#define _OSV_SYSCALL_STATS_HH
+
+#include <string>
+
+namespace syscall_stats {
+
+// Turn per-syscall invocation counting and log2 latency histograms on or
+// off. Accounting covers the syscall() dispatcher, so both the trap entry
+// path and applications calling syscall(2) directly are counted.
+void enable(bool = true);
+bool enabled();
+
+// One "name count N log2ns b0 ... b31" line per syscall invoked since
+// accounting was enabled, where bucket i counts invocations which took
+// between 2^i and 2^(i+1)-1 nanoseconds; served as /proc/syscall_stats
+std::string format();
+
+}
+
+#endif
@@ -0,0 +1,77 @@
+/*
+ * Copyright (C) 2026 Waldemar Kozaczuk
+ *
+ * This work is open source software, licensed under the terms of the
+ * BSD license as described in the LICENSE file in the top-level directory.
+ */
+
+#ifndef OSV_TASK_ENGINE_H
+#define OSV_TASK_ENGINE_H
+
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * A run-to-completion task engine: one pinned event-loop thread per cpu
+ * that runs posted tasks, timer callbacks and event callbacks inline,
+ * without waking worker threads or switching context per request. Since
+ * everything belonging to one engine runs on its single loop thread,
+ * callbacks for the same engine never run concurrently and need no
+ * locking among themselves.
+ *
+ * Callbacks must not block: a sleeping callback stalls every other task
+ * on that cpu's engine. Blocking work should be handed to an ordinary
+ * thread, which can post its completion back to the engine.
+ */
+
+typedef struct osv_task_engine osv_task_engine;
+typedef struct osv_task_engine_event osv_task_engine_event;
+
+/* Number of engines available (one per cpu). */
+unsigned osv_task_engine_cpus(void);
+
+/* The engine pinned to the given cpu, starting it on first use.
+ * Returns NULL if cpu is out of range. */
+osv_task_engine *osv_task_engine_for_cpu(unsigned cpu);
+
+/* Queue fn(arg) to run on the engine's loop thread. May be called from
+ * any thread; tasks from one caller run in posting order. Allocates, so
+ * it must not be called from interrupt context - signal a pre-created
+ * event from there instead. Returns 0 on success. */
+int osv_task_engine_post(osv_task_engine *eng, void (*fn)(void *), void *arg);
+
+/* Run fn(arg) on the engine's loop thread once, delay_ns nanoseconds
+ * from now. Returns 0 on success. */
+int osv_task_engine_timer(osv_task_engine *eng, uint64_t delay_ns,
+                          void (*fn)(void *), void *arg);
+
+/* Create an event on the engine: each signal makes the engine run
+ * fn(arg) once on its loop thread (signals arriving before the callback
+ * has run coalesce, like an edge-triggered eventfd). */
+osv_task_engine_event *osv_task_engine_event_new(osv_task_engine *eng,
+                                                 void (*fn)(void *),
+                                                 void *arg);
+
+/* Signal an event. Lock-free and allocation-free: safe from any thread
+ * and from interrupt context. */
+void osv_task_engine_event_signal(osv_task_engine_event *ev);
+
+/* Destroy an event. The callback will not run again once this returns;
+ * it must not be called from the event's own callback. */
+void osv_task_engine_event_free(osv_task_engine_event *ev);
+
+/* Before blocking when idle, let the engine busy-poll the NIC receive
+ * rings for up to budget_us microseconds, so network events are picked
+ * up without taking the interrupt path (see osv/net_busy_poll.hh).
+ * 0 (the default) disables spinning. */
+void osv_task_engine_set_poll_budget(osv_task_engine *eng,
+                                     unsigned budget_us);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* OSV_TASK_ENGINE_H */
@@ -0,0 +1,280 @@
+/*
+ * Copyright (C) 2026 Waldemar Kozaczuk
+ *
+ * This work is open source software, licensed under the terms of the
+ * BSD license as described in the LICENSE file in the top-level directory.
+ */
+
+#ifndef __OSV_TIMER_WHEEL_HH
+#define __OSV_TIMER_WHEEL_HH
+
+#include <chrono>
+#include <limits>
+#include <bitset>
+#include <osv/debug.hh>
+#include <boost/intrusive/list.hpp>
+
+namespace bi = boost::intrusive;
+
+/**
+ * A timer wheel for low-resolution timers, complementing timer_set.
+ *
+ * Unlike timer_set, which defers sorting until expiry but still pays
+ * O(log n)-ish costs when many buckets are populated, the wheel divides
+ * the near future into fixed-width slots (about 1ms each) so insert and
+ * cancel are strictly O(1), and the next-timeout estimate only changes
+ * when an earlier slot becomes non-empty. Timers may fire up to one slot
+ * width late - that's the contract callers opt into (e.g. TCP retransmit
+ * and keepalive timers, where sub-millisecond accuracy is pointless and
+ * the vast majority of timers are cancelled before they fire).
+ *
+ * Timers beyond the wheel's horizon (roughly a quarter of a second) are
+ * parked on an overflow list and re-inserted in bulk once the wheel has
+ * turned close enough, so arbitrarily long timeouts are still supported
+ * without per-revolution cascading of every far timer.
+ *
+ * The template type "Timer" should have a method named get_timeout()
+ * which returns Clock::time_point denoting the timer's expiration.
+ */
+template<typename Timer, bi::list_member_hook<> Timer::*link, typename Clock>
+class timer_wheel {
+public:
+    using time_point = typename Clock::time_point;
+private:
+    using duration = typename Clock::duration;
+    using timestamp_t = typename Clock::duration::rep;
+    using timer_list_t = bi::list<Timer,
+        bi::member_hook<Timer, bi::list_member_hook<>, link>>;
+
+    static constexpr timestamp_t max_timestamp =
+        std::numeric_limits<timestamp_t>::max();
+    // 2^20 ns =~ 1.05ms per slot, 256 slots =~ 268ms horizon
+    static constexpr int slot_bits = 20;
+    static constexpr int n_slots = 256;
+    static constexpr timestamp_t slot_width = timestamp_t(1) << slot_bits;
+    static constexpr timestamp_t horizon = slot_width * n_slots;
+
+    timer_list_t _slots[n_slots];
+    timer_list_t _far;
+    // timers armed with an already-elapsed deadline; drained by the next
+    // expire() call, mirroring timer_set's reserved last bucket
+    timer_list_t _past;
+    timer_list_t _expired;
+    // everything up to and including _last has already been expired
+    timestamp_t _last;
+    // smallest timestamp on the _far list, max_timestamp when it's empty
+    timestamp_t _far_next;
+    std::bitset<n_slots> _non_empty_slots;
+private:
+    static timestamp_t get_timestamp(time_point tp)
+    {
+        return tp.time_since_epoch().count();
+    }
+
+    static timestamp_t get_timestamp(Timer& timer)
+    {
+        return get_timestamp(timer.get_timeout());
+    }
+
+    static int get_slot(timestamp_t timestamp)
+    {
+        return (timestamp >> slot_bits) & (n_slots - 1);
+    }
+
+    // A slot's timers are considered due once the clock passes the slot's
+    // upper boundary - this is what makes the timers "low resolution".
+    static timestamp_t slot_end(timestamp_t timestamp)
+    {
+        return ((timestamp >> slot_bits) + 1) << slot_bits;
+    }
+
+    bool insert_near(Timer& timer, timestamp_t timestamp)
+    {
+        auto old_next = get_next_timestamp();
+        auto slot = get_slot(timestamp);
+        _slots[slot].push_back(timer);
+        _non_empty_slots[slot] = true;
+        return slot_end(timestamp) < old_next;
+    }
+
+    // Move timers which came within the horizon from the overflow list
+    // into their slots. Called with the wheel already drained up to _last.
+    void pull_near_far_timers()
+    {
+        _far_next = max_timestamp;
+        timer_list_t still_far;
+        while (!_far.empty()) {
+            auto& timer = *_far.begin();
+            _far.pop_front();
+            auto timestamp = get_timestamp(timer);
+            if (slot_end(timestamp) <= _last) {
+                // expire() ran so late the far timer is already due
+                _past.push_back(timer);
+            } else if (timestamp - _last < horizon) {
+                insert_near(timer, timestamp);
+            } else {
+                still_far.push_back(timer);
+                _far_next = std::min(_far_next, timestamp);
+            }
+        }
+        _far.swap(still_far);
+    }
+
+    timestamp_t get_next_timestamp() const
+    {
+        if (!_past.empty()) {
+            return _last;
+        }
+        if (_non_empty_slots.none()) {
+            return _far_next == max_timestamp ? max_timestamp
+                : slot_end(_far_next);
+        }
+        // Scan at most one full revolution starting just past _last.
+        auto slot = get_slot(_last);
+        for (int i = 0; i < n_slots; ++i) {
+            auto s = (slot + i) & (n_slots - 1);
+            if (_non_empty_slots[s]) {
+                auto base = _last & ~(horizon - 1);
+                auto end = base + (timestamp_t(s) + 1) * slot_width;
+                if (end <= _last) {
+                    end += horizon;
+                }
+                return std::min(end, _far_next == max_timestamp
+                        ? max_timestamp : slot_end(_far_next));
+            }
+        }
+        return max_timestamp;
+    }
+public:
+    timer_wheel()
+        : _last(0)
+        , _far_next(max_timestamp)
+        , _non_empty_slots(0)
+    {
+    }
+
+    /**
+     * Adds timer to the active set in O(1).
+     *
+     * The value returned by timer.get_timeout() is used as the expiry and
+     * must not change while the timer is in the active set.
+     *
+     * Returns true if and only if this insert moved the wheel's next
+     * timeout earlier, in which case the caller should reprogram its
+     * clock event - by design this is rare, since all timers landing in
+     * an already-populated slot share one deadline.
+     */
+    bool insert(Timer& timer)
+    {
+        auto timestamp = get_timestamp(timer);
+        if (slot_end(timestamp) <= _last) {
+            // Already due - park it for the next expire() pass.
+            _past.push_back(timer);
+            return true;
+        }
+        if (timestamp - _last >= horizon) {
+            _far.push_back(timer);
+            if (timestamp < _far_next) {
+                bool earliest = _non_empty_slots.none();
+                _far_next = timestamp;
+                return earliest;
+            }
+            return false;
+        }
+        return insert_near(timer, timestamp);
+    }
+
+    /**
+     * Removes timer from the active set in O(1).
+     *
+     * The timer must be currently in the active set (not expired).
+     */
+    void remove(Timer& timer)
+    {
+        auto timestamp = get_timestamp(timer);
+        if (slot_end(timestamp) <= _last) {
+            _past.erase(_past.iterator_to(timer));
+            return;
+        }
+        if (timestamp - _last >= horizon) {
+            _far.erase(_far.iterator_to(timer));
+            // _far_next may now be stale (too early); that only costs a
+            // spurious expire() call, so don't bother rescanning the list.
+            return;
+        }
+        auto slot = get_slot(timestamp);
+        auto& list = _slots[slot];
+        list.erase(list.iterator_to(timer));
+        if (list.empty()) {
+            _non_empty_slots[slot] = false;
+        }
+    }
+
+    /**
+     * Expires active timers.
+     *
+     * The time points passed to this function must be monotonically
+     * increasing. Use get_next_timeout() to query for the next one.
+     * All timers whose slot boundary is <= now move to the expired set.
+     */
+    void expire(time_point now)
+    {
+        auto timestamp = get_timestamp(now);
+        if (timestamp < _last) {
+            abort("timer_wheel: time going backwards: %ld < %ld\n",
+                  timestamp, _last);
+        }
+        _expired.splice(_expired.end(), _past);
+        auto first = get_slot(_last);
+        // number of slot boundaries the clock crossed since the last call
+        auto nr = std::min<timestamp_t>(
+            (timestamp >> slot_bits) - (_last >> slot_bits), n_slots);
+        for (timestamp_t i = 0; i < nr; ++i) {
+            auto s = (first + i) & (n_slots - 1);
+            _expired.splice(_expired.end(), _slots[s]);
+            _non_empty_slots[s] = false;
+        }
+        // The current slot is only partially elapsed: its timers become
+        // due at the slot's upper boundary, not now. Leave them in place.
+        _last = timestamp;
+        if (_far_next - _last < horizon) {
+            pull_near_far_timers();
+            // pulled-in timers whose slots already fully elapsed relative
+            // to _last would stall; they can only land in the current
+            // (partial) slot or later, so nothing more to collect here
+        }
+    }
+
+    /**
+     * Removes and returns a timer from the expired set, or nullptr when
+     * the expired set is empty.
+     */
+    Timer* pop_expired()
+    {
+        if (_expired.empty()) {
+            return nullptr;
+        }
+        Timer* timer = &*_expired.begin();
+        _expired.pop_front();
+        return timer;
+    }
+
+    /**
+     * Returns a time point at which expire() should be called in order
+     * to ensure timers are expired in a timely manner.
+     */
+    time_point get_next_timeout() const
+    {
+        return time_point(duration(std::max(_last, get_next_timestamp())));
+    }
+
+    /**
+     * Returns true if and only if there are no timers in the active set.
+     */
+    bool empty() const
+    {
+        return _non_empty_slots.none() && _far.empty() && _past.empty();
+    }
+};
+
+#endif
@@ -16,6 +16,8 @@
 #include <boost/intrusive/list.hpp>
 #include <string>
 #include <unordered_set>
+#include <utility>
+#include <vector>
 #include <drivers/clock.hh>
 #include <cstring>
 #include <arch.hh>
@@ -28,6 +30,26 @@ void enable_trace();
 void enable_tracepoint(std::string wildcard);
 void enable_backtraces(bool = true);
 void list_all_tracepoints();
+// Flight recorder mode: always-on tracing of a small curated event set into
+// per-cpu rings of bufsz_kb kilobytes (0 picks a default), dumped on panic
+// or through the regular trace dump API
+void enable_flight_recorder(size_t bufsz_kb = 0);
+void dump_flight_recorder();
+struct trace_record;
+// Size of the serialized arguments (and optional backtrace) following a
+// trace_record, derived from the tracepoint's signature; the absolute
+// timestamp some records carry (see trace_record::payload()) is excluded
+size_t trace_payload_size(const trace_record* tr);
+// The record's thread name from its cpu's intern table ("?" if recycled)
+const char* trace_record_thread_name(const trace_record* tr);
+// The record's absolute timestamp, rebuilt from the per-cpu delta chain;
+// records of one cpu must be fed in buffer order
+u64 trace_record_time(const trace_record* tr);
+// Attach built-in per-cpu hit counters to all tracepoints matching the
+// wildcard, without enabling trace logging for them
+void enable_tracepoint_counting(std::string wildcard);
+// Name and accumulated hit count of every counted tracepoint
+std::vector<std::pair<const char*, ulong>> get_tracepoint_counts();
 
 class tracepoint_base;
 
@@ -36,17 +58,41 @@ struct blob_tag {};
 template<typename T>
 using is_blob = std::is_base_of<blob_tag, T>;
 
+// Version 2 record layout: a 24-byte header against v1's 48. The
+// timestamp is delta-encoded - time_delta holds nanoseconds since the
+// previous record in the same cpu's buffer - and the 16-byte inline
+// thread name was replaced by a slot index into the buffer's thread-name
+// intern table (see trace_buf in core/trace.cc). Records flagged
+// flag_abs_time instead carry a full u64 uptime at the start of buffer[];
+// the first record of every trace page is forced absolute, so a wrapped
+// ring can be decoded from any page boundary. Extracted dumps carry
+// format version 2 in their header for scripts/osv/trace.py.
 struct trace_record {
+    static const u8 flag_backtrace = 1; // 10-element backtrace precedes parameters
+    static const u8 flag_abs_time = 2;  // u64 absolute time starts buffer[]
     tracepoint_base* tp;
     sched::thread* thread;
-    std::array<char, 16> thread_name;
-    u64 time;
-    unsigned cpu;
-    bool backtrace : 1;  // 10-element backtrace precedes parameters
+    u32 time_delta;
+    u16 cpu;
+    u8 flags;
+    u8 name_id;
     union {
         u8 buffer[0];
         long align[0];
     };
+    bool backtrace() const {
+        return flags & flag_backtrace;
+    }
+    bool absolute_time() const {
+        return flags & flag_abs_time;
+    }
+    // Where the (optional) backtrace and the serialized arguments start
+    u8* payload() {
+        return buffer + (absolute_time() ? sizeof(u64) : 0);
+    }
+    const u8* payload() const {
+        return buffer + (absolute_time() ? sizeof(u64) : 0);
+    }
 };
 
 //Simple lock-less multiple-producer single-consumer structure
@@ -79,9 +125,28 @@ struct trace_log {
             return traces[read_offset++];
         }
     }
+
+    // The record read() would return next, without consuming it - for
+    // the merge cursors in strace.cc
+    trace_record* peek() const {
+        if (read_offset == write_offset.load()) {
+            return nullptr;
+        } else {
+            return traces[read_offset];
+        }
+    }
+
+    bool empty() const {
+        return read_offset == write_offset.load();
+    }
 };
 
-extern trace_log* _trace_log;
+// One log per cpu, indexed by cpu id; nullptr until a consumer (strace
+// or trace streaming) allocates them. A cpu appends to its own log only,
+// so the producers never contend on a shared write offset, and each log
+// is a time-sorted stream the consumers merge back into one ordered
+// sequence with osv::nway_stream_merger (see strace.cc).
+extern trace_log** _trace_logs;
 
 template <typename T, typename = void>
 struct signature_char;
@@ -287,7 +352,18 @@ public:
 
     void enable(bool = true);
     void backtrace(bool);
-    
+
+    // Attach (detach) a built-in per-cpu hit counter to this tracepoint.
+    // Counting alone does not enable trace logging, so a counted
+    // tracepoint costs just a per-cpu increment per hit.
+    void count(bool = true);
+    bool counting() const {
+        return _counter;
+    }
+    // Sum of the per-cpu hit counts; 0 if counting was never enabled
+    ulong counter_value();
+
+
     const tracepoint_id id;
     const char* name;
     const char* format;
@@ -306,11 +382,13 @@ protected:
     bool _backtrace = false;
     bool _logging = false;
     bool active = false; // logging || !probes.empty()
+    class counter_probe;
+    counter_probe* _counter = nullptr;
     osv::rcu_ptr<std::vector<probe*>> probes_ptr;
     mutex probes_mutex;
     void run_probes();
     void log_backtrace(trace_record* tr, u8*& buffer) {
-        if (!tr->backtrace) {
+        if (!tr->backtrace()) {
             return;
         }
         do_log_backtrace(tr, buffer);
@@ -367,13 +445,15 @@ public:
             return;
         }
         auto tr = allocate_trace_record(payload_size(as));
-        auto buffer = tr->buffer;
+        auto buffer = tr->payload();
         log_backtrace(tr, buffer);
         serialize(buffer, as);
         barrier();
         tr->tp = this; // do this last to indicate the record is complete
-        if (_trace_log) {
-            _trace_log->write(tr);
+        // cpu is u16(-1) for records logged before threads exist - the
+        // consumers only start after smp, so those are never logged here
+        if (_trace_logs && tr->cpu != u16(-1)) {
+            _trace_logs[tr->cpu]->write(tr);
         }
     }
     void serialize(void* buffer, std::tuple<s_args...> as) {
@@ -37,6 +37,7 @@
 #include <sys/types.h>
 #include <sys/uio.h>
 #include <limits.h>
+#include <string.h>
 
 __BEGIN_DECLS
 
@@ -63,21 +64,47 @@ __END_DECLS
 
 #if defined(__cplusplus) && !defined(USE_C_INTERFACE)
 
+// Calls f on contiguous spans of the uio's data. Adjacent small iovecs
+// are coalesced through a stack buffer so that a consumer which takes a
+// lock per f() call (e.g. the console multiplexer) pays it once per
+// writev rather than once per iovec, and so that a multi-iov record is
+// not interleaved with other writers between its fragments. A single
+// iovec, or one too large to merge, is passed through without copying.
 template <typename F>
 static inline void linearize_uio_write(struct uio *uio, int ioflag, F f)
 {
+    char buf[1024];
+    size_t buffered = 0;
+
     while (uio->uio_resid > 0) {
         struct iovec *iov = uio->uio_iov;
-
-        if (iov->iov_len) {
-            f(reinterpret_cast<const char *>(iov->iov_base),
-                iov->iov_len);
+        size_t len = iov->iov_len;
+
+        if (len) {
+            if (buffered == 0 && (uio->uio_iovcnt == 1 || len >= sizeof(buf))) {
+                f(reinterpret_cast<const char *>(iov->iov_base), len);
+            } else {
+                if (buffered + len > sizeof(buf)) {
+                    f(buf, buffered);
+                    buffered = 0;
+                }
+                if (len >= sizeof(buf)) {
+                    f(reinterpret_cast<const char *>(iov->iov_base), len);
+                } else {
+                    memcpy(buf + buffered, iov->iov_base, len);
+                    buffered += len;
+                }
+            }
         }
 
         uio->uio_iov++;
         uio->uio_iovcnt--;
-        uio->uio_resid -= iov->iov_len;
-        uio->uio_offset += iov->iov_len;
+        uio->uio_resid -= len;
+        uio->uio_offset += len;
+    }
+
+    if (buffered) {
+        f(buf, buffered);
     }
 }
 
@@ -0,0 +1,190 @@
+/*
+ * Copyright (C) 2026 Waldemar Kozaczuk
+ *
+ * This work is open source software, licensed under the terms of the
+ * BSD license as described in the LICENSE file in the top-level directory.
+ */
+
+#ifndef OSV_ULOG_H
+#define OSV_ULOG_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+#include <errno.h>
+
+/*
+ * /dev/ulog - a log transport ring shared between the application and a
+ * kernel drain thread.
+ *
+ * The application mmap()s the device node and appends framed records
+ * with plain memory writes; a kernel thread drains committed records in
+ * order and ships them to the host through the console channel. When
+ * the drain falls behind, new records are dropped and counted rather
+ * than blocking the writer. This turns a high-rate logger (100k+
+ * records/s) from one syscall per line into one compare-and-swap and a
+ * memcpy per line.
+ *
+ * Layout of the mapping: one ULOG_DATA_OFF-sized header page holding
+ * struct ulog_ring_hdr, followed by hdr->data_size bytes of data area
+ * (a power of two). head and tail are free-running byte offsets into
+ * the data area; dropped counts records lost to backpressure.
+ *
+ * Record framing: each record starts on an 8-byte boundary with a
+ * single 64-bit header word - the low 32 bits hold the flags and the
+ * payload length, the high 32 bits the low half of the record's
+ * free-running start offset. A producer reserves space by advancing
+ * head with a compare-and-swap, copies the payload, and publishes the
+ * header word last with a releasing store; the consumer accepts a
+ * record only when ULOG_F_COMMIT is set and the embedded offset matches
+ * its tail, which keeps stale headers from the previous lap invisible
+ * (the ring is far smaller than 4GB). A record never wraps: when it
+ * would cross the end of the data area the producer emits an
+ * ULOG_F_PAD filler covering the remainder of the lap instead.
+ *
+ * The same inline producer/consumer routines below are used by the
+ * libc writer (ulog_write()) and by the in-kernel fallback write()
+ * path, so there is exactly one implementation of the protocol.
+ */
+
+#define ULOG_MAGIC      0x756c6f67u     /* "ulog" */
+#define ULOG_DATA_OFF   4096
+#define ULOG_ALIGN      8
+#define ULOG_REC_HDR    8
+
+#define ULOG_F_COMMIT   0x80000000u
+#define ULOG_F_PAD      0x40000000u
+#define ULOG_LEN_MASK   0x00ffffffu
+
+/* longest payload accepted for a single record */
+#define ULOG_MAX_RECORD 16384
+
+/* ioctls understood by /dev/ulog */
+enum {
+    ULOG_GET_SIZE    = 0x756c00, /* uint64_t*: bytes in the data area */
+    ULOG_GET_DROPPED = 0x756c01, /* uint64_t*: records dropped so far */
+    ULOG_KICK        = 0x756c02, /* wake the drain thread now */
+};
+
+struct ulog_ring_hdr {
+    uint32_t magic;
+    uint32_t data_size;     /* bytes in the data area, a power of two */
+    uint64_t head;          /* producer cursor, free-running */
+    uint64_t tail;          /* consumer cursor, free-running */
+    uint64_t dropped;       /* records dropped because the ring was full */
+};
+
+/*
+ * Append one record. Returns 0 on success, EAGAIN when the ring is full
+ * (the record is counted as dropped) and EMSGSIZE when the payload is
+ * longer than ULOG_MAX_RECORD. Safe against concurrent producers.
+ */
+static inline int
+ulog_ring_append(struct ulog_ring_hdr *h, char *data, const void *payload,
+                 uint32_t len)
+{
+    uint32_t size = h->data_size;
+    uint64_t need, total, pad, head, off, tail, w;
+    char *rec;
+
+    if (len > ULOG_MAX_RECORD) {
+        return EMSGSIZE;
+    }
+    need = (ULOG_REC_HDR + len + ULOG_ALIGN - 1) & ~(uint64_t)(ULOG_ALIGN - 1);
+
+    head = __atomic_load_n(&h->head, __ATOMIC_RELAXED);
+    for (;;) {
+        off = head & (size - 1);
+        pad = (off + need > size) ? size - off : 0;
+        total = pad + need;
+        tail = __atomic_load_n(&h->tail, __ATOMIC_ACQUIRE);
+        if (head + total - tail > size) {
+            __atomic_fetch_add(&h->dropped, 1, __ATOMIC_RELAXED);
+            return EAGAIN;
+        }
+        /* on failure the builtin reloads head for the next attempt */
+        if (__atomic_compare_exchange_n(&h->head, &head, head + total, 1,
+                                        __ATOMIC_ACQ_REL, __ATOMIC_RELAXED)) {
+            break;
+        }
+    }
+
+    if (pad) {
+        /* fill the rest of the lap so the real record starts at 0 */
+        w = ((uint64_t)(uint32_t)head << 32) | ULOG_F_COMMIT | ULOG_F_PAD |
+            (uint32_t)(pad - ULOG_REC_HDR);
+        __atomic_store_n((uint64_t *)(data + (head & (size - 1))), w,
+                         __ATOMIC_RELEASE);
+        head += pad;
+    }
+
+    rec = data + (head & (size - 1));
+    memcpy(rec + ULOG_REC_HDR, payload, len);
+    w = ((uint64_t)(uint32_t)head << 32) | ULOG_F_COMMIT | len;
+    __atomic_store_n((uint64_t *)rec, w, __ATOMIC_RELEASE);
+    return 0;
+}
+
+/*
+ * Pop the next committed record into buf (silently truncated to bufsz),
+ * skipping pad fillers. Returns the number of bytes copied, or 0 when
+ * no record is ready - including when the record at tail is still being
+ * written, in which case delivery waits so that order is preserved.
+ * Single consumer only.
+ */
+static inline size_t
+ulog_ring_pop(struct ulog_ring_hdr *h, char *data, char *buf, size_t bufsz)
+{
+    uint32_t size = h->data_size;
+    uint64_t tail, head, w;
+    uint32_t len;
+    size_t n;
+    char *rec;
+
+    for (;;) {
+        tail = h->tail;     /* we are the only writer of tail */
+        head = __atomic_load_n(&h->head, __ATOMIC_ACQUIRE);
+        if (tail == head) {
+            return 0;
+        }
+        rec = data + (tail & (size - 1));
+        w = __atomic_load_n((uint64_t *)rec, __ATOMIC_ACQUIRE);
+        if (!(w & ULOG_F_COMMIT) || (uint32_t)(w >> 32) != (uint32_t)tail) {
+            return 0;
+        }
+        len = w & ULOG_LEN_MASK;
+        if (w & ULOG_F_PAD) {
+            __atomic_store_n(&h->tail, tail + ULOG_REC_HDR + len,
+                             __ATOMIC_RELEASE);
+            continue;
+        }
+        n = len < bufsz ? len : bufsz;
+        memcpy(buf, rec + ULOG_REC_HDR, n);
+        __atomic_store_n(&h->tail,
+                         tail + ((ULOG_REC_HDR + len + ULOG_ALIGN - 1) &
+                                 ~(uint64_t)(ULOG_ALIGN - 1)),
+                         __ATOMIC_RELEASE);
+        return n;
+    }
+}
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * The libc writer: ulog_open() opens and maps /dev/ulog, after which
+ * ulog_write() is one ring append - no syscall. Returns 0/-1 with errno;
+ * a full ring fails with EAGAIN and shows up in ulog_dropped().
+ */
+struct ulog_writer;
+int ulog_open(struct ulog_writer **out);
+int ulog_write(struct ulog_writer *w, const void *buf, size_t len);
+uint64_t ulog_dropped(struct ulog_writer *w);
+void ulog_close(struct ulog_writer *w);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* OSV_ULOG_H */
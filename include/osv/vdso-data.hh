@@ -0,0 +1,41 @@
+/*
+ * Copyright (C) 2026 Waldemar Kozaczuk
+ *
+ * This work is open source software, licensed under the terms of the
+ * BSD license as described in the LICENSE file in the top-level directory.
+ */
+
+#ifndef OSV_VDSO_DATA_HH_
+#define OSV_VDSO_DATA_HH_
+
+#include <osv/types.h>
+#include <atomic>
+
+struct pvclock_wall_clock;
+struct pvclock_vcpu_time_info;
+
+// Clock state shared between the kernel and the vDSO (libc/vdso/vdso.cc).
+// The vDSO is an ordinary shared object, so it binds __osv_vdso_clock_data
+// like any other kernel symbol when it is loaded, and can then read the
+// paravirtual clock directly on every __vdso_clock_gettime() call instead
+// of calling back into the kernel's generic clock dispatch.
+//
+// The clock driver fills the pointers and boot_systemtime and then sets
+// enabled with a release store; until it does (and on hypervisors without
+// a stable pvclock) the vDSO falls back to the plain clock_gettime() call.
+struct vdso_clock_data {
+    pvclock_wall_clock* wall;     // host wall clock at boot (pvclock ABI)
+    pvclock_vcpu_time_info* sys;  // vcpu0's time info page (pvclock ABI)
+    u64 boot_systemtime;          // system_time() sampled at SMP bring-up
+    std::atomic<u32> enabled;
+};
+
+extern "C" vdso_clock_data __osv_vdso_clock_data;
+
+// Nonzero once every cpu has loaded its id into the IA32_TSC_AUX msr
+// (set at SMP bring-up on hosts with the rdtscp feature, see
+// arch_cpu::init_cpu_id()). __vdso_getcpu() then answers with a single
+// rdtscp instead of calling into the kernel.
+extern "C" std::atomic<u32> __osv_vdso_getcpu_rdtscp;
+
+#endif /* OSV_VDSO_DATA_HH_ */
@@ -0,0 +1,61 @@
+/*
+ * Copyright (C) 2026 Waldemar Kozaczuk
+ *
+ * This work is open source software, licensed under the terms of the
+ * BSD license as described in the LICENSE file in the top-level directory.
+ */
+
+#ifndef VFS_NOTIFY_HH
+#define VFS_NOTIFY_HH
+
+#include <api/sys/inotify.h>
+
+#include <atomic>
+#include <cstdint>
+
+struct vnode;
+
+// Kernel-side hooks for the inotify file-watch facility implemented in
+// libc/inotify.cc. The VFS modification points (vfs_syscalls.cc,
+// vfs_fops.cc) report successful changes through notify() and
+// notify_name(); the masks are the IN_* event bits from <sys/inotify.h>.
+//
+// Watching files is the exception, not the rule, so the hooks must cost
+// nothing on the hot paths (every write() goes through one): while no
+// watch exists anywhere in the system the inline wrappers are a single
+// relaxed load of watch_count and a predicted-not-taken branch.
+namespace vfs_notify {
+
+// Number of watches currently registered, system-wide. Maintained by
+// libc/inotify.cc.
+extern std::atomic<unsigned> watch_count;
+
+void notify_slow(struct vnode* vp, uint32_t mask);
+void notify_name_slow(struct vnode* dir_vp, const char* name, uint32_t mask,
+    uint32_t cookie);
+
+// Returns a fresh nonzero cookie for pairing IN_MOVED_FROM/IN_MOVED_TO
+// events of one rename.
+uint32_t next_cookie();
+
+// Report an event on the object itself (IN_MODIFY, IN_DELETE_SELF, ...).
+inline void notify(struct vnode* vp, uint32_t mask)
+{
+    if (watch_count.load(std::memory_order_relaxed) != 0) {
+        notify_slow(vp, mask);
+    }
+}
+
+// Report an event on the entry @name inside the directory @dir_vp
+// (IN_CREATE, IN_DELETE, IN_MOVED_FROM/IN_MOVED_TO, ...).
+inline void notify_name(struct vnode* dir_vp, const char* name, uint32_t mask,
+    uint32_t cookie = 0)
+{
+    if (watch_count.load(std::memory_order_relaxed) != 0) {
+        notify_name_slow(dir_vp, name, mask, cookie);
+    }
+}
+
+}
+
+#endif
@@ -9,6 +9,7 @@
 #define VFS_FILE_HH_
 
 #include <osv/file.h>
+#include <atomic>
 
 class vfs_file final : public file {
 public:
@@ -23,10 +24,27 @@ public:
     virtual int chmod(mode_t mode) override;
     virtual std::unique_ptr<mmu::file_vma> mmap(addr_range range, unsigned flags, unsigned perm, off_t offset) override;
     virtual bool map_page(uintptr_t offset, mmu::hw_ptep<0> ptep, mmu::pt_element<0> pte, bool write, bool shared);
+    virtual bool cached_page(uintptr_t offset) override;
     virtual bool put_page(void *addr, uintptr_t offset, mmu::hw_ptep<0> ptep);
     virtual void sync(off_t start, off_t end);
 
     int read_page_from_cache(void *key, off_t offset);
+
+private:
+    // Sequential-read detection, protected by the vnode lock which already
+    // serializes read() on this file. When a streak of back-to-back reads
+    // is seen, the next window of the file is read ahead asynchronously to
+    // warm the filesystem's own cache (ZFS ARC, ROFS segment cache, the
+    // buffer cache), so a plain read() loop streams at device bandwidth
+    // regardless of which filesystem backs the file.
+    void consider_read_ahead(struct vnode *vp, off_t offset, size_t count);
+    off_t _next_read_offset = 0;    // Where a sequential reader would read next
+    unsigned _seq_streak = 0;       // Consecutive sequential reads seen
+    off_t _ra_next = 0;             // File offset up to which readahead was issued
+    std::atomic<bool> _ra_inflight = {false};   // One readahead at a time per file
+
+    friend void vfs_file_read_ahead(vfs_file *fp, off_t offset, size_t len);
+    friend void vfs_file_read_ahead_done(vfs_file *fp);
 };
 
 #endif /* VFS_FILE_HH_ */
@@ -126,6 +126,8 @@ struct vattr {
 
 #define IO_APPEND	0x0001
 #define IO_SYNC		0x0002
+#define IO_DIRECT	0x0004	/* O_DIRECT: bypass the filesystem's cache
+				   where the filesystem supports it */
 
 /*
  * ARC actions
@@ -75,6 +75,22 @@ public:
      * wake_all() must be called with the mutex held.
      */
     void wake_all(mutex& mtx);
+    /**
+     * Wake up to count threads waiting on the condition variable
+     *
+     * Wake the count oldest of the threads currently waiting on the
+     * condition variable, or fewer if not that many are waiting. Since
+     * the queue is FIFO and awakened threads re-queue at the tail when
+     * they wait again, repeated wake_many(mtx, 1) calls rotate fairly
+     * through a pool of waiters (e.g. acceptor threads), and a batch of
+     * count events wakes exactly count of them.
+     *
+     * The threads are not awakened immediately; they will only wake after
+     * mtx is released.
+     *
+     * wake_many() must be called with the mutex held.
+     */
+    void wake_many(mutex& mtx, size_t count);
     /**
      * Query whether any threads are waiting on the waitqueue.
      *
@@ -0,0 +1,54 @@
+/*
+ * Copyright (C) 2026 Waldemar Kozaczuk
+ *
+ * This work is open source software, licensed under the terms of the
+ * BSD license as described in the LICENSE file in the top-level directory.
+ */
+
+#ifndef OSV_WORKQUEUE_HH
+#define OSV_WORKQUEUE_HH
+
+#include <chrono>
+#include <functional>
+#include <osv/types.h>
+
+// Shared pools of kernel worker threads, replacing the pattern of every
+// subsystem spawning a dedicated thread (with its own stack) for
+// occasional background work. Pool threads are created on demand, up to
+// a per-class concurrency limit, and exit again after sitting idle, so
+// a mostly-idle guest carries no extra threads at all.
+//
+// Three priority classes are provided; each maps to a scheduler priority
+// and its own pool, so a backlog of low-priority work (e.g. readahead)
+// can never delay high-priority work behind it.
+namespace workqueue {
+
+enum class prio { high = 0, normal = 1, low = 2 };
+
+// Run @fn on a pool thread of class @p as soon as one is available.
+// @fn may sleep; it must not run forever, since it occupies one of the
+// class's limited threads while it runs.
+void queue(prio p, std::function<void()> fn);
+
+// Run @fn on a pool thread of class @p no earlier than @delay from now.
+// Periodic work is expressed by rescheduling itself from its callback.
+void queue_after(prio p, std::chrono::nanoseconds delay,
+                 std::function<void()> fn);
+
+// Limit how many pool threads of class @p may exist concurrently.
+// The defaults are one thread per CPU for high and normal, and a single
+// thread for low.
+void set_max_threads(prio p, unsigned count);
+
+struct stats {
+    u64 queued;           // work items ever submitted
+    u64 executed;         // work items completed
+    unsigned threads;     // pool threads currently alive
+    unsigned max_threads; // concurrency limit
+    size_t backlog;       // items waiting, including not-yet-due delayed work
+};
+stats get_stats(prio p);
+
+}
+
+#endif
@@ -1,6 +1,37 @@
 #ifndef _ZCOPY_H
 #define _ZCOPY_H
 
+/*
+ * Zero-copy socket I/O, OSv specific.
+ *
+ * OSv runs the application in the kernel address space, so "mapping" a
+ * received buffer is just handing out a pointer: zcopy_rx() fills the
+ * caller's msg_iov with pointers straight into the mbuf clusters the NIC
+ * received into, instead of copying through uiomove() like recvmsg().
+ * The mbufs are detached from the socket buffer and owned by the caller
+ * until zcopy_rxgc() releases them; the release is refcounted (clusters
+ * may be shared) and returns the buffers to the cluster pools the
+ * driver's rx ring refills from, so sitting on a large backlog of
+ * unreleased buffers can starve receive.
+ *
+ * zcopy_rx() is only valid on SOCK_STREAM sockets. zm_msg.msg_iovlen
+ * caps how many segments one call may return; on return it holds the
+ * number of segments actually filled, and zm_rxhandle the token to pass
+ * to zcopy_rxgc(). zm_msg.msg_flags may carry MSG_DONTWAIT and
+ * MSG_WAITALL with their usual recvmsg() meaning (other flags fail with
+ * EINVAL - notably MSG_PEEK cannot work without a copy), and reports
+ * flags like MSG_EOR back on return.
+ *
+ * zcopy_tx() queues the caller's iovec pages directly to the NIC;
+ * completion is signaled on the zm_txfd eventfd, after which the caller
+ * may reuse the buffers and must call zcopy_txclose().
+ *
+ * zcopy_sendfile() is the internal backend of sendfile(): it queues a
+ * mapped file region (whose pages are the pagecache/ARC pages themselves)
+ * and takes ownership of the mapping, unmapping it once the stack has
+ * released every queued byte. See the comment at its definition.
+ */
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -14,6 +45,8 @@ struct zmsghdr {
 
 ssize_t zcopy_tx(int sockfd, struct zmsghdr *zm);
 void zcopy_txclose(struct zmsghdr *zm);
+ssize_t zcopy_sendfile(int sockfd, void *base, size_t map_len,
+                       void *data, size_t count);
 ssize_t zcopy_rx(int sockfd, struct zmsghdr *zm);
 int zcopy_rxgc(struct zmsghdr *zm);
 
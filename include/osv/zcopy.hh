@@ -3,9 +3,16 @@
 
 #include <osv/zcopy.h>
 
+#include <functional>
+
 struct ztx_handle {
     ztx_handle() : zh_remained(0) {};
     std::atomic<size_t> zh_remained;
+    // Optional completion hook, run once the stack has released every
+    // queued byte. zcopy_sendfile() uses it to drop the file mapping the
+    // mbufs point into; zcopy_tx() leaves it unset and is signaled over
+    // the zm_txfd eventfd instead.
+    std::function<void()> zh_done;
 };
 
 #endif
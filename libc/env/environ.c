@@ -0,0 +1,156 @@
+/*
+ * Copyright (C) 2026 Waldemar Kozaczuk
+ *
+ * This work is open source software, licensed under the terms of the
+ * BSD license as described in the LICENSE file in the top-level directory.
+ */
+
+/*
+ * Immutable-snapshot environment, replacing musl's env/*.c which mutate
+ * the environment array in place.
+ *
+ * getenv() scans the currently published array with plain loads and no
+ * locking. Writers (setenv/putenv/unsetenv/clearenv) serialize on a
+ * mutex, build a fresh NULL-terminated array and publish it to __environ
+ * with a release store. Replaced arrays and "name=value" strings are
+ * deliberately never freed: environment writes are rare, concurrent
+ * readers may still be scanning an old array, and applications hold on
+ * to getenv() results indefinitely, so the small leak buys fully
+ * lock-free reads without any grace-period machinery.
+ *
+ * An application remains free to assign to environ directly; writers
+ * always start from whatever array is currently published.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <pthread.h>
+
+extern char **__environ;
+
+static pthread_mutex_t env_mutex = PTHREAD_MUTEX_INITIALIZER;
+
+char *getenv(const char *name)
+{
+	size_t l = strcspn(name, "=");
+	char **e = __atomic_load_n(&__environ, __ATOMIC_ACQUIRE);
+	if (l && !name[l] && e) {
+		for (; *e; e++) {
+			if (!strncmp(name, *e, l) && (*e)[l] == '=') {
+				return *e + l + 1;
+			}
+		}
+	}
+	return NULL;
+}
+
+/*
+ * Publish a copy of the environment with the variable "name" (of length
+ * l) replaced by entry, appended if it was absent, or removed everywhere
+ * if entry is NULL. Must be called with env_mutex held.
+ */
+static int env_replace(const char *name, size_t l, char *entry)
+{
+	char **old = __environ;
+	char **e;
+	size_t n = 0, i, j;
+	int replaced = 0;
+
+	if (old) {
+		while (old[n]) {
+			n++;
+		}
+	}
+	e = malloc((n + 2) * sizeof(char *));
+	if (!e) {
+		errno = ENOMEM;
+		return -1;
+	}
+	for (i = 0, j = 0; i < n; i++) {
+		if (!strncmp(name, old[i], l) && old[i][l] == '=') {
+			if (entry && !replaced) {
+				e[j++] = entry;
+				replaced = 1;
+			}
+			/* removed, or a duplicate of the replaced entry */
+		} else {
+			e[j++] = old[i];
+		}
+	}
+	if (entry && !replaced) {
+		e[j++] = entry;
+	}
+	e[j] = NULL;
+	__atomic_store_n(&__environ, e, __ATOMIC_RELEASE);
+	return 0;
+}
+
+int setenv(const char *name, const char *value, int overwrite)
+{
+	size_t l1, l2;
+	char *s;
+	int ret;
+
+	if (!name || !(l1 = strcspn(name, "=")) || name[l1]) {
+		errno = EINVAL;
+		return -1;
+	}
+	l2 = strlen(value);
+	pthread_mutex_lock(&env_mutex);
+	if (!overwrite && getenv(name)) {
+		pthread_mutex_unlock(&env_mutex);
+		return 0;
+	}
+	s = malloc(l1 + l2 + 2);
+	if (!s) {
+		pthread_mutex_unlock(&env_mutex);
+		errno = ENOMEM;
+		return -1;
+	}
+	memcpy(s, name, l1);
+	s[l1] = '=';
+	memcpy(s + l1 + 1, value, l2 + 1);
+	ret = env_replace(name, l1, s);
+	pthread_mutex_unlock(&env_mutex);
+	return ret;
+}
+
+int unsetenv(const char *name)
+{
+	size_t l = strcspn(name, "=");
+	int ret;
+
+	if (!l || name[l]) {
+		errno = EINVAL;
+		return -1;
+	}
+	pthread_mutex_lock(&env_mutex);
+	ret = env_replace(name, l, NULL);
+	pthread_mutex_unlock(&env_mutex);
+	return ret;
+}
+
+int putenv(char *s)
+{
+	size_t l = strcspn(s, "=");
+	int ret;
+
+	if (!l || !s[l]) {
+		return unsetenv(s);
+	}
+	pthread_mutex_lock(&env_mutex);
+	ret = env_replace(s, l, s);
+	pthread_mutex_unlock(&env_mutex);
+	return ret;
+}
+
+int clearenv(void)
+{
+	static char *empty[1];
+
+	pthread_mutex_lock(&env_mutex);
+	__atomic_store_n(&__environ, empty, __ATOMIC_RELEASE);
+	pthread_mutex_unlock(&env_mutex);
+	return 0;
+}
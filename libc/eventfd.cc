@@ -13,6 +13,26 @@
 #include <osv/condvar.h>
 #include <osv/poll.h>
 
+#include <atomic>
+#include <set>
+
+/*
+ * eventfd is the standard inter-thread doorbell, and some applications
+ * ring it around a million times a second. The counter is therefore a
+ * lone atomic - the common signal is one compare-and-swap - and waking
+ * the other side is conditional: the mutex and condvars below are only
+ * ever touched by a read() or write() that has to sleep, and poll_wake()
+ * with its FD_LOCK is only called when a poll() is actually installed on
+ * the file. epoll watchers are reached through the lock-free
+ * wake_epoll() path instead.
+ *
+ * The waiter-presence checks pair with the waiters as follows: a blocked
+ * reader bumps _sleeping_readers before rechecking the counter (both
+ * seq_cst), and a signaler bumps the counter before checking
+ * _sleeping_readers, so one of them always sees the other. The same
+ * argument covers _pollers against the re-poll at the end of
+ * poll_install(), and epoll via the recheck in epoll_file::add().
+ */
 class event_fd final : public special_file {
     public:
         event_fd(unsigned int initval, int is_semaphore,  int flags)
@@ -25,15 +45,30 @@ class event_fd final : public special_file {
         virtual int read(struct uio *uio, int flags) override;
         virtual int write(struct uio *uio, int flags) override;
         virtual int poll(int events) override;
+        virtual void poll_install(pollreq& pr) override;
+        virtual void poll_uninstall(pollreq& pr) override;
 
     private:
-        mutable mutex _mutex;
-        uint64_t      _count;
+        std::atomic<uint64_t> _count;
         bool          _is_semaphore;
+
+        // Only sleepers take the mutex; the waiter counts let the fast
+        // paths skip the wakeups when nobody can possibly be waiting.
+        mutable mutex _mutex;
         condvar       _blocked_reader;
         condvar       _blocked_writer;
+        std::atomic<int> _sleeping_readers = {0};
+        std::atomic<int> _sleeping_writers = {0};
+
+        // Classic poll()ers installed on this file. Kept as a set keyed
+        // by the request because poll_uninstall() may be called for
+        // entries whose installation never completed.
+        std::set<pollreq *> _pollreqs;
+        std::atomic<int> _pollers = {0};
 
     private:
+        bool try_read(uint64_t &v);
+        bool try_write(uint64_t v);
         size_t copy_to_uio(uint64_t value, uio *uio);
         size_t copy_from_uio(uio *uio, uint64_t *value);
 };
@@ -84,6 +119,33 @@ size_t event_fd::copy_from_uio(uio *uio, uint64_t *value)
     return bc;
 }
 
+// Consume the counter (all of it, or one tick in semaphore mode) with a
+// single compare-and-swap; fails when the counter is zero.
+bool event_fd::try_read(uint64_t &v)
+{
+    uint64_t c = _count.load(std::memory_order_relaxed);
+    do {
+        if (c == 0) {
+            return false;
+        }
+        v = _is_semaphore ? 1 : c;
+    } while (!_count.compare_exchange_weak(c, c - v));
+    return true;
+}
+
+// Add to the counter with a single compare-and-swap; fails when the
+// addition would take it to ULLONG_MAX or beyond.
+bool event_fd::try_write(uint64_t v)
+{
+    uint64_t c = _count.load(std::memory_order_relaxed);
+    do {
+        if (v >= ULLONG_MAX - c) {
+            return false;
+        }
+    } while (!_count.compare_exchange_weak(c, c + v));
+    return true;
+}
+
 int event_fd::read(uio *data, int flags)
 {
     uint64_t v;
@@ -92,28 +154,32 @@ int event_fd::read(uio *data, int flags)
         return EINVAL;
     }
 
-    WITH_LOCK(_mutex) {
-        for (;;) {
-            if (_count > 0) {
-                if (_is_semaphore) {
-                    v = 1;
-                } else {
-                    v = _count;
-                }
-                _count -= v;
-                break;
-            } else {
-                if (f_flags & O_NONBLOCK) {
-                    return EAGAIN;
-                }
+    if (!try_read(v)) {
+        if (f_flags & O_NONBLOCK) {
+            return EAGAIN;
+        }
+        WITH_LOCK(_mutex) {
+            _sleeping_readers.fetch_add(1);
+            while (!try_read(v)) {
                 _blocked_reader.wait(_mutex);
             }
+            _sleeping_readers.fetch_sub(1, std::memory_order_relaxed);
         }
+    }
+
+    data->uio_resid -= copy_to_uio(v, data);
 
-        data->uio_resid -= copy_to_uio(v, data);
-        _blocked_writer.wake_all();
+    // We made room; tell anyone waiting for it.
+    if (_sleeping_writers.load() != 0) {
+        WITH_LOCK(_mutex) {
+            _blocked_writer.wake_all();
+        }
+    }
+    if (_pollers.load() != 0) {
+        poll_wake(this, POLLOUT);
+    } else {
+        wake_epoll(POLLOUT);
     }
-    poll_wake(this, POLLOUT);
 
     return 0;
 }
@@ -131,22 +197,29 @@ int event_fd::write(uio *data, int flags)
         return EINVAL;
     }
 
-    WITH_LOCK(_mutex) {
-        for (;;) {
-            if (v < ULLONG_MAX - _count) {
-                _count += v;
-                break;
-            } else {
-                if (f_flags & O_NONBLOCK) {
-                    return EAGAIN;
-                }
+    if (!try_write(v)) {
+        if (f_flags & O_NONBLOCK) {
+            return EAGAIN;
+        }
+        WITH_LOCK(_mutex) {
+            _sleeping_writers.fetch_add(1);
+            while (!try_write(v)) {
                 _blocked_writer.wait(_mutex);
             }
+            _sleeping_writers.fetch_sub(1, std::memory_order_relaxed);
         }
+    }
 
-        _blocked_reader.wake_all();
+    if (_sleeping_readers.load() != 0) {
+        WITH_LOCK(_mutex) {
+            _blocked_reader.wake_all();
+        }
+    }
+    if (_pollers.load() != 0) {
+        poll_wake(this, POLLIN);
+    } else {
+        wake_epoll(POLLIN);
     }
-    poll_wake(this, POLLIN);
 
     /* update uio_resid only when count is updated. */
     data->uio_resid -= bc;
@@ -156,28 +229,45 @@ int event_fd::write(uio *data, int flags)
 
 int event_fd::poll(int events)
 {
+    uint64_t c = _count.load();
     int rc = 0;
 
-    WITH_LOCK(_mutex) {
-        if ((_count > 0) && ((events & POLLIN) != 0)) {
-            /* readable */
-            rc |= POLLIN;
-        }
+    if ((c > 0) && ((events & POLLIN) != 0)) {
+        /* readable */
+        rc |= POLLIN;
+    }
 
-        if ((_count < ULLONG_MAX - 1) && ((events & POLLOUT) != 0)) {
-            /* writable */
-            rc |= POLLOUT;
-        }
+    if ((c < ULLONG_MAX - 1) && ((events & POLLOUT) != 0)) {
+        /* writable */
+        rc |= POLLOUT;
+    }
 
-        if (_count == ULLONG_MAX) {
-            /* error on overflow */
-            rc |= POLLERR;
-        }
+    if (c == ULLONG_MAX) {
+        /* error on overflow */
+        rc |= POLLERR;
     }
 
     return rc;
 }
 
+void event_fd::poll_install(pollreq& pr)
+{
+    WITH_LOCK(_mutex) {
+        if (_pollreqs.insert(&pr).second) {
+            _pollers.fetch_add(1);
+        }
+    }
+}
+
+void event_fd::poll_uninstall(pollreq& pr)
+{
+    WITH_LOCK(_mutex) {
+        if (_pollreqs.erase(&pr)) {
+            _pollers.fetch_sub(1);
+        }
+    }
+}
+
 OSV_LIBC_API
 int eventfd(unsigned int initval, int flags)
 {
@@ -42,7 +42,12 @@ int libc_error(int err)
 
 #undef errno
 
-int __thread errno;
+// errno lives in the kernel's static TLS block, so it is reachable with a
+// direct thread-pointer-relative address. Pin the TLS model explicitly so
+// __errno_location() never compiles to a __tls_get_addr call, whatever
+// code model a particular build (or translation unit) uses - this is one
+// of the hottest paths in libc and must stay a handful of instructions.
+int __thread __attribute__((tls_model("initial-exec"))) errno;
 
 int* __errno_location()
 {
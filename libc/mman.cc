@@ -22,6 +22,10 @@
 #define MAP_UNINITIALIZED 0x4000000
 #endif
 
+#ifndef MAP_HUGETLB
+#define MAP_HUGETLB 0x40000
+#endif
+
 TRACEPOINT(trace_memory_mmap, "addr=%p, length=%d, prot=%d, flags=%d, fd=%d, offset=%d", void *, size_t, int, int, int, off_t);
 TRACEPOINT(trace_memory_mmap_err, "%d", int);
 TRACEPOINT(trace_memory_mmap_ret, "%p", void *);
@@ -52,6 +56,11 @@ unsigned libc_flags_to_mmap(int flags)
     if (flags & MAP_UNINITIALIZED) {
         mmap_flags |= mmu::mmap_uninitialized;
     }
+    if (flags & MAP_HUGETLB) {
+        // We have no separate hugetlb pool; the nearest equivalent is
+        // committing the mapping's interior with 2MB pages up front.
+        mmap_flags |= mmu::mmap_huge;
+    }
     return mmap_flags;
 }
 
@@ -74,6 +83,10 @@ unsigned libc_madvise_to_advise(int advice)
 {
     if (advice == MADV_DONTNEED) {
         return mmu::advise_dontneed;
+    } else if (advice == MADV_FREE) {
+        return mmu::advise_free;
+    } else if (advice == MADV_HUGEPAGE) {
+        return mmu::advise_hugepage;
     } else if (advice == MADV_NOHUGEPAGE) {
         return mmu::advise_nohugepage;
     }
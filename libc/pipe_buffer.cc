@@ -10,6 +10,7 @@
 
 #include "pipe_buffer.hh"
 
+#include <cstring>
 #include <osv/poll.h>
 
 void pipe_buffer::detach_sender()
@@ -49,7 +50,7 @@ void pipe_buffer::attach_receiver(struct file *f)
 int pipe_buffer::read_events_unlocked()
 {
     int ret = 0;
-    ret |= !q.empty() ? POLLIN : 0;
+    ret |= size() ? POLLIN : 0;
     ret |= !sender ? POLLHUP : 0;
     return ret;
 }
@@ -60,7 +61,7 @@ int pipe_buffer::write_events_unlocked()
         return no_receiver_event;
     }
     int ret = 0;
-    ret |= q.size() < max_buf ? POLLOUT : 0;
+    ret |= size() < max_buf ? POLLOUT : 0;
     return ret;
 }
 
@@ -78,16 +79,24 @@ int pipe_buffer::write_events()
     }
 }
 
-// Copy from the pipe into the given iovec array, until the array is full
-// or the queue is empty. Decrements uio->uio_resid.
-static void copy_to_uio(std::deque<char> &q, uio *uio)
+// Copy from the ring buffer into the given iovec array, until the array is
+// full or the buffer is empty. Decrements uio->uio_resid. Each iovec is
+// filled with at most two memcpys - the span up to the end of the ring and
+// the wrapped-around remainder.
+void pipe_buffer::copy_out(uio *uio)
 {
-    for (int i = 0; i < uio->uio_iovcnt && !q.empty(); i++) {
+    for (int i = 0; i < uio->uio_iovcnt && size(); i++) {
         auto &iov = uio->uio_iov[i];
-        auto n = std::min(q.size(), iov.iov_len);
+        auto n = std::min(size(), iov.iov_len);
         char* p = static_cast<char*>(iov.iov_base);
-        std::copy(q.begin(), q.begin() + n, p);
-        q.erase(q.begin(), q.begin() + n);
+        size_t copied = 0;
+        while (copied < n) {
+            auto idx = rpos & (max_buf - 1);
+            auto chunk = std::min(n - copied, max_buf - idx);
+            memcpy(p + copied, buf.get() + idx, chunk);
+            copied += chunk;
+            rpos += chunk;
+        }
         uio->uio_resid -= n;
     }
 }
@@ -98,37 +107,48 @@ int pipe_buffer::read(uio* data, bool nonblock)
         return 0;
     }
     std::unique_lock<mutex> lock(mtx);
-    if (nonblock && q.empty()) {
+    if (nonblock && !size()) {
         return sender ? EAGAIN : 0;
     }
-    while (sender && q.empty()) {
+    while (sender && !size()) {
+        ++read_waiters;
         may_read.wait(&mtx);
+        --read_waiters;
     }
-    if (q.empty()) {
+    if (!size()) {
         return 0;
     }
-    copy_to_uio(q, data);
+    copy_out(data);
     if (write_events_unlocked() & POLLOUT)
         poll_wake(sender, (POLLOUT | POLLWRNORM));
+    bool wake_writers = write_waiters > 0;
     lock.unlock();
-    may_write.wake_all();
+    if (wake_writers) {
+        may_write.wake_all();
+    }
     return 0;
 }
 
-// Copy from a certain iovec array into a pipe, starting at a given index
-// and offset, until the buffer or the array ends. Decrements uio->uio_resid,
-// and modifies ind and offset to where the copy stopped.
-static void copy_from_uio(uio *uio, size_t *ind, size_t *offset,
-        std::deque<char> &buf, size_t bufsize)
+// Copy from a certain iovec array into the ring buffer, starting at a given
+// index and offset, until the buffer or the array ends. Decrements
+// uio->uio_resid, and modifies ind and offset to where the copy stopped.
+void pipe_buffer::copy_in(uio *uio, size_t *ind, size_t *offset)
 {
     int i = *ind;
     size_t off = *offset;
 
-    while (i < uio->uio_iovcnt && buf.size() < bufsize) {
+    while (i < uio->uio_iovcnt && size() < max_buf) {
         auto &iov = uio->uio_iov[i];
-        auto n = std::min(bufsize - buf.size(), iov.iov_len - off);
-        char* p = static_cast<char*>(iov.iov_base) + off;
-        std::copy(p, p + n, std::back_inserter(buf));
+        auto n = std::min(max_buf - size(), iov.iov_len - off);
+        const char* p = static_cast<const char*>(iov.iov_base) + off;
+        size_t copied = 0;
+        while (copied < n) {
+            auto idx = wpos & (max_buf - 1);
+            auto chunk = std::min(n - copied, max_buf - idx);
+            memcpy(buf.get() + idx, p + copied, chunk);
+            copied += chunk;
+            wpos += chunk;
+        }
         uio->uio_resid -= n;
         off += n;
         if (off == iov.iov_len) {
@@ -146,22 +166,25 @@ int pipe_buffer::write(uio* data, bool nonblock)
     if (!data->uio_resid) {
         return 0;
     }
+    bool wake_readers = false;
     WITH_LOCK(mtx) {
         // A write() smaller than PIPE_BUF (=4096 in Linux) will not be split
         // (i.e., will be "atomic"): For such a small write, we need to wait
         // until there's enough room for all it in the buffer.
-        int needroom = data->uio_resid <= 4096 ? data->uio_resid : 1;
+        size_t needroom = data->uio_resid <= 4096 ? data->uio_resid : 1;
         if (nonblock) {
             if (!receiver) {
                 // FIXME: If we don't generate a SIGPIPE here, at least assert
                 // that the user did not install a SIGPIPE handler.
                 return EPIPE;
-            } else if (q.size() + needroom > max_buf) {
+            } else if (size() + needroom > max_buf) {
                 return EAGAIN;
             }
         } else {
-            while (receiver && q.size() + needroom > max_buf) {
+            while (receiver && size() + needroom > max_buf) {
+                ++write_waiters;
                 may_write.wait(&mtx);
+                --write_waiters;
             }
             if (!receiver) {
                 return EPIPE;
@@ -173,24 +196,29 @@ int pipe_buffer::write(uio* data, bool nonblock)
         // times, until the whole given buffer is written.
         size_t ind = 0, offset = 0;
         while (data->uio_resid && receiver) {
-            copy_from_uio(data, &ind, &offset, q, max_buf);
+            copy_in(data, &ind, &offset);
             if (data->uio_resid) {
                 // The buffer is full but we still have more to send. Wake up
                 // readers, and go to sleep ourselves.
-                assert(q.size() == max_buf);
+                assert(size() == max_buf);
                 poll_wake(receiver, (POLLIN | POLLRDNORM));
                 may_read.wake_all();
                 if (nonblock) {
                     return 0;
                 }
-                while (receiver && q.size() == max_buf) {
+                while (receiver && size() == max_buf) {
+                    ++write_waiters;
                     may_write.wait(&mtx);
+                    --write_waiters;
                 }
             }
         }
         if (read_events_unlocked() & POLLIN)
             poll_wake(receiver, (POLLIN | POLLRDNORM));
+        wake_readers = read_waiters > 0;
+    }
+    if (wake_readers) {
+        may_read.wake_all();
     }
-    may_read.wake_all();
     return 0;
 }
@@ -8,8 +8,8 @@
 #ifndef PIPE_BUFFER_HH_
 #define PIPE_BUFFER_HH_
 
-#include <deque>
 #include <atomic>
+#include <memory>
 #include <boost/intrusive_ptr.hpp>
 
 #include <osv/mutex.h>
@@ -36,9 +36,23 @@ public:
 private:
     int read_events_unlocked();
     int write_events_unlocked();
+    void copy_out(uio *uio);
+    void copy_in(uio *uio, size_t *ind, size_t *offset);
 private:
     mutex mtx;
-    std::deque<char> q;
+    // A fixed ring buffer. rpos and wpos are free-running byte positions
+    // (max_buf is a power of two, so "pos & (max_buf - 1)" indexes into
+    // buf), and wpos - rpos is the number of buffered bytes. Data moves
+    // in and out with whole-span memcpys.
+    std::unique_ptr<char[]> buf{new char[max_buf]};
+    size_t rpos = 0;
+    size_t wpos = 0;
+    size_t size() const { return wpos - rpos; }
+    // How many threads are blocked in read() or write(), so the other
+    // side only pays for a condvar wake_all() when someone is listening.
+    // Protected by mtx, like the positions above.
+    unsigned read_waiters = 0;
+    unsigned write_waiters = 0;
     struct file *receiver = nullptr;
     struct file *sender = nullptr;
     std::atomic<unsigned> refs = {};
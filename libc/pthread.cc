@@ -24,6 +24,8 @@
 
 #include <osv/mutex.h>
 #include <osv/condvar.h>
+#include <osv/percpu.hh>
+#include <osv/preempt-lock.hh>
 #include <osv/stubbing.hh>
 #include <osv/lazy_indirect.hh>
 
@@ -37,10 +39,14 @@ namespace pthread_private {
 
     const unsigned tsd_nkeys = PTHREAD_KEYS_MAX;
 
-    __thread void* tsd[tsd_nkeys];
-    __thread pthread_t current_pthread;
-    __thread int cancel_state = PTHREAD_CANCEL_ENABLE;
-    __thread int cancel_type = PTHREAD_CANCEL_DEFERRED;
+    // These per-thread slots sit in the kernel's static TLS block. Pin the
+    // TLS model so pthread_self() and pthread_getspecific() compile to
+    // direct thread-pointer-relative accesses and never go through
+    // __tls_get_addr, regardless of the code model a build uses.
+    __thread __attribute__((tls_model("initial-exec"))) void* tsd[tsd_nkeys];
+    __thread __attribute__((tls_model("initial-exec"))) pthread_t current_pthread;
+    __thread __attribute__((tls_model("initial-exec"))) int cancel_state = PTHREAD_CANCEL_ENABLE;
+    __thread __attribute__((tls_model("initial-exec"))) int cancel_type = PTHREAD_CANCEL_DEFERRED;
 
     // NOTE: currently, the list of keys and destructor for each is global,
     // not per shared object or ELF namespace. So if a shared object uses
@@ -95,6 +101,7 @@ namespace pthread_private {
     private:
         sched::thread::stack_info allocate_stack(thread_attr attr);
         static void free_stack(sched::thread::stack_info si);
+        static void free_pooled_stack(sched::thread::stack_info si);
         sched::thread::attr attributes(thread_attr attr);
     };
 
@@ -135,12 +142,45 @@ namespace pthread_private {
         return a;
     }
 
+    // Threads created with the default attributes all use the same stack
+    // and guard size, and on thread-churn-heavy workloads the per-thread
+    // map_anon+fault+munmap cycle dominates thread creation cost. So we
+    // recycle such stacks through a small percpu magazine: a recycled
+    // stack is already mapped, its pages already faulted in and its guard
+    // page already protected, so reusing it touches neither vma_list nor
+    // the page tables. Stacks with non-default size or guard are tagged
+    // with the plain free_stack deleter and bypass the pool.
+    static constexpr size_t pooled_stack_size = 1 << 20;
+    static constexpr size_t pooled_guard_size = 4096;
+    static constexpr unsigned stack_magazine_max = 4;
+    struct stack_magazine {
+        void* stacks[stack_magazine_max];
+        unsigned count = 0;
+    };
+    static dynamic_percpu<stack_magazine> s_stack_magazines;
+
     sched::thread::stack_info pthread::allocate_stack(thread_attr attr)
     {
         if (attr.stack_begin) {
             return {attr.stack_begin, attr.stack_size};
         }
         size_t size = attr.stack_size;
+        bool poolable = size == pooled_stack_size &&
+                        attr.guard_size == pooled_guard_size;
+        if (poolable) {
+            void *recycled = nullptr;
+            WITH_LOCK(preempt_lock) {
+                auto& mag = *s_stack_magazines;
+                if (mag.count) {
+                    recycled = mag.stacks[--mag.count];
+                }
+            }
+            if (recycled) {
+                sched::thread::stack_info si{recycled, size};
+                si.deleter = free_pooled_stack;
+                return si;
+            }
+        }
 #if CONF_lazy_stack
         unsigned stack_flags = mmu::mmap_stack;
 #else
@@ -149,7 +189,7 @@ namespace pthread_private {
         void *addr = mmu::map_anon(nullptr, size, stack_flags, mmu::perm_rw);
         mmu::mprotect(addr, attr.guard_size, 0);
         sched::thread::stack_info si{addr, size};
-        si.deleter = free_stack;
+        si.deleter = poolable ? free_pooled_stack : free_stack;
         return si;
     }
 
@@ -158,6 +198,18 @@ namespace pthread_private {
         mmu::munmap(si.begin, si.size);
     }
 
+    void pthread::free_pooled_stack(sched::thread::stack_info si)
+    {
+        WITH_LOCK(preempt_lock) {
+            auto& mag = *s_stack_magazines;
+            if (mag.count < stack_magazine_max) {
+                mag.stacks[mag.count++] = si.begin;
+                return;
+            }
+        }
+        mmu::munmap(si.begin, si.size);
+    }
+
     int pthread::join(void** retval)
     {
         _thread->join();
@@ -13,6 +13,11 @@
 #include <sys/random.h>
 
 #define RANDOM_PATH "/dev/random"
+
+// Per-CPU ChaCha pools in drivers/fast-random.cc; -1 means they were
+// never initialized and we must fall back to reading /dev/random
+extern int osv_fast_random_fill(void *buf, size_t len);
+
 //
 // This implementation is based on the specification described at http://man7.org/linux/man-pages/man2/getrandom.2.html
 // with following limitations:
@@ -20,13 +25,19 @@
 // - given /dev/random and /dev/urandom provide same behavior in OSv (backed by the same code per drivers/random.cc),
 //   getrandom does not read flags argument to differentiate quality of random data returned
 // - does not check if random source data is available
-// - does not differentiate between blocking vs non-blocking behavior
-// - return ENOSYS when GRND_NONBLOCK passed in flags
+// - return ENOSYS when GRND_NONBLOCK passed in flags and the fast pools
+//   are unavailable (the pools themselves never block)
 ssize_t getrandom(void *buf, size_t count, unsigned int flags)
 {
     int fd;
     ssize_t read;
 
+    // The common case: serve from this CPU's pool without opening any
+    // device, taking any lock, or ever blocking
+    if (osv_fast_random_fill(buf, count) == 0) {
+        return count;
+    }
+
     if(flags & GRND_NONBLOCK) {
         errno = ENOSYS;
         return -1;
@@ -20,6 +20,12 @@
 #include <osv/stubbing.hh>
 #include <osv/pid.h>
 #include <osv/export.h>
+#include <osv/rcu.hh>
+
+#include <algorithm>
+#include <atomic>
+#include <memory>
+#include <vector>
 
 using namespace osv::clock::literals;
 
@@ -29,11 +35,13 @@ namespace osv {
 __thread __attribute__((aligned(sizeof(sigset))))
     char thread_signal_mask[sizeof(sigset)];
 
-// Let's ignore rt signals. For standard signals, signal(7) says order is
-// unspecified over multiple deliveries, so we always record the last one.  It
-// also relieves us of any need for locking, since it doesn't matter if the
-// pending signal changes: returning any one is fine
-__thread int thread_pending_signal;
+// Let's ignore rt signals. For standard signals we keep one pending bit
+// per signal (at index signo - 1): a sender on any cpu sets the bit with
+// an atomic fetch_or and the owning thread consumes bits with fetch_and,
+// so delivering to distinct threads touches no shared state and takes no
+// lock. As on Linux, further deliveries of a standard signal that is
+// already pending coalesce into the one bit.
+__thread std::atomic<uint64_t> thread_pending_signals;
 
 struct sigaction signal_actions[nsignals];
 
@@ -70,35 +78,84 @@ inline bool is_sig_ign(const struct sigaction &sa) {
 }
 
 //Similar to signal actions and mask, list of "waiters" for a given signal
-//with number "signo" is stored at the index "signo - 1"
-typedef std::list<sched::thread *> thread_list;
-static std::array<thread_list, nsignals> waiters;
-mutex waiters_mutex;
+//with number "signo" is stored at the index "signo - 1".
+//Delivery must not serialize - a profiler firing SIGPROF at kHz rates
+//into hundreds of threads would spend its time on a global lock - so
+//the delivery side walks an RCU-published snapshot of the list without
+//taking any lock, and only the rare mask changes in sigprocmask() copy
+//and republish the vector under a per-signal mutex.
+struct signal_waiters {
+    mutex mtx;
+    osv::rcu_ptr<std::vector<sched::thread *>> threads;
+};
+static std::array<signal_waiters, nsignals> waiters;
 
 int wake_up_signal_waiters(int signo)
 {
-    SCOPE_LOCK(waiters_mutex);
+    unsigned sigidx = signo - 1;
+    uint64_t sigbit = 1ULL << sigidx;
     int woken = 0;
 
-    unsigned sigidx = signo - 1;
-    for (auto& t: waiters[sigidx]) {
-        woken++;
-        t->remote_thread_local_var<int>(thread_pending_signal) = signo;
-        t->wake();
+    WITH_LOCK(osv::rcu_read_lock) {
+        auto tl = waiters[sigidx].threads.read();
+        if (tl) {
+            for (auto& t: *tl) {
+                woken++;
+                t->remote_thread_local_ptr<std::atomic<uint64_t>>(
+                    &thread_pending_signals)->fetch_or(sigbit,
+                        std::memory_order_relaxed);
+                // interrupted(true) both wakes a sigwait()er and makes an
+                // interruptible wait the recipient may be blocked in
+                // return EINTR, like a signal interrupting a system call
+                t->interrupted(true);
+            }
+        }
     }
     return woken;
 }
 
 void wait_for_signal(unsigned int sigidx)
 {
-    SCOPE_LOCK(waiters_mutex);
-    waiters[sigidx].push_front(sched::thread::current());
+    auto& w = waiters[sigidx];
+    SCOPE_LOCK(w.mtx);
+    auto old = w.threads.read_by_owner();
+    std::unique_ptr<std::vector<sched::thread *>> neww{
+        new std::vector<sched::thread *>};
+    if (old) {
+        *neww = *old;
+    }
+    neww->push_back(sched::thread::current());
+    w.threads.assign(neww.release());
+    osv::rcu_dispose(old);
 }
 
 void unwait_for_signal(sched::thread *t, unsigned int sigidx)
 {
-    SCOPE_LOCK(waiters_mutex);
-    waiters[sigidx].remove(t);
+    auto& w = waiters[sigidx];
+    bool removed = false;
+    WITH_LOCK(w.mtx) {
+        auto old = w.threads.read_by_owner();
+        if (!old) {
+            return;
+        }
+        std::unique_ptr<std::vector<sched::thread *>> neww{
+            new std::vector<sched::thread *>(*old)};
+        auto it = std::remove(neww->begin(), neww->end(), t);
+        removed = it != neww->end();
+        neww->erase(it, neww->end());
+        w.threads.assign(neww.release());
+        osv::rcu_dispose(old);
+    }
+    // The snapshots wake_up_signal_waiters() walks hold raw thread
+    // pointers, and thread objects are not RCU-deferred - only their
+    // _detached_state is. Wait out the grace period here, before our
+    // caller can let t exit and be deleted, so no lock-free deliverer
+    // is still poking a freed thread's TLS. Removals are rare (mask
+    // changes and thread exit), so blocking here costs nothing on the
+    // delivery path.
+    if (removed) {
+        osv::rcu_synchronize();
+    }
 }
 
 void unwait_for_signal(unsigned int sigidx)
@@ -316,8 +373,17 @@ int sigignore(int signum)
 OSV_LIBC_API
 int sigwait(const sigset_t *set, int *sig)
 {
-    sched::thread::wait_until([sig] { return *sig = thread_pending_signal; });
-    thread_pending_signal = 0;
+    auto pending = &thread_pending_signals;
+    sched::thread::wait_until([pending] {
+        return pending->load(std::memory_order_relaxed) != 0;
+    });
+    // Consume the lowest pending signal; only this thread ever clears
+    // bits, senders just set them, so a plain fetch_and cannot lose a
+    // concurrent delivery of a different signal
+    uint64_t bits = pending->load(std::memory_order_relaxed);
+    uint64_t sigbit = bits & ~(bits - 1);
+    pending->fetch_and(~sigbit, std::memory_order_relaxed);
+    *sig = __builtin_ctzll(sigbit) + 1;
     return 0;
 }
 
@@ -36,6 +36,11 @@ private:
     s64 _expiration = 0;
     s64 _interval = 0;
 
+    // Mirrors "_expiration && !_wakeup_due" so that poll(), which epoll
+    // calls on every wakeup, can check readability without the mutex.
+    // Written only under _mutex, together with the fields it mirrors.
+    std::atomic<bool> _readable = {false};
+
     // Each timerfd keeps a timer for wakeup of sleeping read() or poll()
     // in a dedicated thread. We could have used a timer_base::client instead
     // of a real thread, but things get really complicated when trying to
@@ -112,6 +117,7 @@ void timerfd::wakeup_thread_func()
                 _wakeup_change_cond.wait(_mutex, &tmr);
                 if (tmr.expired()) {
                     _wakeup_due = 0;
+                    _readable.store(true);
                     // Wake blocked read() or poll() on this fd
                     _blocked_reader.wake_one();
                     poll_wake(this, POLLIN);
@@ -134,6 +140,7 @@ void timerfd::set(s64 expiration, s64 interval)
         _expiration = expiration;
         _interval = interval;
         _wakeup_due = expiration;
+        _readable.store(false);
         _wakeup_change_cond.wake_one();
         _blocked_reader.wake_one();
     }
@@ -195,6 +202,7 @@ again:
         if (!_interval) {
             ret = 1;
             _expiration = 0;
+            _readable.store(false);
         } else {
             auto now = time_now();
             if (_clockid == CLOCK_MONOTONIC || now >= _expiration) {
@@ -204,11 +212,13 @@ again:
                 u64 count = (now - _expiration) / _interval;
                 _expiration = _expiration + (count+1) * _interval;
                 _wakeup_due = _expiration;
+                _readable.store(false);
                 _wakeup_change_cond.wake_one();
                 ret = 1 + count;
             } else {
                 // Clock is REALTIME and now < _expiration (clock may have jumped backwards)
                 _wakeup_due = _expiration;
+                _readable.store(false);
                 _wakeup_change_cond.wake_one();
                 goto again;
             }
@@ -220,13 +230,7 @@ again:
 
 int timerfd::poll(int events)
 {
-    WITH_LOCK(_mutex) {
-        if (!_expiration || _wakeup_due) {
-            return 0;
-        } else {
-            return POLLIN;
-        }
-    }
+    return _readable.load() ? POLLIN : 0;
 }
 
 // After this long introduction, without further ado, let's implement Linux's
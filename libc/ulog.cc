@@ -0,0 +1,94 @@
+/*
+ * Copyright (C) 2026 Waldemar Kozaczuk
+ *
+ * This work is open source software, licensed under the terms of the
+ * BSD license as described in the LICENSE file in the top-level directory.
+ */
+
+// The application half of the /dev/ulog transport: ulog_open() maps the
+// ring once, and from then on each ulog_write() is a lock-free ring
+// append - no syscall per record. See <osv/ulog.h> for the protocol.
+
+#include <osv/ulog.h>
+#include <libc/libc.hh>
+
+#include <fcntl.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/ioctl.h>
+
+struct ulog_writer {
+    struct ulog_ring_hdr *hdr;
+    char *data;
+    size_t map_size;
+    int fd;
+};
+
+OSV_LIBC_API
+int ulog_open(struct ulog_writer **out)
+{
+    int fd = open("/dev/ulog", O_RDWR);
+    if (fd < 0) {
+        return -1;
+    }
+
+    uint64_t size;
+    if (ioctl(fd, ULOG_GET_SIZE, &size) < 0) {
+        close(fd);
+        return -1;
+    }
+
+    size_t map_size = ULOG_DATA_OFF + size;
+    void *mem = mmap(NULL, map_size, PROT_READ | PROT_WRITE, MAP_SHARED,
+                     fd, 0);
+    if (mem == MAP_FAILED) {
+        close(fd);
+        return -1;
+    }
+
+    auto hdr = static_cast<struct ulog_ring_hdr *>(mem);
+    if (hdr->magic != ULOG_MAGIC) {
+        munmap(mem, map_size);
+        close(fd);
+        return libc_error(EINVAL);
+    }
+
+    auto w = static_cast<struct ulog_writer *>(
+        malloc(sizeof(struct ulog_writer)));
+    if (!w) {
+        munmap(mem, map_size);
+        close(fd);
+        return libc_error(ENOMEM);
+    }
+    w->hdr = hdr;
+    w->data = static_cast<char *>(mem) + ULOG_DATA_OFF;
+    w->map_size = map_size;
+    w->fd = fd;
+    *out = w;
+    return 0;
+}
+
+OSV_LIBC_API
+int ulog_write(struct ulog_writer *w, const void *buf, size_t len)
+{
+    int error = ulog_ring_append(w->hdr, w->data, buf, len);
+    if (error) {
+        return libc_error(error);
+    }
+    return 0;
+}
+
+OSV_LIBC_API
+uint64_t ulog_dropped(struct ulog_writer *w)
+{
+    return __atomic_load_n(&w->hdr->dropped, __ATOMIC_RELAXED);
+}
+
+OSV_LIBC_API
+void ulog_close(struct ulog_writer *w)
+{
+    munmap(w->hdr, w->map_size);
+    close(w->fd);
+    free(w);
+}
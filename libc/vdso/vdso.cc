@@ -1,12 +1,86 @@
 #include <time.h>
 #include <sys/time.h>
+#include <sched.h>
 #include <cerrno>
 
 #ifdef __x86_64__
 #include "tls-switch.hh"
+#include <osv/barrier.hh>
+#include <osv/pvclock-abi.hh>
+#include <osv/vdso-data.hh>
+
+static inline u64 vdso_rdtsc()
+{
+    u32 lo, hi;
+    asm volatile("rdtsc" : "=a"(lo), "=d"(hi));
+    return lo | (u64(hi) << 32);
+}
+
+// Read the paravirtual clock directly, without entering the kernel. This
+// mirrors pvclock::system_time() and pvclock::wall_clock_boot() in
+// arch/x64/pvclock-abi.cc, except that we always read vcpu0's time info
+// (we have no cheap way to learn our cpu here, let alone pin to it), so
+// we insist on TSC_STABLE_BIT and fall back to the kernel otherwise.
+// Returns false when the kernel has not published usable clock data.
+static bool pvclock_read(u64 *wall, u64 *up)
+{
+    auto& d = __osv_vdso_clock_data;
+    if (!d.enabled.load(std::memory_order_acquire)) {
+        return false;
+    }
+    auto sys = d.sys;
+    u32 v1, v2;
+    u64 time;
+    u8 flags;
+    do {
+        v1 = sys->version;
+        barrier();
+        asm volatile("lfence" ::: "memory");
+        time = sys->system_time +
+               pvclock::processor_to_nano(sys, vdso_rdtsc() - sys->tsc_timestamp);
+        flags = sys->flags;
+        barrier();
+        v2 = sys->version;
+    } while ((v1 & 1) || v1 != v2);
+    if (!(flags & pvclock::TSC_STABLE_BIT)) {
+        return false;
+    }
+    if (up) {
+        *up = time - d.boot_systemtime;
+    }
+    if (wall) {
+        auto wc = d.wall;
+        u32 w1, w2;
+        u64 w;
+        do {
+            w1 = wc->version;
+            barrier();
+            w = u64(wc->sec) * 1000000000 + wc->nsec;
+            barrier();
+            w2 = wc->version;
+        } while (w1 != w2);
+        *wall = w + time;
+    }
+    return true;
+}
+
+static inline void fill_ts(u64 ns, struct timespec *ts)
+{
+    ts->tv_sec = ns / 1000000000;
+    ts->tv_nsec = ns % 1000000000;
+}
+
 extern "C" __attribute__((__visibility__("default")))
 time_t __vdso_time(time_t *tloc)
 {
+    u64 w;
+    if (pvclock_read(&w, nullptr)) {
+        time_t t = w / 1000000000;
+        if (tloc) {
+            *tloc = t;
+        }
+        return t;
+    }
     arch::tls_switch _tls_switch;
     return time(tloc);
 }
@@ -14,13 +88,66 @@ time_t __vdso_time(time_t *tloc)
 extern "C" __attribute__((__visibility__("default")))
 int __vdso_gettimeofday(struct timeval *tv, struct timezone *tz)
 {
+    u64 w;
+    if (!tz && tv && pvclock_read(&w, nullptr)) {
+        tv->tv_sec = w / 1000000000;
+        tv->tv_usec = (w % 1000000000) / 1000;
+        return 0;
+    }
     arch::tls_switch _tls_switch;
     return gettimeofday(tv, tz);
 }
 
+extern "C" __attribute__((__visibility__("default")))
+long __vdso_getcpu(unsigned *cpu, unsigned *node, void *tcache)
+{
+    if (__osv_vdso_getcpu_rdtscp.load(std::memory_order_acquire)) {
+        // The kernel loaded each cpu's id into IA32_TSC_AUX at bring-up,
+        // so rdtscp hands it back without entering the kernel. A stale
+        // answer after a migration between the read and the use is the
+        // same race every getcpu interface has.
+        u32 aux;
+        asm volatile("rdtscp" : "=c"(aux) : : "rax", "rdx");
+        if (cpu) {
+            *cpu = aux;
+        }
+        if (node) {
+            *node = 0; // OSv presents a single NUMA node to apps
+        }
+        return 0;
+    }
+    arch::tls_switch _tls_switch;
+    if (cpu) {
+        *cpu = sched_getcpu();
+    }
+    if (node) {
+        *node = 0;
+    }
+    return 0;
+}
+
 extern "C" __attribute__((__visibility__("default")))
 int __vdso_clock_gettime(clockid_t clk_id, struct timespec *tp)
 {
+    u64 ns;
+    switch (clk_id) {
+    case CLOCK_REALTIME:
+    case CLOCK_REALTIME_COARSE:
+        if (pvclock_read(&ns, nullptr)) {
+            fill_ts(ns, tp);
+            return 0;
+        }
+        break;
+    case CLOCK_BOOTTIME:
+    case CLOCK_MONOTONIC:
+    case CLOCK_MONOTONIC_COARSE:
+    case CLOCK_MONOTONIC_RAW:
+        if (pvclock_read(nullptr, &ns)) {
+            fill_ts(ns, tp);
+            return 0;
+        }
+        break;
+    }
     arch::tls_switch _tls_switch;
     if (clock_gettime(clk_id, tp) < 0) {
         return -errno;
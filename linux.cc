@@ -10,10 +10,12 @@
 #include <osv/debug.hh>
 #include <osv/sched.hh>
 #include <osv/mutex.h>
-#include <osv/waitqueue.hh>
 #include <osv/stubbing.hh>
 #include <osv/export.h>
 #include <osv/trace.hh>
+#include <osv/clock.hh>
+#include <osv/printf.hh>
+#include <osv/syscall-stats.hh>
 #include <memory>
 
 #include <syscall.h>
@@ -54,7 +56,7 @@
 #include "tls-switch.hh"
 #endif
 
-#include <unordered_map>
+#include <boost/intrusive/list.hpp>
 
 #include <musl/src/internal/ksigaction.h>
 
@@ -65,88 +67,248 @@ extern "C" OSV_LIBC_API long gettid()
     return sched::thread::current()->id();
 }
 
-// We don't expect applications to use the Linux futex() system call (it is
-// normally only used to implement higher-level synchronization mechanisms),
-// but unfortunately gcc's C++ runtime uses a subset of futex in the
-// __cxa__guard_* functions, which safeguard the concurrent initialization
-// of function-scope static objects. We only implement here this subset.
-// The __cxa_guard_* functions only call futex in the rare case of contention,
-// in fact so rarely that OSv existed for a year before anyone noticed futex
-// was missing. So the performance of this implementation is not critical.
-static std::unordered_map<void*, waitqueue> queues;
-static mutex queues_mutex;
+// futex() was originally implemented here only for gcc's __cxa_guard_*
+// functions, which hit it so rarely that a single global hash of wait
+// queues was good enough. Statically-linked Linux runtimes changed that:
+// Go's runtime parks goroutines and the JVM parks threads directly on
+// futex(), so the table is now sharded - waiters hash by the futex word's
+// address into per-bucket lists with per-bucket locks, and independent
+// futexes contend only on a hash collision. Waiters matched by a wake are
+// woken as one batch, at most one IPI per destination cpu.
+namespace futex_impl {
+
+struct bucket;
+
+struct waiter : boost::intrusive::list_base_hook<> {
+    // cleared (under the mtx of the bucket the record lives in) by the
+    // waker once the record is off the list; the blocked thread reads it
+    // without any bucket lock, hence atomic
+    std::atomic<sched::thread*> owner;
+    int* uaddr;
+    uint32_t bitset;
+    // The bucket whose list currently holds this record. A requeue moves
+    // the record to another bucket's list, so the waiter's timeout path
+    // must not trust the bucket it originally enqueued on: it re-reads
+    // cur, locks it and re-validates, as a requeue (holding both bucket
+    // locks) may have moved the record again meanwhile.
+    std::atomic<bucket*> cur;
+};
+
+static constexpr unsigned bucket_count = 64; // power of two
+
+struct bucket {
+    mutex mtx;
+    boost::intrusive::list<waiter,
+        boost::intrusive::constant_time_size<false>> waiters;
+} CACHELINE_ALIGNED;
+
+static bucket buckets[bucket_count];
+
+static bucket& bucket_for(int* uaddr)
+{
+    auto h = reinterpret_cast<uintptr_t>(uaddr);
+    // The low bits of a naturally aligned futex word are zero; multiply
+    // by the golden ratio and take high bits so neighbouring words don't
+    // all land in the same bucket
+    h = (h >> 2) * 0x9E3779B97F4A7C15ull;
+    return buckets[(h >> 32) & (bucket_count - 1)];
+}
+
+// Wake up to "count" waiters of uaddr whose bitset intersects "bitset".
+// Must be called with b.mtx held.
+static int wake(bucket& b, int* uaddr, int count, uint32_t bitset)
+{
+    int waken = 0;
+    sched::wakeup_batch batch;
+    auto i = b.waiters.begin();
+    while (waken < count && i != b.waiters.end()) {
+        auto w = i++;
+        if (w->uaddr == uaddr && (w->bitset & bitset)) {
+            auto t = w->owner.load(std::memory_order_relaxed);
+            b.waiters.erase(w);
+            // The waiter may observe the cleared owner and return,
+            // destroying its record - stop touching it after this store
+            w->owner.store(nullptr, std::memory_order_release);
+            t->wake();
+            waken++;
+        }
+    }
+    return waken;
+}
+
+// Lock the bucket whose list holds w, revalidating after the lock: a
+// concurrent requeue (which holds both bucket locks) may move the record
+// between the read of w.cur and the lock acquisition.
+static bucket* lock_bucket_of(waiter& w)
+{
+    while (true) {
+        auto b = w.cur.load(std::memory_order_acquire);
+        b->mtx.lock();
+        if (w.cur.load(std::memory_order_relaxed) == b) {
+            return b;
+        }
+        b->mtx.unlock();
+    }
+}
+
+}
 
 #define FUTEX_BITSET_MATCH_ANY  0xffffffff
 
 int futex(int *uaddr, int op, int val, const struct timespec *timeout,
         int *uaddr2, uint32_t val3)
 {
+    using namespace futex_impl;
+
     switch (op & FUTEX_CMD_MASK) {
     case FUTEX_WAIT_BITSET:
-        if (val3 != FUTEX_BITSET_MATCH_ANY) {
-            abort("Unimplemented futex() operation %d\n", op);
+    case FUTEX_WAIT: {
+        uint32_t bitset = (op & FUTEX_CMD_MASK) == FUTEX_WAIT_BITSET ?
+            val3 : FUTEX_BITSET_MATCH_ANY;
+        if (!bitset) {
+            errno = EINVAL;
+            return -1;
         }
 
-    case FUTEX_WAIT:
-        WITH_LOCK(queues_mutex) {
-            if (*uaddr == val) {
-                waitqueue &q = queues[uaddr];
-                if (timeout) {
-                    sched::timer tmr(*sched::thread::current());
-                    if ((op & FUTEX_CMD_MASK) == FUTEX_WAIT_BITSET) {
-                        // If FUTEX_WAIT_BITSET we need to interpret timeout as an absolute
-                        // time point. If futex operation FUTEX_CLOCK_REALTIME is set we will use
-                        // real-time clock otherwise we will use monotonic clock
-                        if (op & FUTEX_CLOCK_REALTIME) {
-                            tmr.set(osv::clock::wall::time_point(std::chrono::seconds(timeout->tv_sec) +
-                                                                 std::chrono::nanoseconds(timeout->tv_nsec)));
-                        } else {
-                            tmr.set(osv::clock::uptime::time_point(std::chrono::seconds(timeout->tv_sec) +
-                                                                   std::chrono::nanoseconds(timeout->tv_nsec)));
-                        }
-                    } else {
-                        tmr.set(std::chrono::seconds(timeout->tv_sec) +
-                                std::chrono::nanoseconds(timeout->tv_nsec));
-                    }
-                    sched::thread::wait_for(queues_mutex, tmr, q);
-                    // FIXME: testing if tmr was expired isn't quite right -
-                    // we could have had both a wakeup and timer expiration
-                    // racing. It would be more correct to check if we were
-                    // waken by a FUTEX_WAKE. But how?
-                    if (tmr.expired()) {
-                        errno = ETIMEDOUT;
-                        return -1;
-                    }
+        auto& b = bucket_for(uaddr);
+        waiter w;
+        WITH_LOCK(b.mtx) {
+            if (*uaddr != val) {
+                errno = EWOULDBLOCK;
+                return -1;
+            }
+
+            w.owner.store(sched::thread::current(),
+                    std::memory_order_relaxed);
+            w.uaddr = uaddr;
+            w.bitset = bitset;
+            w.cur.store(&b, std::memory_order_relaxed);
+            b.waiters.push_back(w);
+        }
+
+        // Block without holding a bucket lock: a requeue may move our
+        // record to another bucket while we sleep, and a wake there
+        // clears w.owner under that bucket's lock, not this one's.
+        if (timeout) {
+            sched::timer tmr(*sched::thread::current());
+            if ((op & FUTEX_CMD_MASK) == FUTEX_WAIT_BITSET) {
+                // If FUTEX_WAIT_BITSET we need to interpret timeout as an absolute
+                // time point. If futex operation FUTEX_CLOCK_REALTIME is set we will use
+                // real-time clock otherwise we will use monotonic clock
+                if (op & FUTEX_CLOCK_REALTIME) {
+                    tmr.set(osv::clock::wall::time_point(std::chrono::seconds(timeout->tv_sec) +
+                                                         std::chrono::nanoseconds(timeout->tv_nsec)));
                 } else {
-                    q.wait(queues_mutex);
+                    tmr.set(osv::clock::uptime::time_point(std::chrono::seconds(timeout->tv_sec) +
+                                                           std::chrono::nanoseconds(timeout->tv_nsec)));
                 }
-                return 0;
             } else {
-                errno = EWOULDBLOCK;
-                return -1;
+                tmr.set(std::chrono::seconds(timeout->tv_sec) +
+                        std::chrono::nanoseconds(timeout->tv_nsec));
             }
+            sched::thread::wait_until([&] {
+                return tmr.expired() ||
+                       !w.owner.load(std::memory_order_acquire);
+            });
+            if (w.owner.load(std::memory_order_acquire)) {
+                // Timed out - take the record off whichever bucket's
+                // list it lives in by now. A wake can still race with
+                // us up to the lock acquisition, and an actual
+                // FUTEX_WAKE wins
+                auto cb = lock_bucket_of(w);
+                bool timed_out = w.owner.load(std::memory_order_relaxed);
+                if (timed_out) {
+                    cb->waiters.erase(cb->waiters.iterator_to(w));
+                }
+                cb->mtx.unlock();
+                if (timed_out) {
+                    errno = ETIMEDOUT;
+                    return -1;
+                }
+            }
+        } else {
+            sched::thread::wait_until([&] {
+                return !w.owner.load(std::memory_order_acquire);
+            });
         }
-    case FUTEX_WAKE:
-        if(val < 0) {
+        return 0;
+    }
+    case FUTEX_WAKE_BITSET:
+    case FUTEX_WAKE: {
+        uint32_t bitset = (op & FUTEX_CMD_MASK) == FUTEX_WAKE_BITSET ?
+            val3 : FUTEX_BITSET_MATCH_ANY;
+        if (val < 0 || !bitset) {
             errno = EINVAL;
             return -1;
         }
 
-        WITH_LOCK(queues_mutex) {
-            auto i = queues.find(uaddr);
-            if (i != queues.end()) {
-                int waken = 0;
-                while( (val > waken) && !(i->second.empty()) ) {
-                    i->second.wake_one(queues_mutex);
-                    waken++;
-                }
-                if(i->second.empty()) {
-                    queues.erase(i);
+        auto& b = bucket_for(uaddr);
+        WITH_LOCK(b.mtx) {
+            return wake(b, uaddr, val, bitset);
+        }
+    }
+    case FUTEX_REQUEUE:
+    case FUTEX_CMP_REQUEUE: {
+        // The timeout argument slot carries the requeue limit
+        int val2 = (int)(uintptr_t)timeout;
+        if (val < 0 || val2 < 0) {
+            errno = EINVAL;
+            return -1;
+        }
+
+        auto& src = bucket_for(uaddr);
+        auto& dst = bucket_for(uaddr2);
+        // Lock the two buckets in a fixed order to avoid a deadlock with
+        // a concurrent requeue going the other way
+        bucket* first = &src;
+        bucket* second = &dst;
+        if (first == second) {
+            second = nullptr;
+        } else if (first > second) {
+            std::swap(first, second);
+        }
+
+        first->mtx.lock();
+        if (second) {
+            second->mtx.lock();
+        }
+
+        int ret;
+        if ((op & FUTEX_CMD_MASK) == FUTEX_CMP_REQUEUE &&
+                *uaddr != (int)val3) {
+            errno = EAGAIN;
+            ret = -1;
+        } else {
+            int waken = wake(src, uaddr, val, FUTEX_BITSET_MATCH_ANY);
+            // Move up to val2 of the remaining waiters over to uaddr2,
+            // so glibc condvars can shift the herd to the mutex's futex
+            // instead of waking everyone at once
+            int requeued = 0;
+            auto i = src.waiters.begin();
+            while (requeued < val2 && i != src.waiters.end()) {
+                auto w = i++;
+                if (w->uaddr == uaddr) {
+                    auto& wr = *w;
+                    src.waiters.erase(w);
+                    wr.uaddr = uaddr2;
+                    // Both bucket locks are held, so the waiter's
+                    // lock-and-revalidate cleanup path cannot observe a
+                    // half-moved record
+                    wr.cur.store(&dst, std::memory_order_release);
+                    dst.waiters.push_back(wr);
+                    requeued++;
                 }
-                return waken;
             }
+            ret = (op & FUTEX_CMD_MASK) == FUTEX_CMP_REQUEUE ?
+                waken + requeued : waken;
         }
-        return 0;
+
+        if (second) {
+            second->mtx.unlock();
+        }
+        first->mtx.unlock();
+        return ret;
+    }
     default:
         abort("Unimplemented futex() operation %d\n", op);
     }
@@ -239,10 +401,114 @@ long long_shmat(int shmid, const void *shmaddr, int shmflg) {
     return (long) shmat(shmid, shmaddr, shmflg);
 }
 
-#define SYSCALL0(fn) case (__NR_##fn): do { long ret = fn(); trace_syscall_##fn(ret); return ret; } while (0)
+// Optional per-syscall invocation counters and log2 latency histograms,
+// exported as /proc/syscall_stats. Off by default: accounting costs two
+// clock reads per invocation when enabled, a single flag test when not.
+namespace syscall_stats {
+
+static constexpr unsigned max_nr = 512;
+static constexpr unsigned nr_buckets = 32;
+
+struct entry {
+    const char* name;
+    std::atomic<u64> count;
+    std::atomic<u64> latency[nr_buckets];
+};
+
+static entry* table;
+static std::atomic<bool> _enabled {false};
+
+void enable(bool on)
+{
+    if (on && !table) {
+        table = new entry[max_nr]();
+    }
+    _enabled.store(on);
+}
+
+bool enabled()
+{
+    return _enabled.load(std::memory_order_relaxed);
+}
+
+static inline void set_name(long nr, const char* name)
+{
+    if (_enabled.load(std::memory_order_relaxed) &&
+        nr >= 0 && nr < long(max_nr)) {
+        table[nr].name = name;
+    }
+}
+
+static void record(long nr, u64 ns)
+{
+    if (nr < 0 || nr >= long(max_nr)) {
+        return;
+    }
+    auto& e = table[nr];
+    e.count.fetch_add(1, std::memory_order_relaxed);
+    unsigned bucket = ns ?
+        std::min(63u - __builtin_clzll(ns), nr_buckets - 1) : 0;
+    e.latency[bucket].fetch_add(1, std::memory_order_relaxed);
+}
+
+// Measures one invocation: the destructor runs after the dispatcher's
+// return statement has computed its value, so the whole handler is timed
+struct guard {
+    explicit guard(long nr)
+        : _nr(nr)
+        , _active(_enabled.load(std::memory_order_relaxed))
+    {
+        if (_active) {
+            _start = osv::clock::uptime::now();
+        }
+    }
+    ~guard()
+    {
+        if (_active) {
+            record(_nr, std::chrono::duration_cast<std::chrono::nanoseconds>(
+                osv::clock::uptime::now() - _start).count());
+        }
+    }
+    long _nr;
+    bool _active;
+    osv::clock::uptime::time_point _start;
+};
+
+std::string format()
+{
+    std::string out;
+    if (!table) {
+        return out;
+    }
+    for (unsigned nr = 0; nr < max_nr; nr++) {
+        auto& e = table[nr];
+        auto count = e.count.load(std::memory_order_relaxed);
+        if (!count) {
+            continue;
+        }
+        if (e.name) {
+            out += osv::sprintf("%s count %lu log2ns", e.name, count);
+        } else {
+            // a syscall which never went through the dispatcher's named
+            // cases since accounting was enabled
+            out += osv::sprintf("syscall%u count %lu log2ns", nr, count);
+        }
+        for (unsigned i = 0; i < nr_buckets; i++) {
+            out += osv::sprintf(" %lu",
+                e.latency[i].load(std::memory_order_relaxed));
+        }
+        out += "\n";
+    }
+    return out;
+}
+
+}
+
+#define SYSCALL0(fn) case (__NR_##fn): do { syscall_stats::set_name(__NR_##fn, #fn); long ret = fn(); trace_syscall_##fn(ret); return ret; } while (0)
 
 #define SYSCALL1(fn, __t1)             \
         case (__NR_##fn): do {         \
+        syscall_stats::set_name(__NR_##fn, #fn); \
         va_list args;                  \
         __t1 arg1;                     \
         va_start(args, number);        \
@@ -255,6 +521,7 @@ long long_shmat(int shmid, const void *shmaddr, int shmflg) {
 
 #define SYSCALL2(fn, __t1, __t2)            \
         case (__NR_##fn): do {              \
+        syscall_stats::set_name(__NR_##fn, #fn); \
         va_list args;                       \
         __t1 arg1;                          \
         __t2 arg2;                          \
@@ -269,6 +536,7 @@ long long_shmat(int shmid, const void *shmaddr, int shmflg) {
 
 #define SYSCALL3(fn, __t1, __t2, __t3)             \
         case (__NR_##fn): do {                     \
+        syscall_stats::set_name(__NR_##fn, #fn);   \
         va_list args;                              \
         __t1 arg1;                                 \
         __t2 arg2;                                 \
@@ -285,6 +553,7 @@ long long_shmat(int shmid, const void *shmaddr, int shmflg) {
 
 #define SYSCALL4(fn, __t1, __t2, __t3, __t4)             \
         case (__NR_##fn): do {                           \
+        syscall_stats::set_name(__NR_##fn, #fn);         \
         va_list args;                                    \
         __t1 arg1;                                       \
         __t2 arg2;                                       \
@@ -303,6 +572,7 @@ long long_shmat(int shmid, const void *shmaddr, int shmflg) {
 
 #define SYSCALL5(fn, __t1, __t2, __t3, __t4, __t5)             \
         case (__NR_##fn): do {                                 \
+        syscall_stats::set_name(__NR_##fn, #fn);               \
         va_list args;                                          \
         __t1 arg1;                                             \
         __t2 arg2;                                             \
@@ -323,6 +593,7 @@ long long_shmat(int shmid, const void *shmaddr, int shmflg) {
 
 #define SYSCALL6(fn, __t1, __t2, __t3, __t4, __t5, __t6)             \
         case (__NR_##fn): do {                                       \
+        syscall_stats::set_name(__NR_##fn, #fn);                     \
         va_list args;                                                \
         __t1 arg1;                                                   \
         __t2 arg2;                                                   \
@@ -703,8 +974,10 @@ TRACEPOINT(trace_syscall_fstat, "%d <= %d %p", int, int, struct stat *);
 TRACEPOINT(trace_syscall_getsockname, "%d <= %d %p %p", int, int, struct sockaddr *, socklen_t *);
 TRACEPOINT(trace_syscall_sendto, "%lu <= %d 0x%x %lu %d %p %u", ssize_t, int, const void *, size_t, int, const struct sockaddr *, socklen_t);
 TRACEPOINT(trace_syscall_sendmsg, "%lu <= %d %p %d", ssize_t, int, const struct msghdr *, int);
+TRACEPOINT(trace_syscall_sendmmsg, "%d <= %d %p %u 0x%x", int, int, struct mmsghdr *, unsigned int, unsigned int);
 TRACEPOINT(trace_syscall_recvfrom, "%lu <= %d 0x%x %lu %d %p %p", ssize_t, int, void *, size_t, int, struct sockaddr *, socklen_t *);
 TRACEPOINT(trace_syscall_recvmsg, "%lu <= %d %p %d", ssize_t, int, struct msghdr *, int);
+TRACEPOINT(trace_syscall_recvmmsg, "%d <= %d %p %u 0x%x %p", int, int, struct mmsghdr *, unsigned int, unsigned int, struct timespec *);
 TRACEPOINT(trace_syscall_dup3, "%d <= %d %d %d", int, int, int, int);
 TRACEPOINT(trace_syscall_flock, "%d <= %d %d", int, int, int);
 TRACEPOINT(trace_syscall_pwrite64, "%lu <= %d 0x%x %lu %ld", ssize_t, int, const void *, size_t, off_t);
@@ -767,6 +1040,7 @@ TRACEPOINT(trace_syscall_gettimeofday, "%d <= %p %p", int, struct timeval *, str
 TRACEPOINT(trace_syscall_getppid, "%d <=", pid_t);
 TRACEPOINT(trace_syscall_sysinfo, "%d <= %p", int, struct sysinfo *);
 TRACEPOINT(trace_syscall_sendfile, "%lu <= %d %d %p %lu", ssize_t, int, int, off_t *, size_t);
+TRACEPOINT(trace_syscall_copy_file_range, "%lu <= %d %p %d %p %lu %u", ssize_t, int, off_t *, int, off_t *, size_t, unsigned int);
 TRACEPOINT(trace_syscall_socketpair, "%d <= %d %d %d %p", int, int, int, int, int *);
 TRACEPOINT(trace_syscall_shutdown, "%d <= %d %d", int, int, int);
 TRACEPOINT(trace_syscall_readv, "%lu <= %lu %p %lu", ssize_t, unsigned long, const struct iovec *, unsigned long);
@@ -810,31 +1084,53 @@ TRACEPOINT(trace_syscall_getpriority, "%d <= %d %d", int, int, int);
 TRACEPOINT(trace_syscall_setpriority, "%d <= %d %d %d", int, int, int, int);
 TRACEPOINT(trace_syscall_ppoll, "%d <= %p %ld %p %p", int, struct pollfd *, nfds_t, const struct timespec *, const sigset_t *);
 
+// Kept out of line so the cold unimplemented path does not dilute the
+// dispatcher's instruction cache footprint
+static long __attribute__((cold, noinline)) unimplemented_syscall(long number)
+{
+    debug_always("syscall(): unimplemented system call %d\n", number);
+    errno = ENOSYS;
+    return -1;
+}
+
 OSV_LIBC_API long syscall(long number, ...)
 {
     // Save FPU state and restore it at the end of this function
     sched::fpu_lock fpu;
     SCOPE_LOCK(fpu);
 
+    syscall_stats::guard latency_guard(number);
+
+    // The hottest syscalls - the I/O, polling, futex and clock calls which
+    // dominate event loops and the Go runtime - are dispatched from this
+    // short switch first, which the compiler lowers to a few compares
+    // instead of the bounds check and indirect jump the full table below
+    // becomes. Everything else falls through to the big switch.
+    switch (number) {
+    SYSCALL3(read, int, char *, size_t);
+    SYSCALL3(write, int, const void *, size_t);
+    SYSCALL6(futex, int *, int, int, const struct timespec *, int *, uint32_t);
+    SYSCALL2(clock_gettime, clockid_t, struct timespec *);
+#ifdef SYS_epoll_wait
+    SYSCALL4(epoll_wait, int, struct epoll_event *, int, int);
+#endif
+    SYSCALL5(epoll_pwait, int, struct epoll_event *, int, int, const sigset_t*);
+    SYSCALL6(sendto, int, const void *, size_t, int, const struct sockaddr *, socklen_t);
+    SYSCALL6(recvfrom, int, void *, size_t, int, struct sockaddr *, socklen_t *);
+    }
+
     switch (number) {
 #ifdef SYS_open
     SYSCALL2(open, const char *, int);
 #endif
-    SYSCALL3(read, int, char *, size_t);
     SYSCALL1(uname, struct utsname *);
-    SYSCALL3(write, int, const void *, size_t);
     SYSCALL0(gettid);
-    SYSCALL2(clock_gettime, clockid_t, struct timespec *);
     SYSCALL2(clock_getres, clockid_t, struct timespec *);
-    SYSCALL6(futex, int *, int, int, const struct timespec *, int *, uint32_t);
     SYSCALL1(close, int);
     SYSCALL2(pipe2, int *, int);
     SYSCALL1(epoll_create1, int);
     SYSCALL2(eventfd2, unsigned int, int);
     SYSCALL4(epoll_ctl, int, int, int, struct epoll_event *);
-#ifdef SYS_epoll_wait
-    SYSCALL4(epoll_wait, int, struct epoll_event *, int, int);
-#endif
     SYSCALL4(accept4, int, struct sockaddr *, socklen_t *, int);
     SYSCALL3(connect, int, struct sockaddr *, socklen_t);
     SYSCALL5(get_mempolicy, int *, unsigned long *, unsigned long, void *, int);
@@ -864,10 +1160,10 @@ OSV_LIBC_API long syscall(long number, ...)
 #endif
     SYSCALL2(fstat, int, struct stat *);
     SYSCALL3(getsockname, int, struct sockaddr *, socklen_t *);
-    SYSCALL6(sendto, int, const void *, size_t, int, const struct sockaddr *, socklen_t);
     SYSCALL3(sendmsg, int, const struct msghdr *, int);
-    SYSCALL6(recvfrom, int, void *, size_t, int, struct sockaddr *, socklen_t *);
+    SYSCALL4(sendmmsg, int, struct mmsghdr *, unsigned int, unsigned int);
     SYSCALL3(recvmsg, int, struct msghdr *, int);
+    SYSCALL5(recvmmsg, int, struct mmsghdr *, unsigned int, unsigned int, struct timespec *);
     SYSCALL3(dup3, int, int, int);
     SYSCALL2(flock, int, int);
     SYSCALL4(pwrite64, int, const void *, size_t, off_t);
@@ -877,7 +1173,6 @@ OSV_LIBC_API long syscall(long number, ...)
     SYSCALL4(pread64, int, void *, size_t, off_t);
     SYSCALL2(ftruncate, int, off_t);
     SYSCALL1(fsync, int);
-    SYSCALL5(epoll_pwait, int, struct epoll_event *, int, int, const sigset_t*);
     SYSCALL3(getrandom, char *, size_t, unsigned int);
     SYSCALL2(nanosleep, const struct timespec*, struct timespec *);
     SYSCALL4(fstatat, int, const char *, struct stat *, int);
@@ -930,6 +1225,7 @@ OSV_LIBC_API long syscall(long number, ...)
     SYSCALL0(getppid);
     SYSCALL1(sysinfo, struct sysinfo *);
     SYSCALL4(sendfile, int, int, off_t *, size_t);
+    SYSCALL6(copy_file_range, int, off_t *, int, off_t *, size_t, unsigned int);
     SYSCALL4(socketpair, int, int, int, int *);
     SYSCALL2(shutdown, int, int);
     SYSCALL3(readv, unsigned long, const struct iovec *, unsigned long);
@@ -974,9 +1270,7 @@ OSV_LIBC_API long syscall(long number, ...)
     SYSCALL4(ppoll, struct pollfd *, nfds_t, const struct timespec *, const sigset_t *);
     }
 
-    debug_always("syscall(): unimplemented system call %d\n", number);
-    errno = ENOSYS;
-    return -1;
+    return unimplemented_syscall(number);
 }
 long __syscall(long number, ...)  __attribute__((alias("syscall")));
 
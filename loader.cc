@@ -41,13 +41,20 @@
 #include <osv/run.hh>
 #include <osv/shutdown.hh>
 #include <osv/commands.hh>
+#include <osv/crashdump.hh>
 #include <osv/boot.hh>
 #include <osv/sampler.hh>
+#include <osv/stall-detector.hh>
+#include <osv/syscall-stats.hh>
+#include <osv/lockstat.hh>
 #include <osv/app.hh>
 #include <osv/firmware.hh>
 #if CONF_drivers_xen
 #include <osv/xen.hh>
 #endif
+#if CONF_drivers_virtio
+#include "drivers/virtio.hh"
+#endif
 #include <osv/options.hh>
 #include <dirent.h>
 #include <mntent.h>
@@ -56,6 +63,7 @@
 #include "drivers/random.hh"
 #include "drivers/console.hh"
 #include "drivers/null.hh"
+#include "drivers/ulog.hh"
 
 #include "libc/network/__dns.hh"
 #include <processor.hh>
@@ -151,6 +159,7 @@ bool opt_power_off_on_abort = false;
 static bool opt_log_backtrace = false;
 static bool opt_list_tracepoints = false;
 static bool opt_strace = false;
+static std::string opt_trace_stream;
 #endif
 static bool opt_mount = true;
 static bool opt_pivot = true;
@@ -166,13 +175,17 @@ static std::string opt_defaultgw;
 static std::string opt_nameserver;
 static std::string opt_redirect;
 static std::chrono::nanoseconds boot_delay;
+static int opt_dedup_pages_delay = -1;
 std::vector<mntent> opt_mount_fs;
+extern bool opt_lazy_mount; // defined in fs/vfs/main.cc
 bool opt_maxnic = false;
 int maxnic;
 bool opt_pci_disabled = false;
 
 static int sampler_frequency;
 static bool opt_enable_sampler = false;
+static int opt_stall_detector_ms = 0;
+static bool opt_lock_stats = false;
 
 static void usage()
 {
@@ -182,18 +195,36 @@ static void usage()
 #if CONF_tracepoints
         "  --sampler=arg         start stack sampling profiler\n"
         "  --trace=arg           tracepoints to enable\n"
+        "  --trace-count=arg     tracepoints to count (per-cpu hit counters, no logging)\n"
         "  --trace-backtrace     log backtraces in the tracepoint log\n"
         "  --trace-list          list available tracepoints\n"
         "  --strace              start a thread to print tracepoints to the console on the fly\n"
+        "  --trace-stream=arg    stream binary trace records to tcp:<ip>:<port> or a path\n"
+        "  --flight-recorder=arg always-on tracing of a curated event set into small\n"
+        "                        per-cpu rings of arg kB, dumped on panic\n"
+        "  --stall-detector=arg  trace timer ticks arriving more than arg ms late\n"
 #endif
+        "  --crashdump=arg       reserve arg kB for a binary crash dump serialized\n"
+        "                        on panic, harvested from a guest memory snapshot\n"
         "  --leak                start leak detector after boot\n"
+        "  --syscall-stats       count syscalls and their log2 latency histograms,\n"
+        "                        exported as /proc/syscall_stats\n"
+        "  --alloc-profiler=arg  sample one allocation per arg KB allocated,\n"
+        "                        aggregated by site as /proc/alloc_profile\n"
+        "  --lock-stats          account mutex/rwlock wait times per lock and\n"
+        "                        call site, exported as /proc/lock_stats\n"
         "  --nomount             don't mount the root file system\n"
         "  --nopivot             do not pivot the root from bootfs to the root fs\n"
         "  --rootfs=arg          root filesystem to use (zfs, rofs, ramfs or virtiofs)\n"
         "  --assign-net          assign virtio network to the application\n"
         "  --maxnic=arg          maximum NIC number\n"
+        "  --virtio-poll-rounds=arg  polling rounds a virtio service thread runs\n"
+        "                        after draining its queue before re-arming the\n"
+        "                        interrupt (default 16, 0 re-arms immediately)\n"
         "  --norandom            don't initialize any random device\n"
         "  --noshutdown          continue running after main() returns\n"
+        "  --idle-quiesce        coalesce periodic housekeeping of idle cpus into\n"
+        "                        one aligned wakeup slot per second\n"
         "  --power-off-on-abort  use poweroff instead of halt if it's aborted\n"
         "  --noinit              don't run commands from /init\n"
         "  --verbose             be verbose, print debug messages\n"
@@ -211,7 +242,13 @@ static void usage()
         "  --nopci               disable PCI enumeration\n"
         "  --extra-zfs-pools     import extra ZFS pools\n"
         "  --mount-fs=arg        mount extra filesystem, format:<fs_type,url,path>\n"
-        "  --preload-zfs-library preload ZFS library from /usr/lib/fs\n\n");
+        "  --preload-zfs-library preload ZFS library from /usr/lib/fs\n"
+        "  --save-reloc-cache    save relocation results to be replayed by later boots\n"
+        "  --preload-objects=arg populate segments of listed ELF objects at load time\n"
+        "  --lazy-mount          mount non-root filesystems in the background\n"
+        "  --dedup-pages=arg     deduplicate read-only file-backed pages arg seconds\n"
+        "                        after boot\n"
+        "  --app-templates       keep payload ELF objects resident between runs\n\n");
 }
 
 static void handle_parse_error(const std::string &message)
@@ -254,6 +291,10 @@ static void parse_options(int loader_argc, char** loader_argv)
         opt_noshutdown = true;
     }
 
+    if (extract_option_flag(options_values, "idle-quiesce")) {
+        sched::idle_quiesce = true;
+    }
+
     if (extract_option_flag(options_values, "power-off-on-abort")) {
         opt_power_off_on_abort = true;
     }
@@ -263,6 +304,14 @@ static void parse_options(int loader_argc, char** loader_argv)
         maxnic = options::extract_option_int_value(options_values, "maxnic", handle_parse_error);
     }
 
+#if CONF_drivers_virtio
+    if (options::option_value_exists(options_values, "virtio-poll-rounds")) {
+        virtio::virtio_driver::set_irq_poll_rounds(
+            options::extract_option_int_value(options_values,
+                "virtio-poll-rounds", handle_parse_error));
+    }
+#endif
+
 #if CONF_tracepoints
     if (extract_option_flag(options_values, "trace-backtrace")) {
         opt_log_backtrace = true;
@@ -284,6 +333,11 @@ static void parse_options(int loader_argc, char** loader_argv)
         opt_enable_sampler = true;
     }
 
+    if (options::option_value_exists(options_values, "stall-detector")) {
+        opt_stall_detector_ms = options::extract_option_int_value(options_values,
+            "stall-detector", handle_parse_error);
+    }
+
     if (extract_option_flag(options_values, "bootchart")) {
         opt_bootchart = true;
     }
@@ -301,8 +355,86 @@ static void parse_options(int loader_argc, char** loader_argv)
             opt_strace = true;
         }
     }
+
+    if (options::option_value_exists(options_values, "trace-stream")) {
+        auto dests = options::extract_option_values(options_values, "trace-stream");
+        if (!dests.empty()) {
+            opt_trace_stream = dests.front();
+        }
+    }
+
+    if (options::option_value_exists(options_values, "trace-count")) {
+        auto tv = options::extract_option_values(options_values, "trace-count");
+        for (auto t : tv) {
+            std::vector<std::string> tmp;
+            osv::split(tmp, t, " ,", true);
+            for (auto t : tmp) {
+                enable_tracepoint_counting(t);
+            }
+        }
+    }
+
+    // Parsed after --trace on purpose: when explicit tracing is requested
+    // the full-size buffers are already set up and the flight recorder
+    // just adds its curated set to them
+    if (options::option_value_exists(options_values, "flight-recorder")) {
+        enable_flight_recorder(options::extract_option_int_value(options_values,
+            "flight-recorder", handle_parse_error));
+    } else if (extract_option_flag(options_values, "flight-recorder")) {
+        enable_flight_recorder();
+    }
 #endif
 
+    if (options::option_value_exists(options_values, "crashdump")) {
+        crashdump::reserve(options::extract_option_int_value(options_values,
+            "crashdump", handle_parse_error) * 1024);
+    }
+
+    if (extract_option_flag(options_values, "save-reloc-cache")) {
+        elf::save_relocation_caches = true;
+    }
+
+    if (extract_option_flag(options_values, "lazy-mount")) {
+        opt_lazy_mount = true;
+    }
+
+    if (options::option_value_exists(options_values, "preload-objects")) {
+        for (auto t : options::extract_option_values(options_values,
+                "preload-objects")) {
+            std::vector<std::string> tmp;
+            osv::split(tmp, t, " ,", true);
+            for (auto o : tmp) {
+                elf::eager_load_objects.push_back(o);
+            }
+        }
+    }
+
+    if (extract_option_flag(options_values, "app-templates")) {
+        osv::application::cache_app_templates(true);
+    }
+
+    if (options::option_value_exists(options_values, "dedup-pages")) {
+        opt_dedup_pages_delay = options::extract_option_int_value(options_values,
+            "dedup-pages", handle_parse_error);
+    }
+
+    if (extract_option_flag(options_values, "syscall-stats")) {
+        syscall_stats::enable(true);
+    }
+
+    if (options::option_value_exists(options_values, "alloc-profiler")) {
+        auto kb = options::extract_option_int_value(options_values,
+            "alloc-profiler", handle_parse_error);
+        memory::alloc_profiler::enable(size_t(kb) * 1024);
+    } else if (extract_option_flag(options_values, "alloc-profiler")) {
+        memory::alloc_profiler::enable(0); // keep the default interval
+    }
+
+    if (extract_option_flag(options_values, "lock-stats")) {
+        // enabled in do_main_thread, once all cpus are up
+        opt_lock_stats = true;
+    }
+
     opt_mount = !extract_option_flag(options_values, "nomount");
     opt_pivot = !extract_option_flag(options_values, "nopivot");
     opt_random = !extract_option_flag(options_values, "norandom");
@@ -489,21 +621,44 @@ static void load_zfs_library_and_mount_zfs_root(const char* mount_error_msg, boo
     });
 }
 
-void* do_main_thread(void *_main_args)
-{
-    auto app_cmdline = static_cast<char*>(_main_args);
-
-    if (!arch_setup_console(opt_console)) {
-        abort("Unknown console:%s\n", opt_console.c_str());
+// A boot stage runs on its own thread, after the stages it declares as
+// dependencies have completed. Stages with no dependency between them - like
+// mounting the root filesystem and configuring the network - run concurrently
+// on the already-launched cpus instead of back-to-back on one.
+class boot_stage {
+public:
+    boot_stage(const char* name, std::function<void ()> work,
+               std::initializer_list<boot_stage*> deps = {})
+        : _deps(deps)
+    {
+        _thread = sched::thread::make([this, work] {
+            for (auto dep : _deps) {
+                dep->wait();
+            }
+            work();
+        }, sched::thread::attr().name(name));
+        _thread->start();
     }
-    arch_init_drivers();
-    console::console_init();
-    nulldev::nulldev_init();
-    if (opt_random) {
-        randomdev::randomdev_init();
+    // Wait for the stage to complete; may be called from several threads
+    void wait()
+    {
+        WITH_LOCK(_mutex) {
+            if (_thread) {
+                _thread->join();
+                delete _thread;
+                _thread = nullptr;
+            }
+        }
     }
-    boot_time.event("drivers loaded");
-
+    ~boot_stage() { wait(); }
+private:
+    std::vector<boot_stage*> _deps;
+    sched::thread* _thread;
+    mutex _mutex;
+};
+
+static void mount_rootfs_stage()
+{
     if (opt_mount) {
         unmount_devfs();
 
@@ -553,7 +708,10 @@ void* do_main_thread(void *_main_args)
     if (opt_preload_zfs_library) {
         load_zfs_library();
     }
+}
 
+static void network_config_stage()
+{
     bool has_if = false;
     osv::for_each_if([&has_if] (std::string if_name) {
         if (if_name == "lo0")
@@ -567,7 +725,10 @@ void* do_main_thread(void *_main_args)
     });
     if (has_if) {
         if (opt_ip.size() == 0) {
-            dhcp_start(true);
+            // Don't hold up boot for the lease - the first socket operation
+            // that actually needs the address waits for it instead (see
+            // dhcp_wait_for_ip())
+            dhcp_start(false);
         } else {
             for (auto t : opt_ip) {
                 std::vector<std::string> tmp;
@@ -591,6 +752,31 @@ void* do_main_thread(void *_main_args)
             }
         }
     }
+}
+
+void* do_main_thread(void *_main_args)
+{
+    auto app_cmdline = static_cast<char*>(_main_args);
+
+    if (!arch_setup_console(opt_console)) {
+        abort("Unknown console:%s\n", opt_console.c_str());
+    }
+    arch_init_drivers();
+    console::console_init();
+    nulldev::nulldev_init();
+    ulogdev::ulogdev_init();
+    if (opt_random) {
+        randomdev::randomdev_init();
+    }
+    boot_time.event("drivers loaded");
+
+    // The root filesystem mount and the network configuration only depend on
+    // the drivers probed above, not on each other, so bring them up
+    // concurrently - DHCP in particular mostly waits for the server to reply.
+    boot_stage mount_stage("boot-mount", mount_rootfs_stage);
+    boot_stage net_stage("boot-net", network_config_stage);
+    mount_stage.wait(); // chdir below and the application need the rootfs
+    net_stage.wait();   // OSV_IP below needs the interfaces configured
 
     std::string if_ip;
     auto nr_ips = 0;
@@ -601,7 +787,10 @@ void* do_main_thread(void *_main_args)
         if_ip = osv::if_ip(if_name);
         nr_ips++;
     });
-    if (nr_ips == 1) {
+    // With DHCP the lease may still be in flight here; only export OSV_IP
+    // when an address has actually been assigned, rather than stall the
+    // application start waiting for it.
+    if (nr_ips == 1 && if_ip != "0.0.0.0") {
        setenv("OSV_IP", if_ip.c_str(), 1);
     }
 
@@ -651,6 +840,19 @@ void* do_main_thread(void *_main_args)
         }
     }
 
+    if (opt_dedup_pages_delay >= 0) {
+        // Wait for the application to fault in its working set first -
+        // pages not yet populated cannot be deduplicated
+        auto delay = std::chrono::seconds(opt_dedup_pages_delay);
+        auto t = sched::thread::make([delay] {
+            sched::thread::sleep(delay);
+            auto bytes = mmu::dedup_readonly_pages();
+            debugf("dedup: released %d KB of duplicate read-only pages\n",
+                   bytes / 1024);
+        }, sched::thread::attr().detached().name("page-dedup"));
+        t->start();
+    }
+
     auto commands = prepare_commands(app_cmdline);
 
     // Run command lines in /init/* before the manual command line
@@ -747,6 +949,10 @@ void main_cont(int loader_argc, char** loader_argv)
     smp_launch();
     setenv("OSV_CPUS", std::to_string(sched::cpus.size()).c_str(), 1);
     boot_time.event("SMP launched");
+    // On big-memory guests most of the physical memory was not onlined
+    // yet - spread that work over the cpus now that they are up, and let
+    // boot continue meanwhile.
+    memory::online_deferred_memory();
 
     auto end = osv::clock::uptime::now() + boot_delay;
     while (end > osv::clock::uptime::now()) {
@@ -779,8 +985,14 @@ void main_cont(int loader_argc, char** loader_argv)
     }
     if (opt_strace) {
         start_strace();
+    } else if (!opt_trace_stream.empty()) {
+        // shares the trace log with strace, so one or the other
+        start_trace_stream(opt_trace_stream.c_str());
     }
 #endif
+    if (opt_lock_stats) {
+        lock_stats::enable(true);
+    }
     sched::init_detached_threads_reaper();
     elf::setup_missing_symbols_detector();
 
@@ -800,6 +1012,12 @@ void main_cont(int loader_argc, char** loader_argv)
         prof::config config{std::chrono::nanoseconds(1000000000 / sampler_frequency)};
         prof::start_sampler(config);
     }
+
+#if CONF_tracepoints
+    if (opt_stall_detector_ms > 0) {
+        osv::start_stall_detector(std::chrono::milliseconds(opt_stall_detector_ms));
+    }
+#endif
 #endif /* !AARCH64_PORT_STUB */
 
     // multiple programs can be run -> separate their arguments
@@ -0,0 +1,6 @@
+from osv.modules import api
+
+# Boot straight into the suite with the default iteration policy
+# (10 warmup batches, 50 measured batches). Override by passing
+# different arguments with scripts/run.py -e.
+default = api.run('/benchmarks/misc-bench-suite.so')
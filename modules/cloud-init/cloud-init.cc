@@ -275,7 +275,17 @@ void osvinit::load(const std::string& script)
 
 void osvinit::load_file(const std::string& path)
 {
-    do_yaml(YAML::LoadFile(path));
+    // Slurp the file with one read instead of letting YAML::LoadFile
+    // stream it through an ifstream in small chunks.
+    std::ifstream f(path, std::ios::binary);
+    if (!f) {
+        throw osvinit_exception("failed to open " + path);
+    }
+    f.seekg(0, std::ios::end);
+    std::string script(static_cast<size_t>(f.tellg()), '\0');
+    f.seekg(0);
+    f.read(&script[0], script.size());
+    do_yaml(YAML::Load(script));
 }
 
 void osvinit::load_url(const std::string& server, const std::string& path,
@@ -12,6 +12,7 @@
 #include <vector>
 #include <sys/statvfs.h>
 #include <mntent.h>
+#include <osv/osv_c_wrappers.h>
 
 namespace httpserver {
 
@@ -107,6 +108,22 @@ void init(routes& routes) {
             return res;
         });
 
+    getZfetchStats.set_handler([](const_req req)
+        {
+            struct osv_zfetch_stats st;
+            if (osv_zfs_zfetch_stats(&st)) {
+                throw not_found_exception("ZFS not loaded");
+            }
+            httpserver::json::ZfetchStat zstat;
+            zstat.hits = st.hits;
+            zstat.misses = st.misses;
+            zstat.stride_hits = st.stride_hits;
+            zstat.stride_misses = st.stride_misses;
+            zstat.fetched_blocks = st.fetched_blocks;
+            zstat.reclaim_failures = st.reclaim_failures;
+            return zstat;
+        });
+
 }
 
 }
@@ -0,0 +1,164 @@
+/*
+ * Copyright (C) 2026 Waldemar Kozaczuk
+ *
+ * This work is open source software, licensed under the terms of the
+ * BSD license as described in the LICENSE file in the top-level directory.
+ */
+
+#include "metrics.hh"
+#include "autogen/metrics.json.hh"
+#include "../libtools/network_interface.hh"
+
+#include <osv/mempool.hh>
+#include <osv/sched.hh>
+#include <osv/trace.hh>
+
+#include <cstdio>
+
+namespace httpserver {
+
+namespace api {
+
+namespace metrics {
+
+using namespace std;
+using namespace osv::network;
+
+// One scrape should cost microseconds: the HELP/TYPE preambles are
+// preformatted string constants and every sample is appended with a
+// plain snprintf into one reserved buffer - no json trees, no
+// per-sample allocation.
+static void add_sample(string& out, const char* name, uint64_t value)
+{
+    char buf[128];
+    auto len = snprintf(buf, sizeof(buf), "%s %lu\n", name,
+        (unsigned long)value);
+    out.append(buf, len);
+}
+
+static void add_sample(string& out, const char* name, const char* label,
+    const char* label_value, uint64_t value)
+{
+    char buf[192];
+    auto len = snprintf(buf, sizeof(buf), "%s{%s=\"%s\"} %lu\n", name,
+        label, label_value, (unsigned long)value);
+    out.append(buf, len);
+}
+
+static string gather()
+{
+    string out;
+    out.reserve(8192);
+
+    out += "# HELP osv_memory_total_bytes Total usable memory\n"
+           "# TYPE osv_memory_total_bytes gauge\n";
+    add_sample(out, "osv_memory_total_bytes", memory::stats::total());
+    out += "# HELP osv_memory_free_bytes Free memory\n"
+           "# TYPE osv_memory_free_bytes gauge\n";
+    add_sample(out, "osv_memory_free_bytes", memory::stats::free());
+    out += "# HELP osv_memory_jvm_heap_bytes Memory reserved for the JVM heap\n"
+           "# TYPE osv_memory_jvm_heap_bytes gauge\n";
+    add_sample(out, "osv_memory_jvm_heap_bytes", memory::stats::jvm_heap());
+
+    out += "# HELP osv_sched_context_switches_total Context switches per cpu\n"
+           "# TYPE osv_sched_context_switches_total counter\n";
+    char cpu_label[16];
+    for (auto c : sched::cpus) {
+        snprintf(cpu_label, sizeof(cpu_label), "%u", c->id);
+        add_sample(out, "osv_sched_context_switches_total", "cpu", cpu_label,
+            c->stats.context_switches);
+    }
+    out += "# HELP osv_sched_preemptions_total Preemptions per cpu\n"
+           "# TYPE osv_sched_preemptions_total counter\n";
+    for (auto c : sched::cpus) {
+        snprintf(cpu_label, sizeof(cpu_label), "%u", c->id);
+        add_sample(out, "osv_sched_preemptions_total", "cpu", cpu_label,
+            c->stats.preemptions);
+    }
+    out += "# HELP osv_sched_runqueue_length Threads queued per cpu\n"
+           "# TYPE osv_sched_runqueue_length gauge\n";
+    for (auto c : sched::cpus) {
+        snprintf(cpu_label, sizeof(cpu_label), "%u", c->id);
+        add_sample(out, "osv_sched_runqueue_length", "cpu", cpu_label,
+            c->runqueue.size());
+    }
+
+    static const struct {
+        const char* preamble;
+        const char* name;
+        u_long if_data::*field;
+    } net_metrics[] = {
+        { "# HELP osv_net_receive_bytes_total Octets received\n"
+          "# TYPE osv_net_receive_bytes_total counter\n",
+          "osv_net_receive_bytes_total", &if_data::ifi_ibytes },
+        { "# HELP osv_net_transmit_bytes_total Octets sent\n"
+          "# TYPE osv_net_transmit_bytes_total counter\n",
+          "osv_net_transmit_bytes_total", &if_data::ifi_obytes },
+        { "# HELP osv_net_receive_packets_total Packets received\n"
+          "# TYPE osv_net_receive_packets_total counter\n",
+          "osv_net_receive_packets_total", &if_data::ifi_ipackets },
+        { "# HELP osv_net_transmit_packets_total Packets sent\n"
+          "# TYPE osv_net_transmit_packets_total counter\n",
+          "osv_net_transmit_packets_total", &if_data::ifi_opackets },
+        { "# HELP osv_net_receive_errors_total Input errors\n"
+          "# TYPE osv_net_receive_errors_total counter\n",
+          "osv_net_receive_errors_total", &if_data::ifi_ierrors },
+        { "# HELP osv_net_transmit_errors_total Output errors\n"
+          "# TYPE osv_net_transmit_errors_total counter\n",
+          "osv_net_transmit_errors_total", &if_data::ifi_oerrors },
+    };
+    auto count = number_of_interfaces();
+    for (auto& m : net_metrics) {
+        out += m.preamble;
+        for (unsigned i = 0; i <= count; i++) {
+            auto* ifp = get_interface_by_index(i);
+            if (!ifp) {
+                continue;
+            }
+            auto name = get_interface_name(ifp);
+            interface intf(name);
+            if_data data = { 0 };
+            if (!set_interface_info(ifp, data, intf)) {
+                continue;
+            }
+            add_sample(out, m.name, "interface", name.c_str(), data.*m.field);
+        }
+    }
+
+    // Counted tracepoints (--trace-count=...) turn into counters named
+    // after the tracepoint; this is where e.g. mutex contention or
+    // block-device rates show up
+    auto counts = get_tracepoint_counts();
+    if (!counts.empty()) {
+        out += "# HELP osv_tracepoint_hits_total Hits of counted tracepoints\n"
+               "# TYPE osv_tracepoint_hits_total counter\n";
+        for (auto& c : counts) {
+            add_sample(out, "osv_tracepoint_hits_total", "tracepoint",
+                c.first, c.second);
+        }
+    }
+
+    return out;
+}
+
+#if !defined(MONITORING)
+extern "C" void httpserver_plugin_register_routes(httpserver::routes* routes) {
+    httpserver::api::metrics::init(*routes);
+}
+#endif
+
+/**
+ * Initialize the routes object with specific routes mapping
+ * @param routes - the routes object to fill
+ */
+void init(routes& routes)
+{
+    metrics_json_init_path("Prometheus metrics API");
+    metrics_json::getMetrics.set_handler("txt", [](const_req req) {
+        return gather();
+    });
+}
+
+}
+}
+}
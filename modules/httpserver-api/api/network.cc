@@ -9,6 +9,7 @@
 #include "../libtools/route_info.hh"
 #include "../libtools/network_interface.hh"
 #include "exception.hh"
+#include <osv/net_channel_stats.hh>
 #include <vector>
 #include <time.h>
 
@@ -87,6 +88,15 @@ void init(routes& routes)
         return get_interface(name, ifp, time_mc);
     });
 
+    network_json::getNetChannels.set_handler([](const_req req) {
+        vector<Net_channel> res;
+        net_channel_foreach_stats([&res](const net_channel_stats& st) {
+            res.push_back(Net_channel());
+            res.back() = st;
+        });
+        return res;
+    });
+
     network_json::getRoute.set_handler([](const_req req) {
         vector<Route> res;
         osv::foreach_route([&res](const osv::route_info& route) {
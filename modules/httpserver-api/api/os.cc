@@ -17,6 +17,7 @@
 #include <api/unistd.h>
 #include <osv/commands.hh>
 #include <osv/osv_c_wrappers.h>
+#include <osv/sampler.hh>
 #include <algorithm>
 #include "../java-base/balloon/balloon_api.hh"
 
@@ -113,6 +114,23 @@ void init(routes& routes)
         return osv_debug_buffer();
     });
 
+    os_bootchart.set_handler([](const_req req) {
+        vector<httpserver::json::BootchartEvent> res;
+        osv_bootchart_event *events;
+        size_t count;
+        if (!osv_get_bootchart_events(&events, &count)) {
+            for (size_t i = 0; i < count; i++) {
+                httpserver::json::BootchartEvent e;
+                e.name = events[i].name;
+                e.time_ms = events[i].time_ms;
+                free(events[i].name);
+                res.push_back(e);
+            }
+            free(events);
+        }
+        return res;
+    });
+
     os_get_hostname.set_handler([](const_req req)
     {
         char hostname[65];
@@ -181,6 +199,24 @@ void init(routes& routes)
     });
 #endif
 
+    os_profile.set_handler([](const_req req) {
+        auto freq_str = req.get_query_param("freq");
+        auto duration_str = req.get_query_param("duration");
+        long freq = freq_str.empty() ? 1000 : atol(freq_str.c_str());
+        long duration = duration_str.empty() ? 2 : atol(duration_str.c_str());
+        if (freq <= 0 || freq > 100000) {
+            throw bad_request_exception("freq must be between 1 and 100000");
+        }
+        if (duration <= 0 || duration > 60) {
+            throw bad_request_exception("duration must be between 1 and 60");
+        }
+        prof::config config;
+        config.period = std::chrono::nanoseconds(1000000000 / freq);
+        prof::start_profiler(config);
+        sleep(duration);
+        return prof::stop_profiler_and_collect();
+    });
+
 }
 
 }
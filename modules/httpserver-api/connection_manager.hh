@@ -13,6 +13,7 @@
 
 #include "connection.hh"
 
+#include <mutex>
 #include <set>
 
 namespace http {
@@ -21,7 +22,8 @@ namespace server {
 
 /**
  * Manages open connections so that they may be cleanly stopped when the server
- * needs to shut down.
+ * needs to shut down. The server may run its io_service on several threads,
+ * so the set of connections is protected by a mutex.
  */
 class connection_manager {
 public:
@@ -60,6 +62,12 @@ private:
      *
      */
     std::set<connection_ptr> connections_;
+
+    /**
+     * Protects the set of connections.
+     *
+     */
+    std::mutex mutex_;
 };
 
 } // namespace server
@@ -26,6 +26,7 @@
 #include "api/hardware.hh"
 #include "api/api.hh"
 #include "api/env.hh"
+#include "api/metrics.hh"
 #endif
 
 namespace httpserver {
@@ -101,6 +102,7 @@ bool global_server::run(std::map<std::string,std::vector<std::string>>& _config)
     set(_config);
     get().set("ipaddress", "0.0.0.0");
     get().set("port", "8000");
+    get().set("threads", "2");
 
 #if !defined(MONITORING)
     if (get().config.count("ssl")) {
@@ -214,6 +216,7 @@ void global_server::set_routes()
     httpserver::api::hardware::init(_routes);
     httpserver::api::env::init(_routes);
     httpserver::api::file::init(_routes);
+    httpserver::api::metrics::init(_routes);
 #endif
     {
         namespace fs = boost::filesystem;
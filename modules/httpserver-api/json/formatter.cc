@@ -18,16 +18,75 @@ namespace httpserver {
 
 namespace json {
 
+void formatter::to_json(ostream& os, const string& str)
+{
+    os << '"';
+    json_escape_UTF8_string(os, str);
+    os << '"';
+}
+
+void formatter::to_json(ostream& os, const char* str)
+{
+    os << '"';
+    json_escape_UTF8_string(os, str);
+    os << '"';
+}
+
+void formatter::to_json(ostream& os, int n)
+{
+    os << n;
+}
+
+void formatter::to_json(ostream& os, long n)
+{
+    os << n;
+}
+
+void formatter::to_json(ostream& os, float f)
+{
+    int inf;
+    if ((inf = boost::math::isinf(f))) {
+        f = inf * FLT_MAX;
+    } else if (boost::math::isnan(f)) {
+        f = 0;
+    }
+    os << to_string(f);
+}
+
+void formatter::to_json(ostream& os, bool b)
+{
+    os << ((b) ? "true" : "false");
+}
+
+void formatter::to_json(ostream& os, const date_time& d)
+{
+    char buff[50];
+    strftime(buff, 50, TIME_FORMAT, &d);
+    os << '"' << buff << '"';
+}
+
+void formatter::to_json(ostream& os, const jsonable& obj)
+{
+    obj.write(os);
+}
+
+void formatter::to_json(ostream& os, unsigned long l)
+{
+    os << l;
+}
+
 string formatter::to_json(const string& str)
 {
-    return '"' + json_escape_UTF8_string(str) + '"';
+    arena_ostringstream os;
+    to_json(os, str);
+    return to_std_string(os.str());
 }
 
 string formatter::to_json(const char* str)
 {
-    string res = "\"";
-    res += json_escape_UTF8_string(str);
-    return res + '"';
+    arena_ostringstream os;
+    to_json(os, str);
+    return to_std_string(os.str());
 }
 
 string formatter::to_json(int n)
@@ -42,13 +101,9 @@ string formatter::to_json(long n)
 
 string formatter::to_json(float f)
 {
-    int inf;
-    if ((inf = boost::math::isinf(f))) {
-        f = inf * FLT_MAX;
-    } else if (boost::math::isnan(f)) {
-        f = 0;
-    }
-    return to_string(f);
+    arena_ostringstream os;
+    to_json(os, f);
+    return to_std_string(os.str());
 }
 
 string formatter::to_json(bool b)
@@ -58,11 +113,9 @@ string formatter::to_json(bool b)
 
 string formatter::to_json(const date_time& d)
 {
-    char buff[50];
-    string res = "\"";
-    strftime(buff, 50, TIME_FORMAT, &d);
-    res += buff;
-    return res + "\"";
+    arena_ostringstream os;
+    to_json(os, d);
+    return to_std_string(os.str());
 }
 
 string formatter::to_json(const jsonable& obj) {
@@ -73,8 +126,8 @@ std::string formatter::to_json(unsigned long l) {
     return to_string(l);
 }
 
-std::string formatter::json_escape_UTF8_string(const std::string& utf8_string) {
-    std::ostringstream o;
+void formatter::json_escape_UTF8_string(ostream& o,
+                                        const std::string& utf8_string) {
     for (auto c = utf8_string.cbegin(); c != utf8_string.cend(); c++) {
         switch (*c) {
             case '"': o << "\\\""; break;
@@ -87,13 +140,13 @@ std::string formatter::json_escape_UTF8_string(const std::string& utf8_string) {
             default:
                 if ('\x00' <= *c && *c <= '\x1f') {
                     o << "\\u"
-                      << std::hex << std::setw(4) << std::setfill('0') << (int)*c;
+                      << std::hex << std::setw(4) << std::setfill('0') << (int)*c
+                      << std::dec << std::setfill(' ');
                 } else {
                     o << *c;
                 }
         }
     }
-    return o.str();
 }
 
 }
@@ -11,6 +11,7 @@
 #include <vector>
 #include <time.h>
 #include <sstream>
+#include "memory_arena.hh"
 
 #pragma GCC visibility push(default)
 namespace httpserver {
@@ -79,21 +80,98 @@ public:
     template<typename T>
     static std::string to_json(const std::vector<T>& vec)
     {
-        std::stringstream res;
-        res << "[";
+        arena_ostringstream res;
+        to_json(res, vec);
+        return to_std_string(res.str());
+    }
+
+    /**
+     * Stream the given value into an output stream in a json format.
+     * The streaming overloads let composite objects serialize into a
+     * single buffer, instead of building a temporary string per element
+     * and concatenating them.
+     * @param os the stream to write to
+     * @param str the string to format
+     */
+    static void to_json(std::ostream& os, const std::string& str);
+
+    /**
+     * Stream a json formated int
+     * @param os the stream to write to
+     * @param n the int to format
+     */
+    static void to_json(std::ostream& os, int n);
+
+    /**
+     * Stream a json formated long
+     * @param os the stream to write to
+     * @param n the long to format
+     */
+    static void to_json(std::ostream& os, long n);
+
+    /**
+     * Stream a json formated float
+     * @param os the stream to write to
+     * @param f the float to format
+     */
+    static void to_json(std::ostream& os, float f);
+
+    /**
+     * Stream a json formated char* (treated as string)
+     * @param os the stream to write to
+     * @param str the char* to format
+     */
+    static void to_json(std::ostream& os, const char* str);
+
+    /**
+     * Stream a json formated bool
+     * @param os the stream to write to
+     * @param d the bool to format
+     */
+    static void to_json(std::ostream& os, bool d);
+
+    /**
+     * Stream a json formated list of a given vector of params
+     * @param os the stream to write to
+     * @param vec the vector to format
+     */
+    template<typename T>
+    static void to_json(std::ostream& os, const std::vector<T>& vec)
+    {
+        os << '[';
         bool first = true;
-        for (auto i : vec) {
+        for (auto& i : vec) {
             if (first) {
                 first = false;
             } else {
-                res << ",";
+                os << ',';
             }
-            res << to_json(i);
+            to_json(os, i);
         }
-        res << "]";
-        return res.str();
+        os << ']';
     }
 
+    /**
+     * Stream a json formated date_time
+     * @param os the stream to write to
+     * @param d the date_time to format
+     */
+    static void to_json(std::ostream& os, const date_time& d);
+
+    /**
+     * Stream a json formated json object
+     * @param os the stream to write to
+     * @param obj the json object to format
+     */
+    static void to_json(std::ostream& os, const jsonable& obj);
+
+    /**
+     * Stream a json formated unsigned long
+     * @param os the stream to write to
+     * @param l unsigned long to format
+     */
+    static void to_json(std::ostream& os, unsigned long l);
+
     /**
      * return a json formated date_time
      * @param d the date_time to format
@@ -119,7 +197,8 @@ private:
 
     constexpr static const char* TIME_FORMAT = "%a %b %d %H:%M:%S %Z %Y";
 
-    static std::string json_escape_UTF8_string(const std::string& utf8_string);
+    static void json_escape_UTF8_string(std::ostream& os,
+                                        const std::string& utf8_string);
 
 };
 
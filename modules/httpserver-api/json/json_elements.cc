@@ -20,32 +20,20 @@ namespace json {
 
 /**
  * The json builder is a helper class
- * To help create a json object
+ * To help create a json object.
+ * It streams the object straight into the given stream,
+ * so no intermediate string is built per element.
  *
  */
 class json_builder {
 public:
-    json_builder()
-        : first(true)
+    json_builder(ostream& os)
+        : result(os)
+        , first(true)
     {
         result << OPEN;
     }
 
-    /**
-     * add a name value to an object
-     * @param name the name of the element
-     * @param str the value already formated
-     */
-    void add(const string& name, const string& str)
-    {
-        if (first) {
-            first = false;
-        } else {
-            result << ", ";
-        }
-        result << '"' << name << "\": " << str;
-    }
-
     /**
      * add a json element to the an object
      * @param element
@@ -55,24 +43,28 @@ public:
         if (element == nullptr || element->set == false) {
             return;
         }
-        add(element->name, element->to_string());
+        if (first) {
+            first = false;
+        } else {
+            result << ", ";
+        }
+        result << '"' << element->name << "\": ";
+        element->write(result);
     }
 
     /**
-     * Get the string representation of the object
-     * @return a string of accumulative object
+     * Close the object on the stream
      */
-    string as_json()
+    void done()
     {
         result << CLOSE;
-        return result.str();
     }
 
 private:
     static const string OPEN;
     static const string CLOSE;
 
-    stringstream result;
+    ostream& result;
     bool first;
 
 };
@@ -89,11 +81,18 @@ void json_base::add(json_base_element* element, string name, bool mandatory)
 
 string json_base::to_json() const
 {
-    json_builder res;
+    arena_ostringstream os;
+    write(os);
+    return to_std_string(os.str());
+}
+
+void json_base::write(ostream& os) const
+{
+    json_builder res(os);
     for (auto i : elements) {
         res.add(i);
     }
-    return res.as_json();
+    res.done();
 }
 
 bool json_base::is_verify() const
@@ -57,6 +57,17 @@ public:
      */
     virtual std::string to_string() = 0;
 
+    /**
+     * stream the internal value in a json format.
+     * Override it when the value can be written without
+     * building an intermediate string.
+     * @param os the stream to write to
+     */
+    virtual void write(std::ostream& os)
+    {
+        os << to_string();
+    }
+
     std::string name;
     bool mandatory;
     bool set;
@@ -116,6 +127,11 @@ public:
         return formatter::to_json(value);
     }
 
+    virtual void write(std::ostream& os) override
+    {
+        formatter::to_json(os, value);
+    }
+
 private:
     T value;
 };
@@ -145,6 +161,11 @@ public:
         return formatter::to_json(elements);
     }
 
+    virtual void write(std::ostream& os) override
+    {
+        formatter::to_json(os, elements);
+    }
+
     std::vector<T> elements;
 };
 
@@ -156,6 +177,17 @@ public:
      * @return the object formated.
      */
     virtual std::string to_json() const = 0;
+
+    /**
+     * stream the object in a json format.
+     * The default implementation falls back on to_json(), objects
+     * that can serialize directly should override it.
+     * @param os the stream to write to
+     */
+    virtual void write(std::ostream& os) const
+    {
+        os << to_json();
+    }
 };
 
 /**
@@ -184,6 +216,13 @@ struct json_base : public jsonable {
      */
     virtual std::string to_json() const;
 
+    /**
+     * stream the object in a json format, writing each registered
+     * element straight into the given stream.
+     * @param os the stream to write to
+     */
+    virtual void write(std::ostream& os) const override;
+
     /**
      * Check that all mandatory elements are set
      * @return true if all mandatory parameters are set
@@ -218,7 +257,9 @@ struct json_return_type {
     std::string res;
     template<class T>
     json_return_type(const T& _res) {
-        res = formatter::to_json(_res);
+        arena_ostringstream os;
+        formatter::to_json(os, _res);
+        res = to_std_string(os.str());
     }
 };
 
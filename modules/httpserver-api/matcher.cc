@@ -41,7 +41,7 @@ size_t param_matcher::match(const string& url, size_t ind, parameters& param)
          */
         return (entire_path) ? 0 : std::string::npos;
     }
-    param[name] = url.substr(ind, last - ind);
+    param[name].assign(url, ind, last - ind);
     return last;
 }
 
@@ -0,0 +1,109 @@
+/*
+ * Copyright (C) 2026 Waldemar Kozaczuk
+ *
+ * This work is open source software, licensed under the terms of the
+ * BSD license as described in the LICENSE file in the top-level directory.
+ */
+
+#include "memory_arena.hh"
+
+#include <algorithm>
+#include <cstdlib>
+#include <new>
+
+namespace httpserver {
+
+static thread_local memory_arena tls_arena;
+
+memory_arena& memory_arena::tls()
+{
+    return tls_arena;
+}
+
+memory_arena* memory_arena::current()
+{
+    return tls_arena.active ? &tls_arena : nullptr;
+}
+
+memory_arena::~memory_arena()
+{
+    chunk* c = chunks;
+    while (c != nullptr) {
+        chunk* next = c->next;
+        free(c);
+        c = next;
+    }
+}
+
+memory_arena::chunk* memory_arena::new_chunk(size_t size)
+{
+    chunk* c = static_cast<chunk*>(malloc(sizeof(chunk) + size));
+    if (c == nullptr) {
+        throw std::bad_alloc();
+    }
+    c->next = nullptr;
+    c->size = size;
+    return c;
+}
+
+void* memory_arena::alloc(size_t size)
+{
+    size = (size + 15) & ~size_t(15);
+    if (current_chunk == nullptr || used + size > current_chunk->size) {
+        // move on to the next retained chunk that fits, or grow the
+        // arena by a fresh one
+        chunk* c = (current_chunk == nullptr) ? chunks : current_chunk->next;
+        while (c != nullptr && c->size < size) {
+            c = c->next;
+        }
+        if (c == nullptr) {
+            c = new_chunk(std::max(size, default_chunk_size));
+            if (current_chunk == nullptr) {
+                chunks = c;
+            } else {
+                chunk* last = current_chunk;
+                while (last->next != nullptr) {
+                    last = last->next;
+                }
+                last->next = c;
+            }
+        }
+        current_chunk = c;
+        used = 0;
+    }
+    void* p = current_chunk->data() + used;
+    used += size;
+    return p;
+}
+
+void memory_arena::reset()
+{
+    current_chunk = chunks;
+    used = 0;
+}
+
+bool memory_arena::owns(const void* p) const
+{
+    for (chunk* c = chunks; c != nullptr; c = c->next) {
+        if (p >= c->data() && p < c->data() + c->size) {
+            return true;
+        }
+    }
+    return false;
+}
+
+memory_arena::scope::scope()
+    : outermost(!tls_arena.active)
+{
+    tls_arena.active = true;
+}
+
+memory_arena::scope::~scope()
+{
+    if (outermost) {
+        tls_arena.active = false;
+        tls_arena.reset();
+    }
+}
+
+}
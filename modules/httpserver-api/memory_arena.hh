@@ -0,0 +1,199 @@
+/*
+ * Copyright (C) 2026 Waldemar Kozaczuk
+ *
+ * This work is open source software, licensed under the terms of the
+ * BSD license as described in the LICENSE file in the top-level directory.
+ */
+
+#ifndef MEMORY_ARENA_HH_
+#define MEMORY_ARENA_HH_
+
+#include <cstddef>
+#include <string>
+#include <sstream>
+
+namespace httpserver {
+
+/**
+ * A bump allocator scoped to the lifetime of one request.
+ *
+ * Handling a single REST request allocates dozens of short lived
+ * strings and stream buffers while the url is matched and the json
+ * response is formatted. All of them are dead by the time the reply is
+ * sent, so instead of taking each one from the general allocator (and
+ * returning it there a microsecond later) they are carved out of a
+ * per-thread arena that is rewound in bulk when the request is done.
+ * This matters because monitoring tools scrape the API on every guest
+ * every second, and the churn was showing up in the allocator.
+ *
+ * The arena hands out memory by bumping a pointer inside a chunk and
+ * never frees individual allocations; reset() rewinds it to the
+ * beginning. Chunks are retained across requests (the footprint is
+ * bounded by the largest response the thread ever built), both to avoid
+ * re-allocating them and so that owns() keeps working for objects whose
+ * destructor runs after the scope ended - their deallocation is then a
+ * no-op. Memory taken from the arena must be released on the thread
+ * that allocated it, which holds trivially for the request-local
+ * temporaries this is meant for.
+ */
+class memory_arena {
+public:
+    memory_arena() = default;
+    ~memory_arena();
+
+    memory_arena(const memory_arena&) = delete;
+    memory_arena& operator=(const memory_arena&) = delete;
+
+    /**
+     * Carve size bytes (16 byte aligned) out of the arena,
+     * growing it by a new chunk when the current one is full.
+     * @param size the number of bytes to allocate
+     * @return the allocated memory, never nullptr (throws bad_alloc)
+     */
+    void* alloc(size_t size);
+
+    /**
+     * Rewind the arena to its beginning, recycling all memory handed
+     * out since the last reset. Chunks are kept for the next request.
+     */
+    void reset();
+
+    /**
+     * Check if a pointer was handed out by this arena.
+     * @param p the pointer to check
+     * @return true if p points into one of the arena chunks
+     */
+    bool owns(const void* p) const;
+
+    /**
+     * The calling thread's arena
+     * @return the per-thread arena instance
+     */
+    static memory_arena& tls();
+
+    /**
+     * The arena to allocate from, if one is active
+     * @return the per-thread arena while a scope is alive, or nullptr
+     */
+    static memory_arena* current();
+
+    /**
+     * Activates the per-thread arena for the duration of a request and
+     * rewinds it on exit. Nested scopes are harmless - only the
+     * outermost one resets the arena.
+     */
+    class scope {
+    public:
+        scope();
+        ~scope();
+
+        scope(const scope&) = delete;
+        scope& operator=(const scope&) = delete;
+    private:
+        bool outermost;
+    };
+
+private:
+    struct chunk {
+        chunk* next;
+        size_t size;
+        char* data()
+        {
+            return reinterpret_cast<char*>(this + 1);
+        }
+        const char* data() const
+        {
+            return reinterpret_cast<const char*>(this + 1);
+        }
+    };
+
+    chunk* new_chunk(size_t size);
+
+    static constexpr size_t default_chunk_size = 16384;
+
+    chunk* chunks = nullptr; // all chunks, in allocation order
+    chunk* current_chunk = nullptr; // the chunk being bumped
+    size_t used = 0; // bytes handed out from current_chunk
+    bool active = false;
+};
+
+/**
+ * A minimal STL allocator on top of the per-thread arena.
+ * While a memory_arena::scope is alive allocations are served from the
+ * arena and deallocations are no-ops; without one it behaves like
+ * std::allocator, so arena backed types are safe to use (just slower)
+ * outside of request handling.
+ */
+template<typename T>
+struct arena_allocator {
+    typedef T value_type;
+    typedef T* pointer;
+    typedef const T* const_pointer;
+    typedef T& reference;
+    typedef const T& const_reference;
+    typedef size_t size_type;
+    typedef ptrdiff_t difference_type;
+
+    template<typename U>
+    struct rebind {
+        typedef arena_allocator<U> other;
+    };
+
+    arena_allocator() = default;
+    template<typename U>
+    arena_allocator(const arena_allocator<U>&) { }
+
+    T* allocate(size_t n)
+    {
+        auto arena = memory_arena::current();
+        if (arena != nullptr) {
+            return static_cast<T*>(arena->alloc(n * sizeof(T)));
+        }
+        return static_cast<T*>(::operator new(n * sizeof(T)));
+    }
+
+    void deallocate(T* p, size_t n)
+    {
+        if (memory_arena::tls().owns(p)) {
+            return;
+        }
+        ::operator delete(p);
+    }
+
+    template<typename U>
+    bool operator==(const arena_allocator<U>&) const
+    {
+        return true;
+    }
+
+    template<typename U>
+    bool operator!=(const arena_allocator<U>&) const
+    {
+        return false;
+    }
+};
+
+/**
+ * An output string stream whose buffer grows inside the request arena.
+ * The accumulated string has to be copied into a regular std::string
+ * before it escapes the request scope.
+ */
+typedef std::basic_string<char, std::char_traits<char>,
+                          arena_allocator<char>> arena_string;
+typedef std::basic_ostringstream<char, std::char_traits<char>,
+                                 arena_allocator<char>> arena_ostringstream;
+
+/**
+ * Copy an arena backed string into a regular one, so the result can
+ * outlive the request.
+ * @param str the arena backed string
+ * @return the same characters in a std::string
+ */
+inline std::string to_std_string(const arena_string& str)
+{
+    return std::string(str.data(), str.size());
+}
+
+}
+
+#endif /* MEMORY_ARENA_HH_ */
@@ -11,6 +11,7 @@
 #include "reply.hh"
 #include "json/json_path.hh"
 #include "exception.hh"
+#include "memory_arena.hh"
 
 namespace httpserver {
 
@@ -40,6 +41,12 @@ routes::~routes()
 void routes::handle(const string& path, http::server::request& req,
                     http::server::reply& rep)
 {
+    // While the request is matched and handled, the temporary strings
+    // and stream buffers the json formatter churns through come from
+    // the per-thread arena and are recycled in bulk when we return.
+    // Anything that outlives the request (rep.content, req.param) is a
+    // regular std::string and escapes the arena by being copied out.
+    memory_arena::scope arena_scope;
     handler_base* handler = get_handler(str2type(req.method),
                                         normalize_url(path), req.param);
     if (handler != nullptr) {
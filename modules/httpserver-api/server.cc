@@ -18,6 +18,8 @@
 #include "plain_server.hh"
 
 #include <utility>
+#include <thread>
+#include <vector>
 #if !defined(MONITORING)
 #include <openssl/ssl.h>
 #endif
@@ -48,6 +50,18 @@ server::server(std::map<std::string,std::vector<std::string>> &config,
         options::extract_option_value(config, "port")
     });
 
+    nr_threads_ = 2;
+    if (config.count("threads")) {
+        nr_threads_ = options::extract_option_int_value(config, "threads",
+            [](const std::string &message) {
+                std::cerr << message << std::endl;
+                throw std::runtime_error("invalid configuration");
+            });
+        if (nr_threads_ < 1) {
+            nr_threads_ = 1;
+        }
+    }
+
     tcp::acceptor tcp_acceptor(io_service_);
     tcp_acceptor.open(endpoint.protocol());
     tcp_acceptor.set_option(boost::asio::ip::tcp::acceptor::reuse_address(true));
@@ -125,7 +139,19 @@ void server::run()
     // have finished. While the server is running, there is always at least one
     // asynchronous operation outstanding: the asynchronous accept call waiting
     // for new incoming connections.
+    //
+    // Run it on a small fixed pool of threads (--threads, default 2) so a
+    // single slow handler does not stall every other request; each
+    // connection only has one asynchronous operation in flight at a time,
+    // so its handlers never run concurrently with each other.
+    std::vector<std::thread> pool;
+    for (unsigned i = 1; i < nr_threads_; i++) {
+        pool.emplace_back([this] { io_service_.run(); });
+    }
     io_service_.run();
+    for (auto& t : pool) {
+        t.join();
+    }
 }
 
 } // namespace server
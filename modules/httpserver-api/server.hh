@@ -82,6 +82,12 @@ private:
      *
      */
     request_handler request_handler_;
+
+    /**
+     * The number of threads running the io_service loop.
+     *
+     */
+    unsigned nr_threads_;
 };
 
 } // namespace server
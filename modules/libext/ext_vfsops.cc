@@ -21,6 +21,7 @@ void free_contiguous_aligned(void* p);
 #include <ext4_blockdev.h>
 #include <ext4_debug.h>
 #include <ext4_fs.h>
+#include <ext4_journal.h>
 #include <ext4_super.h>
 
 #include <cstdlib>
@@ -103,6 +104,44 @@ static struct ext4_fs ext_fs;
 static struct ext4_bcache ext_block_cache;
 extern struct vnops ext_vnops;
 
+//Journal state. When the mounted volume has a journal we keep a single
+//running jbd transaction that all metadata updates join (see
+//ext4_trans_set_block_dirty() in lwext4), and commit it as a whole on
+//fsync()/sync() and on unmount. This way any number of concurrent writers
+//share one journal write per commit (group commit) instead of journaling
+//each operation separately.
+static struct jbd_fs ext_jbd_fs;
+static struct jbd_journal ext_journal;
+static bool ext_journal_started;
+static mutex_t ext_journal_mutex;
+
+//Commit whatever has accumulated in the running transaction in one journal
+//write, start a new transaction and flush the block cache. Shared by
+//ext_sync(), ext_fsync() (in ext_vnops.cc) and the unmount path.
+int ext_commit_journal()
+{
+    if (ext_journal_started) {
+        mutex_lock(&ext_journal_mutex);
+        int r = EOK;
+        if (ext_fs.curr_trans) {
+            jbd_journal_submit_trans(&ext_journal, ext_fs.curr_trans);
+            ext_fs.curr_trans = NULL;
+        }
+        r = jbd_journal_commit_all(&ext_journal);
+        if (r == EOK) {
+            ext_fs.curr_trans = jbd_journal_new_trans(&ext_journal);
+            if (!ext_fs.curr_trans) {
+                r = ENOMEM;
+            }
+        }
+        mutex_unlock(&ext_journal_mutex);
+        if (r != EOK) {
+            return r;
+        }
+    }
+    return ext4_block_cache_flush(&ext_blockdev);
+}
+
 static mutex_t ext_inode_alloc_mutex;
 static void ext_inode_alloc_lock()
 {
@@ -203,6 +242,34 @@ ext_mount(struct mount *mp, const char *dev, int flags, const void *data)
     }
 
     ext_blockdev.fs = &ext_fs;
+
+    //If the volume carries a journal, replay whatever an unclean shutdown
+    //may have left in it and start journaling; lwext4 honors the v2/v3
+    //journal checksum features when the volume has them enabled. Failure
+    //is not fatal - we fall back to unjournaled writes like before.
+    if (ext4_sb_feature_com(&ext_fs.sb, EXT4_FCOM_HAS_JOURNAL)) {
+        mutex_init(&ext_journal_mutex);
+        int jr = jbd_get_fs(&ext_fs, &ext_jbd_fs);
+        if (jr == EOK) {
+            jr = jbd_recover(&ext_jbd_fs);
+            if (jr == EOK) {
+                jr = jbd_journal_start(&ext_jbd_fs, &ext_journal);
+            }
+            if (jr != EOK) {
+                jbd_put_fs(&ext_jbd_fs);
+            }
+        }
+        if (jr == EOK) {
+            ext_fs.jbd_fs = &ext_jbd_fs;
+            ext_fs.jbd_journal = &ext_journal;
+            ext_fs.curr_trans = jbd_journal_new_trans(&ext_journal);
+            ext_journal_started = true;
+            kprintf("[ext4] Started journal (group commit on fsync/sync)\n");
+        } else {
+            kprintf("[ext4] Failed to start journal (%d), writes will not be journaled!\n", jr);
+        }
+    }
+
     mp->m_data = &ext_fs;
     mp->m_root->d_vnode->v_ino = EXT4_INODE_ROOT_INDEX;
 
@@ -213,6 +280,21 @@ ext_mount(struct mount *mp, const char *dev, int flags, const void *data)
 static int
 ext_unmount(struct mount *mp, int flags)
 {
+    if (ext_journal_started) {
+        ext_commit_journal();
+        mutex_lock(&ext_journal_mutex);
+        if (ext_fs.curr_trans) {
+            jbd_journal_free_trans(&ext_journal, ext_fs.curr_trans, true);
+            ext_fs.curr_trans = NULL;
+        }
+        jbd_journal_stop(&ext_journal);
+        jbd_put_fs(&ext_jbd_fs);
+        ext_fs.jbd_journal = NULL;
+        ext_fs.jbd_fs = NULL;
+        ext_journal_started = false;
+        mutex_unlock(&ext_journal_mutex);
+    }
+
     int r = ext4_fs_fini(&ext_fs);
     if (r == EOK) {
         ext4_bcache_cleanup(&ext_block_cache);
@@ -228,7 +310,7 @@ ext_unmount(struct mount *mp, int flags)
 static int
 ext_sync(struct mount *mp)
 {
-    return EIO;
+    return ext_commit_journal();
 }
 
 static int
@@ -21,8 +21,10 @@
 //access to block cache, i-node and block allocation routines as well as updating
 //super block.
 //
-//Also, it does not implement journal (we can integrate it later and make it optional)
-//nor xattr which is not even supported by OSv VFS layer.
+//When the mounted volume has a journal, metadata updates join the running
+//jbd transaction that ext_vfsops.cc maintains and get committed as a group
+//on fsync()/sync() and on unmount (see ext_commit_journal() there).
+//xattr is not implemented as it is not even supported by OSv VFS layer.
 
 extern "C" {
 #define USE_C_INTERFACE 1
@@ -38,6 +40,10 @@ void* alloc_contiguous_aligned(size_t size, size_t align);
 void free_contiguous_aligned(void* p);
 }
 
+//Defined in ext_vfsops.cc - commits the running journal transaction (if
+//journaling) and flushes the block cache
+int ext_commit_journal();
+
 #include <ext4_errno.h>
 #include <ext4_dir.h>
 #include <ext4_inode.h>
@@ -100,7 +106,6 @@ typedef	struct vattr vattr_t;
 //TODO:
 //Ops:
 // - ext_ioctl
-// - ext_fsync
 //
 // Later:
 // - ext_arc
@@ -533,7 +538,9 @@ static int
 ext_fsync(vnode_t *vp, file_t *fp)
 {
     ext_debug("fsync\n");
-    return (EINVAL);
+    //lwext4 keeps no per-file dirty list so we sync the whole filesystem:
+    //all writers that raced with us share this one journal commit
+    return ext_commit_journal();
 }
 
 static int
@@ -0,0 +1,7 @@
+from osv.modules import api
+
+api.require('libtools')
+
+# Sink side; point a second instance at it with e.g.
+#   scripts/run.py -e "/netbench.so -c <host> -t TCP_RR"
+default = api.run('/netbench.so -s')
@@ -12,6 +12,12 @@
 #include <osv/file.h>
 #include <osv/mount.h>
 
+#include <poll.h>
+
+#include <algorithm>
+#include <chrono>
+#include <vector>
+
 #include "nfs.hh"
 
 static inline struct nfs_context *get_nfs_context(struct vnode *node,
@@ -46,6 +52,164 @@ static inline std::string mkpath(struct vnode *node, const char *name)
     return path + "/" + name;
 }
 
+// ---------------------------------------------------------------------------
+// Attribute cache.
+//
+// Build-style workloads stat the same files over and over (lookup during
+// path resolution, getattr right after), and each nfs_stat64() is a full
+// round trip to the server. Cache the stat results for a few seconds, the
+// way Linux's acregmin does, and drop an entry whenever this client
+// modifies the file. Like the nfs contexts themselves the cache is
+// thread-local, so no locking is needed; cross-client (and cross-thread)
+// modifications are only noticed once the entry times out, which is the
+// usual NFS attribute-cache weak consistency.
+static constexpr auto attr_cache_timeout = std::chrono::seconds(3);
+
+struct cached_attrs {
+    struct nfs_stat_64 st;
+    std::chrono::steady_clock::time_point expires;
+};
+
+static thread_local std::unordered_map<std::string, cached_attrs> _attr_cache;
+
+static int stat_cached(struct nfs_context *nfs, const std::string &path,
+                       struct nfs_stat_64 *st)
+{
+    auto now = std::chrono::steady_clock::now();
+    auto it = _attr_cache.find(path);
+    if (it != _attr_cache.end()) {
+        if (now < it->second.expires) {
+            *st = it->second.st;
+            return 0;
+        }
+        _attr_cache.erase(it);
+    }
+
+    int ret = nfs_stat64(nfs, path.c_str(), st);
+    if (!ret) {
+        _attr_cache[path] = {*st, now + attr_cache_timeout};
+    }
+    return ret;
+}
+
+static void attr_cache_invalidate(const std::string &path)
+{
+    _attr_cache.erase(path);
+}
+
+// ---------------------------------------------------------------------------
+// Pipelined reads with readahead.
+//
+// libnfs's synchronous nfs_pread() keeps exactly one READ on the wire, so
+// large or sequential reads are bound by the round trip time instead of
+// the wire bandwidth. We chop reads into rpc-sized chunks and keep a
+// bounded window of them in flight on the thread's own nfs context, and
+// when a file is being read sequentially we fetch a full readahead window
+// beyond the requested range and serve the following reads from it.
+static constexpr size_t rpc_chunk_size = 64 * 1024;
+static constexpr unsigned rpc_window = 8;
+static constexpr size_t readahead_size = rpc_window * rpc_chunk_size;
+
+struct pread_chunk {
+    char *dst;
+    uint64_t offset;
+    size_t len;
+    int result;
+    bool done;
+};
+
+static void pread_chunk_cb(int status, struct nfs_context *nfs, void *data,
+                           void *private_data)
+{
+    auto chunk = static_cast<pread_chunk *>(private_data);
+    if (status > 0) {
+        memcpy(chunk->dst, data, status);
+    }
+    chunk->result = status;
+    chunk->done = true;
+}
+
+// Issue up to rpc_window READs at a time until the whole [offset,
+// offset+len) range has been read into buf. Returns a negative errno on
+// failure, otherwise the number of bytes read (the range is trimmed to
+// the file size by the callers, but a racing truncate may still legally
+// shorten the result).
+static ssize_t pipelined_pread(struct nfs_context *nfs, struct nfsfh *handle,
+                               uint64_t offset, size_t len, char *buf)
+{
+    std::vector<pread_chunk> chunks((len + rpc_chunk_size - 1) / rpc_chunk_size);
+
+    uint64_t chunk_offset = offset;
+    for (auto &chunk : chunks) {
+        chunk.dst = buf + (chunk_offset - offset);
+        chunk.offset = chunk_offset;
+        chunk.len = std::min(rpc_chunk_size, len - (chunk_offset - offset));
+        chunk.result = 0;
+        chunk.done = false;
+        chunk_offset += chunk.len;
+    }
+
+    size_t issued = 0, completed = 0;
+    unsigned inflight = 0;
+    while (completed < chunks.size()) {
+        // top the window up
+        while (issued < chunks.size() && inflight < rpc_window) {
+            auto &chunk = chunks[issued];
+            if (nfs_pread_async(nfs, handle, chunk.offset, chunk.len,
+                                pread_chunk_cb, &chunk)) {
+                return -EIO;
+            }
+            issued++;
+            inflight++;
+        }
+
+        struct pollfd pfd;
+        pfd.fd = nfs_get_fd(nfs);
+        pfd.events = nfs_which_events(nfs);
+        if (poll(&pfd, 1, -1) < 0) {
+            return -errno;
+        }
+        if (nfs_service(nfs, pfd.revents) < 0) {
+            return -EIO;
+        }
+
+        while (completed < issued && chunks[completed].done) {
+            if (chunks[completed].result < 0) {
+                return chunks[completed].result;
+            }
+            inflight--;
+            completed++;
+        }
+    }
+
+    // Add the chunks up, stopping at the first short read (EOF)
+    ssize_t total = 0;
+    for (auto &chunk : chunks) {
+        total += chunk.result;
+        if ((size_t)chunk.result < chunk.len) {
+            break;
+        }
+    }
+    return total;
+}
+
+// Per-file-handle readahead state: the last prefetched window and where a
+// sequential reader is expected to continue.
+struct readahead_state {
+    uint64_t next_offset = 0;
+    uint64_t buf_offset = 0;
+    size_t buf_len = 0;
+    std::vector<char> buf;
+};
+
+static thread_local std::unordered_map<struct nfsfh *, readahead_state> _readahead;
+
+static void readahead_drop(struct vnode *vp)
+{
+    if (vp->v_data && vp->v_type == VREG) {
+        _readahead.erase(get_handle(vp));
+    }
+}
 
 int nfs_op_open(struct file *fp)
 {
@@ -146,15 +310,37 @@ static int nfs_op_read(struct vnode *vp, struct file *fp, struct uio *uio,
     else
         len = uio->uio_resid;
 
-    // FIXME: remove this temporary buffer
-    auto buf = std::unique_ptr<char>(new char[len + 1]());
+    uint64_t offset = uio->uio_offset;
+    auto &ra = _readahead[handle];
 
-    int ret = nfs_pread(nfs, handle, uio->uio_offset, len, buf.get());
+    // Serve the read from the last prefetched window if it is fully
+    // contained in it
+    if (offset >= ra.buf_offset && offset + len <= ra.buf_offset + ra.buf_len) {
+        ra.next_offset = offset + len;
+        return uiomove(ra.buf.data() + (offset - ra.buf_offset), len, uio);
+    }
+
+    // On a sequential read fetch a whole readahead window beyond what was
+    // asked for (but not past the end of the file) - the following reads
+    // will be served from it without touching the wire
+    size_t fetch_len = len;
+    if (offset == ra.next_offset) {
+        fetch_len = std::min<uint64_t>(std::max(len, readahead_size),
+                                       vp->v_size - offset);
+    }
+
+    ra.buf.resize(fetch_len);
+    ssize_t ret = pipelined_pread(nfs, handle, offset, fetch_len, ra.buf.data());
     if (ret < 0) {
+        _readahead.erase(handle);
         return -ret;
     }
 
-    return uiomove(buf.get(), ret, uio);
+    ra.buf_offset = offset;
+    ra.buf_len = ret;
+    ra.next_offset = offset + std::min<size_t>(len, ret);
+
+    return uiomove(ra.buf.data(), std::min<size_t>(len, ret), uio);
 }
 
 static int nfs_op_write(struct vnode *vp, struct uio *uio, int ioflag)
@@ -221,6 +407,13 @@ static int nfs_op_write(struct vnode *vp, struct uio *uio, int ioflag)
 
     vp->v_size = new_size;
 
+    // our size/mtime changed and any prefetched data may be stale now
+    auto name = get_node_name(vp);
+    if (name) {
+        attr_cache_invalidate(name);
+    }
+    readahead_drop(vp);
+
     return 0;
 }
 
@@ -296,8 +489,9 @@ static int nfs_op_lookup(struct vnode *dvp, char *p, struct vnode **vpp)
     assert(path != ".");
     assert(path != "..");
 
-    // We must get the inode number so we query the NFS server.
-    int ret = nfs_stat64(nfs, path.c_str(), &st);
+    // We must get the inode number so we query the NFS server
+    // (or the attribute cache).
+    int ret = stat_cached(nfs, path, &st);
     if (ret) {
         return -ret;
     }
@@ -358,6 +552,8 @@ static int nfs_op_create(struct vnode *dvp, char *name, mode_t mode)
         return -ret;
     }
 
+    attr_cache_invalidate(path);
+
     return -nfs_close(nfs, handle);
 }
 
@@ -371,6 +567,8 @@ static int nfs_op_remove(struct vnode *dvp, struct vnode *vp, char *name)
         return err_no;
     }
 
+    attr_cache_invalidate(path);
+
     return -nfs_unlink(nfs, path.c_str());
 }
 
@@ -386,6 +584,9 @@ static int nfs_op_rename(struct vnode *dvp1, struct vnode *vp1, char *old_path,
         return err_no;
     }
 
+    attr_cache_invalidate(src);
+    attr_cache_invalidate(dst);
+
     return -nfs_rename(nfs, src.c_str(), dst.c_str());
 }
 
@@ -413,6 +614,8 @@ static int nfs_op_rmdir(struct vnode *dvp, struct vnode *vp, char *name)
         return err_no;
     }
 
+    attr_cache_invalidate(path);
+
     return -nfs_rmdir(nfs, path.c_str());
 }
 
@@ -442,8 +645,8 @@ static int nfs_op_getattr(struct vnode *vp, struct vattr *attr)
         return ENOENT;
     }
 
-    // Get the file infos.
-    int ret = nfs_stat64(nfs, path, &st);
+    // Get the file infos (possibly from the attribute cache).
+    int ret = stat_cached(nfs, path, &st);
     if (ret) {
         return -ret;
     }
@@ -485,6 +688,8 @@ static int nfs_op_setattr(struct vnode *vp, struct vattr *attr)
         return ENOENT;
     }
 
+    attr_cache_invalidate(path);
+
     // Change all that we can change with libnfs.
 
     ret = nfs_chmod(nfs, path, attr->va_mode);
@@ -516,6 +721,9 @@ static int nfs_op_truncate(struct vnode *vp, off_t length)
 
     vp->v_size = length;
 
+    attr_cache_invalidate(get_node_name(vp));
+    readahead_drop(vp);
+
     return 0;
 }
 
@@ -553,6 +761,8 @@ static int nfs_op_symlink(struct vnode *dvp, char *l, char *t)
         return err_no;
     }
 
+    attr_cache_invalidate(link);
+
     return -nfs_symlink(nfs, target.c_str(), link.c_str());
 }
 
@@ -576,6 +786,7 @@ static  int nfs_op_inactive(struct vnode *dvp)
         nfs_closedir(nfs, handle);
     } else if (type == VREG) {
         auto handle = get_handle(dvp);
+        _readahead.erase(handle);
         nfs_close(nfs, handle);
     } else {
         return 0;
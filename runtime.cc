@@ -33,6 +33,7 @@
 #include "processor.hh"
 #include <osv/debug.hh>
 #include <osv/mempool.hh>
+#include <osv/trace.hh>
 #include <osv/export.h>
 #include <pwd.h>
 #include <fcntl.h>
@@ -54,6 +55,7 @@
 #include <api/sys/resource.h>
 #include <api/math.h>
 #include <osv/shutdown.hh>
+#include <osv/crashdump.hh>
 #include <osv/execinfo.hh>
 #include <osv/demangle.hh>
 #include <processor.hh>
@@ -132,6 +134,14 @@ void abort(const char *fmt, ...)
     } else {
         debug_early("Halting.\n");
     }
+#if CONF_tracepoints
+    // No-op unless the --flight-recorder mode is on
+    dump_flight_recorder();
+#endif
+    // No-op unless --crashdump reserved a buffer. Serialized before the
+    // pvpanic notification below, so the host sees a finished dump by the
+    // time it learns of the panic.
+    crashdump::dump(msg);
 #ifndef AARCH64_PORT_STUB
 #if CONF_drivers_acpi
     panic::pvpanic::panicked();
@@ -41,6 +41,15 @@
 # Table of inodes where each specifies type (dir,file,symlink) and data offset
 # (for files it is a block on a disk, for symlinks and directories it is an
 # offset in one of the 2 tables above)
+#
+# With --compress (superblock version 2, ROFS_SB_FLAG_LZ4) each file's data
+# is instead stored as lz4-compressed extents of 32K of original data each
+# (matching the kernel's cache segment size, so reading one extent fills one
+# cache segment with a single bio and a single decompress). The file's
+# data_offset then points at an extent table - a uint32 extent count
+# followed by one uint32 stored size per extent, with the high bit marking
+# extents kept raw because compression did not shrink them - padded to a
+# block, with the extents following back-to-back, each padded to a block.
 ##################################################################################
 
 import os, optparse, io
@@ -50,12 +59,19 @@ from manifest_common import add_var, expand, unsymlink, read_manifest, defines,
 
 OSV_BLOCK_SIZE = 512
 
+ROFS_EXTENT_SIZE = 32 * 1024
+ROFS_EXTENT_RAW = 0x80000000
+ROFS_EXTENT_LEN_MASK = 0x7fffffff
+
 DIR_MODE  = int('0x4000', 16)
 REG_MODE  = int('0x8000', 16)
 LINK_MODE = int('0xA000', 16)
 
 block = 0
 
+# Set by --compress: a function compressing bytes into an LZ4 block
+lz4_compress = None
+
 class SuperBlock(Structure):
     _fields_ = [
         ('magic', c_ulonglong),
@@ -65,7 +81,8 @@ class SuperBlock(Structure):
         ('structure_info_blocks_count', c_ulonglong),
         ('directory_entries_count', c_ulonglong),
         ('symlinks_count', c_ulonglong),
-        ('inodes_count', c_ulonglong)
+        ('inodes_count', c_ulonglong),
+        ('flags', c_ulonglong) # only read by the kernel for version >= 2
     ]
 
 # data_offset and count represent different things depending on mode:
@@ -177,6 +194,89 @@ def write_file(fp, path):
 
     return total
 
+def pad_to_block(fp, written):
+    global block
+    pad_len = (OSV_BLOCK_SIZE - written % OSV_BLOCK_SIZE) % OSV_BLOCK_SIZE
+    pad(fp, pad_len)
+    block += (written + pad_len) // OSV_BLOCK_SIZE
+
+def lz4_compress_fallback(src):
+    # Greedy LZ4 block compressor used when the python lz4 module is not
+    # installed - slower and a little less tight than the real library,
+    # but produces perfectly standard blocks.
+    n = len(src)
+    out = bytearray()
+
+    def emit_len(l):
+        while l >= 255:
+            out.append(255)
+            l -= 255
+        out.append(l)
+
+    table = {}
+    anchor = 0
+    i = 0
+    # Per the spec, the last match must start at least 12 bytes before
+    # the end of the block and must not cover the last 5 bytes
+    while i <= n - 12:
+        seq = src[i:i+4]
+        j = table.get(seq, -1)
+        table[seq] = i
+        if j < 0 or i - j > 65535:
+            i += 1
+            continue
+        m = i + 4
+        k = j + 4
+        while m < n - 5 and src[m] == src[k]:
+            m += 1
+            k += 1
+        lit_len = i - anchor
+        match_len = m - i - 4 # minus the 4-byte minimum match
+        out.append((min(lit_len, 15) << 4) | min(match_len, 15))
+        if lit_len >= 15:
+            emit_len(lit_len - 15)
+        out += src[anchor:i]
+        out += (i - j).to_bytes(2, 'little')
+        if match_len >= 15:
+            emit_len(match_len - 15)
+        anchor = m
+        i = m
+    lit_len = n - anchor
+    out.append(min(lit_len, 15) << 4)
+    if lit_len >= 15:
+        emit_len(lit_len - 15)
+    out += src[anchor:]
+    return bytes(out)
+
+def write_file_compressed(fp, path):
+    with open(path, 'rb') as f:
+        data = f.read()
+
+    total = len(data)
+    if total == 0:
+        return 0
+
+    extents = []
+    for offset in range(0, total, ROFS_EXTENT_SIZE):
+        chunk = data[offset:offset + ROFS_EXTENT_SIZE]
+        compressed = lz4_compress(chunk)
+        if len(compressed) >= len(chunk):
+            extents.append((len(chunk) | ROFS_EXTENT_RAW, chunk))
+        else:
+            extents.append((len(compressed), compressed))
+
+    table = pack('<I', len(extents))
+    for (stored_len, _) in extents:
+        table += pack('<I', stored_len)
+    fp.write(table)
+    pad_to_block(fp, len(table))
+
+    for (stored_len, payload) in extents:
+        fp.write(payload)
+        pad_to_block(fp, stored_len & ROFS_EXTENT_LEN_MASK)
+
+    return total
+
 def write_inodes(fp):
     global inodes
 
@@ -219,7 +319,10 @@ def write_dir(fp, manifest, dirpath, parent_dir):
                 inode.mode = REG_MODE
                 global block
                 inode.data_offset = block
-                inode.count = write_file(fp, val)
+                if lz4_compress:
+                    inode.count = write_file_compressed(fp, val)
+                else:
+                    inode.count = write_file(fp, val)
                 print('Adding %s' % (dirpath + '/' + entry))
 
     # This needs to be added so that later we can walk the tree
@@ -277,7 +380,11 @@ def gen_image(out, manifest):
     global symlinks
 
     sb = SuperBlock()
-    sb.version = 1
+    if lz4_compress:
+        sb.version = 2
+        sb.flags = 1 # ROFS_SB_FLAG_LZ4
+    else:
+        sb.version = 1
     sb.magic = int('0xDEADBEAD', 16)
     sb.block_size = OSV_BLOCK_SIZE
     sb.structure_info_first_block = system_structure_block
@@ -353,10 +460,24 @@ def main():
                         metavar='VAR=DATA',
                         action='callback',
                         callback=add_var),
+            make_option('-c', '--compress',
+                        dest='compress',
+                        help='compress file data with per-extent lz4',
+                        action='store_true',
+                        default=False),
     ])
 
     (options, args) = opt.parse_args()
 
+    if options.compress:
+        global lz4_compress
+        try:
+            import lz4.block
+            lz4_compress = lambda data: lz4.block.compress(data, store_size=False)
+        except ImportError:
+            print('python lz4 module not found, using the (slower) built-in compressor')
+            lz4_compress = lz4_compress_fallback
+
     manifest = read_manifest(options.manifest)
 
     outfile = os.path.abspath(options.output)
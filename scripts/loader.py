@@ -5,6 +5,7 @@ import re
 import os, os.path
 import heapq
 import fnmatch
+import struct
 from glob import glob
 from collections import defaultdict
 
@@ -1307,12 +1308,24 @@ def all_traces():
             print('!!! Could not find any trace data! Make sure "--trace" option matches some tracepoints.')
             raise StopIteration
 
+        # The thread-name intern table; v2 records carry a slot index
+        names_val = trace_buffer['_names']
+        slot_size = 8 + 16
+        n_slots = names_val.type.sizeof // slot_size
+        names_raw = bytes(inf.read_memory(names_val.address, n_slots * slot_size))
+        names = []
+        for i in range(n_slots):
+            slot = names_raw[i * slot_size:(i + 1) * slot_size]
+            thread_ptr, = struct.unpack('Q', slot[:8])
+            names.append((thread_ptr, slot[8:].partition(b'\0')[0].decode()))
+
         trace_log = inf.read_memory(trace_log_base, max_trace)
 
         last %= max_trace
         pivot = align_up(last, trace_page_size)
         trace_log = concat(trace_log[pivot:], trace_log[:last])
 
+        last_time = 0
         unpacker = trace.SlidingUnpacker(trace_log)
         while unpacker:
             tp_key, = unpacker.unpack('Q')
@@ -1324,8 +1337,17 @@ def all_traces():
             if tp_key == -1:
                 break
 
-            thread, thread_name, time, cpu, flags = unpacker.unpack('Q16sQII')
-            thread_name = thread_name.partition(b'\0')[0].decode()
+            thread, time_delta, cpu, flags, name_id = unpacker.unpack('QIHBB')
+            if flags & 2: # absolute timestamp follows the header
+                time, = unpacker.unpack('Q')
+            else:
+                time = last_time + time_delta
+            last_time = time
+            slot = names[name_id]
+            if thread and slot[0] == thread:
+                thread_name = slot[1]
+            else:
+                thread_name = '?' # slot recycled after this record
 
             tp = tracepoints.get(tp_key, None)
             if not tp:
@@ -319,7 +319,10 @@ class TraceDumpReaderBase :
             self.read('Q') # size. ignore, do not support embedded yet.
             if self.read('I') != 1: #endian check. verify tag check
                 raise SyntaxError
-            self.read('I') # version. should check
+            # (major << 16) | minor. Minor 2 introduced v2 trace records:
+            # delta timestamps, interned thread names and a name table at
+            # the head of each TRCS chunk.
+            self.version = self.read('I')
             while self.readStruct0():
                 pass
         finally:
@@ -372,8 +375,19 @@ class TraceDumpReader(TraceDumpReaderBase) :
         if tag == 0x54524344: # 'TRCD'
             return self.readTraceDict(size)
         elif tag == 0x54524353: #'TRCS'
-            data = self.file.read(size)
-            self.trace_buffers.append(data)
+            start = self.file.tell()
+            names = None
+            if self.version >= 2:
+                # the cpu's thread-name intern table precedes the records
+                n_slots = self.read('I')
+                names = []
+                for i in range(0, n_slots):
+                    thread = self.read('Q')
+                    name = self.file.read(16).partition(b'\0')[0].decode()
+                    names.append((thread, name))
+                self.align(8)
+            data = self.file.read(size - (self.file.tell() - start))
+            self.trace_buffers.append((names, data))
             return True
         else:
             return False
@@ -399,23 +413,37 @@ class TraceDumpReader(TraceDumpReaderBase) :
             self.tracepoints[tp_key] = tp
         return True
 
-    def oneTrace(self, trace_log):
+    def oneTrace(self, buffer):
+        names, trace_log = buffer
         last_tp = None
         last_trace = None
+        last_time = 0
         unpacker = SlidingUnpacker(trace_log)
         while unpacker:
             tp_key, = unpacker.unpack('Q')
             if (tp_key == 0) or (tp_key == -1):
                 break
 
-            thread, thread_name, time, cpu, flags = unpacker.unpack('Q16sQII')
+            if self.version >= 2:
+                thread, time_delta, cpu, flags, name_id = unpacker.unpack('QIHBB')
+                if flags & 2: # absolute timestamp follows the header
+                    time, = unpacker.unpack('Q')
+                else:
+                    time = last_time + time_delta
+                last_time = time
+                slot = names[name_id]
+                if thread and slot[0] == thread:
+                    thread_name = slot[1]
+                else:
+                    thread_name = '?' # slot recycled after this record
+            else:
+                thread, thread_name, time, cpu, flags = unpacker.unpack('Q16sQII')
+                thread_name = thread_name.partition(b'\0')[0].decode()
 
             tp = self.tracepoints.get(tp_key, None)
             if not tp:
                 raise SyntaxError(("Unknown trace point 0x%x" % tp_key))
 
-            thread_name = thread_name.partition(b'\0')[0].decode()
-
             backtrace = None
             if flags & 1:
                 backtrace = [_f for _f in unpacker.unpack('Q' * self.backtrace_len) if _f]
@@ -427,7 +455,7 @@ class TraceDumpReader(TraceDumpReaderBase) :
             yield last_trace
 
     def traces(self):
-        iters = [self.oneTrace(data) for data in self.trace_buffers]
+        iters = [self.oneTrace(buffer) for buffer in self.trace_buffers]
         return heapq.merge(*iters)
 
 
@@ -7,7 +7,7 @@ usage() {
 	Manipulate ZFS images on host using OpenZFS - mount, unmount and build.
 
 	Usage: ${argv0} mount <image_path> <partition> <pool_name> <filesystem> |
-	                            build <image_path> <partition> <pool_name> <filesystem> <populate_image> |
+	                            build <image_path> <partition> <pool_name> <filesystem> <populate_image> <log_device> <compression> |
 	                            unmount <pool_name>
 
 	Where:
@@ -17,6 +17,11 @@ usage() {
 	  filesystem      name of ZFS filesystem; defaults to zfs
 	  populate_image  boolean value to indicate if the image should be populated with content
 	                  from build/last/usr.manifest; defaults to true but only used with 'build' command
+	  log_device      optional host block device to add as a separate intent log (SLOG) vdev
+	                  so ZIL (fsync) writes do not compete with regular pool I/O; only used
+	                  with 'build' command
+	  compression     dataset compression the built image is left with (off, lz4, gzip, ...);
+	                  defaults to off and is only used with 'build' command
 
 	Examples:
 	  ${argv0} mount                                     # Mount OSv image from build/last/usr.img under /zfs
@@ -136,7 +141,10 @@ build_image() {
 	fi
 
 	local filesystem="$4"
-	sudo zpool create -df -R / ${pool_name} ${vdev}
+	# An optional separate log device (SLOG) keeps ZIL writes - the
+	# latency-critical part of fsync() - off the main pool vdev.
+	local log_device="$6"
+	sudo zpool create -df -R / ${pool_name} ${vdev} ${log_device:+log $log_device}
 	sudo zpool set feature@lz4_compress=enabled ${pool_name}
 
 	local dataset="$pool_name/$filesystem"
@@ -153,7 +161,10 @@ build_image() {
 		pushd "$OSV_ROOT/build/release" && sudo "$OSV_ROOT/scripts/export_manifest.py" -m usr.manifest -e /zfs/ -D libgcc_s_dir="$libgcc_s_dir" && popd
 	fi
 
-	sudo zfs set compression=off ${pool_name}
+	# Leave the pool with the requested runtime compression (default off;
+	# lz4 trades some CPU for less disk I/O and a smaller footprint).
+	local compression="${7:-off}"
+	sudo zfs set compression=${compression} ${pool_name}
 
 	unmount_image $pool_name
 }
@@ -187,7 +198,9 @@ case $command in
 		pool_name=${3:-osv}
 		filesystem=${4:-zfs}
 		populate_image=${5:-true}
-		build_image $image_path $partition $pool_name $filesystem $populate_image
+		log_device=${6:-}
+		compression=${7:-off}
+		build_image "$image_path" "$partition" "$pool_name" "$filesystem" "$populate_image" "$log_device" "$compression"
 		;;
 	*)
 		usage
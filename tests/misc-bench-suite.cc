@@ -0,0 +1,263 @@
+/*
+ * Copyright (C) 2026 Waldemar Kozaczuk
+ *
+ * This work is open source software, licensed under the terms of the
+ * BSD license as described in the LICENSE file in the top-level directory.
+ */
+
+// A single-binary microbenchmark suite intended for tracking per-commit
+// performance regressions. Unlike the scattered misc-*-perf tests, every
+// benchmark here runs with the same policy - a fixed number of warmup
+// batches that are discarded followed by a fixed number of measured
+// batches - and the results are emitted as one machine-readable JSON
+// document on stdout, together with a capture of the environment the
+// numbers were taken in (kernel version, CPU count, memory size).
+//
+// Usage: misc-bench-suite.so [warmup_batches] [measured_batches]
+//
+// The covered operations are the classic latency suspects: context
+// switch (condvar ping-pong between two threads pinned to the same CPU),
+// malloc/free of small and large objects, the futex() syscall, and
+// anonymous mmap/munmap. Per-operation latencies are reported in
+// nanoseconds as min/median/p90/p99/mean over the measured batches.
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <linux/futex.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/sysinfo.h>
+#include <sys/utsname.h>
+#include <time.h>
+#include <unistd.h>
+
+static int warmup_batches = 10;
+static int measured_batches = 50;
+
+struct bench_result {
+    std::string name;
+    unsigned batch;        // operations per measured batch
+    uint64_t min, p50, p90, p99;
+    double mean;
+};
+
+static std::vector<bench_result> results;
+
+// Run one benchmark: fn() executes a whole batch of "batch" operations
+// and the per-operation latency is the batch time divided by the batch
+// size. The warmup batches are run with the same code but thrown away.
+static void run_bench(const std::string& name, unsigned batch,
+                      std::function<void ()> fn)
+{
+    for (int i = 0; i < warmup_batches; i++) {
+        fn();
+    }
+    std::vector<uint64_t> samples;
+    samples.reserve(measured_batches);
+    for (int i = 0; i < measured_batches; i++) {
+        auto start = std::chrono::steady_clock::now();
+        fn();
+        auto end = std::chrono::steady_clock::now();
+        auto ns = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                end - start).count();
+        samples.push_back(ns / batch);
+    }
+    std::sort(samples.begin(), samples.end());
+    bench_result r;
+    r.name = name;
+    r.batch = batch;
+    r.min = samples.front();
+    r.p50 = samples[samples.size() / 2];
+    r.p90 = samples[samples.size() * 9 / 10];
+    r.p99 = samples[std::min(samples.size() - 1, samples.size() * 99 / 100)];
+    double sum = 0;
+    for (auto s : samples) {
+        sum += s;
+    }
+    r.mean = sum / samples.size();
+    results.push_back(r);
+    fprintf(stderr, "done: %s\n", name.c_str());
+}
+
+static void pin_to_cpu(unsigned cpu)
+{
+    cpu_set_t cs;
+    CPU_ZERO(&cs);
+    CPU_SET(cpu, &cs);
+    sched_setaffinity(0, sizeof(cs), &cs);
+}
+
+// Condvar ping-pong between two threads pinned to the same CPU, so
+// every handoff is a real context switch. One "operation" is a full
+// round trip, i.e. two context switches.
+static void bench_ctxsw()
+{
+    const unsigned batch = 1000;
+    std::mutex mtx;
+    std::condition_variable cv;
+    int turn = 0;           // 0 - main's turn, 1 - partner's turn
+    bool stop = false;
+    std::thread partner([&] {
+        pin_to_cpu(0);
+        std::unique_lock<std::mutex> lk(mtx);
+        while (true) {
+            cv.wait(lk, [&] { return turn == 1 || stop; });
+            if (stop) {
+                return;
+            }
+            turn = 0;
+            cv.notify_one();
+        }
+    });
+    pin_to_cpu(0);
+    run_bench("ctxsw_roundtrip", batch, [&] {
+        std::unique_lock<std::mutex> lk(mtx);
+        for (unsigned i = 0; i < batch; i++) {
+            turn = 1;
+            cv.notify_one();
+            cv.wait(lk, [&] { return turn == 0; });
+        }
+    });
+    {
+        std::unique_lock<std::mutex> lk(mtx);
+        stop = true;
+        cv.notify_one();
+    }
+    partner.join();
+    // Let later benchmarks use every CPU again
+    cpu_set_t cs;
+    CPU_ZERO(&cs);
+    for (int i = 0; i < get_nprocs(); i++) {
+        CPU_SET(i, &cs);
+    }
+    sched_setaffinity(0, sizeof(cs), &cs);
+}
+
+// Allocate a batch of objects and then free them all, so the allocator
+// cannot simply hand the same block back and forth.
+static void bench_malloc(const std::string& name, size_t size)
+{
+    const unsigned batch = 1000;
+    std::vector<void*> ptrs(batch);
+    run_bench(name, batch, [&] {
+        for (unsigned i = 0; i < batch; i++) {
+            ptrs[i] = malloc(size);
+            // Touch the object so lazily-populated memory is counted
+            *static_cast<char*>(ptrs[i]) = 1;
+        }
+        for (unsigned i = 0; i < batch; i++) {
+            free(ptrs[i]);
+        }
+    });
+}
+
+// FUTEX_WAKE with no waiters - measures the syscall entry/exit plus the
+// futex hash lookup, which is the fixed cost every contended mutex pays.
+static void bench_futex()
+{
+    const unsigned batch = 1000;
+    static int word = 0;
+    run_bench("futex_wake_nowaiter", batch, [&] {
+        for (unsigned i = 0; i < batch; i++) {
+            syscall(SYS_futex, &word, FUTEX_WAKE, 1, nullptr, nullptr, 0);
+        }
+    });
+}
+
+// mmap + touch first page + munmap, the pattern of a short-lived
+// anonymous mapping (thread stacks, malloc_large etc.)
+static void bench_mmap(const std::string& name, size_t size)
+{
+    const unsigned batch = 100;
+    run_bench(name, batch, [&] {
+        for (unsigned i = 0; i < batch; i++) {
+            void *p = mmap(nullptr, size, PROT_READ | PROT_WRITE,
+                           MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+            if (p == MAP_FAILED) {
+                perror("mmap");
+                exit(1);
+            }
+            *static_cast<char*>(p) = 1;
+            munmap(p, size);
+        }
+    });
+}
+
+static void print_json()
+{
+    struct utsname u;
+    uname(&u);
+    struct sysinfo si;
+    sysinfo(&si);
+    char now[64];
+    time_t t = time(nullptr);
+    strftime(now, sizeof(now), "%Y-%m-%dT%H:%M:%SZ", gmtime(&t));
+
+    printf("{\n");
+    printf("  \"version\": 1,\n");
+    printf("  \"timestamp\": \"%s\",\n", now);
+    printf("  \"environment\": {\n");
+    printf("    \"sysname\": \"%s\",\n", u.sysname);
+    printf("    \"release\": \"%s\",\n", u.release);
+    printf("    \"version\": \"%s\",\n", u.version);
+    printf("    \"machine\": \"%s\",\n", u.machine);
+    printf("    \"cpus\": %d,\n", get_nprocs());
+    printf("    \"total_ram\": %llu,\n",
+           (unsigned long long)si.totalram * si.mem_unit);
+    printf("    \"page_size\": %ld\n", sysconf(_SC_PAGESIZE));
+    printf("  },\n");
+    printf("  \"config\": { \"warmup_batches\": %d, \"measured_batches\": %d },\n",
+           warmup_batches, measured_batches);
+    printf("  \"results\": [\n");
+    for (size_t i = 0; i < results.size(); i++) {
+        auto& r = results[i];
+        printf("    { \"name\": \"%s\", \"unit\": \"ns\", \"batch\": %u, "
+               "\"min\": %llu, \"p50\": %llu, \"p90\": %llu, \"p99\": %llu, "
+               "\"mean\": %.1f }%s\n",
+               r.name.c_str(), r.batch,
+               (unsigned long long)r.min, (unsigned long long)r.p50,
+               (unsigned long long)r.p90, (unsigned long long)r.p99,
+               r.mean, i + 1 < results.size() ? "," : "");
+    }
+    printf("  ]\n");
+    printf("}\n");
+}
+
+int main(int argc, char** argv)
+{
+    if (argc > 1) {
+        warmup_batches = atoi(argv[1]);
+    }
+    if (argc > 2) {
+        measured_batches = atoi(argv[2]);
+    }
+    if (warmup_batches < 0 || measured_batches < 1) {
+        fprintf(stderr,
+                "usage: %s [warmup_batches >= 0] [measured_batches >= 1]\n",
+                argv[0]);
+        return 1;
+    }
+
+    bench_ctxsw();
+    bench_malloc("malloc_free_64", 64);
+    bench_malloc("malloc_free_4k", 4096);
+    bench_malloc("malloc_free_64k", 65536);
+    bench_futex();
+    bench_mmap("mmap_munmap_4k", 4096);
+    bench_mmap("mmap_munmap_1m", 1 << 20);
+
+    print_json();
+    return 0;
+}
@@ -0,0 +1,163 @@
+/*
+ * Copyright (C) 2026 Waldemar Kozaczuk
+ *
+ * This work is open source software, licensed under the terms of the
+ * BSD license as described in the LICENSE file in the top-level directory.
+ */
+
+// Measures wake-to-run latency - the time between one thread calling
+// futex(FUTEX_WAKE) and the sleeping thread being back on a cpu - in the
+// three cases that behave differently:
+//
+//   same-cpu    waker and sleeper pinned to cpu 0
+//   cross-busy  sleeper on cpu 1, which a spinner keeps out of halt
+//   cross-idle  sleeper on cpu 1, which is halted and needs a wakeup
+//               IPI to come back (the case that hurts on hypervisors
+//               with expensive idle exits)
+//
+// misc-ctxsw.cc covers the same-cpu switch cost; this one exists for the
+// two cross-cpu cases. After the runs the wakeup IPI delivery histogram
+// the scheduler keeps (cpuN ipilat_log2ns in /proc/sched_stats, measured
+// from send_wakeup_ipi() to handle_incoming_wakeups()) is printed, which
+// separates IPI delivery from the rest of the wake-to-run path.
+//
+// Usage: misc-wakeup-lat.so [iterations]
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <thread>
+#include <vector>
+
+#include <linux/futex.h>
+#include <sched.h>
+#include <stdlib.h>
+#include <sys/syscall.h>
+#include <sys/sysinfo.h>
+#include <unistd.h>
+
+using clk = std::chrono::steady_clock;
+
+static int iterations = 10000;
+
+static void pin_to_cpu(unsigned cpu)
+{
+    cpu_set_t cs;
+    CPU_ZERO(&cs);
+    CPU_SET(cpu, &cs);
+    sched_setaffinity(0, sizeof(cs), &cs);
+}
+
+static void futex_wait(std::atomic<int> *addr, int expected)
+{
+    syscall(SYS_futex, addr, FUTEX_WAIT, expected, nullptr, nullptr, 0);
+}
+
+static void futex_wake(std::atomic<int> *addr)
+{
+    syscall(SYS_futex, addr, FUTEX_WAKE, 1, nullptr, nullptr, 0);
+}
+
+// One scenario: the sleeper arms a futex word and blocks on it, the
+// waker waits settle_us (giving the target cpu a chance to reach halt in
+// the idle case), timestamps, and wakes. The sleeper timestamps as soon
+// as it is running again.
+static void run_scenario(const char* name, int waker_cpu, int sleeper_cpu,
+                         bool keep_sleeper_cpu_busy, unsigned settle_us)
+{
+    std::atomic<int> word(0);
+    std::atomic<bool> stop(false);
+    clk::time_point woken_at;
+    std::vector<uint64_t> samples;
+    samples.reserve(iterations);
+
+    std::thread spinner;
+    if (keep_sleeper_cpu_busy) {
+        spinner = std::thread([&] {
+            pin_to_cpu(sleeper_cpu);
+            while (!stop.load(std::memory_order_relaxed)) {
+                // keep the cpu out of halt without syscalls
+            }
+        });
+    }
+
+    std::thread sleeper([&] {
+        pin_to_cpu(sleeper_cpu);
+        for (int i = 0; i < iterations; i++) {
+            word.store(1, std::memory_order_release);
+            while (word.load(std::memory_order_acquire) == 1) {
+                futex_wait(&word, 1);
+            }
+            auto now = clk::now();
+            samples.push_back(std::chrono::duration_cast<
+                    std::chrono::nanoseconds>(now - woken_at).count());
+        }
+    });
+
+    pin_to_cpu(waker_cpu);
+    for (int i = 0; i < iterations; i++) {
+        while (word.load(std::memory_order_acquire) != 1) {
+            // wait for the sleeper to arm the futex word
+        }
+        // give the sleeper time to block - and its cpu time to halt
+        auto until = clk::now() + std::chrono::microseconds(settle_us);
+        while (clk::now() < until) {
+        }
+        woken_at = clk::now();
+        word.store(0, std::memory_order_release);
+        futex_wake(&word);
+    }
+    sleeper.join();
+    stop = true;
+    if (spinner.joinable()) {
+        spinner.join();
+    }
+
+    std::sort(samples.begin(), samples.end());
+    auto pct = [&] (double p) {
+        return samples[std::min(samples.size() - 1,
+                                (size_t)(samples.size() * p))] / 1000.0;
+    };
+    printf("%-10s wake-to-run usec: min %.2f p50 %.2f p99 %.2f max %.2f\n",
+           name, samples.front() / 1000.0, pct(0.5), pct(0.99),
+           samples.back() / 1000.0);
+}
+
+static void print_ipi_histograms()
+{
+    std::ifstream f("/proc/sched_stats");
+    if (!f) {
+        return;
+    }
+    std::string line;
+    while (std::getline(f, line)) {
+        if (line.find("ipilat_log2ns") != std::string::npos) {
+            std::cout << line << "\n";
+        }
+    }
+}
+
+int main(int argc, char** argv)
+{
+    if (argc > 1) {
+        iterations = atoi(argv[1]);
+    }
+    if (iterations < 1) {
+        std::cerr << "usage: " << argv[0] << " [iterations]\n";
+        return 1;
+    }
+    if (get_nprocs() < 2) {
+        std::cerr << "needs at least 2 cpus for the cross-cpu cases\n";
+        return 1;
+    }
+
+    printf("%d wakeups per scenario\n", iterations);
+    run_scenario("same-cpu", 0, 0, false, 10);
+    run_scenario("cross-busy", 0, 1, true, 10);
+    run_scenario("cross-idle", 0, 1, false, 1000);
+    print_ipi_histograms();
+    return 0;
+}
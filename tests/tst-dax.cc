@@ -33,9 +33,9 @@ public:
 // Tests on an empty window
 BOOST_FIXTURE_TEST_SUITE(empty_window_tests, dax_manager_test)
 
-    BOOST_AUTO_TEST_CASE(first_empty_empty)
+    BOOST_AUTO_TEST_CASE(free_chunks_empty)
     {
-        BOOST_TEST(first_empty() == 0);
+        BOOST_TEST(free_chunks() == window_chunks);
     }
 
     BOOST_AUTO_TEST_CASE(map_empty)
@@ -50,11 +50,10 @@ BOOST_FIXTURE_TEST_SUITE(empty_window_tests, dax_manager_test)
 
     BOOST_AUTO_TEST_CASE(unmap_empty)
     {
-        mapping_part mp {0, 0};
+        chunk freed = 0;
 
-        BOOST_TEST(unmap(1, mp) != 0);
-        BOOST_TEST(mp.mstart == 0);
-        BOOST_TEST(mp.nchunks == 0);
+        BOOST_TEST(unmap(1, freed) != 0);
+        BOOST_TEST(freed == 0);
         BOOST_TEST(_mappings.empty());
     }
 
@@ -95,15 +94,16 @@ public:
         // At this point the window's state is:
         // | f[0] | f[1] | f[2] | f[5] | f[6] | empty | empty |...
         // |     mapping #1     |  mapping #2 |
+        // Mapping #1 is the least recently used.
     }
 };
 
 // Tests on a pre-populated window
 BOOST_FIXTURE_TEST_SUITE(populated_window_tests, dax_manager_test_populated)
 
-    BOOST_AUTO_TEST_CASE(first_empty_populated)
+    BOOST_AUTO_TEST_CASE(free_chunks_populated)
     {
-        BOOST_TEST(first_empty() == 5);
+        BOOST_TEST(free_chunks() == 5);
     }
 
     BOOST_AUTO_TEST_CASE(map_coalesce)
@@ -128,81 +128,77 @@ BOOST_FIXTURE_TEST_SUITE(populated_window_tests, dax_manager_test_populated)
 
     BOOST_AUTO_TEST_CASE(unmap_stable)
     {
-        mapping_part mp {0, 0};
+        chunk freed = 1;
 
-        BOOST_TEST(unmap(0, mp) == 0);
-        BOOST_TEST(mp.mstart == 5);
-        BOOST_TEST(mp.nchunks == 0);
+        BOOST_TEST(unmap(0, freed) == 0);
+        BOOST_TEST(freed == 0);
         BOOST_TEST(_mappings.size() == 2);
     }
 
-    BOOST_AUTO_TEST_CASE(unmap_one_whole)
+    BOOST_AUTO_TEST_CASE(unmap_one_lru)
     {
-        mapping_part mp {0, 0};
+        chunk freed = 0;
 
-        BOOST_TEST(unmap(2, mp) == 0);
-        BOOST_TEST(mp.mstart == 3);
-        BOOST_TEST(mp.nchunks == 2);
+        // Mapping #1 is the least recently used, so it goes first
+        BOOST_TEST(unmap(1, freed) == 0);
+        BOOST_TEST(freed == 3);
         BOOST_TEST(_mappings.size() == 1);
+        BOOST_TEST(_mappings.front().mstart == 3);
     }
 
-    BOOST_AUTO_TEST_CASE(unmap_one_part)
+    BOOST_AUTO_TEST_CASE(unmap_respects_recent_use)
     {
         mapping_part mp {0, 0};
+        chunk freed = 0;
 
-        BOOST_TEST(unmap(1, mp) == 0);
-        BOOST_TEST(mp.mstart == 4);
-        BOOST_TEST(mp.nchunks == 1);
-        BOOST_TEST(_mappings.size() == 2);
-    }
-
-    BOOST_AUTO_TEST_CASE(unmap_multiple_part)
-    {
-        mapping_part mp {0, 0};
-
-        BOOST_TEST(unmap(3, mp) == 0);
-        BOOST_TEST(mp.mstart == 2);
-        BOOST_TEST(mp.nchunks == 3);
+        // A find() on mapping #1 makes mapping #2 the eviction victim
+        BOOST_TEST_REQUIRE(find(nodeid, 0, mp));
+        BOOST_TEST(unmap(1, freed) == 0);
+        BOOST_TEST(freed == 2);
         BOOST_TEST(_mappings.size() == 1);
+        BOOST_TEST(_mappings.front().mstart == 0);
     }
 
-    BOOST_AUTO_TEST_CASE(unmap_all)
+    BOOST_AUTO_TEST_CASE(unmap_multiple)
     {
-        mapping_part mp {0, 0};
+        chunk freed = 0;
 
-        BOOST_TEST(unmap(5, mp) == 0);
-        BOOST_TEST(mp.mstart == 0);
-        BOOST_TEST(mp.nchunks == 5);
+        BOOST_TEST(unmap(4, freed) == 0);
+        BOOST_TEST(freed == 5);
         BOOST_TEST(_mappings.empty());
     }
 
     BOOST_AUTO_TEST_CASE(unmap_excess)
     {
-        mapping_part mp {0, 0};
+        chunk freed = 0;
 
-        BOOST_TEST(unmap(6, mp) == 0);
-        BOOST_TEST(mp.mstart == 0);
-        BOOST_TEST(mp.nchunks == 5);
+        BOOST_TEST(unmap(6, freed) == 0);
+        BOOST_TEST(freed == 5);
         BOOST_TEST(_mappings.empty());
     }
 
-    BOOST_AUTO_TEST_CASE(map_evict_part)
+    BOOST_AUTO_TEST_CASE(map_evict_lru)
     {
         mapping_part mp {0, 0};
 
+        // Mapping #1 is the least recently used; evicting it alone does not
+        // open a large enough gap, so mapping #2 goes as well
         BOOST_TEST(map(nodeid, file_handle, 6, 0, mp, true) == 0);
-        BOOST_TEST(mp.mstart == 4);
+        BOOST_TEST(mp.mstart == 0);
         BOOST_TEST(mp.nchunks == 6);
-        BOOST_TEST(_mappings.size() == 3);
+        BOOST_TEST(_mappings.size() == 1);
     }
 
-    BOOST_AUTO_TEST_CASE(map_evict_multiple_part)
+    BOOST_AUTO_TEST_CASE(map_evict_respects_recent_use)
     {
         mapping_part mp {0, 0};
 
-        BOOST_TEST(map(nodeid, file_handle, 9, 0, mp, true) == 0);
-        BOOST_TEST(mp.mstart == 1);
-        BOOST_TEST(mp.nchunks == 9);
+        // A find() on mapping #1 makes mapping #2 the eviction victim,
+        // opening the gap m[3]-m[9]
+        BOOST_TEST_REQUIRE(find(nodeid, 0, mp));
+        BOOST_TEST(map(nodeid, file_handle, 6, 10, mp, true) == 0);
+        BOOST_TEST(mp.mstart == 3);
+        BOOST_TEST(mp.nchunks == 6);
         BOOST_TEST(_mappings.size() == 2);
     }
 
@@ -249,6 +245,17 @@ BOOST_FIXTURE_TEST_SUITE(populated_window_tests, dax_manager_test_populated)
         BOOST_TEST(mp.nchunks == 1);
     }
 
+    BOOST_AUTO_TEST_CASE(find_counts_hits)
+    {
+        mapping_part mp {0, 0};
+
+        BOOST_TEST(_mappings.front().hits == 0);
+        BOOST_TEST_REQUIRE(find(nodeid, 0, mp));
+        BOOST_TEST_REQUIRE(find(nodeid, 1, mp));
+        BOOST_TEST(_mappings.front().hits == 2);
+        BOOST_TEST(_mappings.back().hits == 0);
+    }
+
 BOOST_AUTO_TEST_SUITE_END()
 
 // A full dax_manager_test. Used as a test case fixture.
@@ -263,14 +270,15 @@ public:
         // At this point the window's state is:
         // | f[0] | f[1] | f[2] | f[5] | f[6] | f[10] | f[11] | f[12] | f[13] | f[14] |
         // |     mapping #1     |  mapping #2 |               mapping #3              |
+        // Mapping #1 is the least recently used.
     }
 };
 
 BOOST_FIXTURE_TEST_SUITE(full_window_tests, dax_manager_test_full)
 
-    BOOST_AUTO_TEST_CASE(first_empty_full)
+    BOOST_AUTO_TEST_CASE(free_chunks_full)
     {
-        BOOST_TEST(first_empty() == window_chunks);
+        BOOST_TEST(free_chunks() == 0);
     }
 
     BOOST_AUTO_TEST_CASE(map_full)
@@ -287,10 +295,11 @@ BOOST_FIXTURE_TEST_SUITE(full_window_tests, dax_manager_test_full)
     {
         mapping_part mp {0, 0};
 
+        // Mapping #1 is the least recently used, so its chunks are reused
         BOOST_TEST(map(nodeid, file_handle, 1, 0, mp, true) == 0);
-        BOOST_TEST(mp.mstart == 9);
+        BOOST_TEST(mp.mstart == 0);
         BOOST_TEST(mp.nchunks == 1);
-        BOOST_TEST(_mappings.size() == 4);
+        BOOST_TEST(_mappings.size() == 3);
     }
 
     BOOST_AUTO_TEST_CASE(find_absent)
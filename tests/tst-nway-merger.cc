@@ -192,6 +192,68 @@ bool test_list(list<my_struct>& dest)
     return true;
 }
 
+/**
+ * A cursor over a sorted vector - the minimal stream interface the
+ * nway_stream_merger expects
+ */
+class my_cursor {
+public:
+    explicit my_cursor(const vector<my_struct>* v) : _v(v) {}
+    bool empty() const { return _pos == _v->size(); }
+    const my_struct& front() const { return (*_v)[_pos]; }
+    void pop() { _pos++; }
+private:
+    const vector<my_struct>* _v;
+    size_t _pos = 0;
+};
+
+static bool test_stream_merger()
+{
+    vector<my_struct> a, b, c;
+    fill_abc(a, b, c);
+    auto total = a.size() + b.size() + c.size();
+
+    my_cursor ca(&a), cb(&b), cc(&c);
+    osv::nway_stream_merger<my_cursor> m;
+    m.add_stream(&ca);
+    m.add_stream(&cb);
+    m.add_stream(&cc);
+
+    // Drain in small batches to exercise the heap re-seeding between
+    // calls
+    list<my_struct> dest;
+    while (m.drain(back_inserter(dest), 4)) {
+    }
+
+    if (dest.size() != total) {
+        cerr<<"nway_stream_merger lost records ("<<dest.size()<<" of "
+            <<total<<")! FAIL"<<endl;
+        return false;
+    }
+
+    auto t = dest.front();
+    dest.pop_front();
+    cout<<t<<" ";
+    for (auto s : dest) {
+        if (t > s) {
+            cerr<<"nway_stream_merger is broken! FAIL"<<endl;
+            return false;
+        }
+        t = s;
+        cout<<t<<" ";
+    }
+    cout<<endl;
+
+    // A second drain must find all the streams exhausted
+    if (m.drain(back_inserter(dest), 4)) {
+        cerr<<"nway_stream_merger emitted from exhausted streams! FAIL"<<endl;
+        return false;
+    }
+
+    cout<<"nway_stream_merger tesing is ok"<<endl;
+    return true;
+}
+
 int main(int argc, char *argv[])
 {
     list<my_struct> dest;
@@ -236,5 +298,10 @@ int main(int argc, char *argv[])
         }
     }
 
+    // Test the non-destructive cursor-based stream merger
+    if (!test_stream_merger()) {
+        return 1;
+    }
+
     return 0;
 }
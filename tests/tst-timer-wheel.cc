@@ -0,0 +1,200 @@
+/*
+ * Copyright (C) 2026 Waldemar Kozaczuk
+ *
+ * This work is open source software, licensed under the terms of the
+ * BSD license as described in the LICENSE file in the top-level directory.
+ *
+ * To compile on Linux:
+ * g++ -g -pthread -std=c++11 tests/tst-timer-wheel.cc -o tests/tst-timer-wheel \
+ *   -I./include -lboost_unit_test_framework -DBOOST_TEST_DYN_LINK
+ */
+
+#define BOOST_TEST_MODULE tst-timer-wheel
+
+#include <chrono>
+#include <unordered_set>
+#include <stdio.h>
+#include <osv/timer-wheel.hh>
+#include <boost/test/unit_test.hpp>
+
+using Clock = std::chrono::steady_clock;
+
+class test_timer
+{
+private:
+    Clock::time_point _timeout;
+
+public:
+    test_timer(Clock::time_point _time_point)
+        : _timeout(_time_point)
+    {
+    }
+
+    Clock::time_point get_timeout()
+    {
+        return _timeout;
+    }
+
+    void set_timeout(Clock::time_point new_timeout)
+    {
+        _timeout = new_timeout;
+    }
+public:
+    bi::list_member_hook<> link;
+};
+
+using timer_wheel_t = timer_wheel<test_timer, &test_timer::link, Clock>;
+using timer_ptr_set = std::unordered_set<test_timer*>;
+
+static constexpr Clock::duration::rep slot_width = 1 << 20;
+
+static Clock::time_point abs_time_point(Clock::duration::rep value)
+{
+    return Clock::time_point(Clock::duration(value));
+}
+
+static timer_ptr_set get_expired(timer_wheel_t& timers)
+{
+    timer_ptr_set set;
+    test_timer* timer;
+    while ((timer = timers.pop_expired())) {
+        set.insert(timer);
+    }
+    return set;
+}
+
+BOOST_AUTO_TEST_CASE(test_insertion_and_expiry_across_slots)
+{
+    timer_wheel_t _timers;
+
+    test_timer t1(abs_time_point(slot_width / 2));      // slot 0
+    test_timer t2(abs_time_point(slot_width * 3 / 2));  // slot 1
+    test_timer t3(abs_time_point(slot_width * 7 / 2));  // slot 3
+
+    BOOST_REQUIRE(_timers.empty());
+    BOOST_REQUIRE(_timers.insert(t1));
+    BOOST_REQUIRE(!_timers.insert(t2));
+    BOOST_REQUIRE(!_timers.insert(t3));
+    BOOST_REQUIRE(!_timers.empty());
+
+    // t1's slot ends at slot_width; nothing is due before that
+    BOOST_REQUIRE(_timers.get_next_timeout() == abs_time_point(slot_width));
+
+    _timers.expire(abs_time_point(slot_width));
+    BOOST_REQUIRE(get_expired(_timers) == timer_ptr_set({&t1}));
+
+    _timers.expire(abs_time_point(slot_width * 2));
+    BOOST_REQUIRE(get_expired(_timers) == timer_ptr_set({&t2}));
+
+    // expiring several slots at once collects everything due
+    _timers.expire(abs_time_point(slot_width * 8));
+    BOOST_REQUIRE(get_expired(_timers) == timer_ptr_set({&t3}));
+    BOOST_REQUIRE(_timers.empty());
+}
+
+BOOST_AUTO_TEST_CASE(test_timers_in_same_slot_share_one_deadline)
+{
+    timer_wheel_t _timers;
+
+    test_timer t1(abs_time_point(slot_width * 5 + 1));
+    test_timer t2(abs_time_point(slot_width * 5 + 2));
+    test_timer t3(abs_time_point(slot_width * 6 - 1));
+
+    // only the first insert into the slot should demand a rearm
+    BOOST_REQUIRE(_timers.insert(t1));
+    BOOST_REQUIRE(!_timers.insert(t2));
+    BOOST_REQUIRE(!_timers.insert(t3));
+    BOOST_REQUIRE(_timers.get_next_timeout() == abs_time_point(slot_width * 6));
+
+    _timers.expire(abs_time_point(slot_width * 6));
+    BOOST_REQUIRE(get_expired(_timers) == timer_ptr_set({&t1, &t2, &t3}));
+    BOOST_REQUIRE(_timers.empty());
+}
+
+BOOST_AUTO_TEST_CASE(test_cancellation)
+{
+    timer_wheel_t _timers;
+
+    test_timer t1(abs_time_point(slot_width + 1));
+    test_timer t2(abs_time_point(slot_width + 2));
+
+    _timers.insert(t1);
+    _timers.insert(t2);
+    _timers.remove(t1);
+
+    _timers.expire(abs_time_point(slot_width * 3));
+    BOOST_REQUIRE(get_expired(_timers) == timer_ptr_set({&t2}));
+    BOOST_REQUIRE(_timers.empty());
+}
+
+BOOST_AUTO_TEST_CASE(test_far_timers_are_parked_and_pulled_in)
+{
+    timer_wheel_t _timers;
+
+    // horizon is 256 slots; this one is well beyond it
+    test_timer far(abs_time_point(slot_width * 1000 + 5));
+    BOOST_REQUIRE(_timers.insert(far));
+    BOOST_REQUIRE(!_timers.empty());
+
+    // a near timer coexists with the far one
+    test_timer near(abs_time_point(slot_width * 2 + 5));
+    _timers.insert(near);
+
+    _timers.expire(abs_time_point(slot_width * 3));
+    BOOST_REQUIRE(get_expired(_timers) == timer_ptr_set({&near}));
+    BOOST_REQUIRE(!_timers.empty());
+
+    // once the wheel turns close enough the far timer migrates to a slot
+    // and expires at its slot boundary
+    _timers.expire(abs_time_point(slot_width * 900));
+    BOOST_REQUIRE(get_expired(_timers).empty());
+    _timers.expire(abs_time_point(slot_width * 1001));
+    BOOST_REQUIRE(get_expired(_timers) == timer_ptr_set({&far}));
+    BOOST_REQUIRE(_timers.empty());
+}
+
+BOOST_AUTO_TEST_CASE(test_far_timer_cancellation)
+{
+    timer_wheel_t _timers;
+
+    test_timer far(abs_time_point(slot_width * 1000));
+    _timers.insert(far);
+    _timers.remove(far);
+    BOOST_REQUIRE(_timers.empty());
+
+    _timers.expire(abs_time_point(slot_width * 2000));
+    BOOST_REQUIRE(get_expired(_timers).empty());
+}
+
+BOOST_AUTO_TEST_CASE(test_insertion_of_already_due_timer)
+{
+    timer_wheel_t _timers;
+
+    _timers.expire(abs_time_point(slot_width * 10));
+
+    // a timer armed in the past should demand an immediate rearm and
+    // expire on the very next pass
+    test_timer late(abs_time_point(slot_width * 4));
+    BOOST_REQUIRE(_timers.insert(late));
+    BOOST_REQUIRE(_timers.get_next_timeout() <= abs_time_point(slot_width * 10));
+
+    _timers.expire(abs_time_point(slot_width * 10 + 1));
+    BOOST_REQUIRE(get_expired(_timers) == timer_ptr_set({&late}));
+    BOOST_REQUIRE(_timers.empty());
+}
+
+BOOST_AUTO_TEST_CASE(test_reinsertion_after_expiry)
+{
+    timer_wheel_t _timers;
+
+    test_timer t1(abs_time_point(slot_width / 2));
+    _timers.insert(t1);
+    _timers.expire(abs_time_point(slot_width));
+    BOOST_REQUIRE(get_expired(_timers) == timer_ptr_set({&t1}));
+
+    t1.set_timeout(abs_time_point(slot_width * 3 + 1));
+    BOOST_REQUIRE(_timers.insert(t1));
+    _timers.expire(abs_time_point(slot_width * 4));
+    BOOST_REQUIRE(get_expired(_timers) == timer_ptr_set({&t1}));
+    BOOST_REQUIRE(_timers.empty());
+}
@@ -24,8 +24,10 @@ static void run_cmd(const char *cmdpath, vector<string> args)
     assert(ret == 0);
 }
 
-// Get extra blk devices for pool creation.
-static void get_blk_devices(vector<string> &zpool_args)
+// Get extra blk devices for pool creation. The device reserved as the
+// pool's separate intent log, if any, must not show up here as a regular
+// top-level vdev.
+static void get_blk_devices(vector<string> &zpool_args, const string &log_dev)
 {
     DIR *dir;
     struct dirent *entry;
@@ -44,6 +46,10 @@ static void get_blk_devices(vector<string> &zpool_args)
             continue;
         }
 
+        if ("/dev/" + string(entry->d_name) == log_dev) {
+            continue;
+        }
+
         zpool_args.push_back("/dev/" + string(entry->d_name));
     }
 
@@ -62,10 +68,19 @@ static void mkfs(int ac, char** av)
     assert(fd != -1);
     close(fd);
 
-    const char *dev_name = ac == 2 ? av[1] : "/dev/vblk0.1";
+    const char *dev_name = ac >= 2 ? av[1] : "/dev/vblk0.1";
+    // An optional 2nd argument names a device to be used as a separate
+    // intent log (SLOG) so that ZIL writes - the latency-critical part of
+    // fsync() - do not compete with regular pool I/O.
+    string log_dev = ac >= 3 ? av[2] : "";
     vector<string> zpool_args = {"zpool", "create", "-f", "-R", "/zfs", "osv", dev_name};
 
-    get_blk_devices(zpool_args);
+    get_blk_devices(zpool_args, log_dev);
+
+    if (!log_dev.empty()) {
+        zpool_args.push_back("log");
+        zpool_args.push_back(log_dev);
+    }
 
     // Create zpool named osv
     run_cmd("/zpool.so", zpool_args);
@@ -78,7 +93,8 @@ static void mkfs(int ac, char** av)
     run_cmd("/zfs.so", {"zfs", "set", "canmount=noauto", "osv/zfs"});
 
     // Enable lz4 compression on the created zfs dataset
-    // NOTE: Compression is disabled after image creation.
+    // NOTE: scripts/build resets compression after image creation to
+    // whatever its zfs_compression option asks for (off by default).
     run_cmd("/zfs.so", {"zfs", "set", "compression=lz4", "osv"});
 }
 